@@ -0,0 +1,83 @@
+//インスタンス毎の視錐台カリングとLOD選択を行い、ExecuteIndirectの引数を組み立てるコンピュートシェーダー
+//CPU側のInstanceCuller + MeshInfo::SelectLodと同じ判定をしている
+
+#define THREAD_GROUP_SIZE 64
+#define MAX_LOD_COUNT 8
+
+//IndirectDrawCommand(32バイト)の中のバイトオフセット
+//  0:マテリアル番号 4:メッシュ番号 8:インスタンス番号の表の開始位置
+//  12:D3D12_DRAW_INDEXED_ARGUMENTS(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation)
+#define COMMAND_STRIDE 32
+#define COMMAND_INSTANCE_OFFSET 8
+#define COMMAND_INSTANCE_COUNT 16
+
+cbuffer cull_frame : register(b0)
+{
+    float4 FrustumPlanes[6];
+    float3 EyePosition;
+    float LodScale;
+    float MaxPixelError;
+    uint InstanceCount;
+    float2 padding;
+}
+
+cbuffer cull_mesh : register(b1)
+{
+    uint MeshIdx;
+    uint CommandBase;
+}
+
+struct MeshCullData
+{
+    float4 bounding_sphere;
+    float lod_errors[MAX_LOD_COUNT];
+    uint lod_count;
+    uint3 padding;
+};
+
+StructuredBuffer<float4x4> ObjWorld : register(t0);
+StructuredBuffer<MeshCullData> MeshData : register(t1);
+RWByteAddressBuffer Commands : register(u0);
+RWStructuredBuffer<uint> InstanceIds : register(u1);
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void main(uint3 dispatch_id : SV_DispatchThreadID)
+{
+    uint object_id = dispatch_id.x;
+    if (object_id >= InstanceCount)
+        return;
+
+    MeshCullData mesh = MeshData[MeshIdx];
+    float4x4 world = ObjWorld[object_id];
+    float3 center = mul(world, float4(mesh.bounding_sphere.xyz, 1.0)).xyz;
+    //各軸のスケールの最大値で半径を拡大する
+    float3 axis_x = mul(world, float4(1.0, 0.0, 0.0, 0.0)).xyz;
+    float3 axis_y = mul(world, float4(0.0, 1.0, 0.0, 0.0)).xyz;
+    float3 axis_z = mul(world, float4(0.0, 0.0, 1.0, 0.0)).xyz;
+    float radius = mesh.bounding_sphere.w * sqrt(max(dot(axis_x, axis_x), max(dot(axis_y, axis_y), dot(axis_z, axis_z))));
+
+    //視錐台カリング
+    [unroll]
+    for (uint plane = 0; plane < 6; plane++)
+    {
+        if (dot(FrustumPlanes[plane].xyz, center) + FrustumPlanes[plane].w < -radius)
+            return;
+    }
+
+    //誤差が画面上でMaxPixelError以下に収まる中で、一番粗いLODを選ぶ
+    float screen_size = 2.0 * radius * LodScale / max(length(center - EyePosition), 0.1);
+    uint lod = 0;
+    for (uint i = 1; i < mesh.lod_count; i++)
+    {
+        if (mesh.lod_errors[i] * screen_size > MaxPixelError)
+            break;
+        lod = i;
+    }
+
+    //選んだドローのInstanceCountを1つ増やして、増やす前の値を表の中の位置にする
+    uint command_address = (CommandBase + lod) * COMMAND_STRIDE;
+    uint slot;
+    Commands.InterlockedAdd(command_address + COMMAND_INSTANCE_COUNT, 1, slot);
+    uint instance_offset = Commands.Load(command_address + COMMAND_INSTANCE_OFFSET);
+    InstanceIds[instance_offset + slot] = object_id;
+}
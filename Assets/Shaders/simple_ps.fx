@@ -40,13 +40,13 @@ float3x3 calcCotangentFrame(float3 N, float3 p, float2 uv)
 //!	@param	[in]	N	法線
 //!	@param	[in]	p	ワールド座標
 //!	@param	[in]	uv	テクスチャ座標
+//!	@param	[in]	texture_xy	法線マップから読んだ値(XYだけを使う。BC5に圧縮した法線マップはZを持たない)
 //----------------------------------------------------------------------------
-float3 Normalmap(float3 N, float3 p, float2 uv, Texture2D NormalTexture, SamplerState NormalSampler)
+float3 Normalmap(float3 N, float3 p, float2 uv, float2 texture_xy)
 {
-	// 法線マップテクスチャを読み込み
-    float3 texture_normal = NormalTexture.Sample(NormalSampler, uv).rgb;
-	// デコード
-    texture_normal = texture_normal * 2 - 1;
+	// デコード(Zは単位ベクトルになるように復元する)
+    texture_xy = texture_xy * 2 - 1;
+    float3 texture_normal = float3(texture_xy, sqrt(saturate(1.0 - dot(texture_xy, texture_xy))));
 
 	// タンジェント空間を変換
     float3x3 TBN = calcCotangentFrame(N, p, uv);
@@ -79,32 +79,91 @@ cbuffer system_cbuffer : register(b4)
     float system_time;
 }
 
+//マテリアルテーブルの1要素(MaterialTable::GpuMaterialと同じ並び)
 struct MaterialData
 {
     float4 diffuse_color;
     float metallic;
     float roughness;
-    uint tex_idx[10];
+    uint tex_idx[3];    // SRVの番号を16bitずつ詰めたもの(偶数のスロットが下位)
+    uint flags;
 };
 
+//テクスチャのスロット(MaterialTable::TextureSlotと同じ順)
+#define TEXTURE_SLOT_DIFFUSE 0
+#define TEXTURE_SLOT_NORMAL 1
+#define TEXTURE_SLOT_ROUGHNESS 2
+#define TEXTURE_SLOT_METALLIC 3
+#define TEXTURE_SLOT_EMISSION 4
+
+//スロットのSRVの番号を取り出す
+uint GetTextureIndex(MaterialData mat, uint slot)
+{
+    return (mat.tex_idx[slot >> 1] >> ((slot & 1) * 16)) & 0xffff;
+}
+
+//アトラスや配列にまとめたテクスチャ1つ分の参照(MaterialTable::GpuAtlasEntryと同じ並び)
+struct AtlasEntryData
+{
+    uint srv_index;     // まとめた先のTexture2DArrayのSRVの番号
+    uint array_index;   // 配列の要素の番号
+    float2 uv_scale;    // uv * uv_scale + uv_offsetで、配列の要素の中のUVになる
+    float2 uv_offset;
+    uint2 padding;
+};
+//この値が立っているスロットの番号は、AtlasEntriesの番号(MaterialTable::ATLAS_ENTRY_BIT)
+#define TEXTURE_ATLAS_ENTRY_BIT 0x8000
 
 
 StructuredBuffer<MaterialData> Mat : register(t0);
 
 SamplerState sampler1 : register(s0);
 Texture2D Tex[] : register(t5);
+//アトラスの参照の表と、同じディスクリプタをTexture2DArrayとして読む配列
+StructuredBuffer<AtlasEntryData> AtlasEntries : register(t0, space1);
+Texture2DArray TexArray[] : register(t1, space1);
+
+//----------------------------------------------------------------------------
+//!	マテリアルのスロットのテクスチャを読みます
+//!	@param	[in]	lod	負ならミップを自動で選ぶ。0以上ならそのミップを読む
+//!	アトラスにまとめたものは、UVが0~1の外で繰り返せないのでfracしてから変換する。
+//!	fracした所でミップが飛ばないように、ミップは変換前のUVの変化量から選ぶ
+//----------------------------------------------------------------------------
+float4 SampleMaterialTexture(MaterialData mat, uint slot, SamplerState texture_sampler, float2 uv, float lod = -1.0)
+{
+    uint index = GetTextureIndex(mat, slot);
+    if ((index & TEXTURE_ATLAS_ENTRY_BIT) != 0)
+    {
+        AtlasEntryData entry = AtlasEntries[index & ~TEXTURE_ATLAS_ENTRY_BIT];
+        float3 atlas_uv = float3(frac(uv) * entry.uv_scale + entry.uv_offset, entry.array_index);
+        if (lod >= 0.0)
+        {
+            return TexArray[entry.srv_index].SampleLevel(texture_sampler, atlas_uv, lod);
+        }
+        return TexArray[entry.srv_index].SampleGrad(texture_sampler, atlas_uv, ddx(uv) * entry.uv_scale, ddy(uv) * entry.uv_scale);
+    }
+    if (lod >= 0.0)
+    {
+        return Tex[index].SampleLevel(texture_sampler, uv, lod);
+    }
+    return Tex[index].Sample(texture_sampler, uv);
+}
+
+#ifdef VIRTUAL_TEXTURE
+#include "virtual_texture.hlsli"
+#endif
 
 float4 main(PSInput input) : SV_TARGET
 {
 
     float4 output_color0 = float4(1, 1, 1, 1);
     MaterialData mat = Mat[MatIdx];
-    Texture2D diffuse_texture = Tex[mat.tex_idx[0]];
-    Texture2D normal_texture = Tex[mat.tex_idx[1]];
-    Texture2D roughness_texture = Tex[mat.tex_idx[2]];
-    Texture2D metallic_texture = Tex[mat.tex_idx[3]];
-    Texture2D emission_texture = Tex[mat.tex_idx[4]];
-    float4 texture_color = diffuse_texture.Sample(sampler1, input.uv);
+#ifdef VIRTUAL_TEXTURE
+    //ディフューズは、仮想テクスチャの0番から必要なページだけを読む
+    float4 texture_color = SampleVirtualTexture(Tex[VTPageTable[VT_PHYSICAL_SRV_INDEX]], sampler1, 0, input.uv, input.sv_position.xy);
+#else
+    float4 texture_color = SampleMaterialTexture(mat, TEXTURE_SLOT_DIFFUSE, sampler1, input.uv);
+#endif
     output_color0 = input.color;
     texture_color *= mat.diffuse_color;
     
@@ -115,13 +174,13 @@ float4 main(PSInput input) : SV_TARGET
     //output_color0.rgb *= input.color * frac(system_time);
     //output_color0.a = 1.0;
     float3 albedo = texture_color.rgb;
-    float metallic = metallic_texture.SampleLevel(sampler1, input.uv, 5).r;
-    float roughness = roughness_texture.SampleLevel(sampler1, input.uv, 5).r;
+    float metallic = SampleMaterialTexture(mat, TEXTURE_SLOT_METALLIC, sampler1, input.uv, 5).r;
+    float roughness = SampleMaterialTexture(mat, TEXTURE_SLOT_ROUGHNESS, sampler1, input.uv, 5).r;
     metallic = 0.7;
     roughness = 0.7;
     
     static float3 L = normalize(float3(0.0,1.0,-1.0));
-    float3 N = Normalmap(normalize(input.normal), input.world_position.xyz, input.uv, normal_texture, sampler1);
+    float3 N = Normalmap(normalize(input.normal), input.world_position.xyz, input.uv, SampleMaterialTexture(mat, TEXTURE_SLOT_NORMAL, sampler1, input.uv).rg);
     float3 V = normalize(eye_position - input.world_position.xyz);
     float3 H = normalize(L + V);
     float NdotH = saturate(dot(N, H)) + 0.000001;
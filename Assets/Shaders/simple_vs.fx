@@ -1,9 +1,21 @@
+//頂点の並びはCPU側のVertexFormatが決める。
+//同じフラグからマクロが渡されてくるので、インプットレイアウトとデコードが食い違うことはない
 struct VSInput
 {
+#ifdef VTX_POSITION_UNORM16
+    float4 pos : POSITION;
+#else
     float3 pos : POSITION;
+#endif
+#ifndef VTX_COLOR_OMIT
     float4 color : COLOR;
+#endif
     float2 uv : TEXCOORD0;
+#ifdef VTX_NORMAL_OCTAHEDRAL
+    float2 normal : NORMAL;
+#else
     float3 normal : NORMAL;
+#endif
     uint instance_id : SV_InstanceID;
 };
 
@@ -30,22 +42,75 @@ cbuffer system_cbuffer : register(b4)
 }
 
 
+cbuffer mesh_constant : register(b1)
+{
+    uint MeshIdx;
+}
+
+//LOD毎にまとめたインスタンス番号の、このドローコールでの開始位置
+cbuffer instance_constant : register(b2)
+{
+    uint InstanceOffset;
+}
+
+struct VertexDequant
+{
+    float3 offset;
+    float padding0;
+    float3 scale;
+    float padding1;
+};
+
 StructuredBuffer<float4x4> ObjWorld : register(t1);
+StructuredBuffer<VertexDequant> MeshDequant : register(t2);
+StructuredBuffer<uint> InstanceIds : register(t3);
+
+//16bit正規化された位置を、メッシュ毎のAABBを使って元の座標に戻す
+float3 DecodePosition(VSInput input)
+{
+#ifdef VTX_POSITION_UNORM16
+    VertexDequant dq = MeshDequant[MeshIdx];
+    return dq.offset + input.pos.xyz * dq.scale;
+#else
+    return input.pos;
+#endif
+}
+
+//八面体エンコードされた法線を3成分に戻す
+float3 DecodeNormal(VSInput input)
+{
+#ifdef VTX_NORMAL_OCTAHEDRAL
+    float3 n = float3(input.normal.xy, 1.0 - abs(input.normal.x) - abs(input.normal.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+#else
+    return input.normal;
+#endif
+}
 
 VSOutput main(VSInput input)
 {
 
     VSOutput output;
 
-    float3 world_position = mul(ObjWorld[input.instance_id], float4(input.pos, 1.0)).xyz;
+    //SV_InstanceIDはドローコール毎に0から始まるので、LOD毎の表からオブジェクトの番号を引く
+    uint object_id = InstanceIds[InstanceOffset + input.instance_id];
+    float3 local_position = DecodePosition(input);
+    float3 local_normal = DecodeNormal(input);
+    float3 world_position = mul(ObjWorld[object_id], float4(local_position, 1.0)).xyz;
     float3 view_position = mul(view_matrix, float4(world_position, 1.0)).xyz;
     float4 screen_position = mul(projection_matrix, float4(view_position, 1.0));
     output.world_position = float4(world_position, 1.0);
     output.sv_position = screen_position;
+#ifdef VTX_COLOR_OMIT
+    output.color = float4(1.0, 1.0, 1.0, 1.0);
+#else
     output.color = input.color;
+#endif
     output.uv = input.uv;
-    output.normal = mul(ObjWorld[input.instance_id], float4(input.normal, 0.0)).xyz;
-    output.instance = input.instance_id;
+    output.normal = mul(ObjWorld[object_id], float4(local_normal, 0.0)).xyz;
+    output.instance = object_id;
     return output;
 
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef VIRTUAL_TEXTURE_HLSLI
+#define VIRTUAL_TEXTURE_HLSLI
+
+//仮想テクスチャのページテーブル(VirtualTexturePageTableと同じ並び)
+//先頭のヘッダー、テクスチャ毎の情報、ミップ毎の表の順に並ぶ
+StructuredBuffer<uint> VTPageTable : register(t4);
+//欲しいページを書くフィードバック(VirtualTexture::BeginFrameでEMPTYに戻す)
+RWStructuredBuffer<uint> VTFeedback : register(u0);
+
+#define VT_HEADER_SIZE 8
+#define VT_INFO_STRIDE 16
+#define VT_PHYSICAL_PAGES_X 0
+#define VT_PHYSICAL_PAGES_Y 1
+#define VT_PAGE_SIZE 2
+#define VT_BORDER 3
+#define VT_PHYSICAL_SRV_INDEX 4
+#define VT_FEEDBACK_WIDTH 5
+#define VT_FEEDBACK_SCALE 6
+#define VT_VALID_BIT 0x80000000
+
+//ページを32bitに詰める(VirtualTextureFeedback::Packと同じ並び)
+uint VTPackPage(uint texture, uint mip, uint2 page)
+{
+    return (texture << 28) | (mip << 24) | (page.y << 12) | page.x;
+}
+
+//----------------------------------------------------------------------------
+//!	仮想テクスチャを読みます
+//!	@param	[in]	physical	物理キャッシュ(Tex[VTPageTable[VT_PHYSICAL_SRV_INDEX]])
+//!	@param	[in]	texture		VirtualTexture::Registerで受け取った番号
+//!	@param	[in]	uv			テクスチャ座標(範囲の外は繰り返す)
+//!	@param	[in]	screen_pos	SV_POSITION(フィードバックを書く場所を決める)
+//!	欲しいページが無ければ、キャッシュにある一番近い親のページを読む。1枚も無ければ灰色を返す
+//----------------------------------------------------------------------------
+float4 SampleVirtualTexture(Texture2D physical, SamplerState physical_sampler, uint texture, float2 uv, float2 screen_pos)
+{
+    uint info = VT_HEADER_SIZE + texture * VT_INFO_STRIDE;
+    uint2 size = uint2(VTPageTable[info], VTPageTable[info + 1]);
+    uint mip_count = VTPageTable[info + 2];
+    uint page_size = VTPageTable[VT_PAGE_SIZE];
+    float2 wrapped_uv = frac(uv);
+
+    //ミップはテクセルの画面上の大きさから選ぶ(ミップの間は補間しない)
+    float2 texel = uv * float2(size);
+    float2 dx = ddx(texel);
+    float2 dy = ddy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    uint mip = (uint) clamp(floor(lod), 0.0, float(mip_count - 1));
+
+    uint2 mip_size = max(size >> mip, uint2(1, 1));
+    uint2 pages = (mip_size + page_size - 1) / page_size;
+    uint2 page = min(uint2(wrapped_uv * float2(mip_size)) / page_size, pages - 1);
+
+    //縦横feedback_scaleピクセルに1つだけ、欲しいページを書く
+    uint feedback_scale = VTPageTable[VT_FEEDBACK_SCALE];
+    uint2 pixel = uint2(screen_pos);
+    if (all(pixel % feedback_scale == 0))
+    {
+        uint2 feedback_pos = pixel / feedback_scale;
+        VTFeedback[feedback_pos.y * VTPageTable[VT_FEEDBACK_WIDTH] + feedback_pos.x] = VTPackPage(texture, mip, page);
+    }
+
+    uint entry = VTPageTable[VTPageTable[info + 4 + mip] + page.y * pages.x + page.x];
+    if ((entry & VT_VALID_BIT) == 0)
+    {
+        return float4(0.5, 0.5, 0.5, 1.0);
+    }
+    //要素が指すページ(親の場合がある)の中での位置から、物理キャッシュの座標を求める
+    uint entry_mip = (entry >> 16) & 0xf;
+    uint2 slot = uint2(entry & 0xff, (entry >> 8) & 0xff);
+    uint2 entry_size = max(size >> entry_mip, uint2(1, 1));
+    float2 entry_texel = wrapped_uv * float2(entry_size);
+    float2 in_page = entry_texel - float2(floor(entry_texel / page_size) * page_size);
+    uint border = VTPageTable[VT_BORDER];
+    uint padded_page_size = page_size + border * 2;
+    float2 physical_size = float2(VTPageTable[VT_PHYSICAL_PAGES_X], VTPageTable[VT_PHYSICAL_PAGES_Y]) * padded_page_size;
+    float2 physical_uv = (float2(slot * padded_page_size + border) + in_page) / physical_size;
+    return physical.SampleLevel(physical_sampler, physical_uv, 0);
+}
+
+#endif
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <chrono>
+#include <cstdio>
+
+//-------------------------------------------------------------
+// @brief ベンチマークで使う時間計測
+// @details 結果の確認はテストと同じCHECK(TestCommon.h)で行い、mainの最後でTestResult()を返す。
+//			時間はOSの割り込みなどで遅れた回を除くため、何回か測って一番速い値を使う
+//-------------------------------------------------------------
+namespace BenchCommon {
+	using Clock = std::chrono::steady_clock;
+
+	// @brief 前回からの経過時間(ミリ秒)
+	inline double GetElapsedMilliseconds(Clock::time_point begin) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	}
+
+	// @brief funcをrepeat回実行し、一番速かった1回の時間(ミリ秒)を返す
+	template <class Func>
+	double MeasureBest(int repeat, Func&& func)
+	{
+		double best = 0.0;
+		for (int i = 0; i < repeat; i++) {
+			Clock::time_point begin = Clock::now();
+			func();
+			double elapsed = GetElapsedMilliseconds(begin);
+			if (i == 0 || elapsed < best)
+				best = elapsed;
+		}
+		return best;
+	}
+}
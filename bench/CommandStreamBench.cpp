@@ -0,0 +1,120 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamReplayer.h"
+#include "System/SystemUtils/DeviceContext/NullCommandList.h"
+#include "System/SystemUtils/DeviceContext/StateFilteredCommandList.h"
+
+using namespace System;
+using Op = CommandStream::Op;
+
+namespace {
+	constexpr UINT PIPELINE_COUNT = 8;
+
+	struct Scene {
+		ID3D12RootSignature root_signature;
+		ID3D12PipelineState pipeline_states[PIPELINE_COUNT];
+		ID3D12DescriptorHeap heap;
+		ID3D12Resource back_buffer;
+		D3D12_VERTEX_BUFFER_VIEW vertex_buffer = { 100, 1000, 32 };
+		D3D12_INDEX_BUFFER_VIEW index_buffer = { 200, 1000, DXGI_FORMAT_R16_UINT };
+		D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+		D3D12_RECT scissor = { 0, 0, 1280, 720 };
+		D3D12_CPU_DESCRIPTOR_HANDLE rtv = { 0x100 };
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv = { 0x200 };
+	};
+
+	//-------------------------------------------------------------
+	// アプリと同じ形の1フレーム。描画毎にステートを全て設定し直し、ステートを省くラッパーで減らす。
+	// ステート以外のコマンドはアプリと同じく、ラッパーの下のコマンドリストへ直接積む。
+	// PSOは描画順に並べ替えてある想定で、draw_count / PIPELINE_COUNT回毎に切り替わる
+	//-------------------------------------------------------------
+	template <class CommandList>
+	void RecordFrame(StateFilteredCommandList<CommandList>& filter, Scene& scene, UINT draw_count)
+	{
+		CommandList& command_list = *filter.Get();
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = &scene.back_buffer;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		command_list.ResourceBarrier(1, &barrier);
+		const FLOAT clear_color[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
+		command_list.ClearRenderTargetView(scene.rtv, clear_color, 0, nullptr);
+		command_list.ClearDepthStencilView(scene.dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+		ID3D12DescriptorHeap* heaps[] = { &scene.heap };
+		UINT draws_per_pipeline = std::max(1u, draw_count / PIPELINE_COUNT);
+		for (UINT draw = 0; draw < draw_count; draw++) {
+			filter.OMSetRenderTargets(1, &scene.rtv, FALSE, &scene.dsv);
+			filter.RSSetViewports(1, &scene.viewport);
+			filter.RSSetScissorRects(1, &scene.scissor);
+			filter.SetGraphicsRootSignature(&scene.root_signature);
+			filter.SetPipelineState(&scene.pipeline_states[std::min(draw / draws_per_pipeline, PIPELINE_COUNT - 1)]);
+			filter.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			filter.SetDescriptorHeaps(1, heaps);
+			filter.SetGraphicsRootDescriptorTable(1, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x1000 });
+			filter.IASetVertexBuffers(0, 1, &scene.vertex_buffer);
+			filter.IASetIndexBuffer(&scene.index_buffer);
+			filter.SetGraphicsRoot32BitConstant(0, draw, 0);
+			filter.SetGraphicsRoot32BitConstant(0, draw * 2, 1);
+			command_list.DrawIndexedInstanced(36, 1, 0, 0, draw);
+		}
+
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+		command_list.ResourceBarrier(1, &barrier);
+	}
+}
+
+int main()
+{
+	constexpr int REPEAT = 20;
+	Scene scene;
+	std::printf("%8s %10s %12s %12s %12s %12s %12s\n", "draws", "commands", "direct[ms]", "record[ms]", "capture[ms]", "replay[ms]", "replay[ns/c]");
+	for (UINT draw_count : { 1000u, 10000u, 100000u }) {
+		//記録用のラッパーを挟まない場合
+		NullCommandList direct_command_list;
+		StateFilteredCommandList<NullCommandList> direct_filter(&direct_command_list);
+		double direct = BenchCommon::MeasureBest(REPEAT, [&] {
+			direct_filter.Reset();
+			direct_command_list.Clear();
+			RecordFrame(direct_filter, scene, draw_count);
+		});
+
+		//アプリと同じく、ステートを省くラッパー → 記録用のラッパー → コマンドリストの順に重ねる
+		NullCommandList null_command_list;
+		CommandStreamRecorder<NullCommandList> recorder(&null_command_list);
+		StateFilteredCommandList<CommandStreamRecorder<NullCommandList>> filter(&recorder);
+		CommandStream stream;
+		double record = BenchCommon::MeasureBest(REPEAT, [&] {
+			filter.Reset();
+			RecordFrame(filter, scene, draw_count);
+		});
+		double capture = BenchCommon::MeasureBest(REPEAT, [&] {
+			filter.Reset();
+			recorder.BeginCapture(&stream);
+			RecordFrame(filter, scene, draw_count);
+			recorder.EndCapture();
+		});
+
+		//記録したフレームを、アプリもアセットも無しで積み直す
+		CommandStreamReplayer replayer;
+		NullCommandList replayed;
+		int replayed_count = 0;
+		double replay = BenchCommon::MeasureBest(REPEAT, [&] {
+			replayed.Clear();
+			replayed_count = replayer.Replay(stream, &replayed);
+		});
+		CHECK(replayed_count == static_cast<int>(stream.GetCommandCount()));
+		CHECK(replayed.GetCount(Op::DrawIndexedInstanced) == draw_count);
+		CHECK(replayed.GetCount(Op::SetPipelineState) == PIPELINE_COUNT);
+		CHECK(replayed.GetCount(Op::ResourceBarrier) == 2);
+		for (size_t op = 0; op < static_cast<size_t>(Op::Count); op++)
+			CHECK(replayed.GetCount(static_cast<Op>(op)) == direct_command_list.GetCount(static_cast<Op>(op)));
+
+		std::printf("%8u %10zu %12.3f %12.3f %12.3f %12.3f %12.2f\n", draw_count, stream.GetCommandCount(), direct, record, capture, replay, replay * 1e6 / stream.GetCommandCount());
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,53 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/Culling/Frustum/Frustum.h"
+#include "System/SystemUtils/Culling/InstanceCuller/InstanceCuller.h"
+
+#include <random>
+
+using namespace System;
+using namespace DirectX;
+
+namespace {
+	//-200~200の範囲にばら撒いた、回転と大きさの違うインスタンスのワールド行列を作る
+	std::vector<XMMATRIX> MakeInstances(size_t count)
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 2.0f * XM_PI);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::vector<XMMATRIX> world_matrices(count);
+		for (XMMATRIX& world : world_matrices) {
+			float s = scale(random);
+			world = XMMatrixScaling(s, s, s) * XMMatrixRotationY(angle(random)) * XMMatrixTranslation(position(random), position(random) * 0.1f, position(random));
+		}
+		return world_matrices;
+	}
+}
+
+int main()
+{
+	constexpr int REPEAT = 10;
+	//アプリと同じ画角で、原点から+z方向を見る
+	Frustum frustum(XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f));
+
+	std::printf("%10s %10s %12s %12s %12s %10s\n", "instances", "visible", "update[ms]", "simd[ms]", "scalar[ms]", "simd[ns/i]");
+	for (size_t count : { size_t(10000), size_t(100000), size_t(1000000) }) {
+		std::vector<XMMATRIX> world_matrices = MakeInstances(count);
+		InstanceCuller culler;
+		double update = BenchCommon::MeasureBest(REPEAT, [&] { culler.UpdateBounds(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), world_matrices.data(), count); });
+
+		std::vector<unsigned int> simd_visible;
+		std::vector<unsigned int> scalar_visible;
+		double simd = BenchCommon::MeasureBest(REPEAT, [&] { culler.Cull(frustum, simd_visible); });
+		double scalar = BenchCommon::MeasureBest(REPEAT, [&] { culler.CullScalar(frustum, scalar_visible); });
+		//SIMD版とスカラー版は同じインスタンスを残す
+		CHECK(simd_visible == scalar_visible);
+		CHECK(!simd_visible.empty() && simd_visible.size() < count);
+
+		std::printf("%10zu %10zu %12.3f %12.3f %12.3f %10.2f\n", count, simd_visible.size(), update, simd, scalar, simd * 1e6 / count);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,93 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/Mesh/MeshOptimizer/MeshOptimizer.h"
+
+#include <cmath>
+#include <random>
+
+using namespace System;
+
+namespace {
+	//u方向にsegments_u、v方向にsegments_vで分割したトーラスを、三角形の順番をばらばらにして作る(インポート直後の最悪の並びの想定)
+	MeshInfo MakeShuffledTorus(unsigned int segments_u, unsigned int segments_v)
+	{
+		constexpr float TWO_PI = 6.2831853f;
+		MeshInfo mesh;
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				float a = u * TWO_PI / segments_u;
+				float b = v * TWO_PI / segments_v;
+				float ring = 2.0f + 0.5f * std::cos(b);
+				float vertex[MeshInfo::SOURCE_STRIDE] = {
+					ring * std::cos(a), 0.5f * std::sin(b), ring * std::sin(a),
+					1.0f, 1.0f, 1.0f, 1.0f,
+					static_cast<float>(u) / segments_u, static_cast<float>(v) / segments_v,
+					std::cos(b) * std::cos(a), std::sin(b), std::cos(b) * std::sin(a),
+				};
+				mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MeshInfo::SOURCE_STRIDE);
+			}
+		}
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				unsigned int a = v * segments_u + u;
+				unsigned int b = v * segments_u + (u + 1) % segments_u;
+				unsigned int c = ((v + 1) % segments_v) * segments_u + u;
+				unsigned int d = ((v + 1) % segments_v) * segments_u + (u + 1) % segments_u;
+				unsigned int triangles[6] = { a, c, b, b, c, d };
+				mesh.indices.insert(mesh.indices.end(), triangles, triangles + 6);
+			}
+		}
+		std::mt19937 random(11);
+		for (size_t t = mesh.indices.size() / 3 - 1; t > 0; t--) {
+			size_t other = random() % (t + 1);
+			for (int k = 0; k < 3; k++)
+				std::swap(mesh.indices[t * 3 + k], mesh.indices[other * 3 + k]);
+		}
+		return mesh;
+	}
+}
+
+int main()
+{
+	constexpr int REPEAT = 5;
+	std::printf("%10s %12s %12s %12s %12s %10s %10s\n", "triangles", "cache[ms]", "overdraw[ms]", "fetch[ms]", "total[ms]", "acmr", "atvr");
+	for (unsigned int segments : { 32u, 100u, 316u, 1000u }) {
+		const MeshInfo source = MakeShuffledTorus(segments * 2, segments / 2);
+		size_t triangle_count = source.indices.size() / 3;
+
+		//段毎の時間。入力を毎回作り直すので、コピーの時間は測らない
+		MeshInfo mesh;
+		double cache = 0.0;
+		double overdraw = 0.0;
+		double fetch = 0.0;
+		double total = 0.0;
+		for (int i = 0; i < REPEAT; i++) {
+			mesh = source;
+			BenchCommon::Clock::time_point begin = BenchCommon::Clock::now();
+			MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.GetVertexCount());
+			double cache_time = BenchCommon::GetElapsedMilliseconds(begin);
+			begin = BenchCommon::Clock::now();
+			MeshOptimizer::OptimizeOverdraw(mesh);
+			double overdraw_time = BenchCommon::GetElapsedMilliseconds(begin);
+			begin = BenchCommon::Clock::now();
+			MeshOptimizer::OptimizeVertexFetch(mesh);
+			double fetch_time = BenchCommon::GetElapsedMilliseconds(begin);
+			if (i == 0 || cache_time + overdraw_time + fetch_time < total) {
+				cache = cache_time;
+				overdraw = overdraw_time;
+				fetch = fetch_time;
+				total = cache_time + overdraw_time + fetch_time;
+			}
+		}
+
+		MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(source.indices, source.GetVertexCount());
+		MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.GetVertexCount());
+		CHECK(mesh.indices.size() == source.indices.size());
+		CHECK(after.acmr <= before.acmr);
+		CHECK(after.atvr <= before.atvr);
+		std::printf("%10zu %12.3f %12.3f %12.3f %12.3f %4.2f->%4.2f %4.2f->%4.2f\n", triangle_count, cache, overdraw, fetch, total, before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,87 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+#include <thread>
+
+using namespace System;
+
+int main()
+{
+	constexpr int ZONE_COUNT = 1000000;
+	constexpr int REPEAT = 5;
+	constexpr double TARGET_NS = 50.0;	// 区間1つ(開始と終了)の目標
+	PROFILE_THREAD("Main");
+
+	//空の区間を積み続けた時の、区間1つ当たりの時間。バッファは一周して上書きされるが、積む側の処理は変わらない
+	double zone = BenchCommon::MeasureBest(REPEAT, [] {
+		for (int i = 0; i < ZONE_COUNT; i++) {
+			PROFILE_ZONE("Zone");
+		}
+	}) * 1e6 / ZONE_COUNT;
+	double nested = BenchCommon::MeasureBest(REPEAT, [] {
+		for (int i = 0; i < ZONE_COUNT / 2; i++) {
+			PROFILE_ZONE("Outer");
+			PROFILE_ZONE("Inner");
+		}
+	}) * 1e6 / ZONE_COUNT;
+	double counter = BenchCommon::MeasureBest(REPEAT, [] {
+		for (int i = 0; i < ZONE_COUNT; i++)
+			PROFILE_COUNTER("Counter", i);
+	}) * 1e6 / ZONE_COUNT;
+	uint64_t sum = 0;	// 読んだ値を使わないと、最適化で消えてしまう
+	double now = BenchCommon::MeasureBest(REPEAT, [&] {
+		for (int i = 0; i < ZONE_COUNT; i++)
+			sum += static_cast<uint64_t>(ProfileManager::Now());
+	}) * 1e6 / ZONE_COUNT;
+	CHECK(sum != 0);
+	ProfileManager::Instance()->EndFrame();
+
+	//4つのワーカーが1000区間ずつ積んだフレームを集計する時間
+	constexpr int WORKER_COUNT = 4;
+	constexpr int TILE_COUNT = 1000;
+	double end_frame = BenchCommon::MeasureBest(REPEAT * 4, [] {
+		ProfileManager::Instance()->EndFrame();
+	});
+	double end_frame_loaded = 0.0;
+	for (int frame = 0; frame < REPEAT * 4; frame++) {
+		{
+			PROFILE_ZONE("Update");
+			std::vector<std::thread> workers;
+			for (int w = 0; w < WORKER_COUNT; w++) {
+				workers.emplace_back([] {
+					PROFILE_THREAD("Worker");
+					for (int k = 0; k < TILE_COUNT; k++) {
+						PROFILE_ZONE("Tile");
+					}
+				});
+			}
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+		BenchCommon::Clock::time_point begin = BenchCommon::Clock::now();
+		ProfileManager::Instance()->EndFrame();
+		double elapsed = BenchCommon::GetElapsedMilliseconds(begin);
+		if (frame == 0 || elapsed < end_frame_loaded)
+			end_frame_loaded = elapsed;
+		//集計は全てのスレッドの区間を数える
+		for (const ProfileManager::ZoneStats& stats : ProfileManager::Instance()->GetLastFrameZones()) {
+			if (stats.name == "Tile")
+				CHECK(stats.call_count == WORKER_COUNT * TILE_COUNT);
+			if (stats.name == "Update")
+				CHECK(stats.call_count == 1);
+		}
+	}
+
+	std::printf("zone         %8.1f ns (target %.0f ns)\n", zone, TARGET_NS);
+	std::printf("nested zone  %8.1f ns\n", nested);
+	std::printf("counter      %8.1f ns\n", counter);
+	std::printf("Now()        %8.1f ns\n", now);
+	std::printf("EndFrame     %8.3f ms (empty) %8.3f ms (%d zones)\n", end_frame, end_frame_loaded, WORKER_COUNT * TILE_COUNT + 1);
+#if defined(NDEBUG)
+	//最適化したビルドでだけ目標を確かめる(デバッグやサニタイザーのビルドでは遅くて当然なので)
+	CHECK(zone < TARGET_NS);
+#endif
+
+	return TestResult();
+}
@@ -0,0 +1,55 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/RenderQueue/RadixSort/RadixSort.h"
+
+#include <numeric>
+#include <random>
+
+using namespace System;
+
+namespace {
+	//-------------------------------------------------------------
+	// RenderQueue::MakeKeyの不透明の並び(レイヤー4 | 半透明1 | PSO11 | マテリアル16 | 深度32)でキーを作る
+	// RenderQueueはIndirectCommandBuffer経由でD3D12に依存するので、ホストのビルドには入れていない
+	//-------------------------------------------------------------
+	std::vector<uint64_t> MakeDrawKeys(size_t count)
+	{
+		std::mt19937 random(7);
+		std::vector<uint64_t> keys(count);
+		for (uint64_t& key : keys) {
+			key = random() % 2;					// レイヤー
+			key = key << 1;						// 不透明
+			key = (key << 11) | (random() % 4);	// PSO
+			key = (key << 16) | (random() % 32);	// マテリアル
+			key = (key << 32) | random();		// 深度
+		}
+		return keys;
+	}
+}
+
+int main()
+{
+	constexpr int REPEAT = 20;
+	std::printf("%10s %12s %14s %8s\n", "draws", "radix[ms]", "stable[ms]", "ratio");
+	for (size_t count : { size_t(1000), size_t(10000), size_t(100000), size_t(1000000) }) {
+		std::vector<uint64_t> keys = MakeDrawKeys(count);
+		//作業用のバッファはRenderQueueと同じく使い回す
+		std::vector<unsigned int> order;
+		std::vector<uint64_t> scratch_keys;
+		std::vector<unsigned int> scratch_order;
+		double radix = BenchCommon::MeasureBest(REPEAT, [&] { RadixSort::Sort(keys, order, scratch_keys, scratch_order); });
+
+		std::vector<unsigned int> reference;
+		double stable = BenchCommon::MeasureBest(REPEAT, [&] {
+			reference.resize(count);
+			std::iota(reference.begin(), reference.end(), 0u);
+			std::stable_sort(reference.begin(), reference.end(), [&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+		});
+		//どちらも安定ソートなので、番号の並びは完全に一致する
+		CHECK(order == reference);
+
+		std::printf("%10zu %12.3f %14.3f %8.2f\n", count, radix, stable, stable / radix);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,61 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/TextureTools/SubresourceCopier/SubresourceCopier.h"
+
+#include <cstring>
+
+using namespace System;
+
+namespace {
+	constexpr size_t PITCH_ALIGNMENT = 256;	// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+
+	//-------------------------------------------------------------
+	// width x height のRGBA8のテクスチャ1枚を、詰めた配置からアップロードバッファの配置へコピーする速さを測る
+	// ホストのメモリはライトコンバインではないので、実機のアップロードバッファより差は小さく出る。
+	// キャッシュに収まる小さいテクスチャは、繰り返すとmemcpyの書き込み先がキャッシュに残るのでmemcpyの方が速く見える
+	//-------------------------------------------------------------
+	void MeasureTexture(size_t width, size_t height, int repeat)
+	{
+		size_t row_size = width * 4;
+		size_t dst_pitch = (row_size + PITCH_ALIGNMENT - 1) / PITCH_ALIGNMENT * PITCH_ALIGNMENT;
+		std::vector<uint8_t> src(row_size * height);
+		for (size_t i = 0; i < src.size(); i++)
+			src[i] = static_cast<uint8_t>(i * 7);
+		std::vector<uint8_t> dst(dst_pitch * height);
+
+		for (bool simd : { true, false }) {
+			double best = BenchCommon::MeasureBest(repeat, [&] {
+				SubresourceCopier::CopySubresource(dst.data(), dst_pitch, dst_pitch * height, src.data(), row_size, row_size * height, row_size, height, 1, simd);
+				SubresourceCopier::Finish();
+			});
+			CHECK(std::memcmp(dst.data() + dst_pitch * (height - 1), src.data() + row_size * (height - 1), row_size) == 0);
+			std::printf("%5zux%-5zu pitch %6zu %-7s %8.3f ms %7.2f GB/s\n", width, height, dst_pitch, simd ? "stream" : "memcpy", best, src.size() / best / 1e6);
+		}
+	}
+}
+
+int main()
+{
+	constexpr int REPEAT = 5;
+	//行のピッチがそのまま揃う幅と、揃わずに行毎に詰め直す幅
+	MeasureTexture(4096, 4096, REPEAT);
+	MeasureTexture(4095, 4096, REPEAT);
+	MeasureTexture(1000, 1000, REPEAT * 4);
+	MeasureTexture(407, 400, REPEAT * 20);
+
+	//連続した64MBを、書き込み先の境界をずらしてコピーする
+	constexpr size_t SIZE = 64 << 20;
+	std::vector<uint8_t> src(SIZE, 1);
+	std::vector<uint8_t> dst(SIZE + 16);
+	for (size_t offset : { size_t(0), size_t(3) }) {
+		double stream = BenchCommon::MeasureBest(REPEAT, [&] {
+			SubresourceCopier::CopyStreaming(dst.data() + offset, src.data(), SIZE);
+			SubresourceCopier::Finish();
+		});
+		double copy = BenchCommon::MeasureBest(REPEAT, [&] { std::memcpy(dst.data() + offset, src.data(), SIZE); });
+		CHECK(std::memcmp(dst.data() + offset, src.data(), SIZE) == 0);
+		std::printf("contiguous offset %zu: stream %7.2f GB/s, memcpy %7.2f GB/s\n", offset, SIZE / stream / 1e6, SIZE / copy / 1e6);
+	}
+
+	return TestResult();
+}
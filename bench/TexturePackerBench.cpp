@@ -0,0 +1,76 @@
+﻿#include "TestCommon.h"
+#include "BenchCommon.h"
+#include "System/SystemUtils/TextureTools/TexturePacker/TexturePacker.h"
+
+#include <random>
+
+using namespace System;
+
+namespace {
+	constexpr uint32_t FORMAT_RGBA8 = 28;	// DXGI_FORMAT_R8G8B8A8_UNORM
+	constexpr uint32_t ITEM_COUNT = 1000;
+
+	//16~256テクセルの大きさをばら撒く。pow2なら2の累乗だけにする
+	std::vector<TexturePacker::Item> MakeItems(bool pow2)
+	{
+		std::mt19937 random(42);
+		std::uniform_int_distribution<uint32_t> size(16, 256);
+		std::uniform_int_distribution<uint32_t> exponent(4, 8);
+		std::vector<TexturePacker::Item> items(ITEM_COUNT);
+		for (TexturePacker::Item& item : items) {
+			item.width = pow2 ? 1u << exponent(random) : size(random);
+			item.height = pow2 ? 1u << exponent(random) : size(random);
+			item.format = FORMAT_RGBA8;
+		}
+		return items;
+	}
+
+	// @brief 同じ要素に置いたテクスチャの領域(余白を含む)が重ならず、ビンからはみ出していないか
+	bool IsValidLayout(const TexturePacker& packer)
+	{
+		const std::vector<TexturePacker::Placement>& placements = packer.GetPlacements();
+		for (size_t i = 0; i < placements.size(); i++) {
+			const TexturePacker::Placement& a = placements[i];
+			if (a.bin == TexturePacker::INVALID_INDEX)
+				continue;
+			const TexturePacker::Bin& bin = packer.GetBins()[a.bin];
+			if (a.frame_x + a.frame_width > bin.width || a.frame_y + a.frame_height > bin.height)
+				return false;
+			for (size_t j = i + 1; j < placements.size(); j++) {
+				const TexturePacker::Placement& b = placements[j];
+				if (b.bin != a.bin || b.layer != a.layer)
+					continue;
+				if (a.frame_x < b.frame_x + b.frame_width && b.frame_x < a.frame_x + a.frame_width &&
+					a.frame_y < b.frame_y + b.frame_height && b.frame_y < a.frame_y + a.frame_height)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	//ミップの段数が増えるほどセルと余白が大きくなり、占有率が下がる
+	std::printf("%-7s %5s %7s %7s %11s %10s %10s\n", "sizes", "mips", "packed", "layers", "layer", "occupancy", "time[ms]");
+	for (bool pow2 : { false, true }) {
+		std::vector<TexturePacker::Item> items = MakeItems(pow2);
+		for (uint32_t mip_levels : { 1u, 3u, 4u, 5u }) {
+			TexturePacker::Settings settings;
+			settings.mip_levels = mip_levels;
+			settings.allow_arrays = false;	// 全てアトラスに詰めた時の占有率を見る
+			settings.max_layers = 256;
+			TexturePacker packer;
+			uint32_t packed = 0;
+			double time = BenchCommon::MeasureBest(3, [&] { packed = packer.Pack(items, settings); });
+			CHECK(packed == ITEM_COUNT);
+			CHECK(packer.GetBins().size() == 1);
+			CHECK(IsValidLayout(packer));
+			const TexturePacker::Bin& bin = packer.GetBins()[0];
+			std::printf("%-7s %5u %7u %7u %5ux%-5u %9.1f%% %10.2f\n", pow2 ? "pow2" : "random", mip_levels, packed, bin.layer_count, bin.width, bin.height,
+				packer.GetOccupancy(0) * 100.0, time);
+		}
+	}
+
+	return TestResult();
+}
@@ -3,6 +3,26 @@
 #include "System/Managers/DirectX12Manager/DirectX12Manager.h"
 #include "System/SystemUtils/DescriptorHeaps/DescriptorHeap/DescriptorHeap.h"
 #include "System/SystemUtils/D3DBuffer/D3DBufferInclude.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/Mesh/MeshOptimizer/MeshOptimizer.h"
+#include "System/SystemUtils/Mesh/MeshSimplifier/MeshSimplifier.h"
+#include "System/SystemUtils/Mesh/MeshletBuilder/MeshletBuilder.h"
+#include "System/SystemUtils/Culling/MeshletCuller/MeshletCuller.h"
+#include "System/SystemUtils/Culling/Frustum/Frustum.h"
+#include "System/SystemUtils/Culling/InstanceCuller/InstanceCuller.h"
+#include "System/SystemUtils/Culling/OcclusionCuller/OcclusionCuller.h"
+#include "System/SystemUtils/Culling/GpuInstanceCuller/GpuInstanceCuller.h"
+#include "System/SystemUtils/IndirectDraw/IndirectCommandBuffer/IndirectCommandBuffer.h"
+#include "System/SystemUtils/GeometryPool/GeometryPool/GeometryPool.h"
+#include "System/SystemUtils/RenderQueue/RenderQueue/RenderQueue.h"
+#include "System/SystemUtils/Mesh/VertexFormat/VertexFormat.h"
+#include "System/SystemUtils/DeviceContext/CommandStream.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/TextureTools/TextureCooker/TextureCooker.h"
+#include "System/Managers/ResourceManager/ResourceManager.h"
+#include "System/Managers/MaterialManager/MaterialManager.h"
+#include "System/SystemUtils/TextureTools/TextureReadback/TextureReadback.h"
+#include "System/SystemUtils/TextureTools/VirtualTexture/VirtualTexture.h"
 
 #include <d3dcompiler.h>
 #pragma comment(lib, "d3dcompiler.lib")
@@ -144,6 +164,8 @@ private:
 	static constexpr unsigned int GENERAL_SRV_COUNTS = 1; //Bindless Resourceに使うSRVの数
 	static constexpr unsigned int ROOT_CONSTANT_COUNTS = 4; //ルート定数の数
 	static constexpr unsigned int GENERAL_CBV_COUNTS = 16;
+	static constexpr unsigned int GENERAL_UAV_COUNTS = 1; //ピクセルシェーダーから書き込むバッファの数
+	static constexpr unsigned int ATLAS_PARAMETER_COUNTS = 2; //アトラスの参照の表と、Texture2DArrayとして見るBindless Resource
 
 public:
 	typedef enum RootParameterStartSlot {
@@ -151,7 +173,9 @@ public:
 		SRVSlot = StructuredBufferSlot + STRUCTURED_BUFFER_COUNTS,
 		RootConstantSlot = SRVSlot + GENERAL_SRV_COUNTS,
 		CBVSlot = RootConstantSlot + ROOT_CONSTANT_COUNTS,
-		RootParameterCount = CBVSlot + GENERAL_CBV_COUNTS
+		UAVSlot = CBVSlot + GENERAL_CBV_COUNTS,
+		AtlasSlot = UAVSlot + GENERAL_UAV_COUNTS,
+		RootParameterCount = AtlasSlot + ATLAS_PARAMETER_COUNTS
 	} RootParameterStartSlot;
 
 
@@ -182,6 +206,16 @@ public:
 	//|                                                |
 	//|                                                |
 	//+------------------------------------------------+
+	//| ルートパラメータ37: UAV(RWStructuredBuffer)       |
+	//| 仮想テクスチャのフィードバックなど、               |
+	//| ピクセルシェーダーから書き込むバッファ              |
+	//+------------------------------------------------+
+	//| ルートパラメータ38: SRV(StructuredBuffer, space1)  |
+	//| アトラスの参照の表(配列の要素とUVの変換)           |
+	//| ルートパラメータ39: SRV(Bindless Resource, space1) |
+	//| ルートパラメータ16と同じディスクリプタを、          |
+	//| Texture2DArrayとして読むための巨大配列              |
+	//+------------------------------------------------+
 	//| 静的サンプラー0:バイリニアフィルタリング、ラップ      |
 	//| 静的サンプラー1:バイリニアフィルタリング、クランプ    |
 	//| 静的サンプラー2:バイリニアフィルタリング、ミラー      |
@@ -208,9 +242,16 @@ public:
 		for (unsigned int i = 0; i < CBVSlot - RootConstantSlot; i++)
 			SetRootConstatntParameter(root_signature_desc, root_parameters, i);
 
-		for (unsigned int i = CBVSlot - RootConstantSlot; i < RootParameterCount - RootConstantSlot; i++)
+		for (unsigned int i = CBVSlot - RootConstantSlot; i < UAVSlot - RootConstantSlot; i++)
 			SetCBVParameter(root_signature_desc, root_parameters, i);
 
+		for (unsigned int i = 0; i < AtlasSlot - UAVSlot; i++)
+			SetUAVParameter(root_signature_desc, root_parameters, i);
+
+		//アトラスにまとめたテクスチャは、t5から始まる巨大配列と重ならないようにspace1に置く
+		SetStructuredBufferParameter(root_signature_desc, root_parameters, 0, 1);
+		SetSRVParameter(root_signature_desc, root_parameters, &srv_range2, 1, 1);
+
 		SetStaticSamplers(root_signature_desc, static_samplers);
 		SetParameters(root_signature_desc, root_parameters);
 
@@ -233,7 +274,7 @@ public:
 		return 0;
 	}
 	int SetSRVParameter(D3D12_ROOT_SIGNATURE_DESC& rs_desc, std::vector<D3D12_ROOT_PARAMETER>& root_parameters,
-		D3D12_DESCRIPTOR_RANGE* srv_range, unsigned int base_register) {
+		D3D12_DESCRIPTOR_RANGE* srv_range, unsigned int base_register, unsigned int register_space = 0) {
 
 		//SRVをルートパラメータに追加する
 		//ここではSRVを1つだけ追加しているが、
@@ -244,6 +285,7 @@ public:
 		srv_range->RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 		srv_range->BaseShaderRegister = base_register;
 		srv_range->NumDescriptors = 1;
+		srv_range->RegisterSpace = register_space;
 
 		srv_parameter.DescriptorTable.NumDescriptorRanges = 1;
 		srv_parameter.DescriptorTable.pDescriptorRanges = srv_range;
@@ -286,16 +328,27 @@ public:
 
 		return 0;
 	}
-	int SetStructuredBufferParameter(D3D12_ROOT_SIGNATURE_DESC& rs_desc, std::vector<D3D12_ROOT_PARAMETER>& root_parameters, unsigned int start_slot) {
+	int SetStructuredBufferParameter(D3D12_ROOT_SIGNATURE_DESC& rs_desc, std::vector<D3D12_ROOT_PARAMETER>& root_parameters, unsigned int start_slot, unsigned int register_space = 0) {
 		//StructuredBufferをルートパラメータに追加する
 		D3D12_ROOT_PARAMETER structured_buffer_parameter = {};
 		structured_buffer_parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
 		structured_buffer_parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 		structured_buffer_parameter.Descriptor.ShaderRegister = start_slot;
+		structured_buffer_parameter.Descriptor.RegisterSpace = register_space;
 		root_parameters.push_back(structured_buffer_parameter);
 		rs_desc.NumParameters++;
 		return 0;
 	}
+	int SetUAVParameter(D3D12_ROOT_SIGNATURE_DESC& rs_desc, std::vector<D3D12_ROOT_PARAMETER>& root_parameters, unsigned int start_slot) {
+		//RWStructuredBufferをルートパラメータに追加する(ルートディスクリプタなので、ディスクリプタは作らずにアドレスだけを渡す)
+		D3D12_ROOT_PARAMETER uav_parameter = {};
+		uav_parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		uav_parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		uav_parameter.Descriptor.ShaderRegister = start_slot;
+		root_parameters.push_back(uav_parameter);
+		rs_desc.NumParameters++;
+		return 0;
+	}
 	int SetStaticSamplers(D3D12_ROOT_SIGNATURE_DESC& rs_desc, std::vector< D3D12_STATIC_SAMPLER_DESC>& static_samplers) {
 		//静的サンプラーをルートシグネチャに追加する
 		//ここでは、1つのサンプラーを追加しているが、必要に応じて複数のサンプラーを追加することができる
@@ -383,15 +436,15 @@ public:
 	ID3D12PipelineState* GetPipelineState() const { return pipeline_state.Get(); }
 	bool IsValid() const { return pipeline_state != nullptr; }
 
-	PipelineState(RootSignature* root_sig, const std::wstring& vs, const std::string& vs_entry, const std::wstring& ps, const std::string& ps_entry, const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputs, unsigned int flags) {
+	PipelineState(RootSignature* root_sig, const std::wstring& vs, const std::string& vs_entry, const std::wstring& ps, const std::string& ps_entry, const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputs, unsigned int flags, const D3D_SHADER_MACRO* defines = nullptr) {
 		root_signature = root_sig;
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
 
 		pso_desc.pRootSignature = root_signature->GetRootSignature();
 
 
-		ShaderCompiler::CompileShader(vs, nullptr, vs_entry.c_str(), ShaderCompiler::TargetShader::VertexShader, vs_blob);
-		ShaderCompiler::CompileShader(ps, nullptr, ps_entry.c_str(), ShaderCompiler::TargetShader::PixelShader, ps_blob);
+		ShaderCompiler::CompileShader(vs, defines, vs_entry.c_str(), ShaderCompiler::TargetShader::VertexShader, vs_blob);
+		ShaderCompiler::CompileShader(ps, defines, ps_entry.c_str(), ShaderCompiler::TargetShader::PixelShader, ps_blob);
 		pso_desc.VS.pShaderBytecode = vs_blob->GetBufferPointer();
 		pso_desc.VS.BytecodeLength = vs_blob->GetBufferSize();
 		pso_desc.PS.pShaderBytecode = ps_blob->GetBufferPointer();
@@ -433,7 +486,7 @@ public:
 		}
 		{
 			pso_desc.DepthStencilState.DepthEnable = (flags & DepthTestEnable) ? TRUE : FALSE;
-			pso_desc.DepthStencilState.DepthWriteMask = (flags & (DepthWriteEnable | DepthTestEnable)) ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+			pso_desc.DepthStencilState.DepthWriteMask = (flags & DepthWriteEnable) ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
 			pso_desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 			pso_desc.DepthStencilState.StencilEnable = FALSE;
 		}
@@ -511,15 +564,6 @@ namespace System {
 		DirectX::XMFLOAT3 eye_position;
 		float system_time;
 	};
-	struct TextureIndices {
-		unsigned int slot[10];
-	};
-	struct MaterialData {
-		DirectX::XMFLOAT4 diffuse_color;
-		float metallic;
-		float roughness;
-		TextureIndices texture_indices;
-	};
 	struct ObjectCBuffer {
 		DirectX::XMMATRIX world_matrix;
 	};
@@ -530,30 +574,108 @@ namespace System {
 
 	std::unique_ptr<RootSignature> root_signature;
 	std::unique_ptr<PipelineState> pipeline_state;
+	//半透明用。深度テストはするが書き込まない(奥から順に描いた半透明同士が隠し合わないように)
+	std::unique_ptr<PipelineState> translucent_pipeline_state;
 
 
 	std::array<std::unique_ptr<ConstantBufferTyped<ConstantBufferData>>, DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT> frame_constant_buffers;
-	std::unique_ptr<StructuredBufferTyped<MaterialData>> material_buffer;
 	std::unique_ptr<StructuredBufferTyped<ObjectCBuffer>> objs_buffer;
 	std::unique_ptr<StructuredBufferTyped<CameraBuffer>> camera_buffer;
-	std::array<unsigned int, 4> tex_indices;
-
-	std::unique_ptr<Texture> diffuse_texture;
-	std::unique_ptr<Texture> normal_texture;
-	std::unique_ptr<Texture> roughness_texture;
-	std::unique_ptr<Texture> metallic_texture;
-	std::unique_ptr<Texture> emission_texture;
+	std::unique_ptr<StructuredBufferTyped<VertexDequant>> mesh_buffer;
+	//LOD毎にまとめたインスタンス番号。メッシュ毎にINSTANCE_COUNT個ずつ区切って使う
+	//毎フレームCPUから書き換えるので、GPUが読んでいる最中のフレームのものを上書きしないようにフレーム毎に持つ
+	std::array<std::unique_ptr<StructuredBufferTyped<unsigned int>>, DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT> frame_instance_lod_buffers;
+
+	//マテリアルにテクスチャが無い時の代わりのテクスチャ。実体はResourceManagerが持ち、同じパスは1つだけ読み込む
+	TextureHandle diffuse_texture;
+	TextureHandle normal_texture;
+	TextureHandle roughness_texture;
+	TextureHandle metallic_texture;
+	TextureHandle emission_texture;
 	std::unique_ptr<Texture> depth_texture;
 	std::unique_ptr<Texture> tex3d;
-	struct MeshInfo {
-		std::vector<float> vertices;
-		std::vector<unsigned int> indices;
-		unsigned int material_index;
-	};
+	//ストリーミングするテクスチャの、VRAMの予算
+	constexpr uint64_t TEXTURE_STREAMING_BUDGET = 16ull * 1024 * 1024;
+	//スクリーンショットや連番のキャプチャを、描画を止めずに読み戻して書き出す
+	std::unique_ptr<TextureReadback> texture_readback;
+	bool is_capturing_frames = false;	// trueの間、毎フレームのバックバッファを連番で書き出す
+	//trueなら、ディフューズを仮想テクスチャ(画面に必要なページだけをVRAMに置く)から読む
+	constexpr bool USE_VIRTUAL_TEXTURE = false;
+	std::unique_ptr<VirtualTexture> virtual_texture;
+	//trueなら、小さいテクスチャをTextureAtlasでTexture2DArrayにまとめ、全てのメッシュをそれを読むマテリアルで描く
+	constexpr bool USE_TEXTURE_ATLAS = false;
+	std::unique_ptr<TextureAtlas> texture_atlas;
 	std::vector<MeshInfo> meshes;
-
-	std::vector<std::unique_ptr<VertexBuffer>> vertex_buffers;
-	std::vector<std::unique_ptr<IndexBuffer>> index_buffers;
+	//GPUに送る頂点の形式。元データ(48バイト/頂点)を16バイト/頂点に圧縮する
+	VertexFormat vertex_format(VertexFormat::Compact);
+
+	//全メッシュの頂点とインデックスを1本ずつのバッファにまとめたもの
+	std::unique_ptr<GeometryPool> geometry_pool;
+	//メッシュ毎の、geometry_pool内の範囲
+	std::vector<GeometryAllocation> mesh_allocations;
+	//trueなら、LOD0で描くインスタンスをメッシュレット単位で視錐台カリング・背面カリングし、残った範囲だけを描く(CPUでカリングする時だけ)
+	constexpr bool USE_MESHLET_CULLING = false;
+	//メッシュレットのカリングで作るドローの上限。超えたら、残りのインスタンスはメッシュレットに分けずにまとめて描く
+	constexpr unsigned int MESHLET_MAX_DRAWS = 8192;
+	//メッシュ毎の、LOD0のインスタンスのうちメッシュレット単位で描いた数(インスタンス番号の表のLOD0の範囲の先頭から数える)
+	std::vector<unsigned int> meshlet_culled_counts;
+	//メッシュレットのカリングで残った範囲のドローと、ソートキーに使うインスタンスまでの距離(毎フレーム使い回す)
+	std::vector<std::pair<float, IndirectDrawCommand>> meshlet_commands;
+	std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> meshlet_arguments;
+
+	//描画するインスタンス数
+	constexpr unsigned int INSTANCE_COUNT = 5000;
+	//カメラ。ビュー・射影行列と、カリングやLOD選択で使う視点・画角は全てここから取る(ずれると見えている物を外してしまう)
+	constexpr DirectX::XMFLOAT3 CAMERA_EYE_POSITION(-5.0f, 5.0f, -5.0f);
+	constexpr DirectX::XMFLOAT3 CAMERA_FOCUS_POSITION(0.0f, 3.0f, 0.0f);
+	constexpr float CAMERA_FOV_Y = DirectX::XMConvertToRadians(60.0f);	// 縦の画角
+	constexpr float CAMERA_NEAR_Z = 0.1f;
+	constexpr float CAMERA_FAR_Z = 1000.0f;
+	//LODチェーンの設定。誤差はメッシュの大きさに対する比率
+	const std::vector<MeshSimplifier::LodSetting> lod_settings = {
+		{ 0.5f, 0.005f },
+		{ 0.25f, 0.01f },
+		{ 0.125f, 0.02f },
+		{ 0.0625f, 0.05f },
+	};
+	//LODの誤差が画面上でこのピクセル数を超えない範囲で、一番粗いLODを使う
+	constexpr float LOD_MAX_PIXEL_ERROR = 1.0f;
+	//メッシュ毎・LOD毎の、frame_instance_lod_buffers内の開始位置(末尾にインスタンス数の合計が入る)
+	std::vector<std::vector<unsigned int>> lod_instance_offsets;
+	//インスタンスの視錐台カリング。メッシュは全て同じインスタンスで描くので、全メッシュを囲むスフィアで1回だけ判定する
+	InstanceCuller instance_culler;
+	DirectX::XMFLOAT4 model_bounding_sphere = { 0.0f, 0.0f, 0.0f, 0.0f };
+	//インスタンス毎のワールド行列。カリングはこちらを読み、objs_buffer(書き込み結合のアップロードヒープ)へは毎フレーム1回コピーするだけにする
+	std::vector<DirectX::XMMATRIX> world_matrices;
+	//メッシュ毎の、カリングで残ったインスタンスの番号(毎フレーム使い回す)
+	std::vector<std::vector<unsigned int>> visible_instances;
+	//CPUの遮蔽カリング
+	std::unique_ptr<OcclusionCuller> occlusion_culler;
+	std::vector<OcclusionCuller::Occluder> occluders;
+	//カメラに近い順に、この数のインスタンスをオクルーダーとして描く
+	constexpr unsigned int OCCLUDER_COUNT = 64;
+	//オクルーダーに使うLODの誤差の上限。粗すぎるLODは元の形からはみ出して、見えている物まで隠してしまう
+	constexpr float OCCLUDER_MAX_LOD_ERROR = 0.005f;
+	//メッシュ×LOD毎のドローを、ExecuteIndirect1回にまとめて描画する
+	std::unique_ptr<IndirectCommandBuffer> indirect_command_buffer;
+	//trueなら、視錐台カリングとLOD選択をコンピュートシェーダーで行い、引数バッファもGPU上で組み立てる(遮蔽カリングは行わない)
+	//falseなら、CPUでカリングした結果から、CPUで引数バッファを組み立てる
+	constexpr bool USE_GPU_CULLING = false;
+	std::unique_ptr<GpuInstanceCuller> gpu_instance_culler;
+	//ドローをソートキーで並べ替えてから引数バッファに詰める
+	RenderQueue render_queue;
+	//ソートキーのPSO番号から引くPSO
+	std::vector<PipelineState*> pipeline_states;
+	constexpr unsigned int OPAQUE_PIPELINE_ID = 0;
+	constexpr unsigned int TRANSLUCENT_PIPELINE_ID = 1;
+	// @brief マテリアルを描くPSOの、ソートキーでの番号
+	unsigned int GetPipelineId(unsigned int material_index) {
+		return MaterialManager::Instance()->IsTranslucent(material_index) ? TRANSLUCENT_PIPELINE_ID : OPAQUE_PIPELINE_ID;
+	}
+	//メッシュ毎・LOD毎の、カメラに一番近いインスタンスと一番遠いインスタンスまでの距離(ソートキーの深度に使う)
+	std::vector<std::vector<DirectX::XMFLOAT2>> lod_depth_ranges;
+	//ソートキーの深度を量子化する時の最大距離(ファークリップに合わせる)
+	constexpr float SORT_MAX_DEPTH = CAMERA_FAR_Z;
 
 	//パイプライン周りの用語について
 	//そもそもパイプラインとは何か
@@ -623,10 +745,16 @@ namespace System {
 	}
 	int ApplicationManager::Initialize()
 	{
+		PROFILE_THREAD("Main");
+		PROFILE_FUNCTION();
 		//ウィンドウマネージャーの初期化
 		if (WindowManager::Instance()->Initialize() != 0) return -1;
 		if (DirectX12Manager::Instance()->Initialize() != 0) return -1;
 		if (WindowManager::Instance()->CreateSwapChain() != 0) return -1;
+		if (ResourceManager::Instance()->Initialize(TEXTURE_STREAMING_BUDGET) != 0) return -1;
+		if (MaterialManager::Instance()->Initialize() != 0) return -1;
+		texture_readback = std::make_unique<TextureReadback>();
+		if (!texture_readback->IsValid()) return -1;
 		//if (SystemGUI::InitImGui(WindowManager::Instance()->GetWindowHandle(), DirectX12Manager::Instance()->GetDevice(), DirectX12Manager::Instance()->GetDrawQueue()) != 0) return -1;
 
 
@@ -634,8 +762,57 @@ namespace System {
 		auto back_buffer = WindowManager::Instance()->GetCurrentBackBuffer();
 		////コマンドリスト(コンテキスト)は、初期化段階でCloseされているので、最初のフレームの描画を始める前にResetしておく必要がある
 		//if (DirectX12Manager::Instance()->GetDrawContext()->ResetCommandList() != 0) return -1;
-		DirectX::XMFLOAT4 mat_diffuse_color[10] = {};
 
+		{
+			//クック済み(ブロック圧縮・ミップ作成済み)のDDSがあれば、ストリーミングする。-cookを付けて起動すると、元の画像から作り直す
+			//クック済みのものが無ければ、元の画像を別スレッドで読み、メッシュの読み込みと重ねる
+			struct TextureSource {
+				const wchar_t* source_path;
+				const wchar_t* cooked_path;
+				TextureCooker::Usage usage;
+				TextureHandle* texture;
+			};
+			const TextureSource texture_sources[] = {
+				{ L"Assets/Textures/sample.png", L"Assets/Textures/Cooked/sample.dds", TextureCooker::Usage::Albedo, &diffuse_texture },
+				{ L"Assets/Textures/sample_normal.png", L"Assets/Textures/Cooked/sample_normal.dds", TextureCooker::Usage::Normal, &normal_texture },
+				{ L"Assets/Textures/sample_roughness.jpg", L"Assets/Textures/Cooked/sample_roughness.dds", TextureCooker::Usage::Mask, &roughness_texture },
+				{ L"Assets/Textures/sample_metallic.jpg", L"Assets/Textures/Cooked/sample_metallic.dds", TextureCooker::Usage::Mask, &metallic_texture },
+			};
+			std::unique_ptr<TextureCooker> cooker = cook_textures ? std::make_unique<TextureCooker>() : nullptr;
+			for (const TextureSource& source : texture_sources) {
+				if (source.texture->IsValid()) {
+					continue;
+				}
+				if (cooker) {
+					double psnr = 0.0;
+					if (SUCCEEDED(cooker->CookFile(source.source_path, source.cooked_path, source.usage, &psnr))) {
+						wchar_t message[256];
+						swprintf_s(message, L"%ls PSNR %.2f dB\n", source.cooked_path, psnr);
+						OutputDebugString(message);
+					}
+					else {
+						OutputDebugString(L"テクスチャのクックに失敗しました\n");
+					}
+				}
+				const wchar_t* path = std::filesystem::exists(source.cooked_path) ? source.cooked_path : source.source_path;
+				*source.texture = ResourceManager::Instance()->LoadTexture(path, ResourceManager::LoadMode::Streamed);
+			}
+			MaterialManager::Instance()->SetFallbackTextures({ diffuse_texture, normal_texture, roughness_texture, metallic_texture, TextureHandle() });
+		}
+		if (USE_VIRTUAL_TEXTURE && !virtual_texture) {
+			//ページ単位の形式に変換したものが無いか、-cookを付けて起動した時は、元の画像から作り直す
+			const wchar_t* source_path = L"Assets/Textures/sample.png";
+			const wchar_t* tiled_path = L"Assets/Textures/Cooked/sample.vtex";
+			if ((cook_textures || !std::filesystem::exists(tiled_path)) && FAILED(VirtualTexture::Cook(source_path, tiled_path))) {
+				return -1;
+			}
+			virtual_texture = std::make_unique<VirtualTexture>(VirtualTexture::Settings());
+			uint32_t virtual_texture_id = VirtualTexture::INVALID_ID;
+			//シェーダーは0番を読むので、最初に登録する
+			if (!virtual_texture->IsValid() || FAILED(virtual_texture->Register(tiled_path, virtual_texture_id)) || virtual_texture_id != 0) {
+				return -1;
+			}
+		}
 		//頂点バッファとインデックスバッファの作成(読み込みからバッファの作成、転送まで)
 		{
 			Assimp::Importer importer;
@@ -646,16 +823,36 @@ namespace System {
 			if (!scene || !scene->HasMeshes()) {
 				return -1;
 			}
+			//シーンのマテリアル番号を、マテリアルテーブルの番号に直す(同じ内容のものは同じ番号になる)
+			std::vector<uint32_t> material_ids(scene->mNumMaterials, 0);
 			for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
-				const aiMaterial* material = scene->mMaterials[i];
-				aiColor4D diffuse_color;
-				material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse_color);
-				mat_diffuse_color[i] = DirectX::XMFLOAT4(diffuse_color.r, diffuse_color.g, diffuse_color.b, diffuse_color.a);
+				material_ids[i] = MaterialManager::Instance()->CreateFromAiMaterial(scene->mMaterials[i], "Assets");
+				if (material_ids[i] == MaterialManager::INVALID_ID) {
+					return -1;
+				}
+			}
+			if constexpr (USE_TEXTURE_ATLAS) {
+				//同じ大きさの2枚を1つの配列にまとめ、1枚目をディフューズに使う
+				texture_atlas = std::make_unique<TextureAtlas>();
+				if (FAILED(texture_atlas->Build({ L"Assets/Textures/sample.png", L"Assets/Textures/sample_alpha.png" }))) {
+					return -1;
+				}
+				MaterialManager::AtlasEntrySet atlas_entries;
+				atlas_entries.fill(MaterialManager::INVALID_ID);
+				atlas_entries[MaterialTable::Diffuse] = MaterialManager::Instance()->AddAtlasEntry(texture_atlas->GetEntry(0));
+				if (atlas_entries[MaterialTable::Diffuse] == MaterialManager::INVALID_ID) {
+					return -1;
+				}
+				uint32_t atlas_material = MaterialManager::Instance()->CreateMaterial(MaterialTable::Desc(), atlas_entries);
+				if (atlas_material == MaterialManager::INVALID_ID) {
+					return -1;
+				}
+				std::fill(material_ids.begin(), material_ids.end(), atlas_material);
 			}
 			for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
 				const aiMesh* mesh = scene->mMeshes[i];
 				MeshInfo info;
-				info.vertices.reserve(mesh->mNumVertices * 12);
+				info.vertices.reserve(mesh->mNumVertices * MeshInfo::SOURCE_STRIDE);
 				for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
 					//頂点位置
 					info.vertices.push_back(mesh->mVertices[j].x);
@@ -702,18 +899,64 @@ namespace System {
 						info.indices.push_back(face.mIndices[j]);
 					}
 				}
-				info.material_index = mesh->mMaterialIndex;
+				info.material_index = mesh->mMaterialIndex < material_ids.size() ? material_ids[mesh->mMaterialIndex] : 0;
+				//インスタンス描画で同じ並びが5000回再生されるので、インポート時に頂点キャッシュ向けに並べ替えておく
+				MeshOptimizer::VertexCacheStats stats_before;
+				MeshOptimizer::VertexCacheStats stats_after;
+				if (MeshOptimizer::Optimize(info, &stats_before, &stats_after) == 0) {
+					char message[256];
+					snprintf(message, sizeof(message), "mesh[%u] ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", i, stats_before.acmr, stats_after.acmr, stats_before.atvr, stats_after.atvr);
+					OutputDebugStringA(message);
+				}
+				//LODチェーンを作る。全LODで頂点を共有するので、インデックスの形式は頂点数だけで決まる
+				if (MeshSimplifier::BuildLodChain(info, lod_settings) != 0) {
+					return -1;
+				}
+				info.ComputeBounds();
+				//カリング用にLOD0をメッシュレットに分割しておく
+				if (MeshletBuilder::Build(info) != 0) {
+					return -1;
+				}
+				info.index_format = IndexBuffer::SelectFormat(info.GetVertexCount());
 				meshes.push_back(std::move(info));
 			}
-			if (vertex_buffers.empty()) {
-				vertex_buffers.reserve(meshes.size());
-				for (auto& mesh_info : meshes)
-					vertex_buffers.push_back(std::make_unique<VertexBuffer>(mesh_info.vertices, 12, D3D12_HEAP_TYPE_DEFAULT));
+			if (!geometry_pool) {
+				//インデックスはメッシュ内のローカルな番号のまま入れるので、全メッシュが16bitに収まるならプールも16bitにする
+				size_t total_vertex_count = 0;
+				size_t total_index_count = 0;
+				DXGI_FORMAT pool_index_format = DXGI_FORMAT_R16_UINT;
+				for (auto& mesh_info : meshes) {
+					total_vertex_count += mesh_info.GetVertexCount();
+					total_index_count += mesh_info.indices.size();
+					if (mesh_info.index_format == DXGI_FORMAT_R32_UINT)
+						pool_index_format = DXGI_FORMAT_R32_UINT;
+				}
+				//16bitの場合は範囲の開始位置を偶数に揃えるので、その分だけ余裕を持たせておく
+				geometry_pool = std::make_unique<GeometryPool>(vertex_format.GetStride(), total_vertex_count, pool_index_format, total_index_count + meshes.size());
+				if (!geometry_pool->IsValid()) {
+					return -1;
+				}
+				mesh_allocations.resize(meshes.size());
+				std::vector<unsigned char> encoded_vertices;
+				for (size_t i = 0; i < meshes.size(); i++) {
+					MeshInfo& mesh_info = meshes[i];
+					//元データを圧縮フォーマットに変換してから転送する
+					if (vertex_format.Encode(mesh_info, encoded_vertices, mesh_info.dequant) != 0) {
+						return -1;
+					}
+					if (geometry_pool->Allocate(mesh_info.GetVertexCount(), mesh_info.indices.size(), mesh_allocations[i]) != 0) {
+						return -1;
+					}
+					if (geometry_pool->Upload(mesh_allocations[i], encoded_vertices.data(), mesh_info.indices) != 0) {
+						return -1;
+					}
+				}
 			}
-			if (index_buffers.empty()) {
-				index_buffers.reserve(meshes.size());
-				for (auto& mesh_info : meshes)
-					index_buffers.push_back(std::make_unique<IndexBuffer>(mesh_info.indices, D3D12_HEAP_TYPE_DEFAULT));
+			if (!mesh_buffer) {
+				//メッシュ毎の逆量子化パラメータ。頂点シェーダーでメッシュ番号を使って引く
+				mesh_buffer = std::make_unique<StructuredBufferTyped<VertexDequant>>(meshes.size());
+				for (size_t i = 0; i < meshes.size(); i++)
+					*mesh_buffer->At(i) = meshes[i].dequant;
 			}
 		}
 
@@ -736,52 +979,64 @@ namespace System {
 
 		if (!pipeline_state) {
 
-			static constexpr unsigned int INPUT_ELEMENT_COUNT = 4;
-			static D3D12_INPUT_LAYOUT_DESC input_layout_desc = {};
-			input_layout_desc.NumElements = INPUT_ELEMENT_COUNT;
-			std::vector<D3D12_INPUT_ELEMENT_DESC> input_elements(INPUT_ELEMENT_COUNT);
-			input_elements[0] = { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
-			input_elements[1] = { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
-			input_elements[2] = { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
-			input_elements[3] = { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
-			pipeline_state = std::make_unique<PipelineState>(root_signature.get(), L"Assets/Shaders/simple_vs.fx", "main", L"Assets/Shaders/simple_ps.fx", "main", input_elements, PipelineState::DepthTestEnable | PipelineState::DepthWriteEnable | PipelineState::CullBack | PipelineState::AlphaBlendEnable);
+			//インプットレイアウトとシェーダーのデコード用マクロは、頂点フォーマットから生成する
+			std::vector<D3D_SHADER_MACRO> shader_defines;
+			for (const D3D_SHADER_MACRO* define = vertex_format.GetShaderDefines(); define && define->Name; define++)
+				shader_defines.push_back(*define);
+			if constexpr (USE_VIRTUAL_TEXTURE)
+				shader_defines.push_back({ "VIRTUAL_TEXTURE", "1" });
+			shader_defines.push_back({ nullptr, nullptr });
+			pipeline_state = std::make_unique<PipelineState>(root_signature.get(), L"Assets/Shaders/simple_vs.fx", "main", L"Assets/Shaders/simple_ps.fx", "main", vertex_format.GetInputElementDescs(), PipelineState::DepthTestEnable | PipelineState::DepthWriteEnable | PipelineState::CullBack | PipelineState::AlphaBlendEnable, shader_defines.data());
 			if (!pipeline_state->IsValid()) {
 				return -1;
 			}
+			translucent_pipeline_state = std::make_unique<PipelineState>(root_signature.get(), L"Assets/Shaders/simple_vs.fx", "main", L"Assets/Shaders/simple_ps.fx", "main", vertex_format.GetInputElementDescs(), PipelineState::DepthTestEnable | PipelineState::CullBack | PipelineState::AlphaBlendEnable, shader_defines.data());
+			if (!translucent_pipeline_state->IsValid()) {
+				return -1;
+			}
+			//番号はOPAQUE_PIPELINE_ID、TRANSLUCENT_PIPELINE_IDの順
+			pipeline_states = { pipeline_state.get(), translucent_pipeline_state.get() };
 
 
 		}
-		if (!diffuse_texture) {
-			diffuse_texture = Texture::Loader::LoadFromFile(L"Assets/Textures/sample.png");
-			if (!diffuse_texture->IsValid()) {
+		if (!indirect_command_buffer) {
+			//ドローは最大でメッシュ×LODの数だけ
+			size_t max_command_count = 0;
+			for (auto& mesh_info : meshes)
+				max_command_count += mesh_info.GetLodCount();
+			if constexpr (USE_MESHLET_CULLING)
+				max_command_count += MESHLET_MAX_DRAWS;
+			indirect_command_buffer = std::make_unique<IndirectCommandBuffer>(root_signature->GetRootSignature(), RootSignature::RootConstantSlot, std::max<size_t>(max_command_count, 1));
+			if (!indirect_command_buffer->IsValid()) {
 				return -1;
 			}
 		}
-
-		if (!normal_texture) {
-			normal_texture = Texture::Loader::LoadFromFile(L"Assets/Textures/sample_normal.png");
-			if (!normal_texture->IsValid()) {
+		if (USE_GPU_CULLING && !gpu_instance_culler) {
+			gpu_instance_culler = std::make_unique<GpuInstanceCuller>(L"Assets/Shaders/instance_cull_cs.fx", INSTANCE_COUNT);
+			if (!gpu_instance_culler->IsValid()) {
 				return -1;
 			}
-		}
-		if (!roughness_texture) {
-			roughness_texture = Texture::Loader::LoadFromFile(L"Assets/Textures/sample_roughness.jpg");
-			if (!roughness_texture->IsValid()) {
+			for (size_t i = 0; i < meshes.size(); i++) {
+				if (gpu_instance_culler->AddMesh(meshes[i], mesh_allocations[i]) != 0) {
+					return -1;
+				}
+			}
+			if (gpu_instance_culler->Build() != 0) {
 				return -1;
 			}
 		}
-		if (!metallic_texture) {
-			metallic_texture = Texture::Loader::LoadFromFile(L"Assets/Textures/sample_metallic.jpg");
-			if (!metallic_texture->IsValid()) {
+		//if (!emission_texture.IsValid()) {
+		//	emission_texture = ResourceManager::Instance()->LoadTexture(L"Assets/Textures/sample_emission.jpg", ResourceManager::LoadMode::Async);
+		//}
+		//別スレッドで読んでいるテクスチャを待っておく(マテリアルのディスクリプタの番号は、MaterialManager::Updateで書き込む)
+		if (ResourceManager::Instance()->WaitForTextures() != 0) {
+			return -1;
+		}
+		for (TextureHandle handle : { diffuse_texture, normal_texture, roughness_texture, metallic_texture }) {
+			if (ResourceManager::Instance()->GetTextureState(handle) != AssetState::Ready) {
 				return -1;
 			}
 		}
-		//if (!emission_texture) {
-		//	emission_texture = Texture::Loader::LoadFromFile(L"Assets/Textures/sample_emission.jpg");
-		//	if (!emission_texture->IsValid()) {
-		//		return -1;
-		//	}
-		//}
 
 		if (!frame_constant_buffers[0]) {
 			for (size_t i = 0; i < DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT; i++)
@@ -793,27 +1048,39 @@ namespace System {
 			//CreateConstantBufer();
 
 		}
-		if (!material_buffer) {
-			material_buffer = std::make_unique<StructuredBufferTyped<MaterialData>>(10);
-			tex_indices = {
-				diffuse_texture->Srv()->GetIndex(),
-				normal_texture->Srv()->GetIndex(),
-				roughness_texture->Srv()->GetIndex(),
-				metallic_texture->Srv()->GetIndex(),
-				//emission_texture->Srv()->GetIndex()
-			};
-			for (size_t i = 0; i < 10; i++) {
-				material_buffer->At(i)->diffuse_color = mat_diffuse_color[i];
-				material_buffer->At(i)->texture_indices.slot[0] = tex_indices[0];
-				material_buffer->At(i)->texture_indices.slot[1] = tex_indices[1];
-				material_buffer->At(i)->texture_indices.slot[2] = tex_indices[2];
-				material_buffer->At(i)->texture_indices.slot[3] = tex_indices[3];
-			}
-		}
 		if (!objs_buffer) {
 			objs_buffer = std::make_unique<StructuredBufferTyped<ObjectCBuffer>>(10000);
 
 		}
+		if (!frame_instance_lod_buffers[0]) {
+			for (auto& buffer : frame_instance_lod_buffers)
+				buffer = std::make_unique<StructuredBufferTyped<unsigned int>>(meshes.size() * INSTANCE_COUNT);
+			lod_instance_offsets.resize(meshes.size());
+			lod_depth_ranges.resize(meshes.size());
+			meshlet_culled_counts.resize(meshes.size());
+			visible_instances.resize(meshes.size());
+			//全メッシュのスフィアを囲むスフィア(中心は各スフィアを囲むAABBの中心)
+			if (!meshes.empty()) {
+				DirectX::XMFLOAT3 box_min(FLT_MAX, FLT_MAX, FLT_MAX);
+				DirectX::XMFLOAT3 box_max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				for (const MeshInfo& mesh_info : meshes) {
+					const DirectX::XMFLOAT4& sphere = mesh_info.bounding_sphere;
+					box_min = DirectX::XMFLOAT3(std::min(box_min.x, sphere.x - sphere.w), std::min(box_min.y, sphere.y - sphere.w), std::min(box_min.z, sphere.z - sphere.w));
+					box_max = DirectX::XMFLOAT3(std::max(box_max.x, sphere.x + sphere.w), std::max(box_max.y, sphere.y + sphere.w), std::max(box_max.z, sphere.z + sphere.w));
+				}
+				DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&box_min), DirectX::XMLoadFloat3(&box_max)), 0.5f);
+				float radius = 0.0f;
+				for (const MeshInfo& mesh_info : meshes) {
+					float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(&mesh_info.bounding_sphere), center)));
+					radius = std::max(radius, distance + mesh_info.bounding_sphere.w);
+				}
+				DirectX::XMStoreFloat4(&model_bounding_sphere, center);
+				model_bounding_sphere.w = radius;
+			}
+		}
+		if (!occlusion_culler) {
+			occlusion_culler = std::make_unique<OcclusionCuller>();
+		}
 		D3D12_CLEAR_VALUE clear_value = {};
 		clear_value.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		clear_value.Color[0] = 1.0f;
@@ -832,7 +1099,9 @@ namespace System {
 	}
 	int ApplicationManager::MainLoop()
 	{
-		MSG msg;		// Windowsのメッセージを格納する構造体
+		MSG msg = {};		// Windowsのメッセージを格納する構造体
+		unsigned int frame_count = 0;	// 描画したフレーム数
+		CommandStream capture_stream;	// SetCaptureFrameで指定したフレームのコマンドを記録する先
 
 
 
@@ -876,10 +1145,39 @@ namespace System {
 				auto dsv_handle = depth_texture->Dsv()->GetCPUHandle();
 				auto cmd_list = DirectX12Manager::Instance()->GetDrawContext()->GetCommandList();
 				auto cmd_allocator = DirectX12Manager::Instance()->GetDrawContext()->GetCommandAllocator();
-
+				//ステートの設定は、同じ値の再設定を省くラッパー経由で積む
+				auto state = DirectX12Manager::Instance()->GetDrawContext()->GetStateFilter();
+				//ステート以外のコマンドは、記録用のラッパー経由で積む(記録していない間はそのまま転送される)
+				auto recorder = DirectX12Manager::Instance()->GetDrawContext()->GetRecorder();
+				auto draw_context = DirectX12Manager::Instance()->GetDrawContext();
+
+				//読み込み終わったテクスチャやミップを差し替えてから、このフレームのコマンドを積む(ディスクリプタは積んだ後に書き換えられない)
+				if (ResourceManager::Instance()->Update() != 0) {
+					return -1;
+				}
+				//前のフレームまでに積んだ読み戻しのうち、GPUが終わったものを書き出しに回す
+				texture_readback->Update();
+				//前のフレームまでのフィードバックから読むページを決め、読み終わったページをコピーキューで転送する
+				if (virtual_texture && virtual_texture->Update() != 0) {
+					return -1;
+				}
 				if (DirectX12Manager::Instance()->DrawBegin() < 0) {
 					return -1;
 				}
+				//指定されたフレームだけ、積んだコマンドを記録する(マテリアルテーブルの更新から、読み戻しのコピーまで)
+				bool capture_this_frame = !capture_path.empty() && frame_count == capture_frame;
+				if (capture_this_frame)
+					recorder->BeginCapture(&capture_stream);
+				//書き換えたマテリアルだけを、描画より前にテーブルへコピーする
+				if (MaterialManager::Instance()->Update(recorder) != 0) {
+					return -1;
+				}
+				//ページテーブルの更新とフィードバックのクリアも、描画より前に積む
+				if (virtual_texture && virtual_texture->BeginFrame(recorder, static_cast<uint32_t>(back_buffer->Width()), static_cast<uint32_t>(back_buffer->Height())) != 0) {
+					return -1;
+				}
+				//フレーム全体のGPU側の時間。結果は、このコンテキストの実行が完了した後(数フレーム後)にプロファイルに積まれる
+				int gpu_frame_zone = draw_context->BeginGpuZone("GPU Frame");
 				float clear_color[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
 
 				D3D12_RESOURCE_BARRIER begin_barrier = {};
@@ -888,14 +1186,17 @@ namespace System {
 				begin_barrier.Transition.Subresource = 0;
 				begin_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
 				begin_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-				cmd_list->ResourceBarrier(1, &begin_barrier);
+				recorder->ResourceBarrier(1, &begin_barrier);
 
-				cmd_list->OMSetRenderTargets(1, &handle, FALSE, &dsv_handle);
-				cmd_list->ClearRenderTargetView(handle, clear_color, 0, nullptr);
-				cmd_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+				state->OMSetRenderTargets(1, &handle, FALSE, &dsv_handle);
+				recorder->ClearRenderTargetView(handle, clear_color, 0, nullptr);
+				recorder->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 				//試験的に虹色トライアングルの描画コマンドを入れてみる
 				if constexpr (true) {
+					PROFILE_GPU_ZONE(draw_context, "GPU Scene");
 
+					//カリングに使うビュー射影行列
+					DirectX::XMMATRIX view_projection = DirectX::XMMatrixIdentity();
 					//定数バッファにデータを転送する
 					{
 						ConstantBufferData* mapped_data = nullptr;
@@ -916,31 +1217,165 @@ namespace System {
 								DirectX::XMMatrixScaling(0.01f, 0.01f, 0.01f) *
 								DirectX::XMMatrixTransformation(DirectX::XMVectorZero(), DirectX::XMQuaternionIdentity(), DirectX::XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f), DirectX::XMVectorZero(), DirectX::XMQuaternionIdentity(), DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f));
 							mapped_data->world_matrix = w_m;
-							DirectX::XMMATRIX v_m = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(-5.0f, 5.0f, -5.0f, 1.0f), DirectX::XMVectorSet(0.0f, 3.0f, 0.0f, 0.0f), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+							DirectX::XMMATRIX v_m = DirectX::XMMatrixLookAtLH(DirectX::XMLoadFloat3(&CAMERA_EYE_POSITION), DirectX::XMLoadFloat3(&CAMERA_FOCUS_POSITION), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
 							mapped_data->view_matrix = v_m;
 
 
 							//ウィンドウ拡縮に合わせる場合
-							DirectX::XMMATRIX p_m = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.0f), static_cast<float>(WindowManager::Instance()->GetWindowWidth()) / WindowManager::Instance()->GetWindowHeight(), 0.1f, 1000.0f);
+							DirectX::XMMATRIX p_m = DirectX::XMMatrixPerspectiveFovLH(CAMERA_FOV_Y, static_cast<float>(WindowManager::Instance()->GetWindowWidth()) / WindowManager::Instance()->GetWindowHeight(), CAMERA_NEAR_Z, CAMERA_FAR_Z);
 							//バックバッファのサイズに合わせる場合
-							//DirectX::XMMATRIX p_m = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.0f), static_cast<float>(back_buffer->GetResource()->GetDesc().Width / back_buffer->GetResource()->GetDesc().Height), 0.1f, 1000.0f);
+							//DirectX::XMMATRIX p_m = DirectX::XMMatrixPerspectiveFovLH(CAMERA_FOV_Y, static_cast<float>(back_buffer->GetResource()->GetDesc().Width / back_buffer->GetResource()->GetDesc().Height), CAMERA_NEAR_Z, CAMERA_FAR_Z);
 							mapped_data->projection_matrix = p_m;
-							mapped_data->eye_position = DirectX::XMFLOAT3(-5.0f, 5.0f, -5.0f);
+							mapped_data->eye_position = CAMERA_EYE_POSITION;
+							view_projection = v_m * p_m;
 						}
 						int elem_count = objs_buffer->GetElementCount();
 						int x_count = 40;
 						int z_count = 40;
+						world_matrices.resize(elem_count);
 						for (int i = 0; i < elem_count; i++) {
-							objs_buffer->At(i)->world_matrix =
+							world_matrices[i] =
 								DirectX::XMMatrixScaling(0.01f, 0.01f, 0.01f) *
 								DirectX::XMMatrixRotationY(system_time + 0.04f * i) *
 								//DirectX::XMMatrixRotationZ(DirectX::XMConvertToRadians(90.0f)) *
 								//DirectX::XMMatrixRotationX(DirectX::XMConvertToRadians(90.0f)) *
 								DirectX::XMMatrixTranslation((i % x_count) * 0.5f, i / (x_count * z_count), (i / x_count - i / (x_count * z_count) * x_count) * 0.5f);
 						}
+						//アップロードヒープは書き込み結合なので、読み戻さずに先頭から順に1回で書き込む
+						static_assert(sizeof(ObjectCBuffer) == sizeof(DirectX::XMMATRIX));
+						ObjectCBuffer* objects = objs_buffer->Map();
+						if (!objects) {
+							return -1;
+						}
+						std::memcpy(objects, world_matrices.data(), sizeof(DirectX::XMMATRIX) * world_matrices.size());
 						//constant_buffer->Unmap();
 
 					}
+					//視錐台カリングと遮蔽カリングで残ったインスタンスについて、画面上の大きさからLODを選び、LOD毎にインスタンス番号をまとめる
+					//頂点シェーダーは、ルート定数で渡した開始位置+SV_InstanceIDでこの表を引いて、オブジェクトの番号を得る
+					{
+						PROFILE_ZONE("Culling");
+						Frustum frustum(view_projection);
+						DirectX::XMVECTOR eye = DirectX::XMLoadFloat3(&CAMERA_EYE_POSITION);
+						//射影後の大きさ = 直径 / (距離 * tan(fov/2)) * 画面の高さ / 2
+						float projection_scale = 1.0f / std::tan(CAMERA_FOV_Y * 0.5f);
+						float half_height = static_cast<float>(back_buffer->GetResourceDesc().Height) * 0.5f;
+						//テクスチャは全てのメッシュで共通なので、一番大きく描かれるインスタンスの大きさでミップを要求する
+						float max_screen_size = 0.0f;
+						if constexpr (USE_GPU_CULLING) {
+							//カリングとLOD選択はコンピュートシェーダーで行う。引数バッファとインスタンス番号の表はGPU上で完結する
+							PROFILE_GPU_ZONE(draw_context, "GPU Culling");
+							if (gpu_instance_culler->Dispatch(recorder, frustum, CAMERA_EYE_POSITION, projection_scale * half_height, LOD_MAX_PIXEL_ERROR, objs_buffer->GetResource()->GetGPUVirtualAddress()) != 0) {
+								return -1;
+							}
+							//カリングはステートを省くラッパーを通さずにPSOやルートシグネチャを変えるので、ラッパーが覚えている値を捨てる
+							//(記録用のラッパーには積んでいるので、コマンドストリームには記録される)
+							state->Invalidate();
+							//インスタンス毎の大きさはGPUにしか無いので、画面いっぱいに描かれるものとして要求する
+							max_screen_size = half_height * 2.0f;
+						}
+						else {
+							unsigned int* instance_ids = frame_instance_lod_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->Map();
+							std::vector<unsigned int> instance_lods(INSTANCE_COUNT);
+							MeshletCuller::CullStats meshlet_stats;
+							meshlet_commands.clear();
+							//視錐台カリング。インスタンス毎のスフィアはフレーム毎に1回だけ求め、残ったインスタンスを全メッシュの候補にする
+							instance_culler.UpdateBounds(model_bounding_sphere, world_matrices.data(), INSTANCE_COUNT);
+							if (!meshes.empty()) {
+								instance_culler.Cull(frustum, visible_instances[0]);
+								for (size_t m = 1; m < meshes.size(); m++)
+									visible_instances[m] = visible_instances[0];
+							}
+							//遮蔽カリング
+							//カメラに近いインスタンスをオクルーダーとして低解像度の深度バッファに描き、AABBが完全に隠れたインスタンスを外す
+							if (!meshes.empty()) {
+								std::vector<std::pair<float, unsigned int>> nearest;
+								nearest.reserve(visible_instances[0].size());
+								for (unsigned int i : visible_instances[0]) {
+									DirectX::XMFLOAT4 sphere = instance_culler.GetWorldSphere(i);
+									float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(&sphere), eye)));
+									nearest.push_back({ distance, i });
+								}
+								size_t occluder_instances = std::min<size_t>(OCCLUDER_COUNT, nearest.size());
+								std::partial_sort(nearest.begin(), nearest.begin() + occluder_instances, nearest.end());
+								occluders.clear();
+								for (size_t n = 0; n < occluder_instances; n++) {
+									DirectX::XMMATRIX world_view_projection = world_matrices[nearest[n].second] * view_projection;
+									for (const MeshInfo& mesh_info : meshes) {
+										OcclusionCuller::Occluder occluder;
+										occluder.mesh = &mesh_info;
+										occluder.lod = mesh_info.SelectLodByError(OCCLUDER_MAX_LOD_ERROR);
+										occluder.world_view_projection = world_view_projection;
+										occluders.push_back(occluder);
+									}
+								}
+								occlusion_culler->Clear();
+								occlusion_culler->RenderOccluders(occluders);
+								for (size_t m = 0; m < meshes.size(); m++) {
+									std::vector<unsigned int>& visible = visible_instances[m];
+									visible.erase(std::remove_if(visible.begin(), visible.end(), [&](unsigned int i) {
+										return !occlusion_culler->IsVisible(meshes[m].bounding_box_min, meshes[m].bounding_box_max, world_matrices[i] * view_projection);
+										}), visible.end());
+								}
+							}
+							for (size_t m = 0; m < meshes.size(); m++) {
+								const MeshInfo& mesh_info = meshes[m];
+								std::vector<unsigned int>& offsets = lod_instance_offsets[m];
+								offsets.assign(mesh_info.GetLodCount() + 1, 0);
+								std::vector<DirectX::XMFLOAT2>& depth_ranges = lod_depth_ranges[m];
+								depth_ranges.assign(mesh_info.GetLodCount(), DirectX::XMFLOAT2(SORT_MAX_DEPTH, 0.0f));
+								//LODはメッシュ自身の大きさで選ぶ(誤差はメッシュの大きさに対する比率なので)
+								for (unsigned int i : visible_instances[m]) {
+									DirectX::XMFLOAT4 sphere = InstanceCuller::TransformSphere(mesh_info.bounding_sphere, world_matrices[i]);
+									float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(&sphere), eye)));
+									float screen_size = 2.0f * sphere.w * projection_scale * half_height / std::max(distance, 0.1f);
+									instance_lods[i] = mesh_info.SelectLod(screen_size, LOD_MAX_PIXEL_ERROR);
+									max_screen_size = std::max(max_screen_size, screen_size);
+									offsets[instance_lods[i] + 1]++;
+									DirectX::XMFLOAT2& depth_range = depth_ranges[instance_lods[i]];
+									depth_range.x = std::min(depth_range.x, distance);
+									depth_range.y = std::max(depth_range.y, distance);
+								}
+								//LOD毎の個数から開始位置を求めて、インスタンス番号を振り分ける
+								for (size_t lod = 1; lod < offsets.size(); lod++)
+									offsets[lod] += offsets[lod - 1];
+								std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+								unsigned int* mesh_instance_ids = instance_ids + m * INSTANCE_COUNT;
+								for (unsigned int i : visible_instances[m])
+									mesh_instance_ids[fill[instance_lods[i]]++] = i;
+								//LOD0で描くインスタンスは、メッシュレット単位でカリングしてインスタンス毎にドローを作る
+								//上限に達したら、そこから後ろのインスタンスは通常通りLOD0の1ドローでまとめて描く
+								meshlet_culled_counts[m] = 0;
+								if constexpr (USE_MESHLET_CULLING) {
+									for (unsigned int k = offsets[0]; k < offsets[1]; k++) {
+										unsigned int i = mesh_instance_ids[k];
+										meshlet_arguments.clear();
+										MeshletCuller::Cull(mesh_info, mesh_allocations[m], world_matrices[i], view_projection, CAMERA_EYE_POSITION, 0, meshlet_arguments, &meshlet_stats);
+										if (meshlet_commands.size() + meshlet_arguments.size() > MESHLET_MAX_DRAWS)
+											break;
+										DirectX::XMFLOAT4 sphere = InstanceCuller::TransformSphere(mesh_info.bounding_sphere, world_matrices[i]);
+										float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(&sphere), eye)));
+										for (const D3D12_DRAW_INDEXED_ARGUMENTS& arguments : meshlet_arguments) {
+											IndirectDrawCommand command;
+											command.material_index = mesh_info.material_index;
+											command.mesh_index = static_cast<unsigned int>(m);
+											command.instance_offset = static_cast<unsigned int>(m * INSTANCE_COUNT + k);
+											command.draw = arguments;
+											meshlet_commands.push_back({ distance, command });
+										}
+										meshlet_culled_counts[m]++;
+									}
+								}
+							}
+							if constexpr (USE_MESHLET_CULLING) {
+								PROFILE_COUNTER("MeshletVisible", meshlet_stats.visible);
+								PROFILE_COUNTER("MeshletFrustumCulled", meshlet_stats.frustum_culled);
+								PROFILE_COUNTER("MeshletBackfaceCulled", meshlet_stats.backface_culled);
+							}
+						}
+						for (TextureHandle handle : { diffuse_texture, normal_texture, roughness_texture, metallic_texture })
+							ResourceManager::Instance()->RequestScreenSize(handle, max_screen_size);
+					}
 					//このままではラスタライザーで全ての頂点がdiscardされてしまうため、ビューポートとシザー矩形を画面全体に設定しておく
 					{
 						D3D12_VIEWPORT viewport = {};
@@ -950,59 +1385,129 @@ namespace System {
 						viewport.Height = static_cast<float>(back_buffer->GetResourceDesc().Height);
 						viewport.MinDepth = 0.0f;
 						viewport.MaxDepth = 1.0f;
-						cmd_list->RSSetViewports(1, &viewport);
+						state->RSSetViewports(1, &viewport);
 						D3D12_RECT scissor_rect = {};
 						scissor_rect.left = 0;
 						scissor_rect.top = 0;
 						scissor_rect.right = static_cast<LONG>(back_buffer->GetResourceDesc().Width);
 						scissor_rect.bottom = static_cast<LONG>(back_buffer->GetResourceDesc().Height);
-						cmd_list->RSSetScissorRects(1, &scissor_rect);
+						state->RSSetScissorRects(1, &scissor_rect);
 
 
 					}
 
-					cmd_list->SetGraphicsRootSignature(root_signature->GetRootSignature());
-					cmd_list->SetPipelineState(pipeline_state->GetPipelineState());
-					cmd_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					state->SetGraphicsRootSignature(root_signature->GetRootSignature());
+					state->SetPipelineState(pipeline_state->GetPipelineState());
+					state->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 					ID3D12DescriptorHeap* descriptor_heaps[] = { System::DirectX12Manager::Instance()->GetCBVSRVUAVHeap()->GetHeap() };
-					cmd_list->SetDescriptorHeaps(1, descriptor_heaps);
-
-
-					cmd_list->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot, material_buffer->GetResource()->GetGPUVirtualAddress());
-					cmd_list->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 1, objs_buffer->GetResource()->GetGPUVirtualAddress());
-					cmd_list->SetGraphicsRootDescriptorTable(RootSignature::SRVSlot, System::DirectX12Manager::Instance()->GetCBVSRVUAVHeap()->GetStartGPUHandle());
-
-					cmd_list->SetGraphicsRootConstantBufferView(RootSignature::CBVSlot, frame_constant_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->GetResource()->GetGPUVirtualAddress());
-
-
+					state->SetDescriptorHeaps(1, descriptor_heaps);
+
+
+					state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot, MaterialManager::Instance()->GetTableAddress());
+					state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 1, objs_buffer->GetResource()->GetGPUVirtualAddress());
+					state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 2, mesh_buffer->GetResource()->GetGPUVirtualAddress());
+					//GPUでカリングした場合は、コンピュートシェーダーが書いた表を使う
+					if constexpr (USE_GPU_CULLING)
+						state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 3, gpu_instance_culler->GetInstanceIdAddress());
+					else
+						state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 3, frame_instance_lod_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->GetResource()->GetGPUVirtualAddress());
+					state->SetGraphicsRootDescriptorTable(RootSignature::SRVSlot, System::DirectX12Manager::Instance()->GetCBVSRVUAVHeap()->GetStartGPUHandle());
+					//アトラスの参照の表(space1のt0)と、同じディスクリプタをTexture2DArrayとして読む配列(space1のt1~)
+					state->SetGraphicsRootShaderResourceView(RootSignature::AtlasSlot, MaterialManager::Instance()->GetAtlasTableAddress());
+					state->SetGraphicsRootDescriptorTable(RootSignature::AtlasSlot + 1, System::DirectX12Manager::Instance()->GetCBVSRVUAVHeap()->GetStartGPUHandle());
+
+					state->SetGraphicsRootConstantBufferView(RootSignature::CBVSlot, frame_constant_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->GetResource()->GetGPUVirtualAddress());
+					//仮想テクスチャのページテーブル(t4)とフィードバック(u0)
+					if (virtual_texture) {
+						state->SetGraphicsRootShaderResourceView(RootSignature::StructuredBufferSlot + 4, virtual_texture->GetPageTableAddress());
+						state->SetGraphicsRootUnorderedAccessView(RootSignature::UAVSlot, virtual_texture->GetFeedbackAddress());
+					}
 
-					unsigned int idx_offset = 0;
-					unsigned int vertex_offset = 0;
 
-					for (size_t i = 0; i < meshes.size(); ++i) {
-						//頂点バッファをセットして、描画コマンドを発行する
-						{
 
-							cmd_list->IASetVertexBuffers(0, 1, vertex_buffers[i]->GetViewPtr());
+					//インスタンス描画を行う。
+					//今回用意したモデルは無駄に50000ポリゴンあるが、
+					//50000*1000体で
+					//合計5000万ポリゴンを描画することができる。
+					//全メッシュが同じ頂点・インデックスバッファに入っているので、バインドは1回だけ
+					//ルート定数とDrawIndexedInstancedの引数はドロー毎に引数バッファに詰めてあるので、
+					//メッシュ×LODの数だけあったドローコールが、ExecuteIndirect1回になる
+					geometry_pool->Bind(state);
+					if constexpr (USE_GPU_CULLING) {
+						if (indirect_command_buffer->Execute(recorder, gpu_instance_culler->GetCommandBuffer(), gpu_instance_culler->GetCommandCount()) != 0) {
+							return -1;
 						}
-						//インデックスバッファをセットする
-						{
-							cmd_list->IASetIndexBuffer(index_buffers[i]->GetViewPtr());
+					}
+					else {
+						PROFILE_ZONE("BuildDrawList");
+						//LOD毎にまとめたインスタンスの範囲が、そのまま1ドローになる
+						//ドロー毎にソートキーを付けてレンダーキューに積み、並べ替えてから引数バッファに詰める
+						render_queue.Clear();
+						for (size_t i = 0; i < meshes.size(); ++i) {
+							const std::vector<unsigned int>& offsets = lod_instance_offsets[i];
+							bool translucent = MaterialManager::Instance()->IsTranslucent(meshes[i].material_index);
+							for (size_t lod = 0; lod < meshes[i].GetLodCount(); lod++) {
+								//LOD0の先頭のインスタンスは、メッシュレット単位のドローで描いてある
+								unsigned int skipped = lod == 0 ? meshlet_culled_counts[i] : 0;
+								unsigned int instance_count = offsets[lod + 1] - offsets[lod] - skipped;
+								MeshLod mesh_lod = meshes[i].GetLod(lod);
+								if (instance_count == 0 || mesh_lod.index_count == 0)
+									continue;
+								IndirectDrawCommand command;
+								command.material_index = meshes[i].material_index;
+								command.mesh_index = static_cast<unsigned int>(i);
+								command.instance_offset = static_cast<unsigned int>(i * INSTANCE_COUNT + offsets[lod] + skipped);
+								command.draw.IndexCountPerInstance = mesh_lod.index_count;
+								command.draw.InstanceCount = instance_count;
+								command.draw.StartIndexLocation = mesh_allocations[i].first_index + mesh_lod.index_offset;
+								command.draw.BaseVertexLocation = static_cast<INT>(mesh_allocations[i].base_vertex);
+								command.draw.StartInstanceLocation = 0;
+								//不透明は一番近いインスタンス、半透明は一番遠いインスタンスの距離で並べる
+								const DirectX::XMFLOAT2& depth_range = lod_depth_ranges[i][lod];
+								float depth = translucent ? depth_range.y : depth_range.x;
+								render_queue.Push(RenderQueue::MakeKey(0, translucent, GetPipelineId(command.material_index), command.material_index, depth, SORT_MAX_DEPTH), command);
+							}
 						}
-						cmd_list->SetGraphicsRoot32BitConstant(RootSignature::RootConstantSlot, static_cast<UINT>(meshes[i].material_index), 0);
+						//メッシュレットのカリングで残った範囲は、インスタンスまでの距離で並べる
+						for (const auto& [distance, command] : meshlet_commands)
+							render_queue.Push(RenderQueue::MakeKey(0, MaterialManager::Instance()->IsTranslucent(command.material_index), GetPipelineId(command.material_index), command.material_index, distance, SORT_MAX_DEPTH), command);
+						render_queue.Sort();
 
-
-						//インスタンス描画を行う。
-						//今回用意したモデルは無駄に50000ポリゴンあるが、
-						//50000*1000体で
-						//合計5000万ポリゴンを2ドローコールで描画することができる。
-						cmd_list->DrawIndexedInstanced(meshes[i].indices.size(), 5000, idx_offset, vertex_offset, 0);
+						if (indirect_command_buffer->Begin() != 0) {
+							return -1;
+						}
+						//PSOが変わる所でExecuteIndirectを区切る
+						size_t run_begin = 0;
+						for (size_t n = 0; n <= render_queue.GetCount(); n++) {
+							bool run_end = n == render_queue.GetCount() ||
+								(n > run_begin && RenderQueue::GetPipelineId(render_queue.GetKey(n)) != RenderQueue::GetPipelineId(render_queue.GetKey(run_begin)));
+							if (run_end && n > run_begin) {
+								unsigned int pipeline_id = RenderQueue::GetPipelineId(render_queue.GetKey(run_begin));
+								if (pipeline_id >= pipeline_states.size()) {
+									return -1;
+								}
+								//直前のランと同じPSOなら、ラッパーが設定を省く
+								state->SetPipelineState(pipeline_states[pipeline_id]->GetPipelineState());
+								if (indirect_command_buffer->ExecuteRange(recorder, run_begin, n - run_begin) != 0) {
+									return -1;
+								}
+								run_begin = n;
+							}
+							if (n < render_queue.GetCount() && indirect_command_buffer->Add(render_queue.GetCommand(n)) != 0) {
+								return -1;
+							}
+						}
 					}
 
 				}
 
 
 
+				//このフレームで書いたフィードバックを読み戻しに回す(読むのは数フレーム後のUpdate)
+				if (virtual_texture && virtual_texture->EndFrame(recorder) != 0) {
+					return -1;
+				}
+
 #if 0
 				SystemGUI::ImGuiDrawBegin();
 				{
@@ -1049,13 +1554,33 @@ namespace System {
 				static int press_counter_prtscr = 0;
 				if (GetKeyState(VK_SPACE) & 0x8000) {
 					if (press_counter_prtscr == 0) {
-						Texture::Loader::SaveToFile(depth_texture.get(), L"Assets/Textures/tex3d_test.dds");
+						//コピーをこのフレームのコマンドに積むだけで、書き出しは数フレーム後に別スレッドで行う
+						if (texture_readback->Capture(recorder, depth_texture.get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, L"Assets/Textures/tex3d_test.dds") != 0) {
+							OutputDebugString(L"深度バッファの読み戻しを積めませんでした\n");
+						}
 					}
 					press_counter_prtscr++;
 				}
 				else {
 					press_counter_prtscr = 0;
 				}
+				//F9で、バックバッファの連番キャプチャを切り替える(書き出しが追いつかないフレームは抜ける)
+				static int press_counter_f9 = 0;
+				if (GetKeyState(VK_F9) & 0x8000) {
+					if (press_counter_f9 == 0) {
+						is_capturing_frames = !is_capturing_frames;
+					}
+					press_counter_f9++;
+				}
+				else {
+					press_counter_f9 = 0;
+				}
+				if (is_capturing_frames) {
+					wchar_t frame_path[64];
+					swprintf_s(frame_path, L"Captures/frame_%06u.png", frame_count);
+					texture_readback->Capture(recorder, back_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET, frame_path);
+				}
+				PROFILE_COUNTER("CaptureDropped", texture_readback->GetDroppedCount());
 
 
 				D3D12_RESOURCE_BARRIER end_barrier = {};
@@ -1064,7 +1589,19 @@ namespace System {
 				end_barrier.Transition.Subresource = 0;
 				end_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
 				end_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-				cmd_list->ResourceBarrier(1, &end_barrier);
+				recorder->ResourceBarrier(1, &end_barrier);
+				draw_context->EndGpuZone(gpu_frame_zone);
+
+				PROFILE_COUNTER("DrawCount", render_queue.GetCount());
+				PROFILE_COUNTER("StateCallsIssued", state->GetStats().GetIssuedCount());
+				PROFILE_COUNTER("StateCallsSkipped", state->GetStats().GetSkippedCount());
+
+				if (capture_this_frame) {
+					recorder->EndCapture();
+					if (capture_stream.SaveToFile(capture_path) != 0) {
+						OutputDebugString(L"コマンドストリームの保存に失敗しました\n");
+					}
+				}
 
 				if (DirectX12Manager::Instance()->DrawEnd() < 0) {
 					return -1;
@@ -1073,6 +1610,13 @@ namespace System {
 				if (WindowManager::Instance()->ScreenFlip() < 0)
 					return -1;
 
+				ProfileManager::Instance()->EndFrame();
+
+				//フレーム数の上限に達したら終了する
+				frame_count++;
+				if (max_frame_count != 0 && frame_count >= max_frame_count)
+					break;
+
 
 			}
 
@@ -1083,7 +1627,23 @@ namespace System {
 	}
 	int ApplicationManager::Finalize()
 	{
+		if (!profile_path.empty() && ProfileManager::Instance()->ExportChromeTrace(profile_path) != 0) {
+			OutputDebugString(L"プロファイルの書き出しに失敗しました\n");
+		}
 		//SystemGUI::DestroyImGui();
+		//積んだ読み戻しを書き出し終えてから、作業スレッドを止める
+		if (texture_readback) {
+			texture_readback->Flush();
+			texture_readback.reset();
+		}
+		//仮想テクスチャの作業スレッドとコピーキューを止める
+		virtual_texture.reset();
+		//マテリアルが持つテクスチャの参照を手放してから、テクスチャを破棄する
+		MaterialManager::Instance()->Finalize();
+		//マテリアルの参照が無くなってから、まとめたテクスチャを破棄する
+		texture_atlas.reset();
+		//読み込みのスレッドとコピーキューを、デバイスより先に止める
+		ResourceManager::Instance()->Finalize();
 		WindowManager::Instance()->ReleaseSwapChain();
 		DirectX12Manager::Instance()->Finalize();
 		WindowManager::Instance()->Finalize();
@@ -25,10 +25,30 @@ namespace System {
 		//・TimeManager：時間の管理
 		//・ThreadManager：スレッドの管理(今回はマルチスレッドは扱わない予定)
 
+		unsigned int max_frame_count = 0;	// この回数だけ描画したらメインループを抜ける。0なら無制限(ウィンドウが閉じられるまで回る)
+		unsigned int capture_frame = 0;		// コマンドを記録するフレーム(0始まり)
+		std::wstring capture_path;			// 記録したコマンドの保存先。空なら記録しない
+		std::wstring profile_path;			// 終了時にプロファイル(Chromeのトレース形式)を書き出す先。空なら書き出さない
+		bool cook_textures = false;			// 初期化時に、テクスチャをクックしてDDSを作り直すかどうか
+
 
 	public:
 		static ApplicationManager* Instance();
 
+		// @brief 描画するフレーム数の上限を設定する
+		// @details ヘッドレスモードではウィンドウを閉じて終了できないので、計測などではこれで終わらせる
+		void SetMaxFrameCount(unsigned int count) { max_frame_count = count; }
+		// @brief 指定したフレームで積んだコマンドをCommandStreamに記録し、ファイルに保存する
+		// @details 保存したファイルはCommandStreamReplayerで、アプリやアセット無しに何度でも積み直せる
+		void SetCaptureFrame(unsigned int frame, const std::wstring& path) {
+			capture_frame = frame;
+			capture_path = path;
+		}
+		// @brief 終了時に、ProfileManagerで計測した区間をChromeのトレース形式で書き出す
+		void SetProfileOutput(const std::wstring& path) { profile_path = path; }
+		// @brief 初期化時に、元の画像からブロック圧縮とミップ作成を済ませたDDSを作り直す(Assets/Textures/Cooked)
+		void SetCookTextures(bool enabled) { cook_textures = enabled; }
+
 		int RunApplication();
 		int Initialize();
 		int MainLoop();
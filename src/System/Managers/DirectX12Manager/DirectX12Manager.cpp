@@ -2,6 +2,7 @@
 #include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
 #include "System/SystemUtils/DescriptorHeaps/DescriptorHeap/DescriptorHeap.h"
 #include "System/Managers/WindowManager/WindowManager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
 #ifdef _DEBUG
 #include <dxgidebug.h>
 #pragma comment(lib, "dxguid.lib")
@@ -54,10 +55,19 @@ namespace System {
 		minimum_feature_level = level;
 	}
 
+	void DirectX12Manager::SetAdapterType(AdapterType type)
+	{
+		// すでにデバイスが作成されている場合は、アダプタを変更できないため、何もせずに関数を終了する
+		if (device) return;
+
+		adapter_type = type;
+	}
+
 
 
 	int DirectX12Manager::DrawBegin()
 	{
+		PROFILE_FUNCTION();
 		if (!draw_context[current_draw_context_index] || !draw_command_queue) {
 			// 描画コンテキストや描画コマンドキューが有効でない場合は、-1を返す
 			return -1;
@@ -68,6 +78,7 @@ namespace System {
 
 	int DirectX12Manager::DrawEnd()
 	{
+		PROFILE_FUNCTION();
 
 		if (FAILED(draw_context[current_draw_context_index]->CloseCommandList()))
 			return -1;
@@ -130,6 +141,7 @@ namespace System {
 
 	int DirectX12Manager::Initialize()
 	{
+		PROFILE_FUNCTION();
 
 		if (CreateFactory(dxgi_adapter) < 0) {
 			return -1;
@@ -315,6 +327,9 @@ namespace System {
 
 			// 使用可能なアダプタの中から、NVIDIA製やAMD製のGPUを優先的に選択する
 			for (auto& adapter : adapters) {
+				// WARPを指定された場合は、GPUを探さない
+				if (adapter_type == AdapterType::Warp)
+					break;
 				DXGI_ADAPTER_DESC desc = {};
 				adapter->GetDesc(&desc);
 				std::wstring string_desc = desc.Description;
@@ -329,6 +344,30 @@ namespace System {
 					break;
 				}
 			}
+			// NVIDIA製やAMD製が無ければ、他のGPUを使う
+			// ベンダーIDが0x1414(Microsoft)のアダプタはWARP(Microsoft Basic Render Driver)なので除外する
+			static constexpr UINT MICROSOFT_VENDOR_ID = 0x1414;
+			if (!tmp_adapter && adapter_type == AdapterType::Hardware) {
+				for (auto& adapter : adapters) {
+					DXGI_ADAPTER_DESC desc = {};
+					adapter->GetDesc(&desc);
+					if (desc.VendorId != MICROSOFT_VENDOR_ID) {
+						tmp_adapter = adapter;
+						break;
+					}
+				}
+			}
+
+			// GPUが1つも無いマシン(CIのサーバーなど)では、WARPで動かす
+			// 描画はCPUで行われるので遅いが、アロケーターやカリング、アップロードなどの処理は全てそのまま通る
+			if (!tmp_adapter) {
+				HRESULT warp_hr = factory->EnumWarpAdapter(IID_PPV_ARGS(tmp_adapter.GetAddressOf()));
+				if (FAILED(warp_hr)) {
+					return -1;
+				}
+				adapter_type = AdapterType::Warp;
+				OutputDebugString(L"GPUが見つからなかった(または指定された)ので、WARPで動作します\n");
+			}
 			dxgi_adapter = tmp_adapter;
 		}
 		if (dxgi_adapter == nullptr) {
@@ -23,6 +23,12 @@ namespace System {
 	public:
 		static constexpr size_t DRAW_CONTEXT_FRAME_COUNT = 3;	// 描画コンテキストの数。将来的に、複数の描画コンテキストを使用することも考えられるため、定数として定義しておく
 
+		// @brief デバイスを作るアダプタの種類
+		enum class AdapterType {
+			Hardware,	// GPU。NVIDIA製やAMD製を優先し、見つからなければ他のGPU、それも無ければWARPに切り替える
+			Warp,		// WARP(CPUで動くD3D12のソフトウェア実装)。GPUの無いWindowsのマシンで動かす時に使う(D3D12のランタイムは要る。デバイス無しで動かすのはホスト向けのビルド(tests/)だけ)
+		};
+
 	private:
 		DirectX12Manager() = default;
 
@@ -30,6 +36,7 @@ namespace System {
 		ComPtr<IDXGIAdapter> dxgi_adapter;
 		ComPtr<ID3D12Device> device;
 		D3D_FEATURE_LEVEL minimum_feature_level = D3D_FEATURE_LEVEL_11_0;
+		AdapterType adapter_type = AdapterType::Hardware;	// 実際に使っているアダプタの種類。GPUが見つからずWARPに切り替えた場合はWarpになる
 
 		//他のマネージャーと違い、Singletonを継承させない
 		// D3D11では1対1の関係だった。しかしD3D12では、
@@ -76,6 +83,7 @@ namespace System {
 		CSUHeap* GetCBVSRVUAVHeap() const { return cbv_srv_uav_heap.get(); }
 		RTVHeap* GetRTVHeap() const { return rtv_heap.get(); }
 		DSVHeap* GetDSVHeap() const { return dsv_heap.get(); }
+		AdapterType GetAdapterType() const { return adapter_type; }
 		const unsigned int GetFrameIndex() const { return current_draw_context_index; }	// 現在のフレームインデックスを取得する関数。これを使用して、描画コンテキストの切り替えを行うことができるようになる。
 
 
@@ -85,6 +93,9 @@ namespace System {
 		// @brief DirectX12の最低限必要な機能レベルを設定する関数
 		void SetMinimumFeatureLevel(D3D_FEATURE_LEVEL level);
 
+		// @brief デバイスを作るアダプタの種類を設定する関数
+		void SetAdapterType(AdapterType type);
+
 
 		//---------------------------------------------
 
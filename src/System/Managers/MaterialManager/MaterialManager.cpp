@@ -0,0 +1,424 @@
+﻿#include "MaterialManager.h"
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+
+#include "assimp/material.h"
+
+#include <algorithm>
+
+namespace System {
+
+	namespace {
+		HRESULT CreateBuffer(size_t size, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES state, ComPtr<ID3D12Resource>& out_resource) {
+			D3D12_HEAP_PROPERTIES heap_properties = {};
+			heap_properties.Type = heap_type;
+			heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			heap_properties.CreationNodeMask = 0;
+			heap_properties.VisibleNodeMask = 0;
+			D3D12_RESOURCE_DESC resource_desc = {};
+			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			resource_desc.Alignment = 0;
+			resource_desc.Width = size;
+			resource_desc.Height = 1;
+			resource_desc.DepthOrArraySize = 1;
+			resource_desc.MipLevels = 1;
+			resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+			resource_desc.SampleDesc.Count = 1;
+			resource_desc.SampleDesc.Quality = 0;
+			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			return DirectX12Manager::Instance()->GetDevice()->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, state, nullptr, IID_PPV_ARGS(out_resource.GetAddressOf()));
+		}
+		constexpr size_t MATERIAL_STRIDE = sizeof(MaterialTable::GpuMaterial);
+		constexpr uint32_t DEFAULT_ATLAS_CAPACITY = 16;
+	}
+
+	MaterialManager* MaterialManager::Instance()
+	{
+		static MaterialManager manager;
+		return &manager;
+	}
+
+	int MaterialManager::Initialize(uint32_t initial_capacity)
+	{
+		if (is_initialized) {
+			return 0;
+		}
+		upload_buffers.resize(DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT);
+		if (GrowTable(std::max(1u, initial_capacity)) != 0) {
+			return -1;
+		}
+		//アトラスを使わなくてもルートのSRVに渡せるように、最初から作っておく
+		if (GrowAtlasTable(DEFAULT_ATLAS_CAPACITY) != 0) {
+			return -1;
+		}
+		is_initialized = true;
+		return 0;
+	}
+
+	int MaterialManager::Finalize()
+	{
+		//描画中のフレームがテーブルを使い終わるのを待ってから、全て破棄する
+		if (CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue()) {
+			draw_queue->WaitForCompletionAll();
+		}
+		for (TextureSet& textures : material_textures) {
+			for (TextureHandle& handle : textures)
+				ResourceManager::Instance()->Release(handle);
+		}
+		for (TextureHandle& handle : fallback_textures)
+			ResourceManager::Instance()->Release(handle);
+		material_textures.clear();
+		material_atlas_entries.clear();
+		atlas_references.clear();
+		atlas_entries.clear();
+		atlas_buffer.Reset();
+		mapped_atlas_entries = nullptr;
+		atlas_capacity = 0;
+		pending.clear();
+		table = MaterialTable();
+		table_buffer.Reset();
+		capacity = 0;
+		upload_buffers.clear();
+		retired.clear();
+		texture_view_revision = 0;
+		is_initialized = false;
+		return 0;
+	}
+
+	void MaterialManager::SetFallbackTextures(const TextureSet& textures)
+	{
+		for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++) {
+			ResourceManager::Instance()->Release(fallback_textures[slot]);
+			fallback_textures[slot] = textures[slot];
+			if (fallback_textures[slot].IsValid() && !ResourceManager::Instance()->AddRef(fallback_textures[slot])) {
+				fallback_textures[slot] = {};
+			}
+		}
+		//代わりのテクスチャを使っているかもしれないので、全てのマテリアルの番号を決め直す
+		pending.resize(material_textures.size());
+		for (uint32_t id = 0; id < pending.size(); id++)
+			pending[id] = id;
+	}
+
+	uint32_t MaterialManager::CreateMaterial(const MaterialTable::Desc& desc, const TextureSet& textures)
+	{
+		AtlasEntrySet no_atlas_entries;
+		no_atlas_entries.fill(INVALID_ID);
+		return CreateMaterial(desc, no_atlas_entries, textures);
+	}
+
+	uint32_t MaterialManager::CreateMaterial(const MaterialTable::Desc& desc, const AtlasEntrySet& atlas_entries, const TextureSet& textures)
+	{
+		MaterialTable::Desc key = desc;
+		AtlasEntrySet used_atlas_entries = atlas_entries;
+		for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++) {
+			if (used_atlas_entries[slot] >= atlas_references.size()) {
+				used_atlas_entries[slot] = INVALID_ID;
+			}
+			key.textures[slot] = used_atlas_entries[slot] != INVALID_ID ? ToAtlasKey(used_atlas_entries[slot]) : ToTextureKey(textures[slot]);
+		}
+		bool created = false;
+		uint32_t id = table.Add(key, &created);
+		if (id == INVALID_ID || !created) {
+			return id;
+		}
+		//アトラスを使うスロットのテクスチャは使わないので、参照を持たない
+		//参照を増やせない(破棄済みの)ハンドルは、テクスチャ無しとして扱う
+		TextureSet alive = textures;
+		for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++) {
+			TextureHandle& handle = alive[slot];
+			if (used_atlas_entries[slot] != INVALID_ID) {
+				handle = {};
+			}
+			if (handle.IsValid() && !ResourceManager::Instance()->AddRef(handle)) {
+				handle = {};
+			}
+		}
+		material_textures.push_back(alive);
+		material_atlas_entries.push_back(used_atlas_entries);
+		pending.push_back(id);
+		return id;
+	}
+
+	uint32_t MaterialManager::AddAtlasEntry(const TextureAtlas::Entry& entry)
+	{
+		if (!is_initialized || !entry.texture || !entry.texture->Srv()) {
+			return INVALID_ID;
+		}
+		//最上位のビットはアトラスの参照の印に使うので、それより小さいSRVの番号しか書けない
+		uint32_t srv_index = entry.texture->Srv()->GetIndex();
+		if (srv_index >= MaterialTable::ATLAS_ENTRY_BIT) {
+			return INVALID_ID;
+		}
+		uint32_t id = static_cast<uint32_t>(atlas_references.size());
+		AtlasReference reference;
+		reference.srv_index = srv_index;
+		//まとめなかったものは普通のTexture2Dなので、表を通さずにSRVの番号を書く
+		if (!entry.is_packed) {
+			atlas_references.push_back(reference);
+			return id;
+		}
+		uint32_t atlas_entry = static_cast<uint32_t>(atlas_entries.size());
+		if (atlas_entry >= MaterialTable::MAX_ATLAS_ENTRY_COUNT) {
+			return INVALID_ID;
+		}
+		if (atlas_entry >= atlas_capacity && GrowAtlasTable(atlas_entry + 1) != 0) {
+			return INVALID_ID;
+		}
+		MaterialTable::GpuAtlasEntry gpu_entry = {};
+		gpu_entry.srv_index = srv_index;
+		gpu_entry.array_index = entry.array_index;
+		gpu_entry.uv_scale[0] = entry.uv.scale_u;
+		gpu_entry.uv_scale[1] = entry.uv.scale_v;
+		gpu_entry.uv_offset[0] = entry.uv.offset_u;
+		gpu_entry.uv_offset[1] = entry.uv.offset_v;
+		//描画中のフレームが読んでいない所に追記するだけなので、そのまま書き込める
+		mapped_atlas_entries[atlas_entry] = gpu_entry;
+		atlas_entries.push_back(gpu_entry);
+		reference.atlas_entry = atlas_entry;
+		atlas_references.push_back(reference);
+		return id;
+	}
+
+	uint32_t MaterialManager::CreateFromAiMaterial(const aiMaterial* material, const std::filesystem::path& directory)
+	{
+		if (!material) {
+			return INVALID_ID;
+		}
+		MaterialTable::Desc desc;
+		aiColor4D diffuse_color(1.0f, 1.0f, 1.0f, 1.0f);
+		material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse_color);
+		desc.diffuse_color[0] = diffuse_color.r;
+		desc.diffuse_color[1] = diffuse_color.g;
+		desc.diffuse_color[2] = diffuse_color.b;
+		desc.diffuse_color[3] = diffuse_color.a;
+		material->Get(AI_MATKEY_METALLIC_FACTOR, desc.metallic);
+		material->Get(AI_MATKEY_ROUGHNESS_FACTOR, desc.roughness);
+		//ディフューズのアルファが1未満なら半透明として、不透明の後に奥から描く
+		if (desc.diffuse_color[3] < 1.0f) {
+			desc.flags |= MaterialTable::FLAG_TRANSLUCENT;
+		}
+
+		//スロットと同じ順の、読むテクスチャの種類
+		constexpr aiTextureType texture_types[MaterialTable::TextureSlotCount] = {
+			aiTextureType_DIFFUSE,
+			aiTextureType_NORMALS,
+			aiTextureType_DIFFUSE_ROUGHNESS,
+			aiTextureType_METALNESS,
+			aiTextureType_EMISSIVE,
+		};
+		TextureSet textures = {};
+		for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++) {
+			aiString path;
+			//"*0"のようなパスは、ファイルに埋め込まれたテクスチャ
+			if (material->GetTexture(texture_types[slot], 0, &path) != AI_SUCCESS || path.length == 0 || path.data[0] == '*') {
+				continue;
+			}
+			std::u8string utf8_path(reinterpret_cast<const char8_t*>(path.C_Str()), path.length);
+			std::filesystem::path file_path = directory / std::filesystem::path(utf8_path);
+			textures[slot] = ResourceManager::Instance()->LoadTexture(file_path.lexically_normal().wstring(), ResourceManager::LoadMode::Async);
+		}
+		uint32_t id = CreateMaterial(desc, textures);
+		//マテリアルが参照を持ったので、読み込んだ時の参照は手放す
+		for (TextureHandle& handle : textures)
+			ResourceManager::Instance()->Release(handle);
+		return id;
+	}
+
+	int MaterialManager::SetParameters(uint32_t id, const float(&diffuse_color)[4], float metallic, float roughness)
+	{
+		if (!table.IsValidId(id)) {
+			return -1;
+		}
+		MaterialTable::Desc desc = table.GetDesc(id);
+		std::copy(std::begin(diffuse_color), std::end(diffuse_color), desc.diffuse_color);
+		desc.metallic = metallic;
+		desc.roughness = roughness;
+		//半透明かどうかは、アルファから決め直す
+		desc.flags &= ~MaterialTable::FLAG_TRANSLUCENT;
+		if (desc.diffuse_color[3] < 1.0f) {
+			desc.flags |= MaterialTable::FLAG_TRANSLUCENT;
+		}
+		return table.Modify(id, desc);
+	}
+
+	uint32_t MaterialManager::GetSrvIndex(TextureHandle handle, uint32_t slot, bool& out_final) const
+	{
+		ResourceManager* resource_manager = ResourceManager::Instance();
+		out_final = true;
+		if (handle.IsValid()) {
+			AssetState state = resource_manager->GetTextureState(handle);
+			Texture* texture = resource_manager->GetTexture(handle);
+			if (state == AssetState::Ready && texture && texture->Srv()) {
+				return texture->Srv()->GetIndex();
+			}
+			//読み込み中なら、読み終わってからもう一度決める
+			out_final = state != AssetState::Loading;
+		}
+		TextureHandle fallback = fallback_textures[slot];
+		if (!fallback.IsValid()) {
+			return MaterialTable::INVALID_TEXTURE;
+		}
+		AssetState fallback_state = resource_manager->GetTextureState(fallback);
+		Texture* fallback_texture = resource_manager->GetTexture(fallback);
+		if (fallback_state == AssetState::Ready && fallback_texture && fallback_texture->Srv()) {
+			return fallback_texture->Srv()->GetIndex();
+		}
+		if (fallback_state == AssetState::Loading) {
+			out_final = false;
+		}
+		return MaterialTable::INVALID_TEXTURE;
+	}
+
+	void MaterialManager::ResolveTextures()
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			uint32_t id = pending[i];
+			bool resolved = true;
+			for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++) {
+				bool is_final = true;
+				int result = 0;
+				uint32_t atlas_id = material_atlas_entries[id][slot];
+				if (atlas_id != INVALID_ID && atlas_references[atlas_id].atlas_entry != INVALID_ID) {
+					result = table.SetAtlasEntry(id, slot, atlas_references[atlas_id].atlas_entry);
+				}
+				else {
+					uint32_t srv_index = atlas_id != INVALID_ID ? atlas_references[atlas_id].srv_index : GetSrvIndex(material_textures[id][slot], slot, is_final);
+					result = table.SetTextureIndex(id, slot, srv_index);
+				}
+				//アトラスの参照と区別できない番号(最上位のビットが立つもの)は使えないので、テクスチャ無しにする
+				if (result != 0) {
+					table.SetTextureIndex(id, slot, MaterialTable::INVALID_TEXTURE);
+				}
+				resolved = resolved && is_final;
+			}
+			if (!resolved) {
+				pending[kept++] = id;
+			}
+		}
+		pending.resize(kept);
+	}
+
+	int MaterialManager::GrowTable(uint32_t required)
+	{
+		uint32_t new_capacity = std::max(1u, capacity);
+		while (new_capacity < required)
+			new_capacity *= 2;
+		ComPtr<ID3D12Resource> buffer;
+		//COMMONで作り、コピーの時にCOPY_DESTへ暗黙に昇格させる(コマンドリストの実行が終わるとCOMMONに戻る)
+		if (FAILED(CreateBuffer(static_cast<size_t>(new_capacity) * MATERIAL_STRIDE, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, buffer))) {
+			return -1;
+		}
+		//古いテーブルは、今記録しているフレームまでの描画が読み終わってから破棄する
+		if (table_buffer) {
+			uint64_t fence_value = DirectX12Manager::Instance()->GetDrawQueue()->GetLastSignaledValue() + 1;
+			retired.push_back({ table_buffer, fence_value });
+		}
+		table_buffer = buffer;
+		capacity = new_capacity;
+		table.MarkAllDirty();
+		return 0;
+	}
+
+	int MaterialManager::GrowAtlasTable(uint32_t required)
+	{
+		uint32_t new_capacity = std::max(1u, atlas_capacity);
+		while (new_capacity < required)
+			new_capacity *= 2;
+		ComPtr<ID3D12Resource> buffer;
+		if (FAILED(CreateBuffer(static_cast<size_t>(new_capacity) * sizeof(MaterialTable::GpuAtlasEntry), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, buffer))) {
+			return -1;
+		}
+		MaterialTable::GpuAtlasEntry* mapped = nullptr;
+		if (FAILED(buffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)))) {
+			return -1;
+		}
+		if (!atlas_entries.empty()) {
+			std::memcpy(mapped, atlas_entries.data(), atlas_entries.size() * sizeof(MaterialTable::GpuAtlasEntry));
+		}
+		//古い表は、今記録しているフレームまでの描画が読み終わってから破棄する
+		if (atlas_buffer) {
+			uint64_t fence_value = DirectX12Manager::Instance()->GetDrawQueue()->GetLastSignaledValue() + 1;
+			retired.push_back({ atlas_buffer, fence_value });
+		}
+		atlas_buffer = buffer;
+		mapped_atlas_entries = mapped;
+		atlas_capacity = new_capacity;
+		return 0;
+	}
+
+	int MaterialManager::Update(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list)
+	{
+		PROFILE_FUNCTION();
+		if (!is_initialized || !command_list) {
+			return -1;
+		}
+		uint64_t completed = DirectX12Manager::Instance()->GetDrawQueue()->GetCompletedValue();
+		while (!retired.empty() && retired.front().fence_value <= completed) {
+			retired.pop_front();
+		}
+		//ストリーミングでディスクリプタが切り替わったテクスチャがあれば、全てのマテリアルの番号を決め直す
+		//(番号が変わらなかったマテリアルは、転送されない)
+		uint64_t view_revision = ResourceManager::Instance()->GetTextureViewRevision();
+		if (view_revision != texture_view_revision) {
+			texture_view_revision = view_revision;
+			pending.resize(material_textures.size());
+			for (uint32_t id = 0; id < pending.size(); id++)
+				pending[id] = id;
+		}
+		ResolveTextures();
+		if (table.GetCount() > capacity && GrowTable(static_cast<uint32_t>(table.GetCount())) != 0) {
+			return -1;
+		}
+		PROFILE_COUNTER("MaterialCount", table.GetCount());
+		if (!table.HasDirty()) {
+			return 0;
+		}
+
+		std::vector<MaterialTable::Range> ranges = table.TakeDirtyRanges();
+		size_t upload_size = 0;
+		for (const MaterialTable::Range& range : ranges)
+			upload_size += static_cast<size_t>(range.count) * MATERIAL_STRIDE;
+		//このフレーム番号のコンテキストは、前に使った時の実行を終えているので、同じアップロードバッファを使い回せる
+		UploadBuffer& upload = upload_buffers[DirectX12Manager::Instance()->GetFrameIndex()];
+		if (upload.size < upload_size) {
+			size_t new_size = std::max(upload_size, upload.size * 2);
+			if (FAILED(CreateBuffer(new_size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, upload.buffer))) {
+				upload.size = 0;
+				table.MarkAllDirty();
+				return -1;
+			}
+			upload.size = new_size;
+		}
+		unsigned char* mapped_data = nullptr;
+		if (FAILED(upload.buffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped_data)))) {
+			table.MarkAllDirty();
+			return -1;
+		}
+		const std::vector<MaterialTable::GpuMaterial>& materials = table.GetGpuMaterials();
+		size_t offset = 0;
+		for (const MaterialTable::Range& range : ranges) {
+			size_t size = static_cast<size_t>(range.count) * MATERIAL_STRIDE;
+			std::memcpy(mapped_data + offset, &materials[range.begin], size);
+			command_list->CopyBufferRegion(table_buffer.Get(), static_cast<UINT64>(range.begin) * MATERIAL_STRIDE, upload.buffer.Get(), offset, size);
+			offset += size;
+		}
+		upload.buffer->Unmap(0, nullptr);
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = table_buffer.Get();
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		command_list->ResourceBarrier(1, &barrier);
+		PROFILE_COUNTER("MaterialUploadBytes", upload_size);
+		return 0;
+	}
+}
@@ -0,0 +1,152 @@
+﻿#pragma once
+#include <deque>
+#include "System/Managers/ResourceManager/ResourceManager.h"
+#include "System/SystemUtils/Material/MaterialTable/MaterialTable.h"
+#include "System/SystemUtils/TextureTools/TextureAtlas/TextureAtlas.h"
+
+struct aiMaterial;
+
+namespace System {
+	template <class CommandList> class CommandStreamRecorder;
+
+	//-------------------------------------------------------------
+	// @brief マテリアルマネージャー
+	// @brief 全てのマテリアルを1本のStructuredBuffer(バインドレスのマテリアルテーブル)にまとめて持つクラス
+	// @details ・マテリアルは重複を省いて番号を振る。描画はその番号で、テーブルとテクスチャの配列を引く
+	//			・テーブルはDEFAULTヒープに置き、足りなくなったら倍の大きさで作り直す(古いものは描画キューの完了後に破棄する)
+	//			・書き換えたマテリアルだけを、Updateでフレーム毎のアップロードバッファから描画のコマンドリストでコピーする
+	//			  (同じキューなので、前のフレームがテーブルを読み終わってから書き換わる)
+	//			・読み込み中のテクスチャの代わりには、スロット毎の代わりのテクスチャの番号を書いておき、読み終わったら書き換える
+	//			・ストリーミングでテクスチャのSRVが切り替わったら、全てのマテリアルの番号を決め直す
+	//			・TextureAtlasにまとめたテクスチャは、アトラスの参照の表(配列の要素とUVの変換)を通して読む。
+	//			  表はアップロードヒープに置き、追記するだけなので描画中のフレームと競合しない(足りなくなったら作り直す)
+	//			マテリアルはテクスチャの参照を1つずつ持ち、Finalizeで手放す
+	//-------------------------------------------------------------
+	class MaterialManager
+	{
+	public:
+		using TextureSet = std::array<TextureHandle, MaterialTable::TextureSlotCount>;
+		// @brief スロット毎のアトラスの参照(AddAtlasEntryの戻り値)。使わないスロットはINVALID_ID
+		using AtlasEntrySet = std::array<uint32_t, MaterialTable::TextureSlotCount>;
+		static constexpr uint32_t INVALID_ID = MaterialTable::INVALID_ID;
+		static constexpr uint32_t DEFAULT_CAPACITY = 256;
+
+	private:
+		MaterialManager() = default;
+
+		MaterialTable table;
+		std::vector<TextureSet> material_textures;	// マテリアル毎のテクスチャ(参照を持つ)
+		std::vector<AtlasEntrySet> material_atlas_entries;	// マテリアル毎のアトラスの参照(テクスチャより優先する)
+		// @brief AddAtlasEntryで追加した参照。まとめたものは表の番号、まとめなかったものはSRVの番号で書く
+		struct AtlasReference {
+			uint32_t srv_index = MaterialTable::INVALID_TEXTURE;
+			uint32_t atlas_entry = INVALID_ID;	// INVALID_IDでなければ、表を通して読む
+		};
+		std::vector<AtlasReference> atlas_references;	// AddAtlasEntryの戻り値毎
+		std::vector<uint32_t> pending;				// テクスチャの番号がまだ決まっていないマテリアル
+		TextureSet fallback_textures = {};			// 読み込み中・失敗・無しの時に使うテクスチャ(参照を持つ)
+
+		ComPtr<ID3D12Resource> table_buffer;
+		uint32_t capacity = 0;	// table_bufferに入るマテリアルの数
+		// @brief フレーム毎のアップロードバッファ(同じフレーム番号のコンテキストが完了してから使い回す)
+		struct UploadBuffer {
+			ComPtr<ID3D12Resource> buffer;
+			size_t size = 0;
+		};
+		std::vector<UploadBuffer> upload_buffers;
+		// @brief 作り直した後、描画キューの完了を待っている古いテーブル
+		struct Retired {
+			ComPtr<ID3D12Resource> buffer;
+			uint64_t fence_value = 0;
+		};
+		std::deque<Retired> retired;
+		// @brief アトラスの参照の表(GPUに送るもの)
+		std::vector<MaterialTable::GpuAtlasEntry> atlas_entries;
+		ComPtr<ID3D12Resource> atlas_buffer;
+		MaterialTable::GpuAtlasEntry* mapped_atlas_entries = nullptr;
+		uint32_t atlas_capacity = 0;	// atlas_bufferに入る数
+		uint64_t texture_view_revision = 0;	// 最後に番号を決めた時の、ResourceManager::GetTextureViewRevision
+		bool is_initialized = false;
+
+		// @brief capacity以上の数が入るテーブルを作り、全てのマテリアルを転送し直す
+		int GrowTable(uint32_t required);
+		// @brief required以上の数が入るアトラスの参照の表を作り、今までの参照を書き写す
+		int GrowAtlasTable(uint32_t required);
+		// @brief テクスチャの番号が決まっていないマテリアルに、使える番号を書き込む
+		void ResolveTextures();
+		// @brief スロットに書くSRVの番号。テクスチャが使えなければ代わりのテクスチャ、それも無ければINVALID_TEXTURE
+		// @param [out] out_final これ以上変わらない番号ならtrue
+		uint32_t GetSrvIndex(TextureHandle handle, uint32_t slot, bool& out_final) const;
+		// @brief Descでテクスチャを区別する値
+		static uint64_t ToAtlasKey(uint32_t atlas_entry) { return (1ull << 63) | atlas_entry; }
+		static uint64_t ToTextureKey(TextureHandle handle) { return handle.IsValid() ? (static_cast<uint64_t>(handle.generation) << 32) | handle.index : 0; }
+
+	public:
+		static MaterialManager* Instance();
+
+		// @param [in] initial_capacity 最初に作るテーブルに入るマテリアルの数
+		int Initialize(uint32_t initial_capacity = DEFAULT_CAPACITY);
+		// @brief テーブルとテクスチャの参照を手放す。ResourceManagerより先に呼ぶこと
+		int Finalize();
+
+		//-------------------------------------------------------------
+		// @brief スロット毎の、代わりのテクスチャを設定する(参照を1つ増やす)
+		// @details テクスチャの無いスロットや読み込み中のテクスチャは、これを使って描く。
+		//			シェーダーが読むスロットには、全て設定しておくこと
+		//-------------------------------------------------------------
+		void SetFallbackTextures(const TextureSet& textures);
+
+		//-------------------------------------------------------------
+		// @brief マテリアルを作る。内容とテクスチャが同じものがあれば、その番号を返す
+		// @details desc.texturesは使わず、texturesから作る。テクスチャの参照は、マテリアルを新しく作った時だけ1つ増やす
+		// @return マテリアルの番号。上限に達していればINVALID_ID
+		//-------------------------------------------------------------
+		uint32_t CreateMaterial(const MaterialTable::Desc& desc, const TextureSet& textures = {});
+
+		//-------------------------------------------------------------
+		// @brief アトラスの参照を使うマテリアルを作る。内容と参照が同じものがあれば、その番号を返す
+		// @details INVALID_IDのスロットは、texturesのテクスチャ(無ければ代わりのテクスチャ)を使う
+		// @return マテリアルの番号。上限に達していればINVALID_ID
+		//-------------------------------------------------------------
+		uint32_t CreateMaterial(const MaterialTable::Desc& desc, const AtlasEntrySet& atlas_entries, const TextureSet& textures = {});
+
+		//-------------------------------------------------------------
+		// @brief TextureAtlasにまとめたテクスチャ1つ分を、マテリアルから使えるようにする
+		// @details まとめなかったもの(is_packedがfalse)は、そのテクスチャのSRVの番号をそのまま使う。
+		//			TextureAtlasは、参照するマテリアルを使い終わるまで生かしておくこと
+		// @return アトラスの参照の番号。上限に達しているか、テクスチャが無ければINVALID_ID
+		//-------------------------------------------------------------
+		uint32_t AddAtlasEntry(const TextureAtlas::Entry& entry);
+
+		//-------------------------------------------------------------
+		// @brief インポートしたマテリアルから作る
+		// @details ディフューズの色と不透明度・メタリック・ラフネスと、スロット毎の最初のテクスチャを読む。
+		//			テクスチャのパスはdirectoryからの相対パスとして、別スレッドで読み込む(埋め込みのテクスチャは読まない)
+		// @param [in] directory モデルのファイルがあるフォルダ
+		// @return マテリアルの番号。上限に達していればINVALID_ID
+		//-------------------------------------------------------------
+		uint32_t CreateFromAiMaterial(const aiMaterial* material, const std::filesystem::path& directory);
+
+		//-------------------------------------------------------------
+		// @brief マテリアルの色・パラメーターを書き換える(テクスチャはそのまま)。次のUpdateで、このマテリアルだけが転送される
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int SetParameters(uint32_t id, const float (&diffuse_color)[4], float metallic, float roughness);
+
+		//-------------------------------------------------------------
+		// @brief 読み終わったテクスチャの番号を書き込み、書き換えたマテリアルをテーブルにコピーするコマンドを積む
+		// @details 1フレームに1回、DrawBeginの後、テーブルを使う描画より前に呼ぶこと
+		//			描画のコマンドリストの記録用のラッパーで積む(記録中のフレームでは、コピーも再生できるように残る)
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int Update(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list);
+
+		// @brief ルートのSRVに渡すテーブルのアドレス
+		D3D12_GPU_VIRTUAL_ADDRESS GetTableAddress() const { return table_buffer ? table_buffer->GetGPUVirtualAddress() : 0; }
+		// @brief ルートのSRVに渡す、アトラスの参照の表のアドレス
+		D3D12_GPU_VIRTUAL_ADDRESS GetAtlasTableAddress() const { return atlas_buffer ? atlas_buffer->GetGPUVirtualAddress() : 0; }
+		bool IsTranslucent(uint32_t id) const { return table.IsTranslucent(id); }
+		size_t GetMaterialCount() const { return table.GetCount(); }
+		const MaterialTable& GetTable() const { return table; }
+	};
+}
@@ -0,0 +1,209 @@
+﻿#include "ProfileManager.h"
+
+namespace System {
+
+	ProfileManager::ProfileManager()
+	{
+		start_time = Now();
+		frame_begin_time = start_time;
+		calibration_ticks = start_time;
+		calibration_time = std::chrono::steady_clock::now();
+		UpdateCalibration();
+	}
+
+	void ProfileManager::UpdateCalibration()
+	{
+		//起動直後で経過時間が短すぎると比が不正確になるので、最低でも1ミリ秒は空ける
+		std::chrono::steady_clock::time_point now_time = std::chrono::steady_clock::now();
+		while (now_time - calibration_time < std::chrono::milliseconds(1))
+			now_time = std::chrono::steady_clock::now();
+		int64_t now_ticks = Now();
+		double elapsed_ms = std::chrono::duration<double, std::milli>(now_time - calibration_time).count();
+		if (now_ticks > calibration_ticks)
+			milliseconds_per_tick = elapsed_ms / static_cast<double>(now_ticks - calibration_ticks);
+	}
+
+	ProfileManager* ProfileManager::Instance()
+	{
+		static ProfileManager manager;
+		return &manager;
+	}
+
+	ProfileThreadBuffer* ProfileManager::AcquireThreadBuffer()
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		//終わったスレッドのバッファがあれば使い回す。毎フレームスレッドを作り直す処理でも、バッファが増え続けないようにするため
+		if (!free_buffers.empty()) {
+			ProfileThreadBuffer* buffer = free_buffers.back();
+			free_buffers.pop_back();
+			buffer->depth = 0;
+			return buffer;
+		}
+		auto buffer = std::make_unique<ProfileThreadBuffer>();
+		buffer->lane = static_cast<uint32_t>(buffers.size());
+		buffers.push_back(std::move(buffer));
+		return buffers.back().get();
+	}
+
+	void ProfileManager::ReleaseThreadBuffer(ProfileThreadBuffer* buffer)
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		free_buffers.push_back(buffer);
+	}
+
+	ProfileThreadBufferHolder::~ProfileThreadBufferHolder()
+	{
+		if (buffer)
+			ProfileManager::Instance()->ReleaseThreadBuffer(buffer);
+	}
+
+	void ProfileManager::CopyEvents(const ProfileThreadBuffer& buffer, uint64_t first, uint64_t last, std::vector<ProfileEvent>& out_events)
+	{
+		//一周以上前のものは、もう上書きされている
+		if (last > ProfileThreadBuffer::CAPACITY && first < last - ProfileThreadBuffer::CAPACITY)
+			first = last - ProfileThreadBuffer::CAPACITY;
+		size_t begin = out_events.size();
+		for (uint64_t i = first; i < last; i++)
+			out_events.push_back(buffer.events[i & (ProfileThreadBuffer::CAPACITY - 1)]);
+
+		//コピーしている間に書き込みが進んでいたら、上書きされた可能性のある先頭の分を捨てる
+		uint64_t after = buffer.write_index.load(std::memory_order_acquire);
+		if (after > ProfileThreadBuffer::CAPACITY) {
+			uint64_t safe_first = after - ProfileThreadBuffer::CAPACITY;
+			if (safe_first > first) {
+				size_t discard = static_cast<size_t>(std::min<uint64_t>(safe_first - first, last - first));
+				out_events.erase(out_events.begin() + begin, out_events.begin() + begin + discard);
+			}
+		}
+	}
+
+	void ProfileManager::EndFrame()
+	{
+		int64_t now = Now();
+		//フレーム全体の区間は、メインスレッドのバッファに積む
+		{
+			ProfileEvent frame_event;
+			frame_event.name = "Frame";
+			frame_event.begin = frame_begin_time;
+			frame_event.value = now;
+			frame_event.type = ProfileEvent::Type::Zone;
+			GetThreadBuffer()->Push(frame_event);
+		}
+		frame_begin_time = now;
+		UpdateCalibration();
+
+		for (ZoneStats& stats : last_frame_zones) {
+			stats.total_ms = 0.0;
+			stats.call_count = 0;
+		}
+
+		aggregate_events.clear();
+		{
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			for (auto& buffer : buffers) {
+				//集計済みの位置は、コピーを始める前の書き込み位置にしておく(コピー中に積まれた分は次のフレームで集計する)
+				uint64_t last = buffer->write_index.load(std::memory_order_acquire);
+				CopyEvents(*buffer, buffer->aggregate_index, last, aggregate_events);
+				buffer->aggregate_index = last;
+			}
+		}
+
+		for (const ProfileEvent& event : aggregate_events) {
+			std::string_view name = event.name ? event.name : "";
+			if (event.type == ProfileEvent::Type::Zone) {
+				auto it = zone_indices.find(name);
+				if (it == zone_indices.end()) {
+					it = zone_indices.emplace(name, last_frame_zones.size()).first;
+					last_frame_zones.push_back({ name, 0.0, 0 });
+				}
+				ZoneStats& stats = last_frame_zones[it->second];
+				stats.total_ms += TicksToMilliseconds(event.value - event.begin);
+				stats.call_count++;
+			}
+			else {
+				auto it = counter_indices.find(name);
+				if (it == counter_indices.end()) {
+					it = counter_indices.emplace(name, last_frame_counters.size()).first;
+					last_frame_counters.push_back({ name, 0 });
+				}
+				last_frame_counters[it->second].value = event.value;
+			}
+		}
+	}
+
+	namespace {
+		//JSONの文字列として書けるように、"と\と制御文字を逃がす
+		void WriteJsonString(std::ofstream& file, const char* text)
+		{
+			file << '"';
+			for (const char* c = text ? text : ""; *c; c++) {
+				switch (*c) {
+				case '"': file << "\\\""; break;
+				case '\\': file << "\\\\"; break;
+				case '\n': file << "\\n"; break;
+				case '\t': file << "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(*c) < 0x20)
+						file << ' ';
+					else
+						file << *c;
+					break;
+				}
+			}
+			file << '"';
+		}
+	}
+
+	int ProfileManager::ExportChromeTrace(const std::wstring& path)
+	{
+		std::ofstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file) {
+			return -1;
+		}
+		UpdateCalibration();
+		//時刻はマイクロ秒で書く
+		auto to_microseconds = [this](int64_t ticks) {
+			return TicksToMilliseconds(ticks - start_time) * 1000.0;
+			};
+
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first_event = true;
+		auto separator = [&]() {
+			if (!first_event)
+				file << ",\n";
+			first_event = false;
+			};
+
+		std::vector<ProfileEvent> events;
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		for (auto& buffer : buffers) {
+			if (buffer->thread_name) {
+				separator();
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->lane << ",\"args\":{\"name\":";
+				WriteJsonString(file, buffer->thread_name);
+				file << "}}";
+			}
+			events.clear();
+			CopyEvents(*buffer, 0, buffer->write_index.load(std::memory_order_acquire), events);
+			for (const ProfileEvent& event : events) {
+				separator();
+				file << "{\"name\":";
+				WriteJsonString(file, event.name);
+				if (event.type == ProfileEvent::Type::Zone) {
+					file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->lane
+						<< ",\"ts\":" << to_microseconds(event.begin)
+						<< ",\"dur\":" << TicksToMilliseconds(event.value - event.begin) * 1000.0 << "}";
+				}
+				else {
+					file << ",\"ph\":\"C\",\"pid\":1,\"tid\":" << buffer->lane
+						<< ",\"ts\":" << to_microseconds(event.begin)
+						<< ",\"args\":{\"value\":" << event.value << "}}";
+				}
+			}
+		}
+		file << "\n]}\n";
+		return file ? 0 : -1;
+	}
+}
@@ -0,0 +1,234 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+//計測用のマクロを全て空にする場合は、0を定義しておく
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief プロファイラーに記録する1件分のデータ
+	// @details nameは文字列リテラルなど、プログラムの終了まで残る文字列だけを渡すこと(ポインタのまま保存するため)
+	//-------------------------------------------------------------
+	struct ProfileEvent {
+		enum class Type : uint8_t {
+			Zone,		// 区間。beginからvalueまで
+			Counter,	// 値。beginの時点でvalue
+		};
+		const char* name = nullptr;
+		int64_t begin = 0;
+		int64_t value = 0;
+		uint16_t depth = 0;	// 区間の入れ子の深さ
+		Type type = Type::Zone;
+	};
+
+	//-------------------------------------------------------------
+	// @brief スレッド毎のリングバッファ
+	// @details 書き込むのは持ち主のスレッドだけなので、ロックは要らない。
+	//			書き込み位置をreleaseで公開し、読む側はacquireで読んでから中身をコピーする。
+	//			コピーした後にもう一度書き込み位置を読み、その間に上書きされた可能性がある分は捨てる。
+	//			一杯になったら古いものから上書きする
+	//-------------------------------------------------------------
+	class ProfileThreadBuffer
+	{
+	public:
+		static constexpr size_t CAPACITY = 1 << 14;	// 2の累乗にしておくこと
+
+		std::array<ProfileEvent, CAPACITY> events;
+		std::atomic<uint64_t> write_index = 0;
+		uint64_t aggregate_index = 0;	// EndFrameで集計済みの位置。メインスレッドだけが触る
+		uint32_t lane = 0;				// トレース上の行番号(スレッドが終わったバッファは、次のスレッドが同じ行で使い回す)
+		uint16_t depth = 0;
+		const char* thread_name = nullptr;
+
+		void Push(const ProfileEvent& event) {
+			uint64_t index = write_index.load(std::memory_order_relaxed);
+			events[index & (CAPACITY - 1)] = event;
+			write_index.store(index + 1, std::memory_order_release);
+		}
+	};
+
+	// @brief スレッドが終わる時に、使っていたバッファをProfileManagerに返すためのもの
+	struct ProfileThreadBufferHolder {
+		ProfileThreadBuffer* buffer = nullptr;
+		~ProfileThreadBufferHolder();
+	};
+
+	//-------------------------------------------------------------
+	// @brief CPU側の処理時間を計測するマネージャー
+	// @details PROFILE_ZONEなどのマクロで区間を記録し、EndFrameでフレーム毎に集計する。
+	//			記録した区間はChromeのトレース形式(chrome://tracing、Perfettoで開ける)で書き出せる
+	//-------------------------------------------------------------
+	class ProfileManager
+	{
+	public:
+		// @brief 1フレーム分の、区間毎の集計
+		struct ZoneStats {
+			std::string_view name;
+			double total_ms = 0.0;
+			unsigned int call_count = 0;
+		};
+		// @brief 1フレーム分の、カウンター毎の最後の値
+		struct CounterStats {
+			std::string_view name;
+			int64_t value = 0;
+		};
+
+	private:
+		ProfileManager();
+
+		std::mutex buffers_mutex;	// スレッドの登録と、バッファの一覧を読む時だけ使う
+		std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+		std::vector<ProfileThreadBuffer*> free_buffers;	// スレッドが終わって空いたバッファ
+
+		int64_t start_time = 0;
+		int64_t frame_begin_time = 0;
+		//Nowの刻み(TSC)を時間に直すための較正。起動時のTSCと時計の組と、今の組の比から求める
+		int64_t calibration_ticks = 0;
+		std::chrono::steady_clock::time_point calibration_time;
+		double milliseconds_per_tick = 0.0;
+		void UpdateCalibration();
+		std::vector<ZoneStats> last_frame_zones;
+		std::vector<CounterStats> last_frame_counters;
+		std::unordered_map<std::string_view, size_t> zone_indices;
+		std::unordered_map<std::string_view, size_t> counter_indices;
+		std::vector<ProfileEvent> aggregate_events;	// EndFrameで集計する分のコピー。フレーム毎に確保しないように使い回す
+
+		ProfileThreadBuffer* AcquireThreadBuffer();
+		void ReleaseThreadBuffer(ProfileThreadBuffer* buffer);
+
+		friend struct ProfileThreadBufferHolder;
+		static inline thread_local ProfileThreadBufferHolder thread_buffer_holder;
+
+		// @brief バッファの[first, last)のうち、上書きされていない分だけコピーする
+		static void CopyEvents(const ProfileThreadBuffer& buffer, uint64_t first, uint64_t last, std::vector<ProfileEvent>& out_events);
+
+	public:
+		static ProfileManager* Instance();
+
+		//-------------------------------------------------------------
+		// @brief 今の時刻。単位はCPUのタイムスタンプカウンター(TSC)の刻み
+		// @details steady_clock(Windowsの場合はQueryPerformanceCounter)は1回で数十nsかかることがあり、
+		//			区間1つで2回読むと計測自体が重くなるので、TSCを直接読む。時間への換算はTicksToMillisecondsで行う
+		//-------------------------------------------------------------
+		static int64_t Now() {
+			return static_cast<int64_t>(__rdtsc());
+		}
+		// @brief Nowの刻みの差をミリ秒に直す(直前のEndFrameかExportChromeTraceで較正した値を使う)
+		double TicksToMilliseconds(int64_t ticks) const {
+			return static_cast<double>(ticks) * milliseconds_per_tick;
+		}
+		double GetMillisecondsPerTick() const { return milliseconds_per_tick; }
+
+		// @brief 呼び出したスレッドのバッファ。初めて呼ばれた時に登録する
+		static ProfileThreadBuffer* GetThreadBuffer() {
+			ProfileThreadBuffer* buffer = thread_buffer_holder.buffer;
+			if (!buffer) {
+				buffer = Instance()->AcquireThreadBuffer();
+				thread_buffer_holder.buffer = buffer;
+			}
+			return buffer;
+		}
+
+		// @brief 呼び出したスレッドに、トレース上で表示する名前を付ける
+		static void SetThreadName(const char* name) { GetThreadBuffer()->thread_name = name; }
+
+		//-------------------------------------------------------------
+		// @brief スレッドに結び付かない、トレース上の行を1つ用意する
+		// @details GPUの区間のように、CPUのスレッドとは別の行に並べたいものに使う。
+		//			書き込むのは1つのスレッドからだけにすること(スレッド毎のバッファと同じく、ロックしないため)
+		//-------------------------------------------------------------
+		ProfileThreadBuffer* AcquireLane(const char* name) {
+			ProfileThreadBuffer* lane = AcquireThreadBuffer();
+			lane->thread_name = name;
+			return lane;
+		}
+		// @brief AcquireLaneで用意した行を返す
+		void ReleaseLane(ProfileThreadBuffer* lane) {
+			if (lane) ReleaseThreadBuffer(lane);
+		}
+
+		// @brief カウンターの値を記録する
+		static void Counter(const char* name, int64_t value) {
+			ProfileEvent event;
+			event.name = name;
+			event.begin = Now();
+			event.value = value;
+			event.type = ProfileEvent::Type::Counter;
+			GetThreadBuffer()->Push(event);
+		}
+
+		//-------------------------------------------------------------
+		// @brief 前回のEndFrameから今までに記録された区間とカウンターを集計する
+		// @details メインスレッドから、フレームの終わりに1回呼ぶこと。フレーム全体も"Frame"という区間として記録する
+		//-------------------------------------------------------------
+		void EndFrame();
+		const std::vector<ZoneStats>& GetLastFrameZones() const { return last_frame_zones; }
+		const std::vector<CounterStats>& GetLastFrameCounters() const { return last_frame_counters; }
+
+		//-------------------------------------------------------------
+		// @brief バッファに残っている全ての区間とカウンターを、Chromeのトレース形式で書き出す
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int ExportChromeTrace(const std::wstring& path);
+	};
+
+	//-------------------------------------------------------------
+	// @brief スコープを抜けるまでの時間を区間として記録する
+	//-------------------------------------------------------------
+	class ProfileZone
+	{
+	private:
+		ProfileThreadBuffer* buffer;
+		const char* name;
+		int64_t begin;
+		uint16_t depth;
+	public:
+		explicit ProfileZone(const char* name_) :buffer(ProfileManager::GetThreadBuffer()), name(name_) {
+			depth = buffer->depth++;
+			begin = ProfileManager::Now();
+		}
+		~ProfileZone() {
+			ProfileEvent event;
+			event.name = name;
+			event.begin = begin;
+			event.value = ProfileManager::Now();
+			event.depth = depth;
+			event.type = ProfileEvent::Type::Zone;
+			buffer->depth--;
+			buffer->Push(event);
+		}
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+// @brief スコープの終わりまでを、nameという区間として記録する
+#define PROFILE_ZONE(name) System::ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+// @brief スコープの終わりまでを、関数名の区間として記録する
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+// @brief カウンターの値を記録する
+#define PROFILE_COUNTER(name, value) System::ProfileManager::Counter(name, static_cast<int64_t>(value))
+// @brief 呼び出したスレッドに名前を付ける
+#define PROFILE_THREAD(name) System::ProfileManager::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,239 @@
+﻿#include "ResourceManager.h"
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/TextureTools/TextureStreamer/TextureStreamer.h"
+
+namespace System {
+
+	ResourceManager* ResourceManager::Instance()
+	{
+		static ResourceManager manager;
+		return &manager;
+	}
+
+	int ResourceManager::Initialize(uint64_t streaming_budget_bytes)
+	{
+		if (load_worker.joinable()) {
+			return 0;
+		}
+		//別スレッドの読み込みは、起動時の転送ともストリーミングとも別のキューで行う
+		ID3D12Device* device = DirectX12Manager::Instance()->GetDevice();
+		load_queue = std::make_unique<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+		load_context = std::make_unique<ID3D12DeviceContext>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+		if (!load_queue->IsValid() || !load_context->IsValid()) {
+			return -1;
+		}
+		streamer = std::make_unique<TextureStreamer>(streaming_budget_bytes);
+		if (!streamer->IsValid()) {
+			return -1;
+		}
+		stop_requested = false;
+		load_worker = std::thread(&ResourceManager::LoadWorkerMain, this);
+		return 0;
+	}
+
+	int ResourceManager::Finalize()
+	{
+		{
+			std::lock_guard<std::mutex> lock(load_mutex);
+			stop_requested = true;
+			load_jobs.clear();
+		}
+		load_added.notify_all();
+		if (load_worker.joinable()) {
+			load_worker.join();
+		}
+		load_results.clear();
+		loads_in_flight = 0;
+		//描画中のフレームが使い終わるのを待ってから、全て破棄する
+		if (CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue()) {
+			draw_queue->WaitForCompletionAll();
+		}
+		//ストリーマーはテクスチャのポインタを持っているので、テクスチャより先に止める
+		streamer.reset();
+		textures.Clear([](uint32_t, Texture*) {});
+		stream_ids.clear();
+		load_context.reset();
+		load_queue.reset();
+		return 0;
+	}
+
+	uint64_t ResourceManager::GetRetireFenceValue() const
+	{
+		//今記録しているフレームは、まだシグナルしていない次の値で完了する
+		return DirectX12Manager::Instance()->GetDrawQueue()->GetLastSignaledValue() + 1;
+	}
+
+	void ResourceManager::OnDestroyTexture(uint32_t index)
+	{
+		if (index < stream_ids.size() && stream_ids[index] != INVALID_STREAM_ID) {
+			streamer->Unregister(stream_ids[index]);
+			stream_ids[index] = INVALID_STREAM_ID;
+		}
+	}
+
+	TextureHandle ResourceManager::LoadTexture(const std::wstring& path, LoadMode mode)
+	{
+		PROFILE_FUNCTION();
+		bool created = false;
+		TextureHandle handle = textures.Acquire(path, created);
+		if (!created) {
+			return handle;
+		}
+		if (stream_ids.size() <= handle.index) {
+			stream_ids.resize(handle.index + 1, INVALID_STREAM_ID);
+		}
+		stream_ids[handle.index] = INVALID_STREAM_ID;
+
+		std::wstring extension = std::filesystem::path(path).extension().wstring();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+		if (mode == LoadMode::Streamed) {
+			//ストリーミングできるのはクック済みのDDSだけ。それ以外は別スレッドでまとめて読む
+			mode = LoadMode::Async;
+			if (extension == L".dds" && streamer) {
+				std::unique_ptr<Texture> texture;
+				unsigned int id = 0;
+				HRESULT hr = streamer->Register(path, texture, id);
+				if (SUCCEEDED(hr)) {
+					stream_ids[handle.index] = id;
+					textures.SetLoaded(handle, texture);
+					return handle;
+				}
+				if (hr != E_NOTIMPL) {
+					textures.SetFailed(handle);
+					return handle;
+				}
+			}
+		}
+
+		if (mode == LoadMode::Async && load_worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(load_mutex);
+				load_jobs.push_back({ handle, path });
+			}
+			loads_in_flight++;
+			load_added.notify_one();
+			return handle;
+		}
+
+		std::unique_ptr<Texture> texture = Texture::Loader::LoadFromFile(path);
+		if (texture && texture->IsValid()) {
+			textures.SetLoaded(handle, texture);
+		}
+		else {
+			textures.SetFailed(handle);
+		}
+		return handle;
+	}
+
+	void ResourceManager::Release(TextureHandle& handle)
+	{
+		textures.Release(handle, GetRetireFenceValue());
+		handle = {};
+	}
+
+	void ResourceManager::RequestScreenSize(TextureHandle handle, float screen_size)
+	{
+		if (!textures.IsAlive(handle) || handle.index >= stream_ids.size() || stream_ids[handle.index] == INVALID_STREAM_ID) {
+			return;
+		}
+		streamer->RequestScreenSize(stream_ids[handle.index], screen_size);
+	}
+
+	void ResourceManager::FinishLoads(std::vector<LoadResult>& results)
+	{
+		for (LoadResult& result : results) {
+			loads_in_flight--;
+			if (FAILED(result.hr)) {
+				textures.SetFailed(result.handle);
+				continue;
+			}
+			//読み込んでいる間に参照が無くなっていれば、GPUはまだ使っていないので、そのまま捨てる
+			if (!textures.IsAlive(result.handle)) {
+				continue;
+			}
+			std::unique_ptr<Texture> texture = Texture::Loader::CreateFromResource(result.resource);
+			if (!texture || !texture->IsValid()) {
+				textures.SetFailed(result.handle);
+				continue;
+			}
+			textures.SetLoaded(result.handle, texture);
+		}
+		results.clear();
+	}
+
+	uint64_t ResourceManager::GetTextureViewRevision() const
+	{
+		return streamer ? streamer->GetViewRevision() : 0;
+	}
+
+	int ResourceManager::WaitForTextures()
+	{
+		PROFILE_FUNCTION();
+		while (loads_in_flight > 0) {
+			std::vector<LoadResult> results;
+			{
+				std::unique_lock<std::mutex> lock(load_mutex);
+				load_finished.wait(lock, [this] { return !load_results.empty(); });
+				results.swap(load_results);
+			}
+			FinishLoads(results);
+		}
+		return 0;
+	}
+
+	int ResourceManager::Update()
+	{
+		PROFILE_FUNCTION();
+		if (loads_in_flight > 0) {
+			std::vector<LoadResult> results;
+			{
+				std::lock_guard<std::mutex> lock(load_mutex);
+				results.swap(load_results);
+			}
+			FinishLoads(results);
+		}
+		if (streamer && streamer->Update() != 0) {
+			return -1;
+		}
+		//GPUが通過したフレームまでに参照が無くなったテクスチャを破棄する
+		uint64_t completed = DirectX12Manager::Instance()->GetDrawQueue()->GetCompletedValue();
+		textures.CollectRetired(completed, [this](uint32_t index, Texture*) { OnDestroyTexture(index); });
+		PROFILE_COUNTER("TextureCount", textures.GetAliveCount());
+		return 0;
+	}
+
+	void ResourceManager::LoadWorkerMain()
+	{
+		PROFILE_THREAD("ResourceLoader");
+		//WICでの画像の読み込みにCOMを使う
+		HRESULT com_result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		while (true) {
+			LoadJob job;
+			{
+				std::unique_lock<std::mutex> lock(load_mutex);
+				load_added.wait(lock, [this] { return stop_requested || !load_jobs.empty(); });
+				if (stop_requested) {
+					break;
+				}
+				job = std::move(load_jobs.front());
+				load_jobs.pop_front();
+			}
+			LoadResult result;
+			result.handle = job.handle;
+			result.hr = Texture::Loader::CreateResourceFromFile(job.path, D3D12_RESOURCE_FLAG_NONE, true, result.resource,
+				load_context.get(), load_queue.get());
+			{
+				std::lock_guard<std::mutex> lock(load_mutex);
+				load_results.push_back(std::move(result));
+			}
+			load_finished.notify_all();
+		}
+		if (SUCCEEDED(com_result)) {
+			CoUninitialize();
+		}
+	}
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "System/SystemUtils/Asset/AssetRegistry/AssetRegistry.h"
+
+namespace System {
+	class Texture;
+	class TextureStreamer;
+	class CommandQueue;
+	class ID3D12DeviceContext;
+
+	using TextureHandle = AssetHandle<Texture>;
+
+	//-------------------------------------------------------------
+	// @brief リソースマネージャー
+	// @brief テクスチャなどのアセットを、パス毎に1つだけ読み込んで共有するクラス
+	// @details ・同じパスを何度読んでも、GPUのリソースとSRVは1つだけ作り、同じハンドルを返す(参照カウントが増える)
+	//			・Releaseで参照が無くなったテクスチャは、今のフレームのコマンドが終わったことを描画キューのフェンスで確かめてから破棄する
+	//			・読み方は3通り。その場で読む・別スレッドで読む・ストリーミングする(クック済みのDDSだけ)
+	//			・別スレッドの読み込みは、専用のコピーキューでリソースの転送まで済ませ、SRVはUpdateでメインスレッドが作る
+	//			  (ディスクリプタヒープは複数のスレッドから確保できないため)
+	//			CSUHeapは解放できないので、破棄したテクスチャのディスクリプタは空いたままになる
+	//-------------------------------------------------------------
+	class ResourceManager
+	{
+	public:
+		enum class LoadMode {
+			Immediate,	// その場で読み込み、転送の完了まで待つ
+			Async,		// 別スレッドで読み込む。UpdateかWaitForTexturesで使えるようになる
+			Streamed,	// 末尾のミップだけをその場で読み込み、細かいミップは画面上の大きさに応じて読む(DDS以外はAsyncと同じ)
+		};
+		static constexpr unsigned int INVALID_STREAM_ID = 0xffffffff;
+
+	private:
+		ResourceManager() = default;
+
+		AssetRegistry<Texture> textures;
+		std::vector<unsigned int> stream_ids;	// スロット毎の、TextureStreamerの番号。ストリーミングしないものはINVALID_STREAM_ID
+		std::unique_ptr<TextureStreamer> streamer;
+
+		// @brief 別スレッドでの読み込みの指示と結果
+		struct LoadJob {
+			TextureHandle handle;
+			std::wstring path;
+		};
+		struct LoadResult {
+			TextureHandle handle;
+			ComPtr<ID3D12Resource> resource;
+			HRESULT hr = E_FAIL;
+		};
+		std::unique_ptr<CommandQueue> load_queue;
+		std::unique_ptr<ID3D12DeviceContext> load_context;
+		std::thread load_worker;
+		std::mutex load_mutex;
+		std::condition_variable load_added;
+		std::condition_variable load_finished;
+		std::deque<LoadJob> load_jobs;
+		std::vector<LoadResult> load_results;
+		unsigned int loads_in_flight = 0;	// 積んだが、結果をまだ受け取っていない数(メインスレッドだけが触る)
+		bool stop_requested = false;
+
+		void LoadWorkerMain();
+		// @brief 別スレッドで転送し終わったリソースに、SRVを作ってハンドルに渡す
+		void FinishLoads(std::vector<LoadResult>& results);
+		// @brief 今記録しているフレームのコマンドが完了した時の、描画キューのフェンス値
+		uint64_t GetRetireFenceValue() const;
+		void OnDestroyTexture(uint32_t index);
+
+	public:
+		static ResourceManager* Instance();
+
+		// @param [in] streaming_budget_bytes ストリーミングするテクスチャの、VRAMの予算
+		int Initialize(uint64_t streaming_budget_bytes);
+		// @brief 読み込み中のものを止め、全てのテクスチャを破棄する。DirectX12Managerより先に呼ぶこと
+		int Finalize();
+
+		//-------------------------------------------------------------
+		// @brief 別スレッドで読み終わったテクスチャを使えるようにし、ストリーミングを進め、破棄待ちのテクスチャを破棄する
+		// @details 1フレームに1回、描画のコマンドを積み始める前に呼ぶこと
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int Update();
+
+		//-------------------------------------------------------------
+		// @brief テクスチャを読み込む。同じパスが読み込み済み(読み込み中を含む)なら、同じハンドルを返す
+		// @details 返したハンドルは、使い終わったらReleaseすること。同じパスは最初に読んだ時の読み方になる
+		//			読み込みに失敗した場合も、ハンドルは返す(GetTextureStateがFailedになる)
+		//-------------------------------------------------------------
+		TextureHandle LoadTexture(const std::wstring& path, LoadMode mode = LoadMode::Immediate);
+		// @brief 参照を1つ増やす(ハンドルを別の持ち主に渡す時)
+		bool AddRef(TextureHandle handle) { return textures.AddRef(handle); }
+		// @brief 参照を1つ減らし、ハンドルを無効にする
+		void Release(TextureHandle& handle);
+
+		// @brief 使えるテクスチャ。読み込み中・失敗・破棄済みならnullptr
+		Texture* GetTexture(TextureHandle handle) const { return textures.Get(handle); }
+		AssetState GetTextureState(TextureHandle handle) const { return textures.GetState(handle); }
+		// @brief 別スレッドで読んでいるテクスチャが、全て使えるようになるまで待つ
+		int WaitForTextures();
+
+		// @brief このフレームで、テクスチャが画面上でscreen_sizeピクセルの大きさに描かれることを伝える(ストリーミングするものだけ)
+		void RequestScreenSize(TextureHandle handle, float screen_size);
+		// @brief ストリーミングでテクスチャのSRVが切り替わる度に増える値。変わっていたら、ディスクリプタの番号を読み直すこと
+		uint64_t GetTextureViewRevision() const;
+
+		size_t GetTextureCount() const { return textures.GetAliveCount(); }
+	};
+}
@@ -130,6 +130,11 @@ namespace System {
 		for (int i = 0; i < BACK_BUFFER_COUNT; i++)
 			back_buffers[i].reset();
 		DirectX12Manager::Instance()->GetDrawQueue()->WaitForCompletionAll();
+		if (headless) {
+			swap_chain_desc.Width = width;
+			swap_chain_desc.Height = height;
+			return CreateHeadlessBackBuffers();
+		}
 		HRESULT hr = swap_chain->ResizeBuffers(BACK_BUFFER_COUNT, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING);		// スワップチェインのバッファをリサイズする。
 		if (FAILED(hr))
 			return hr;
@@ -159,6 +164,11 @@ namespace System {
 		//モニターのリフレッシュレートに合わせて自動的にフルスクリーンとウィンドウモードを切り替えることを許可するフラグを設定
 		swap_chain_desc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
 
+		//ヘッドレスモードでは、スワップチェインの設定だけを残して、バックバッファは自前で作る
+		if (headless) {
+			return CreateHeadlessBackBuffers();
+		}
+
 		IDXGIFactory6* factory = DirectX12Manager::Instance()->GetFactory();	// DirectX12のファクトリーを取得
 		CommandQueue* command_queue = DirectX12Manager::Instance()->GetDrawQueue();	// コマンドキューを取得
 		ID3D12CommandQueue* d3d_command_queue = command_queue->GetCommandQueue();	// コマンドキューのD3D12インターフェースを取得
@@ -218,8 +228,47 @@ namespace System {
 		return 0;
 	}
 
+	int WindowManager::CreateHeadlessBackBuffers()
+	{
+		D3D12_HEAP_PROPERTIES heap_properties = {};
+		heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+		D3D12_RESOURCE_DESC desc = TEX2D_DESC(swap_chain_desc.Width, swap_chain_desc.Height, swap_chain_desc.Format, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		D3D12_CLEAR_VALUE clear_value = {};
+		clear_value.Format = swap_chain_desc.Format;
+
+		for (unsigned int i = 0; i < BACK_BUFFER_COUNT; i++) {
+			ComPtr<ID3D12Resource> back_buffer;
+			//スワップチェインのバックバッファと同じく、PRESENT(=COMMON)状態で作っておく
+			//描画側はPRESENTからRENDER_TARGETへの遷移を前提にしているので、そのまま使える
+			HRESULT hr = DirectX12Manager::Instance()->GetDevice()->CreateCommittedResource(
+				&heap_properties, D3D12_HEAP_FLAG_NONE, &desc,
+				D3D12_RESOURCE_STATE_PRESENT, &clear_value,
+				IID_PPV_ARGS(back_buffer.GetAddressOf()));
+			if (FAILED(hr)) {
+				return -1;
+			}
+			back_buffer->SetName(L"HeadlessBackBuffer");
+
+			D3D12_RENDER_TARGET_VIEW_DESC rtv_desc = {};
+			rtv_desc.Format = swap_chain_desc.Format;
+			rtv_desc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
+			std::unique_ptr<RenderTargetView> rtv = DirectX12Manager::Instance()->CreateRenderTargetView(back_buffer.Get(), &rtv_desc);
+			if (rtv == nullptr) {
+				return -1;
+			}
+			auto srv = DirectX12Manager::Instance()->CreateShaderResourceView(back_buffer.Get(), nullptr);
+			back_buffers[i] = std::make_unique<Texture>(back_buffer, std::move(srv), std::move(rtv), nullptr);
+		}
+		headless_back_buffer_index = 0;
+		return 0;
+	}
+
 
 	int WindowManager::Initialize() {
+		//ヘッドレスモードではウィンドウを作らない
+		if (headless)
+			return 0;
 		if (CreateMainWindow() != 0) {		// メインウィンドウの作成に失敗したら、失敗を示す -1 を返す
 			return -1;
 		}
@@ -227,6 +276,8 @@ namespace System {
 		return 0;
 	}
 	int WindowManager::Finalize() {
+		if (headless)
+			return 0;
 
 		UnregisterClass(window_class_name.c_str(), GetModuleHandle(NULL));		// ウィンドウクラスの登録を解除する
 		return 0;
@@ -27,6 +27,12 @@ namespace System {
 		static constexpr unsigned int BACK_BUFFER_COUNT = 3;
 		std::array<std::unique_ptr<Texture>, BACK_BUFFER_COUNT> back_buffers;
 
+		// ヘッドレスモードでは、ウィンドウとスワップチェインを作らず、自前で作ったテクスチャをバックバッファとして使う
+		// ディスプレイの無いWindowsのマシン(リモートのセッションなど)で、描画処理をそのまま通して計測するためのもの
+		bool headless = false;
+		unsigned int headless_back_buffer_index = 0;	// スワップチェインの代わりに、現在のバックバッファの番号を管理する
+		int CreateHeadlessBackBuffers();
+
 		static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 		static inline std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)> CustomWindowProc = nullptr;		// カスタムウィンドウプロシージャを設定するための関数オブジェクト。これを設定すると、デフォルトのウィンドウプロシージャの代わりに、カスタムウィンドウプロシージャが呼び出されるようになる。
 	public:
@@ -49,6 +55,18 @@ namespace System {
 			this->window_width = width;
 			this->window_height = height;
 		}
+		//-------------------------------------------------------------
+		// @brief ヘッドレスモードを設定する関数
+		//
+		// @param [in] enable trueならウィンドウとスワップチェインを作らず、オフスクリーンのバックバッファに描画する
+		// @warning SetWindowInfoと同じく、ウィンドウの作成前に設定する必要がある
+		//-------------------------------------------------------------
+		void SetHeadless(bool enable) {
+			if (window_handle || swap_chain)
+				return;
+			headless = enable;
+		}
+		bool IsHeadless() const { return headless; }
 		void SetCustomWindowProc(std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)>&& custom_proc) {
 			CustomWindowProc = std::move(custom_proc);
 		}
@@ -66,6 +84,8 @@ namespace System {
 
 		IDXGISwapChain4* GetSwapChain() const { return swap_chain.Get(); }
 		Texture* GetCurrentBackBuffer() const {
+			if (headless)
+				return back_buffers[headless_back_buffer_index].get();
 			UINT back_buffer_index = swap_chain->GetCurrentBackBufferIndex();		// 現在のバックバッファのインデックスを取得
 			return back_buffers[back_buffer_index].get();
 		}
@@ -84,6 +104,11 @@ namespace System {
 		int Finalize();
 
 		int ScreenFlip(unsigned int sync_interval = 0) {
+			if (headless) {
+				// 表示先が無いので、次のバックバッファに切り替えるだけ
+				headless_back_buffer_index = (headless_back_buffer_index + 1) % BACK_BUFFER_COUNT;
+				return 0;
+			}
 			if (!swap_chain)
 				return -1;		// スワップチェインが存在しない場合は、失敗を示す -1 を返す
 			HRESULT hr = swap_chain->Present(sync_interval, 0);		// 垂直同期なしで画面を更新する
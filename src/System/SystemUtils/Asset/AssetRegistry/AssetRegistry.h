@@ -0,0 +1,251 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <cwctype>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief アセットを指すハンドル
+	// @details スロットの番号と世代の組。アセットが破棄されるとスロットの世代が進むので、
+	//			古いハンドルで引いても別のアセットが返ることは無い(nullptrになる)。世代0は無効なハンドルに使う
+	//-------------------------------------------------------------
+	template<class T>
+	struct AssetHandle {
+		uint32_t index = 0;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return generation != 0; }
+		bool operator==(const AssetHandle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const AssetHandle& other) const { return !(*this == other); }
+	};
+
+	// @brief アセットの読み込み状態
+	enum class AssetState {
+		Loading,	// 読み込み中(別スレッドで読んでいるもの)
+		Ready,		// 使える
+		Failed,		// 読み込みに失敗した
+	};
+
+	//-------------------------------------------------------------
+	// @brief パスで重複を省き、参照カウントで寿命を管理するアセットの一覧
+	// @details ・Acquireで同じパスを2回読もうとすると、同じハンドルを返して参照カウントを増やす
+	//			・参照カウントが0になったアセットは、すぐには破棄しない。Releaseに渡したフェンス値を
+	//			  GPUが通過したら(CollectRetiredに完了したフェンス値を渡したら)破棄する
+	//			・デバイスには触らないので、フェンス値を自分で進めればデバイス無しで動かせる
+	//			スレッドセーフではない。メインスレッドだけで使うこと
+	//-------------------------------------------------------------
+	template<class T>
+	class AssetRegistry
+	{
+	public:
+		using Handle = AssetHandle<T>;
+
+	private:
+		struct Slot {
+			std::unique_ptr<T> asset;
+			std::wstring path;
+			uint64_t path_hash = 0;
+			uint32_t generation = 1;
+			uint32_t ref_count = 0;
+			AssetState state = AssetState::Loading;
+			bool alive = false;	// 参照されている間だけtrue。破棄待ちの間はfalse
+		};
+		// @brief 参照が無くなり、GPUの完了を待っているスロット
+		struct Retired {
+			uint32_t index = 0;
+			uint64_t fence_value = 0;
+		};
+
+		std::vector<Slot> slots;
+		std::vector<uint32_t> free_slots;
+		std::unordered_multimap<uint64_t, uint32_t> path_lookup;	// パスのハッシュからスロットを引く(衝突した場合はパスを比べる)
+		std::deque<Retired> retired;	// フェンス値の小さい順
+
+		const Slot* GetSlot(Handle handle) const {
+			if (handle.index >= slots.size()) return nullptr;
+			const Slot& slot = slots[handle.index];
+			if (!slot.alive || slot.generation != handle.generation) return nullptr;
+			return &slot;
+		}
+		Slot* GetSlot(Handle handle) {
+			return const_cast<Slot*>(static_cast<const AssetRegistry*>(this)->GetSlot(handle));
+		}
+
+	public:
+		//-------------------------------------------------------------
+		// @brief パスのハッシュ(FNV-1a)
+		// @details 大文字と小文字、'\\'と'/'の違いは同じパスとして扱う
+		//-------------------------------------------------------------
+		static uint64_t HashPath(const std::wstring& path) {
+			uint64_t hash = 14695981039346656037ull;
+			for (wchar_t c : path) {
+				wchar_t normalized = c == L'\\' ? L'/' : static_cast<wchar_t>(std::towlower(c));
+				hash ^= static_cast<uint64_t>(normalized);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+		// @brief HashPathと同じ正規化で、2つのパスが同じかどうか
+		static bool IsSamePath(const std::wstring& a, const std::wstring& b) {
+			if (a.size() != b.size()) return false;
+			for (size_t i = 0; i < a.size(); i++) {
+				wchar_t ca = a[i] == L'\\' ? L'/' : static_cast<wchar_t>(std::towlower(a[i]));
+				wchar_t cb = b[i] == L'\\' ? L'/' : static_cast<wchar_t>(std::towlower(b[i]));
+				if (ca != cb) return false;
+			}
+			return true;
+		}
+
+		// @brief 読み込み済み(または読み込み中)のアセットを、パスで探す。参照カウントは増やさない
+		Handle Find(const std::wstring& path) const {
+			auto range = path_lookup.equal_range(HashPath(path));
+			for (auto it = range.first; it != range.second; ++it) {
+				const Slot& slot = slots[it->second];
+				if (IsSamePath(slot.path, path))
+					return { it->second, slot.generation };
+			}
+			return {};
+		}
+
+		//-------------------------------------------------------------
+		// @brief パスのアセットの参照を1つ増やす。まだ無ければ、読み込み中のスロットを作る
+		// @param [out] out_created 新しく作ったならtrue(呼び出し側が読み込んで、SetLoadedかSetFailedを呼ぶこと)
+		//-------------------------------------------------------------
+		Handle Acquire(const std::wstring& path, bool& out_created) {
+			Handle handle = Find(path);
+			if (handle.IsValid()) {
+				slots[handle.index].ref_count++;
+				out_created = false;
+				return handle;
+			}
+			uint32_t index = 0;
+			if (!free_slots.empty()) {
+				index = free_slots.back();
+				free_slots.pop_back();
+			}
+			else {
+				index = static_cast<uint32_t>(slots.size());
+				slots.emplace_back();
+			}
+			Slot& slot = slots[index];
+			slot.path = path;
+			slot.path_hash = HashPath(path);
+			slot.ref_count = 1;
+			slot.state = AssetState::Loading;
+			slot.alive = true;
+			path_lookup.emplace(slot.path_hash, index);
+			out_created = true;
+			return { index, slot.generation };
+		}
+
+		// @brief 参照を1つ増やす(ハンドルを別の持ち主にコピーする時)
+		bool AddRef(Handle handle) {
+			Slot* slot = GetSlot(handle);
+			if (!slot) return false;
+			slot->ref_count++;
+			return true;
+		}
+
+		//-------------------------------------------------------------
+		// @brief 参照を1つ減らす。0になったら、パスで引けないようにして破棄待ちにする
+		// @param [in] retire_fence_value このフェンス値をGPUが通過したら破棄してよい(このフレームのコマンドが終わる値を渡す)
+		// @return 破棄待ちにしたらtrue
+		//-------------------------------------------------------------
+		bool Release(Handle handle, uint64_t retire_fence_value) {
+			Slot* slot = GetSlot(handle);
+			if (!slot || slot->ref_count == 0) return false;
+			if (--slot->ref_count > 0) return false;
+			slot->alive = false;
+			auto range = path_lookup.equal_range(slot->path_hash);
+			for (auto it = range.first; it != range.second; ++it) {
+				if (it->second == handle.index) {
+					path_lookup.erase(it);
+					break;
+				}
+			}
+			//フェンス値は増えていくだけなので、後ろに積めば小さい順のまま
+			retired.push_back({ handle.index, retire_fence_value });
+			return true;
+		}
+
+		//-------------------------------------------------------------
+		// @brief GPUが通過したフェンス値までの破棄待ちを破棄し、スロットを空ける
+		// @param [in] on_destroy 破棄する直前に(スロットの番号, アセット)で呼ばれる。アセットはnullptrのこともある
+		// @return 破棄した数
+		//-------------------------------------------------------------
+		template<class OnDestroy>
+		size_t CollectRetired(uint64_t completed_fence_value, OnDestroy&& on_destroy) {
+			size_t count = 0;
+			while (!retired.empty() && retired.front().fence_value <= completed_fence_value) {
+				uint32_t index = retired.front().index;
+				retired.pop_front();
+				Slot& slot = slots[index];
+				on_destroy(index, slot.asset.get());
+				slot.asset.reset();
+				slot.path.clear();
+				slot.state = AssetState::Loading;
+				//世代を進めて、古いハンドルを無効にする(0は無効なハンドルなので飛ばす)
+				if (++slot.generation == 0)
+					slot.generation = 1;
+				free_slots.push_back(index);
+				count++;
+			}
+			return count;
+		}
+		size_t CollectRetired(uint64_t completed_fence_value) {
+			return CollectRetired(completed_fence_value, [](uint32_t, T*) {});
+		}
+
+		//-------------------------------------------------------------
+		// @brief 読み込みが終わったアセットを渡す
+		// @details 読み込み中に参照が無くなっていた場合(破棄待ちか、既に破棄された場合)はfalseを返し、assetは受け取らない
+		//-------------------------------------------------------------
+		bool SetLoaded(Handle handle, std::unique_ptr<T>& asset) {
+			Slot* slot = GetSlot(handle);
+			if (!slot) return false;
+			slot->asset = std::move(asset);
+			slot->state = AssetState::Ready;
+			return true;
+		}
+		bool SetFailed(Handle handle) {
+			Slot* slot = GetSlot(handle);
+			if (!slot) return false;
+			slot->state = AssetState::Failed;
+			return true;
+		}
+
+		// @brief 読み込み済みのアセット。読み込み中・失敗・無効なハンドルならnullptr
+		T* Get(Handle handle) const {
+			const Slot* slot = GetSlot(handle);
+			return slot && slot->state == AssetState::Ready ? slot->asset.get() : nullptr;
+		}
+		// @brief 無効なハンドルはFailedとして扱う
+		AssetState GetState(Handle handle) const {
+			const Slot* slot = GetSlot(handle);
+			return slot ? slot->state : AssetState::Failed;
+		}
+		bool IsAlive(Handle handle) const { return GetSlot(handle) != nullptr; }
+		uint32_t GetRefCount(Handle handle) const {
+			const Slot* slot = GetSlot(handle);
+			return slot ? slot->ref_count : 0;
+		}
+		// @brief 参照されているアセットの数(破棄待ちは含めない)
+		size_t GetAliveCount() const { return path_lookup.size(); }
+		size_t GetRetiredCount() const { return retired.size(); }
+
+		// @brief 破棄待ちも含め、全てのアセットを破棄する(GPUの完了を待ってから呼ぶこと)
+		template<class OnDestroy>
+		void Clear(OnDestroy&& on_destroy) {
+			for (uint32_t i = 0; i < slots.size(); i++) {
+				if (slots[i].asset || slots[i].alive)
+					on_destroy(i, slots[i].asset.get());
+			}
+			slots.clear();
+			free_slots.clear();
+			path_lookup.clear();
+			retired.clear();
+		}
+	};
+}
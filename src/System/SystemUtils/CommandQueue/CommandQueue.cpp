@@ -1,5 +1,6 @@
 #include "CommandQueue.h"
-#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
 
 namespace System {
 
@@ -33,16 +34,31 @@ namespace System {
 		}
 		fence_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
+		//GPU側の区間を計測するのは、タイムスタンプが取れる描画とコンピュートのキューだけ
+		if (command_queue && (type == D3D12_COMMAND_LIST_TYPE_DIRECT || type == D3D12_COMMAND_LIST_TYPE_COMPUTE)) {
+			UINT64 frequency = 0;
+			if (SUCCEEDED(command_queue->GetTimestampFrequency(&frequency))) {
+				timestamp_frequency = frequency;
+				profile_lane = ProfileManager::Instance()->AcquireLane(type == D3D12_COMMAND_LIST_TYPE_DIRECT ? "GPU Direct" : "GPU Compute");
+			}
+		}
 	}
 
 	CommandQueue::~CommandQueue()
 	{
+		ProfileManager::Instance()->ReleaseLane(profile_lane);
+		profile_lane = nullptr;
 		command_queue.Reset();
 		fence.Reset();
+		if (fence_event) {
+			CloseHandle(fence_event);
+			fence_event = nullptr;
+		}
 	}
 
 	int CommandQueue::Execute(const std::vector<ID3D12CommandList*>& command_lists)
 	{
+		PROFILE_FUNCTION();
 		if (!IsValid()) return -1;
 		command_queue->ExecuteCommandLists(static_cast<UINT>(command_lists.size()), command_lists.data());
 
@@ -53,6 +69,7 @@ namespace System {
 	}
 	int CommandQueue::Execute(const std::vector<ID3D12DeviceContext*>& contexts)
 	{
+		PROFILE_FUNCTION();
 		if (!IsValid()) return -1;
 		std::vector<ID3D12CommandList*> command_lists;
 		command_lists.reserve(contexts.size());
@@ -99,8 +116,11 @@ namespace System {
 				// イベントの設定に失敗した場合は、失敗を示す -1 を返す
 				return -1;
 			}
+			PROFILE_ZONE("CommandQueue::WaitForFence");
 			WaitForSingleObject(fence_event, INFINITE);
 		}
+		//このコンテキストが前に積んだコマンドは全て完了しているので、タイムスタンプを読み戻せる
+		CollectGpuZones(context);
 
 
 #endif // !IVENT_WAIT
@@ -119,9 +139,43 @@ namespace System {
 				// イベントの設定に失敗した場合は、失敗を示す -1 を返す
 				return -1;
 			}
+			PROFILE_ZONE("CommandQueue::WaitForFence");
 			WaitForSingleObject(fence_event, INFINITE);
 		}
 
 		return 0;
 	}
+
+	int CommandQueue::WaitForQueue(const CommandQueue* other, uint64_t value)
+	{
+		if (!IsValid() || !other || !other->IsValid()) return -1;
+		//既に通過している値なら、待たせる必要は無い
+		if (other->GetCompletedValue() >= value) return 0;
+		return SUCCEEDED(command_queue->Wait(other->fence.Get(), value)) ? 0 : -1;
+	}
+
+	GpuClockCalibration CommandQueue::CalibrateClock() const
+	{
+		GpuClockCalibration calibration;
+		if (!command_queue || timestamp_frequency == 0) return calibration;
+		//GetClockCalibrationが返すCPUの時刻はQueryPerformanceCounterの値なので、前後でProfileManagerの時刻を読み、その中間を同じ時点とする
+		UINT64 gpu_timestamp = 0;
+		UINT64 cpu_timestamp = 0;
+		int64_t before = ProfileManager::Now();
+		if (FAILED(command_queue->GetClockCalibration(&gpu_timestamp, &cpu_timestamp))) {
+			return calibration;
+		}
+		int64_t after = ProfileManager::Now();
+		calibration.gpu_timestamp = gpu_timestamp;
+		calibration.cpu_ticks = before + (after - before) / 2;
+		calibration.frequency = timestamp_frequency;
+		return calibration;
+	}
+
+	void CommandQueue::CollectGpuZones(ID3D12DeviceContext* context)
+	{
+		if (!context || !profile_lane || !context->GetGpuTimer()->HasPendingZones()) return;
+		//GPUとCPUの時計は少しずつずれていくので、読む度に較正し直す
+		context->GetGpuTimer()->Collect(CalibrateClock(), profile_lane);
+	}
 }
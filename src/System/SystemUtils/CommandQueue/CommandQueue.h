@@ -2,6 +2,8 @@
 
 namespace System {
 	class ID3D12DeviceContext;
+	class ProfileThreadBuffer;
+	struct GpuClockCalibration;
 	//-------------------------------------------------------------
 	// @brief コマンドキュークラス
 	// @brief コマンドキュー、フェンス、フェンス値を所有・管理するクラス
@@ -19,8 +21,17 @@ namespace System {
 		// @brief キューの実行完了を待つ
 		int WaitForCompletion(ID3D12DeviceContext* context);
 		int WaitForCompletionAll();
+		// @brief otherのフェンスがvalueに達するまで、このキューに後から積むコマンドをGPU側で待たせる(CPUは待たない)
+		int WaitForQueue(const CommandQueue* other, uint64_t value);
 
 		ID3D12CommandQueue* GetCommandQueue() const { return command_queue.Get(); }
+		// @brief 最後にシグナルしたフェンス値。次にExecuteしたコマンドは、この値+1で完了が分かる
+		uint64_t GetLastSignaledValue() const { return fence_value; }
+		// @brief GPUが通過したフェンス値(待たずに読む)
+		uint64_t GetCompletedValue() const { return fence ? fence->GetCompletedValue() : 0; }
+		uint64_t GetTimestampFrequency() const { return timestamp_frequency; }
+		// @brief 今のGPUのタイムスタンプと、ProfileManagerの時刻の組を取る
+		GpuClockCalibration CalibrateClock() const;
 		bool IsValid() const { return command_queue && fence && fence_event; }
 
 	private:
@@ -28,5 +39,10 @@ namespace System {
 		ComPtr<ID3D12Fence> fence;
 		size_t fence_value = 0;
 		HANDLE fence_event = nullptr;
+		uint64_t timestamp_frequency = 0;	// GPUのタイムスタンプの周波数。取れないキューでは0
+		ProfileThreadBuffer* profile_lane = nullptr;	// GPU側の区間を並べる、トレース上の行
+
+		// @brief 実行が完了したコンテキストの、GPU側の区間の結果を読む
+		void CollectGpuZones(ID3D12DeviceContext* context);
 	};
 }
@@ -0,0 +1,31 @@
+﻿#include "Frustum.h"
+
+namespace System {
+
+	Frustum::Frustum(const DirectX::XMMATRIX& matrix)
+	{
+		//DirectXMathは行ベクトルなので、クリップ座標は v * M の各列との内積になる
+		//転置して列を行として取り出し、-w <= x <= w, -w <= y <= w, 0 <= z <= w の各不等式を平面にする
+		DirectX::XMMATRIX columns = DirectX::XMMatrixTranspose(matrix);
+		DirectX::XMVECTOR plane_vectors[PlaneCount] = {
+			DirectX::XMVectorAdd(columns.r[3], columns.r[0]),
+			DirectX::XMVectorSubtract(columns.r[3], columns.r[0]),
+			DirectX::XMVectorAdd(columns.r[3], columns.r[1]),
+			DirectX::XMVectorSubtract(columns.r[3], columns.r[1]),
+			columns.r[2],
+			DirectX::XMVectorSubtract(columns.r[3], columns.r[2]),
+		};
+		for (int i = 0; i < PlaneCount; i++)
+			DirectX::XMStoreFloat4(&planes[i], DirectX::XMPlaneNormalize(plane_vectors[i]));
+	}
+
+	bool Frustum::IntersectsSphere(const DirectX::XMFLOAT3& center, float radius) const
+	{
+		for (const DirectX::XMFLOAT4& plane : planes) {
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			if (distance < -radius)
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <DirectXMath.h>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 視錐台
+	// @brief ビュー射影行列から6枚の平面を取り出して、バウンディングスフィアとの判定を行う
+	// @details 平面は行列に入る前の空間で表される。
+	//			ビュー射影行列を渡せばワールド空間、ワールド行列を掛けた物を渡せばローカル空間の視錐台になる。
+	//			平面の法線は内側を向いていて、長さ1に正規化してある
+	//-------------------------------------------------------------
+	class Frustum
+	{
+	public:
+		enum FrustumPlane {
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			PlaneCount
+		};
+	private:
+		std::array<DirectX::XMFLOAT4, PlaneCount> planes = {};
+	public:
+		Frustum() = default;
+		explicit Frustum(const DirectX::XMMATRIX& matrix);
+
+		const DirectX::XMFLOAT4& GetPlane(FrustumPlane plane) const { return planes[plane]; }
+		const std::array<DirectX::XMFLOAT4, PlaneCount>& GetPlanes() const { return planes; }
+
+		// @brief 球が視錐台と交差している(一部でも中にある)かどうか
+		bool IntersectsSphere(const DirectX::XMFLOAT3& center, float radius) const;
+	};
+}
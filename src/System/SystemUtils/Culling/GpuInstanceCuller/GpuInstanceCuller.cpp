@@ -0,0 +1,204 @@
+﻿#include "GpuInstanceCuller.h"
+#include "System/SystemUtils/Culling/Frustum/Frustum.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/D3DBuffer/D3DBufferInclude.h"
+
+#include <d3dcompiler.h>
+
+namespace System {
+
+	GpuInstanceCuller::GpuInstanceCuller(const std::wstring& shader_path, unsigned int instance_count_)
+		:instance_count(instance_count_)
+	{
+		if (CreateRootSignature() != 0) {
+			return;
+		}
+		if (CreatePipelineState(shader_path) != 0) {
+			return;
+		}
+		for (auto& cb : frame_constant_buffers) {
+			cb = std::make_unique<ConstantBufferTyped<CullConstants>>();
+			if (!cb->IsValid()) {
+				return;
+			}
+		}
+		is_valid = true;
+	}
+
+	GpuInstanceCuller::~GpuInstanceCuller() = default;
+
+	int GpuInstanceCuller::CreateRootSignature()
+	{
+		std::array<D3D12_ROOT_PARAMETER, RootParameterCount> root_parameters = {};
+		root_parameters[FrameConstantSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		root_parameters[FrameConstantSlot].Descriptor.ShaderRegister = 0;
+		root_parameters[MeshConstantSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		root_parameters[MeshConstantSlot].Constants.ShaderRegister = 1;
+		root_parameters[MeshConstantSlot].Constants.Num32BitValues = 2;
+		root_parameters[WorldMatrixSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		root_parameters[WorldMatrixSlot].Descriptor.ShaderRegister = 0;
+		root_parameters[MeshDataSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		root_parameters[MeshDataSlot].Descriptor.ShaderRegister = 1;
+		root_parameters[CommandSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		root_parameters[CommandSlot].Descriptor.ShaderRegister = 0;
+		root_parameters[InstanceIdSlot].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		root_parameters[InstanceIdSlot].Descriptor.ShaderRegister = 1;
+		for (auto& parameter : root_parameters)
+			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		D3D12_ROOT_SIGNATURE_DESC root_signature_desc = {};
+		root_signature_desc.NumParameters = static_cast<UINT>(root_parameters.size());
+		root_signature_desc.pParameters = root_parameters.data();
+		root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		ComPtr<ID3DBlob> signature_blob;
+		ComPtr<ID3DBlob> error_blob;
+		HRESULT hr = D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature_blob, &error_blob);
+		if (FAILED(hr)) {
+			if (error_blob) {
+				OutputDebugStringA((char*)error_blob->GetBufferPointer());
+			}
+			return -1;
+		}
+		hr = DirectX12Manager::Instance()->GetDevice()->CreateRootSignature(0, signature_blob->GetBufferPointer(), signature_blob->GetBufferSize(), IID_PPV_ARGS(root_signature.GetAddressOf()));
+		if (FAILED(hr)) {
+			return -1;
+		}
+		return 0;
+	}
+
+	int GpuInstanceCuller::CreatePipelineState(const std::wstring& shader_path)
+	{
+		ComPtr<ID3DBlob> cs_blob;
+		ComPtr<ID3DBlob> error_blob;
+		HRESULT hr = D3DCompileFromFile(shader_path.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "cs_5_1", D3DCOMPILE_ENABLE_STRICTNESS, 0, cs_blob.GetAddressOf(), error_blob.GetAddressOf());
+		if (FAILED(hr)) {
+			if (error_blob) {
+				OutputDebugStringA((char*)error_blob->GetBufferPointer());
+			}
+			return -1;
+		}
+		D3D12_COMPUTE_PIPELINE_STATE_DESC pso_desc = {};
+		pso_desc.pRootSignature = root_signature.Get();
+		pso_desc.CS.pShaderBytecode = cs_blob->GetBufferPointer();
+		pso_desc.CS.BytecodeLength = cs_blob->GetBufferSize();
+		hr = DirectX12Manager::Instance()->GetDevice()->CreateComputePipelineState(&pso_desc, IID_PPV_ARGS(pipeline_state.GetAddressOf()));
+		if (FAILED(hr)) {
+			return -1;
+		}
+		return 0;
+	}
+
+	int GpuInstanceCuller::AddMesh(const MeshInfo& mesh, const GeometryAllocation& allocation)
+	{
+		if (mesh.GetLodCount() > MAX_LOD_COUNT) {
+			return -1;
+		}
+		MeshCullData data;
+		data.bounding_sphere = mesh.bounding_sphere;
+		data.lod_count = static_cast<unsigned int>(mesh.GetLodCount());
+		unsigned int mesh_index = static_cast<unsigned int>(mesh_data.size());
+		command_bases.push_back(static_cast<unsigned int>(command_templates.size()));
+		for (unsigned int lod = 0; lod < data.lod_count; lod++) {
+			MeshLod mesh_lod = mesh.GetLod(lod);
+			data.lod_errors[lod] = mesh_lod.error;
+
+			//メッシュ×LOD毎に1ドロー。インスタンス番号の表は、ドロー毎にinstance_count個ずつ区切って使う
+			IndirectDrawCommand command;
+			command.material_index = mesh.material_index;
+			command.mesh_index = mesh_index;
+			command.instance_offset = static_cast<unsigned int>(command_templates.size()) * instance_count;
+			command.draw.IndexCountPerInstance = mesh_lod.index_count;
+			command.draw.InstanceCount = 0;
+			command.draw.StartIndexLocation = allocation.first_index + mesh_lod.index_offset;
+			command.draw.BaseVertexLocation = static_cast<INT>(allocation.base_vertex);
+			command.draw.StartInstanceLocation = 0;
+			command_templates.push_back(command);
+		}
+		mesh_data.push_back(data);
+		return 0;
+	}
+
+	int GpuInstanceCuller::Build()
+	{
+		if (!is_valid || command_templates.empty()) {
+			return -1;
+		}
+		mesh_data_buffer = std::make_unique<StructuredBufferTyped<MeshCullData>>(mesh_data.size());
+		MeshCullData* mapped_mesh_data = mesh_data_buffer->Map();
+		if (!mapped_mesh_data) {
+			return -1;
+		}
+		std::copy(mesh_data.begin(), mesh_data.end(), mapped_mesh_data);
+
+		template_buffer = std::make_unique<StructuredBufferTyped<IndirectDrawCommand>>(command_templates.size());
+		IndirectDrawCommand* mapped_templates = template_buffer->Map();
+		if (!mapped_templates) {
+			return -1;
+		}
+		std::copy(command_templates.begin(), command_templates.end(), mapped_templates);
+
+		command_buffer = std::make_unique<RWStructuredBuffer>(sizeof(IndirectDrawCommand), command_templates.size());
+		instance_id_buffer = std::make_unique<RWStructuredBuffer>(sizeof(unsigned int), command_templates.size() * instance_count);
+		if (!command_buffer->IsValid() || !instance_id_buffer->IsValid()) {
+			return -1;
+		}
+		return 0;
+	}
+
+	int GpuInstanceCuller::Dispatch(CommandStreamRecorder<ID3D12GraphicsCommandList>* cmd_list, const Frustum& frustum, const DirectX::XMFLOAT3& eye_position, float lod_scale, float max_pixel_error, D3D12_GPU_VIRTUAL_ADDRESS world_matrices)
+	{
+		if (!command_buffer) {
+			return -1;
+		}
+		auto& frame_cb = frame_constant_buffers[DirectX12Manager::Instance()->GetFrameIndex()];
+		CullConstants* constants = frame_cb->Map();
+		if (!constants) {
+			return -1;
+		}
+		const auto& planes = frustum.GetPlanes();
+		std::copy(planes.begin(), planes.end(), constants->frustum_planes);
+		constants->eye_position = eye_position;
+		constants->lod_scale = lod_scale;
+		constants->max_pixel_error = max_pixel_error;
+		constants->instance_count = instance_count;
+
+		//バッファはコマンドリストの実行が終わるとCOMMONに戻るので、フレームの頭では必ずCOMMONから始まる
+		command_buffer->ResetState();
+		instance_id_buffer->ResetState();
+
+		//InstanceCountを0に戻した雛形をコピーしてから、シェーダーで加算していく
+		command_buffer->Transition(cmd_list, D3D12_RESOURCE_STATE_COPY_DEST);
+		cmd_list->CopyBufferRegion(command_buffer->GetResource(), 0, template_buffer->GetResource(), 0, template_buffer->GetBufferSize());
+		command_buffer->Transition(cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		instance_id_buffer->Transition(cmd_list, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		cmd_list->SetComputeRootSignature(root_signature.Get());
+		cmd_list->SetPipelineState(pipeline_state.Get());
+		cmd_list->SetComputeRootConstantBufferView(FrameConstantSlot, frame_cb->GetResource()->GetGPUVirtualAddress());
+		cmd_list->SetComputeRootShaderResourceView(WorldMatrixSlot, world_matrices);
+		cmd_list->SetComputeRootShaderResourceView(MeshDataSlot, mesh_data_buffer->GetResource()->GetGPUVirtualAddress());
+		cmd_list->SetComputeRootUnorderedAccessView(CommandSlot, command_buffer->GetResource()->GetGPUVirtualAddress());
+		cmd_list->SetComputeRootUnorderedAccessView(InstanceIdSlot, instance_id_buffer->GetResource()->GetGPUVirtualAddress());
+		unsigned int group_count = (instance_count + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE;
+		for (size_t m = 0; m < mesh_data.size(); m++) {
+			unsigned int mesh_constants[2] = { static_cast<unsigned int>(m), command_bases[m] };
+			cmd_list->SetComputeRoot32BitConstants(MeshConstantSlot, 2, mesh_constants, 0);
+			cmd_list->Dispatch(group_count, 1, 1);
+		}
+
+		command_buffer->Transition(cmd_list, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+		instance_id_buffer->Transition(cmd_list, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		return 0;
+	}
+
+	ID3D12Resource* GpuInstanceCuller::GetCommandBuffer() const
+	{
+		return command_buffer ? command_buffer->GetResource() : nullptr;
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS GpuInstanceCuller::GetInstanceIdAddress() const
+	{
+		return instance_id_buffer ? instance_id_buffer->GetResource()->GetGPUVirtualAddress() : 0;
+	}
+}
@@ -0,0 +1,116 @@
+﻿#pragma once
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/SystemUtils/IndirectDraw/IndirectCommandBuffer/IndirectCommandBuffer.h"
+#include "System/SystemUtils/GeometryPool/GeometryPool/GeometryPool.h"
+#include <DirectXMath.h>
+
+namespace System {
+	class Frustum;
+	struct MeshInfo;
+	class RWStructuredBuffer;
+	class StructuredBuffer;
+	template <class T> class StructuredBufferTyped;
+	template <class T> class ConstantBufferTyped;
+
+	//-------------------------------------------------------------
+	// @brief インスタンスの視錐台カリングとLOD選択をコンピュートシェーダーで行い、ExecuteIndirectの引数を組み立てるクラス
+	// @details メッシュ×LOD毎に1ドロー分のIndirectDrawCommandを用意しておき、
+	//			インスタンス毎に1スレッドで、カリング→LOD選択→該当するドローのInstanceCountをアトミックに加算→
+	//			インスタンス番号の表に書き込む、を行う。
+	//			CPU側(InstanceCuller + MeshInfo::SelectLod)と同じ判定なので、結果はCPU版と一致する(並び順は除く)。
+	//			インスタンス数が0のドローはそのまま残るが、ExecuteIndirectでは何も描かれない
+	//-------------------------------------------------------------
+	class GpuInstanceCuller
+	{
+	public:
+		//1メッシュで扱えるLODの最大数
+		static constexpr unsigned int MAX_LOD_COUNT = 8;
+		//シェーダーのnumthreadsと合わせること
+		static constexpr unsigned int THREAD_GROUP_SIZE = 64;
+
+		//メッシュ毎のカリング用データ(シェーダーのMeshCullDataと同じ並び)
+		struct MeshCullData {
+			DirectX::XMFLOAT4 bounding_sphere = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float lod_errors[MAX_LOD_COUNT] = {};
+			unsigned int lod_count = 1;
+			unsigned int padding[3] = {};
+		};
+		//フレーム毎の定数(シェーダーのcull_frameと同じ並び)
+		struct CullConstants {
+			DirectX::XMFLOAT4 frustum_planes[6];
+			DirectX::XMFLOAT3 eye_position;
+			float lod_scale;				// 射影後の大きさ = 直径 * lod_scale / 距離
+			float max_pixel_error;
+			unsigned int instance_count;
+			float padding[2];
+		};
+		//ルートパラメータの並び
+		enum RootParameterSlot {
+			FrameConstantSlot = 0,
+			MeshConstantSlot,
+			WorldMatrixSlot,
+			MeshDataSlot,
+			CommandSlot,
+			InstanceIdSlot,
+			RootParameterCount
+		};
+	private:
+		ComPtr<ID3D12RootSignature> root_signature;
+		ComPtr<ID3D12PipelineState> pipeline_state;
+		unsigned int instance_count = 0;
+
+		std::vector<MeshCullData> mesh_data;
+		std::vector<IndirectDrawCommand> command_templates;
+		std::vector<unsigned int> command_bases;
+
+		std::array<std::unique_ptr<ConstantBufferTyped<CullConstants>>, DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT> frame_constant_buffers;
+		std::unique_ptr<StructuredBufferTyped<MeshCullData>> mesh_data_buffer;
+		//InstanceCountを0にした引数の雛形。毎フレームこれをcommand_bufferにコピーしてから加算していく
+		std::unique_ptr<StructuredBufferTyped<IndirectDrawCommand>> template_buffer;
+		std::unique_ptr<RWStructuredBuffer> command_buffer;
+		std::unique_ptr<RWStructuredBuffer> instance_id_buffer;
+		bool is_valid = false;
+
+		int CreateRootSignature();
+		int CreatePipelineState(const std::wstring& shader_path);
+	public:
+		//-------------------------------------------------------------
+		// @param [in] shader_path カリング用コンピュートシェーダーのパス
+		// @param [in] instance_count_ インスタンス数(全メッシュ共通)
+		//-------------------------------------------------------------
+		GpuInstanceCuller(const std::wstring& shader_path, unsigned int instance_count_);
+		~GpuInstanceCuller();
+		bool IsValid() const { return is_valid; }
+
+		//-------------------------------------------------------------
+		// @brief 描画するメッシュを登録する。登録順がルート定数のメッシュ番号になる
+		//
+		// @param [in] mesh メッシュ(LODチェーンとバウンディングスフィアを使う)
+		// @param [in] allocation メッシュの頂点とインデックスが入っている、GeometryPool内の範囲
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int AddMesh(const MeshInfo& mesh, const GeometryAllocation& allocation);
+		// @brief 登録したメッシュから、GPU側のバッファを作る
+		int Build();
+
+		//-------------------------------------------------------------
+		// @brief カリングを行うディスパッチを積む
+		// @details 終わった時点で、引数バッファはINDIRECT_ARGUMENT、インスタンス番号の表はNON_PIXEL_SHADER_RESOURCEになっている。
+		//			コンピュート用のルートシグネチャとパイプラインステートに切り替わるので、描画の前に呼ぶこと
+		//
+		// @param [in] cmd_list 記録用のラッパー(コマンドストリームを記録したフレームにも、カリングのコマンドが残る)
+		// @param [in] frustum ワールド空間の視錐台
+		// @param [in] eye_position カメラの位置
+		// @param [in] lod_scale 射影後の大きさ = 直径 * lod_scale / 距離 となる係数
+		// @param [in] max_pixel_error LODの誤差の許容値(ピクセル)
+		// @param [in] world_matrices インスタンス毎のワールド行列が並んだバッファ
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int Dispatch(CommandStreamRecorder<ID3D12GraphicsCommandList>* cmd_list, const Frustum& frustum, const DirectX::XMFLOAT3& eye_position, float lod_scale, float max_pixel_error, D3D12_GPU_VIRTUAL_ADDRESS world_matrices);
+
+		ID3D12Resource* GetCommandBuffer() const;
+		unsigned int GetCommandCount() const { return static_cast<unsigned int>(command_templates.size()); }
+		// @brief 頂点シェーダーに渡すインスタンス番号の表
+		D3D12_GPU_VIRTUAL_ADDRESS GetInstanceIdAddress() const;
+	};
+}
@@ -0,0 +1,124 @@
+﻿#include "InstanceCuller.h"
+#include "System/SystemUtils/Culling/Frustum/Frustum.h"
+
+#include <immintrin.h>
+
+namespace System {
+
+	void InstanceCuller::UpdateBounds(const DirectX::XMFLOAT4& local_sphere, const DirectX::XMMATRIX* world_matrices, size_t count, size_t stride)
+	{
+		instance_count = count;
+		size_t padded_count = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+		center_x.resize(padded_count);
+		center_y.resize(padded_count);
+		center_z.resize(padded_count);
+		radius.resize(padded_count);
+
+		const unsigned char* matrix_bytes = reinterpret_cast<const unsigned char*>(world_matrices);
+		for (size_t i = 0; i < count; i++) {
+			const DirectX::XMMATRIX& world = *reinterpret_cast<const DirectX::XMMATRIX*>(matrix_bytes + i * stride);
+			DirectX::XMFLOAT4 sphere = TransformSphere(local_sphere, world);
+			center_x[i] = sphere.x;
+			center_y[i] = sphere.y;
+			center_z[i] = sphere.z;
+			radius[i] = sphere.w;
+		}
+		//SIMDの幅に足りない分は、どの平面に対しても必ず外側になるダミーで埋める
+		for (size_t i = count; i < padded_count; i++) {
+			center_x[i] = 0.0f;
+			center_y[i] = 0.0f;
+			center_z[i] = 0.0f;
+			radius[i] = -std::numeric_limits<float>::max();
+		}
+	}
+
+	DirectX::XMFLOAT4 InstanceCuller::TransformSphere(const DirectX::XMFLOAT4& local_sphere, const DirectX::XMMATRIX& world)
+	{
+		DirectX::XMVECTOR world_center = DirectX::XMVector3Transform(DirectX::XMVectorSet(local_sphere.x, local_sphere.y, local_sphere.z, 1.0f), world);
+		//各軸のスケールの最大値で半径を拡大する
+		float scale_sq = std::max({
+			DirectX::XMVectorGetX(DirectX::XMVector3Dot(world.r[0], world.r[0])),
+			DirectX::XMVectorGetX(DirectX::XMVector3Dot(world.r[1], world.r[1])),
+			DirectX::XMVectorGetX(DirectX::XMVector3Dot(world.r[2], world.r[2])) });
+		return DirectX::XMFLOAT4(DirectX::XMVectorGetX(world_center), DirectX::XMVectorGetY(world_center), DirectX::XMVectorGetZ(world_center), local_sphere.w * std::sqrt(scale_sq));
+	}
+
+	size_t InstanceCuller::Cull(const Frustum& frustum, std::vector<unsigned int>& out_visible) const
+	{
+		out_visible.clear();
+		out_visible.reserve(instance_count);
+		const std::array<DirectX::XMFLOAT4, Frustum::PlaneCount>& planes = frustum.GetPlanes();
+		size_t padded_count = center_x.size();
+
+#if defined(__AVX__)
+		//8インスタンスずつ判定する
+		__m256 plane_x[Frustum::PlaneCount];
+		__m256 plane_y[Frustum::PlaneCount];
+		__m256 plane_z[Frustum::PlaneCount];
+		__m256 plane_w[Frustum::PlaneCount];
+		for (int p = 0; p < Frustum::PlaneCount; p++) {
+			plane_x[p] = _mm256_set1_ps(planes[p].x);
+			plane_y[p] = _mm256_set1_ps(planes[p].y);
+			plane_z[p] = _mm256_set1_ps(planes[p].z);
+			plane_w[p] = _mm256_set1_ps(planes[p].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		for (size_t i = 0; i < padded_count; i += 8) {
+			__m256 cx = _mm256_loadu_ps(&center_x[i]);
+			__m256 cy = _mm256_loadu_ps(&center_y[i]);
+			__m256 cz = _mm256_loadu_ps(&center_z[i]);
+			__m256 neg_radius = _mm256_sub_ps(zero, _mm256_loadu_ps(&radius[i]));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < Frustum::PlaneCount; p++) {
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[p], cx), _mm256_mul_ps(plane_y[p], cy)), _mm256_add_ps(_mm256_mul_ps(plane_z[p], cz), plane_w[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+			}
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+				if (mask & 1)
+					out_visible.push_back(static_cast<unsigned int>(i + lane));
+			}
+		}
+#else
+		//4インスタンスずつ判定する
+		__m128 plane_x[Frustum::PlaneCount];
+		__m128 plane_y[Frustum::PlaneCount];
+		__m128 plane_z[Frustum::PlaneCount];
+		__m128 plane_w[Frustum::PlaneCount];
+		for (int p = 0; p < Frustum::PlaneCount; p++) {
+			plane_x[p] = _mm_set1_ps(planes[p].x);
+			plane_y[p] = _mm_set1_ps(planes[p].y);
+			plane_z[p] = _mm_set1_ps(planes[p].z);
+			plane_w[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		for (size_t i = 0; i < padded_count; i += 4) {
+			__m128 cx = _mm_loadu_ps(&center_x[i]);
+			__m128 cy = _mm_loadu_ps(&center_y[i]);
+			__m128 cz = _mm_loadu_ps(&center_z[i]);
+			__m128 neg_radius = _mm_sub_ps(zero, _mm_loadu_ps(&radius[i]));
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::PlaneCount; p++) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], cx), _mm_mul_ps(plane_y[p], cy)), _mm_add_ps(_mm_mul_ps(plane_z[p], cz), plane_w[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_radius));
+			}
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+				if (mask & 1)
+					out_visible.push_back(static_cast<unsigned int>(i + lane));
+			}
+		}
+#endif
+		return out_visible.size();
+	}
+
+	size_t InstanceCuller::CullScalar(const Frustum& frustum, std::vector<unsigned int>& out_visible) const
+	{
+		out_visible.clear();
+		for (size_t i = 0; i < instance_count; i++) {
+			if (frustum.IntersectsSphere(DirectX::XMFLOAT3(center_x[i], center_y[i], center_z[i]), radius[i]))
+				out_visible.push_back(static_cast<unsigned int>(i));
+		}
+		return out_visible.size();
+	}
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <DirectXMath.h>
+
+namespace System {
+	class Frustum;
+
+	//-------------------------------------------------------------
+	// @brief インスタンス単位の視錐台カリングを行うクラス
+	// @details メッシュのバウンディングスフィアを各インスタンスのワールド行列で変換して、SoA(成分毎の配列)で保持する。
+	//			カリングはSSEで4インスタンスずつ(AVXが有効なビルドでは8インスタンスずつ)まとめて6平面と判定し、
+	//			残ったインスタンスの番号だけを詰めて返す。
+	//			配列の末尾はSIMDの幅に合わせて、必ず弾かれるダミーで埋めてある
+	//-------------------------------------------------------------
+	class InstanceCuller
+	{
+	public:
+		//SIMDでまとめて処理するインスタンス数(AVXの8に合わせておけば、SSEの4でも割り切れる)
+		static constexpr size_t SIMD_WIDTH = 8;
+	private:
+		std::vector<float> center_x;
+		std::vector<float> center_y;
+		std::vector<float> center_z;
+		std::vector<float> radius;
+		size_t instance_count = 0;
+	public:
+		//-------------------------------------------------------------
+		// @brief インスタンス毎のワールド空間のバウンディングスフィアを更新する
+		// @details 半径はワールド行列の最大スケールで拡大するので、非一様スケールでも欠けることはない
+		//
+		// @param [in] local_sphere メッシュのローカル空間のバウンディングスフィア(xyz:中心, w:半径)
+		// @param [in] world_matrices 先頭のインスタンスのワールド行列
+		// @param [in] count インスタンス数
+		// @param [in] stride 次のインスタンスのワールド行列までのバイト数
+		//-------------------------------------------------------------
+		void UpdateBounds(const DirectX::XMFLOAT4& local_sphere, const DirectX::XMMATRIX* world_matrices, size_t count, size_t stride = sizeof(DirectX::XMMATRIX));
+
+		//-------------------------------------------------------------
+		// @brief 視錐台と交差するインスタンスの番号を詰めて返す(SIMD版)
+		//
+		// @param [in] frustum ワールド空間の視錐台
+		// @param [out] out_visible 残ったインスタンスの番号(昇順)
+		// @return 残ったインスタンス数
+		//-------------------------------------------------------------
+		size_t Cull(const Frustum& frustum, std::vector<unsigned int>& out_visible) const;
+		// @brief Cullと同じ結果を返すスカラー版(検証用)
+		size_t CullScalar(const Frustum& frustum, std::vector<unsigned int>& out_visible) const;
+
+		//-------------------------------------------------------------
+		// @brief ローカル空間のバウンディングスフィアを、ワールド空間に変換する(UpdateBoundsと同じ計算)
+		// @details 半径はワールド行列の最大スケールで拡大するので、非一様スケールでも欠けることはない
+		//-------------------------------------------------------------
+		static DirectX::XMFLOAT4 TransformSphere(const DirectX::XMFLOAT4& local_sphere, const DirectX::XMMATRIX& world);
+
+		size_t GetInstanceCount() const { return instance_count; }
+		// @brief ワールド空間のバウンディングスフィア(xyz:中心, w:半径)
+		DirectX::XMFLOAT4 GetWorldSphere(size_t instance) const {
+			return DirectX::XMFLOAT4(center_x[instance], center_y[instance], center_z[instance], radius[instance]);
+		}
+	};
+}
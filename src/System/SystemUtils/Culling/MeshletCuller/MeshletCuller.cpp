@@ -0,0 +1,77 @@
+﻿#include "MeshletCuller.h"
+#include "System/SystemUtils/Culling/Frustum/Frustum.h"
+#include "System/SystemUtils/GeometryPool/GeometryPool/GeometryPool.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+
+#include <cmath>
+
+namespace System {
+
+	bool MeshletCuller::IsOutsideFrustum(const Meshlet& meshlet, const Frustum& local_frustum)
+	{
+		DirectX::XMFLOAT3 center(meshlet.bounding_sphere.x, meshlet.bounding_sphere.y, meshlet.bounding_sphere.z);
+		return !local_frustum.IntersectsSphere(center, meshlet.bounding_sphere.w);
+	}
+
+	bool MeshletCuller::IsBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& local_eye_position)
+	{
+		if (meshlet.cone_cutoff >= 1.0f)
+			return false;
+		//カメラからスフィアの中心へのベクトルが、コーンの軸と十分同じ向きなら、
+		//スフィア内のどこから見ても全ての三角形が裏を向いている
+		float dx = meshlet.bounding_sphere.x - local_eye_position.x;
+		float dy = meshlet.bounding_sphere.y - local_eye_position.y;
+		float dz = meshlet.bounding_sphere.z - local_eye_position.z;
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float along_axis = dx * meshlet.cone_axis.x + dy * meshlet.cone_axis.y + dz * meshlet.cone_axis.z;
+		return along_axis >= meshlet.cone_cutoff * distance + meshlet.bounding_sphere.w;
+	}
+
+	unsigned int MeshletCuller::Cull(const MeshInfo& mesh, const GeometryAllocation& allocation, const DirectX::XMMATRIX& world, const DirectX::XMMATRIX& view_projection, const DirectX::XMFLOAT3& eye_position,
+		unsigned int instance_id, std::vector<D3D12_DRAW_INDEXED_ARGUMENTS>& out_arguments, CullStats* out_stats)
+	{
+		//視錐台とカメラ位置をローカル空間に持ってくる
+		//メッシュレットの数だけ行列を掛けるより、こちらの方が安い
+		Frustum local_frustum(DirectX::XMMatrixMultiply(world, view_projection));
+		DirectX::XMMATRIX inverse_world = DirectX::XMMatrixInverse(nullptr, world);
+		DirectX::XMFLOAT3 local_eye;
+		DirectX::XMStoreFloat3(&local_eye, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&eye_position), inverse_world));
+
+		//インデックスはメッシュ内のローカルな番号なので、プール内の位置はallocationから足す
+		unsigned int lod0_offset = allocation.first_index + mesh.GetLod(0).index_offset;
+		unsigned int added = 0;
+		//直前に追加した描画引数に、続きのメッシュレットをまとめられるか
+		bool can_merge = false;
+		for (const Meshlet& meshlet : mesh.meshlets) {
+			if (IsOutsideFrustum(meshlet, local_frustum)) {
+				if (out_stats)
+					out_stats->frustum_culled++;
+				can_merge = false;
+				continue;
+			}
+			if (IsBackfacing(meshlet, local_eye)) {
+				if (out_stats)
+					out_stats->backface_culled++;
+				can_merge = false;
+				continue;
+			}
+			if (out_stats)
+				out_stats->visible++;
+
+			if (can_merge) {
+				out_arguments.back().IndexCountPerInstance += meshlet.triangle_count * 3;
+				continue;
+			}
+			D3D12_DRAW_INDEXED_ARGUMENTS arguments = {};
+			arguments.IndexCountPerInstance = meshlet.triangle_count * 3;
+			arguments.InstanceCount = 1;
+			arguments.StartIndexLocation = lod0_offset + meshlet.triangle_offset * 3;
+			arguments.BaseVertexLocation = static_cast<INT>(allocation.base_vertex);
+			arguments.StartInstanceLocation = instance_id;
+			out_arguments.push_back(arguments);
+			added++;
+			can_merge = true;
+		}
+		return added;
+	}
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <DirectXMath.h>
+
+namespace System {
+	struct MeshInfo;
+	struct Meshlet;
+	struct GeometryAllocation;
+	class Frustum;
+
+	//-------------------------------------------------------------
+	// @brief メッシュレット単位のカリングを、CPUで行うクラス
+	// @details GPUでカリングする場合の基準となる実装。
+	//			視錐台カリング(バウンディングスフィア)と、法線コーンによる背面カリングを行い、
+	//			残ったメッシュレットから DrawIndexedInstanced / ExecuteIndirect の引数を作る。
+	//			判定は全てメッシュのローカル空間で行うので、ワールド行列は回転・平行移動・一様スケールのみを想定している
+	//-------------------------------------------------------------
+	class MeshletCuller
+	{
+	public:
+		//カリングの統計
+		struct CullStats {
+			unsigned int frustum_culled = 0;	// 視錐台の外で弾かれた数
+			unsigned int backface_culled = 0;	// 全ての三角形が裏を向いていて弾かれた数
+			unsigned int visible = 0;			// 残った数
+		};
+
+		// @brief メッシュレットが視錐台の外にあるか
+		static bool IsOutsideFrustum(const Meshlet& meshlet, const Frustum& local_frustum);
+		// @brief メッシュレットの全ての三角形がカメラから裏を向いているか
+		static bool IsBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& local_eye_position);
+
+		//-------------------------------------------------------------
+		// @brief 1インスタンス分のメッシュレットをカリングして、描画引数を追加する
+		// @details インデックスが連続するメッシュレットが続けて残った場合は、1つの描画引数にまとめる
+		//
+		// @param [in] mesh 対象のメッシュ(MeshletBuilder::Build済み)
+		// @param [in] allocation メッシュのGeometryPool内の範囲(描画引数の開始位置とベース頂点に足す)
+		// @param [in] world インスタンスのワールド行列
+		// @param [in] view_projection ビュー行列 * 射影行列
+		// @param [in] eye_position ワールド空間のカメラ位置
+		// @param [in] instance_id 描画引数のStartInstanceLocationに入れる値
+		// @param [out] out_arguments 描画引数の追加先
+		// @param [out] out_stats 統計の加算先(不要ならnullptr)
+		// @return 追加した描画引数の数
+		//-------------------------------------------------------------
+		static unsigned int Cull(const MeshInfo& mesh, const GeometryAllocation& allocation, const DirectX::XMMATRIX& world, const DirectX::XMMATRIX& view_projection, const DirectX::XMFLOAT3& eye_position,
+			unsigned int instance_id, std::vector<D3D12_DRAW_INDEXED_ARGUMENTS>& out_arguments, CullStats* out_stats = nullptr);
+	};
+}
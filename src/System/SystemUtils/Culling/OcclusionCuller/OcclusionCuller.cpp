@@ -0,0 +1,312 @@
+﻿#include "OcclusionCuller.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+#include <immintrin.h>
+#include <thread>
+
+namespace System {
+
+	namespace {
+		//これより手前(w)の頂点を含む三角形・AABBは扱わない
+		constexpr float NEAR_CLIP_W = 1e-4f;
+
+		//三角形のエッジ関数 E(x, y) = a * x + b * y + c (内側で正)
+		struct EdgeFunction {
+			float a;
+			float b;
+			float c;
+		};
+
+		//三角形の3辺のエッジ関数と、深度の平面 z = dzdx * x + dzdy * y + z_bias を求める
+		//裏向き・面積0の三角形はfalse
+		bool SetupEdges(const float* x, const float* y, const float* z, EdgeFunction* edges, float& dzdx, float& dzdy, float& z_bias)
+		{
+			//スクリーン座標はyが下向きなので、D3Dの表(時計回り)は符号付き面積が正になる
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (!(area > 0.0f))
+				return false;
+			for (int i = 0; i < 3; i++) {
+				int j = (i + 1) % 3;
+				edges[i].a = -(y[j] - y[i]);
+				edges[i].b = x[j] - x[i];
+				edges[i].c = (y[j] - y[i]) * x[i] - (x[j] - x[i]) * y[i];
+			}
+			float inv_area = 1.0f / area;
+			dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inv_area;
+			dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * inv_area;
+			z_bias = z[0] - dzdx * x[0] - dzdy * y[0];
+			return true;
+		}
+
+		//描くのに使うスレッド数(帯の数)。帯はタイル行より多くしない
+		unsigned int CalcThreadCount(unsigned int height, unsigned int thread_count)
+		{
+			unsigned int tiles_y = (std::max(height, 1u) + OcclusionCuller::TILE_HEIGHT - 1) / OcclusionCuller::TILE_HEIGHT;
+			unsigned int count = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+			return std::min(count, tiles_y);
+		}
+	}
+
+	OcclusionCuller::OcclusionCuller(unsigned int width_, unsigned int height_, unsigned int thread_count_)
+		:workers(CalcThreadCount(height_, thread_count_) - 1, "OcclusionCuller")	// 呼び出したスレッドも帯を描くので、作業スレッドは1つ少なくてよい
+	{
+		tiles_x = (std::max(width_, 1u) + TILE_WIDTH - 1) / TILE_WIDTH;
+		tiles_y = (std::max(height_, 1u) + TILE_HEIGHT - 1) / TILE_HEIGHT;
+		width = tiles_x * TILE_WIDTH;
+		height = tiles_y * TILE_HEIGHT;
+		thread_count = workers.GetWorkerCount() + 1;
+		depth.resize(static_cast<size_t>(width) * height);
+		tile_max_depth.resize(static_cast<size_t>(tiles_x) * tiles_y);
+		Clear();
+	}
+
+	void OcclusionCuller::Clear()
+	{
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		std::fill(tile_max_depth.begin(), tile_max_depth.end(), 1.0f);
+	}
+
+	void OcclusionCuller::SetupTriangles(const Occluder& occluder)
+	{
+		const MeshInfo& mesh = *occluder.mesh;
+		size_t vertex_count = mesh.GetVertexCount();
+
+		//頂点をスクリーン空間に変換する(w <= 0 の頂点は使えないのでwを負にして印を付ける)
+		std::vector<DirectX::XMFLOAT4> screen(vertex_count);
+		for (size_t i = 0; i < vertex_count; i++) {
+			const float* pos = mesh.GetPosition(i);
+			DirectX::XMVECTOR clip = DirectX::XMVector3Transform(DirectX::XMVectorSet(pos[0], pos[1], pos[2], 1.0f), occluder.world_view_projection);
+			float w = DirectX::XMVectorGetW(clip);
+			if (w <= NEAR_CLIP_W) {
+				screen[i] = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, -1.0f);
+				continue;
+			}
+			float inv_w = 1.0f / w;
+			screen[i] = DirectX::XMFLOAT4(
+				(DirectX::XMVectorGetX(clip) * inv_w * 0.5f + 0.5f) * static_cast<float>(width),
+				(0.5f - DirectX::XMVectorGetY(clip) * inv_w * 0.5f) * static_cast<float>(height),
+				DirectX::XMVectorGetZ(clip) * inv_w,
+				w);
+		}
+
+		MeshLod lod = mesh.GetLod(std::min<size_t>(occluder.lod, mesh.GetLodCount() - 1));
+		const unsigned int* indices = mesh.indices.data() + lod.index_offset;
+		for (unsigned int t = 0; t + 2 < lod.index_count; t += 3) {
+			ScreenTriangle triangle;
+			bool valid = true;
+			float min_x = std::numeric_limits<float>::max();
+			float max_x = -std::numeric_limits<float>::max();
+			float min_y = std::numeric_limits<float>::max();
+			float max_y = -std::numeric_limits<float>::max();
+			for (int k = 0; k < 3; k++) {
+				const DirectX::XMFLOAT4& v = screen[indices[t + k]];
+				if (v.w < 0.0f || v.z < 0.0f || v.z > 1.0f) {
+					valid = false;
+					break;
+				}
+				triangle.x[k] = v.x;
+				triangle.y[k] = v.y;
+				triangle.z[k] = v.z;
+				min_x = std::min(min_x, v.x);
+				max_x = std::max(max_x, v.x);
+				min_y = std::min(min_y, v.y);
+				max_y = std::max(max_y, v.y);
+			}
+			if (!valid)
+				continue;
+			//画面外の三角形はここで捨てる
+			if (max_x < 0.0f || min_x >= static_cast<float>(width) || max_y < 0.0f || min_y >= static_cast<float>(height))
+				continue;
+			triangle.min_y = std::max(0, static_cast<int>(std::floor(min_y)));
+			triangle.max_y = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(max_y)));
+			triangles.push_back(triangle);
+		}
+	}
+
+	void OcclusionCuller::RenderOccluders(const std::vector<Occluder>& occluders)
+	{
+		PROFILE_FUNCTION();
+		triangles.clear();
+		for (const Occluder& occluder : occluders) {
+			if (occluder.mesh)
+				SetupTriangles(occluder);
+		}
+		if (triangles.empty())
+			return;
+
+		//タイル行を帯に分けて、帯毎に別スレッドで描く
+		workers.Run(thread_count, [this](unsigned int band) {
+			RasterizeBand(tiles_y * band / thread_count, tiles_y * (band + 1) / thread_count);
+			});
+	}
+
+	void OcclusionCuller::RasterizeBand(unsigned int tile_row_begin, unsigned int tile_row_end)
+	{
+		PROFILE_FUNCTION();
+		int band_min_y = static_cast<int>(tile_row_begin * TILE_HEIGHT);
+		int band_max_y = static_cast<int>(tile_row_end * TILE_HEIGHT) - 1;
+		if (band_min_y > band_max_y)
+			return;
+		for (const ScreenTriangle& triangle : triangles) {
+			if (triangle.max_y < band_min_y || triangle.min_y > band_max_y)
+				continue;
+			if (simd_enabled)
+				RasterizeTriangle(triangle, band_min_y, band_max_y);
+			else
+				RasterizeTriangleScalar(triangle, band_min_y, band_max_y);
+		}
+
+		//帯の中のタイル毎に、一番奥の深度を更新する
+		for (unsigned int ty = tile_row_begin; ty < tile_row_end; ty++) {
+			for (unsigned int tx = 0; tx < tiles_x; tx++) {
+				float max_depth = 0.0f;
+				for (unsigned int py = 0; py < TILE_HEIGHT; py++) {
+					const float* row = &depth[static_cast<size_t>(ty * TILE_HEIGHT + py) * width + tx * TILE_WIDTH];
+					for (unsigned int px = 0; px < TILE_WIDTH; px++)
+						max_depth = std::max(max_depth, row[px]);
+				}
+				tile_max_depth[static_cast<size_t>(ty) * tiles_x + tx] = max_depth;
+			}
+		}
+	}
+
+	void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int band_min_y, int band_max_y)
+	{
+		EdgeFunction edges[3];
+		float dzdx = 0.0f;
+		float dzdy = 0.0f;
+		float z_bias = 0.0f;
+		if (!SetupEdges(triangle.x, triangle.y, triangle.z, edges, dzdx, dzdy, z_bias))
+			return;
+
+		float min_x = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		float max_x = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		//4ピクセル単位で処理するので、開始位置を4の倍数に揃える
+		int x_begin = std::max(0, static_cast<int>(std::floor(min_x))) & ~3;
+		int x_end = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(max_x)));
+		int y_begin = std::max(band_min_y, triangle.min_y);
+		int y_end = std::min(band_max_y, triangle.max_y);
+
+		const __m128 lane_offset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 edge_a[3];
+		for (int i = 0; i < 3; i++)
+			edge_a[i] = _mm_set1_ps(edges[i].a * 4.0f);
+		__m128 dz_step = _mm_set1_ps(dzdx * 4.0f);
+
+		for (int y = y_begin; y <= y_end; y++) {
+			float center_y = static_cast<float>(y) + 0.5f;
+			__m128 center_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x_begin)), lane_offset);
+			//行の先頭でのエッジ関数と深度。以降は4ピクセル毎に足していく
+			__m128 edge_value[3];
+			for (int i = 0; i < 3; i++)
+				edge_value[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[i].a), center_x), _mm_set1_ps(edges[i].b * center_y + edges[i].c));
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), center_x), _mm_set1_ps(dzdy * center_y + z_bias));
+
+			float* row = &depth[static_cast<size_t>(y) * width];
+			for (int x = x_begin; x <= x_end; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(edge_value[0], zero), _mm_cmpgt_ps(edge_value[1], zero)), _mm_cmpgt_ps(edge_value[2], zero));
+				if (_mm_movemask_ps(inside) != 0) {
+					__m128 old_depth = _mm_loadu_ps(row + x);
+					__m128 new_depth = _mm_min_ps(old_depth, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+				}
+				for (int i = 0; i < 3; i++)
+					edge_value[i] = _mm_add_ps(edge_value[i], edge_a[i]);
+				z = _mm_add_ps(z, dz_step);
+			}
+		}
+	}
+
+	void OcclusionCuller::RasterizeTriangleScalar(const ScreenTriangle& triangle, int band_min_y, int band_max_y)
+	{
+		EdgeFunction edges[3];
+		float dzdx = 0.0f;
+		float dzdy = 0.0f;
+		float z_bias = 0.0f;
+		if (!SetupEdges(triangle.x, triangle.y, triangle.z, edges, dzdx, dzdy, z_bias))
+			return;
+
+		float min_x = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		float max_x = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		int x_begin = std::max(0, static_cast<int>(std::floor(min_x)));
+		int x_end = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(max_x)));
+		int y_begin = std::max(band_min_y, triangle.min_y);
+		int y_end = std::min(band_max_y, triangle.max_y);
+		for (int y = y_begin; y <= y_end; y++) {
+			float center_y = static_cast<float>(y) + 0.5f;
+			for (int x = x_begin; x <= x_end; x++) {
+				float center_x = static_cast<float>(x) + 0.5f;
+				bool inside = true;
+				for (const EdgeFunction& edge : edges)
+					inside = inside && (edge.a * center_x + edge.b * center_y + edge.c > 0.0f);
+				if (!inside)
+					continue;
+				float z = dzdx * center_x + dzdy * center_y + z_bias;
+				float& dst = depth[static_cast<size_t>(y) * width + x];
+				dst = std::min(dst, z);
+			}
+		}
+	}
+
+	bool OcclusionCuller::IsVisible(const DirectX::XMFLOAT3& box_min, const DirectX::XMFLOAT3& box_max, const DirectX::XMMATRIX& world_view_projection) const
+	{
+		//AABBの8頂点をスクリーンに投影して、外接矩形と一番手前の深度を求める
+		float min_x = std::numeric_limits<float>::max();
+		float max_x = -std::numeric_limits<float>::max();
+		float min_y = std::numeric_limits<float>::max();
+		float max_y = -std::numeric_limits<float>::max();
+		float min_z = std::numeric_limits<float>::max();
+		for (int corner = 0; corner < 8; corner++) {
+			DirectX::XMVECTOR pos = DirectX::XMVectorSet(
+				(corner & 1) ? box_max.x : box_min.x,
+				(corner & 2) ? box_max.y : box_min.y,
+				(corner & 4) ? box_max.z : box_min.z,
+				1.0f);
+			DirectX::XMVECTOR clip = DirectX::XMVector3Transform(pos, world_view_projection);
+			float w = DirectX::XMVectorGetW(clip);
+			//カメラを跨いでいるAABBは判定できないので、見えることにする
+			if (w <= NEAR_CLIP_W)
+				return true;
+			float inv_w = 1.0f / w;
+			float x = (DirectX::XMVectorGetX(clip) * inv_w * 0.5f + 0.5f) * static_cast<float>(width);
+			float y = (0.5f - DirectX::XMVectorGetY(clip) * inv_w * 0.5f) * static_cast<float>(height);
+			min_x = std::min(min_x, x);
+			max_x = std::max(max_x, x);
+			min_y = std::min(min_y, y);
+			max_y = std::max(max_y, y);
+			min_z = std::min(min_z, DirectX::XMVectorGetZ(clip) * inv_w);
+		}
+		if (min_z < 0.0f)
+			return true;
+		//画面外(視錐台カリングで弾かれるべき物)は、ここでは判定しない
+		if (max_x < 0.0f || min_x >= static_cast<float>(width) || max_y < 0.0f || min_y >= static_cast<float>(height))
+			return true;
+
+		int x_begin = std::max(0, static_cast<int>(std::floor(min_x)));
+		int x_end = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(max_x)));
+		int y_begin = std::max(0, static_cast<int>(std::floor(min_y)));
+		int y_end = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(max_y)));
+		for (int ty = y_begin / static_cast<int>(TILE_HEIGHT); ty <= y_end / static_cast<int>(TILE_HEIGHT); ty++) {
+			for (int tx = x_begin / static_cast<int>(TILE_WIDTH); tx <= x_end / static_cast<int>(TILE_WIDTH); tx++) {
+				//タイルの一番奥よりAABBが奥なら、このタイルは完全に隠れている
+				if (tile_max_depth[static_cast<size_t>(ty) * tiles_x + tx] < min_z)
+					continue;
+				//決まらないタイルは、矩形と重なるピクセルを見る
+				int py_begin = std::max(y_begin, ty * static_cast<int>(TILE_HEIGHT));
+				int py_end = std::min(y_end, (ty + 1) * static_cast<int>(TILE_HEIGHT) - 1);
+				int px_begin = std::max(x_begin, tx * static_cast<int>(TILE_WIDTH));
+				int px_end = std::min(x_end, (tx + 1) * static_cast<int>(TILE_WIDTH) - 1);
+				for (int py = py_begin; py <= py_end; py++) {
+					const float* row = &depth[static_cast<size_t>(py) * width];
+					for (int px = px_begin; px <= px_end; px++) {
+						if (row[px] >= min_z)
+							return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include "System/SystemUtils/Thread/WorkerPool/WorkerPool.h"
+
+namespace System {
+	struct MeshInfo;
+
+	//-------------------------------------------------------------
+	// @brief CPUで低解像度の深度バッファを描いて、遮蔽されたインスタンスを弾くクラス
+	// @details 手前にある物(オクルーダー)の三角形を低解像度の深度バッファにラスタライズし、
+	//			インスタンスのAABBがその奥に完全に隠れているかを判定する。
+	//			・ラスタライズはエッジ関数をSSEで4ピクセルずつ評価する
+	//			・画面をタイル行の帯に分けて、帯毎に別スレッドで描く(帯同士は書き込み先が重ならない)。スレッドは毎フレーム使い回す
+	//			・タイル(8x8ピクセル)毎に最も奥の深度を持っておき、判定はまずタイル単位で行う
+	//			  (タイル単位で決まらない時だけピクセルを見る、階層的な判定)
+	//			判定は常に保守的で、迷ったら「見える」と返す。
+	//			オクルーダーの頂点が近クリップ面より手前にある三角形は描かない(描かなければ遮蔽が減るだけなので安全)
+	//-------------------------------------------------------------
+	class OcclusionCuller
+	{
+	public:
+		static constexpr unsigned int TILE_WIDTH = 8;
+		static constexpr unsigned int TILE_HEIGHT = 8;
+
+		//描画するオクルーダー1つ分
+		struct Occluder {
+			const MeshInfo* mesh = nullptr;				// 形状
+			unsigned int lod = 0;						// 使うLOD(粗いLODの方が速い)
+			DirectX::XMMATRIX world_view_projection;	// ワールド * ビュー * 射影
+		};
+	private:
+		//スクリーン空間に変換済みの三角形
+		struct ScreenTriangle {
+			float x[3];
+			float y[3];
+			float z[3];
+			int min_y;
+			int max_y;
+		};
+
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int tiles_x = 0;
+		unsigned int tiles_y = 0;
+		unsigned int thread_count = 1;
+		bool simd_enabled = true;
+		std::vector<float> depth;
+		std::vector<float> tile_max_depth;
+		std::vector<ScreenTriangle> triangles;
+		WorkerPool workers;
+
+		void SetupTriangles(const Occluder& occluder);
+		void RasterizeBand(unsigned int tile_row_begin, unsigned int tile_row_end);
+		void RasterizeTriangle(const ScreenTriangle& triangle, int band_min_y, int band_max_y);
+		void RasterizeTriangleScalar(const ScreenTriangle& triangle, int band_min_y, int band_max_y);
+	public:
+		//-------------------------------------------------------------
+		// @param [in] width_ 深度バッファの幅(タイル幅の倍数に切り上げる)
+		// @param [in] height_ 深度バッファの高さ(タイル高さの倍数に切り上げる)
+		// @param [in] thread_count_ ラスタライズに使うスレッド数(0ならハードウェアスレッド数)
+		//-------------------------------------------------------------
+		OcclusionCuller(unsigned int width_ = 320, unsigned int height_ = 184, unsigned int thread_count_ = 0);
+
+		// @brief 深度バッファを一番奥(1.0)で埋める
+		void Clear();
+
+		// @brief オクルーダーを深度バッファに描く
+		void RenderOccluders(const std::vector<Occluder>& occluders);
+
+		//-------------------------------------------------------------
+		// @brief AABBが見える可能性があるかどうか
+		//
+		// @param [in] box_min ローカル空間のAABBの最小点
+		// @param [in] box_max ローカル空間のAABBの最大点
+		// @param [in] world_view_projection ワールド * ビュー * 射影
+		// @return 遮蔽されていると確定できればfalse、それ以外はtrue
+		//-------------------------------------------------------------
+		bool IsVisible(const DirectX::XMFLOAT3& box_min, const DirectX::XMFLOAT3& box_max, const DirectX::XMMATRIX& world_view_projection) const;
+
+		// @brief SSE版とスカラー版のラスタライザを切り替える(スカラー版は検証用)
+		void SetSimdEnabled(bool enabled) { simd_enabled = enabled; }
+
+		unsigned int GetWidth() const { return width; }
+		unsigned int GetHeight() const { return height; }
+		const std::vector<float>& GetDepth() const { return depth; }
+	};
+}
@@ -5,3 +5,4 @@
 #include "System/SystemUtils/D3DBuffer/IndexBuffer/IndexBuffer.h"
 #include "System/SystemUtils/D3DBuffer/StructuredBuffer/StructuredBuffer.h"
 #include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/D3DBuffer/RWStructuredBuffer/RWStructuredBuffer.h"
@@ -5,16 +5,35 @@
 #include "System/SystemUtils/CommandQueue/CommandQueue.h"
 namespace System {
 
-	IndexBuffer::IndexBuffer(std::vector<unsigned int>& indices, D3D12_HEAP_TYPE heap_type)
+	IndexBuffer::IndexBuffer(std::vector<unsigned int>& indices, D3D12_HEAP_TYPE heap_type, DXGI_FORMAT format)
 	{
-		index_data = indices;
+		if (format == DXGI_FORMAT_UNKNOWN) {
+			//インデックスの最大値が16bitに収まるなら16bitにする
+			//頂点数が65536未満のメッシュ(Y Bot LODのサブメッシュなど)は、これだけでインデックスのメモリと帯域が半分になる
+			unsigned int max_index = 0;
+			for (unsigned int index : indices)
+				max_index = std::max(max_index, index);
+			format = SelectFormat(static_cast<size_t>(max_index) + 1);
+		}
+		index_format = format;
+		index_count = indices.size();
+		unsigned int index_size = GetIndexSize(index_format);
+		index_data.resize(index_count * index_size);
+		if (index_format == DXGI_FORMAT_R16_UINT) {
+			unsigned short* dst = reinterpret_cast<unsigned short*>(index_data.data());
+			for (size_t i = 0; i < index_count; i++)
+				dst[i] = static_cast<unsigned short>(indices[i]);
+		}
+		else {
+			std::copy(indices.begin(), indices.end(), reinterpret_cast<unsigned int*>(index_data.data()));
+		}
 		heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
 		heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
 		heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 		heap_properties.CreationNodeMask = 0;
 		heap_properties.VisibleNodeMask = 0;
 
-		resource_desc.Width = sizeof(unsigned int) * index_data.size();
+		resource_desc.Width = index_data.size();
 
 		resource_desc.Alignment = 0;
 		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
@@ -31,8 +50,8 @@ namespace System {
 			return;
 		}
 		ib_view.BufferLocation = d3d_resource->GetGPUVirtualAddress();
-		ib_view.Format = DXGI_FORMAT_R32_UINT;
-		ib_view.SizeInBytes = static_cast<unsigned int>(index_data.size() * sizeof(unsigned int));
+		ib_view.Format = index_format;
+		ib_view.SizeInBytes = static_cast<unsigned int>(index_data.size());
 		//インデックスバッファにデータを転送する
 		{
 			void* mapped_data = nullptr;
@@ -40,7 +59,7 @@ namespace System {
 			if (FAILED(hr)) {
 				return;
 			}
-			std::copy(index_data.begin(), index_data.end(), reinterpret_cast<unsigned int*>(mapped_data));
+			std::copy(index_data.begin(), index_data.end(), reinterpret_cast<unsigned char*>(mapped_data));
 			d3d_resource->Unmap(0, nullptr);
 		}
 
@@ -83,8 +102,8 @@ namespace System {
 
 			//ビューの更新
 			ib_view.BufferLocation = d3d_resource->GetGPUVirtualAddress();
-			ib_view.Format = DXGI_FORMAT_R32_UINT;
-			ib_view.SizeInBytes = static_cast<unsigned int>(index_data.size() * sizeof(unsigned int));
+			ib_view.Format = index_format;
+			ib_view.SizeInBytes = static_cast<unsigned int>(index_data.size());
 
 		}
 		is_valid = true;
@@ -7,13 +7,27 @@ namespace System {
 	{
 	private:
 		D3D12_INDEX_BUFFER_VIEW ib_view = {};
-		std::vector<unsigned int> index_data;
+		//16bitと32bitのどちらでも持てるように、バイト列で保持する
+		std::vector<unsigned char> index_data;
+		size_t index_count = 0;
+		DXGI_FORMAT index_format = DXGI_FORMAT_R32_UINT;
 		void* mapped_data = nullptr;
 	private:
 	public:
-		IndexBuffer(std::vector<unsigned int>& indices, D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_UPLOAD);
+		// @brief formatにDXGI_FORMAT_UNKNOWNを渡すと、インデックスの最大値から16bitか32bitかを自動で選ぶ
+		IndexBuffer(std::vector<unsigned int>& indices, D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_UPLOAD, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN);
 		const D3D12_INDEX_BUFFER_VIEW& GetView() const { return ib_view; }
 		const D3D12_INDEX_BUFFER_VIEW* GetViewPtr() const { return &ib_view; }
+		DXGI_FORMAT GetFormat() const { return index_format; }
+		size_t GetIndexCount() const { return index_count; }
+
+		// @brief 頂点数から、インデックスに必要なフォーマットを選ぶ(65536頂点未満なら16bit)
+		static DXGI_FORMAT SelectFormat(size_t vertex_count) {
+			return vertex_count <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		}
+		static unsigned int GetIndexSize(DXGI_FORMAT format) {
+			return format == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+		}
 	};
 
 }
@@ -0,0 +1,33 @@
+﻿#include "RWStructuredBuffer.h"
+
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+namespace System {
+
+	RWStructuredBuffer::RWStructuredBuffer(size_t element_size_, size_t element_count_)
+	{
+		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resource_desc.Alignment = 0;
+		resource_desc.Width = element_size_ * element_count_;
+		resource_desc.Height = 1;
+		resource_desc.DepthOrArraySize = 1;
+		resource_desc.MipLevels = 1;
+		resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+		resource_desc.SampleDesc.Count = 1;
+		resource_desc.SampleDesc.Quality = 0;
+		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		resource_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heap_properties.CreationNodeMask = 0;
+		heap_properties.VisibleNodeMask = 0;
+		HRESULT hr = DirectX12Manager::Instance()->GetDevice()->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(d3d_resource.GetAddressOf()));
+		if (FAILED(hr)) {
+			return;
+		}
+		current_state = D3D12_RESOURCE_STATE_COMMON;
+		element_size = element_size_;
+		element_count = element_count_;
+		is_valid = true;
+	}
+}
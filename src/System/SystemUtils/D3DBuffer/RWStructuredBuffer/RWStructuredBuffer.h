@@ -0,0 +1,58 @@
+﻿#pragma once
+#include "System/SystemUtils/D3DBuffer/D3DBuffer/D3DBuffer.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief GPUから書き込めるバッファ(RWStructuredBuffer / RWByteAddressBuffer用)
+	// @details デフォルトヒープにUAVを許可して作るので、CPUからは直接触れない。
+	//			コンピュートシェーダーで書いて、同じフレームの描画で読む使い方を想定していて、
+	//			ルートディスクリプタで渡すのでディスクリプタヒープは使わない。
+	//			使い道によって状態(UAV・SRV・インダイレクト引数・コピー先)を行き来するので、現在の状態を覚えておく
+	//-------------------------------------------------------------
+	class RWStructuredBuffer :public D3DBuffer
+	{
+	private:
+		size_t element_size = 0;
+		size_t element_count = 0;
+		D3D12_RESOURCE_STATES current_state = D3D12_RESOURCE_STATE_COMMON;
+	public:
+		RWStructuredBuffer(size_t element_size_, size_t element_count_);
+		size_t GetElementSize() const { return element_size; }
+		size_t GetElementCount() const { return element_count; }
+		size_t GetBufferSize() const { return element_size * element_count; }
+		D3D12_RESOURCE_STATES GetState() const { return current_state; }
+		// @brief 覚えている状態をCOMMONに戻す。バッファはExecuteCommandListsが終わると暗黙にCOMMONへ戻るので、次のコマンドリストの頭で呼ぶ
+		void ResetState() { current_state = D3D12_RESOURCE_STATE_COMMON; }
+
+		//-------------------------------------------------------------
+		// @brief 状態を遷移させるバリアを積む
+		// @details 既にその状態なら何もしない。UAVのまま続けて書く場合は、UAVバリアを積む
+		//
+		// @details 生のコマンドリストでもCommandStreamRecorderなどのラッパーでも渡せるようにテンプレートにしてある
+		//
+		// @param [in] cmd_list バリアを積むコマンドリスト
+		// @param [in] state 遷移後の状態
+		//-------------------------------------------------------------
+		template <class CommandList>
+		void Transition(CommandList* cmd_list, D3D12_RESOURCE_STATES state) {
+			D3D12_RESOURCE_BARRIER barrier = {};
+			if (current_state == state) {
+				//UAVからUAVへは遷移ではなく、前の書き込みを待つためのUAVバリアになる
+				if (state != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+					return;
+				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+				barrier.UAV.pResource = d3d_resource.Get();
+				cmd_list->ResourceBarrier(1, &barrier);
+				return;
+			}
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barrier.Transition.pResource = d3d_resource.Get();
+			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			barrier.Transition.StateBefore = current_state;
+			barrier.Transition.StateAfter = state;
+			cmd_list->ResourceBarrier(1, &barrier);
+			current_state = state;
+		}
+	};
+}
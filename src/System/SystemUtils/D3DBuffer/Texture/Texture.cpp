@@ -1,104 +1,14 @@
 #include "Texture.h"
 #include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
 #include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
 #include "System/SystemUtils/CommandQueue/CommandQueue.h"
 #include "System/SystemUtils/Descriptors/View/View.h"
+#include "System/SystemUtils/TextureTools/MipGenerator/MipGenerator.h"
+#include "System/SystemUtils/TextureTools/DDSFile/DDSFile.h"
+#include "System/SystemUtils/TextureTools/SubresourceCopier/SubresourceCopier.h"
 
 namespace System {
-	unsigned int GetBytesPerPixel(DXGI_FORMAT format)
-	{
-		switch (format)
-		{
-		case DXGI_FORMAT_R32G32B32A32_TYPELESS:
-		case DXGI_FORMAT_R32G32B32A32_FLOAT:
-		case DXGI_FORMAT_R32G32B32A32_UINT:
-		case DXGI_FORMAT_R32G32B32A32_SINT:
-			return 16;
-
-		case DXGI_FORMAT_R32G32B32_TYPELESS:
-		case DXGI_FORMAT_R32G32B32_FLOAT:
-		case DXGI_FORMAT_R32G32B32_UINT:
-		case DXGI_FORMAT_R32G32B32_SINT:
-			return 12;
-
-		case DXGI_FORMAT_R16G16B16A16_TYPELESS:
-		case DXGI_FORMAT_R16G16B16A16_FLOAT:
-		case DXGI_FORMAT_R16G16B16A16_UNORM:
-		case DXGI_FORMAT_R16G16B16A16_UINT:
-		case DXGI_FORMAT_R16G16B16A16_SNORM:
-		case DXGI_FORMAT_R16G16B16A16_SINT:
-		case DXGI_FORMAT_R32G32_TYPELESS:
-		case DXGI_FORMAT_R32G32_FLOAT:
-		case DXGI_FORMAT_R32G32_UINT:
-		case DXGI_FORMAT_R32G32_SINT:
-		case DXGI_FORMAT_R32G8X24_TYPELESS:
-		case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
-		case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
-		case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
-			return 8;
-
-		case DXGI_FORMAT_R10G10B10A2_TYPELESS:
-		case DXGI_FORMAT_R10G10B10A2_UNORM:
-		case DXGI_FORMAT_R10G10B10A2_UINT:
-		case DXGI_FORMAT_R11G11B10_FLOAT:
-		case DXGI_FORMAT_R8G8B8A8_TYPELESS:
-		case DXGI_FORMAT_R8G8B8A8_UNORM:
-		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-		case DXGI_FORMAT_R8G8B8A8_UINT:
-		case DXGI_FORMAT_R8G8B8A8_SNORM:
-		case DXGI_FORMAT_R8G8B8A8_SINT:
-		case DXGI_FORMAT_R16G16_TYPELESS:
-		case DXGI_FORMAT_R16G16_FLOAT:
-		case DXGI_FORMAT_R16G16_UNORM:
-		case DXGI_FORMAT_R16G16_UINT:
-		case DXGI_FORMAT_R16G16_SNORM:
-		case DXGI_FORMAT_R16G16_SINT:
-		case DXGI_FORMAT_R32_TYPELESS:
-		case DXGI_FORMAT_D32_FLOAT:
-		case DXGI_FORMAT_R32_FLOAT:
-		case DXGI_FORMAT_R32_UINT:
-		case DXGI_FORMAT_R32_SINT:
-		case DXGI_FORMAT_R24G8_TYPELESS:
-		case DXGI_FORMAT_D24_UNORM_S8_UINT:
-		case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
-		case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
-
-		case DXGI_FORMAT_B8G8R8A8_UNORM:
-		case DXGI_FORMAT_B8G8R8X8_UNORM:
-		case DXGI_FORMAT_B8G8R8A8_TYPELESS:
-		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-		case DXGI_FORMAT_B8G8R8X8_TYPELESS:
-		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-			return 4;
-
-		case DXGI_FORMAT_R8G8_TYPELESS:
-		case DXGI_FORMAT_R8G8_UNORM:
-		case DXGI_FORMAT_R8G8_UINT:
-		case DXGI_FORMAT_R8G8_SNORM:
-		case DXGI_FORMAT_R8G8_SINT:
-		case DXGI_FORMAT_R16_TYPELESS:
-		case DXGI_FORMAT_R16_FLOAT:
-		case DXGI_FORMAT_D16_UNORM:
-		case DXGI_FORMAT_R16_UNORM:
-		case DXGI_FORMAT_R16_UINT:
-		case DXGI_FORMAT_R16_SNORM:
-		case DXGI_FORMAT_R16_SINT:
-			return 2;
-
-		case DXGI_FORMAT_R8_TYPELESS:
-		case DXGI_FORMAT_R8_UNORM:
-		case DXGI_FORMAT_R8_UINT:
-		case DXGI_FORMAT_R8_SNORM:
-		case DXGI_FORMAT_R8_SINT:
-		case DXGI_FORMAT_A8_UNORM:
-			return 1;
-
-		default:
-			return 0; // 未対応のフォーマットの場合は0を返す
-		}
-	}
-
-
 	Texture::Texture(ComPtr<ID3D12Resource>& resource, std::unique_ptr<ShaderResourceView> srv_, std::unique_ptr<RenderTargetView> rtv_, std::unique_ptr<DepthStencilView> dsv_)
 	{
 		if (!resource) {
@@ -115,6 +25,22 @@ namespace System {
 		width_32 = static_cast<unsigned int>(resource_desc.Width);
 		is_valid = true;
 	}
+	int Texture::ReplaceResource(ComPtr<ID3D12Resource>& resource, std::unique_ptr<ShaderResourceView>& spare_srv)
+	{
+		if (!resource || !spare_srv || !srv || rtv || dsv) {
+			return -1;
+		}
+		//ミップの数や大きさが変わるので、descは新しいリソースから作り直す
+		D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = DEFAULT_VIEW_DESC_HELPER::GetDefaultSRVDesc(resource.Get());
+		DirectX12Manager::Instance()->GetDevice()->CreateShaderResourceView(resource.Get(), &srv_desc, spare_srv->GetCPUHandle());
+		spare_srv->Rebind(resource.Get(), srv_desc);
+		//古いリソースとSRVは呼び出し側に返す
+		srv.swap(spare_srv);
+		d3d_resource.Swap(resource);
+		resource_desc = d3d_resource->GetDesc();
+		width_32 = static_cast<unsigned int>(resource_desc.Width);
+		return 0;
+	}
 	HRESULT Texture::Loader::CreateUploadBuffer(size_t size, ComPtr<ID3D12Resource>& upload_buffer)
 	{
 		D3D12_RESOURCE_DESC resource_desc = {};
@@ -143,50 +69,69 @@ namespace System {
 		return hr;
 	}
 
-	HRESULT Texture::Loader::UploadTextureData(ID3D12Resource* upload_buffer, void* data, unsigned int width_in_bytes, unsigned int height, unsigned short depth)
+	HRESULT Texture::Loader::GetSubresourceFootprints(const D3D12_RESOURCE_DESC& desc, SubresourceFootprints& out_footprints)
+	{
+		//3Dテクスチャは奥行きがサブリソースに含まれるので、サブリソースはミップの数だけ
+		UINT item_count = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+		UINT subresource_count = desc.MipLevels * item_count;
+		out_footprints.layouts.resize(subresource_count);
+		out_footprints.row_counts.resize(subresource_count);
+		out_footprints.row_sizes.resize(subresource_count);
+		out_footprints.total_size = 0;
+		//行のピッチ(256バイト境界)やサブリソースの先頭(512バイト境界)の揃え方は、デバイスに計算してもらう
+		DirectX12Manager::Instance()->GetDevice()->GetCopyableFootprints(&desc, 0, subresource_count, 0,
+			out_footprints.layouts.data(), out_footprints.row_counts.data(), out_footprints.row_sizes.data(), &out_footprints.total_size);
+		if (out_footprints.total_size == 0 || out_footprints.total_size == UINT64_MAX) {
+			return E_FAIL;
+		}
+		return S_OK;
+	}
+
+	HRESULT Texture::Loader::UploadTextureData(ID3D12Resource* upload_buffer, const DirectX::ScratchImage& scratch, const SubresourceFootprints& footprints)
 	{
-		unsigned int row_pitch = (width_in_bytes + 255) & ~255; //行のピッチは256バイトアラインメントでなければならないため、256の倍数に切り上げる
+		const DirectX::TexMetadata& metadata = scratch.GetMetadata();
+		bool is_3d = metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D;
+		size_t item_count = is_3d ? 1 : metadata.arraySize;
+		if (footprints.layouts.size() < item_count * metadata.mipLevels) {
+			return E_INVALIDARG;
+		}
 		void* mapped_data = nullptr;
 		HRESULT hr = upload_buffer->Map(0, nullptr, &mapped_data);
 		if (FAILED(hr)) {
 			return hr;
 		}
-		unsigned char* src_data = static_cast<unsigned char*>(data);
-		unsigned char* dst_data = static_cast<unsigned char*>(mapped_data);
-
-		for (unsigned short z = 0; z < depth; ++z) {
-			for (unsigned int y = 0; y < height; ++y) {
-				std::copy(src_data, src_data + row_pitch, dst_data);
-				//元データは1行分だけ進める
-				src_data += width_in_bytes;
-				//アップロードバッファは切り上げた分も含めて1行分進める
-				dst_data += row_pitch;
+		unsigned char* dst_base = static_cast<unsigned char*>(mapped_data);
+
+		//サブリソースの番号は、ミップ + 配列の要素 * ミップの数
+		for (size_t item = 0; item < item_count && SUCCEEDED(hr); ++item) {
+			for (size_t mip = 0; mip < metadata.mipLevels; ++mip) {
+				size_t subresource = mip + item * metadata.mipLevels;
+				const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.layouts[subresource];
+				size_t row_count = footprints.row_counts[subresource];
+				size_t row_pitch = layout.Footprint.RowPitch;
+				//3Dテクスチャは奥行き1枚毎に画像が分かれているが、同じミップの面はslicePitch毎に続けて並んでいる
+				const DirectX::Image* image = scratch.GetImage(mip, is_3d ? 0 : item, 0);
+				if (!image) {
+					hr = E_FAIL;
+					break;
+				}
+				//アップロードバッファは行毎に256バイト境界に揃っているので、行毎にコピーする(ブロック圧縮はブロックの行毎)
+				SubresourceCopier::CopySubresource(dst_base + layout.Offset, row_pitch, row_pitch * row_count,
+					image->pixels, image->rowPitch, image->slicePitch,
+					static_cast<size_t>(footprints.row_sizes[subresource]), row_count, layout.Footprint.Depth);
 			}
 		}
 
 		upload_buffer->Unmap(0, nullptr);
-		return S_OK;
+		return hr;
 	}
-	HRESULT Texture::Loader::CopyUploadBufferToTexture(ID3D12Resource* upload_buffer, ID3D12Resource* texture_resource)
+	HRESULT Texture::Loader::CopyUploadBufferToTexture(ID3D12Resource* upload_buffer, ID3D12Resource* texture_resource, const SubresourceFootprints& footprints,
+		ID3D12DeviceContext* context, CommandQueue* queue)
 	{
-		D3D12_RESOURCE_DESC desc = texture_resource->GetDesc();
-
-		D3D12_TEXTURE_COPY_LOCATION dst_location = {};
-		dst_location.pResource = texture_resource;
-		dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		dst_location.SubresourceIndex = 0;
-
-		D3D12_TEXTURE_COPY_LOCATION src_location = {};
-		src_location.pResource = upload_buffer;
-		src_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-		src_location.PlacedFootprint.Offset = 0;
-		src_location.PlacedFootprint.Footprint.Format = desc.Format;
-		src_location.PlacedFootprint.Footprint.Width = static_cast<unsigned int>(desc.Width);
-		src_location.PlacedFootprint.Footprint.Height = static_cast<unsigned int>(desc.Height);
-		src_location.PlacedFootprint.Footprint.Depth = static_cast<unsigned int>(desc.DepthOrArraySize);
-		src_location.PlacedFootprint.Footprint.RowPitch = (GetBytesPerPixel(desc.Format) * static_cast<unsigned int>(desc.Width) + 255) & ~255;
-
-		ID3D12DeviceContext* context = DirectX12Manager::Instance()->GetCopyContext();
+		PROFILE_FUNCTION();
+		if (!context) {
+			context = DirectX12Manager::Instance()->GetCopyContext();
+		}
 		if (!context || !context->IsValid())
 		{
 			return E_FAIL;
@@ -194,11 +139,24 @@ namespace System {
 		ID3D12GraphicsCommandList* cmd_list = context->GetCommandList();
 		std::vector<ID3D12DeviceContext*> contexts = { context };
 
-		CommandQueue* copy_queue = DirectX12Manager::Instance()->GetCopyQueue();
+		CommandQueue* copy_queue = queue ? queue : DirectX12Manager::Instance()->GetCopyQueue();
 
 		context->ResetCommandList();
 
-		cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
+		//サブリソース毎に、アップロードバッファ上の配置を指定してコピーする
+		for (size_t i = 0; i < footprints.layouts.size(); ++i) {
+			D3D12_TEXTURE_COPY_LOCATION dst_location = {};
+			dst_location.pResource = texture_resource;
+			dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst_location.SubresourceIndex = static_cast<UINT>(i);
+
+			D3D12_TEXTURE_COPY_LOCATION src_location = {};
+			src_location.pResource = upload_buffer;
+			src_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src_location.PlacedFootprint = footprints.layouts[i];
+
+			cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
+		}
 
 
 		context->CloseCommandList();
@@ -208,13 +166,13 @@ namespace System {
 
 		return S_OK;
 	}
-	HRESULT Texture::Loader::CreateViewsForTexture(ID3D12Resource* texture_resource, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags, std::unique_ptr<ShaderResourceView>& out_srv, std::unique_ptr<RenderTargetView>& out_rtv, std::unique_ptr<DepthStencilView>& out_dsv)
+	HRESULT Texture::Loader::CreateViewsForTexture(ID3D12Resource* texture_resource, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags, std::unique_ptr<ShaderResourceView>& out_srv, std::unique_ptr<RenderTargetView>& out_rtv, std::unique_ptr<DepthStencilView>& out_dsv, D3D12_SHADER_RESOURCE_VIEW_DESC* srv_desc)
 	{
 		//とりあえずSRVだけ作っておく
 		{
 
 
-			out_srv = DirectX12Manager::Instance()->CreateShaderResourceView(texture_resource, nullptr);
+			out_srv = DirectX12Manager::Instance()->CreateShaderResourceView(texture_resource, srv_desc);
 			if (!out_srv) {
 				return E_FAIL;
 			}
@@ -275,22 +233,162 @@ namespace System {
 				IID_PPV_ARGS(texture_resource.GetAddressOf()));
 		return hr;
 	}
-	std::unique_ptr<Texture> Texture::Loader::LoadFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags)
+	HRESULT Texture::Loader::UploadMappedData(ID3D12Resource* upload_buffer, const DDSFile& dds, UINT first_mip, const SubresourceFootprints& footprints)
 	{
-		if (path.empty() || !std::filesystem::exists(path)) {
+		PROFILE_FUNCTION();
+		//ファイルの中のサブリソースは ミップ + 配列の要素 * ミップの数 の順。転送先はfirst_mipより細かいミップを持たない
+		UINT mip_levels = dds.GetDescription().mip_levels;
+		UINT streamed_mips = mip_levels - first_mip;
+		if (first_mip >= mip_levels || footprints.layouts.size() != dds.GetSubresourceCount() / mip_levels * streamed_mips) {
+			return E_INVALIDARG;
+		}
+		void* mapped_data = nullptr;
+		HRESULT hr = upload_buffer->Map(0, nullptr, &mapped_data);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		unsigned char* dst_base = static_cast<unsigned char*>(mapped_data);
+
+		//ファイルの中では行が詰めて並んでいるので、アップロードバッファの行のピッチに合わせて行毎にコピーする
+		for (size_t subresource = 0; subresource < footprints.layouts.size(); ++subresource) {
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.layouts[subresource];
+			size_t row_size = static_cast<size_t>(footprints.row_sizes[subresource]);
+			size_t row_count = footprints.row_counts[subresource];
+			size_t src_subresource = first_mip + subresource % streamed_mips + subresource / streamed_mips * mip_levels;
+			SubresourceCopier::CopySubresource(dst_base + layout.Offset, layout.Footprint.RowPitch, layout.Footprint.RowPitch * row_count,
+				dds.GetSubresourceData(src_subresource), row_size, row_size * row_count,
+				row_size, row_count, layout.Footprint.Depth);
+		}
+
+		upload_buffer->Unmap(0, nullptr);
+		return S_OK;
+	}
+	HRESULT Texture::Loader::CreateResourceFromDDS(const DDSFile& dds, UINT first_mip, D3D12_RESOURCE_FLAGS flags, ComPtr<ID3D12Resource>& out_resource,
+		ID3D12DeviceContext* context, CommandQueue* queue)
+	{
+		PROFILE_FUNCTION();
+		if (!dds.IsOpen() || first_mip >= dds.GetDescription().mip_levels) {
+			return E_INVALIDARG;
+		}
+		//first_mipをミップ0とするリソースにする(3Dテクスチャは奥行きも縮む)
+		D3D12_RESOURCE_DESC desc = dds.GetResourceDesc(flags);
+		desc.Width = std::max<UINT64>(1, desc.Width >> first_mip);
+		desc.Height = std::max(1u, desc.Height >> first_mip);
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) {
+			desc.DepthOrArraySize = static_cast<UINT16>(std::max(1, desc.DepthOrArraySize >> first_mip));
+		}
+		desc.MipLevels = static_cast<UINT16>(desc.MipLevels - first_mip);
+
+		//アップロードバッファ上の配置は、デバイスを使わずにDDSFileで計算する(GetCopyableFootprintsと同じもの)
+		UINT item_count = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+		UINT subresource_count = desc.MipLevels * item_count;
+		SubresourceFootprints footprints;
+		footprints.layouts.resize(subresource_count);
+		footprints.row_counts.resize(subresource_count);
+		footprints.row_sizes.resize(subresource_count);
+		HRESULT hr = DDSFile::GetCopyableFootprints(desc, 0, subresource_count, 0,
+			footprints.layouts.data(), footprints.row_counts.data(), footprints.row_sizes.data(), &footprints.total_size);
+		if (FAILED(hr)) {
+			return hr;
+		}
+
+		ComPtr<ID3D12Resource> texture_resource;
+		hr = CreateEmptyTexture(desc, texture_resource);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		ComPtr<ID3D12Resource> upload_buffer;
+		hr = CreateUploadBuffer(static_cast<size_t>(footprints.total_size), upload_buffer);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		hr = UploadMappedData(upload_buffer.Get(), dds, first_mip, footprints);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		hr = CopyUploadBufferToTexture(upload_buffer.Get(), texture_resource.Get(), footprints, context, queue);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		out_resource.Swap(texture_resource);
+		return S_OK;
+	}
+	std::unique_ptr<Texture> Texture::Loader::CreateFromResource(ComPtr<ID3D12Resource>& resource, D3D12_RESOURCE_FLAGS flags, D3D12_SHADER_RESOURCE_VIEW_DESC* srv_desc)
+	{
+		if (!resource) {
+			return nullptr;
+		}
+		std::unique_ptr<ShaderResourceView> srv = nullptr;
+		std::unique_ptr<RenderTargetView> rtv = nullptr;
+		std::unique_ptr<DepthStencilView> dsv = nullptr;
+		if (FAILED(CreateViewsForTexture(resource.Get(), resource->GetDesc().Format, flags, srv, rtv, dsv, srv_desc))) {
+			return nullptr;
+		}
+		return std::make_unique<Texture>(resource, std::move(srv), std::move(rtv), std::move(dsv));
+	}
+	std::unique_ptr<Texture> Texture::Loader::LoadFromDDS(const DDSFile& dds, UINT first_mip, D3D12_RESOURCE_FLAGS flags)
+	{
+		PROFILE_FUNCTION();
+		ComPtr<ID3D12Resource> texture_resource;
+		if (FAILED(CreateResourceFromDDS(dds, first_mip, flags, texture_resource))) {
 			return nullptr;
 		}
+		return CreateFromResource(texture_resource, flags);
+	}
+	HRESULT Texture::Loader::CreateResourceFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags, bool generate_mips, ComPtr<ID3D12Resource>& out_resource,
+		ID3D12DeviceContext* context, CommandQueue* queue)
+	{
+		PROFILE_FUNCTION();
+		if (path.empty() || !std::filesystem::exists(path)) {
+			return E_INVALIDARG;
+		}
+
+		//DDSはクック済み(ブロック圧縮・ミップ作成済み)のものとして、中身をそのまま転送する。それ以外はWICで読む
+		std::wstring extension = std::filesystem::path(path).extension().wstring();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+		if (extension == L".dds") {
+			//まずはメモリマップして、ファイルから直接アップロードバッファにコピーする。未対応のフォーマットだけDirectXTexで読む
+			DDSFile dds;
+			HRESULT hr = dds.Open(path);
+			if (SUCCEEDED(hr)) {
+				hr = CreateResourceFromDDS(dds, 0, flags, out_resource, context, queue);
+			}
+			if (hr != E_NOTIMPL) {
+				return hr;
+			}
+		}
 
-		std::vector<unsigned char> file_data;
-		//あとコピー用のContextも作ってアップロードバッファからGPU上のテクスチャリソースにデータを転送する処理も必要になる(あとでやります)
 		DirectX::TexMetadata metadata = {};
 		DirectX::ScratchImage scratch = {};
-		//とりあえず一般的なフォーマットのテクスチャのみ対応
-		HRESULT hr = DirectX::LoadFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, &metadata, scratch);
+		HRESULT hr = extension == L".dds"
+			? DirectX::LoadFromDDSFile(path.c_str(), DirectX::DDS_FLAGS_NONE, &metadata, scratch)
+			: DirectX::LoadFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, &metadata, scratch);
 		if (FAILED(hr)) {
-			return nullptr;
+			return hr;
 		}
+		//PNGやJPGはミップを持たないので、1x1までのミップを作る(縮小表示した時のちらつきを抑え、サンプリングの帯域も減らす)
+		//ブロック圧縮のフォーマットはCPUで縮小できないので、ミップはクックする時に作っておくこと
+		if (generate_mips && metadata.mipLevels == 1 && metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE2D
+			&& !DirectX::IsCompressed(metadata.format)
+			&& MipGenerator::CalcMipCount(metadata.width, metadata.height) > 1) {
+			DirectX::ScratchImage mip_chain;
+			//作れなかった場合は、ミップ無しのまま使う
+			if (SUCCEEDED(MipGenerator().Generate(scratch, mip_chain))) {
+				scratch = std::move(mip_chain);
+			}
+		}
+
+		return CreateResourceFromImage(scratch, flags, out_resource, context, queue);
+	}
 
+	HRESULT Texture::Loader::CreateResourceFromImage(const DirectX::ScratchImage& scratch, D3D12_RESOURCE_FLAGS flags, ComPtr<ID3D12Resource>& out_resource,
+		ID3D12DeviceContext* context, CommandQueue* queue)
+	{
+		PROFILE_FUNCTION();
+		if (scratch.GetImageCount() == 0) {
+			return E_INVALIDARG;
+		}
+		const DirectX::TexMetadata& metadata = scratch.GetMetadata();
 		D3D12_RESOURCE_DESC desc = {};
 		desc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(metadata.dimension);
 		desc.Alignment = 0;
@@ -306,37 +404,42 @@ namespace System {
 
 
 		ComPtr<ID3D12Resource> texture_resource;
-		hr = CreateEmptyTexture(desc, texture_resource);
+		HRESULT hr = CreateEmptyTexture(desc, texture_resource);
 		if (FAILED(hr)) {
-			return nullptr;
+			return hr;
 		}
 
-		size_t row_pitch = GetBytesPerPixel(desc.Format) * desc.Width;
-		row_pitch = (row_pitch + 255) & ~255; // 256バイト境界に揃える
-		size_t total_bytes = row_pitch * desc.Height * desc.DepthOrArraySize;
+		//全てのミップ・配列の要素を、1つのアップロードバッファにまとめて転送する
+		SubresourceFootprints footprints;
+		hr = GetSubresourceFootprints(desc, footprints);
+		if (FAILED(hr)) {
+			return hr;
+		}
 
 		ComPtr<ID3D12Resource> upload_buffer;
-		hr = CreateUploadBuffer(total_bytes, upload_buffer);
+		hr = CreateUploadBuffer(static_cast<size_t>(footprints.total_size), upload_buffer);
 		if (FAILED(hr)) {
-			return nullptr;
+			return hr;
 		}
-		hr = UploadTextureData(upload_buffer.Get(), scratch.GetImage(0, 0, 0)->pixels, GetBytesPerPixel(desc.Format) * desc.Width, desc.Height, desc.DepthOrArraySize);
+		hr = UploadTextureData(upload_buffer.Get(), scratch, footprints);
 		if (FAILED(hr)) {
-			return nullptr;
+			return hr;
 		}
-		hr = CopyUploadBufferToTexture(upload_buffer.Get(), texture_resource.Get());
+		hr = CopyUploadBufferToTexture(upload_buffer.Get(), texture_resource.Get(), footprints, context, queue);
 		if (FAILED(hr)) {
-			return nullptr;
+			return hr;
 		}
-
-		std::unique_ptr<ShaderResourceView> srv = nullptr;
-		std::unique_ptr<RenderTargetView> rtv = nullptr;
-		std::unique_ptr<DepthStencilView> dsv = nullptr;
-		hr = CreateViewsForTexture(texture_resource.Get(), desc.Format, flags, srv, rtv, dsv);
-		if (FAILED(hr)) {
+		out_resource.Swap(texture_resource);
+		return S_OK;
+	}
+	std::unique_ptr<Texture> Texture::Loader::LoadFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags, bool generate_mips)
+	{
+		PROFILE_FUNCTION();
+		ComPtr<ID3D12Resource> texture_resource;
+		if (FAILED(CreateResourceFromFile(path, flags, generate_mips, texture_resource))) {
 			return nullptr;
 		}
-		return std::make_unique<Texture>(texture_resource, std::move(srv), std::move(rtv), std::move(dsv));
+		return CreateFromResource(texture_resource, flags);
 	}
 
 	std::unique_ptr<Texture> Texture::Loader::CreateEmpty(const D3D12_RESOURCE_DESC& desc, D3D12_CLEAR_VALUE* p_clear_value)
@@ -421,6 +524,16 @@ namespace System {
 		if (FAILED(hr)) {
 			return -1;
 		}
+		return SaveImageToFile(scratch, path);
+	}
+
+	int Texture::Loader::SaveImageToFile(const DirectX::ScratchImage& scratch, const std::wstring& path)
+	{
+		std::wstring extension = std::filesystem::path(path).extension().wstring();
+		if (path.empty() || extension.empty() || scratch.GetImageCount() == 0) {
+			return -1;
+		}
+		HRESULT hr = S_OK;
 		SaveFormat format = GetSaveFormatFromExtension(extension);
 
 		switch (format)
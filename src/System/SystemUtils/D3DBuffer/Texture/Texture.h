@@ -7,6 +7,9 @@ namespace System {
 	class RenderTargetView;
 	class DepthStencilView;
 	class ShaderResourceView;
+	class DDSFile;
+	class ID3D12DeviceContext;
+	class CommandQueue;
 
 	class Texture final :public D3DBuffer
 	{
@@ -25,19 +28,68 @@ namespace System {
 		const unsigned short ArraySize() const { return resource_desc.DepthOrArraySize; }
 		const size_t& Width64()const { return resource_desc.Width; }// 64ビット版の幅。幅が4GBを超える可能性がある場合はこちらを使用する必要がある
 
+		//-------------------------------------------------------------
+		// @brief リソースを差し替え、SRVをspare_srvのディスクリプタに作ってそちらに切り替える(ストリーミングでミップの数が変わった時用)
+		// @details 実行中のフレームは古いディスクリプタで古いリソースを読んでいるので、どちらも書き換えない。
+		//			ディスクリプタの番号は変わるので、シェーダーに渡す番号はSrv()から読み直すこと。
+		//			古いリソースはresourceに、古いSRVはspare_srvに入れて返すので、GPUが使い終わってから解放・再利用すること。
+		//			RTVやDSVを持つテクスチャは差し替えられない
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int ReplaceResource(ComPtr<ID3D12Resource>& resource, std::unique_ptr<ShaderResourceView>& spare_srv);
+
 		class Loader final
 		{
 		private:
+			// @brief アップロードバッファ上での、サブリソース(ミップ・配列の要素)毎の配置
+			struct SubresourceFootprints {
+				std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;	// 先頭からのオフセットと、行のピッチ(256バイト境界)
+				std::vector<UINT> row_counts;		// 行数(ブロック圧縮のフォーマットは、ブロックの行数)
+				std::vector<UINT64> row_sizes;		// 1行の実際のバイト数
+				UINT64 total_size = 0;				// アップロードバッファに必要なサイズ
+			};
 			static HRESULT CreateEmptyTexture(const D3D12_RESOURCE_DESC& desc, ComPtr<ID3D12Resource>& texture_resource, D3D12_CLEAR_VALUE* p_clear_value = nullptr);
 			static HRESULT CreateUploadBuffer(size_t size, ComPtr<ID3D12Resource>& upload_buffer);
-			static HRESULT UploadTextureData(ID3D12Resource* upload_buffer, void* data, unsigned int row_pitch, unsigned int height, unsigned short depth = 1U);
-			static HRESULT CopyUploadBufferToTexture(ID3D12Resource* upload_buffer, ID3D12Resource* texture_resource);
-			static HRESULT CreateViewsForTexture(ID3D12Resource* texture_resource, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags, std::unique_ptr<ShaderResourceView>& out_srv, std::unique_ptr<RenderTargetView>& out_rtv, std::unique_ptr<DepthStencilView>& out_dsv);
+			static HRESULT GetSubresourceFootprints(const D3D12_RESOURCE_DESC& desc, SubresourceFootprints& out_footprints);
+			static HRESULT UploadTextureData(ID3D12Resource* upload_buffer, const DirectX::ScratchImage& scratch, const SubresourceFootprints& footprints);
+			// @param [in] context, queue 転送に使うコンテキストとキュー。nullptrならDirectX12Managerのコピー用のもの
+			static HRESULT CopyUploadBufferToTexture(ID3D12Resource* upload_buffer, ID3D12Resource* texture_resource, const SubresourceFootprints& footprints,
+				ID3D12DeviceContext* context = nullptr, CommandQueue* queue = nullptr);
+			static HRESULT UploadMappedData(ID3D12Resource* upload_buffer, const DDSFile& dds, UINT first_mip, const SubresourceFootprints& footprints);
+			// @param [in] srv_desc nullptrなら、リソースに合わせた既定のSRVを作る
+			static HRESULT CreateViewsForTexture(ID3D12Resource* texture_resource, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags, std::unique_ptr<ShaderResourceView>& out_srv, std::unique_ptr<RenderTargetView>& out_rtv, std::unique_ptr<DepthStencilView>& out_dsv, D3D12_SHADER_RESOURCE_VIEW_DESC* srv_desc = nullptr);
 
 		public:
-			static std::unique_ptr<Texture> LoadFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+			// @param generate_mips trueなら、ミップを持たない2Dテクスチャに1x1までのミップを作って一緒に転送する
+			static std::unique_ptr<Texture> LoadFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE, bool generate_mips = true);
+			//-------------------------------------------------------------
+			// @brief LoadFromFileのうち、リソースを作って転送するところまで(ビューは作らない)
+			// @details ディスクリプタヒープは複数のスレッドから確保できないので、別スレッドではこちらを呼び、
+			//			ビューはメインスレッドでCreateFromResourceを呼んで作る。contextとqueueはスレッド専用のものを渡すこと
+			// @return 成功したらS_OK
+			//-------------------------------------------------------------
+			static HRESULT CreateResourceFromFile(const std::wstring& path, D3D12_RESOURCE_FLAGS flags, bool generate_mips, ComPtr<ID3D12Resource>& out_resource,
+				ID3D12DeviceContext* context = nullptr, CommandQueue* queue = nullptr);
+			// @brief CPUで作った画像(全てのミップ・配列の要素)から、リソースを作って転送する(ビューは作らない)
+			static HRESULT CreateResourceFromImage(const DirectX::ScratchImage& scratch, D3D12_RESOURCE_FLAGS flags, ComPtr<ID3D12Resource>& out_resource,
+				ID3D12DeviceContext* context = nullptr, CommandQueue* queue = nullptr);
+			// @brief 転送済みのリソースにビューを作って、テクスチャにする
+			// @param [in] srv_desc nullptrなら既定のSRV(要素が1つの配列をTexture2DArrayとして見せたい場合などに渡す)
+			static std::unique_ptr<Texture> CreateFromResource(ComPtr<ID3D12Resource>& resource, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE, D3D12_SHADER_RESOURCE_VIEW_DESC* srv_desc = nullptr);
+			// @brief メモリマップしたDDSから、first_mip以降のミップだけを持つテクスチャを作る(ストリーミングの初期状態用)
+			static std::unique_ptr<Texture> LoadFromDDS(const DDSFile& dds, UINT first_mip = 0, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+			//-------------------------------------------------------------
+			// @brief メモリマップしたDDSから、first_mip以降のミップだけを持つリソースを作り、転送の完了まで待つ
+			// @details contextとqueueを渡せば、そのキューで転送する(別スレッドから呼ぶ場合は、スレッド専用のものを渡すこと)
+			// @return 成功したらS_OK。未対応のフォーマットならE_NOTIMPL
+			//-------------------------------------------------------------
+			static HRESULT CreateResourceFromDDS(const DDSFile& dds, UINT first_mip, D3D12_RESOURCE_FLAGS flags, ComPtr<ID3D12Resource>& out_resource,
+				ID3D12DeviceContext* context = nullptr, CommandQueue* queue = nullptr);
 			static std::unique_ptr<Texture> CreateEmpty(const D3D12_RESOURCE_DESC& desc, D3D12_CLEAR_VALUE* p_clear_value = nullptr);
+			// @brief 描画キューの完了まで待って読み戻し、その場で書き出す(描画が止まるので、毎フレーム書き出す場合はTextureReadbackを使う)
 			static int SaveToFile(Texture* texture, const std::wstring& path,D3D12_RESOURCE_STATES cur_state= D3D12_RESOURCE_STATE_COMMON);
+			// @brief 読み戻した画像を、拡張子に合わせた形式(DDS・PNG・JPEGなど)で書き出す。どのスレッドから呼んでもよい(WICを使う形式はCOMの初期化が必要)
+			static int SaveImageToFile(const DirectX::ScratchImage& scratch, const std::wstring& path);
 		};
 
 	};
@@ -7,11 +7,18 @@ namespace System {
 
 
 	VertexBuffer::VertexBuffer(std::vector<float>& vertices, unsigned int stride_in_counts, D3D12_HEAP_TYPE heap_type)
+		:VertexBuffer(vertices.data(), sizeof(float) * vertices.size(), sizeof(float) * stride_in_counts, heap_type)
 	{
-		vertex_data = vertices;
+	}
+
+	//圧縮した頂点フォーマットはfloatの配列にならないので、バイト列として受け取れるようにしておく
+	VertexBuffer::VertexBuffer(const void* vertices, size_t size_in_bytes, unsigned int stride_in_bytes, D3D12_HEAP_TYPE heap_type)
+	{
+		const unsigned char* src_bytes = static_cast<const unsigned char*>(vertices);
+		vertex_data.assign(src_bytes, src_bytes + size_in_bytes);
 		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 		resource_desc.Alignment = 0;
-		resource_desc.Width = sizeof(float) * vertices.size();
+		resource_desc.Width = size_in_bytes;
 		resource_desc.Height = 1;
 		resource_desc.DepthOrArraySize = 1;
 		resource_desc.MipLevels = 1;
@@ -32,14 +39,14 @@ namespace System {
 		mapped_data = nullptr;
 
 		vb_view.BufferLocation = d3d_resource->GetGPUVirtualAddress();
-		vb_view.SizeInBytes = static_cast<unsigned int>(vertices.size() * sizeof(float));
-		vb_view.StrideInBytes = sizeof(float) * stride_in_counts;
+		vb_view.SizeInBytes = static_cast<unsigned int>(size_in_bytes);
+		vb_view.StrideInBytes = stride_in_bytes;
 
 		hr = d3d_resource->Map(0, nullptr, &mapped_data);
 		if (FAILED(hr)) {
 			return;
 		}
-		std::copy(vertices.data(), vertices.data() + vertices.size(), static_cast<float*>(mapped_data));
+		std::copy(vertex_data.begin(), vertex_data.end(), static_cast<unsigned char*>(mapped_data));
 		d3d_resource->Unmap(0, nullptr);
 
 		if (heap_type == D3D12_HEAP_TYPE_DEFAULT) {
@@ -81,8 +88,8 @@ namespace System {
 
 			//ビューの更新
 			vb_view.BufferLocation = d3d_resource->GetGPUVirtualAddress();
-			vb_view.SizeInBytes = static_cast<unsigned int>(vertices.size() * sizeof(float));
-			vb_view.StrideInBytes = sizeof(float) * stride_in_counts;
+			vb_view.SizeInBytes = static_cast<unsigned int>(size_in_bytes);
+			vb_view.StrideInBytes = stride_in_bytes;
 		}
 		is_valid = true;
 
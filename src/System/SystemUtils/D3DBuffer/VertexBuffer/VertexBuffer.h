@@ -7,10 +7,11 @@ namespace System {
 	{
 	private:
 		D3D12_VERTEX_BUFFER_VIEW vb_view = {};
-		std::vector<float> vertex_data;
+		std::vector<unsigned char> vertex_data;
 		void* mapped_data = nullptr;
 	public:
 		VertexBuffer(std::vector<float>& vertices, unsigned int stride_in_counts, D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_UPLOAD);
+		VertexBuffer(const void* vertices, size_t size_in_bytes, unsigned int stride_in_bytes, D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_UPLOAD);
 		const D3D12_VERTEX_BUFFER_VIEW& GetView() const { return vb_view; }
 		const D3D12_VERTEX_BUFFER_VIEW* GetViewPtr() const { return &vb_view; }
 	};
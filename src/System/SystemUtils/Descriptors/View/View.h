@@ -217,6 +217,8 @@ namespace System {
 		ID3D12Resource* GetResource() const { return resource; }
 		const D3D12_CPU_DESCRIPTOR_HANDLE& GetCPUHandle() const { return cpu_handle; }
 		const DescriptorHeap* GetParentHeap() const { return parent_heap; }
+	protected:
+		void SetResource(ID3D12Resource* resource_) { resource = resource_; }
 	private:
 		D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
 		ID3D12Resource* resource;
@@ -234,6 +236,11 @@ namespace System {
 		unsigned int GetIndex() const { return index; }
 
 		const D3D12_SHADER_RESOURCE_VIEW_DESC& GetDesc() const { return desc; }
+		// @brief 同じディスクリプタに別のリソースのSRVを作り直した後に、覚えているリソースとdescを合わせる
+		void Rebind(ID3D12Resource* resource_, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc_) {
+			SetResource(resource_);
+			desc = desc_;
+		}
 	private:
 		D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle;
 		unsigned int index; // ディスクリタヒープ内のインデックス
@@ -0,0 +1,73 @@
+﻿#include "CommandStream.h"
+
+namespace System {
+
+	//ファイルの中身
+	// uint32 FILE_MAGIC
+	// uint32 FILE_VERSION
+	// uint64 コマンド数
+	// uint64 オブジェクト数
+	// uint64 バイト数
+	// バイト列
+	int CommandStream::SaveToFile(const std::wstring& path) const
+	{
+		std::ofstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file) {
+			return -1;
+		}
+		uint32_t magic = FILE_MAGIC;
+		uint32_t version = FILE_VERSION;
+		uint64_t command_count_64 = command_count;
+		uint64_t object_count_64 = objects.size();
+		uint64_t data_size = data.size();
+		file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		file.write(reinterpret_cast<const char*>(&command_count_64), sizeof(command_count_64));
+		file.write(reinterpret_cast<const char*>(&object_count_64), sizeof(object_count_64));
+		file.write(reinterpret_cast<const char*>(&data_size), sizeof(data_size));
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return file ? 0 : -1;
+	}
+
+	int CommandStream::LoadFromFile(const std::wstring& path)
+	{
+		Clear();
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file) {
+			return -1;
+		}
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t command_count_64 = 0;
+		uint64_t object_count_64 = 0;
+		uint64_t data_size = 0;
+		file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		file.read(reinterpret_cast<char*>(&version), sizeof(version));
+		file.read(reinterpret_cast<char*>(&command_count_64), sizeof(command_count_64));
+		file.read(reinterpret_cast<char*>(&object_count_64), sizeof(object_count_64));
+		file.read(reinterpret_cast<char*>(&data_size), sizeof(data_size));
+		if (!file || magic != FILE_MAGIC || version != FILE_VERSION) {
+			return -1;
+		}
+		//ヘッダーの値は、確保する前にファイルの残りの大きさと照らし合わせる(壊れたファイルで大きく確保しないように)
+		//コマンドは1つ1バイト以上、オブジェクトは最低1回は番号(4バイト)で参照されているはず
+		std::streamoff header_end = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff file_end = file.tellg();
+		file.seekg(header_end, std::ios::beg);
+		if (!file || header_end < 0 || file_end < header_end || data_size != static_cast<uint64_t>(file_end - header_end) ||
+			command_count_64 > data_size || object_count_64 > data_size / sizeof(uint32_t)) {
+			return -1;
+		}
+		data.resize(static_cast<size_t>(data_size));
+		file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data_size));
+		if (!file) {
+			Clear();
+			return -1;
+		}
+		command_count = static_cast<size_t>(command_count_64);
+		//ポインタは復元できないので、番号の数だけnullptrを並べておく
+		objects.assign(static_cast<size_t>(object_count_64), nullptr);
+		return 0;
+	}
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief コマンドリストに積んだコマンドを並べたバイト列
+	// @details CommandStreamRecorderが書き込み、CommandStreamReplayerが読み出して同じ順にコマンドリストへ積み直す。
+	//			1コマンドは「1バイトの種類」+「種類毎に決まった引数」で、引数はパディング無しでそのまま詰めてある。
+	//			リソースやPSOなどのポインタは、記録した順に1から振った番号で書く(0はnullptr)。
+	//			記録時のポインタはobjectsに残してあるので、同じプロセス内ならそのまま実機で再生できる。
+	//			GPU仮想アドレスとディスクリプタハンドルは値のまま書くので、ファイルから読んだストリームを
+	//			実機で再生する場合は、同じ配置のリソースを用意しておく必要がある(ダミーのコマンドリストなら関係ない)
+	//-------------------------------------------------------------
+	class CommandStream
+	{
+	public:
+		// @brief コマンドの種類
+		enum class Op : uint8_t {
+			ResourceBarrier,
+			SetGraphicsRootSignature,
+			SetComputeRootSignature,
+			SetPipelineState,
+			IASetPrimitiveTopology,
+			SetDescriptorHeaps,
+			SetGraphicsRootConstantBufferView,
+			SetGraphicsRootShaderResourceView,
+			SetGraphicsRootUnorderedAccessView,
+			SetGraphicsRootDescriptorTable,
+			SetGraphicsRoot32BitConstant,
+			SetGraphicsRoot32BitConstants,
+			SetComputeRootConstantBufferView,
+			SetComputeRootShaderResourceView,
+			SetComputeRootUnorderedAccessView,
+			SetComputeRootDescriptorTable,
+			SetComputeRoot32BitConstant,
+			SetComputeRoot32BitConstants,
+			IASetVertexBuffers,
+			IASetIndexBuffer,
+			OMSetRenderTargets,
+			RSSetViewports,
+			RSSetScissorRects,
+			ClearRenderTargetView,
+			ClearDepthStencilView,
+			DrawInstanced,
+			DrawIndexedInstanced,
+			Dispatch,
+			CopyBufferRegion,
+			ExecuteIndirect,
+			//後から足したものは末尾に並べる(前に保存したストリームの番号を変えないため)
+			CopyTextureRegion,
+			EndQuery,
+			ResolveQueryData,
+			Count
+		};
+
+		static constexpr uint32_t FILE_MAGIC = 0x52545343;	// "CSTR"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+	private:
+		std::vector<uint8_t> data;
+		std::vector<void*> objects;	// 番号-1の位置に、記録時のポインタが入っている
+		std::unordered_map<const void*, uint32_t> object_ids;
+		size_t command_count = 0;
+
+	public:
+		// @brief 記録したコマンドとオブジェクトの表を全て捨てる。確保したメモリは次の記録で使い回す
+		void Clear() {
+			data.clear();
+			objects.clear();
+			object_ids.clear();
+			command_count = 0;
+		}
+
+		void WriteOp(Op op) {
+			data.push_back(static_cast<uint8_t>(op));
+			command_count++;
+		}
+		void WriteBytes(const void* src, size_t size) {
+			if (size == 0)
+				return;
+			size_t offset = data.size();
+			data.resize(offset + size);
+			std::memcpy(data.data() + offset, src, size);
+		}
+		template <class T>
+		void Write(const T& value) {
+			WriteBytes(&value, sizeof(T));
+		}
+		// @brief ポインタを番号にして書く。初めて出てきたポインタには新しい番号を振る
+		void WriteObject(const void* object) {
+			uint32_t id = 0;
+			if (object) {
+				auto it = object_ids.find(object);
+				if (it == object_ids.end()) {
+					objects.push_back(const_cast<void*>(object));
+					id = static_cast<uint32_t>(objects.size());
+					object_ids.emplace(object, id);
+				}
+				else {
+					id = it->second;
+				}
+			}
+			Write(id);
+		}
+
+		const std::vector<uint8_t>& GetData() const { return data; }
+		const std::vector<void*>& GetObjects() const { return objects; }
+		size_t GetObjectCount() const { return objects.size(); }
+		size_t GetCommandCount() const { return command_count; }
+
+		//-------------------------------------------------------------
+		// @brief ストリームをファイルに保存する
+		// @details ポインタは保存できないので、オブジェクトは数だけを書いておく
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int SaveToFile(const std::wstring& path) const;
+		//-------------------------------------------------------------
+		// @brief SaveToFileで保存したストリームを読み込む
+		// @details オブジェクトの表は全てnullptrになる。実機で再生する場合は、Replayに表を渡すこと
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int LoadFromFile(const std::wstring& path);
+	};
+}
@@ -0,0 +1,362 @@
+﻿#pragma once
+#include "System/SystemUtils/DeviceContext/CommandStream.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief コマンドリストに積むコマンドを、そのまま転送しながらCommandStreamに記録するラッパー
+	// @details StateFilteredCommandListの下に挟んでいるので、記録されるのはステートの省略を通った後の、実際に積まれたコマンドになる。
+	//			記録していない間は転送するだけ。
+	//			CommandListはID3D12GraphicsCommandListと同じ名前と引数の関数を持っていればよいので、
+	//			テスト用のダミーのコマンドリストを入れることもできる
+	//-------------------------------------------------------------
+	template <class CommandList>
+	class CommandStreamRecorder
+	{
+	private:
+		using Op = CommandStream::Op;
+
+		CommandList* command_list = nullptr;
+		CommandStream* stream = nullptr;	// 記録先。nullptrなら記録しない
+
+	public:
+		CommandStreamRecorder(CommandList* command_list_ = nullptr) :command_list(command_list_) {}
+
+		void SetCommandList(CommandList* command_list_) { command_list = command_list_; }
+		CommandList* Get() const { return command_list; }
+
+		// @brief 記録を開始する。ストリームの中身は捨てられる
+		void BeginCapture(CommandStream* stream_) {
+			stream = stream_;
+			if (stream)
+				stream->Clear();
+		}
+		// @brief 記録を終了する。ストリームはそのまま残る
+		void EndCapture() { stream = nullptr; }
+		bool IsCapturing() const { return stream != nullptr; }
+
+		void ResourceBarrier(UINT num_barriers, const D3D12_RESOURCE_BARRIER* barriers) {
+			if (stream) {
+				stream->WriteOp(Op::ResourceBarrier);
+				stream->Write(num_barriers);
+				for (UINT i = 0; i < num_barriers; i++) {
+					const D3D12_RESOURCE_BARRIER& barrier = barriers[i];
+					stream->Write(barrier.Type);
+					stream->Write(barrier.Flags);
+					switch (barrier.Type) {
+					case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+						stream->WriteObject(barrier.Transition.pResource);
+						stream->Write(barrier.Transition.Subresource);
+						stream->Write(barrier.Transition.StateBefore);
+						stream->Write(barrier.Transition.StateAfter);
+						break;
+					case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+						stream->WriteObject(barrier.Aliasing.pResourceBefore);
+						stream->WriteObject(barrier.Aliasing.pResourceAfter);
+						break;
+					case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+						stream->WriteObject(barrier.UAV.pResource);
+						break;
+					}
+				}
+			}
+			command_list->ResourceBarrier(num_barriers, barriers);
+		}
+
+		void SetGraphicsRootSignature(ID3D12RootSignature* root_signature) {
+			if (stream) {
+				stream->WriteOp(Op::SetGraphicsRootSignature);
+				stream->WriteObject(root_signature);
+			}
+			command_list->SetGraphicsRootSignature(root_signature);
+		}
+		void SetComputeRootSignature(ID3D12RootSignature* root_signature) {
+			if (stream) {
+				stream->WriteOp(Op::SetComputeRootSignature);
+				stream->WriteObject(root_signature);
+			}
+			command_list->SetComputeRootSignature(root_signature);
+		}
+		void SetPipelineState(ID3D12PipelineState* pipeline_state) {
+			if (stream) {
+				stream->WriteOp(Op::SetPipelineState);
+				stream->WriteObject(pipeline_state);
+			}
+			command_list->SetPipelineState(pipeline_state);
+		}
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) {
+			if (stream) {
+				stream->WriteOp(Op::IASetPrimitiveTopology);
+				stream->Write(topology);
+			}
+			command_list->IASetPrimitiveTopology(topology);
+		}
+		void SetDescriptorHeaps(UINT num_heaps, ID3D12DescriptorHeap* const* heaps) {
+			if (stream) {
+				stream->WriteOp(Op::SetDescriptorHeaps);
+				stream->Write(num_heaps);
+				for (UINT i = 0; i < num_heaps; i++)
+					stream->WriteObject(heaps[i]);
+			}
+			command_list->SetDescriptorHeaps(num_heaps, heaps);
+		}
+
+		void SetGraphicsRootConstantBufferView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetGraphicsRootConstantBufferView, slot, address);
+			command_list->SetGraphicsRootConstantBufferView(slot, address);
+		}
+		void SetGraphicsRootShaderResourceView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetGraphicsRootShaderResourceView, slot, address);
+			command_list->SetGraphicsRootShaderResourceView(slot, address);
+		}
+		void SetGraphicsRootUnorderedAccessView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetGraphicsRootUnorderedAccessView, slot, address);
+			command_list->SetGraphicsRootUnorderedAccessView(slot, address);
+		}
+		void SetGraphicsRootDescriptorTable(UINT slot, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor) {
+			WriteRootAddress(Op::SetGraphicsRootDescriptorTable, slot, base_descriptor.ptr);
+			command_list->SetGraphicsRootDescriptorTable(slot, base_descriptor);
+		}
+		void SetGraphicsRoot32BitConstant(UINT slot, UINT value, UINT offset) {
+			WriteRootConstant(Op::SetGraphicsRoot32BitConstant, slot, value, offset);
+			command_list->SetGraphicsRoot32BitConstant(slot, value, offset);
+		}
+		void SetGraphicsRoot32BitConstants(UINT slot, UINT num_values, const void* values, UINT offset) {
+			WriteRootConstants(Op::SetGraphicsRoot32BitConstants, slot, num_values, values, offset);
+			command_list->SetGraphicsRoot32BitConstants(slot, num_values, values, offset);
+		}
+		void SetComputeRootConstantBufferView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetComputeRootConstantBufferView, slot, address);
+			command_list->SetComputeRootConstantBufferView(slot, address);
+		}
+		void SetComputeRootShaderResourceView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetComputeRootShaderResourceView, slot, address);
+			command_list->SetComputeRootShaderResourceView(slot, address);
+		}
+		void SetComputeRootUnorderedAccessView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			WriteRootAddress(Op::SetComputeRootUnorderedAccessView, slot, address);
+			command_list->SetComputeRootUnorderedAccessView(slot, address);
+		}
+		void SetComputeRootDescriptorTable(UINT slot, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor) {
+			WriteRootAddress(Op::SetComputeRootDescriptorTable, slot, base_descriptor.ptr);
+			command_list->SetComputeRootDescriptorTable(slot, base_descriptor);
+		}
+		void SetComputeRoot32BitConstant(UINT slot, UINT value, UINT offset) {
+			WriteRootConstant(Op::SetComputeRoot32BitConstant, slot, value, offset);
+			command_list->SetComputeRoot32BitConstant(slot, value, offset);
+		}
+		void SetComputeRoot32BitConstants(UINT slot, UINT num_values, const void* values, UINT offset) {
+			WriteRootConstants(Op::SetComputeRoot32BitConstants, slot, num_values, values, offset);
+			command_list->SetComputeRoot32BitConstants(slot, num_values, values, offset);
+		}
+
+		void IASetVertexBuffers(UINT start_slot, UINT num_views, const D3D12_VERTEX_BUFFER_VIEW* views) {
+			if (stream) {
+				stream->WriteOp(Op::IASetVertexBuffers);
+				stream->Write(start_slot);
+				//viewsがnullptrの場合はスロットの解除なので、ビューは書かない
+				UINT written_views = views ? num_views : 0;
+				stream->Write(num_views);
+				stream->Write(written_views);
+				if (written_views)
+					stream->WriteBytes(views, sizeof(D3D12_VERTEX_BUFFER_VIEW) * written_views);
+			}
+			command_list->IASetVertexBuffers(start_slot, num_views, views);
+		}
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+			if (stream) {
+				stream->WriteOp(Op::IASetIndexBuffer);
+				uint8_t has_view = view ? 1 : 0;
+				stream->Write(has_view);
+				if (view)
+					stream->Write(*view);
+			}
+			command_list->IASetIndexBuffer(view);
+		}
+		void OMSetRenderTargets(UINT num_render_targets, const D3D12_CPU_DESCRIPTOR_HANDLE* render_targets, BOOL single_handle_to_descriptor_range, const D3D12_CPU_DESCRIPTOR_HANDLE* depth_stencil) {
+			if (stream) {
+				stream->WriteOp(Op::OMSetRenderTargets);
+				stream->Write(num_render_targets);
+				stream->Write(single_handle_to_descriptor_range);
+				//連続したディスクリプタを指定する場合は、先頭のハンドルだけが渡される
+				UINT handle_count = render_targets ? (single_handle_to_descriptor_range ? (num_render_targets ? 1u : 0u) : num_render_targets) : 0;
+				stream->Write(handle_count);
+				if (handle_count)
+					stream->WriteBytes(render_targets, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * handle_count);
+				uint8_t has_depth_stencil = depth_stencil ? 1 : 0;
+				stream->Write(has_depth_stencil);
+				if (depth_stencil)
+					stream->Write(*depth_stencil);
+			}
+			command_list->OMSetRenderTargets(num_render_targets, render_targets, single_handle_to_descriptor_range, depth_stencil);
+		}
+		void RSSetViewports(UINT num_viewports, const D3D12_VIEWPORT* viewports) {
+			if (stream) {
+				stream->WriteOp(Op::RSSetViewports);
+				stream->Write(num_viewports);
+				stream->WriteBytes(viewports, sizeof(D3D12_VIEWPORT) * num_viewports);
+			}
+			command_list->RSSetViewports(num_viewports, viewports);
+		}
+		void RSSetScissorRects(UINT num_rects, const D3D12_RECT* rects) {
+			if (stream) {
+				stream->WriteOp(Op::RSSetScissorRects);
+				stream->Write(num_rects);
+				stream->WriteBytes(rects, sizeof(D3D12_RECT) * num_rects);
+			}
+			command_list->RSSetScissorRects(num_rects, rects);
+		}
+
+		void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE render_target, const FLOAT color[4], UINT num_rects, const D3D12_RECT* rects) {
+			if (stream) {
+				stream->WriteOp(Op::ClearRenderTargetView);
+				stream->Write(render_target);
+				stream->WriteBytes(color, sizeof(FLOAT) * 4);
+				WriteRects(num_rects, rects);
+			}
+			command_list->ClearRenderTargetView(render_target, color, num_rects, rects);
+		}
+		void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil, D3D12_CLEAR_FLAGS flags, FLOAT depth, UINT8 stencil, UINT num_rects, const D3D12_RECT* rects) {
+			if (stream) {
+				stream->WriteOp(Op::ClearDepthStencilView);
+				stream->Write(depth_stencil);
+				stream->Write(flags);
+				stream->Write(depth);
+				stream->Write(stencil);
+				WriteRects(num_rects, rects);
+			}
+			command_list->ClearDepthStencilView(depth_stencil, flags, depth, stencil, num_rects, rects);
+		}
+
+		void DrawInstanced(UINT vertex_count, UINT instance_count, UINT start_vertex, UINT start_instance) {
+			if (stream) {
+				stream->WriteOp(Op::DrawInstanced);
+				stream->Write(vertex_count);
+				stream->Write(instance_count);
+				stream->Write(start_vertex);
+				stream->Write(start_instance);
+			}
+			command_list->DrawInstanced(vertex_count, instance_count, start_vertex, start_instance);
+		}
+		void DrawIndexedInstanced(UINT index_count, UINT instance_count, UINT start_index, INT base_vertex, UINT start_instance) {
+			if (stream) {
+				stream->WriteOp(Op::DrawIndexedInstanced);
+				stream->Write(index_count);
+				stream->Write(instance_count);
+				stream->Write(start_index);
+				stream->Write(base_vertex);
+				stream->Write(start_instance);
+			}
+			command_list->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+		}
+		void Dispatch(UINT x, UINT y, UINT z) {
+			if (stream) {
+				stream->WriteOp(Op::Dispatch);
+				stream->Write(x);
+				stream->Write(y);
+				stream->Write(z);
+			}
+			command_list->Dispatch(x, y, z);
+		}
+		void CopyBufferRegion(ID3D12Resource* dst, UINT64 dst_offset, ID3D12Resource* src, UINT64 src_offset, UINT64 num_bytes) {
+			if (stream) {
+				stream->WriteOp(Op::CopyBufferRegion);
+				stream->WriteObject(dst);
+				stream->Write(dst_offset);
+				stream->WriteObject(src);
+				stream->Write(src_offset);
+				stream->Write(num_bytes);
+			}
+			command_list->CopyBufferRegion(dst, dst_offset, src, src_offset, num_bytes);
+		}
+		void ExecuteIndirect(ID3D12CommandSignature* command_signature, UINT max_command_count, ID3D12Resource* argument_buffer, UINT64 argument_offset, ID3D12Resource* count_buffer, UINT64 count_offset) {
+			if (stream) {
+				stream->WriteOp(Op::ExecuteIndirect);
+				stream->WriteObject(command_signature);
+				stream->Write(max_command_count);
+				stream->WriteObject(argument_buffer);
+				stream->Write(argument_offset);
+				stream->WriteObject(count_buffer);
+				stream->Write(count_offset);
+			}
+			command_list->ExecuteIndirect(command_signature, max_command_count, argument_buffer, argument_offset, count_buffer, count_offset);
+		}
+		void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT dst_x, UINT dst_y, UINT dst_z, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* src_box) {
+			if (stream) {
+				stream->WriteOp(Op::CopyTextureRegion);
+				WriteCopyLocation(*dst);
+				stream->Write(dst_x);
+				stream->Write(dst_y);
+				stream->Write(dst_z);
+				WriteCopyLocation(*src);
+				uint8_t has_box = src_box ? 1 : 0;
+				stream->Write(has_box);
+				if (src_box)
+					stream->Write(*src_box);
+			}
+			command_list->CopyTextureRegion(dst, dst_x, dst_y, dst_z, src, src_box);
+		}
+		void EndQuery(ID3D12QueryHeap* query_heap, D3D12_QUERY_TYPE type, UINT index) {
+			if (stream) {
+				stream->WriteOp(Op::EndQuery);
+				stream->WriteObject(query_heap);
+				stream->Write(type);
+				stream->Write(index);
+			}
+			command_list->EndQuery(query_heap, type, index);
+		}
+		void ResolveQueryData(ID3D12QueryHeap* query_heap, D3D12_QUERY_TYPE type, UINT start_index, UINT num_queries, ID3D12Resource* dst, UINT64 dst_offset) {
+			if (stream) {
+				stream->WriteOp(Op::ResolveQueryData);
+				stream->WriteObject(query_heap);
+				stream->Write(type);
+				stream->Write(start_index);
+				stream->Write(num_queries);
+				stream->WriteObject(dst);
+				stream->Write(dst_offset);
+			}
+			command_list->ResolveQueryData(query_heap, type, start_index, num_queries, dst, dst_offset);
+		}
+
+	private:
+		void WriteRootAddress(Op op, UINT slot, uint64_t address) {
+			if (!stream)
+				return;
+			stream->WriteOp(op);
+			stream->Write(slot);
+			stream->Write(address);
+		}
+		void WriteRootConstant(Op op, UINT slot, UINT value, UINT offset) {
+			if (!stream)
+				return;
+			stream->WriteOp(op);
+			stream->Write(slot);
+			stream->Write(value);
+			stream->Write(offset);
+		}
+		void WriteRootConstants(Op op, UINT slot, UINT num_values, const void* values, UINT offset) {
+			if (!stream)
+				return;
+			stream->WriteOp(op);
+			stream->Write(slot);
+			stream->Write(num_values);
+			stream->Write(offset);
+			stream->WriteBytes(values, sizeof(UINT) * num_values);
+		}
+		//バッファ側は配置(フットプリント)を、テクスチャ側はサブリソースの番号を書く
+		void WriteCopyLocation(const D3D12_TEXTURE_COPY_LOCATION& location) {
+			stream->WriteObject(location.pResource);
+			stream->Write(location.Type);
+			if (location.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT)
+				stream->Write(location.PlacedFootprint);
+			else
+				stream->Write(location.SubresourceIndex);
+		}
+		void WriteRects(UINT num_rects, const D3D12_RECT* rects) {
+			UINT written_rects = rects ? num_rects : 0;
+			stream->Write(written_rects);
+			if (written_rects)
+				stream->WriteBytes(rects, sizeof(D3D12_RECT) * written_rects);
+		}
+	};
+}
@@ -0,0 +1,418 @@
+﻿#pragma once
+#include "System/SystemUtils/DeviceContext/CommandStream.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief CommandStreamに記録したコマンドを、記録した順にコマンドリストへ積み直すクラス
+	// @details 積み直す先は実機のコマンドリストでも、StateFilteredCommandListでも、ダミーのコマンドリストでもよい。
+	//			アプリやアセットを読まずに1フレーム分のコマンドを何度でも積めるので、
+	//			コマンドを積むCPU側の負荷を計測したり、ステートの省略が効いているかを確認したりするのに使う。
+	//			リソースバリアやルート定数の一時的な配列は、メンバーに持って使い回す
+	//-------------------------------------------------------------
+	class CommandStreamReplayer
+	{
+	private:
+		using Op = CommandStream::Op;
+
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		std::vector<UINT> constants;
+		std::vector<D3D12_VERTEX_BUFFER_VIEW> vertex_buffers;
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> render_targets;
+		std::vector<D3D12_VIEWPORT> viewports;
+		std::vector<D3D12_RECT> rects;
+		std::vector<ID3D12DescriptorHeap*> descriptor_heaps;
+
+		//ストリームを先頭から読むためのカーソル。範囲外を読もうとしたらfailedを立てて、以降は0を返す
+		struct Reader {
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+			size_t position = 0;
+			const std::vector<void*>* objects = nullptr;
+			bool failed = false;
+
+			bool ReadBytes(void* dst, size_t bytes) {
+				if (failed || position + bytes > size) {
+					failed = true;
+					std::memset(dst, 0, bytes);
+					return false;
+				}
+				if (bytes)
+					std::memcpy(dst, data + position, bytes);
+				position += bytes;
+				return true;
+			}
+			template <class T>
+			T Read() {
+				T value;
+				ReadBytes(&value, sizeof(T));
+				return value;
+			}
+			template <class T>
+			void ReadArray(std::vector<T>& dst, size_t count) {
+				//壊れたストリームで巨大な確保をしないように、残りのバイト数で弾いておく
+				if (failed || count > (size - position) / sizeof(T)) {
+					failed = true;
+					dst.clear();
+					return;
+				}
+				dst.resize(count);
+				ReadBytes(dst.data(), sizeof(T) * count);
+			}
+			template <class T>
+			T* ReadObject() {
+				uint32_t id = Read<uint32_t>();
+				if (id == 0)
+					return nullptr;
+				if (id > objects->size()) {
+					failed = true;
+					return nullptr;
+				}
+				return static_cast<T*>((*objects)[id - 1]);
+			}
+		};
+
+	public:
+		//-------------------------------------------------------------
+		// @brief ストリームのコマンドを全てコマンドリストに積む
+		//
+		// @param [in] stream 再生するストリーム
+		// @param [in] command_list 積み先。ID3D12GraphicsCommandListと同じ名前の関数を持っていればよい
+		// @param [in] objects 番号からポインタを引く表。ストリームのオブジェクト数以上の要素が必要
+		// @return 積んだコマンド数。ストリームが壊れていた場合は-1(途中までは積まれている)
+		//-------------------------------------------------------------
+		template <class CommandList>
+		int Replay(const CommandStream& stream, CommandList* command_list, const std::vector<void*>& objects) {
+			if (!command_list || objects.size() < stream.GetObjectCount())
+				return -1;
+			Reader reader;
+			reader.data = stream.GetData().data();
+			reader.size = stream.GetData().size();
+			reader.objects = &objects;
+
+			int replayed = 0;
+			while (reader.position < reader.size) {
+				Op op = static_cast<Op>(reader.Read<uint8_t>());
+				if (ReplayCommand(reader, op, command_list) != 0 || reader.failed)
+					return -1;
+				replayed++;
+			}
+			return replayed;
+		}
+		// @brief 記録した時のオブジェクトの表でそのまま再生する(同じプロセス内で記録したストリーム用)
+		template <class CommandList>
+		int Replay(const CommandStream& stream, CommandList* command_list) {
+			return Replay(stream, command_list, stream.GetObjects());
+		}
+
+	private:
+		static D3D12_TEXTURE_COPY_LOCATION ReadCopyLocation(Reader& reader) {
+			D3D12_TEXTURE_COPY_LOCATION location = {};
+			location.pResource = reader.ReadObject<ID3D12Resource>();
+			location.Type = reader.Read<D3D12_TEXTURE_COPY_TYPE>();
+			if (location.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT)
+				location.PlacedFootprint = reader.Read<D3D12_PLACED_SUBRESOURCE_FOOTPRINT>();
+			else if (location.Type == D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX)
+				location.SubresourceIndex = reader.Read<UINT>();
+			else
+				reader.failed = true;
+			return location;
+		}
+
+		template <class CommandList>
+		int ReplayCommand(Reader& reader, Op op, CommandList* command_list) {
+			switch (op) {
+			case Op::ResourceBarrier:
+			{
+				UINT count = reader.Read<UINT>();
+				barriers.clear();
+				for (UINT i = 0; i < count && !reader.failed; i++) {
+					D3D12_RESOURCE_BARRIER barrier = {};
+					barrier.Type = reader.Read<D3D12_RESOURCE_BARRIER_TYPE>();
+					barrier.Flags = reader.Read<D3D12_RESOURCE_BARRIER_FLAGS>();
+					switch (barrier.Type) {
+					case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+						barrier.Transition.pResource = reader.ReadObject<ID3D12Resource>();
+						barrier.Transition.Subresource = reader.Read<UINT>();
+						barrier.Transition.StateBefore = reader.Read<D3D12_RESOURCE_STATES>();
+						barrier.Transition.StateAfter = reader.Read<D3D12_RESOURCE_STATES>();
+						break;
+					case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+						barrier.Aliasing.pResourceBefore = reader.ReadObject<ID3D12Resource>();
+						barrier.Aliasing.pResourceAfter = reader.ReadObject<ID3D12Resource>();
+						break;
+					case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+						barrier.UAV.pResource = reader.ReadObject<ID3D12Resource>();
+						break;
+					default:
+						return -1;
+					}
+					barriers.push_back(barrier);
+				}
+				if (reader.failed)
+					return -1;
+				command_list->ResourceBarrier(count, barriers.data());
+				return 0;
+			}
+			case Op::SetGraphicsRootSignature:
+				command_list->SetGraphicsRootSignature(reader.ReadObject<ID3D12RootSignature>());
+				return 0;
+			case Op::SetComputeRootSignature:
+				command_list->SetComputeRootSignature(reader.ReadObject<ID3D12RootSignature>());
+				return 0;
+			case Op::SetPipelineState:
+				command_list->SetPipelineState(reader.ReadObject<ID3D12PipelineState>());
+				return 0;
+			case Op::IASetPrimitiveTopology:
+				command_list->IASetPrimitiveTopology(reader.Read<D3D12_PRIMITIVE_TOPOLOGY>());
+				return 0;
+			case Op::SetDescriptorHeaps:
+			{
+				UINT count = reader.Read<UINT>();
+				descriptor_heaps.clear();
+				for (UINT i = 0; i < count && !reader.failed; i++)
+					descriptor_heaps.push_back(reader.ReadObject<ID3D12DescriptorHeap>());
+				if (reader.failed)
+					return -1;
+				command_list->SetDescriptorHeaps(count, descriptor_heaps.data());
+				return 0;
+			}
+			case Op::SetGraphicsRootConstantBufferView:
+			case Op::SetGraphicsRootShaderResourceView:
+			case Op::SetGraphicsRootUnorderedAccessView:
+			case Op::SetGraphicsRootDescriptorTable:
+			case Op::SetComputeRootConstantBufferView:
+			case Op::SetComputeRootShaderResourceView:
+			case Op::SetComputeRootUnorderedAccessView:
+			case Op::SetComputeRootDescriptorTable:
+			{
+				UINT slot = reader.Read<UINT>();
+				uint64_t address = reader.Read<uint64_t>();
+				if (reader.failed)
+					return -1;
+				D3D12_GPU_DESCRIPTOR_HANDLE handle = {};
+				handle.ptr = address;
+				switch (op) {
+				case Op::SetGraphicsRootConstantBufferView: command_list->SetGraphicsRootConstantBufferView(slot, address); break;
+				case Op::SetGraphicsRootShaderResourceView: command_list->SetGraphicsRootShaderResourceView(slot, address); break;
+				case Op::SetGraphicsRootUnorderedAccessView: command_list->SetGraphicsRootUnorderedAccessView(slot, address); break;
+				case Op::SetGraphicsRootDescriptorTable: command_list->SetGraphicsRootDescriptorTable(slot, handle); break;
+				case Op::SetComputeRootConstantBufferView: command_list->SetComputeRootConstantBufferView(slot, address); break;
+				case Op::SetComputeRootShaderResourceView: command_list->SetComputeRootShaderResourceView(slot, address); break;
+				case Op::SetComputeRootUnorderedAccessView: command_list->SetComputeRootUnorderedAccessView(slot, address); break;
+				default: command_list->SetComputeRootDescriptorTable(slot, handle); break;
+				}
+				return 0;
+			}
+			case Op::SetGraphicsRoot32BitConstant:
+			case Op::SetComputeRoot32BitConstant:
+			{
+				UINT slot = reader.Read<UINT>();
+				UINT value = reader.Read<UINT>();
+				UINT offset = reader.Read<UINT>();
+				if (reader.failed)
+					return -1;
+				if (op == Op::SetGraphicsRoot32BitConstant)
+					command_list->SetGraphicsRoot32BitConstant(slot, value, offset);
+				else
+					command_list->SetComputeRoot32BitConstant(slot, value, offset);
+				return 0;
+			}
+			case Op::SetGraphicsRoot32BitConstants:
+			case Op::SetComputeRoot32BitConstants:
+			{
+				UINT slot = reader.Read<UINT>();
+				UINT count = reader.Read<UINT>();
+				UINT offset = reader.Read<UINT>();
+				reader.ReadArray(constants, count);
+				if (reader.failed)
+					return -1;
+				if (op == Op::SetGraphicsRoot32BitConstants)
+					command_list->SetGraphicsRoot32BitConstants(slot, count, constants.data(), offset);
+				else
+					command_list->SetComputeRoot32BitConstants(slot, count, constants.data(), offset);
+				return 0;
+			}
+			case Op::IASetVertexBuffers:
+			{
+				UINT start_slot = reader.Read<UINT>();
+				UINT count = reader.Read<UINT>();
+				UINT written_views = reader.Read<UINT>();
+				reader.ReadArray(vertex_buffers, written_views);
+				if (reader.failed)
+					return -1;
+				command_list->IASetVertexBuffers(start_slot, count, written_views ? vertex_buffers.data() : nullptr);
+				return 0;
+			}
+			case Op::IASetIndexBuffer:
+			{
+				uint8_t has_view = reader.Read<uint8_t>();
+				D3D12_INDEX_BUFFER_VIEW view = {};
+				if (has_view)
+					view = reader.Read<D3D12_INDEX_BUFFER_VIEW>();
+				if (reader.failed)
+					return -1;
+				command_list->IASetIndexBuffer(has_view ? &view : nullptr);
+				return 0;
+			}
+			case Op::OMSetRenderTargets:
+			{
+				UINT count = reader.Read<UINT>();
+				BOOL single_handle = reader.Read<BOOL>();
+				UINT handle_count = reader.Read<UINT>();
+				reader.ReadArray(render_targets, handle_count);
+				uint8_t has_depth_stencil = reader.Read<uint8_t>();
+				D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil = {};
+				if (has_depth_stencil)
+					depth_stencil = reader.Read<D3D12_CPU_DESCRIPTOR_HANDLE>();
+				if (reader.failed)
+					return -1;
+				command_list->OMSetRenderTargets(count, handle_count ? render_targets.data() : nullptr, single_handle, has_depth_stencil ? &depth_stencil : nullptr);
+				return 0;
+			}
+			case Op::RSSetViewports:
+			{
+				UINT count = reader.Read<UINT>();
+				reader.ReadArray(viewports, count);
+				if (reader.failed)
+					return -1;
+				command_list->RSSetViewports(count, viewports.data());
+				return 0;
+			}
+			case Op::RSSetScissorRects:
+			{
+				UINT count = reader.Read<UINT>();
+				reader.ReadArray(rects, count);
+				if (reader.failed)
+					return -1;
+				command_list->RSSetScissorRects(count, rects.data());
+				return 0;
+			}
+			case Op::ClearRenderTargetView:
+			{
+				D3D12_CPU_DESCRIPTOR_HANDLE render_target = reader.Read<D3D12_CPU_DESCRIPTOR_HANDLE>();
+				FLOAT color[4] = {};
+				reader.ReadBytes(color, sizeof(color));
+				UINT count = reader.Read<UINT>();
+				reader.ReadArray(rects, count);
+				if (reader.failed)
+					return -1;
+				command_list->ClearRenderTargetView(render_target, color, count, count ? rects.data() : nullptr);
+				return 0;
+			}
+			case Op::ClearDepthStencilView:
+			{
+				D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil = reader.Read<D3D12_CPU_DESCRIPTOR_HANDLE>();
+				D3D12_CLEAR_FLAGS flags = reader.Read<D3D12_CLEAR_FLAGS>();
+				FLOAT depth = reader.Read<FLOAT>();
+				UINT8 stencil = reader.Read<UINT8>();
+				UINT count = reader.Read<UINT>();
+				reader.ReadArray(rects, count);
+				if (reader.failed)
+					return -1;
+				command_list->ClearDepthStencilView(depth_stencil, flags, depth, stencil, count, count ? rects.data() : nullptr);
+				return 0;
+			}
+			case Op::DrawInstanced:
+			{
+				UINT vertex_count = reader.Read<UINT>();
+				UINT instance_count = reader.Read<UINT>();
+				UINT start_vertex = reader.Read<UINT>();
+				UINT start_instance = reader.Read<UINT>();
+				if (reader.failed)
+					return -1;
+				command_list->DrawInstanced(vertex_count, instance_count, start_vertex, start_instance);
+				return 0;
+			}
+			case Op::DrawIndexedInstanced:
+			{
+				UINT index_count = reader.Read<UINT>();
+				UINT instance_count = reader.Read<UINT>();
+				UINT start_index = reader.Read<UINT>();
+				INT base_vertex = reader.Read<INT>();
+				UINT start_instance = reader.Read<UINT>();
+				if (reader.failed)
+					return -1;
+				command_list->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+				return 0;
+			}
+			case Op::Dispatch:
+			{
+				UINT x = reader.Read<UINT>();
+				UINT y = reader.Read<UINT>();
+				UINT z = reader.Read<UINT>();
+				if (reader.failed)
+					return -1;
+				command_list->Dispatch(x, y, z);
+				return 0;
+			}
+			case Op::CopyBufferRegion:
+			{
+				ID3D12Resource* dst = reader.ReadObject<ID3D12Resource>();
+				UINT64 dst_offset = reader.Read<UINT64>();
+				ID3D12Resource* src = reader.ReadObject<ID3D12Resource>();
+				UINT64 src_offset = reader.Read<UINT64>();
+				UINT64 num_bytes = reader.Read<UINT64>();
+				if (reader.failed)
+					return -1;
+				command_list->CopyBufferRegion(dst, dst_offset, src, src_offset, num_bytes);
+				return 0;
+			}
+			case Op::ExecuteIndirect:
+			{
+				ID3D12CommandSignature* command_signature = reader.ReadObject<ID3D12CommandSignature>();
+				UINT max_command_count = reader.Read<UINT>();
+				ID3D12Resource* argument_buffer = reader.ReadObject<ID3D12Resource>();
+				UINT64 argument_offset = reader.Read<UINT64>();
+				ID3D12Resource* count_buffer = reader.ReadObject<ID3D12Resource>();
+				UINT64 count_offset = reader.Read<UINT64>();
+				if (reader.failed)
+					return -1;
+				command_list->ExecuteIndirect(command_signature, max_command_count, argument_buffer, argument_offset, count_buffer, count_offset);
+				return 0;
+			}
+			case Op::CopyTextureRegion:
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = ReadCopyLocation(reader);
+				UINT dst_x = reader.Read<UINT>();
+				UINT dst_y = reader.Read<UINT>();
+				UINT dst_z = reader.Read<UINT>();
+				D3D12_TEXTURE_COPY_LOCATION src = ReadCopyLocation(reader);
+				uint8_t has_box = reader.Read<uint8_t>();
+				D3D12_BOX box = {};
+				if (has_box)
+					box = reader.Read<D3D12_BOX>();
+				if (reader.failed)
+					return -1;
+				command_list->CopyTextureRegion(&dst, dst_x, dst_y, dst_z, &src, has_box ? &box : nullptr);
+				return 0;
+			}
+			case Op::EndQuery:
+			{
+				ID3D12QueryHeap* query_heap = reader.ReadObject<ID3D12QueryHeap>();
+				D3D12_QUERY_TYPE type = reader.Read<D3D12_QUERY_TYPE>();
+				UINT index = reader.Read<UINT>();
+				if (reader.failed)
+					return -1;
+				command_list->EndQuery(query_heap, type, index);
+				return 0;
+			}
+			case Op::ResolveQueryData:
+			{
+				ID3D12QueryHeap* query_heap = reader.ReadObject<ID3D12QueryHeap>();
+				D3D12_QUERY_TYPE type = reader.Read<D3D12_QUERY_TYPE>();
+				UINT start_index = reader.Read<UINT>();
+				UINT num_queries = reader.Read<UINT>();
+				ID3D12Resource* dst = reader.ReadObject<ID3D12Resource>();
+				UINT64 dst_offset = reader.Read<UINT64>();
+				if (reader.failed)
+					return -1;
+				command_list->ResolveQueryData(query_heap, type, start_index, num_queries, dst, dst_offset);
+				return 0;
+			}
+			default:
+				return -1;
+			}
+		}
+	};
+}
@@ -0,0 +1,156 @@
+﻿#include "GpuTimer.h"
+
+namespace System {
+
+	GpuTimer::GpuTimer(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type)
+	{
+		zones.reserve(MAX_ZONES);
+		pending_zones.reserve(MAX_ZONES);
+		if (!device) return;
+		//コピーキューのタイムスタンプは対応していないGPUもあるので、描画とコンピュートだけ計測する
+		if (type != D3D12_COMMAND_LIST_TYPE_DIRECT && type != D3D12_COMMAND_LIST_TYPE_COMPUTE) return;
+
+		D3D12_QUERY_HEAP_DESC heap_desc = {};
+		heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		heap_desc.Count = MAX_QUERIES;
+		heap_desc.NodeMask = 0;
+		if (FAILED(device->CreateQueryHeap(&heap_desc, IID_PPV_ARGS(query_heap.GetAddressOf())))) {
+			return;
+		}
+
+		//CPUから読むので、読み戻し用のヒープに作る
+		D3D12_HEAP_PROPERTIES heap_properties = {};
+		heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+		heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heap_properties.CreationNodeMask = 0;
+		heap_properties.VisibleNodeMask = 0;
+		D3D12_RESOURCE_DESC resource_desc = {};
+		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resource_desc.Alignment = 0;
+		resource_desc.Width = sizeof(uint64_t) * MAX_QUERIES;
+		resource_desc.Height = 1;
+		resource_desc.DepthOrArraySize = 1;
+		resource_desc.MipLevels = 1;
+		resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+		resource_desc.SampleDesc.Count = 1;
+		resource_desc.SampleDesc.Quality = 0;
+		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		if (FAILED(device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(readback_buffer.GetAddressOf())))) {
+			query_heap.Reset();
+		}
+	}
+
+	int GpuTimer::Begin(CommandList* command_list, const char* name)
+	{
+		if (zones.size() >= MAX_ZONES) {
+			return -1;
+		}
+		int zone = static_cast<int>(zones.size());
+		zones.push_back({ name, depth++, false });
+		if (command_list && query_heap) {
+			command_list->EndQuery(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, static_cast<UINT>(zone) * 2);
+		}
+		return zone;
+	}
+
+	void GpuTimer::End(CommandList* command_list, int zone)
+	{
+		if (zone < 0 || static_cast<size_t>(zone) >= zones.size() || zones[zone].is_ended) {
+			return;
+		}
+		zones[zone].is_ended = true;
+		depth--;
+		if (command_list && query_heap) {
+			command_list->EndQuery(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, static_cast<UINT>(zone) * 2 + 1);
+		}
+	}
+
+	void GpuTimer::Resolve(CommandList* command_list)
+	{
+		//前の結果を読まないまま次を積んだ場合は、前の結果は捨てる(読み戻し用のバッファを上書きするため)
+		pending_zones.swap(zones);
+		zones.clear();
+		depth = 0;
+		if (pending_zones.empty() || !command_list || !IsValid()) {
+			return;
+		}
+		command_list->ResolveQueryData(query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0,
+			static_cast<UINT>(pending_zones.size() * 2), readback_buffer.Get(), 0);
+	}
+
+	int GpuTimer::Collect(const GpuClockCalibration& calibration, ProfileThreadBuffer* lane)
+	{
+		if (pending_zones.empty()) {
+			return 0;
+		}
+		if (!IsValid()) {
+			pending_zones.clear();
+			return -1;
+		}
+		size_t timestamp_count = pending_zones.size() * 2;
+		D3D12_RANGE read_range = { 0, sizeof(uint64_t) * timestamp_count };
+		void* mapped = nullptr;
+		if (FAILED(readback_buffer->Map(0, &read_range, &mapped))) {
+			pending_zones.clear();
+			return -1;
+		}
+		int result = CollectTimestamps(static_cast<const uint64_t*>(mapped), timestamp_count, calibration, lane);
+		//CPUからは書き込んでいないので、書き込んだ範囲は空にしておく
+		D3D12_RANGE write_range = { 0, 0 };
+		readback_buffer->Unmap(0, &write_range);
+		return result;
+	}
+
+	int GpuTimer::CollectTimestamps(const uint64_t* timestamps, size_t timestamp_count, const GpuClockCalibration& calibration, ProfileThreadBuffer* lane)
+	{
+		if (calibration.frequency == 0 || !lane) {
+			pending_zones.clear();
+			return -1;
+		}
+		//GPUの1刻み(1/frequency秒)を、ミリ秒を経由してProfileManagerの刻みに直す
+		double milliseconds_per_tick = ProfileManager::Instance()->GetMillisecondsPerTick();
+		if (milliseconds_per_tick <= 0.0) {
+			pending_zones.clear();
+			return -1;
+		}
+		double ticks_per_gpu_tick = 1000.0 / static_cast<double>(calibration.frequency) / milliseconds_per_tick;
+
+		converted_events.clear();
+		ConvertZones(pending_zones, timestamps, timestamp_count, calibration, ticks_per_gpu_tick, converted_events);
+		pending_zones.clear();
+		for (const ProfileEvent& event : converted_events) {
+			lane->Push(event);
+		}
+		return static_cast<int>(converted_events.size());
+	}
+
+	void GpuTimer::ConvertZones(const std::vector<Zone>& zones, const uint64_t* timestamps, size_t timestamp_count,
+		const GpuClockCalibration& calibration, double ticks_per_gpu_tick, std::vector<ProfileEvent>& out_events)
+	{
+		if (!timestamps) return;
+		//較正した時点との差を、符号付きで刻みに直す(較正より前のタイムスタンプもあり得る)
+		auto to_ticks = [&](uint64_t timestamp) {
+			int64_t gpu_delta = static_cast<int64_t>(timestamp - calibration.gpu_timestamp);
+			return calibration.cpu_ticks + static_cast<int64_t>(static_cast<double>(gpu_delta) * ticks_per_gpu_tick);
+			};
+		for (size_t i = 0; i < zones.size(); i++) {
+			const Zone& zone = zones[i];
+			size_t begin_index = i * 2;
+			size_t end_index = begin_index + 1;
+			if (!zone.is_ended || end_index >= timestamp_count) continue;
+			uint64_t begin = timestamps[begin_index];
+			uint64_t end = timestamps[end_index];
+			if (end < begin) continue;
+
+			ProfileEvent event;
+			event.name = zone.name;
+			event.begin = to_ticks(begin);
+			event.value = to_ticks(end);
+			event.depth = zone.depth;
+			event.type = ProfileEvent::Type::Zone;
+			out_events.push_back(event);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief GPUのタイムスタンプを、ProfileManagerの時刻(TSC)に直すための組
+	// @details 同じ時点のGPUのタイムスタンプとCPUの時刻を覚えておき、そこからの差を周波数で時間に直す
+	//-------------------------------------------------------------
+	struct GpuClockCalibration {
+		uint64_t gpu_timestamp = 0;	// 較正した時点のGPUのタイムスタンプ
+		int64_t cpu_ticks = 0;		// 同じ時点のProfileManager::Now()
+		uint64_t frequency = 0;		// GPUのタイムスタンプの周波数(1秒あたりの刻み)。0なら較正できていない
+	};
+
+	//-------------------------------------------------------------
+	// @brief タイムスタンプクエリでGPU側の処理時間を計測するクラス
+	// @details コマンドリスト1本(=フレーム1つ分)につき1つ持つ。
+	//			Begin/Endで区間の前後にタイムスタンプを書き込むコマンドを積み、Resolveでまとめて読み戻し用のバッファにコピーする。
+	//			GPUが実行し終わるまで結果は読めないので、フェンスの完了を待った後にCollectで読み、ProfileManagerのレーンに積む。
+	//			クエリヒープが無くても区間の管理だけは行うので、CollectTimestampsに作った値を渡せば、GPU無しで変換と集計を確かめられる
+	//-------------------------------------------------------------
+	class GpuTimer
+	{
+	public:
+		static constexpr unsigned int MAX_ZONES = 256;	// 1回の記録で計測できる区間の数
+		static constexpr unsigned int MAX_QUERIES = MAX_ZONES * 2;	// 区間1つにつき、開始と終了の2つ
+		//クエリのコマンドは記録用のラッパー経由で積む(コマンドストリームを記録したフレームにも、タイムスタンプのコマンドが残る)
+		using CommandList = CommandStreamRecorder<ID3D12GraphicsCommandList>;
+
+		struct Zone {
+			const char* name = nullptr;
+			uint16_t depth = 0;
+			bool is_ended = false;	// Endまで積んだかどうか。途中で記録を閉じた区間は、終了のタイムスタンプが無いので捨てる
+		};
+
+	private:
+		ComPtr<ID3D12QueryHeap> query_heap;
+		ComPtr<ID3D12Resource> readback_buffer;
+		//区間の番号がそのままクエリの番号になる。開始が番号*2、終了が番号*2+1
+		std::vector<Zone> zones;			// 記録中のコマンドリストに積んだ区間
+		std::vector<Zone> pending_zones;	// 実行に回したが、まだ結果を読んでいない区間
+		uint16_t depth = 0;
+		std::vector<ProfileEvent> converted_events;	// 変換した結果。フレーム毎に確保しないように使い回す
+
+	public:
+		// @param device nullptrなら、クエリヒープを作らずに区間の管理だけ行う
+		GpuTimer(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type);
+
+		bool IsValid() const { return query_heap && readback_buffer; }
+		bool HasPendingZones() const { return !pending_zones.empty(); }
+
+		//-------------------------------------------------------------
+		// @brief 区間の開始のタイムスタンプを積む
+		// @param command_list nullptrなら、区間の管理だけ行う
+		// @return 区間の番号。区間が多すぎる場合は-1
+		//-------------------------------------------------------------
+		int Begin(CommandList* command_list, const char* name);
+		// @brief Beginで開始した区間の、終了のタイムスタンプを積む
+		void End(CommandList* command_list, int zone);
+
+		//-------------------------------------------------------------
+		// @brief 積んだタイムスタンプを、読み戻し用のバッファにコピーするコマンドを積む
+		// @details コマンドリストを閉じる直前に呼ぶ。積んだ区間は、結果待ちとしてCollectまで残しておく
+		//-------------------------------------------------------------
+		void Resolve(CommandList* command_list);
+
+		//-------------------------------------------------------------
+		// @brief 結果待ちの区間のタイムスタンプを読み戻し、ProfileManagerの時刻に直してlaneに積む
+		// @details Resolveを積んだコマンドリストの実行が、フェンスで完了したのを確かめてから呼ぶこと
+		// @return 積んだ区間の数。読み戻せなかった場合は-1
+		//-------------------------------------------------------------
+		int Collect(const GpuClockCalibration& calibration, ProfileThreadBuffer* lane);
+
+		//-------------------------------------------------------------
+		// @brief 結果待ちの区間を、渡されたタイムスタンプで変換してlaneに積む
+		// @details Collectが読み戻した後に呼ぶもの。GPU無しで確かめる時は、作った値を直接渡す
+		// @return 積んだ区間の数。較正できていない場合は-1
+		//-------------------------------------------------------------
+		int CollectTimestamps(const uint64_t* timestamps, size_t timestamp_count, const GpuClockCalibration& calibration, ProfileThreadBuffer* lane);
+
+		//-------------------------------------------------------------
+		// @brief タイムスタンプの組を、ProfileManagerの時刻の区間に直す
+		// @details 開始か終了が範囲外の区間、終了まで積んでいない区間、終了が開始より前の区間(リセット直後の不正な値など)は捨てる
+		// @param ticks_per_gpu_tick GPUのタイムスタンプ1刻みが、ProfileManager::Now()の何刻みか
+		//-------------------------------------------------------------
+		static void ConvertZones(const std::vector<Zone>& zones, const uint64_t* timestamps, size_t timestamp_count,
+			const GpuClockCalibration& calibration, double ticks_per_gpu_tick, std::vector<ProfileEvent>& out_events);
+	};
+}
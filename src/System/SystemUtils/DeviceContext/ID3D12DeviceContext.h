@@ -1,4 +1,7 @@
 #pragma once
+#include "System/SystemUtils/DeviceContext/StateFilteredCommandList.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+#include "System/SystemUtils/DeviceContext/GpuTimer.h"
 namespace System {
 	//D3D12には、デバイスコンテキストが存在しないため、DirectX11のようなデバイスコンテキストを表すクラスは必要ない。
 	//ただ、コマンドアロケーターやコマンドリストを管理する必要はあるため、自作でD3D12用のコンテキストを作ることにする。
@@ -25,11 +28,49 @@ namespace System {
 		bool is_closed = false;	// コマンドリストが閉じているかどうかを管理する変数。コマンドリストが閉じているときは、コマンドの記録や実行ができないようにするために使用する。
 		ComPtr<ID3D12CommandAllocator> command_allocator;
 		ComPtr<ID3D12GraphicsCommandList> command_list;
+	public:
+		using Recorder = CommandStreamRecorder<ID3D12GraphicsCommandList>;
+		using StateFilter = StateFilteredCommandList<Recorder>;
+	private:
+		// コマンドリストの上に、記録用のラッパー、ステートを省くラッパーの順に重ねている
+		// ステートを省いた後に実際に積んだコマンドだけが記録される
+		Recorder recorder;
+		StateFilter state_filter;	// 同じステートの再設定を省くためのラッパー。コマンドリストと同じ寿命で、Reset毎に覚えている値を捨てる
+		StateFilterStats last_frame_state_stats;	// 直前に記録したコマンドリストで、実際に積んだ回数と省いた回数
+		GpuTimer gpu_timer;	// GPU側の区間の計測。コマンドリストを閉じる時に結果をコピーし、フェンスの完了後にCommandQueueが読む
 		size_t last_signaled_fence_value = 0;	// コマンドリストに記録された最後のコマンドが完了したときのフェンス値を記録する変数。これを管理することで、コマンドリストの実行が完了したかどうかを確認することができるようになる。
 	public:
-		ID3D12DeviceContext(ID3D12Device* master_device, D3D12_COMMAND_LIST_TYPE context_type);
+		// @details デバイス(キュー・フェンス・アロケーター)はインターフェースとしてしか触らないので、
+		//			ホスト向けのビルドではtests/HostPlatform/NullDevice.hのデバイスで作れる
+		ID3D12DeviceContext(ID3D12Device* master_device, D3D12_COMMAND_LIST_TYPE context_type)
+			:gpu_timer(master_device, context_type)
+		{
+			if (!master_device) return;		// 引数のデバイスがnullptrだったら、何もせずに関数を終了する
+
+			// コマンドアロケータの作成
+			master_device->CreateCommandAllocator(context_type, IID_PPV_ARGS(command_allocator.GetAddressOf()));
+			// コマンドリストの作成
+			master_device->CreateCommandList(0, context_type, command_allocator.Get(), nullptr, IID_PPV_ARGS(command_list.GetAddressOf()));
+			recorder.SetCommandList(command_list.Get());
+			state_filter.SetCommandList(&recorder);
+
+			// コマンドリストは、作成した直後は「記録中」の状態になっているため、コマンドリストを閉じておく
+			CloseCommandList();
+		}
 		ID3D12CommandAllocator* GetCommandAllocator() const { return command_allocator.Get(); }
 		ID3D12GraphicsCommandList* GetCommandList() const { return command_list.Get(); }
+		// @brief 冗長なステート設定を省いてコマンドリストに積むラッパーを取得する
+		// @details 生のコマンドリストで直接ステートを変えた後は、Invalidate()を呼んで覚えている値を捨てること
+		StateFilter* GetStateFilter() { return &state_filter; }
+		// @brief コマンドを記録しながらコマンドリストに積むラッパーを取得する
+		// @details リソースバリアや描画など、ステート以外のコマンドもこちらに積めば記録に残る
+		Recorder* GetRecorder() { return &recorder; }
+		const StateFilterStats& GetLastFrameStateStats() const { return last_frame_state_stats; }
+		// @brief GPU側の区間の計測を始める。戻り値をEndGpuZoneに渡す(PROFILE_GPU_ZONEを使えば自動で閉じる)
+		// @details タイムスタンプは記録用のラッパー経由で積むので、コマンドストリームにも残る
+		int BeginGpuZone(const char* name) { return gpu_timer.Begin(command_list ? &recorder : nullptr, name); }
+		void EndGpuZone(int zone) { gpu_timer.End(command_list ? &recorder : nullptr, zone); }
+		GpuTimer* GetGpuTimer() { return &gpu_timer; }
 		int SignalFence(size_t fence_value) {
 			last_signaled_fence_value = fence_value;	// 引数で渡されたフェンス値を、最後にシグナルしたフェンス値として記録する
 			return 0;
@@ -39,6 +80,7 @@ namespace System {
 		int CloseCommandList() {
 			if (!command_list || is_closed) return -1;	// コマンドリストが有効でない場合は、-1を返す
 			is_closed = true; // コマンドリストが閉じられたことを記録する
+			gpu_timer.Resolve(&recorder);	// 閉じる前に、積んだタイムスタンプを読み戻し用のバッファにコピーしておく
 			return command_list->Close();	// コマンドリストを閉じて、その結果を返す
 		}
 		int ResetCommandList() {
@@ -46,6 +88,9 @@ namespace System {
 			HRESULT hr = command_allocator->Reset();	// コマンドアロケーターをリセットする
 			if (FAILED(hr)) return hr;	// リセットに失敗した場合は、その結果を返す
 			is_closed = false;	// コマンドリストが開いていることを記録する
+			// コマンドリストをリセットすると全てのステートが未設定に戻るので、覚えている値も捨てる。集計は直前の記録分として残しておく
+			last_frame_state_stats = state_filter.GetStats();
+			state_filter.Reset();
 			return command_list->Reset(command_allocator.Get(), nullptr);	// コマンドリストをリセットして、その結果を返す
 		}
 		int SetRenderTarget(Texture* render_target, Texture* dsv);
@@ -56,4 +101,27 @@ namespace System {
 
 
 	};
-}
\ No newline at end of file
+
+	//-------------------------------------------------------------
+	// @brief スコープを抜けるまでのGPU側の時間を、区間として計測する
+	// @details 結果はフェンスの完了後にCommandQueueが読み、ProfileManagerのGPUの行に積む
+	//-------------------------------------------------------------
+	class GpuProfileZone
+	{
+	private:
+		ID3D12DeviceContext* context;
+		int zone;
+	public:
+		GpuProfileZone(ID3D12DeviceContext* context_, const char* name) :context(context_), zone(context_->BeginGpuZone(name)) {}
+		~GpuProfileZone() { context->EndGpuZone(zone); }
+		GpuProfileZone(const GpuProfileZone&) = delete;
+		GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+	};
+}
+
+#if PROFILER_ENABLED
+// @brief スコープの終わりまでのGPU側の時間を、nameという区間として計測する
+#define PROFILE_GPU_ZONE(context, name) System::GpuProfileZone PROFILE_CONCAT(profile_gpu_zone_, __LINE__)(context, name)
+#else
+#define PROFILE_GPU_ZONE(context, name)
+#endif
\ No newline at end of file
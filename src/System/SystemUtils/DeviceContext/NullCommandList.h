@@ -0,0 +1,81 @@
+﻿#pragma once
+#include "System/SystemUtils/DeviceContext/CommandStream.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 何も実行しないコマンドリスト
+	// @details ID3D12GraphicsCommandListと同じ名前と引数の関数を持ち、積まれたコマンドを種類毎に数えるだけ。
+	//			CommandStreamReplayerの積み先や、StateFilteredCommandList・CommandStreamRecorderの下に入れれば、
+	//			デバイス無しで、コマンドを積むCPU側の処理(記録・再生・ステートの省略)だけを動かして確かめたり計測したりできる。
+	//			D3D12のランタイムには触らないので、ホスト向けのビルド(tests/・bench/)でも使える
+	//-------------------------------------------------------------
+	class NullCommandList
+	{
+	private:
+		using Op = CommandStream::Op;
+
+		std::array<uint64_t, static_cast<size_t>(Op::Count)> counts = {};
+		uint64_t drawn_instance_count = 0;	// 描画のコマンドに渡されたインスタンス数の合計
+
+		void Count(Op op) { counts[static_cast<size_t>(op)]++; }
+
+	public:
+		// @brief 数えた回数を全て0に戻す
+		void Clear() {
+			counts.fill(0);
+			drawn_instance_count = 0;
+		}
+		uint64_t GetCount(Op op) const { return counts[static_cast<size_t>(op)]; }
+		uint64_t GetTotalCount() const {
+			uint64_t total = 0;
+			for (uint64_t count : counts)
+				total += count;
+			return total;
+		}
+		uint64_t GetDrawnInstanceCount() const { return drawn_instance_count; }
+
+		void ResourceBarrier(UINT, const D3D12_RESOURCE_BARRIER*) { Count(Op::ResourceBarrier); }
+		void SetGraphicsRootSignature(ID3D12RootSignature*) { Count(Op::SetGraphicsRootSignature); }
+		void SetComputeRootSignature(ID3D12RootSignature*) { Count(Op::SetComputeRootSignature); }
+		void SetPipelineState(ID3D12PipelineState*) { Count(Op::SetPipelineState); }
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) { Count(Op::IASetPrimitiveTopology); }
+		void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) { Count(Op::SetDescriptorHeaps); }
+
+		void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetGraphicsRootConstantBufferView); }
+		void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetGraphicsRootShaderResourceView); }
+		void SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetGraphicsRootUnorderedAccessView); }
+		void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) { Count(Op::SetGraphicsRootDescriptorTable); }
+		void SetGraphicsRoot32BitConstant(UINT, UINT, UINT) { Count(Op::SetGraphicsRoot32BitConstant); }
+		void SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) { Count(Op::SetGraphicsRoot32BitConstants); }
+		void SetComputeRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetComputeRootConstantBufferView); }
+		void SetComputeRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetComputeRootShaderResourceView); }
+		void SetComputeRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Count(Op::SetComputeRootUnorderedAccessView); }
+		void SetComputeRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) { Count(Op::SetComputeRootDescriptorTable); }
+		void SetComputeRoot32BitConstant(UINT, UINT, UINT) { Count(Op::SetComputeRoot32BitConstant); }
+		void SetComputeRoot32BitConstants(UINT, UINT, const void*, UINT) { Count(Op::SetComputeRoot32BitConstants); }
+
+		void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) { Count(Op::IASetVertexBuffers); }
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) { Count(Op::IASetIndexBuffer); }
+		void OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) { Count(Op::OMSetRenderTargets); }
+		void RSSetViewports(UINT, const D3D12_VIEWPORT*) { Count(Op::RSSetViewports); }
+		void RSSetScissorRects(UINT, const D3D12_RECT*) { Count(Op::RSSetScissorRects); }
+		void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE, const FLOAT*, UINT, const D3D12_RECT*) { Count(Op::ClearRenderTargetView); }
+		void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CLEAR_FLAGS, FLOAT, UINT8, UINT, const D3D12_RECT*) { Count(Op::ClearDepthStencilView); }
+
+		void DrawInstanced(UINT, UINT instance_count, UINT, UINT) {
+			Count(Op::DrawInstanced);
+			drawn_instance_count += instance_count;
+		}
+		void DrawIndexedInstanced(UINT, UINT instance_count, UINT, INT, UINT) {
+			Count(Op::DrawIndexedInstanced);
+			drawn_instance_count += instance_count;
+		}
+		void Dispatch(UINT, UINT, UINT) { Count(Op::Dispatch); }
+		void CopyBufferRegion(ID3D12Resource*, UINT64, ID3D12Resource*, UINT64, UINT64) { Count(Op::CopyBufferRegion); }
+		void ExecuteIndirect(ID3D12CommandSignature*, UINT, ID3D12Resource*, UINT64, ID3D12Resource*, UINT64) { Count(Op::ExecuteIndirect); }
+		void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION*, UINT, UINT, UINT, const D3D12_TEXTURE_COPY_LOCATION*, const D3D12_BOX*) { Count(Op::CopyTextureRegion); }
+		void EndQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) { Count(Op::EndQuery); }
+		void ResolveQueryData(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT, UINT, ID3D12Resource*, UINT64) { Count(Op::ResolveQueryData); }
+	};
+}
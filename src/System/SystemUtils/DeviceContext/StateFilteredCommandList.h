@@ -0,0 +1,299 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 冗長なステート設定を省くための集計
+	//-------------------------------------------------------------
+	struct StateFilterStats {
+		enum Category {
+			RootSignature,
+			PipelineState,
+			PrimitiveTopology,
+			DescriptorHeaps,
+			RootParameter,
+			VertexBuffer,
+			IndexBuffer,
+			RenderTarget,
+			Viewport,
+			ScissorRect,
+			CategoryCount
+		};
+		std::array<unsigned int, CategoryCount> issued = {};	// 実際にコマンドリストに積んだ回数
+		std::array<unsigned int, CategoryCount> skipped = {};	// 同じ値だったので省いた回数
+
+		unsigned int GetIssuedCount() const {
+			unsigned int total = 0;
+			for (unsigned int count : issued)
+				total += count;
+			return total;
+		}
+		unsigned int GetSkippedCount() const {
+			unsigned int total = 0;
+			for (unsigned int count : skipped)
+				total += count;
+			return total;
+		}
+	};
+
+	//-------------------------------------------------------------
+	// @brief 今バインドされているステートを覚えておき、同じ値の再設定を省くコマンドリストのラッパー
+	// @details ルートシグネチャ・PSO・トポロジ・ディスクリプタヒープ・ルートパラメータ・頂点/インデックスバッファ・
+	//			レンダーターゲット・ビューポート・シザー矩形を追跡する。
+	//			D3D12ではコマンドリストをResetすると全てのステートが未設定に戻るので、Reset時にはこちらもResetすること。
+	//			ここを通さずに生のコマンドリストでステートを変えた場合(ImGuiの描画など)は、Invalidateで覚えている値を捨てる。
+	//			コマンドリストの型はテンプレートにしてあるので、同じ名前の関数を持つモックに差し替えれば、
+	//			D3D12が無い環境でもフィルタリングを確かめられる
+	//-------------------------------------------------------------
+	template <class CommandList>
+	class StateFilteredCommandList
+	{
+	public:
+		//ルートシグネチャのルートパラメータは最大64個
+		static constexpr unsigned int MAX_ROOT_PARAMETERS = 64;
+		static constexpr unsigned int MAX_VERTEX_BUFFERS = D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+		static constexpr unsigned int MAX_RENDER_TARGETS = D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT;
+		static constexpr unsigned int MAX_VIEWPORTS = D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	private:
+		enum RootParameterKind : uint32_t {
+			Unbound = 0,
+			ConstantBufferView,
+			ShaderResourceView,
+			UnorderedAccessView,
+			DescriptorTable,
+			Constant,
+		};
+		struct RootParameterState {
+			RootParameterKind kind = Unbound;
+			uint32_t offset = 0;	// ルート定数の場合の、何番目の32bit値か
+			uint64_t value = 0;		// GPUアドレス・ディスクリプタハンドル・ルート定数の値
+		};
+		struct PipelineBindings {
+			const void* root_signature = nullptr;
+			std::array<RootParameterState, MAX_ROOT_PARAMETERS> root_parameters = {};
+		};
+
+		CommandList* command_list = nullptr;
+		StateFilterStats stats = {};
+
+		const void* pipeline_state = nullptr;
+		PipelineBindings graphics = {};
+		PipelineBindings compute = {};
+		D3D12_PRIMITIVE_TOPOLOGY primitive_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		std::array<ID3D12DescriptorHeap*, 2> descriptor_heaps = {};
+		unsigned int descriptor_heap_count = 0;
+		std::array<D3D12_VERTEX_BUFFER_VIEW, MAX_VERTEX_BUFFERS> vertex_buffers = {};
+		std::array<bool, MAX_VERTEX_BUFFERS> vertex_buffer_bound = {};
+		D3D12_INDEX_BUFFER_VIEW index_buffer = {};
+		bool index_buffer_bound = false;
+		std::array<D3D12_CPU_DESCRIPTOR_HANDLE, MAX_RENDER_TARGETS> render_targets = {};
+		unsigned int render_target_count = 0;
+		D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil = {};
+		bool render_targets_bound = false;
+		std::array<D3D12_VIEWPORT, MAX_VIEWPORTS> viewports = {};
+		unsigned int viewport_count = 0;
+		std::array<D3D12_RECT, MAX_VIEWPORTS> scissor_rects = {};
+		unsigned int scissor_rect_count = 0;
+
+		// @brief 値が変わっていれば新しい値を覚えてtrueを返す。変わっていなければ省いた回数を数えてfalseを返す
+		bool Filter(StateFilterStats::Category category, bool changed) {
+			if (changed)
+				stats.issued[category]++;
+			else
+				stats.skipped[category]++;
+			return changed;
+		}
+		bool SetRootParameter(PipelineBindings& bindings, UINT slot, RootParameterKind kind, uint32_t offset, uint64_t value) {
+			//範囲外のスロットは追跡せずにそのまま積む(エラーはデバッグレイヤーに任せる)
+			if (slot >= MAX_ROOT_PARAMETERS)
+				return Filter(StateFilterStats::RootParameter, true);
+			RootParameterState& state = bindings.root_parameters[slot];
+			bool changed = state.kind != kind || state.offset != offset || state.value != value;
+			if (changed)
+				state = { kind, offset, value };
+			return Filter(StateFilterStats::RootParameter, changed);
+		}
+		template <class T>
+		static bool Equals(const T& a, const T& b) {
+			return std::memcmp(&a, &b, sizeof(T)) == 0;
+		}
+	public:
+		StateFilteredCommandList(CommandList* command_list_ = nullptr) :command_list(command_list_) {}
+
+		void SetCommandList(CommandList* command_list_) { command_list = command_list_; Reset(); }
+		// @brief 生のコマンドリスト。リソースバリアや描画など、ステート以外のコマンドはこちらに積む
+		CommandList* Get() const { return command_list; }
+
+		// @brief 覚えている値と集計を全て捨てる(コマンドリストをResetした時に呼ぶ)
+		void Reset() {
+			Invalidate();
+			stats = {};
+		}
+		// @brief 覚えている値だけを捨てる。次の設定は必ずコマンドリストに積まれる
+		void Invalidate() {
+			pipeline_state = nullptr;
+			graphics = {};
+			compute = {};
+			primitive_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+			descriptor_heaps = {};
+			descriptor_heap_count = 0;
+			vertex_buffer_bound = {};
+			index_buffer_bound = false;
+			render_targets_bound = false;
+			viewport_count = 0;
+			scissor_rect_count = 0;
+		}
+		const StateFilterStats& GetStats() const { return stats; }
+
+		void SetGraphicsRootSignature(ID3D12RootSignature* root_signature) {
+			if (!Filter(StateFilterStats::RootSignature, graphics.root_signature != root_signature))
+				return;
+			//ルートシグネチャを変えると、ルートパラメータは全て未設定に戻る
+			graphics = {};
+			graphics.root_signature = root_signature;
+			command_list->SetGraphicsRootSignature(root_signature);
+		}
+		void SetComputeRootSignature(ID3D12RootSignature* root_signature) {
+			if (!Filter(StateFilterStats::RootSignature, compute.root_signature != root_signature))
+				return;
+			compute = {};
+			compute.root_signature = root_signature;
+			command_list->SetComputeRootSignature(root_signature);
+		}
+		void SetPipelineState(ID3D12PipelineState* pipeline_state_) {
+			if (!Filter(StateFilterStats::PipelineState, pipeline_state != pipeline_state_))
+				return;
+			pipeline_state = pipeline_state_;
+			command_list->SetPipelineState(pipeline_state_);
+		}
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) {
+			if (!Filter(StateFilterStats::PrimitiveTopology, primitive_topology != topology))
+				return;
+			primitive_topology = topology;
+			command_list->IASetPrimitiveTopology(topology);
+		}
+		void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps) {
+			bool changed = count > descriptor_heaps.size() || count != descriptor_heap_count;
+			for (UINT i = 0; !changed && i < count; i++)
+				changed = descriptor_heaps[i] != heaps[i];
+			if (!Filter(StateFilterStats::DescriptorHeaps, changed))
+				return;
+			//ヒープを変えると、設定済みのディスクリプタテーブルは前のヒープを指したままになるので、次は必ず積み直す
+			for (PipelineBindings* bindings : { &graphics, &compute }) {
+				for (RootParameterState& state : bindings->root_parameters) {
+					if (state.kind == DescriptorTable)
+						state = {};
+				}
+			}
+			descriptor_heap_count = 0;
+			if (count <= descriptor_heaps.size()) {
+				std::copy(heaps, heaps + count, descriptor_heaps.begin());
+				descriptor_heap_count = count;
+			}
+			command_list->SetDescriptorHeaps(count, heaps);
+		}
+
+		void SetGraphicsRootConstantBufferView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(graphics, slot, ConstantBufferView, 0, address))
+				command_list->SetGraphicsRootConstantBufferView(slot, address);
+		}
+		void SetGraphicsRootShaderResourceView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(graphics, slot, ShaderResourceView, 0, address))
+				command_list->SetGraphicsRootShaderResourceView(slot, address);
+		}
+		void SetGraphicsRootUnorderedAccessView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(graphics, slot, UnorderedAccessView, 0, address))
+				command_list->SetGraphicsRootUnorderedAccessView(slot, address);
+		}
+		void SetGraphicsRootDescriptorTable(UINT slot, D3D12_GPU_DESCRIPTOR_HANDLE handle) {
+			if (SetRootParameter(graphics, slot, DescriptorTable, 0, handle.ptr))
+				command_list->SetGraphicsRootDescriptorTable(slot, handle);
+		}
+		void SetGraphicsRoot32BitConstant(UINT slot, UINT value, UINT offset) {
+			if (SetRootParameter(graphics, slot, Constant, offset, value))
+				command_list->SetGraphicsRoot32BitConstant(slot, value, offset);
+		}
+		void SetComputeRootConstantBufferView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(compute, slot, ConstantBufferView, 0, address))
+				command_list->SetComputeRootConstantBufferView(slot, address);
+		}
+		void SetComputeRootShaderResourceView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(compute, slot, ShaderResourceView, 0, address))
+				command_list->SetComputeRootShaderResourceView(slot, address);
+		}
+		void SetComputeRootUnorderedAccessView(UINT slot, D3D12_GPU_VIRTUAL_ADDRESS address) {
+			if (SetRootParameter(compute, slot, UnorderedAccessView, 0, address))
+				command_list->SetComputeRootUnorderedAccessView(slot, address);
+		}
+		void SetComputeRoot32BitConstant(UINT slot, UINT value, UINT offset) {
+			if (SetRootParameter(compute, slot, Constant, offset, value))
+				command_list->SetComputeRoot32BitConstant(slot, value, offset);
+		}
+
+		void IASetVertexBuffers(UINT start_slot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views) {
+			bool changed = !views || start_slot + count > MAX_VERTEX_BUFFERS;
+			for (UINT i = 0; !changed && i < count; i++)
+				changed = !vertex_buffer_bound[start_slot + i] || !Equals(vertex_buffers[start_slot + i], views[i]);
+			if (!Filter(StateFilterStats::VertexBuffer, changed))
+				return;
+			for (UINT i = 0; i < count && start_slot + i < MAX_VERTEX_BUFFERS; i++) {
+				//nullptrを渡した場合はスロットが外れるので、次は必ず積む
+				vertex_buffer_bound[start_slot + i] = views != nullptr;
+				if (views)
+					vertex_buffers[start_slot + i] = views[i];
+			}
+			command_list->IASetVertexBuffers(start_slot, count, views);
+		}
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+			bool changed = !view || !index_buffer_bound || !Equals(index_buffer, *view);
+			if (!Filter(StateFilterStats::IndexBuffer, changed))
+				return;
+			index_buffer_bound = view != nullptr;
+			if (view)
+				index_buffer = *view;
+			command_list->IASetIndexBuffer(view);
+		}
+
+		void OMSetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, BOOL single_handle_to_range, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) {
+			//連続したハンドルとして渡す形式は追跡しない
+			bool changed = single_handle_to_range || !render_targets_bound || count > MAX_RENDER_TARGETS || count != render_target_count ||
+				(dsv ? depth_stencil.ptr != dsv->ptr : depth_stencil.ptr != 0);
+			for (UINT i = 0; !changed && i < count; i++)
+				changed = render_targets[i].ptr != rtvs[i].ptr;
+			if (!Filter(StateFilterStats::RenderTarget, changed))
+				return;
+			render_targets_bound = !single_handle_to_range && count <= MAX_RENDER_TARGETS;
+			if (render_targets_bound) {
+				render_target_count = count;
+				for (UINT i = 0; i < count; i++)
+					render_targets[i] = rtvs[i];
+				depth_stencil.ptr = dsv ? dsv->ptr : 0;
+			}
+			command_list->OMSetRenderTargets(count, rtvs, single_handle_to_range, dsv);
+		}
+		void RSSetViewports(UINT count, const D3D12_VIEWPORT* new_viewports) {
+			bool changed = count == 0 || count > MAX_VIEWPORTS || count != viewport_count;
+			for (UINT i = 0; !changed && i < count; i++)
+				changed = !Equals(viewports[i], new_viewports[i]);
+			if (!Filter(StateFilterStats::Viewport, changed))
+				return;
+			viewport_count = count <= MAX_VIEWPORTS ? count : 0;
+			for (UINT i = 0; i < viewport_count; i++)
+				viewports[i] = new_viewports[i];
+			command_list->RSSetViewports(count, new_viewports);
+		}
+		void RSSetScissorRects(UINT count, const D3D12_RECT* rects) {
+			bool changed = count == 0 || count > MAX_VIEWPORTS || count != scissor_rect_count;
+			for (UINT i = 0; !changed && i < count; i++)
+				changed = !Equals(scissor_rects[i], rects[i]);
+			if (!Filter(StateFilterStats::ScissorRect, changed))
+				return;
+			scissor_rect_count = count <= MAX_VIEWPORTS ? count : 0;
+			for (UINT i = 0; i < scissor_rect_count; i++)
+				scissor_rects[i] = rects[i];
+			command_list->RSSetScissorRects(count, rects);
+		}
+	};
+}
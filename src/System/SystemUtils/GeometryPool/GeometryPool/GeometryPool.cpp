@@ -0,0 +1,165 @@
+﻿#include "GeometryPool.h"
+
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/D3DBuffer/IndexBuffer/IndexBuffer.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+namespace System {
+
+	namespace {
+		HRESULT CreateBuffer(size_t size, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES state, ComPtr<ID3D12Resource>& out_resource) {
+			D3D12_HEAP_PROPERTIES heap_properties = {};
+			heap_properties.Type = heap_type;
+			heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			heap_properties.CreationNodeMask = 0;
+			heap_properties.VisibleNodeMask = 0;
+			D3D12_RESOURCE_DESC resource_desc = {};
+			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			resource_desc.Alignment = 0;
+			resource_desc.Width = size;
+			resource_desc.Height = 1;
+			resource_desc.DepthOrArraySize = 1;
+			resource_desc.MipLevels = 1;
+			resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+			resource_desc.SampleDesc.Count = 1;
+			resource_desc.SampleDesc.Quality = 0;
+			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			return DirectX12Manager::Instance()->GetDevice()->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, state, nullptr, IID_PPV_ARGS(out_resource.GetAddressOf()));
+		}
+	}
+
+	GeometryPool::GeometryPool(unsigned int vertex_stride_, size_t vertex_capacity, DXGI_FORMAT index_format_, size_t index_capacity)
+		:vertex_allocator(vertex_capacity), index_allocator(index_capacity), vertex_stride(vertex_stride_), index_format(index_format_)
+	{
+		if (vertex_stride == 0 || vertex_capacity == 0 || index_capacity == 0) {
+			return;
+		}
+		if (index_format != DXGI_FORMAT_R16_UINT && index_format != DXGI_FORMAT_R32_UINT) {
+			return;
+		}
+		//インデックスバッファの幅は4バイトの倍数でなければならないので、16bitの場合は切り上げておく
+		size_t vertex_buffer_size = vertex_capacity * vertex_stride;
+		size_t index_buffer_size = (index_capacity * IndexBuffer::GetIndexSize(index_format) + 3) / 4 * 4;
+		if (FAILED(CreateBuffer(vertex_buffer_size, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, vertex_resource))) {
+			return;
+		}
+		if (FAILED(CreateBuffer(index_buffer_size, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, index_resource))) {
+			return;
+		}
+		vb_view.BufferLocation = vertex_resource->GetGPUVirtualAddress();
+		vb_view.SizeInBytes = static_cast<UINT>(vertex_buffer_size);
+		vb_view.StrideInBytes = vertex_stride;
+		ib_view.BufferLocation = index_resource->GetGPUVirtualAddress();
+		ib_view.SizeInBytes = static_cast<UINT>(index_buffer_size);
+		ib_view.Format = index_format;
+		is_valid = true;
+	}
+
+	int GeometryPool::Allocate(size_t vertex_count, size_t index_count, GeometryAllocation& out_allocation)
+	{
+		out_allocation = {};
+		if (!is_valid) {
+			return -1;
+		}
+		//16bitインデックスはメッシュ内のローカルな番号なので、1メッシュの頂点数だけが16bitに収まっていればよい
+		if (index_format == DXGI_FORMAT_R16_UINT && vertex_count > 0x10000) {
+			return -1;
+		}
+		size_t vertex_offset = vertex_allocator.Allocate(vertex_count);
+		if (vertex_offset == RangeAllocator::INVALID_OFFSET) {
+			return -1;
+		}
+		//16bitインデックスの場合、開始位置を偶数に揃えておけば、コピーの開始位置が4バイト境界に乗る
+		size_t index_offset = index_allocator.Allocate(index_count, index_format == DXGI_FORMAT_R16_UINT ? 2 : 1);
+		if (index_offset == RangeAllocator::INVALID_OFFSET) {
+			vertex_allocator.Free(vertex_offset, vertex_count);
+			return -1;
+		}
+		out_allocation.base_vertex = static_cast<unsigned int>(vertex_offset);
+		out_allocation.vertex_count = static_cast<unsigned int>(vertex_count);
+		out_allocation.first_index = static_cast<unsigned int>(index_offset);
+		out_allocation.index_count = static_cast<unsigned int>(index_count);
+		return 0;
+	}
+
+	int GeometryPool::Free(GeometryAllocation& allocation)
+	{
+		if (!allocation.IsValid()) {
+			return -1;
+		}
+		if (vertex_allocator.Free(allocation.base_vertex, allocation.vertex_count) != 0) {
+			return -1;
+		}
+		if (index_allocator.Free(allocation.first_index, allocation.index_count) != 0) {
+			return -1;
+		}
+		allocation = {};
+		return 0;
+	}
+
+	int GeometryPool::Upload(const GeometryAllocation& allocation, const void* vertices, const std::vector<unsigned int>& indices)
+	{
+		PROFILE_FUNCTION();
+		if (!is_valid || !allocation.IsValid() || !vertices || indices.size() != allocation.index_count) {
+			return -1;
+		}
+		//インデックスをプールの形式に変換する
+		std::vector<unsigned char> index_data(indices.size() * IndexBuffer::GetIndexSize(index_format));
+		if (index_format == DXGI_FORMAT_R16_UINT) {
+			unsigned short* dst = reinterpret_cast<unsigned short*>(index_data.data());
+			for (size_t i = 0; i < indices.size(); i++) {
+				if (indices[i] > 0xffff) {
+					return -1;
+				}
+				dst[i] = static_cast<unsigned short>(indices[i]);
+			}
+		}
+		else {
+			std::copy(indices.begin(), indices.end(), reinterpret_cast<unsigned int*>(index_data.data()));
+		}
+		//コピーの長さも4バイトの倍数にしておく(末尾の2バイトは次の範囲の先頭に掛からない位置に揃えてある)
+		index_data.resize((index_data.size() + 3) / 4 * 4);
+
+		if (UploadRegion(vertex_resource.Get(), static_cast<size_t>(allocation.base_vertex) * vertex_stride, vertices, static_cast<size_t>(allocation.vertex_count) * vertex_stride) != 0) {
+			return -1;
+		}
+		if (UploadRegion(index_resource.Get(), static_cast<size_t>(allocation.first_index) * IndexBuffer::GetIndexSize(index_format), index_data.data(), index_data.size()) != 0) {
+			return -1;
+		}
+		return 0;
+	}
+
+	int GeometryPool::UploadRegion(ID3D12Resource* dst, size_t dst_offset, const void* data, size_t size)
+	{
+		ComPtr<ID3D12Resource> upload_buffer;
+		if (FAILED(CreateBuffer(size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, upload_buffer))) {
+			return -1;
+		}
+		void* mapped_data = nullptr;
+		if (FAILED(upload_buffer->Map(0, nullptr, &mapped_data))) {
+			return -1;
+		}
+		std::memcpy(mapped_data, data, size);
+		upload_buffer->Unmap(0, nullptr);
+
+		ID3D12DeviceContext* context = DirectX12Manager::Instance()->GetCopyContext();
+		if (!context || !context->IsValid()) {
+			return -1;
+		}
+		ID3D12GraphicsCommandList* cmd_list = context->GetCommandList();
+		std::vector<ID3D12DeviceContext*> contexts = { context };
+		CommandQueue* copy_queue = DirectX12Manager::Instance()->GetCopyQueue();
+
+		context->ResetCommandList();
+		cmd_list->CopyBufferRegion(dst, dst_offset, upload_buffer.Get(), 0, size);
+		context->CloseCommandList();
+		copy_queue->Execute(contexts);
+		//実行を待たなければ、コピー中にアップロードバッファが破棄されてしまう可能性があるため、コピーキューの完了を待つ
+		copy_queue->WaitForCompletion(context);
+		return 0;
+	}
+}
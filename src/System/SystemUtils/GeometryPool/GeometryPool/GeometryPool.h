@@ -0,0 +1,89 @@
+﻿#pragma once
+#include "System/SystemUtils/GeometryPool/RangeAllocator/RangeAllocator.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief GeometryPoolから切り出した、1メッシュ分の頂点とインデックスの範囲
+	// @details 描画ではbase_vertexをBaseVertexLocationに、first_indexをStartIndexLocationに足して使う。
+	//			インデックスはメッシュ内のローカルな番号のままなので、16bitインデックスでもプール全体の頂点数に縛られない
+	//-------------------------------------------------------------
+	struct GeometryAllocation {
+		unsigned int base_vertex = 0;
+		unsigned int vertex_count = 0;
+		unsigned int first_index = 0;
+		unsigned int index_count = 0;
+		bool IsValid() const { return vertex_count > 0 && index_count > 0; }
+	};
+
+	//-------------------------------------------------------------
+	// @brief 全メッシュの頂点とインデックスを、1本ずつの大きな頂点バッファ・インデックスバッファにまとめるクラス
+	// @details メッシュ毎にコミットリソースを作ると、描画の度にIASetVertexBuffers/IASetIndexBufferを切り替える必要があるが、
+	//			1本にまとめておけばバインドはフレームに1回で済み、ドローの違いは開始位置だけになる。
+	//			(ExecuteIndirectで別々のメッシュを1回にまとめる前提にもなる)
+	//			バッファはデフォルトヒープに作り、Uploadでコピーキュー経由で書き込む。
+	//			頂点フォーマットとインデックスフォーマットはプール全体で1つ
+	//-------------------------------------------------------------
+	class GeometryPool
+	{
+	private:
+		ComPtr<ID3D12Resource> vertex_resource;
+		ComPtr<ID3D12Resource> index_resource;
+		D3D12_VERTEX_BUFFER_VIEW vb_view = {};
+		D3D12_INDEX_BUFFER_VIEW ib_view = {};
+		RangeAllocator vertex_allocator;
+		RangeAllocator index_allocator;
+		unsigned int vertex_stride = 0;
+		DXGI_FORMAT index_format = DXGI_FORMAT_R32_UINT;
+		bool is_valid = false;
+
+		// @brief アップロードヒープを経由して、デフォルトヒープのバッファの一部に書き込む
+		int UploadRegion(ID3D12Resource* dst, size_t dst_offset, const void* data, size_t size);
+	public:
+		//-------------------------------------------------------------
+		// @param [in] vertex_stride_ 1頂点あたりのバイト数
+		// @param [in] vertex_capacity プールに入る頂点数
+		// @param [in] index_format_ インデックスの形式(R16_UINTかR32_UINT)
+		// @param [in] index_capacity プールに入るインデックス数
+		//-------------------------------------------------------------
+		GeometryPool(unsigned int vertex_stride_, size_t vertex_capacity, DXGI_FORMAT index_format_, size_t index_capacity);
+		bool IsValid() const { return is_valid; }
+
+		//-------------------------------------------------------------
+		// @brief 頂点とインデックスの範囲を切り出す
+		//
+		// @param [in] vertex_count 頂点数
+		// @param [in] index_count インデックス数
+		// @param [out] out_allocation 切り出した範囲
+		// @return 成功したら0、空きが足りなければ-1
+		//-------------------------------------------------------------
+		int Allocate(size_t vertex_count, size_t index_count, GeometryAllocation& out_allocation);
+		// @brief 切り出した範囲を返す
+		int Free(GeometryAllocation& allocation);
+
+		//-------------------------------------------------------------
+		// @brief 切り出した範囲に頂点とインデックスを書き込む
+		// @details インデックスはプールの形式に変換して書き込む。16bitに収まらないインデックスがあれば失敗する
+		//
+		// @param [in] allocation Allocateで切り出した範囲
+		// @param [in] vertices 頂点データ(vertex_stride × allocation.vertex_countバイト)
+		// @param [in] indices メッシュ内のローカルなインデックス(allocation.index_count個)
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int Upload(const GeometryAllocation& allocation, const void* vertices, const std::vector<unsigned int>& indices);
+
+		// @brief プールの頂点バッファとインデックスバッファをバインドする
+		// @details 生のコマンドリストでも、StateFilteredCommandListでも渡せるようにテンプレートにしてある
+		template <class CommandList>
+		void Bind(CommandList* cmd_list) const {
+			cmd_list->IASetVertexBuffers(0, 1, &vb_view);
+			cmd_list->IASetIndexBuffer(&ib_view);
+		}
+
+		const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const { return vb_view; }
+		const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const { return ib_view; }
+		DXGI_FORMAT GetIndexFormat() const { return index_format; }
+		const RangeAllocator& GetVertexAllocator() const { return vertex_allocator; }
+		const RangeAllocator& GetIndexAllocator() const { return index_allocator; }
+	};
+}
@@ -0,0 +1,78 @@
+﻿#include "RangeAllocator.h"
+
+namespace System {
+
+	RangeAllocator::RangeAllocator(size_t capacity_)
+		:capacity(capacity_)
+	{
+		if (capacity > 0)
+			free_ranges.emplace(0, capacity);
+	}
+
+	size_t RangeAllocator::Allocate(size_t size, size_t alignment)
+	{
+		if (size == 0 || alignment == 0) {
+			return INVALID_OFFSET;
+		}
+		for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+			size_t range_offset = it->first;
+			size_t range_size = it->second;
+			size_t aligned_offset = (range_offset + alignment - 1) / alignment * alignment;
+			size_t padding = aligned_offset - range_offset;
+			if (range_size < padding + size)
+				continue;
+
+			//揃えるために飛ばした前側と、使わなかった後ろ側は空きとして残す
+			free_ranges.erase(it);
+			if (padding > 0)
+				free_ranges.emplace(range_offset, padding);
+			size_t tail_size = range_size - padding - size;
+			if (tail_size > 0)
+				free_ranges.emplace(aligned_offset + size, tail_size);
+			used_size += size;
+			return aligned_offset;
+		}
+		return INVALID_OFFSET;
+	}
+
+	int RangeAllocator::Free(size_t offset, size_t size)
+	{
+		if (size == 0 || offset > capacity || size > capacity - offset) {
+			return -1;
+		}
+		size_t freed_size = size;
+		//後ろ側の空き(offset以上で最初のもの)と、前側の空きに重なっていたら二重解放
+		auto next = free_ranges.lower_bound(offset);
+		if (next != free_ranges.end() && next->first < offset + size) {
+			return -1;
+		}
+		if (next != free_ranges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second > offset) {
+				return -1;
+			}
+			//前側の空きと隣接していれば繋げる
+			if (prev->first + prev->second == offset) {
+				offset = prev->first;
+				size += prev->second;
+				free_ranges.erase(prev);
+			}
+		}
+		//後ろ側の空きと隣接していれば繋げる
+		if (next != free_ranges.end() && next->first == offset + size) {
+			size += next->second;
+			free_ranges.erase(next);
+		}
+		free_ranges.emplace(offset, size);
+		used_size -= freed_size;
+		return 0;
+	}
+
+	size_t RangeAllocator::GetLargestFreeRange() const
+	{
+		size_t largest = 0;
+		for (const auto& range : free_ranges)
+			largest = std::max(largest, range.second);
+		return largest;
+	}
+}
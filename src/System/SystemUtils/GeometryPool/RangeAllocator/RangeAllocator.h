@@ -0,0 +1,48 @@
+﻿#pragma once
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 一次元の範囲(頂点番号やインデックス番号)を切り出して貸し出すクラス
+	// @details 空いている範囲を開始位置順に持っておき、先頭から順に入る所を探して切り出す(ファーストフィット)。
+	//			返却された範囲は前後の空きと繋げて1つにするので、確保と解放を繰り返しても細切れになりにくい。
+	//			単位は何でもよく、GeometryPoolでは頂点数・インデックス数で使う
+	//-------------------------------------------------------------
+	class RangeAllocator
+	{
+	public:
+		//確保に失敗した時の開始位置
+		static constexpr size_t INVALID_OFFSET = ~static_cast<size_t>(0);
+	private:
+		//空いている範囲(開始位置→長さ)
+		std::map<size_t, size_t> free_ranges;
+		size_t capacity = 0;
+		size_t used_size = 0;
+	public:
+		RangeAllocator(size_t capacity_ = 0);
+
+		//-------------------------------------------------------------
+		// @brief 範囲を切り出す
+		//
+		// @param [in] size 長さ
+		// @param [in] alignment 開始位置をこの倍数に揃える
+		// @return 開始位置。空きが足りなければINVALID_OFFSET
+		//-------------------------------------------------------------
+		size_t Allocate(size_t size, size_t alignment = 1);
+
+		//-------------------------------------------------------------
+		// @brief 切り出した範囲を返す
+		//
+		// @param [in] offset Allocateが返した開始位置
+		// @param [in] size Allocateに渡した長さ
+		// @return 成功したら0、範囲外や二重解放なら-1
+		//-------------------------------------------------------------
+		int Free(size_t offset, size_t size);
+
+		size_t GetCapacity() const { return capacity; }
+		size_t GetUsedSize() const { return used_size; }
+		size_t GetFreeSize() const { return capacity - used_size; }
+		// @brief 一度に確保できる最大の長さ(断片化の目安)
+		size_t GetLargestFreeRange() const;
+	};
+}
@@ -0,0 +1,71 @@
+﻿#include "IndirectCommandBuffer.h"
+#include "System/SystemUtils/D3DBuffer/StructuredBuffer/StructuredBuffer.h"
+
+namespace System {
+
+	IndirectCommandBuffer::IndirectCommandBuffer(ID3D12RootSignature* root_signature, unsigned int root_constant_slot, size_t max_command_count_)
+	{
+		//IndirectDrawCommandの並びと同じ順に引数を並べる
+		std::array<D3D12_INDIRECT_ARGUMENT_DESC, 4> arguments = {};
+		for (unsigned int i = 0; i < 3; i++) {
+			arguments[i].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			arguments[i].Constant.RootParameterIndex = root_constant_slot + i;
+			arguments[i].Constant.DestOffsetIn32BitValues = 0;
+			arguments[i].Constant.Num32BitValuesToSet = 1;
+		}
+		arguments[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC signature_desc = {};
+		signature_desc.ByteStride = sizeof(IndirectDrawCommand);
+		signature_desc.NumArgumentDescs = static_cast<UINT>(arguments.size());
+		signature_desc.pArgumentDescs = arguments.data();
+		signature_desc.NodeMask = 0;
+		//ルート定数を書き換える場合は、ルートシグネチャを渡す必要がある
+		HRESULT hr = DirectX12Manager::Instance()->GetDevice()->CreateCommandSignature(&signature_desc, root_signature, IID_PPV_ARGS(command_signature.GetAddressOf()));
+		if (FAILED(hr)) {
+			return;
+		}
+
+		for (auto& buffer : frame_command_buffers) {
+			buffer = std::make_unique<StructuredBufferTyped<IndirectDrawCommand>>(max_command_count_);
+			if (!buffer->IsValid()) {
+				return;
+			}
+		}
+		max_command_count = max_command_count_;
+		is_valid = true;
+	}
+
+	IndirectCommandBuffer::~IndirectCommandBuffer() = default;
+
+	int IndirectCommandBuffer::Begin()
+	{
+		if (!is_valid) {
+			return -1;
+		}
+		//引数バッファはアップロードヒープに置いてあるので、GPUが読んでいる最中のフレームのものは書き換えない
+		mapped_commands = frame_command_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->Map();
+		if (!mapped_commands) {
+			return -1;
+		}
+		command_count = 0;
+		return 0;
+	}
+
+	int IndirectCommandBuffer::Add(const IndirectDrawCommand& command)
+	{
+		if (!mapped_commands || command_count >= max_command_count) {
+			return -1;
+		}
+		if (command.draw.InstanceCount == 0 || command.draw.IndexCountPerInstance == 0) {
+			return 0;
+		}
+		mapped_commands[command_count++] = command;
+		return 0;
+	}
+
+	ID3D12Resource* IndirectCommandBuffer::GetFrameArgumentBuffer() const
+	{
+		return frame_command_buffers[DirectX12Manager::Instance()->GetFrameIndex()]->GetResource();
+	}
+}
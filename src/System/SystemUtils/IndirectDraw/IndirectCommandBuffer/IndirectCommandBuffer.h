@@ -0,0 +1,104 @@
+﻿#pragma once
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+
+namespace System {
+	class StructuredBuffer;
+	template <class T> class StructuredBufferTyped;
+
+	//-------------------------------------------------------------
+	// @brief ExecuteIndirectで1ドロー分として読まれる引数
+	// @details コマンドシグネチャの引数と同じ順に並べてある。
+	//			頂点とインデックスは全メッシュがGeometryPoolにまとまっているので、ドロー毎の違いはBaseVertexLocationとStartIndexLocationだけ。
+	//			ルート定数はマテリアル番号・メッシュ番号・インスタンス番号の表の開始位置の3つで、
+	//			今までSetGraphicsRoot32BitConstantで渡していたものと同じ。
+	//			コンピュートシェーダーからもバイトオフセットで触るので、並びを変える時はシェーダー側も直すこと
+	//-------------------------------------------------------------
+	struct IndirectDrawCommand {
+		unsigned int material_index = 0;
+		unsigned int mesh_index = 0;
+		unsigned int instance_offset = 0;
+		D3D12_DRAW_INDEXED_ARGUMENTS draw = {};
+	};
+	static_assert(sizeof(IndirectDrawCommand) == 32, "IndirectDrawCommand must match the layout used by the compute shader");
+
+	//-------------------------------------------------------------
+	// @brief ExecuteIndirect用のコマンドシグネチャと、CPUで組み立てる引数バッファ
+	// @details 描画の度にCPUからSetGraphicsRoot32BitConstantとDrawIndexedInstancedを発行する代わりに、
+	//			ドロー毎の引数を1本のバッファに詰めておき、ExecuteIndirect1回で全部描く。
+	//			引数バッファはフレーム毎に用意していて、Begin→Add→ExecuteでCPU側から組み立てる(検証用兼フォールバック)。
+	//			GPUで組み立てた引数バッファも、同じコマンドシグネチャでExecuteできる。
+	//			頂点・インデックスバッファは切り替えないので、Executeの前にGeometryPool::Bindしておくこと
+	//-------------------------------------------------------------
+	class IndirectCommandBuffer
+	{
+	private:
+		ComPtr<ID3D12CommandSignature> command_signature;
+		std::array<std::unique_ptr<StructuredBufferTyped<IndirectDrawCommand>>, DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT> frame_command_buffers;
+		size_t max_command_count = 0;
+		size_t command_count = 0;
+		IndirectDrawCommand* mapped_commands = nullptr;
+		bool is_valid = false;
+
+		// @brief 今のフレームの引数バッファ
+		ID3D12Resource* GetFrameArgumentBuffer() const;
+	public:
+		//-------------------------------------------------------------
+		// @brief コマンドシグネチャと引数バッファを作成する
+		//
+		// @param [in] root_signature 描画に使うルートシグネチャ(ルート定数を変えるので必要)
+		// @param [in] root_constant_slot マテリアル番号を渡すルート定数のスロット。ここから3つ続けて使う
+		// @param [in] max_command_count 1フレームで積めるドローの最大数
+		//-------------------------------------------------------------
+		IndirectCommandBuffer(ID3D12RootSignature* root_signature, unsigned int root_constant_slot, size_t max_command_count_);
+		~IndirectCommandBuffer();
+		bool IsValid() const { return is_valid; }
+
+		ID3D12CommandSignature* GetCommandSignature() const { return command_signature.Get(); }
+		size_t GetMaxCommandCount() const { return max_command_count; }
+		size_t GetCommandCount() const { return command_count; }
+
+		// @brief 今のフレームの引数バッファを空にする
+		int Begin();
+		// @brief ドローを1つ積む。インスタンス数が0のドローは積まない
+		int Add(const IndirectDrawCommand& command);
+		// @brief 今のフレームで積んだドローを、ExecuteIndirect1回で描画する
+		// @details Execute系は、生のコマンドリストでもCommandStreamRecorderなどのラッパーでも渡せるようにテンプレートにしてある
+		template <class CommandList>
+		int Execute(CommandList* cmd_list) {
+			return ExecuteRange(cmd_list, 0, command_count);
+		}
+		// @brief 今のフレームで積んだドローのうち、first_commandからcommand_count個だけを描画する(PSOの切り替え毎に区切る場合など)
+		template <class CommandList>
+		int ExecuteRange(CommandList* cmd_list, size_t first_command, size_t command_count_) {
+			if (!mapped_commands || first_command + command_count_ > command_count) {
+				return -1;
+			}
+			if (command_count_ == 0) {
+				return 0;
+			}
+			cmd_list->ExecuteIndirect(command_signature.Get(), static_cast<UINT>(command_count_), GetFrameArgumentBuffer(), first_command * sizeof(IndirectDrawCommand), nullptr, 0);
+			return 0;
+		}
+
+		//-------------------------------------------------------------
+		// @brief GPUで組み立てた引数バッファを描画する
+		// @details 引数バッファはD3D12_RESOURCE_STATE_INDIRECT_ARGUMENTに遷移させておくこと
+		//
+		// @param [in] cmd_list コマンドリスト
+		// @param [in] argument_buffer IndirectDrawCommandが並んだバッファ
+		// @param [in] command_count 描画するドロー数
+		// @param [in] count_buffer 実際のドロー数が入ったバッファ。nullptrならcommand_countをそのまま使う
+		//-------------------------------------------------------------
+		template <class CommandList>
+		int Execute(CommandList* cmd_list, ID3D12Resource* argument_buffer, unsigned int command_count_, ID3D12Resource* count_buffer = nullptr) {
+			if (!is_valid || !argument_buffer) {
+				return -1;
+			}
+			if (command_count_ == 0) {
+				return 0;
+			}
+			cmd_list->ExecuteIndirect(command_signature.Get(), command_count_, argument_buffer, 0, count_buffer, 0);
+			return 0;
+		}
+	};
+}
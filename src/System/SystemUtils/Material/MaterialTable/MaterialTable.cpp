@@ -0,0 +1,170 @@
+﻿#include "MaterialTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace System {
+
+	namespace {
+		uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+		uint64_t HashFloat(uint64_t hash, float value)
+		{
+			//0と-0は同じ値として扱う(比較は==で行うため)
+			if (value == 0.0f) value = 0.0f;
+			return HashBytes(hash, &value, sizeof(value));
+		}
+	}
+
+	size_t MaterialTable::DescHash::operator()(const Desc& desc) const
+	{
+		//パディングを含めないように、メンバー毎に混ぜる(FNV-1a)
+		uint64_t hash = 14695981039346656037ull;
+		for (float value : desc.diffuse_color)
+			hash = HashFloat(hash, value);
+		hash = HashFloat(hash, desc.metallic);
+		hash = HashFloat(hash, desc.roughness);
+		hash = HashBytes(hash, desc.textures, sizeof(desc.textures));
+		hash = HashBytes(hash, &desc.flags, sizeof(desc.flags));
+		return static_cast<size_t>(hash);
+	}
+
+	bool MaterialTable::DescEqual::operator()(const Desc& a, const Desc& b) const
+	{
+		for (size_t i = 0; i < 4; i++) {
+			if (a.diffuse_color[i] != b.diffuse_color[i]) return false;
+		}
+		return a.metallic == b.metallic && a.roughness == b.roughness && a.flags == b.flags &&
+			std::equal(std::begin(a.textures), std::end(a.textures), std::begin(b.textures));
+	}
+
+	uint32_t MaterialTable::Add(const Desc& desc, bool* out_created)
+	{
+		if (out_created) *out_created = false;
+		auto found = lookup.find(desc);
+		if (found != lookup.end()) {
+			return found->second;
+		}
+		if (descs.size() >= MAX_MATERIAL_COUNT) {
+			return INVALID_ID;
+		}
+		uint32_t id = static_cast<uint32_t>(descs.size());
+		descs.push_back(desc);
+		GpuMaterial material = {};
+		std::memcpy(material.diffuse_color, desc.diffuse_color, sizeof(material.diffuse_color));
+		material.metallic = desc.metallic;
+		material.roughness = desc.roughness;
+		for (uint32_t& indices : material.texture_indices)
+			indices = 0xffffffff;
+		material.flags = desc.flags;
+		gpu_materials.push_back(material);
+		is_dirty.push_back(false);
+		lookup.emplace(desc, id);
+		MarkDirty(id);
+		if (out_created) *out_created = true;
+		return id;
+	}
+
+	int MaterialTable::Modify(uint32_t id, const Desc& desc)
+	{
+		if (!IsValidId(id)) {
+			return -1;
+		}
+		Desc& current = descs[id];
+		//古い内容で引けるのがこの番号なら、引けないようにする(同じ内容の別の番号が残っていれば、そちらはそのまま)
+		auto found = lookup.find(current);
+		if (found != lookup.end() && found->second == id) {
+			lookup.erase(found);
+		}
+		GpuMaterial& material = gpu_materials[id];
+		for (uint32_t slot = 0; slot < TextureSlotCount; slot++) {
+			if (current.textures[slot] != desc.textures[slot]) {
+				SetTextureIndex(id, slot, INVALID_TEXTURE);
+			}
+		}
+		current = desc;
+		std::memcpy(material.diffuse_color, desc.diffuse_color, sizeof(material.diffuse_color));
+		material.metallic = desc.metallic;
+		material.roughness = desc.roughness;
+		material.flags = desc.flags;
+		lookup.emplace(desc, id);
+		MarkDirty(id);
+		return 0;
+	}
+
+	int MaterialTable::SetTextureIndex(uint32_t id, uint32_t slot, uint32_t srv_index)
+	{
+		//最上位のビットが立つ番号は、アトラスの参照としてシェーダーに読まれてしまう
+		if (!IsValidId(id) || slot >= TextureSlotCount || (srv_index >= ATLAS_ENTRY_BIT && srv_index != INVALID_TEXTURE)) {
+			return -1;
+		}
+		WriteTextureIndex(id, slot, static_cast<uint16_t>(srv_index));
+		return 0;
+	}
+
+	int MaterialTable::SetAtlasEntry(uint32_t id, uint32_t slot, uint32_t atlas_entry)
+	{
+		if (!IsValidId(id) || slot >= TextureSlotCount || atlas_entry >= MAX_ATLAS_ENTRY_COUNT) {
+			return -1;
+		}
+		WriteTextureIndex(id, slot, MakeAtlasTextureIndex(atlas_entry));
+		return 0;
+	}
+
+	void MaterialTable::WriteTextureIndex(uint32_t id, uint32_t slot, uint16_t texture_index)
+	{
+		uint32_t& packed = gpu_materials[id].texture_indices[slot / 2];
+		uint32_t shift = (slot % 2) * 16;
+		uint32_t updated = (packed & ~(0xffffu << shift)) | (static_cast<uint32_t>(texture_index) << shift);
+		if (updated != packed) {
+			packed = updated;
+			MarkDirty(id);
+		}
+	}
+
+	uint16_t MaterialTable::GetTextureIndex(const GpuMaterial& material, uint32_t slot)
+	{
+		if (slot >= TextureSlotCount) return INVALID_TEXTURE;
+		return static_cast<uint16_t>(material.texture_indices[slot / 2] >> ((slot % 2) * 16));
+	}
+
+	void MaterialTable::MarkDirty(uint32_t id)
+	{
+		if (is_dirty[id]) return;
+		is_dirty[id] = true;
+		dirty.push_back(id);
+	}
+
+	void MaterialTable::MarkAllDirty()
+	{
+		for (uint32_t id = 0; id < descs.size(); id++)
+			MarkDirty(id);
+	}
+
+	std::vector<MaterialTable::Range> MaterialTable::TakeDirtyRanges(uint32_t merge_gap)
+	{
+		std::vector<Range> ranges;
+		std::sort(dirty.begin(), dirty.end());
+		for (uint32_t id : dirty) {
+			is_dirty[id] = false;
+			if (!ranges.empty()) {
+				Range& last = ranges.back();
+				uint32_t end = last.begin + last.count;
+				if (id - end <= merge_gap) {
+					last.count = id + 1 - last.begin;
+					continue;
+				}
+			}
+			ranges.push_back({ id, 1 });
+		}
+		dirty.clear();
+		return ranges;
+	}
+}
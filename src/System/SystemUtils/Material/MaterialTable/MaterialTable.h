@@ -0,0 +1,142 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief マテリアルの一覧を、重複を省いてGPUに送る形式(1マテリアル40バイト)で持つクラス
+	// @details ・同じ内容(色・パラメーター・テクスチャ)のマテリアルを2回追加すると、同じ番号を返す
+	//			・テクスチャは、Descでは区別するための値(ハンドルなど)で持ち、GPUに送るSRVの番号は後から決める
+	//			  (読み込み中のテクスチャは、読み終わってから番号を書き換えられる)
+	//			・SRVの番号は16bitで、2つずつ1つのuintに詰める。テクスチャが無いスロットはINVALID_TEXTURE
+	//			・最上位のビット(ATLAS_ENTRY_BIT)が立っている番号は、SRVではなくアトラスの参照の表(GpuAtlasEntry)の番号。
+	//			  シェーダーはそこからTexture2DArrayのSRVの番号・配列の要素・UVの変換を引く
+	//			・書き換えた番号を覚えておき、TakeDirtyRangesで転送が必要な範囲だけを返す
+	//			デバイスには触らないので、デバイス無しで重複の除去や転送する範囲を確かめられる
+	//-------------------------------------------------------------
+	class MaterialTable
+	{
+	public:
+		// @brief テクスチャのスロット。シェーダーのGetTextureIndexと同じ順
+		enum TextureSlot : uint32_t {
+			Diffuse,
+			Normal,
+			Roughness,
+			Metallic,
+			Emission,
+			TextureSlotCount,
+		};
+		static constexpr uint32_t INVALID_ID = 0xffffffff;
+		static constexpr uint16_t INVALID_TEXTURE = 0xffff;
+		// @brief 立っていれば、残りのビットはアトラスの参照の表の番号(SRVの番号はこれより小さいものだけ使える)
+		static constexpr uint16_t ATLAS_ENTRY_BIT = 0x8000;
+		// @brief アトラスの参照の表に入る数(INVALID_TEXTUREと重ならない所まで)
+		static constexpr uint32_t MAX_ATLAS_ENTRY_COUNT = INVALID_TEXTURE & ~ATLAS_ENTRY_BIT;
+		// @brief マテリアルの番号の上限(RenderQueueのソートキーに16bitで入る数)
+		static constexpr uint32_t MAX_MATERIAL_COUNT = 1u << 16;
+		static constexpr uint32_t FLAG_TRANSLUCENT = 1u << 0;	// 不透明の後に、奥から描く
+
+		// @brief マテリアルの内容。全て同じなら同じマテリアルとして扱う
+		struct Desc {
+			float diffuse_color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			float metallic = 0.0f;
+			float roughness = 1.0f;
+			uint64_t textures[TextureSlotCount] = {};	// テクスチャを区別する値。0はテクスチャ無し
+			uint32_t flags = 0;
+		};
+		// @brief GPUに送る形式(シェーダーのMaterialDataと同じ並び)
+		struct GpuMaterial {
+			float diffuse_color[4];
+			float metallic;
+			float roughness;
+			uint32_t texture_indices[(TextureSlotCount + 1) / 2];	// SRVの番号を16bitずつ、偶数のスロットを下位に詰める
+			uint32_t flags;
+		};
+		static_assert(sizeof(GpuMaterial) == 40, "シェーダーのMaterialDataと大きさを揃えること");
+		// @brief アトラスや配列にまとめたテクスチャ1つ分の参照(シェーダーのAtlasEntryDataと同じ並び)
+		struct GpuAtlasEntry {
+			uint32_t srv_index;		// まとめた先のTexture2DArrayのSRVの番号
+			uint32_t array_index;	// 配列の要素の番号
+			float uv_scale[2];		// 元のUVを、uv * uv_scale + uv_offsetで配列の要素の中のUVに直す
+			float uv_offset[2];
+			uint32_t padding[2];
+		};
+		static_assert(sizeof(GpuAtlasEntry) == 32, "シェーダーのAtlasEntryDataと大きさを揃えること");
+		// @brief 転送が必要な、番号の連続した範囲
+		struct Range {
+			uint32_t begin = 0;
+			uint32_t count = 0;
+		};
+
+	private:
+		struct DescHash {
+			size_t operator()(const Desc& desc) const;
+		};
+		struct DescEqual {
+			bool operator()(const Desc& a, const Desc& b) const;
+		};
+		std::vector<Desc> descs;
+		std::vector<GpuMaterial> gpu_materials;
+		std::unordered_map<Desc, uint32_t, DescHash, DescEqual> lookup;	// 内容から番号を引く
+		std::vector<uint32_t> dirty;		// 書き換えた番号(重複しない)
+		std::vector<bool> is_dirty;
+
+		void MarkDirty(uint32_t id);
+		void WriteTextureIndex(uint32_t id, uint32_t slot, uint16_t texture_index);
+
+	public:
+		//-------------------------------------------------------------
+		// @brief マテリアルを追加する。同じ内容のものがあれば、その番号を返す
+		// @details 追加したマテリアルのテクスチャの番号は、全てINVALID_TEXTURE
+		// @param [out] out_created 新しく追加したらtrue
+		// @return マテリアルの番号。上限に達していればINVALID_ID
+		//-------------------------------------------------------------
+		uint32_t Add(const Desc& desc, bool* out_created = nullptr);
+
+		//-------------------------------------------------------------
+		// @brief マテリアルの内容を書き換える(同じ番号を使っている全ての描画に効く)
+		// @details テクスチャを区別する値が変わったスロットは、番号をINVALID_TEXTUREに戻す
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int Modify(uint32_t id, const Desc& desc);
+
+		//-------------------------------------------------------------
+		// @brief スロットのテクスチャのSRVの番号を書き込む(同じ値なら転送しない)
+		// @details アトラスの参照と区別できなくなるので、ATLAS_ENTRY_BITが立つ番号は書けない(INVALID_TEXTUREは書ける)
+		// @return 成功したら0。番号がATLAS_ENTRY_BIT以上なら-1
+		//-------------------------------------------------------------
+		int SetTextureIndex(uint32_t id, uint32_t slot, uint32_t srv_index);
+
+		//-------------------------------------------------------------
+		// @brief スロットに、アトラスの参照の表の番号を書き込む(同じ値なら転送しない)
+		// @return 成功したら0。表に入らない番号なら-1
+		//-------------------------------------------------------------
+		int SetAtlasEntry(uint32_t id, uint32_t slot, uint32_t atlas_entry);
+
+		// @brief 全てのマテリアルを転送し直す(GPUのバッファを作り直した時)
+		void MarkAllDirty();
+
+		//-------------------------------------------------------------
+		// @brief 前回から書き換えたマテリアルの範囲を、番号の順に返して忘れる
+		// @param [in] merge_gap 間の書き換えていないマテリアルがこの数以下なら、1つの範囲にまとめる(コピーの回数を減らす)
+		//-------------------------------------------------------------
+		std::vector<Range> TakeDirtyRanges(uint32_t merge_gap = 4);
+		bool HasDirty() const { return !dirty.empty(); }
+
+		// @brief GPUに送る形式で、スロットのSRVの番号を取り出す
+		static uint16_t GetTextureIndex(const GpuMaterial& material, uint32_t slot);
+		// @brief アトラスの参照の表の番号を、スロットに書く値にする。表に入らない番号ならINVALID_TEXTURE
+		static uint16_t MakeAtlasTextureIndex(uint32_t atlas_entry) { return atlas_entry < MAX_ATLAS_ENTRY_COUNT ? static_cast<uint16_t>(ATLAS_ENTRY_BIT | atlas_entry) : INVALID_TEXTURE; }
+		static bool IsAtlasTextureIndex(uint16_t texture_index) { return texture_index != INVALID_TEXTURE && (texture_index & ATLAS_ENTRY_BIT) != 0; }
+
+		size_t GetCount() const { return descs.size(); }
+		bool IsValidId(uint32_t id) const { return id < descs.size(); }
+		const Desc& GetDesc(uint32_t id) const { return descs[id]; }
+		const GpuMaterial& GetGpuMaterial(uint32_t id) const { return gpu_materials[id]; }
+		const std::vector<GpuMaterial>& GetGpuMaterials() const { return gpu_materials; }
+		bool IsTranslucent(uint32_t id) const { return id < descs.size() && (descs[id].flags & FLAG_TRANSLUCENT) != 0; }
+	};
+}
@@ -0,0 +1,147 @@
+﻿#pragma once
+#include <DirectXMath.h>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 頂点の逆量子化パラメータ
+	// @brief 位置を16bit正規化整数で持つ場合に、メッシュ毎に元の座標へ戻すための値
+	// @details シェーダー側では pos = offset + unorm * scale で復元する。
+	//			StructuredBufferにそのまま入れるため、float4境界に揃えてある
+	//-------------------------------------------------------------
+	struct VertexDequant {
+		DirectX::XMFLOAT3 offset = { 0.0f, 0.0f, 0.0f };
+		float padding0 = 0.0f;
+		DirectX::XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
+		float padding1 = 0.0f;
+	};
+
+	//-------------------------------------------------------------
+	// @brief LOD1段分の、インデックスバッファ内の範囲
+	// @details 全てのLODは同じ頂点バッファを共有していて、インデックスの範囲だけが違う
+	//-------------------------------------------------------------
+	struct MeshLod {
+		unsigned int index_offset = 0;	// indices内の開始位置
+		unsigned int index_count = 0;	// インデックス数
+		float error = 0.0f;				// 簡略化による誤差(メッシュの大きさに対する比率)
+	};
+
+	//-------------------------------------------------------------
+	// @brief メッシュレット(数十頂点・百数十三角形程度の小さな三角形の塊)
+	// @details メッシュシェーダーでもそのまま使えるように、頂点は meshlet_vertices への範囲、
+	//			三角形はメッシュレット内のローカル番号(1バイト×3)として meshlet_triangles への範囲で持つ。
+	//			また、メッシュレットはLOD0の三角形を先頭から順に区切って作るので、
+	//			LOD0のインデックスでは lods[0].index_offset + triangle_offset * 3 から triangle_count * 3 個がこのメッシュレットになる。
+	//			StructuredBufferにそのまま入れるため、float4境界に揃えてある
+	//-------------------------------------------------------------
+	struct Meshlet {
+		unsigned int vertex_offset = 0;		// meshlet_vertices内の開始位置
+		unsigned int vertex_count = 0;		// 頂点数
+		unsigned int triangle_offset = 0;	// 三角形の開始位置(meshlet_trianglesでは3倍した位置)
+		unsigned int triangle_count = 0;	// 三角形数
+		DirectX::XMFLOAT4 bounding_sphere = { 0.0f, 0.0f, 0.0f, 0.0f };	// xyz:中心, w:半径
+		DirectX::XMFLOAT3 cone_axis = { 0.0f, 0.0f, 0.0f };				// 法線コーンの軸(三角形の法線の平均)
+		float cone_cutoff = 1.0f;											// 法線コーンの広がり(sin)。1なら背面カリングしない
+	};
+
+	//-------------------------------------------------------------
+	// @brief 読み込んだメッシュのCPU側データ
+	// @details verticesはインポート直後の「元データ」の並びで、GPUに送る形式とは別物。
+	//			GPUに送る際は、VertexFormatで圧縮した形式に変換してから頂点バッファを作る
+	//-------------------------------------------------------------
+	struct MeshInfo {
+		//元データの1頂点あたりのfloat数
+		//float3 位置, float4 カラー, float2 UV, float3 法線 の順に並んでいる
+		static constexpr unsigned int SOURCE_STRIDE = 12;
+		static constexpr unsigned int POSITION_OFFSET = 0;
+		static constexpr unsigned int COLOR_OFFSET = 3;
+		static constexpr unsigned int TEXCOORD_OFFSET = 7;
+		static constexpr unsigned int NORMAL_OFFSET = 9;
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		unsigned int material_index = 0;
+		VertexDequant dequant = {};
+		//インデックスバッファの形式。頂点数が65536未満ならR16_UINTになる
+		DXGI_FORMAT index_format = DXGI_FORMAT_R32_UINT;
+		//LODチェーン。lods[0]が元のメッシュで、indicesには全LODのインデックスが順に詰まっている
+		//空の場合はindices全体を1段のLODとして扱う
+		std::vector<MeshLod> lods;
+		//ローカル空間でのバウンディングスフィア(xyz:中心, w:半径)
+		DirectX::XMFLOAT4 bounding_sphere = { 0.0f, 0.0f, 0.0f, 0.0f };
+		//ローカル空間でのAABB
+		DirectX::XMFLOAT3 bounding_box_min = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 bounding_box_max = { 0.0f, 0.0f, 0.0f };
+		//LOD0を分割したメッシュレット
+		std::vector<Meshlet> meshlets;
+		std::vector<unsigned int> meshlet_vertices;
+		std::vector<unsigned char> meshlet_triangles;
+
+		size_t GetVertexCount() const { return vertices.size() / SOURCE_STRIDE; }
+		const float* GetPosition(size_t vertex) const { return &vertices[vertex * SOURCE_STRIDE + POSITION_OFFSET]; }
+
+		size_t GetLodCount() const { return lods.empty() ? 1 : lods.size(); }
+		MeshLod GetLod(size_t lod) const {
+			if (lods.empty())
+				return { 0, static_cast<unsigned int>(indices.size()), 0.0f };
+			return lods[lod];
+		}
+
+		//-------------------------------------------------------------
+		// @brief 画面上の大きさから、使うLODを選ぶ
+		// @details 誤差が画面上でmax_pixel_errorピクセル以下に収まる中で、一番粗いLODを返す
+		//
+		// @param [in] screen_size メッシュが画面上で占める大きさ(ピクセル, バウンディングスフィアの直径)
+		// @param [in] max_pixel_error 許容する画面上の誤差(ピクセル)
+		// @return LODの番号
+		//-------------------------------------------------------------
+		unsigned int SelectLod(float screen_size, float max_pixel_error) const {
+			unsigned int selected = 0;
+			for (size_t i = 1; i < lods.size(); i++) {
+				if (lods[i].error * screen_size > max_pixel_error)
+					break;
+				selected = static_cast<unsigned int>(i);
+			}
+			return selected;
+		}
+
+		// @brief 誤差がmax_error(メッシュの大きさに対する比率)以下に収まる中で、一番粗いLODを返す
+		unsigned int SelectLodByError(float max_error) const {
+			unsigned int selected = 0;
+			for (size_t i = 1; i < lods.size(); i++) {
+				if (lods[i].error > max_error)
+					break;
+				selected = static_cast<unsigned int>(i);
+			}
+			return selected;
+		}
+
+		// @brief 頂点からAABBとバウンディングスフィア(AABBの中心と、そこから一番遠い頂点までの距離)を求める
+		void ComputeBounds() {
+			size_t vertex_count = GetVertexCount();
+			if (vertex_count == 0)
+				return;
+			float bb_min[3] = { GetPosition(0)[0], GetPosition(0)[1], GetPosition(0)[2] };
+			float bb_max[3] = { bb_min[0], bb_min[1], bb_min[2] };
+			for (size_t i = 1; i < vertex_count; i++) {
+				const float* pos = GetPosition(i);
+				for (int axis = 0; axis < 3; axis++) {
+					bb_min[axis] = std::min(bb_min[axis], pos[axis]);
+					bb_max[axis] = std::max(bb_max[axis], pos[axis]);
+				}
+			}
+			bounding_box_min = DirectX::XMFLOAT3(bb_min[0], bb_min[1], bb_min[2]);
+			bounding_box_max = DirectX::XMFLOAT3(bb_max[0], bb_max[1], bb_max[2]);
+			float center[3] = { (bb_min[0] + bb_max[0]) * 0.5f, (bb_min[1] + bb_max[1]) * 0.5f, (bb_min[2] + bb_max[2]) * 0.5f };
+			float radius_sq = 0.0f;
+			for (size_t i = 0; i < vertex_count; i++) {
+				const float* pos = GetPosition(i);
+				float dx = pos[0] - center[0];
+				float dy = pos[1] - center[1];
+				float dz = pos[2] - center[2];
+				radius_sq = std::max(radius_sq, dx * dx + dy * dy + dz * dz);
+			}
+			bounding_sphere = DirectX::XMFLOAT4(center[0], center[1], center[2], std::sqrt(radius_sq));
+		}
+	};
+}
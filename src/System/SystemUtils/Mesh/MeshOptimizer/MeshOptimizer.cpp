@@ -0,0 +1,326 @@
+﻿#include "MeshOptimizer.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace System {
+
+	namespace {
+		//Forsythのスコア計算用の定数(論文の推奨値そのまま)
+		constexpr int FORSYTH_CACHE_SIZE = 32;
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		//頂点のスコア
+		//キャッシュの先頭に近い程、残りの三角形が少ない程(孤立した頂点を早く片付ける)高くなる
+		float VertexScore(int cache_position, unsigned int remaining_triangles) {
+			if (remaining_triangles == 0)
+				return -1.0f;
+			float score = 0.0f;
+			if (cache_position >= 0) {
+				if (cache_position < 3) {
+					//直前の三角形の頂点は、どの順で使っても同じなので固定値
+					score = LAST_TRIANGLE_SCORE;
+				}
+				else {
+					float scaler = 1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+					score = std::pow(scaler, CACHE_DECAY_POWER);
+				}
+			}
+			score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		//インデックスが三角形リストとして正しいかどうか
+		bool IsValidTriangleList(const std::vector<unsigned int>& indices, size_t vertex_count) {
+			if (indices.size() % 3 != 0)
+				return false;
+			for (unsigned int index : indices) {
+				if (index >= vertex_count)
+					return false;
+			}
+			return true;
+		}
+	}
+
+	MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size)
+	{
+		VertexCacheStats stats = {};
+		if (indices.empty() || vertex_count == 0 || cache_size == 0 || !IsValidTriangleList(indices, vertex_count))
+			return stats;
+
+		//FIFOキャッシュ
+		//頂点毎に「キャッシュに入った時刻」を持っておけば、今の時刻との差でキャッシュに残っているか判定できる
+		std::vector<unsigned int> cache_timestamps(vertex_count, 0);
+		unsigned int timestamp = cache_size + 1;
+		for (unsigned int index : indices) {
+			if (timestamp - cache_timestamps[index] > cache_size) {
+				cache_timestamps[index] = timestamp++;
+				stats.vertices_transformed++;
+			}
+		}
+		stats.acmr = static_cast<float>(stats.vertices_transformed) / static_cast<float>(indices.size() / 3);
+		stats.atvr = static_cast<float>(stats.vertices_transformed) / static_cast<float>(vertex_count);
+		return stats;
+	}
+
+	int MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertex_count)
+	{
+		if (!IsValidTriangleList(indices, vertex_count))
+			return -1;
+		size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0)
+			return 0;
+
+		//頂点→三角形の隣接リスト(CSR形式)
+		std::vector<unsigned int> remaining_triangles(vertex_count, 0);
+		for (unsigned int index : indices)
+			remaining_triangles[index]++;
+		std::vector<unsigned int> adjacency_offsets(vertex_count + 1, 0);
+		for (size_t v = 0; v < vertex_count; v++)
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining_triangles[v];
+		std::vector<unsigned int> adjacency(indices.size());
+		{
+			std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (size_t t = 0; t < triangle_count; t++) {
+				for (int k = 0; k < 3; k++)
+					adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+			}
+		}
+
+		std::vector<int> cache_position(vertex_count, -1);
+		std::vector<float> vertex_scores(vertex_count);
+		for (size_t v = 0; v < vertex_count; v++)
+			vertex_scores[v] = VertexScore(-1, remaining_triangles[v]);
+
+		std::vector<float> triangle_scores(triangle_count);
+		std::vector<bool> emitted(triangle_count, false);
+		int best_triangle = -1;
+		float best_score = -1.0f;
+		for (size_t t = 0; t < triangle_count; t++) {
+			triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+			if (triangle_scores[t] > best_score) {
+				best_score = triangle_scores[t];
+				best_triangle = static_cast<int>(t);
+			}
+		}
+
+		std::vector<unsigned int> output;
+		output.reserve(indices.size());
+		std::vector<unsigned int> cache;
+		std::vector<unsigned int> next_cache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		size_t search_cursor = 0;
+
+		for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+			if (best_triangle < 0) {
+				//キャッシュ内の頂点に繋がる三角形が無くなったら、未出力の三角形を先頭から探す
+				while (emitted[search_cursor])
+					search_cursor++;
+				best_triangle = static_cast<int>(search_cursor);
+			}
+			const unsigned int* tri = &indices[best_triangle * 3];
+			output.insert(output.end(), tri, tri + 3);
+			emitted[best_triangle] = true;
+
+			//出力した三角形を、各頂点の隣接リストから外す
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = tri[k];
+				unsigned int begin = adjacency_offsets[v];
+				unsigned int end = begin + remaining_triangles[v];
+				for (unsigned int a = begin; a < end; a++) {
+					if (adjacency[a] == static_cast<unsigned int>(best_triangle)) {
+						std::swap(adjacency[a], adjacency[end - 1]);
+						break;
+					}
+				}
+				remaining_triangles[v]--;
+			}
+
+			//LRUキャッシュの更新。今の三角形の頂点を先頭に入れる
+			next_cache.clear();
+			next_cache.insert(next_cache.end(), tri, tri + 3);
+			for (unsigned int v : cache) {
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					next_cache.push_back(v);
+			}
+			//溢れた頂点はキャッシュ外としてスコアを付け直す
+			for (size_t i = FORSYTH_CACHE_SIZE; i < next_cache.size(); i++) {
+				unsigned int v = next_cache[i];
+				cache_position[v] = -1;
+				vertex_scores[v] = VertexScore(-1, remaining_triangles[v]);
+			}
+			if (next_cache.size() > FORSYTH_CACHE_SIZE) {
+				//溢れた頂点に繋がる三角形のスコアも更新する
+				for (size_t i = FORSYTH_CACHE_SIZE; i < next_cache.size(); i++) {
+					unsigned int v = next_cache[i];
+					for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v] + remaining_triangles[v]; a++) {
+						unsigned int t = adjacency[a];
+						triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+					}
+				}
+				next_cache.resize(FORSYTH_CACHE_SIZE);
+			}
+			cache.swap(next_cache);
+
+			//キャッシュ内の頂点のスコアを更新して、次に出力する三角形を決める
+			for (size_t i = 0; i < cache.size(); i++) {
+				unsigned int v = cache[i];
+				cache_position[v] = static_cast<int>(i);
+				vertex_scores[v] = VertexScore(static_cast<int>(i), remaining_triangles[v]);
+			}
+			best_triangle = -1;
+			best_score = -1.0f;
+			for (unsigned int v : cache) {
+				for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v] + remaining_triangles[v]; a++) {
+					unsigned int t = adjacency[a];
+					float score = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+					triangle_scores[t] = score;
+					if (score > best_score) {
+						best_score = score;
+						best_triangle = static_cast<int>(t);
+					}
+				}
+			}
+		}
+		indices.swap(output);
+		return 0;
+	}
+
+	int MeshOptimizer::OptimizeOverdraw(MeshInfo& mesh, float threshold)
+	{
+		size_t vertex_count = mesh.GetVertexCount();
+		std::vector<unsigned int>& indices = mesh.indices;
+		if (!IsValidTriangleList(indices, vertex_count))
+			return -1;
+		size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0)
+			return 0;
+
+		//クラスタに分ける
+		//3頂点ともキャッシュミスする三角形は、直前の三角形と頂点を共有していないので、そこで切っても頂点キャッシュの効率は落ちない
+		std::vector<unsigned int> cluster_starts;
+		{
+			std::vector<unsigned int> cache_timestamps(vertex_count, 0);
+			unsigned int timestamp = DEFAULT_CACHE_SIZE + 1;
+			for (size_t t = 0; t < triangle_count; t++) {
+				int misses = 0;
+				for (int k = 0; k < 3; k++) {
+					unsigned int v = indices[t * 3 + k];
+					if (timestamp - cache_timestamps[v] > DEFAULT_CACHE_SIZE) {
+						cache_timestamps[v] = timestamp++;
+						misses++;
+					}
+				}
+				if (t == 0 || misses == 3)
+					cluster_starts.push_back(static_cast<unsigned int>(t));
+			}
+		}
+		size_t cluster_count = cluster_starts.size();
+		if (cluster_count <= 1)
+			return 0;
+		cluster_starts.push_back(static_cast<unsigned int>(triangle_count));
+
+		//クラスタ毎の重心と向き
+		//向きは頂点法線の平均で取る(面の巻き順に依存させないため)
+		struct Cluster {
+			float centroid[3] = {};
+			float normal[3] = {};
+			float sort_key = 0.0f;
+			unsigned int index = 0;
+		};
+		std::vector<Cluster> clusters(cluster_count);
+		float mesh_centroid[3] = {};
+		for (size_t c = 0; c < cluster_count; c++) {
+			Cluster& cluster = clusters[c];
+			cluster.index = static_cast<unsigned int>(c);
+			unsigned int cluster_vertices = 0;
+			for (unsigned int t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+				for (int k = 0; k < 3; k++) {
+					const float* src = &mesh.vertices[indices[t * 3 + k] * MeshInfo::SOURCE_STRIDE];
+					for (int axis = 0; axis < 3; axis++) {
+						cluster.centroid[axis] += src[MeshInfo::POSITION_OFFSET + axis];
+						cluster.normal[axis] += src[MeshInfo::NORMAL_OFFSET + axis];
+					}
+					cluster_vertices++;
+				}
+			}
+			for (int axis = 0; axis < 3; axis++) {
+				cluster.centroid[axis] /= static_cast<float>(cluster_vertices);
+				mesh_centroid[axis] += cluster.centroid[axis] * static_cast<float>(cluster_vertices);
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+			mesh_centroid[axis] /= static_cast<float>(indices.size());
+
+		//メッシュの中心から見て外側を向いているクラスタ程、手前に来やすい(=先に描けば後ろが深度テストで弾かれる)
+		for (Cluster& cluster : clusters) {
+			float length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+			if (length <= 0.0f)
+				continue;
+			for (int axis = 0; axis < 3; axis++)
+				cluster.sort_key += (cluster.centroid[axis] - mesh_centroid[axis]) * (cluster.normal[axis] / length);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+		std::vector<unsigned int> sorted;
+		sorted.reserve(indices.size());
+		for (const Cluster& cluster : clusters) {
+			sorted.insert(sorted.end(), indices.begin() + cluster_starts[cluster.index] * 3, indices.begin() + cluster_starts[cluster.index + 1] * 3);
+		}
+
+		//並べ替えで頂点キャッシュの効率が落ちすぎるなら、元の並びのままにする
+		float acmr_before = AnalyzeVertexCache(indices, vertex_count).acmr;
+		float acmr_after = AnalyzeVertexCache(sorted, vertex_count).acmr;
+		if (acmr_after > acmr_before * threshold)
+			return 0;
+		indices.swap(sorted);
+		return 0;
+	}
+
+	int MeshOptimizer::OptimizeVertexFetch(MeshInfo& mesh)
+	{
+		size_t vertex_count = mesh.GetVertexCount();
+		if (!IsValidTriangleList(mesh.indices, vertex_count))
+			return -1;
+
+		//初めて参照された順に新しい番号を振る
+		constexpr unsigned int unused = std::numeric_limits<unsigned int>::max();
+		std::vector<unsigned int> remap(vertex_count, unused);
+		unsigned int next_vertex = 0;
+		for (unsigned int& index : mesh.indices) {
+			if (remap[index] == unused)
+				remap[index] = next_vertex++;
+			index = remap[index];
+		}
+
+		std::vector<float> vertices(static_cast<size_t>(next_vertex) * MeshInfo::SOURCE_STRIDE);
+		for (size_t v = 0; v < vertex_count; v++) {
+			if (remap[v] == unused)
+				continue;
+			std::copy_n(&mesh.vertices[v * MeshInfo::SOURCE_STRIDE], MeshInfo::SOURCE_STRIDE, &vertices[remap[v] * MeshInfo::SOURCE_STRIDE]);
+		}
+		mesh.vertices.swap(vertices);
+		return 0;
+	}
+
+	int MeshOptimizer::Optimize(MeshInfo& mesh, VertexCacheStats* out_before, VertexCacheStats* out_after)
+	{
+		if (out_before)
+			*out_before = AnalyzeVertexCache(mesh.indices, mesh.GetVertexCount());
+		if (OptimizeVertexCache(mesh.indices, mesh.GetVertexCount()) != 0)
+			return -1;
+		if (OptimizeOverdraw(mesh) != 0)
+			return -1;
+		if (OptimizeVertexFetch(mesh) != 0)
+			return -1;
+		if (out_after)
+			*out_after = AnalyzeVertexCache(mesh.indices, mesh.GetVertexCount());
+		return 0;
+	}
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+namespace System {
+	struct MeshInfo;
+
+	//-------------------------------------------------------------
+	// @brief インポートしたメッシュを、GPUが処理しやすい並びに組み替えるクラス
+	// @brief CPUだけで完結するので、インポート時(もしくはオフライン)に一度だけ通す
+	// @details 同じメッシュを5000体インスタンス描画しているので、頂点キャッシュの取りこぼしも5000倍になる。
+	//			以下の3段階で並びを整える
+	//			・頂点キャッシュ最適化 : Forsythのスコア方式で、直前に使った頂点を再利用する三角形を優先して並べる
+	//			・オーバードロー最適化 : キャッシュの切れ目でクラスタに分け、外側を向いたクラスタから描くように並べ替える
+	//			・頂点フェッチ最適化 : インデックスで初めて参照された順に頂点を詰め直す
+	//-------------------------------------------------------------
+	class MeshOptimizer
+	{
+	public:
+		//頂点キャッシュの解析結果
+		struct VertexCacheStats {
+			unsigned int vertices_transformed = 0;	// キャッシュミスで変換された頂点数
+			float acmr = 0.0f;						// 三角形あたりの頂点変換数(0.5~3.0, 小さい程良い)
+			float atvr = 0.0f;						// 頂点あたりの頂点変換数(1.0が理想)
+		};
+		//解析に使うFIFOキャッシュのサイズ(最近のGPUはおおよそ16~32程度)
+		static constexpr unsigned int DEFAULT_CACHE_SIZE = 16;
+		//オーバードロー最適化で、ACMRの悪化をどこまで許すか
+		static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+		//-------------------------------------------------------------
+		// @brief FIFOキャッシュをシミュレートして、ACMRとATVRを求める
+		//
+		// @param [in] indices 三角形リストのインデックス
+		// @param [in] vertex_count 頂点数
+		// @param [in] cache_size キャッシュのサイズ
+		// @return 解析結果
+		//-------------------------------------------------------------
+		static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertex_count, unsigned int cache_size = DEFAULT_CACHE_SIZE);
+
+		//-------------------------------------------------------------
+		// @brief 頂点キャッシュのヒット率が上がるように三角形を並べ替える
+		//
+		// @param [in,out] indices 三角形リストのインデックス
+		// @param [in] vertex_count 頂点数
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertex_count);
+
+		//-------------------------------------------------------------
+		// @brief 外側を向いたクラスタから描くように並べ替え、オーバードローを減らす
+		// @details OptimizeVertexCacheの後に呼ぶこと。
+		//			並べ替えでACMRがthreshold倍より悪くなる場合は、元の並びに戻す
+		//
+		// @param [in,out] mesh 対象のメッシュ(indicesのみ書き換える)
+		// @param [in] threshold ACMRの悪化の許容倍率
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int OptimizeOverdraw(MeshInfo& mesh, float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+		//-------------------------------------------------------------
+		// @brief インデックスで参照される順に頂点を詰め直す。参照されない頂点は削除する
+		//
+		// @param [in,out] mesh 対象のメッシュ(verticesとindicesを書き換える)
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int OptimizeVertexFetch(MeshInfo& mesh);
+
+		//-------------------------------------------------------------
+		// @brief 上記3つを順に通す
+		//
+		// @param [in,out] mesh 対象のメッシュ
+		// @param [out] out_before 最適化前の解析結果(不要ならnullptr)
+		// @param [out] out_after 最適化後の解析結果(不要ならnullptr)
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int Optimize(MeshInfo& mesh, VertexCacheStats* out_before = nullptr, VertexCacheStats* out_after = nullptr);
+	};
+}
@@ -0,0 +1,290 @@
+﻿#include "MeshSimplifier.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/Mesh/MeshOptimizer/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace System {
+
+	namespace {
+		struct Vector3 {
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+		};
+		Vector3 Sub(const Vector3& a, const Vector3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		Vector3 Cross(const Vector3& a, const Vector3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		float Dot(const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+		//平面からの距離の二乗を表す二次形式(対称4x4行列の10要素)
+		//精度が足りないと潰す順番がおかしくなるので、doubleで持つ
+		struct Quadric {
+			double a00 = 0.0, a11 = 0.0, a22 = 0.0;
+			double a01 = 0.0, a02 = 0.0, a12 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+			double weight = 0.0;
+
+			//平面 n・p + d = 0 を、weightの重みで加える
+			void AddPlane(const Vector3& n, float d, float w) {
+				a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+				a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+				b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+				c += w * d * d;
+				weight += w;
+			}
+			void Add(const Quadric& q) {
+				a00 += q.a00; a11 += q.a11; a22 += q.a22;
+				a01 += q.a01; a02 += q.a02; a12 += q.a12;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2;
+				c += q.c;
+				weight += q.weight;
+			}
+			//pに置いた時の、平面からの距離の二乗の加重平均
+			float Error(const Vector3& p) const {
+				double x = p.x, y = p.y, z = p.z;
+				double r = a00 * x * x + a11 * y * y + a22 * z * z
+					+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+					+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				if (weight > 0.0)
+					r /= weight;
+				return static_cast<float>(std::abs(r));
+			}
+		};
+
+		struct Collapse {
+			unsigned int from = 0;
+			unsigned int to = 0;
+			float error = 0.0f;
+		};
+
+		//縮約で三角形が裏返ったり潰れたりしないか
+		bool FlipsTriangle(const std::vector<Vector3>& positions, const unsigned int* tri, unsigned int from, unsigned int to) {
+			Vector3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+			Vector3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+			for (int k = 0; k < 3; k++) {
+				if (tri[k] == from)
+					p[k] = positions[to];
+			}
+			Vector3 after = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+			//向きが大きく(75度程度以上)変わるものは裏返りとみなす
+			float len = std::sqrt(Dot(before, before) * Dot(after, after));
+			return Dot(before, after) <= 0.25f * len;
+		}
+	}
+
+	int MeshSimplifier::Simplify(const MeshInfo& mesh, const std::vector<unsigned int>& indices, size_t target_index_count, float target_error, std::vector<unsigned int>& out_indices, float* out_error)
+	{
+		size_t vertex_count = mesh.GetVertexCount();
+		if (indices.size() % 3 != 0)
+			return -1;
+		for (unsigned int index : indices) {
+			if (index >= vertex_count)
+				return -1;
+		}
+		out_indices = indices;
+		if (out_error)
+			*out_error = 0.0f;
+		if (indices.size() <= target_index_count || vertex_count == 0)
+			return 0;
+
+		//誤差をメッシュの大きさに対する比率で扱えるように、位置を0~1に正規化する
+		float bb_min[3] = { mesh.GetPosition(0)[0], mesh.GetPosition(0)[1], mesh.GetPosition(0)[2] };
+		float bb_max[3] = { bb_min[0], bb_min[1], bb_min[2] };
+		for (size_t i = 1; i < vertex_count; i++) {
+			const float* pos = mesh.GetPosition(i);
+			for (int axis = 0; axis < 3; axis++) {
+				bb_min[axis] = std::min(bb_min[axis], pos[axis]);
+				bb_max[axis] = std::max(bb_max[axis], pos[axis]);
+			}
+		}
+		float extent = std::max({ bb_max[0] - bb_min[0], bb_max[1] - bb_min[1], bb_max[2] - bb_min[2] });
+		float inv_extent = extent > 0.0f ? 1.0f / extent : 1.0f;
+		std::vector<Vector3> positions(vertex_count);
+		for (size_t i = 0; i < vertex_count; i++) {
+			const float* pos = mesh.GetPosition(i);
+			positions[i] = { (pos[0] - bb_min[0]) * inv_extent, (pos[1] - bb_min[1]) * inv_extent, (pos[2] - bb_min[2]) * inv_extent };
+		}
+
+		std::vector<unsigned int>& work = out_indices;
+
+		//各頂点のQuadric(周囲の三角形の平面を面積で重み付けして足し合わせる)
+		std::vector<Quadric> quadrics(vertex_count);
+		for (size_t t = 0; t < work.size(); t += 3) {
+			const Vector3& p0 = positions[work[t]];
+			Vector3 n = Cross(Sub(positions[work[t + 1]], p0), Sub(positions[work[t + 2]], p0));
+			float area = std::sqrt(Dot(n, n));
+			if (area <= 0.0f)
+				continue;
+			n = { n.x / area, n.y / area, n.z / area };
+			float d = -Dot(n, p0);
+			for (int k = 0; k < 3; k++)
+				quadrics[work[t + k]].AddPlane(n, d, area * 0.5f);
+		}
+
+		//境界の頂点は動かさない
+		//逆向きの辺を持つ三角形が無い辺が境界。UVや法線の継ぎ目で頂点が分かれている所もここに含まれる
+		std::vector<bool> locked(vertex_count, false);
+		{
+			std::unordered_set<unsigned long long> edges;
+			edges.reserve(work.size());
+			auto edge_key = [](unsigned int a, unsigned int b) { return (static_cast<unsigned long long>(a) << 32) | b; };
+			for (size_t t = 0; t < work.size(); t += 3) {
+				for (int k = 0; k < 3; k++)
+					edges.insert(edge_key(work[t + k], work[t + (k + 1) % 3]));
+			}
+			for (size_t t = 0; t < work.size(); t += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = work[t + k];
+					unsigned int b = work[t + (k + 1) % 3];
+					if (edges.find(edge_key(b, a)) == edges.end()) {
+						locked[a] = true;
+						locked[b] = true;
+					}
+				}
+			}
+		}
+
+		float error_limit = target_error * target_error;
+		float max_error = 0.0f;
+		std::vector<unsigned int> remap(vertex_count);
+		std::vector<bool> touched(vertex_count);
+		std::vector<unsigned int> adjacency_offsets(vertex_count + 1);
+		std::vector<unsigned int> adjacency;
+		std::vector<Collapse> collapses;
+
+		//1パスで互いに干渉しない辺をまとめて縮約し、三角形が目標数まで減るか、縮約できる辺が無くなるまで繰り返す
+		while (work.size() > target_index_count) {
+			//頂点→三角形の隣接リスト
+			std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+			for (unsigned int index : work)
+				adjacency_offsets[index + 1]++;
+			for (size_t v = 0; v < vertex_count; v++)
+				adjacency_offsets[v + 1] += adjacency_offsets[v];
+			adjacency.resize(work.size());
+			{
+				std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+				for (size_t i = 0; i < work.size(); i++)
+					adjacency[fill[work[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+
+			//縮約の候補。辺毎に、誤差が小さくなる方向へ潰す
+			collapses.clear();
+			for (size_t t = 0; t < work.size(); t += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = work[t + k];
+					unsigned int b = work[t + (k + 1) % 3];
+					//同じ辺は隣の三角形からも出てくるので、片側だけ見る
+					if (a > b)
+						continue;
+					if (locked[a] && locked[b])
+						continue;
+					Quadric q = quadrics[a];
+					q.Add(quadrics[b]);
+					float error_ab = locked[a] ? std::numeric_limits<float>::max() : q.Error(positions[b]);
+					float error_ba = locked[b] ? std::numeric_limits<float>::max() : q.Error(positions[a]);
+					if (error_ab <= error_ba)
+						collapses.push_back({ a, b, error_ab });
+					else
+						collapses.push_back({ b, a, error_ba });
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.error < r.error; });
+
+			for (size_t v = 0; v < vertex_count; v++)
+				remap[v] = static_cast<unsigned int>(v);
+			std::fill(touched.begin(), touched.end(), false);
+			size_t triangles_to_remove = (work.size() - target_index_count) / 3;
+			size_t triangles_removed = 0;
+			size_t collapse_count = 0;
+			for (const Collapse& collapse : collapses) {
+				if (collapse.error > error_limit || triangles_removed >= triangles_to_remove)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				bool flipped = false;
+				unsigned int removed = 0;
+				for (unsigned int a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; a++) {
+					const unsigned int* tri = &work[adjacency[a] * 3];
+					if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+						removed++;
+						continue;
+					}
+					if (FlipsTriangle(positions, tri, collapse.from, collapse.to)) {
+						flipped = true;
+						break;
+					}
+				}
+				if (flipped)
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				max_error = std::max(max_error, collapse.error);
+				triangles_removed += removed;
+				collapse_count++;
+				//周囲の三角形の形が変わるので、このパスでは周りの頂点にもう触らない
+				for (unsigned int a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; a++) {
+					const unsigned int* tri = &work[adjacency[a] * 3];
+					touched[tri[0]] = true;
+					touched[tri[1]] = true;
+					touched[tri[2]] = true;
+				}
+			}
+			if (collapse_count == 0)
+				break;
+
+			//縮約を反映して、潰れた三角形を取り除く
+			size_t write = 0;
+			for (size_t t = 0; t < work.size(); t += 3) {
+				unsigned int a = remap[work[t]];
+				unsigned int b = remap[work[t + 1]];
+				unsigned int c = remap[work[t + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				work[write++] = a;
+				work[write++] = b;
+				work[write++] = c;
+			}
+			work.resize(write);
+		}
+
+		if (out_error)
+			*out_error = std::sqrt(max_error);
+		return 0;
+	}
+
+	int MeshSimplifier::BuildLodChain(MeshInfo& mesh, const std::vector<LodSetting>& settings)
+	{
+		if (!mesh.lods.empty())
+			return -1;
+		std::vector<unsigned int> base = mesh.indices;
+		mesh.lods.push_back({ 0, static_cast<unsigned int>(base.size()), 0.0f });
+
+		size_t previous_count = base.size();
+		float previous_error = 0.0f;
+		std::vector<unsigned int> lod_indices;
+		for (const LodSetting& setting : settings) {
+			//毎回LOD0から簡略化する(前のLODから作ると誤差が積み重なる)
+			size_t target_index_count = static_cast<size_t>(static_cast<float>(base.size() / 3) * setting.index_ratio) * 3;
+			float lod_error = 0.0f;
+			if (Simplify(mesh, base, target_index_count, setting.target_error, lod_indices, &lod_error) != 0)
+				return -1;
+			//前のLODから5%も減らないなら、誤差の上限に当たっているのでここで打ち切る
+			if (lod_indices.empty() || lod_indices.size() * 20 >= previous_count * 19)
+				break;
+			if (MeshOptimizer::OptimizeVertexCache(lod_indices, mesh.GetVertexCount()) != 0)
+				return -1;
+
+			//誤差はLODが粗くなる程大きくなるようにしておく(SelectLodが先頭から順に見るため)
+			previous_error = std::max(previous_error, lod_error);
+			mesh.lods.push_back({ static_cast<unsigned int>(mesh.indices.size()), static_cast<unsigned int>(lod_indices.size()), previous_error });
+			mesh.indices.insert(mesh.indices.end(), lod_indices.begin(), lod_indices.end());
+			previous_count = lod_indices.size();
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+namespace System {
+	struct MeshInfo;
+
+	//-------------------------------------------------------------
+	// @brief QEM(二次誤差尺度)による辺の縮約で、メッシュを簡略化するクラス
+	// @brief 簡略化したインデックスを元のメッシュに追記して、LODチェーンを作る
+	// @details 頂点は元のメッシュのものをそのまま使い、インデックスだけを作り直す。
+	//			なので全LODで頂点バッファを共有でき、LODの切り替えはインデックスの範囲を変えるだけで済む。
+	//			・各頂点に、周囲の三角形の平面からの距離の二乗和(Quadric)を持たせる
+	//			・辺を縮約した時のQuadricの値が小さい順に潰していく
+	//			・境界(UVの継ぎ目も含む)の頂点は動かさないので、穴は開かない
+	//			・誤差はメッシュの大きさ(AABBの最大辺)に対する比率で表す
+	//-------------------------------------------------------------
+	class MeshSimplifier
+	{
+	public:
+		//LOD1段分の設定
+		struct LodSetting {
+			float index_ratio = 0.5f;		// 元のメッシュに対するインデックス数の目標比率
+			float target_error = 0.01f;		// 許容する誤差(メッシュの大きさに対する比率)
+		};
+
+		//-------------------------------------------------------------
+		// @brief インデックスを簡略化する
+		// @details target_index_countに達するか、次の縮約がtarget_errorを超えたら止まる
+		//
+		// @param [in] mesh 頂点を参照するメッシュ
+		// @param [in] indices 簡略化する三角形リスト
+		// @param [in] target_index_count 目標のインデックス数
+		// @param [in] target_error 許容する誤差(メッシュの大きさに対する比率)
+		// @param [out] out_indices 簡略化後の三角形リスト
+		// @param [out] out_error 実際に生じた誤差(不要ならnullptr)
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int Simplify(const MeshInfo& mesh, const std::vector<unsigned int>& indices, size_t target_index_count, float target_error, std::vector<unsigned int>& out_indices, float* out_error = nullptr);
+
+		//-------------------------------------------------------------
+		// @brief LODチェーンを作る
+		// @details mesh.indicesをLOD0として、設定毎に簡略化したインデックスをmesh.indicesの後ろに追記し、mesh.lodsに範囲を記録する。
+		//			前のLODから殆ど減らなくなった(誤差の上限に当たった)時点で打ち切る。
+		//			MeshOptimizer::Optimizeの後に呼ぶこと
+		//
+		// @param [in,out] mesh 対象のメッシュ
+		// @param [in] settings 各LODの設定(粗い方に向かって並べる)
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int BuildLodChain(MeshInfo& mesh, const std::vector<LodSetting>& settings);
+	};
+}
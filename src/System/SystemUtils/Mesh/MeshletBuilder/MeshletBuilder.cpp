@@ -0,0 +1,138 @@
+﻿#include "MeshletBuilder.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace System {
+
+	namespace {
+		//メッシュレットのバウンディングスフィアと法線コーンを求める
+		void ComputeMeshletBounds(const MeshInfo& mesh, Meshlet& meshlet)
+		{
+			const unsigned int* vertices = &mesh.meshlet_vertices[meshlet.vertex_offset];
+			const unsigned char* triangles = &mesh.meshlet_triangles[meshlet.triangle_offset * 3];
+
+			//バウンディングスフィア(AABBの中心と、そこから一番遠い頂点までの距離)
+			const float* first = mesh.GetPosition(vertices[0]);
+			float bb_min[3] = { first[0], first[1], first[2] };
+			float bb_max[3] = { first[0], first[1], first[2] };
+			for (unsigned int i = 1; i < meshlet.vertex_count; i++) {
+				const float* pos = mesh.GetPosition(vertices[i]);
+				for (int axis = 0; axis < 3; axis++) {
+					bb_min[axis] = std::min(bb_min[axis], pos[axis]);
+					bb_max[axis] = std::max(bb_max[axis], pos[axis]);
+				}
+			}
+			float center[3] = { (bb_min[0] + bb_max[0]) * 0.5f, (bb_min[1] + bb_max[1]) * 0.5f, (bb_min[2] + bb_max[2]) * 0.5f };
+			float radius_sq = 0.0f;
+			for (unsigned int i = 0; i < meshlet.vertex_count; i++) {
+				const float* pos = mesh.GetPosition(vertices[i]);
+				float dx = pos[0] - center[0];
+				float dy = pos[1] - center[1];
+				float dz = pos[2] - center[2];
+				radius_sq = std::max(radius_sq, dx * dx + dy * dy + dz * dz);
+			}
+			meshlet.bounding_sphere = DirectX::XMFLOAT4(center[0], center[1], center[2], std::sqrt(radius_sq));
+
+			//法線コーン
+			//軸は三角形の法線の平均、広がりは軸と一番離れた法線との角度で決める
+			std::vector<DirectX::XMFLOAT3> normals;
+			normals.reserve(meshlet.triangle_count);
+			float axis[3] = {};
+			for (unsigned int t = 0; t < meshlet.triangle_count; t++) {
+				const float* p0 = mesh.GetPosition(vertices[triangles[t * 3 + 0]]);
+				const float* p1 = mesh.GetPosition(vertices[triangles[t * 3 + 1]]);
+				const float* p2 = mesh.GetPosition(vertices[triangles[t * 3 + 2]]);
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length <= 0.0f)
+					continue;
+				DirectX::XMFLOAT3 normal(n[0] / length, n[1] / length, n[2] / length);
+				normals.push_back(normal);
+				axis[0] += normal.x;
+				axis[1] += normal.y;
+				axis[2] += normal.z;
+			}
+			meshlet.cone_axis = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+			meshlet.cone_cutoff = 1.0f;
+			float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			if (normals.empty() || axis_length <= 0.0f)
+				return;
+			DirectX::XMFLOAT3 cone_axis(axis[0] / axis_length, axis[1] / axis_length, axis[2] / axis_length);
+			float min_dot = 1.0f;
+			for (const DirectX::XMFLOAT3& normal : normals)
+				min_dot = std::min(min_dot, normal.x * cone_axis.x + normal.y * cone_axis.y + normal.z * cone_axis.z);
+			meshlet.cone_axis = cone_axis;
+			//広がりが大きい(84度以上)と背面カリングで殆ど弾けないので、無効にしておく
+			if (min_dot <= 0.1f)
+				return;
+			meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+		}
+	}
+
+	int MeshletBuilder::Build(MeshInfo& mesh, unsigned int max_vertices, unsigned int max_triangles)
+	{
+		//ローカル番号は1バイトで持つので、256頂点を超えるメッシュレットは作れない
+		if (max_vertices < 3 || max_vertices > 256 || max_triangles == 0)
+			return -1;
+		size_t vertex_count = mesh.GetVertexCount();
+		MeshLod lod = mesh.GetLod(0);
+		if (lod.index_count % 3 != 0 || static_cast<size_t>(lod.index_offset) + lod.index_count > mesh.indices.size())
+			return -1;
+		const unsigned int* indices = mesh.indices.data() + lod.index_offset;
+		for (unsigned int i = 0; i < lod.index_count; i++) {
+			if (indices[i] >= vertex_count)
+				return -1;
+		}
+
+		mesh.meshlets.clear();
+		mesh.meshlet_vertices.clear();
+		mesh.meshlet_triangles.clear();
+		mesh.meshlet_triangles.reserve(lod.index_count);
+
+		//現在のメッシュレット内でのローカル番号(未使用は-1)
+		std::vector<int> local_index(vertex_count, -1);
+		Meshlet meshlet;
+		auto flush = [&]() {
+			if (meshlet.triangle_count == 0)
+				return;
+			for (unsigned int i = 0; i < meshlet.vertex_count; i++)
+				local_index[mesh.meshlet_vertices[meshlet.vertex_offset + i]] = -1;
+			mesh.meshlets.push_back(meshlet);
+			Meshlet next;
+			next.vertex_offset = static_cast<unsigned int>(mesh.meshlet_vertices.size());
+			next.triangle_offset = meshlet.triangle_offset + meshlet.triangle_count;
+			meshlet = next;
+		};
+
+		unsigned int triangle_count = lod.index_count / 3;
+		for (unsigned int t = 0; t < triangle_count; t++) {
+			const unsigned int* tri = &indices[t * 3];
+			unsigned int new_vertices = 0;
+			for (int k = 0; k < 3; k++) {
+				bool duplicated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+				if (local_index[tri[k]] < 0 && !duplicated)
+					new_vertices++;
+			}
+			if (meshlet.vertex_count + new_vertices > max_vertices || meshlet.triangle_count + 1 > max_triangles)
+				flush();
+
+			for (int k = 0; k < 3; k++) {
+				if (local_index[tri[k]] < 0) {
+					local_index[tri[k]] = static_cast<int>(meshlet.vertex_count++);
+					mesh.meshlet_vertices.push_back(tri[k]);
+				}
+				mesh.meshlet_triangles.push_back(static_cast<unsigned char>(local_index[tri[k]]));
+			}
+			meshlet.triangle_count++;
+		}
+		flush();
+
+		for (Meshlet& m : mesh.meshlets)
+			ComputeMeshletBounds(mesh, m);
+		return 0;
+	}
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+namespace System {
+	struct MeshInfo;
+
+	//-------------------------------------------------------------
+	// @brief メッシュをメッシュレットに分割するクラス
+	// @details LOD0の三角形を先頭から順に見て、頂点数か三角形数の上限に達したら次のメッシュレットに移る。
+	//			MeshOptimizerで頂点キャッシュ順に並べ替えた後なら、隣接した三角形が並んでいるので
+	//			この単純な区切り方でもまとまりの良いメッシュレットになる。
+	//			入力が同じなら結果も必ず同じになる(乱数やハッシュの順序に依存しない)。
+	//			各メッシュレットには、カリング用のバウンディングスフィアと法線コーンをインポート時に計算しておく
+	//-------------------------------------------------------------
+	class MeshletBuilder
+	{
+	public:
+		//メッシュシェーダーの出力上限(頂点256, プリミティブ256)に収まり、
+		//かつ1スレッドグループ(64~128スレッド)で処理しやすいサイズ
+		static constexpr unsigned int DEFAULT_MAX_VERTICES = 64;
+		static constexpr unsigned int DEFAULT_MAX_TRIANGLES = 124;
+
+		//-------------------------------------------------------------
+		// @brief メッシュレットを作って、mesh.meshlets, meshlet_vertices, meshlet_trianglesに格納する
+		//
+		// @param [in,out] mesh 対象のメッシュ
+		// @param [in] max_vertices 1メッシュレットあたりの最大頂点数(256以下)
+		// @param [in] max_triangles 1メッシュレットあたりの最大三角形数
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		static int Build(MeshInfo& mesh, unsigned int max_vertices = DEFAULT_MAX_VERTICES, unsigned int max_triangles = DEFAULT_MAX_TRIANGLES);
+	};
+}
@@ -0,0 +1,199 @@
+﻿#include "VertexFormat.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+namespace System {
+
+	namespace {
+		//八面体エンコード
+		//法線を|x|+|y|+|z|=1の八面体に投影してから、下半分を上半分に折り返して2成分に潰す
+		//単位球を均等に近い密度で表現できるので、16bitもあれば見た目の差は分からない
+		void EncodeOctahedral(float x, float y, float z, float& out_x, float& out_y) {
+			float len = std::abs(x) + std::abs(y) + std::abs(z);
+			if (len <= 0.0f) {
+				out_x = 0.0f;
+				out_y = 0.0f;
+				return;
+			}
+			x /= len;
+			y /= len;
+			z /= len;
+			if (z < 0.0f) {
+				float fold_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				float fold_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = fold_x;
+				y = fold_y;
+			}
+			out_x = x;
+			out_y = y;
+		}
+
+		short ToSNorm16(float v) {
+			v = std::clamp(v, -1.0f, 1.0f);
+			return static_cast<short>(std::lround(v * 32767.0f));
+		}
+		unsigned short ToUNorm16(float v) {
+			v = std::clamp(v, 0.0f, 1.0f);
+			return static_cast<unsigned short>(std::lround(v * 65535.0f));
+		}
+		unsigned char ToUNorm8(float v) {
+			v = std::clamp(v, 0.0f, 1.0f);
+			return static_cast<unsigned char>(std::lround(v * 255.0f));
+		}
+
+		template <class T>
+		void Write(unsigned char*& dst, const T& value) {
+			std::memcpy(dst, &value, sizeof(T));
+			dst += sizeof(T);
+		}
+	}
+
+	VertexFormat::VertexFormat(unsigned int flags_)
+		:flags(flags_)
+	{
+		//ColorUNorm8とColorOmitが両方立っていたら、省略を優先する
+		if (flags & ColorOmit)
+			flags &= ~ColorUNorm8;
+
+		if (flags & PositionUNorm16)
+			AddElement("POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, 8);
+		else
+			AddElement("POSITION", DXGI_FORMAT_R32G32B32_FLOAT, 12);
+
+		if (flags & ColorUNorm8)
+			AddElement("COLOR", DXGI_FORMAT_R8G8B8A8_UNORM, 4);
+		else if (!(flags & ColorOmit))
+			AddElement("COLOR", DXGI_FORMAT_R32G32B32A32_FLOAT, 16);
+
+		if (flags & TexcoordHalf)
+			AddElement("TEXCOORD", DXGI_FORMAT_R16G16_FLOAT, 4);
+		else
+			AddElement("TEXCOORD", DXGI_FORMAT_R32G32_FLOAT, 8);
+
+		if (flags & NormalOctahedral)
+			AddElement("NORMAL", DXGI_FORMAT_R16G16_SNORM, 4);
+		else
+			AddElement("NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, 12);
+
+		//シェーダー側のデコード切り替え用マクロ
+		//UNORMやFLOAT16はインプットアセンブラがfloatに戻してくれるので、
+		//シェーダーで手を入れる必要があるのは位置の逆量子化、カラーの省略、法線の展開だけ
+		if (flags & PositionUNorm16)
+			shader_defines.push_back({ "VTX_POSITION_UNORM16", "1" });
+		if (flags & ColorOmit)
+			shader_defines.push_back({ "VTX_COLOR_OMIT", "1" });
+		if (flags & NormalOctahedral)
+			shader_defines.push_back({ "VTX_NORMAL_OCTAHEDRAL", "1" });
+		shader_defines.push_back({ nullptr, nullptr });
+	}
+
+	void VertexFormat::AddElement(const char* semantic_name, DXGI_FORMAT format, unsigned int size_in_bytes)
+	{
+		D3D12_INPUT_ELEMENT_DESC element_desc = {};
+		element_desc.SemanticName = semantic_name;
+		element_desc.SemanticIndex = 0;
+		element_desc.Format = format;
+		element_desc.InputSlot = 0;
+		element_desc.AlignedByteOffset = stride;
+		element_desc.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+		element_desc.InstanceDataStepRate = 0;
+		input_element_descs.push_back(element_desc);
+		stride += size_in_bytes;
+	}
+
+	int VertexFormat::Encode(const MeshInfo& mesh, std::vector<unsigned char>& out_vertices, VertexDequant& out_dequant) const
+	{
+		size_t vertex_count = mesh.GetVertexCount();
+		if (vertex_count == 0) {
+			return -1;
+		}
+		out_dequant = {};
+
+		//位置を量子化する場合は、メッシュのAABBを求めて0~1に正規化する
+		constexpr float float_max = std::numeric_limits<float>::max();
+		float bb_min[3] = { float_max, float_max, float_max };
+		float bb_max[3] = { -float_max, -float_max, -float_max };
+		float inv_scale[3] = { 1.0f, 1.0f, 1.0f };
+		if (flags & PositionUNorm16) {
+			for (size_t i = 0; i < vertex_count; i++) {
+				const float* pos = mesh.GetPosition(i);
+				for (int axis = 0; axis < 3; axis++) {
+					bb_min[axis] = std::min(bb_min[axis], pos[axis]);
+					bb_max[axis] = std::max(bb_max[axis], pos[axis]);
+				}
+			}
+			float scale[3] = {};
+			for (int axis = 0; axis < 3; axis++) {
+				scale[axis] = bb_max[axis] - bb_min[axis];
+				//平面のメッシュなど、幅が0の軸は0除算になるので1にしておく
+				if (scale[axis] <= 0.0f)
+					scale[axis] = 1.0f;
+				inv_scale[axis] = 1.0f / scale[axis];
+			}
+			out_dequant.offset = DirectX::XMFLOAT3(bb_min[0], bb_min[1], bb_min[2]);
+			out_dequant.scale = DirectX::XMFLOAT3(scale[0], scale[1], scale[2]);
+		}
+
+		out_vertices.resize(vertex_count * stride);
+		unsigned char* dst = out_vertices.data();
+		for (size_t i = 0; i < vertex_count; i++) {
+			const float* src = &mesh.vertices[i * MeshInfo::SOURCE_STRIDE];
+			const float* pos = src + MeshInfo::POSITION_OFFSET;
+			const float* color = src + MeshInfo::COLOR_OFFSET;
+			const float* uv = src + MeshInfo::TEXCOORD_OFFSET;
+			const float* normal = src + MeshInfo::NORMAL_OFFSET;
+
+			//位置
+			if (flags & PositionUNorm16) {
+				Write(dst, ToUNorm16((pos[0] - bb_min[0]) * inv_scale[0]));
+				Write(dst, ToUNorm16((pos[1] - bb_min[1]) * inv_scale[1]));
+				Write(dst, ToUNorm16((pos[2] - bb_min[2]) * inv_scale[2]));
+				Write(dst, static_cast<unsigned short>(65535));
+			}
+			else {
+				Write(dst, pos[0]);
+				Write(dst, pos[1]);
+				Write(dst, pos[2]);
+			}
+			//カラー
+			if (flags & ColorUNorm8) {
+				Write(dst, ToUNorm8(color[0]));
+				Write(dst, ToUNorm8(color[1]));
+				Write(dst, ToUNorm8(color[2]));
+				Write(dst, ToUNorm8(color[3]));
+			}
+			else if (!(flags & ColorOmit)) {
+				Write(dst, color[0]);
+				Write(dst, color[1]);
+				Write(dst, color[2]);
+				Write(dst, color[3]);
+			}
+			//テクスチャ座標
+			if (flags & TexcoordHalf) {
+				Write(dst, DirectX::PackedVector::XMConvertFloatToHalf(uv[0]));
+				Write(dst, DirectX::PackedVector::XMConvertFloatToHalf(uv[1]));
+			}
+			else {
+				Write(dst, uv[0]);
+				Write(dst, uv[1]);
+			}
+			//法線
+			if (flags & NormalOctahedral) {
+				float oct_x = 0.0f;
+				float oct_y = 0.0f;
+				EncodeOctahedral(normal[0], normal[1], normal[2], oct_x, oct_y);
+				Write(dst, ToSNorm16(oct_x));
+				Write(dst, ToSNorm16(oct_y));
+			}
+			else {
+				Write(dst, normal[0]);
+				Write(dst, normal[1]);
+				Write(dst, normal[2]);
+			}
+		}
+		return 0;
+	}
+}
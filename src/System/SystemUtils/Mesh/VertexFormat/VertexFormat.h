@@ -0,0 +1,61 @@
+﻿#pragma once
+
+namespace System {
+	struct MeshInfo;
+	struct VertexDequant;
+
+	//-------------------------------------------------------------
+	// @brief 頂点フォーマットを組み立てるクラス
+	// @brief フラグの組み合わせから、頂点の圧縮形式・インプットレイアウト・シェーダーのデコード用マクロをまとめて生成する
+	// @details 元データは1頂点48バイト(float×12)あるが、全部floatで持つ必要はない。
+	//			・位置 : 16bit正規化整数 + メッシュ毎の逆量子化(8バイト)
+	//			・カラー : 殆どのモデルで真っ白なので省略(0バイト)
+	//			・UV : 半精度浮動小数(4バイト)
+	//			・法線 : 八面体エンコードで2成分に潰す(4バイト)
+	//			とすると16バイトになり、5000体描画する時の頂点フェッチ量が1/3になる。
+	//			インプットレイアウトとシェーダー側のデコードは同じフラグから作るので、食い違いは起きない
+	//-------------------------------------------------------------
+	class VertexFormat
+	{
+	public:
+		enum VertexFormatFlags {
+			PositionUNorm16 = 1 << 0,	// 位置をR16G16B16A16_UNORMで持つ(逆量子化が必要)
+			ColorUNorm8 = 1 << 1,		// カラーをR8G8B8A8_UNORMで持つ
+			ColorOmit = 1 << 2,			// カラーを持たない(シェーダー側では白として扱う)
+			TexcoordHalf = 1 << 3,		// UVをR16G16_FLOATで持つ
+			NormalOctahedral = 1 << 4,	// 法線を八面体エンコードしてR16G16_SNORMで持つ
+		};
+		// 元データと同じ、全てfloatのフォーマット
+		static constexpr unsigned int Full = 0;
+		// 5000体描画用の圧縮フォーマット
+		static constexpr unsigned int Compact = PositionUNorm16 | ColorOmit | TexcoordHalf | NormalOctahedral;
+
+	private:
+		unsigned int flags = Full;
+		unsigned int stride = 0;
+		std::vector<D3D12_INPUT_ELEMENT_DESC> input_element_descs;
+		std::vector<D3D_SHADER_MACRO> shader_defines;
+
+		void AddElement(const char* semantic_name, DXGI_FORMAT format, unsigned int size_in_bytes);
+	public:
+		VertexFormat(unsigned int flags_ = Full);
+
+		unsigned int GetFlags() const { return flags; }
+		// @brief 1頂点あたりのバイト数
+		unsigned int GetStride() const { return stride; }
+		// @brief パイプラインステートに渡すインプットレイアウト
+		const std::vector<D3D12_INPUT_ELEMENT_DESC>& GetInputElementDescs() const { return input_element_descs; }
+		// @brief シェーダーのコンパイル時に渡すマクロ(終端はnullptr)
+		const D3D_SHADER_MACRO* GetShaderDefines() const { return shader_defines.data(); }
+
+		//-------------------------------------------------------------
+		// @brief メッシュの元データを、このフォーマットの頂点データに変換する
+		//
+		// @param [in] mesh 変換するメッシュ
+		// @param [out] out_vertices 変換後の頂点データ(GetStride()バイト×頂点数)
+		// @param [out] out_dequant 位置の逆量子化パラメータ。量子化しない場合は恒等変換になる
+		// @return 成功したら0、失敗したら-1
+		//-------------------------------------------------------------
+		int Encode(const MeshInfo& mesh, std::vector<unsigned char>& out_vertices, VertexDequant& out_dequant) const;
+	};
+}
@@ -0,0 +1,67 @@
+﻿#include "RadixSort.h"
+
+namespace System {
+
+	void RadixSort::Sort(const std::vector<uint64_t>& keys, std::vector<unsigned int>& out_order, std::vector<uint64_t>& scratch_keys, std::vector<unsigned int>& scratch_order)
+	{
+		constexpr unsigned int RADIX_BITS = 8;
+		constexpr unsigned int BUCKET_COUNT = 1 << RADIX_BITS;
+		constexpr unsigned int PASS_COUNT = 64 / RADIX_BITS;
+
+		size_t count = keys.size();
+		out_order.resize(count);
+		for (size_t i = 0; i < count; i++)
+			out_order[i] = static_cast<unsigned int>(i);
+		if (count <= 1)
+			return;
+
+		//全パス分のヒストグラムを1回の走査でまとめて数える
+		std::array<std::array<unsigned int, BUCKET_COUNT>, PASS_COUNT> histograms = {};
+		for (uint64_t key : keys) {
+			for (unsigned int pass = 0; pass < PASS_COUNT; pass++)
+				histograms[pass][(key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1)]++;
+		}
+
+		//キーと番号は、それぞれ2本の配列を交互に読み書きする
+		scratch_keys.resize(count * 2);
+		scratch_order.resize(count);
+		uint64_t* src_keys = scratch_keys.data();
+		uint64_t* dst_keys = scratch_keys.data() + count;
+		unsigned int* src_order = out_order.data();
+		unsigned int* dst_order = scratch_order.data();
+		std::copy(keys.begin(), keys.end(), src_keys);
+		for (unsigned int pass = 0; pass < PASS_COUNT; pass++) {
+			auto& histogram = histograms[pass];
+			unsigned int shift = pass * RADIX_BITS;
+			//全要素がこの桁で同じ値なら、並びは変わらない
+			if (histogram[(src_keys[0] >> shift) & (BUCKET_COUNT - 1)] == count)
+				continue;
+
+			//個数から各バケツの書き込み開始位置を求める
+			unsigned int offset = 0;
+			for (unsigned int bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+				unsigned int bucket_count = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucket_count;
+			}
+			for (size_t i = 0; i < count; i++) {
+				uint64_t key = src_keys[i];
+				unsigned int destination = histogram[(key >> shift) & (BUCKET_COUNT - 1)]++;
+				dst_keys[destination] = key;
+				dst_order[destination] = src_order[i];
+			}
+			std::swap(src_keys, dst_keys);
+			std::swap(src_order, dst_order);
+		}
+		//奇数回入れ替えた場合は、結果が作業用の方に入っている
+		if (src_order != out_order.data())
+			std::copy(src_order, src_order + count, out_order.data());
+	}
+
+	void RadixSort::Sort(const std::vector<uint64_t>& keys, std::vector<unsigned int>& out_order)
+	{
+		std::vector<uint64_t> scratch_keys;
+		std::vector<unsigned int> scratch_order;
+		Sort(keys, out_order, scratch_keys, scratch_order);
+	}
+}
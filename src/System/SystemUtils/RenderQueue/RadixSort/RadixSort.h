@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <cstdint>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 64bitキーのLSD基数ソート
+	// @details 下位バイトから8bitずつ、計数ソートを8回繰り返す(安定ソート)。
+	//			比較ソートと違って計算量がO(n)で、分岐もほぼ無いので、描画数が多いほど有利になる。
+	//			全要素で同じ値しか出てこない桁は並べ替えても変わらないので、そのパスは飛ばす
+	//			(ソートキーの上位ビットはレイヤーなど種類の少ないものが多いので、実際には半分近く飛ばせる)
+	//-------------------------------------------------------------
+	class RadixSort
+	{
+	public:
+		//-------------------------------------------------------------
+		// @brief キーの昇順に並べた時の、元の番号の並びを求める
+		// @details キーそのものは並べ替えない。同じキー同士は元の順番のまま
+		//
+		// @param [in] keys ソートするキー
+		// @param [out] out_order 昇順に並べた時の、元の番号
+		// @param [in,out] scratch_keys 作業用(キー数の2倍使う。毎フレーム使い回せば確保が減る)
+		// @param [in,out] scratch_order 作業用
+		//-------------------------------------------------------------
+		static void Sort(const std::vector<uint64_t>& keys, std::vector<unsigned int>& out_order, std::vector<uint64_t>& scratch_keys, std::vector<unsigned int>& scratch_order);
+		// @brief 作業用のバッファを内部で確保する版
+		static void Sort(const std::vector<uint64_t>& keys, std::vector<unsigned int>& out_order);
+	};
+}
@@ -0,0 +1,71 @@
+﻿#include "RenderQueue.h"
+#include "System/SystemUtils/RenderQueue/RadixSort/RadixSort.h"
+
+namespace System {
+
+	namespace {
+		constexpr uint64_t Mask(unsigned int bits) {
+			return (static_cast<uint64_t>(1) << bits) - 1;
+		}
+	}
+
+	uint32_t RenderQueue::QuantizeDepth(float depth, float max_depth)
+	{
+		if (!(max_depth > 0.0f))
+			return 0;
+		double normalized = std::clamp(static_cast<double>(depth) / max_depth, 0.0, 1.0);
+		return static_cast<uint32_t>(normalized * static_cast<double>(Mask(DEPTH_BITS)));
+	}
+
+	uint64_t RenderQueue::MakeKey(unsigned int layer, bool translucent, unsigned int pipeline_id, unsigned int material_id, float depth, float max_depth)
+	{
+		uint64_t key = static_cast<uint64_t>(layer) & Mask(LAYER_BITS);
+		key = (key << 1) | (translucent ? 1 : 0);
+		uint64_t pipeline = static_cast<uint64_t>(pipeline_id) & Mask(PIPELINE_BITS);
+		uint64_t material = static_cast<uint64_t>(material_id) & Mask(MATERIAL_BITS);
+		uint64_t quantized_depth = QuantizeDepth(depth, max_depth);
+		if (translucent) {
+			//奥から手前に描くので、深度を反転してステートよりも上位に置く
+			key = (key << DEPTH_BITS) | (Mask(DEPTH_BITS) - quantized_depth);
+			key = (key << PIPELINE_BITS) | pipeline;
+			key = (key << MATERIAL_BITS) | material;
+		}
+		else {
+			key = (key << PIPELINE_BITS) | pipeline;
+			key = (key << MATERIAL_BITS) | material;
+			key = (key << DEPTH_BITS) | quantized_depth;
+		}
+		return key;
+	}
+
+	unsigned int RenderQueue::GetPipelineId(uint64_t key)
+	{
+		if (IsTranslucent(key))
+			return static_cast<unsigned int>((key >> MATERIAL_BITS) & Mask(PIPELINE_BITS));
+		return static_cast<unsigned int>((key >> (MATERIAL_BITS + DEPTH_BITS)) & Mask(PIPELINE_BITS));
+	}
+
+	void RenderQueue::Clear()
+	{
+		keys.clear();
+		commands.clear();
+		order.clear();
+		is_sorted = false;
+	}
+
+	void RenderQueue::Push(uint64_t key, const IndirectDrawCommand& command)
+	{
+		keys.push_back(key);
+		commands.push_back(command);
+		order.push_back(static_cast<unsigned int>(order.size()));
+		is_sorted = false;
+	}
+
+	void RenderQueue::Sort()
+	{
+		if (is_sorted)
+			return;
+		RadixSort::Sort(keys, order, scratch_keys, scratch_order);
+		is_sorted = true;
+	}
+}
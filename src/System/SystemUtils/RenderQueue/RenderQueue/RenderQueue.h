@@ -0,0 +1,63 @@
+﻿#pragma once
+#include "System/SystemUtils/IndirectDraw/IndirectCommandBuffer/IndirectCommandBuffer.h"
+#include <cstdint>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 描画を64bitのソートキーで並べ替えてから発行するためのキュー
+	// @details キーは上位ビットから次のように詰める。
+	//			不透明 : レイヤー(4) | 半透明フラグ(1)=0 | PSO番号(11) | マテリアル番号(16) | 深度(32, 手前ほど小さい)
+	//			半透明 : レイヤー(4) | 半透明フラグ(1)=1 | 深度(32, 奥ほど小さい) | PSO番号(11) | マテリアル番号(16)
+	//			不透明はステートの切り替えが最小になるようにPSO・マテリアルでまとめ、同じ中では手前から描いて早期深度テストを効かせる。
+	//			半透明は正しく合成されるように、ステートよりも奥から手前の順を優先する。
+	//			並べ替えはRadixSortで、キーとドローは別々の配列に持っておき番号だけを並べ替える
+	//-------------------------------------------------------------
+	class RenderQueue
+	{
+	public:
+		static constexpr unsigned int LAYER_BITS = 4;
+		static constexpr unsigned int PIPELINE_BITS = 11;
+		static constexpr unsigned int MATERIAL_BITS = 16;
+		static constexpr unsigned int DEPTH_BITS = 32;
+	private:
+		std::vector<uint64_t> keys;
+		std::vector<IndirectDrawCommand> commands;
+		std::vector<unsigned int> order;
+		std::vector<uint64_t> scratch_keys;
+		std::vector<unsigned int> scratch_order;
+		bool is_sorted = false;
+	public:
+		//-------------------------------------------------------------
+		// @brief ソートキーを作る
+		//
+		// @param [in] layer 描画レイヤー(小さい方が先。0~15)
+		// @param [in] translucent 半透明ならtrue(不透明を全部描いてから描かれる)
+		// @param [in] pipeline_id PSOの番号(0~2047)
+		// @param [in] material_id マテリアルの番号(0~65535)
+		// @param [in] depth カメラからの距離
+		// @param [in] max_depth 距離の最大値(これで正規化して量子化する)
+		// @return ソートキー
+		//-------------------------------------------------------------
+		static uint64_t MakeKey(unsigned int layer, bool translucent, unsigned int pipeline_id, unsigned int material_id, float depth, float max_depth);
+		// @brief 距離を0~max_depthで正規化して32bitに量子化する
+		static uint32_t QuantizeDepth(float depth, float max_depth);
+		// @brief キーからPSOの番号を取り出す(PSOを切り替える位置を探すのに使う)
+		static unsigned int GetPipelineId(uint64_t key);
+		static unsigned int GetLayer(uint64_t key) { return static_cast<unsigned int>(key >> (64 - LAYER_BITS)); }
+		static bool IsTranslucent(uint64_t key) { return ((key >> (64 - LAYER_BITS - 1)) & 1) != 0; }
+
+		// @brief 積んだ描画を全て捨てる(確保したメモリは使い回す)
+		void Clear();
+		// @brief 描画を1つ積む
+		void Push(uint64_t key, const IndirectDrawCommand& command);
+		// @brief キーの昇順に並べ替える。同じキー同士は積んだ順のまま
+		void Sort();
+
+		size_t GetCount() const { return keys.size(); }
+		// @brief 並べ替えた後のindex番目のキー
+		uint64_t GetKey(size_t index) const { return keys[order[index]]; }
+		// @brief 並べ替えた後のindex番目の描画
+		const IndirectDrawCommand& GetCommand(size_t index) const { return commands[order[index]]; }
+	};
+}
@@ -0,0 +1,668 @@
+﻿#include "BlockCompressor.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+#include <immintrin.h>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+
+namespace System {
+
+	namespace {
+		//1スレッドに任せる最低のブロック数。小さいミップはスレッドを立てる方が遅い
+		constexpr size_t MIN_BLOCKS_PER_THREAD = 1024;
+
+		//4x4ブロックのピクセルを、チャンネル毎に並べたもの(SSEで4ピクセルずつ読めるように)
+		struct BlockPixels {
+			alignas(16) float channel[4][16];
+		};
+
+		//端点の間を補間した色の一覧。各ピクセルは、この中で一番近い色の番号(インデックス)で表す
+		struct Palette {
+			float color[16][4];
+			int count = 0;
+		};
+
+		//ブロック(block_x, block_y)のピクセルを読む。画像からはみ出した分は端のピクセルを使う
+		void LoadBlock(const uint8_t* src, size_t width, size_t height, size_t row_pitch, size_t block_x, size_t block_y, BlockPixels& block)
+		{
+			for (size_t y = 0; y < 4; y++) {
+				const uint8_t* row = src + std::min(block_y * 4 + y, height - 1) * row_pitch;
+				for (size_t x = 0; x < 4; x++) {
+					const uint8_t* pixel = row + std::min(block_x * 4 + x, width - 1) * 4;
+					for (int c = 0; c < 4; c++)
+						block.channel[c][y * 4 + x] = pixel[c];
+				}
+			}
+		}
+
+		//-------------------------------------------------------------
+		// 各ピクセルに一番近いパレットの色を選び、二乗誤差の合計を返す
+		// チャンネルは[channel_begin, channel_begin + channel_count)だけを比べる(パレットの色は0番から詰めておく)
+		// SSE版とそうでない版は、同じ順番で同じ計算をするので、結果は完全に一致する
+		//-------------------------------------------------------------
+		float SelectIndices(const BlockPixels& block, const Palette& palette, int channel_begin, int channel_count, uint8_t* indices, bool simd)
+		{
+			float errors[16];
+			if (simd) {
+				for (int g = 0; g < 16; g += 4) {
+					__m128 pixel[4];
+					for (int c = 0; c < channel_count; c++)
+						pixel[c] = _mm_load_ps(&block.channel[channel_begin + c][g]);
+					__m128 best = _mm_set1_ps(FLT_MAX);
+					__m128i best_index = _mm_setzero_si128();
+					for (int e = 0; e < palette.count; e++) {
+						__m128 distance = _mm_setzero_ps();
+						for (int c = 0; c < channel_count; c++) {
+							__m128 diff = _mm_sub_ps(pixel[c], _mm_set1_ps(palette.color[e][c]));
+							distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+						}
+						//より近ければ、その番号に置き換える
+						__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+						best = _mm_min_ps(distance, best);
+						best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)), _mm_andnot_si128(closer, best_index));
+					}
+					alignas(16) int32_t index[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(index), best_index);
+					_mm_storeu_ps(&errors[g], best);
+					for (int i = 0; i < 4; i++)
+						indices[g + i] = static_cast<uint8_t>(index[i]);
+				}
+			}
+			else {
+				for (int i = 0; i < 16; i++) {
+					float best = FLT_MAX;
+					int best_index = 0;
+					for (int e = 0; e < palette.count; e++) {
+						float distance = 0.0f;
+						for (int c = 0; c < channel_count; c++) {
+							float diff = block.channel[channel_begin + c][i] - palette.color[e][c];
+							distance = distance + diff * diff;
+						}
+						if (distance < best) {
+							best = distance;
+							best_index = e;
+						}
+					}
+					indices[i] = static_cast<uint8_t>(best_index);
+					errors[i] = best;
+				}
+			}
+			float total = 0.0f;
+			for (int i = 0; i < 16; i++)
+				total += errors[i];
+			return total;
+		}
+
+		//-------------------------------------------------------------
+		// ブロック内の色の分布の主軸を求め、ピクセルをその軸に投影した両端を端点にする
+		// 主軸は、共分散行列をべき乗法で数回掛けて求める
+		//-------------------------------------------------------------
+		void ComputeEndpoints(const BlockPixels& block, int channel_count, float* endpoint0, float* endpoint1)
+		{
+			float mean[4] = {};
+			float min_value[4];
+			float max_value[4];
+			for (int c = 0; c < channel_count; c++) {
+				min_value[c] = FLT_MAX;
+				max_value[c] = -FLT_MAX;
+				for (int i = 0; i < 16; i++) {
+					float v = block.channel[c][i];
+					mean[c] += v;
+					min_value[c] = std::min(min_value[c], v);
+					max_value[c] = std::max(max_value[c], v);
+				}
+				mean[c] /= 16.0f;
+			}
+
+			float covariance[4][4] = {};
+			for (int i = 0; i < 16; i++) {
+				for (int a = 0; a < channel_count; a++) {
+					float da = block.channel[a][i] - mean[a];
+					for (int b = a; b < channel_count; b++)
+						covariance[a][b] += da * (block.channel[b][i] - mean[b]);
+				}
+			}
+			for (int a = 0; a < channel_count; a++)
+				for (int b = 0; b < a; b++)
+					covariance[a][b] = covariance[b][a];
+
+			//初期値は各チャンネルの範囲。べき乗法で最大固有値の固有ベクトルに寄せていく
+			float axis[4] = {};
+			for (int c = 0; c < channel_count; c++)
+				axis[c] = max_value[c] - min_value[c];
+			for (int iteration = 0; iteration < 8; iteration++) {
+				float next[4] = {};
+				float length = 0.0f;
+				for (int a = 0; a < channel_count; a++) {
+					for (int b = 0; b < channel_count; b++)
+						next[a] += covariance[a][b] * axis[b];
+					length = std::max(length, std::fabs(next[a]));
+				}
+				if (length <= 0.0f)
+					break;
+				for (int c = 0; c < channel_count; c++)
+					axis[c] = next[c] / length;
+			}
+
+			float axis_length_sq = 0.0f;
+			for (int c = 0; c < channel_count; c++)
+				axis_length_sq += axis[c] * axis[c];
+			if (axis_length_sq < 1e-8f) {
+				//全てのピクセルが同じ色
+				for (int c = 0; c < channel_count; c++)
+					endpoint0[c] = endpoint1[c] = mean[c];
+				return;
+			}
+			float t_min = FLT_MAX;
+			float t_max = -FLT_MAX;
+			for (int i = 0; i < 16; i++) {
+				float t = 0.0f;
+				for (int c = 0; c < channel_count; c++)
+					t += (block.channel[c][i] - mean[c]) * axis[c];
+				t /= axis_length_sq;
+				t_min = std::min(t_min, t);
+				t_max = std::max(t_max, t);
+			}
+			for (int c = 0; c < channel_count; c++) {
+				endpoint0[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+				endpoint1[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+			}
+		}
+
+		//-------------------------------------------------------------
+		// インデックスを固定したまま、二乗誤差が最小になる端点を最小二乗法で求め直す
+		// weightsは、インデックス毎の端点0の重み(端点1の重みは1 - weight)
+		//-------------------------------------------------------------
+		bool RefineEndpoints(const BlockPixels& block, int channel_count, const uint8_t* indices, const float* weights, float* endpoint0, float* endpoint1)
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float x0[4] = {};
+			float x1[4] = {};
+			for (int i = 0; i < 16; i++) {
+				float w0 = weights[indices[i]];
+				float w1 = 1.0f - w0;
+				aa += w0 * w0;
+				ab += w0 * w1;
+				bb += w1 * w1;
+				for (int c = 0; c < channel_count; c++) {
+					x0[c] += w0 * block.channel[c][i];
+					x1[c] += w1 * block.channel[c][i];
+				}
+			}
+			float determinant = aa * bb - ab * ab;
+			if (std::fabs(determinant) < 1e-6f)
+				return false;
+			for (int c = 0; c < channel_count; c++) {
+				endpoint0[c] = std::clamp((bb * x0[c] - ab * x1[c]) / determinant, 0.0f, 255.0f);
+				endpoint1[c] = std::clamp((aa * x1[c] - ab * x0[c]) / determinant, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		//下位bitから順に詰めて書く
+		class BitWriter {
+			uint8_t* data;
+			size_t position = 0;
+		public:
+			explicit BitWriter(uint8_t* data_, size_t size) :data(data_) { std::memset(data, 0, size); }
+			void Write(uint32_t value, int bits) {
+				for (int i = 0; i < bits; i++, position++) {
+					if (value & (1u << i))
+						data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		};
+		class BitReader {
+			const uint8_t* data;
+			size_t position = 0;
+		public:
+			explicit BitReader(const uint8_t* data_) :data(data_) {}
+			uint32_t Read(int bits) {
+				uint32_t value = 0;
+				for (int i = 0; i < bits; i++, position++)
+					value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1) << i;
+				return value;
+			}
+		};
+
+		//-------------------------------------------------------------
+		// BC1
+		//-------------------------------------------------------------
+		uint16_t PackRGB565(const float* color)
+		{
+			uint16_t r = static_cast<uint16_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * (31.0f / 255.0f)));
+			uint16_t g = static_cast<uint16_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * (63.0f / 255.0f)));
+			uint16_t b = static_cast<uint16_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * (31.0f / 255.0f)));
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+		void UnpackRGB565(uint16_t color, int* out)
+		{
+			int r = (color >> 11) & 31;
+			int g = (color >> 5) & 63;
+			int b = color & 31;
+			out[0] = (r << 3) | (r >> 2);
+			out[1] = (g << 2) | (g >> 4);
+			out[2] = (b << 3) | (b >> 2);
+		}
+		//4色モードのパレット。補間の丸めはDecodeBC1Blockと揃えておく
+		void MakeBC1Palette(uint16_t color0, uint16_t color1, int (*out)[3])
+		{
+			UnpackRGB565(color0, out[0]);
+			UnpackRGB565(color1, out[1]);
+			for (int c = 0; c < 3; c++) {
+				out[2][c] = (2 * out[0][c] + out[1][c] + 1) / 3;
+				out[3][c] = (out[0][c] + 2 * out[1][c] + 1) / 3;
+			}
+		}
+		//インデックス毎の端点0の重み
+		constexpr float BC1_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		void EncodeBC1Block(const BlockPixels& block, uint8_t* out, bool simd)
+		{
+			uint16_t best_color0 = 0;
+			uint16_t best_color1 = 0;
+			uint8_t best_indices[16] = {};
+			float best_error = FLT_MAX;
+			auto try_endpoints = [&](const float* endpoint0, const float* endpoint1) {
+				uint16_t color0 = PackRGB565(endpoint0);
+				uint16_t color1 = PackRGB565(endpoint1);
+				int colors[4][3];
+				MakeBC1Palette(color0, color1, colors);
+				Palette palette;
+				palette.count = 4;
+				for (int e = 0; e < 4; e++)
+					for (int c = 0; c < 3; c++)
+						palette.color[e][c] = static_cast<float>(colors[e][c]);
+				uint8_t indices[16];
+				float error = SelectIndices(block, palette, 0, 3, indices, simd);
+				if (error < best_error) {
+					best_error = error;
+					best_color0 = color0;
+					best_color1 = color1;
+					std::memcpy(best_indices, indices, sizeof(indices));
+				}
+				};
+
+			float endpoint0[4], endpoint1[4];
+			ComputeEndpoints(block, 3, endpoint0, endpoint1);
+			try_endpoints(endpoint0, endpoint1);
+			if (RefineEndpoints(block, 3, best_indices, BC1_WEIGHTS, endpoint0, endpoint1))
+				try_endpoints(endpoint0, endpoint1);
+
+			//color0 > color1でないと、3色+透明のモードになってしまうので入れ替える(0と1、2と3のインデックスも入れ替わる)
+			if (best_color0 < best_color1) {
+				std::swap(best_color0, best_color1);
+				for (uint8_t& index : best_indices)
+					index ^= 1;
+			}
+			else if (best_color0 == best_color1) {
+				std::memset(best_indices, 0, sizeof(best_indices));
+			}
+			out[0] = static_cast<uint8_t>(best_color0 & 0xFF);
+			out[1] = static_cast<uint8_t>(best_color0 >> 8);
+			out[2] = static_cast<uint8_t>(best_color1 & 0xFF);
+			out[3] = static_cast<uint8_t>(best_color1 >> 8);
+			uint32_t bits = 0;
+			for (int i = 0; i < 16; i++)
+				bits |= static_cast<uint32_t>(best_indices[i]) << (i * 2);
+			for (int i = 0; i < 4; i++)
+				out[4 + i] = static_cast<uint8_t>(bits >> (i * 8));
+		}
+
+		//force_four_colorはBC3のカラー部分用(BC3では常に4色モードとして読む)
+		void DecodeBC1Block(const uint8_t* in, uint8_t* rgba, bool force_four_color)
+		{
+			uint16_t color0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+			uint16_t color1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+			int colors[4][4];
+			UnpackRGB565(color0, colors[0]);
+			UnpackRGB565(color1, colors[1]);
+			colors[0][3] = colors[1][3] = colors[2][3] = colors[3][3] = 255;
+			if (color0 > color1 || force_four_color) {
+				for (int c = 0; c < 3; c++) {
+					colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+					colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+				}
+			}
+			else {
+				for (int c = 0; c < 3; c++) {
+					colors[2][c] = (colors[0][c] + colors[1][c] + 1) / 2;
+					colors[3][c] = 0;
+				}
+				colors[3][3] = 0;
+			}
+			uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+			for (int i = 0; i < 16; i++) {
+				int index = (bits >> (i * 2)) & 3;
+				for (int c = 0; c < 4; c++)
+					rgba[i * 4 + c] = static_cast<uint8_t>(colors[index][c]);
+			}
+		}
+
+		//-------------------------------------------------------------
+		// BC4(1チャンネル分、8バイト)。端点0 > 端点1の8段階のモードだけを使う
+		//-------------------------------------------------------------
+		void EncodeBC4Channel(const BlockPixels& block, int channel, uint8_t* out, bool simd)
+		{
+			const float* values = block.channel[channel];
+			float min_value = values[0];
+			float max_value = values[0];
+			for (int i = 1; i < 16; i++) {
+				min_value = std::min(min_value, values[i]);
+				max_value = std::max(max_value, values[i]);
+			}
+			int endpoint0 = static_cast<int>(std::lround(max_value));
+			int endpoint1 = static_cast<int>(std::lround(min_value));
+
+			//端点1(最小)からの位置(0～7)を求めて、BC4の番号(0が端点0、1が端点1、2～7がその間を端点0側から)に直す
+			uint8_t codes[16] = {};
+			if (endpoint0 != endpoint1) {
+				float scale = 7.0f / static_cast<float>(endpoint0 - endpoint1);
+				float offset = static_cast<float>(endpoint1);
+				int positions[16];
+				if (simd) {
+					const __m128 scale4 = _mm_set1_ps(scale);
+					const __m128 offset4 = _mm_set1_ps(offset);
+					const __m128 half = _mm_set1_ps(0.5f);
+					const __m128 zero = _mm_setzero_ps();
+					const __m128 seven = _mm_set1_ps(7.0f);
+					for (int g = 0; g < 16; g += 4) {
+						__m128 t = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(values + g), offset4), scale4), half);
+						t = _mm_min_ps(_mm_max_ps(t, zero), seven);
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(positions + g), _mm_cvttps_epi32(t));
+					}
+				}
+				else {
+					for (int i = 0; i < 16; i++) {
+						float t = (values[i] - offset) * scale + 0.5f;
+						positions[i] = static_cast<int>(std::min(std::max(t, 0.0f), 7.0f));
+					}
+				}
+				for (int i = 0; i < 16; i++) {
+					int position = positions[i];
+					codes[i] = static_cast<uint8_t>(position == 7 ? 0 : position == 0 ? 1 : 8 - position);
+				}
+			}
+			out[0] = static_cast<uint8_t>(endpoint0);
+			out[1] = static_cast<uint8_t>(endpoint1);
+			uint64_t bits = 0;
+			for (int i = 0; i < 16; i++)
+				bits |= static_cast<uint64_t>(codes[i]) << (i * 3);
+			for (int i = 0; i < 6; i++)
+				out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+		}
+
+		void DecodeBC4Channel(const uint8_t* in, uint8_t* rgba, int channel)
+		{
+			int values[8];
+			values[0] = in[0];
+			values[1] = in[1];
+			if (values[0] > values[1]) {
+				for (int k = 2; k < 8; k++)
+					values[k] = ((8 - k) * values[0] + (k - 1) * values[1] + 3) / 7;
+			}
+			else {
+				for (int k = 2; k < 6; k++)
+					values[k] = ((6 - k) * values[0] + (k - 1) * values[1] + 2) / 5;
+				values[6] = 0;
+				values[7] = 255;
+			}
+			uint64_t bits = 0;
+			for (int i = 0; i < 6; i++)
+				bits |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+			for (int i = 0; i < 16; i++)
+				rgba[i * 4 + channel] = static_cast<uint8_t>(values[(bits >> (i * 3)) & 7]);
+		}
+
+		//-------------------------------------------------------------
+		// BC7 モード6
+		// 7bitモード番号(0b1000000) | R0 R1 G0 G1 B0 B1 A0 A1 (各7bit) | P0 P1 | インデックス(先頭3bit、残り4bit×15)
+		//-------------------------------------------------------------
+		constexpr int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		//7bitの値とPビットを合わせた8bitの値が、vに一番近くなる7bitの値
+		uint8_t QuantizeWithPBit(float v, int p_bit)
+		{
+			return static_cast<uint8_t>(std::clamp(static_cast<int>(std::lround((v - static_cast<float>(p_bit)) * 0.5f)), 0, 127));
+		}
+
+		void EncodeBC7Block(const BlockPixels& block, uint8_t* out, bool simd)
+		{
+			struct Candidate {
+				uint8_t endpoint0[4];
+				uint8_t endpoint1[4];
+				int p_bit0 = 0;
+				int p_bit1 = 0;
+				uint8_t indices[16];
+				float error = FLT_MAX;
+			};
+			Candidate best;
+			//Pビットの4通りの組み合わせを全て試す
+			auto try_endpoints = [&](const float* endpoint0, const float* endpoint1) {
+				for (int p = 0; p < 4; p++) {
+					Candidate candidate;
+					candidate.p_bit0 = p & 1;
+					candidate.p_bit1 = p >> 1;
+					int value0[4], value1[4];
+					for (int c = 0; c < 4; c++) {
+						candidate.endpoint0[c] = QuantizeWithPBit(endpoint0[c], candidate.p_bit0);
+						candidate.endpoint1[c] = QuantizeWithPBit(endpoint1[c], candidate.p_bit1);
+						value0[c] = (candidate.endpoint0[c] << 1) | candidate.p_bit0;
+						value1[c] = (candidate.endpoint1[c] << 1) | candidate.p_bit1;
+					}
+					Palette palette;
+					palette.count = 16;
+					for (int i = 0; i < 16; i++) {
+						int w = BC7_WEIGHTS4[i];
+						for (int c = 0; c < 4; c++)
+							palette.color[i][c] = static_cast<float>(((64 - w) * value0[c] + w * value1[c] + 32) >> 6);
+					}
+					candidate.error = SelectIndices(block, palette, 0, 4, candidate.indices, simd);
+					if (candidate.error < best.error)
+						best = candidate;
+				}
+				};
+
+			float endpoint0[4], endpoint1[4];
+			ComputeEndpoints(block, 4, endpoint0, endpoint1);
+			try_endpoints(endpoint0, endpoint1);
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = 1.0f - BC7_WEIGHTS4[i] / 64.0f;
+			if (RefineEndpoints(block, 4, best.indices, weights, endpoint0, endpoint1))
+				try_endpoints(endpoint0, endpoint1);
+
+			//ピクセル0のインデックスは最上位bitを省いて3bitで書くので、8以上なら端点を入れ替えて反転する
+			if (best.indices[0] & 8) {
+				std::swap(best.endpoint0, best.endpoint1);
+				std::swap(best.p_bit0, best.p_bit1);
+				for (uint8_t& index : best.indices)
+					index = static_cast<uint8_t>(15 - index);
+			}
+
+			BitWriter writer(out, 16);
+			writer.Write(1u << 6, 7);
+			for (int c = 0; c < 4; c++) {
+				writer.Write(best.endpoint0[c], 7);
+				writer.Write(best.endpoint1[c], 7);
+			}
+			writer.Write(best.p_bit0, 1);
+			writer.Write(best.p_bit1, 1);
+			writer.Write(best.indices[0], 3);
+			for (int i = 1; i < 16; i++)
+				writer.Write(best.indices[i], 4);
+		}
+
+		bool DecodeBC7Block(const uint8_t* in, uint8_t* rgba)
+		{
+			//モード6は、先頭の7bitが0b1000000
+			if ((in[0] & 0x7F) != 0x40)
+				return false;
+			BitReader reader(in);
+			reader.Read(7);
+			int endpoint0[4], endpoint1[4];
+			for (int c = 0; c < 4; c++) {
+				endpoint0[c] = static_cast<int>(reader.Read(7));
+				endpoint1[c] = static_cast<int>(reader.Read(7));
+			}
+			int p_bit0 = static_cast<int>(reader.Read(1));
+			int p_bit1 = static_cast<int>(reader.Read(1));
+			for (int c = 0; c < 4; c++) {
+				endpoint0[c] = (endpoint0[c] << 1) | p_bit0;
+				endpoint1[c] = (endpoint1[c] << 1) | p_bit1;
+			}
+			for (int i = 0; i < 16; i++) {
+				int w = BC7_WEIGHTS4[reader.Read(i == 0 ? 3 : 4)];
+				for (int c = 0; c < 4; c++)
+					rgba[i * 4 + c] = static_cast<uint8_t>(((64 - w) * endpoint0[c] + w * endpoint1[c] + 32) >> 6);
+			}
+			return true;
+		}
+
+		//形式毎の、比べるチャンネルの数(先頭から)
+		int GetChannelCount(BlockCompressor::Format format)
+		{
+			switch (format) {
+			case BlockCompressor::Format::BC1: return 3;
+			case BlockCompressor::Format::BC4: return 1;
+			case BlockCompressor::Format::BC5: return 2;
+			default: return 4;
+			}
+		}
+	}
+
+	BlockCompressor::BlockCompressor(unsigned int thread_count_)
+		:thread_count(thread_count_ != 0 ? thread_count_ : std::max(1u, std::thread::hardware_concurrency())),
+		workers(thread_count - 1, "BlockCompressor")	// 呼び出したスレッドも帯を処理するので、作業スレッドは1つ少なくてよい
+	{
+	}
+
+	size_t BlockCompressor::GetBlockSize(Format format)
+	{
+		return (format == Format::BC1 || format == Format::BC4) ? 8 : 16;
+	}
+
+	void BlockCompressor::CompressBand(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+		uint8_t* dst, size_t dst_row_pitch, size_t block_row_begin, size_t block_row_end) const
+	{
+		size_t blocks_x = (width + BLOCK_WIDTH - 1) / BLOCK_WIDTH;
+		size_t block_size = GetBlockSize(format);
+		BlockPixels block;
+		for (size_t block_y = block_row_begin; block_y < block_row_end; block_y++) {
+			uint8_t* out = dst + block_y * dst_row_pitch;
+			for (size_t block_x = 0; block_x < blocks_x; block_x++, out += block_size) {
+				LoadBlock(src, width, height, src_row_pitch, block_x, block_y, block);
+				switch (format) {
+				case Format::BC1:
+					EncodeBC1Block(block, out, simd_enabled);
+					break;
+				case Format::BC3:
+					//アルファが先、カラーが後
+					EncodeBC4Channel(block, 3, out, simd_enabled);
+					EncodeBC1Block(block, out + 8, simd_enabled);
+					break;
+				case Format::BC4:
+					EncodeBC4Channel(block, 0, out, simd_enabled);
+					break;
+				case Format::BC5:
+					EncodeBC4Channel(block, 0, out, simd_enabled);
+					EncodeBC4Channel(block, 1, out + 8, simd_enabled);
+					break;
+				case Format::BC7:
+					EncodeBC7Block(block, out, simd_enabled);
+					break;
+				}
+			}
+		}
+	}
+
+	void BlockCompressor::Compress(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+		uint8_t* dst, size_t dst_row_pitch) const
+	{
+		PROFILE_FUNCTION();
+		if (!src || !dst || width == 0 || height == 0) return;
+		size_t blocks_x = (width + BLOCK_WIDTH - 1) / BLOCK_WIDTH;
+		size_t block_rows = GetRowCount(height);
+
+		//ブロックの行を帯に分けて、帯毎に別スレッドで圧縮する(帯同士は書き込み先が重ならない)
+		size_t band_count = std::min<size_t>(thread_count, std::max<size_t>(1, blocks_x * block_rows / MIN_BLOCKS_PER_THREAD));
+		band_count = std::min(band_count, block_rows);
+		workers.Run(static_cast<unsigned int>(band_count), [=, this](unsigned int band) {
+			size_t begin = block_rows * band / band_count;
+			size_t end = block_rows * (band + 1) / band_count;
+			CompressBand(format, src, width, height, src_row_pitch, dst, dst_row_pitch, begin, end);
+			});
+	}
+
+	bool BlockCompressor::Decompress(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+		uint8_t* dst, size_t dst_row_pitch)
+	{
+		if (!src || !dst) return false;
+		size_t blocks_x = (width + BLOCK_WIDTH - 1) / BLOCK_WIDTH;
+		size_t block_rows = GetRowCount(height);
+		size_t block_size = GetBlockSize(format);
+		bool result = true;
+		uint8_t rgba[16 * 4];
+		for (size_t block_y = 0; block_y < block_rows; block_y++) {
+			const uint8_t* in = src + block_y * src_row_pitch;
+			for (size_t block_x = 0; block_x < blocks_x; block_x++, in += block_size) {
+				//持っていないチャンネルは、0(アルファは255)にしておく
+				for (int i = 0; i < 16; i++) {
+					rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+					rgba[i * 4 + 3] = 255;
+				}
+				switch (format) {
+				case Format::BC1:
+					DecodeBC1Block(in, rgba, false);
+					break;
+				case Format::BC3:
+					DecodeBC1Block(in + 8, rgba, true);
+					DecodeBC4Channel(in, rgba, 3);
+					break;
+				case Format::BC4:
+					DecodeBC4Channel(in, rgba, 0);
+					break;
+				case Format::BC5:
+					DecodeBC4Channel(in, rgba, 0);
+					DecodeBC4Channel(in + 8, rgba, 1);
+					break;
+				case Format::BC7:
+					if (!DecodeBC7Block(in, rgba))
+						result = false;
+					break;
+				}
+				//画像からはみ出した分は書かない
+				for (size_t y = 0; y < 4 && block_y * 4 + y < height; y++) {
+					size_t x_count = std::min<size_t>(4, width - block_x * 4);
+					std::memcpy(dst + (block_y * 4 + y) * dst_row_pitch + block_x * 16, rgba + y * 16, x_count * 4);
+				}
+			}
+		}
+		return result;
+	}
+
+	double BlockCompressor::ComputePSNR(Format format, const uint8_t* a, size_t a_row_pitch, const uint8_t* b, size_t b_row_pitch, size_t width, size_t height)
+	{
+		int channel_count = GetChannelCount(format);
+		double squared_error = 0.0;
+		for (size_t y = 0; y < height; y++) {
+			const uint8_t* row_a = a + y * a_row_pitch;
+			const uint8_t* row_b = b + y * b_row_pitch;
+			for (size_t x = 0; x < width; x++) {
+				for (int c = 0; c < channel_count; c++) {
+					double diff = static_cast<double>(row_a[x * 4 + c]) - static_cast<double>(row_b[x * 4 + c]);
+					squared_error += diff * diff;
+				}
+			}
+		}
+		if (squared_error == 0.0 || width == 0 || height == 0)
+			return std::numeric_limits<double>::infinity();
+		double mse = squared_error / (static_cast<double>(width) * height * channel_count);
+		return 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+}
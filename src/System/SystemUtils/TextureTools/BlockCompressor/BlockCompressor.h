@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "System/SystemUtils/Thread/WorkerPool/WorkerPool.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief RGBA8の画像を、GPUがそのまま読めるブロック圧縮(BC)の形式に変換するクラス
+	// @details 4x4ピクセルのブロック毎に、2つの端点の色と、各ピクセルがその間のどこにあるか(インデックス)で表す。
+	//			・端点は、ブロック内の色の分布の主軸(主成分分析)の両端から求め、最小二乗法で1回詰め直す
+	//			・各ピクセルのインデックスは、パレットの全ての色との距離をSSEで4ピクセルずつ求めて一番近いものを選ぶ
+	//			・ブロックの行を帯に分けて、帯毎に作業スレッド(ミップ毎に立て直さず、使い回す)で圧縮する
+	//			・BC7はモード6(1サブセット、RGBA各7bit+Pビット、4bitインデックス)だけを使う
+	//			Windowsの型やライブラリには依存しないので、オフラインのツールとしてLinuxでも動かせる
+	//-------------------------------------------------------------
+	class BlockCompressor
+	{
+	public:
+		enum class Format {
+			BC1,	// RGB 4bpp。不透明なカラー用
+			BC3,	// RGBA 8bpp。BC1のカラー + BC4のアルファ
+			BC4,	// R 4bpp。ラフネスやメタリックなど1チャンネルのマスク用
+			BC5,	// RG 8bpp。法線マップ用(Zはシェーダーで復元する)
+			BC7,	// RGBA 8bpp。高品質なカラー用
+		};
+		static constexpr size_t BLOCK_WIDTH = 4;
+		static constexpr size_t BLOCK_HEIGHT = 4;
+
+	private:
+		unsigned int thread_count = 1;
+		bool simd_enabled = true;
+		mutable WorkerPool workers;	// 小さいミップしか無ければ、スレッドは立てない
+
+		void CompressBand(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+			uint8_t* dst, size_t dst_row_pitch, size_t block_row_begin, size_t block_row_end) const;
+	public:
+		// @param [in] thread_count_ 圧縮に使うスレッド数(0ならハードウェアスレッド数)
+		explicit BlockCompressor(unsigned int thread_count_ = 0);
+
+		// @brief SSEを使うかどうか(結果の比較用。通常は有効のまま)
+		void SetSimdEnabled(bool enabled) { simd_enabled = enabled; }
+
+		// @brief 1ブロックのバイト数(BC1とBC4は8、それ以外は16)
+		static size_t GetBlockSize(Format format);
+		// @brief 幅×高さの画像を圧縮した時の、ブロック1行分のバイト数
+		static size_t GetRowPitch(Format format, size_t width) { return (width + BLOCK_WIDTH - 1) / BLOCK_WIDTH * GetBlockSize(format); }
+		// @brief 幅×高さの画像を圧縮した時の、ブロックの行数
+		static size_t GetRowCount(size_t height) { return (height + BLOCK_HEIGHT - 1) / BLOCK_HEIGHT; }
+
+		//-------------------------------------------------------------
+		// @brief RGBA8の画像を圧縮する
+		// @details 幅や高さが4の倍数でない場合、はみ出した分は端のピクセルで埋める
+		// @param [out] dst ブロックの行がdst_row_pitch毎に並ぶ書き込み先
+		//-------------------------------------------------------------
+		void Compress(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+			uint8_t* dst, size_t dst_row_pitch) const;
+
+		//-------------------------------------------------------------
+		// @brief 圧縮した画像をRGBA8に戻す(品質の確認用)
+		// @details BC7はモード6のブロックだけ戻せる。他のモードのブロックが含まれていた場合はfalse
+		//-------------------------------------------------------------
+		static bool Decompress(Format format, const uint8_t* src, size_t width, size_t height, size_t src_row_pitch,
+			uint8_t* dst, size_t dst_row_pitch);
+
+		//-------------------------------------------------------------
+		// @brief 2つのRGBA8の画像のPSNR(ピーク信号対雑音比、dB)を求める
+		// @details 比べるのは、その形式が持っているチャンネルだけ(BC1はRGB、BC4はR、BC5はRG)。全く同じなら無限大を返す
+		//-------------------------------------------------------------
+		static double ComputePSNR(Format format, const uint8_t* a, size_t a_row_pitch, const uint8_t* b, size_t b_row_pitch, size_t width, size_t height);
+	};
+}
@@ -0,0 +1,482 @@
+﻿#include "DDSFile.h"
+
+namespace System {
+
+	namespace {
+		constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+		{
+			return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8)
+				| (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+		}
+		constexpr uint32_t DDS_MAGIC = MakeFourCC('D', 'D', 'S', ' ');
+		constexpr uint32_t DDSD_DEPTH = 0x00800000;
+		constexpr uint32_t DDPF_ALPHAPIXELS = 0x00000001;
+		constexpr uint32_t DDPF_FOURCC = 0x00000004;
+		constexpr uint32_t DDPF_RGB = 0x00000040;
+		constexpr uint32_t DDSCAPS2_CUBEMAP = 0x00000200;
+		constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0x0000FC00;
+		constexpr uint32_t DDSCAPS2_VOLUME = 0x00200000;
+		constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x00000004;
+
+		//行のピッチと、サブリソースの先頭の揃え方(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT、D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)
+		constexpr UINT64 PITCH_ALIGNMENT = 256;
+		constexpr UINT64 PLACEMENT_ALIGNMENT = 512;
+
+#pragma pack(push, 1)
+		struct DDSPixelFormat {
+			uint32_t size;
+			uint32_t flags;
+			uint32_t four_cc;
+			uint32_t rgb_bit_count;
+			uint32_t r_mask;
+			uint32_t g_mask;
+			uint32_t b_mask;
+			uint32_t a_mask;
+		};
+		struct DDSHeader {
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t pitch_or_linear_size;
+			uint32_t depth;
+			uint32_t mip_map_count;
+			uint32_t reserved1[11];
+			DDSPixelFormat pixel_format;
+			uint32_t caps;
+			uint32_t caps2;
+			uint32_t caps3;
+			uint32_t caps4;
+			uint32_t reserved2;
+		};
+		struct DDSHeaderDX10 {
+			uint32_t dxgi_format;
+			uint32_t resource_dimension;
+			uint32_t misc_flag;
+			uint32_t array_size;
+			uint32_t misc_flags2;
+		};
+#pragma pack(pop)
+		static_assert(sizeof(DDSHeader) == 124, "DDSヘッダーの大きさが違います");
+		static_assert(sizeof(DDSHeaderDX10) == 20, "DX10拡張ヘッダーの大きさが違います");
+
+		UINT64 AlignUp(UINT64 value, UINT64 alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		//ブロック圧縮のフォーマットなら、1ブロックのバイト数。それ以外は0
+		unsigned int GetBlockSize(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_BC1_TYPELESS:
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+			case DXGI_FORMAT_BC4_TYPELESS:
+			case DXGI_FORMAT_BC4_UNORM:
+			case DXGI_FORMAT_BC4_SNORM:
+				return 8;
+
+			case DXGI_FORMAT_BC2_TYPELESS:
+			case DXGI_FORMAT_BC2_UNORM:
+			case DXGI_FORMAT_BC2_UNORM_SRGB:
+			case DXGI_FORMAT_BC3_TYPELESS:
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+			case DXGI_FORMAT_BC5_TYPELESS:
+			case DXGI_FORMAT_BC5_UNORM:
+			case DXGI_FORMAT_BC5_SNORM:
+			case DXGI_FORMAT_BC6H_TYPELESS:
+			case DXGI_FORMAT_BC6H_UF16:
+			case DXGI_FORMAT_BC6H_SF16:
+			case DXGI_FORMAT_BC7_TYPELESS:
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				return 16;
+
+			default:
+				return 0;
+			}
+		}
+
+		unsigned int GetBytesPerPixel(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			case DXGI_FORMAT_R32G32B32A32_UINT:
+			case DXGI_FORMAT_R32G32B32A32_SINT:
+				return 16;
+
+			case DXGI_FORMAT_R32G32B32_TYPELESS:
+			case DXGI_FORMAT_R32G32B32_FLOAT:
+			case DXGI_FORMAT_R32G32B32_UINT:
+			case DXGI_FORMAT_R32G32B32_SINT:
+				return 12;
+
+			case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			case DXGI_FORMAT_R16G16B16A16_UNORM:
+			case DXGI_FORMAT_R16G16B16A16_UINT:
+			case DXGI_FORMAT_R16G16B16A16_SNORM:
+			case DXGI_FORMAT_R16G16B16A16_SINT:
+			case DXGI_FORMAT_R32G32_TYPELESS:
+			case DXGI_FORMAT_R32G32_FLOAT:
+			case DXGI_FORMAT_R32G32_UINT:
+			case DXGI_FORMAT_R32G32_SINT:
+			case DXGI_FORMAT_R32G8X24_TYPELESS:
+			case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+			case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+			case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+				return 8;
+
+			case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+			case DXGI_FORMAT_R10G10B10A2_UNORM:
+			case DXGI_FORMAT_R10G10B10A2_UINT:
+			case DXGI_FORMAT_R11G11B10_FLOAT:
+			case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_R8G8B8A8_UINT:
+			case DXGI_FORMAT_R8G8B8A8_SNORM:
+			case DXGI_FORMAT_R8G8B8A8_SINT:
+			case DXGI_FORMAT_R16G16_TYPELESS:
+			case DXGI_FORMAT_R16G16_FLOAT:
+			case DXGI_FORMAT_R16G16_UNORM:
+			case DXGI_FORMAT_R16G16_UINT:
+			case DXGI_FORMAT_R16G16_SNORM:
+			case DXGI_FORMAT_R16G16_SINT:
+			case DXGI_FORMAT_R32_TYPELESS:
+			case DXGI_FORMAT_D32_FLOAT:
+			case DXGI_FORMAT_R32_FLOAT:
+			case DXGI_FORMAT_R32_UINT:
+			case DXGI_FORMAT_R32_SINT:
+			case DXGI_FORMAT_R24G8_TYPELESS:
+			case DXGI_FORMAT_D24_UNORM_S8_UINT:
+			case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+			case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8X8_UNORM:
+			case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+			case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+				return 4;
+
+			case DXGI_FORMAT_R8G8_TYPELESS:
+			case DXGI_FORMAT_R8G8_UNORM:
+			case DXGI_FORMAT_R8G8_UINT:
+			case DXGI_FORMAT_R8G8_SNORM:
+			case DXGI_FORMAT_R8G8_SINT:
+			case DXGI_FORMAT_R16_TYPELESS:
+			case DXGI_FORMAT_R16_FLOAT:
+			case DXGI_FORMAT_D16_UNORM:
+			case DXGI_FORMAT_R16_UNORM:
+			case DXGI_FORMAT_R16_UINT:
+			case DXGI_FORMAT_R16_SNORM:
+			case DXGI_FORMAT_R16_SINT:
+				return 2;
+
+			case DXGI_FORMAT_R8_TYPELESS:
+			case DXGI_FORMAT_R8_UNORM:
+			case DXGI_FORMAT_R8_UINT:
+			case DXGI_FORMAT_R8_SNORM:
+			case DXGI_FORMAT_R8_SINT:
+			case DXGI_FORMAT_A8_UNORM:
+				return 1;
+
+			default:
+				return 0; // 未対応のフォーマットの場合は0を返す
+			}
+		}
+
+		//DX10拡張ヘッダーの無い古いDDSのピクセルフォーマットを、DXGIのフォーマットに直す。分からなければUNKNOWN
+		DXGI_FORMAT GetLegacyFormat(const DDSPixelFormat& pixel_format)
+		{
+			if (pixel_format.flags & DDPF_FOURCC) {
+				switch (pixel_format.four_cc) {
+				case MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+				case MakeFourCC('D', 'X', 'T', '2'):
+				case MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+				case MakeFourCC('D', 'X', 'T', '4'):
+				case MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+				case MakeFourCC('A', 'T', 'I', '1'):
+				case MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+				case MakeFourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+				case MakeFourCC('A', 'T', 'I', '2'):
+				case MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+				case MakeFourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+				default: return DXGI_FORMAT_UNKNOWN;
+				}
+			}
+			if ((pixel_format.flags & DDPF_RGB) && pixel_format.rgb_bit_count == 32) {
+				uint32_t a_mask = (pixel_format.flags & DDPF_ALPHAPIXELS) ? pixel_format.a_mask : 0;
+				if (pixel_format.r_mask == 0x000000FF && pixel_format.g_mask == 0x0000FF00 && pixel_format.b_mask == 0x00FF0000 && a_mask == 0xFF000000)
+					return DXGI_FORMAT_R8G8B8A8_UNORM;
+				if (pixel_format.r_mask == 0x00FF0000 && pixel_format.g_mask == 0x0000FF00 && pixel_format.b_mask == 0x000000FF)
+					return a_mask == 0xFF000000 ? DXGI_FORMAT_B8G8R8A8_UNORM : a_mask == 0 ? DXGI_FORMAT_B8G8R8X8_UNORM : DXGI_FORMAT_UNKNOWN;
+			}
+			return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	DDSFile::~DDSFile()
+	{
+		Close();
+	}
+
+	HRESULT DDSFile::Open(const std::wstring& path)
+	{
+		Close();
+		//先頭から順に読むので、OSに先読みしてもらう
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+		LARGE_INTEGER file_size = {};
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+			Close();
+			return E_FAIL;
+		}
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+			Close();
+			return hr;
+		}
+		view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!view) {
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+			Close();
+			return hr;
+		}
+		view_size = static_cast<size_t>(file_size.QuadPart);
+
+		HRESULT hr = Parse(view, view_size, description, subresource_offsets);
+		if (FAILED(hr)) {
+			Close();
+			return hr;
+		}
+		return S_OK;
+	}
+
+	void DDSFile::Close()
+	{
+		if (view) {
+			UnmapViewOfFile(view);
+			view = nullptr;
+		}
+		if (mapping) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+		}
+		view_size = 0;
+		description = {};
+		subresource_offsets.clear();
+	}
+
+	D3D12_RESOURCE_DESC DDSFile::GetResourceDesc(D3D12_RESOURCE_FLAGS flags) const
+	{
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = description.dimension;
+		desc.Alignment = 0;
+		desc.Width = description.width;
+		desc.Height = description.height;
+		desc.DepthOrArraySize = description.depth_or_array_size;
+		desc.MipLevels = description.mip_levels;
+		desc.Format = description.format;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		desc.Flags = flags;
+		return desc;
+	}
+
+	HRESULT DDSFile::Parse(const uint8_t* data, size_t size, Description& out_description, std::vector<size_t>& out_subresource_offsets)
+	{
+		out_description = {};
+		out_subresource_offsets.clear();
+		if (!data || size < sizeof(uint32_t) + sizeof(DDSHeader)) {
+			return E_FAIL;
+		}
+		//マップしたビューはヘッダーの境界に揃っているとは限らないので、コピーしてから読む
+		uint32_t magic = 0;
+		std::memcpy(&magic, data, sizeof(magic));
+		DDSHeader header = {};
+		std::memcpy(&header, data + sizeof(magic), sizeof(header));
+		if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || header.pixel_format.size != sizeof(DDSPixelFormat)) {
+			return E_FAIL;
+		}
+		size_t offset = sizeof(magic) + sizeof(header);
+
+		Description description;
+		description.width = header.width;
+		description.height = header.height;
+		description.mip_levels = static_cast<UINT16>(std::max<uint32_t>(1, header.mip_map_count));
+		UINT64 depth = 1;
+		UINT64 array_size = 1;
+
+		if ((header.pixel_format.flags & DDPF_FOURCC) && header.pixel_format.four_cc == MakeFourCC('D', 'X', '1', '0')) {
+			if (size < offset + sizeof(DDSHeaderDX10)) {
+				return E_FAIL;
+			}
+			DDSHeaderDX10 header_dx10 = {};
+			std::memcpy(&header_dx10, data + offset, sizeof(header_dx10));
+			offset += sizeof(header_dx10);
+
+			description.format = static_cast<DXGI_FORMAT>(header_dx10.dxgi_format);
+			array_size = header_dx10.array_size;
+			//DDSの次元の値は、D3D12_RESOURCE_DIMENSIONと同じ(1D=2、2D=3、3D=4)
+			switch (header_dx10.resource_dimension) {
+			case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+				description.dimension = D3D12_RESOURCE_DIMENSION_TEXTURE1D;
+				description.height = 1;
+				break;
+			case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+				description.dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+				if (header_dx10.misc_flag & DDS_RESOURCE_MISC_TEXTURECUBE) {
+					array_size *= 6;
+					description.is_cubemap = true;
+				}
+				break;
+			case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+				if (!(header.flags & DDSD_DEPTH) || array_size != 1) {
+					return E_FAIL;
+				}
+				description.dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+				depth = header.depth;
+				break;
+			default:
+				return E_FAIL;
+			}
+		}
+		else {
+			description.format = GetLegacyFormat(header.pixel_format);
+			if (description.format == DXGI_FORMAT_UNKNOWN) {
+				return E_NOTIMPL;
+			}
+			if (header.caps2 & DDSCAPS2_VOLUME) {
+				description.dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+				depth = header.depth;
+			}
+			else {
+				description.dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+				if (header.caps2 & DDSCAPS2_CUBEMAP) {
+					//一部の面だけのキューブマップは、D3D12では作れない
+					if ((header.caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) {
+						return E_NOTIMPL;
+					}
+					array_size = 6;
+					description.is_cubemap = true;
+				}
+			}
+		}
+
+		UINT64 depth_or_array_size = description.dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? depth : array_size;
+		if (description.width == 0 || description.height == 0 || depth_or_array_size == 0 || depth_or_array_size > UINT16_MAX) {
+			return E_FAIL;
+		}
+		description.depth_or_array_size = static_cast<UINT16>(depth_or_array_size);
+
+		//ファイル内では、配列の要素毎にミップが大きい順に並んでいる(3Dテクスチャはミップ毎に奥行き分の面が並ぶ)
+		UINT64 item_count = description.dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : array_size;
+		out_subresource_offsets.reserve(static_cast<size_t>(item_count * description.mip_levels));
+		UINT64 position = offset;
+		for (UINT64 item = 0; item < item_count; item++) {
+			for (UINT mip = 0; mip < description.mip_levels; mip++) {
+				UINT64 width = std::max<UINT64>(1, description.width >> mip);
+				UINT height = std::max<UINT>(1, description.height >> mip);
+				UINT64 slices = description.dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? std::max<UINT64>(1, depth >> mip) : 1;
+				UINT64 row_size = 0;
+				UINT row_count = 0;
+				if (!GetSurfaceInfo(description.format, width, height, row_size, row_count)) {
+					out_subresource_offsets.clear();
+					return E_NOTIMPL;
+				}
+				out_subresource_offsets.push_back(static_cast<size_t>(position));
+				position += row_size * row_count * slices;
+				if (position > size) {
+					out_subresource_offsets.clear();
+					return E_FAIL;
+				}
+			}
+		}
+		out_description = description;
+		return S_OK;
+	}
+
+	bool DDSFile::GetSurfaceInfo(DXGI_FORMAT format, UINT64 width, UINT height, UINT64& out_row_size, UINT& out_row_count)
+	{
+		unsigned int block_size = GetBlockSize(format);
+		if (block_size != 0) {
+			out_row_size = std::max<UINT64>(1, (width + 3) / 4) * block_size;
+			out_row_count = std::max<UINT>(1, (height + 3) / 4);
+			return true;
+		}
+		unsigned int bytes_per_pixel = GetBytesPerPixel(format);
+		if (bytes_per_pixel == 0) {
+			return false;
+		}
+		out_row_size = width * bytes_per_pixel;
+		out_row_count = height;
+		return true;
+	}
+
+	HRESULT DDSFile::GetCopyableFootprints(const D3D12_RESOURCE_DESC& desc, UINT first_subresource, UINT subresource_count, UINT64 base_offset,
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT* out_layouts, UINT* out_row_counts, UINT64* out_row_sizes, UINT64* out_total_size)
+	{
+		bool is_3d = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+		UINT item_count = is_3d ? 1 : desc.DepthOrArraySize;
+		if (desc.MipLevels == 0 || first_subresource + subresource_count > desc.MipLevels * item_count) {
+			return E_INVALIDARG;
+		}
+		bool is_block_compressed = GetBlockSize(desc.Format) != 0;
+
+		UINT64 offset = 0;
+		UINT64 total_size = 0;
+		for (UINT i = 0; i < subresource_count; i++) {
+			UINT mip = (first_subresource + i) % desc.MipLevels;
+			UINT64 width = std::max<UINT64>(1, desc.Width >> mip);
+			UINT height = std::max<UINT>(1, desc.Height >> mip);
+			UINT depth = is_3d ? std::max<UINT>(1, desc.DepthOrArraySize >> mip) : 1;
+			UINT64 row_size = 0;
+			UINT row_count = 0;
+			if (!GetSurfaceInfo(desc.Format, width, height, row_size, row_count)) {
+				return E_NOTIMPL;
+			}
+			UINT64 row_pitch = AlignUp(row_size, PITCH_ALIGNMENT);
+
+			if (out_layouts) {
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = out_layouts[i];
+				layout.Offset = base_offset + offset;
+				layout.Footprint.Format = desc.Format;
+				//ブロック圧縮のフォーマットは、ブロック単位でしかコピーできないので4の倍数に切り上げる
+				layout.Footprint.Width = static_cast<UINT>(is_block_compressed ? AlignUp(width, 4) : width);
+				layout.Footprint.Height = is_block_compressed ? static_cast<UINT>(AlignUp(height, 4)) : height;
+				layout.Footprint.Depth = depth;
+				layout.Footprint.RowPitch = static_cast<UINT>(row_pitch);
+			}
+			if (out_row_counts) {
+				out_row_counts[i] = row_count;
+			}
+			if (out_row_sizes) {
+				out_row_sizes[i] = row_size;
+			}
+			//最後の行は、ピッチに揃えずに実際のバイト数だけ数える
+			total_size = offset + row_pitch * (static_cast<UINT64>(row_count) * depth - 1) + row_size;
+			offset = AlignUp(total_size, PLACEMENT_ALIGNMENT);
+		}
+		if (out_total_size) {
+			*out_total_size = total_size;
+		}
+		return S_OK;
+	}
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief DDSファイルをメモリマップして、中身を直接読むクラス
+	// @details ファイル全体をScratchImageなどに読み込まず、マップしたビューからアップロードバッファへ行単位で直接コピーするためのもの。
+	//			・ヘッダー(DX10拡張ヘッダーを含む)を解析し、リソースのdescと、ファイル内のサブリソース毎の位置を求める
+	//			・アップロードバッファ上の配置(GetCopyableFootprintsと同じもの)を、デバイス無しで計算できる
+	//			パックされたフォーマット(R8G8_B8G8など)や、ビット配置の分からない古い形式のDDSは未対応(E_NOTIMPLを返す)
+	//-------------------------------------------------------------
+	class DDSFile
+	{
+	public:
+		// @brief ヘッダーから読み取ったテクスチャの情報
+		struct Description {
+			DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+			D3D12_RESOURCE_DIMENSION dimension = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+			UINT64 width = 0;
+			UINT height = 0;
+			UINT16 depth_or_array_size = 0;	// 3Dなら奥行き、それ以外は配列の要素数(キューブマップは面の数を含む)
+			UINT16 mip_levels = 0;
+			bool is_cubemap = false;
+		};
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		const uint8_t* view = nullptr;
+		size_t view_size = 0;
+
+		Description description;
+		std::vector<size_t> subresource_offsets;	// サブリソース毎の、ビューの先頭からのオフセット(ミップ + 配列の要素 * ミップの数の順)
+
+	public:
+		DDSFile() = default;
+		~DDSFile();
+		DDSFile(const DDSFile&) = delete;
+		DDSFile& operator=(const DDSFile&) = delete;
+
+		//-------------------------------------------------------------
+		// @brief ファイルをメモリマップし、ヘッダーを解析する
+		// @return 成功したらS_OK。未対応のフォーマットならE_NOTIMPL
+		//-------------------------------------------------------------
+		HRESULT Open(const std::wstring& path);
+		void Close();
+
+		bool IsOpen() const { return view != nullptr; }
+		const Description& GetDescription() const { return description; }
+		// @brief D3D12_RESOURCE_DESCを作る(レイアウトはUNKNOWN)
+		D3D12_RESOURCE_DESC GetResourceDesc(D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE) const;
+		// @brief サブリソースの先頭。行は詰めて(1行のバイト数毎に)並んでいる
+		const uint8_t* GetSubresourceData(size_t subresource) const { return view + subresource_offsets[subresource]; }
+		size_t GetSubresourceCount() const { return subresource_offsets.size(); }
+
+		//-------------------------------------------------------------
+		// @brief メモリ上のDDSのヘッダーを解析し、サブリソース毎のオフセットを求める
+		// @details データがヘッダーに書かれた大きさより短い場合はE_FAIL
+		//-------------------------------------------------------------
+		static HRESULT Parse(const uint8_t* data, size_t size, Description& out_description, std::vector<size_t>& out_subresource_offsets);
+
+		//-------------------------------------------------------------
+		// @brief 1行のバイト数と行数を求める
+		// @details ブロック圧縮のフォーマットは、4x4のブロック1行分を1行として数える
+		// @return 未対応のフォーマットならfalse
+		//-------------------------------------------------------------
+		static bool GetSurfaceInfo(DXGI_FORMAT format, UINT64 width, UINT height, UINT64& out_row_size, UINT& out_row_count);
+
+		//-------------------------------------------------------------
+		// @brief ID3D12Device::GetCopyableFootprintsと同じ配置を、デバイス無しで計算する
+		// @details 行のピッチは256バイト、サブリソースの先頭は512バイト境界に揃える。
+		//			ブロック圧縮のフォーマットは、フットプリントの幅と高さを4の倍数に切り上げる
+		// @return 未対応のフォーマットならE_NOTIMPL
+		//-------------------------------------------------------------
+		static HRESULT GetCopyableFootprints(const D3D12_RESOURCE_DESC& desc, UINT first_subresource, UINT subresource_count, UINT64 base_offset,
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT* out_layouts, UINT* out_row_counts, UINT64* out_row_sizes, UINT64* out_total_size);
+	};
+}
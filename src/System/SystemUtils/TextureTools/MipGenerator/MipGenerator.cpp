@@ -0,0 +1,229 @@
+﻿#include "MipGenerator.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+#include <immintrin.h>
+#include <thread>
+#include <cmath>
+
+namespace System {
+
+	namespace {
+		//1スレッドに任せる最低のピクセル数。小さい段は他のスレッドを起こす方が遅い
+		constexpr size_t MIN_PIXELS_PER_THREAD = 16 * 1024;
+		//リニアからsRGBに戻す表の細かさ(リニアの値を、この数で量子化して表を引く)
+		constexpr size_t ENCODE_TABLE_SIZE = 65536;
+		constexpr float ENCODE_SCALE = static_cast<float>(ENCODE_TABLE_SIZE - 1);
+
+		//sRGBとリニアを変換する表。sRGBの値は256通りしか無いので、powを毎回計算せずに表を引く
+		struct SRGBTables {
+			float decode[256];						// sRGBの8bit値 → リニア(0～1)
+			uint8_t encode[ENCODE_TABLE_SIZE];		// リニアを量子化した値 → sRGBの8bit値
+
+			SRGBTables() {
+				for (int i = 0; i < 256; i++) {
+					double c = i / 255.0;
+					decode[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+				}
+				for (size_t i = 0; i < ENCODE_TABLE_SIZE; i++) {
+					double l = static_cast<double>(i) / (ENCODE_TABLE_SIZE - 1);
+					double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+					encode[i] = static_cast<uint8_t>(std::lround(std::clamp(c, 0.0, 1.0) * 255.0));
+				}
+			}
+		};
+		const SRGBTables& GetSRGBTables() {
+			static const SRGBTables tables;
+			return tables;
+		}
+
+		//4ピクセルのリニア値の合計を、平均してsRGBに戻す(SSE版と同じ順番・同じ式で計算して、結果を揃える)
+		uint8_t EncodeSum(const SRGBTables& tables, float sum) {
+			float scaled = sum * (ENCODE_SCALE * 0.25f) + 0.5f;
+			int index = static_cast<int>(std::min(std::max(scaled, 0.0f), ENCODE_SCALE));
+			return tables.encode[index];
+		}
+	}
+
+	MipGenerator::MipGenerator(unsigned int thread_count_)
+		:thread_count(thread_count_ != 0 ? thread_count_ : std::max(1u, std::thread::hardware_concurrency())),
+		workers(thread_count - 1, "MipGenerator")	// 呼び出したスレッドも帯を処理するので、作業スレッドは1つ少なくてよい
+	{
+	}
+
+	unsigned int MipGenerator::CalcMipCount(size_t width, size_t height)
+	{
+		size_t size = std::max(width, height);
+		unsigned int count = 1;
+		while (size > 1) {
+			size >>= 1;
+			count++;
+		}
+		return count;
+	}
+
+	bool MipGenerator::IsSupportedFormat(DXGI_FORMAT format)
+	{
+		switch (format) {
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void MipGenerator::DownsampleBand(const uint8_t* src, size_t src_width, size_t src_height, size_t src_row_pitch,
+		uint8_t* dst, size_t dst_width, size_t dst_row_pitch, size_t row_begin, size_t row_end, bool srgb) const
+	{
+		const SRGBTables& tables = GetSRGBTables();
+		for (size_t y = row_begin; y < row_end; y++) {
+			//高さが1の場合は、同じ行を2回使う
+			const uint8_t* row0 = src + (y * 2) * src_row_pitch;
+			const uint8_t* row1 = src + std::min(y * 2 + 1, src_height - 1) * src_row_pitch;
+			uint8_t* out = dst + y * dst_row_pitch;
+			size_t x = 0;
+
+			if (simd_enabled && !srgb) {
+				//元の4ピクセル(16バイト)×2行から、2ピクセル分を作る
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i round = _mm_set1_epi16(2);
+				for (; x + 2 <= dst_width && x * 2 + 4 <= src_width; x += 2) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+					//16bitに広げて縦に足す。lo = ピクセル0,1、hi = ピクセル2,3
+					__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+					//隣のピクセルと横に足す(下位64bitに、ピクセル0+1、2+3が入る)
+					lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+					hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+					__m128i sum = _mm_unpacklo_epi64(lo, hi);
+					__m128i average = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(average, zero));
+				}
+			}
+			else if (simd_enabled && srgb) {
+				//RGBは表でリニアに戻して4ピクセル分を一度に足す。アルファは整数のまま平均する
+				const __m128 scale = _mm_set1_ps(ENCODE_SCALE * 0.25f);
+				const __m128 half = _mm_set1_ps(0.5f);
+				const __m128 max_index = _mm_set1_ps(ENCODE_SCALE);
+				const __m128 zero = _mm_setzero_ps();
+				auto load_linear = [&tables](const uint8_t* p) {
+					return _mm_setr_ps(tables.decode[p[0]], tables.decode[p[1]], tables.decode[p[2]], 0.0f);
+					};
+				alignas(16) int32_t index[4];
+				for (; x < dst_width && x * 2 + 2 <= src_width; x++) {
+					const uint8_t* p00 = row0 + x * 8;
+					const uint8_t* p01 = p00 + 4;
+					const uint8_t* p10 = row1 + x * 8;
+					const uint8_t* p11 = p10 + 4;
+					__m128 sum = _mm_add_ps(_mm_add_ps(load_linear(p00), load_linear(p01)), _mm_add_ps(load_linear(p10), load_linear(p11)));
+					__m128 scaled = _mm_add_ps(_mm_mul_ps(sum, scale), half);
+					scaled = _mm_min_ps(_mm_max_ps(scaled, zero), max_index);
+					_mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(scaled));
+					uint8_t* o = out + x * 4;
+					o[0] = tables.encode[index[0]];
+					o[1] = tables.encode[index[1]];
+					o[2] = tables.encode[index[2]];
+					o[3] = static_cast<uint8_t>((p00[3] + p01[3] + p10[3] + p11[3] + 2) >> 2);
+				}
+			}
+
+			//SSEで処理しきれなかった残り(幅が1の場合は、同じ列を2回使う)
+			for (; x < dst_width; x++) {
+				const uint8_t* p00 = row0 + (x * 2) * 4;
+				const uint8_t* p01 = row0 + std::min(x * 2 + 1, src_width - 1) * 4;
+				const uint8_t* p10 = row1 + (x * 2) * 4;
+				const uint8_t* p11 = row1 + std::min(x * 2 + 1, src_width - 1) * 4;
+				uint8_t* o = out + x * 4;
+				for (int c = 0; c < 4; c++) {
+					if (srgb && c < 3) {
+						float sum = (tables.decode[p00[c]] + tables.decode[p01[c]]) + (tables.decode[p10[c]] + tables.decode[p11[c]]);
+						o[c] = EncodeSum(tables, sum);
+					}
+					else {
+						o[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2);
+					}
+				}
+			}
+		}
+	}
+
+	void MipGenerator::Downsample(const uint8_t* src, size_t src_width, size_t src_height, size_t src_row_pitch,
+		uint8_t* dst, size_t dst_row_pitch, bool srgb) const
+	{
+		if (!src || !dst || src_width == 0 || src_height == 0) return;
+		size_t dst_width = std::max<size_t>(1, src_width / 2);
+		size_t dst_height = std::max<size_t>(1, src_height / 2);
+
+		//行を帯に分けて、帯毎に別スレッドで処理する(帯同士は書き込み先が重ならない)
+		size_t band_count = std::min<size_t>(thread_count, std::max<size_t>(1, dst_width * dst_height / MIN_PIXELS_PER_THREAD));
+		band_count = std::min(band_count, dst_height);
+		workers.Run(static_cast<unsigned int>(band_count), [=, this](unsigned int band) {
+			size_t begin = dst_height * band / band_count;
+			size_t end = dst_height * (band + 1) / band_count;
+			DownsampleBand(src, src_width, src_height, src_row_pitch, dst, dst_width, dst_row_pitch, begin, end, srgb);
+			});
+	}
+
+	HRESULT MipGenerator::Generate(const DirectX::ScratchImage& source, DirectX::ScratchImage& out_mips) const
+	{
+		PROFILE_FUNCTION();
+		const DirectX::TexMetadata& metadata = source.GetMetadata();
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.width == 0 || metadata.height == 0) {
+			return E_INVALIDARG;
+		}
+		unsigned int mip_count = CalcMipCount(metadata.width, metadata.height);
+
+		//作り直すので、元のミップは0段目だけ使う
+		DirectX::TexMetadata base_metadata = metadata;
+		base_metadata.mipLevels = 1;
+		std::vector<DirectX::Image> base_images;
+		base_images.reserve(metadata.arraySize);
+		for (size_t item = 0; item < metadata.arraySize; item++) {
+			const DirectX::Image* image = source.GetImage(0, item, 0);
+			if (!image) {
+				return E_FAIL;
+			}
+			base_images.push_back(*image);
+		}
+
+		if (!IsSupportedFormat(metadata.format)) {
+			//自前で扱えないフォーマットは、DirectXTexで作る(sRGBのフォーマットならリニアで平均してくれる)
+			return DirectX::GenerateMipMaps(base_images.data(), base_images.size(), base_metadata,
+				DirectX::TEX_FILTER_BOX | DirectX::TEX_FILTER_FORCE_NON_WIC, mip_count, out_mips);
+		}
+
+		DirectX::TexMetadata mip_metadata = base_metadata;
+		mip_metadata.mipLevels = mip_count;
+		HRESULT hr = out_mips.Initialize(mip_metadata);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		bool srgb = DirectX::IsSRGB(metadata.format);
+		for (size_t item = 0; item < metadata.arraySize; item++) {
+			//0段目はそのままコピーする(行のピッチが違うこともあるので1行ずつ)
+			const DirectX::Image& base = base_images[item];
+			const DirectX::Image* top = out_mips.GetImage(0, item, 0);
+			if (!top) {
+				return E_FAIL;
+			}
+			size_t row_bytes = std::min(base.rowPitch, top->rowPitch);
+			for (size_t y = 0; y < base.height; y++)
+				std::memcpy(top->pixels + y * top->rowPitch, base.pixels + y * base.rowPitch, row_bytes);
+
+			for (unsigned int mip = 1; mip < mip_count; mip++) {
+				const DirectX::Image* src = out_mips.GetImage(mip - 1, item, 0);
+				const DirectX::Image* dst = out_mips.GetImage(mip, item, 0);
+				if (!src || !dst) {
+					return E_FAIL;
+				}
+				Downsample(src->pixels, src->width, src->height, src->rowPitch, dst->pixels, dst->rowPitch, srgb);
+			}
+		}
+		return S_OK;
+	}
+}
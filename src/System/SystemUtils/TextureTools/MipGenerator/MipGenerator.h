@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "System/SystemUtils/Thread/WorkerPool/WorkerPool.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief CPUでミップマップを作るクラス
+	// @details 1段上のミップの2x2ピクセルを平均して(ボックスフィルタ)、次の段を作る。
+	//			・8bitのRGBA/BGRAは、SSEで2ピクセルずつ処理する
+	//			・sRGBのフォーマットは、一度リニアに戻してから平均し、sRGBに戻す(そのまま平均すると暗くなるため)。アルファはリニアのまま平均する
+	//			・段毎に、行を帯に分けて別スレッドで処理する(次の段は前の段ができてからでないと作れないので、段の間は並列にしない)。
+	//			  スレッドは段をまたいで使い回すので、多くのテクスチャを作る時は同じインスタンスを使うこと
+	//			・幅か高さが奇数の場合、最後の列・行は使わない(1ピクセルの場合は同じピクセルを2回使う)
+	//			それ以外のフォーマットは、DirectXTexのGenerateMipMapsに任せる
+	//-------------------------------------------------------------
+	class MipGenerator
+	{
+	private:
+		unsigned int thread_count = 1;
+		bool simd_enabled = true;
+		mutable WorkerPool workers;	// 小さい段しか無ければ、スレッドは立てない
+
+		void DownsampleBand(const uint8_t* src, size_t src_width, size_t src_height, size_t src_row_pitch,
+			uint8_t* dst, size_t dst_width, size_t dst_row_pitch, size_t row_begin, size_t row_end, bool srgb) const;
+	public:
+		// @param [in] thread_count_ 1段の処理に使うスレッド数(0ならハードウェアスレッド数)
+		explicit MipGenerator(unsigned int thread_count_ = 0);
+
+		// @brief SSEを使うかどうか(結果の比較用。通常は有効のまま)
+		void SetSimdEnabled(bool enabled) { simd_enabled = enabled; }
+
+		// @brief 幅と高さから、1x1までのミップの段数を求める
+		static unsigned int CalcMipCount(size_t width, size_t height);
+		// @brief 自前のフィルタで処理できるフォーマットかどうか(8bitの4チャンネル)
+		static bool IsSupportedFormat(DXGI_FORMAT format);
+
+		//-------------------------------------------------------------
+		// @brief 1段分縮小する(1ピクセル4バイトの画像のみ)
+		// @param [in] src 縮小する画像
+		// @param [out] dst 縮小した画像の書き込み先。幅と高さはそれぞれsrcの半分(最低1)
+		// @param [in] srgb trueなら、リニアに戻してから平均する
+		//-------------------------------------------------------------
+		void Downsample(const uint8_t* src, size_t src_width, size_t src_height, size_t src_row_pitch,
+			uint8_t* dst, size_t dst_row_pitch, bool srgb) const;
+
+		//-------------------------------------------------------------
+		// @brief sourceのミップ0から、1x1までの全てのミップを作る
+		// @details sourceが既にミップを持っていても、ミップ0以外は使わずに作り直す。2Dテクスチャ(配列を含む)のみ対応
+		// @return 成功したらS_OK
+		//-------------------------------------------------------------
+		HRESULT Generate(const DirectX::ScratchImage& source, DirectX::ScratchImage& out_mips) const;
+	};
+}
@@ -0,0 +1,73 @@
+﻿#include "SubresourceCopier.h"
+
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace System {
+
+	void SubresourceCopier::CopyStreaming(void* dst, const void* src, size_t size)
+	{
+		uint8_t* out = static_cast<uint8_t*>(dst);
+		const uint8_t* in = static_cast<const uint8_t*>(src);
+
+		//非テンポラルストアは書き込み先が16バイト境界に揃っている必要があるので、そこまでは普通に書く
+		size_t head = std::min(size, (16 - (reinterpret_cast<uintptr_t>(out) & 15)) & 15);
+		std::memcpy(out, in, head);
+		out += head;
+		in += head;
+		size -= head;
+
+		//ライトコンバインのバッファ(64バイト)を埋めるように、4回ずつ書く
+		for (; size >= 64; size -= 64, in += 64, out += 64) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out), a);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), d);
+		}
+		for (; size >= 16; size -= 16, in += 16, out += 16)
+			_mm_stream_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+		std::memcpy(out, in, size);
+	}
+
+	void SubresourceCopier::Finish()
+	{
+		_mm_sfence();
+	}
+
+	void SubresourceCopier::CopySubresource(void* dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+		const void* src, size_t src_row_pitch, size_t src_slice_pitch,
+		size_t row_size, size_t row_count, size_t slice_count, bool simd)
+	{
+		if (!dst || !src || row_count == 0 || slice_count == 0) return;
+		//コピー元の1行より長くは読まない(コピー先の行のピッチは、256バイト境界に揃えた分だけ長い)
+		size_t copy_size = std::min(row_size, src_row_pitch);
+		//行が隙間無く並んでいれば、面全体を1回でコピーできる
+		bool contiguous = copy_size == src_row_pitch && copy_size == dst_row_pitch;
+
+		for (size_t slice = 0; slice < slice_count; slice++) {
+			uint8_t* dst_slice = static_cast<uint8_t*>(dst) + slice * dst_slice_pitch;
+			const uint8_t* src_slice = static_cast<const uint8_t*>(src) + slice * src_slice_pitch;
+			if (contiguous) {
+				if (simd)
+					CopyStreaming(dst_slice, src_slice, copy_size * row_count);
+				else
+					std::memcpy(dst_slice, src_slice, copy_size * row_count);
+				continue;
+			}
+			for (size_t row = 0; row < row_count; row++) {
+				if (simd)
+					CopyStreaming(dst_slice + row * dst_row_pitch, src_slice + row * src_row_pitch, copy_size);
+				else
+					std::memcpy(dst_slice + row * dst_row_pitch, src_slice + row * src_row_pitch, copy_size);
+			}
+		}
+		if (simd)
+			Finish();
+	}
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <cstddef>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief テクスチャのデータを、アップロードバッファの配置(行のピッチ・面のピッチ)に合わせてコピーするクラス
+	// @details アップロードバッファはCPUから見るとライトコンバインのメモリで、読むと非常に遅く、書き込みもまとめて行う方が速い。
+	//			そのため、16バイト毎のSSEの非テンポラルストア(キャッシュを通さない書き込み)で、64バイトずつ書き込む。
+	//			・行の長さはコピー元のピッチを超えて読まない(コピー元の最後の行の先を読まない)
+	//			・ブロック圧縮のフォーマットは、ブロック1行分を1行として渡す(行数・行のバイト数はフットプリントのものを使う)
+	//			・3Dテクスチャは奥行きの面毎に、配列は要素毎のサブリソースとして呼ぶ
+	//-------------------------------------------------------------
+	class SubresourceCopier
+	{
+	public:
+		//-------------------------------------------------------------
+		// @brief サブリソース1つ分を、行毎にコピーする
+		// @param [in] row_size 1行のバイト数(コピー元のピッチより長い場合は、コピー元のピッチまで)
+		// @param [in] row_count 1面あたりの行数
+		// @param [in] slice_count 面の数(3Dテクスチャの奥行き。それ以外は1)
+		// @param [in] simd falseなら、memcpyでコピーする(結果の比較用)
+		//-------------------------------------------------------------
+		static void CopySubresource(void* dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+			const void* src, size_t src_row_pitch, size_t src_slice_pitch,
+			size_t row_size, size_t row_count, size_t slice_count, bool simd = true);
+
+		//-------------------------------------------------------------
+		// @brief 連続した領域を、非テンポラルストアでコピーする
+		// @details 書き込み先の16バイト境界までと、16バイトに満たない残りはmemcpyで書く。
+		//			最後にsfenceを発行しないので、まとめてコピーした後にFinishを呼ぶこと
+		//-------------------------------------------------------------
+		static void CopyStreaming(void* dst, const void* src, size_t size);
+		// @brief 非テンポラルストアを、この後のGPUへの受け渡しより前に確定させる
+		static void Finish();
+	};
+}
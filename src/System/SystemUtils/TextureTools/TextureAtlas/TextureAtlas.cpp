@@ -0,0 +1,187 @@
+﻿#include "TextureAtlas.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/TextureTools/MipGenerator/MipGenerator.h"
+
+#include <algorithm>
+
+namespace System {
+
+	HRESULT TextureAtlas::Build(const std::vector<std::wstring>& paths, const TexturePacker::Settings& settings)
+	{
+		PROFILE_FUNCTION();
+		textures.clear();
+		entries.clear();
+
+		//全て読み込んでから、大きさとフォーマットで配置を決める
+		std::vector<DirectX::ScratchImage> sources(paths.size());
+		std::vector<TexturePacker::Item> items(paths.size());
+		for (size_t i = 0; i < paths.size(); i++) {
+			std::wstring extension = std::filesystem::path(paths[i]).extension().wstring();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+			HRESULT hr = extension == L".dds"
+				? DirectX::LoadFromDDSFile(paths[i].c_str(), DirectX::DDS_FLAGS_NONE, nullptr, sources[i])
+				: DirectX::LoadFromWICFile(paths[i].c_str(), DirectX::WIC_FLAGS_NONE, nullptr, sources[i]);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			const DirectX::TexMetadata& metadata = sources[i].GetMetadata();
+			//2Dで配列でないものだけをまとめる(大きさを0にしておけば、packerはまとめない)
+			if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 || metadata.IsCubemap()) {
+				continue;
+			}
+			TexturePacker::Item& item = items[i];
+			item.width = static_cast<uint32_t>(metadata.width);
+			item.height = static_cast<uint32_t>(metadata.height);
+			item.format = static_cast<uint32_t>(metadata.format);
+			item.block_size = DirectX::IsCompressed(metadata.format) ? 4 : 1;
+			item.mip_levels = static_cast<uint32_t>(metadata.mipLevels);
+		}
+		packer.Pack(items, settings);
+		const std::vector<TexturePacker::Placement>& placements = packer.GetPlacements();
+		const std::vector<TexturePacker::Bin>& bins = packer.GetBins();
+
+		//ビンのミップの段数に足りないものは、元のテクスチャ毎にミップを作っておく(まとめてから作ると、余白越しに隣と混ざる)
+		//まとめないものも、LoadFromFileと同じようにミップを作る(作業スレッドを使い回すため、MipGeneratorは1つにする)
+		MipGenerator mip_generator;
+		for (size_t i = 0; i < sources.size(); i++) {
+			const DirectX::TexMetadata& metadata = sources[i].GetMetadata();
+			size_t needed = placements[i].bin != TexturePacker::INVALID_INDEX ? bins[placements[i].bin].mip_levels : MipGenerator::CalcMipCount(metadata.width, metadata.height);
+			if (metadata.mipLevels >= needed || metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || DirectX::IsCompressed(metadata.format)) {
+				continue;
+			}
+			DirectX::ScratchImage mip_chain;
+			HRESULT hr = mip_generator.Generate(sources[i], mip_chain);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			sources[i] = std::move(mip_chain);
+		}
+
+		for (uint32_t bin = 0; bin < bins.size(); bin++) {
+			DirectX::ScratchImage image;
+			HRESULT hr = ComposeBin(packer, bin, sources, image);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			ComPtr<ID3D12Resource> resource;
+			hr = Texture::Loader::CreateResourceFromImage(image, D3D12_RESOURCE_FLAG_NONE, resource);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			//要素が1つでも、シェーダーからは配列として読めるようにする
+			D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+			srv_desc.Format = static_cast<DXGI_FORMAT>(bins[bin].format);
+			srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+			srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srv_desc.Texture2DArray.MostDetailedMip = 0;
+			srv_desc.Texture2DArray.MipLevels = bins[bin].mip_levels;
+			srv_desc.Texture2DArray.FirstArraySlice = 0;
+			srv_desc.Texture2DArray.ArraySize = bins[bin].layer_count;
+			std::unique_ptr<Texture> texture = Texture::Loader::CreateFromResource(resource, D3D12_RESOURCE_FLAG_NONE, &srv_desc);
+			if (!texture || !texture->IsValid()) {
+				return E_FAIL;
+			}
+			textures.push_back(std::move(texture));
+		}
+
+		entries.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); i++) {
+			Entry& entry = entries[i];
+			if (placements[i].bin != TexturePacker::INVALID_INDEX) {
+				entry.texture = textures[placements[i].bin].get();
+				entry.array_index = placements[i].layer;
+				entry.uv = packer.GetUVTransform(static_cast<uint32_t>(i));
+				entry.is_packed = true;
+				continue;
+			}
+			ComPtr<ID3D12Resource> resource;
+			HRESULT hr = Texture::Loader::CreateResourceFromImage(sources[i], D3D12_RESOURCE_FLAG_NONE, resource);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			std::unique_ptr<Texture> texture = Texture::Loader::CreateFromResource(resource);
+			if (!texture || !texture->IsValid()) {
+				return E_FAIL;
+			}
+			entry.texture = texture.get();
+			textures.push_back(std::move(texture));
+		}
+		return S_OK;
+	}
+
+	HRESULT TextureAtlas::ComposeBin(const TexturePacker& packer, uint32_t bin_index, const std::vector<DirectX::ScratchImage>& sources, DirectX::ScratchImage& out_image)
+	{
+		PROFILE_FUNCTION();
+		if (bin_index >= packer.GetBins().size()) {
+			return E_INVALIDARG;
+		}
+		const TexturePacker::Bin& bin = packer.GetBins()[bin_index];
+		DirectX::TexMetadata metadata = {};
+		metadata.width = bin.width;
+		metadata.height = bin.height;
+		metadata.depth = 1;
+		metadata.arraySize = bin.layer_count;
+		metadata.mipLevels = bin.mip_levels;
+		metadata.format = static_cast<DXGI_FORMAT>(bin.format);
+		metadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+		HRESULT hr = out_image.Initialize(metadata);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		//どのテクスチャも置かれていない所は、黒(0)にしておく
+		std::memset(out_image.GetPixels(), 0, out_image.GetPixelsSize());
+
+		size_t texel_size = DirectX::BitsPerPixel(metadata.format) / 8;
+		if (bin.type == TexturePacker::BinType::Atlas && (texel_size == 0 || DirectX::BitsPerPixel(metadata.format) % 8 != 0)) {
+			return E_NOTIMPL;
+		}
+
+		const std::vector<TexturePacker::Placement>& placements = packer.GetPlacements();
+		for (size_t i = 0; i < placements.size() && i < sources.size(); i++) {
+			const TexturePacker::Placement& placement = placements[i];
+			if (placement.bin != bin_index) continue;
+			const DirectX::TexMetadata& source_metadata = sources[i].GetMetadata();
+			if (source_metadata.format != metadata.format || (bin.type == TexturePacker::BinType::Array && source_metadata.mipLevels < bin.mip_levels)) {
+				return E_INVALIDARG;
+			}
+			for (size_t mip = 0; mip < bin.mip_levels; mip++) {
+				//アトラスのミップより先に1x1になる小さいものは、1x1のミップを使い続ける
+				size_t source_mip = std::min(mip, source_metadata.mipLevels - 1);
+				const DirectX::Image* src = sources[i].GetImage(source_mip, 0, 0);
+				const DirectX::Image* dst = out_image.GetImage(mip, placement.layer, 0);
+				if (!src || !dst) {
+					return E_FAIL;
+				}
+				//配列の要素は同じ大きさ・フォーマットなので、そのままコピーする(ブロック圧縮もそのまま)
+				if (bin.type == TexturePacker::BinType::Array) {
+					std::memcpy(dst->pixels, src->pixels, std::min(src->slicePitch, dst->slicePitch));
+					continue;
+				}
+
+				//アトラスは、このミップでの余白を含めた領域を埋める。中身の外は、一番近い端のテクセルを使う
+				size_t content_x = placement.x >> mip;
+				size_t content_y = placement.y >> mip;
+				size_t frame_x0 = placement.frame_x >> mip;
+				size_t frame_y0 = placement.frame_y >> mip;
+				size_t frame_x1 = std::min(dst->width, static_cast<size_t>((placement.frame_x + placement.frame_width) >> mip));
+				size_t frame_y1 = std::min(dst->height, static_cast<size_t>((placement.frame_y + placement.frame_height) >> mip));
+				size_t content_width = std::min(src->width, frame_x1 - content_x);
+				for (size_t y = frame_y0; y < frame_y1; y++) {
+					size_t src_y = std::min(y < content_y ? 0 : y - content_y, src->height - 1);
+					const uint8_t* src_row = src->pixels + src_y * src->rowPitch;
+					uint8_t* dst_row = dst->pixels + y * dst->rowPitch;
+					for (size_t x = frame_x0; x < content_x; x++) {
+						std::memcpy(dst_row + x * texel_size, src_row, texel_size);
+					}
+					std::memcpy(dst_row + content_x * texel_size, src_row, content_width * texel_size);
+					const uint8_t* last_texel = src_row + (src->width - 1) * texel_size;
+					for (size_t x = content_x + content_width; x < frame_x1; x++) {
+						std::memcpy(dst_row + x * texel_size, last_texel, texel_size);
+					}
+				}
+			}
+		}
+		return S_OK;
+	}
+}
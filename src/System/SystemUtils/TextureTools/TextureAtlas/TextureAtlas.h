@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "System/SystemUtils/TextureTools/TexturePacker/TexturePacker.h"
+
+namespace System {
+	class Texture;
+
+	//-------------------------------------------------------------
+	// @brief 小さいテクスチャを読み込み、TexturePackerの配置に従ってTexture2DArrayにまとめるクラス
+	// @details ・まとめたビンは、要素が1つでもTexture2DArrayのSRVで作る(シェーダーは配列として読む)
+	//			・アトラスの余白は、ミップ毎に中身の端のテクセルで埋める(ミップは元のテクスチャ毎に作ったものを並べる)
+	//			・まとめられなかったもの(大きい・ブロック圧縮で大きさが揃わない・2D以外)は、今まで通り1つずつテクスチャにする
+	//			マテリアルからは、Entryのテクスチャ(SRVの番号)・配列の要素・UVの変換で参照する
+	//-------------------------------------------------------------
+	class TextureAtlas
+	{
+	public:
+		// @brief 読み込んだテクスチャ1つ分の参照先
+		struct Entry {
+			Texture* texture = nullptr;			// まとめた先のテクスチャ(まとめなかったものは単独のテクスチャ)
+			uint32_t array_index = 0;			// 配列の要素の番号
+			TexturePacker::UVTransform uv;		// 元のUVを、まとめた先のUVに直す変換
+			bool is_packed = false;				// falseならTexture2Dのまま
+		};
+
+	private:
+		TexturePacker packer;
+		std::vector<std::unique_ptr<Texture>> textures;	// ビン毎のテクスチャの後に、まとめなかったものが並ぶ
+		std::vector<Entry> entries;
+
+	public:
+		//-------------------------------------------------------------
+		// @brief テクスチャを読み込んでまとめ、GPUに転送する(前の結果は捨てる)
+		// @details 転送の完了まで待つ。ビューを作るので、メインスレッドで呼ぶこと
+		// @return 成功したらS_OK。1つでも読めなければ、その結果を返す
+		//-------------------------------------------------------------
+		HRESULT Build(const std::vector<std::wstring>& paths, const TexturePacker::Settings& settings = {});
+
+		//-------------------------------------------------------------
+		// @brief 1つのビンの画像を作る(全ての要素・ミップ)
+		// @param [in] sources 元の画像(packerに渡した順)。ビンのミップの段数だけミップを持っていること
+		// @return 成功したらS_OK
+		//-------------------------------------------------------------
+		static HRESULT ComposeBin(const TexturePacker& packer, uint32_t bin, const std::vector<DirectX::ScratchImage>& sources, DirectX::ScratchImage& out_image);
+
+		const Entry& GetEntry(size_t index) const { return entries[index]; }
+		size_t GetEntryCount() const { return entries.size(); }
+		// @brief 作ったテクスチャ(リソースとSRV)の数
+		size_t GetTextureCount() const { return textures.size(); }
+		const TexturePacker& GetPacker() const { return packer; }
+	};
+}
@@ -0,0 +1,190 @@
+﻿#include "TextureCooker.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+namespace System {
+
+	namespace {
+		//BCのフォーマットを、BlockCompressorの形式に直す。BC以外ならfalse
+		bool ToBlockFormat(DXGI_FORMAT format, BlockCompressor::Format& out_format)
+		{
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+				out_format = BlockCompressor::Format::BC1;
+				return true;
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+				out_format = BlockCompressor::Format::BC3;
+				return true;
+			case DXGI_FORMAT_BC4_UNORM:
+				out_format = BlockCompressor::Format::BC4;
+				return true;
+			case DXGI_FORMAT_BC5_UNORM:
+				out_format = BlockCompressor::Format::BC5;
+				return true;
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				out_format = BlockCompressor::Format::BC7;
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	TextureCooker::TextureCooker(unsigned int thread_count_)
+		:compressor(thread_count_), mip_generator(thread_count_)
+	{
+	}
+
+	DXGI_FORMAT TextureCooker::GetCookedFormat(Usage usage, bool srgb)
+	{
+		switch (usage) {
+		case Usage::Albedo:
+			return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		case Usage::AlbedoCompact:
+			return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case Usage::Normal:
+			return DXGI_FORMAT_BC5_UNORM;
+		case Usage::Mask:
+			return DXGI_FORMAT_BC4_UNORM;
+		default:
+			return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	HRESULT TextureCooker::Cook(const uint8_t* rgba, size_t width, size_t height, size_t row_pitch, DXGI_FORMAT format, CookedTexture& out_cooked) const
+	{
+		PROFILE_FUNCTION();
+		BlockCompressor::Format block_format;
+		if (!rgba || width == 0 || height == 0 || !ToBlockFormat(format, block_format)) {
+			return E_INVALIDARG;
+		}
+
+		//ミップ0を4の倍数に揃える。はみ出した分は端のピクセルで埋める
+		size_t padded_width = (width + BlockCompressor::BLOCK_WIDTH - 1) / BlockCompressor::BLOCK_WIDTH * BlockCompressor::BLOCK_WIDTH;
+		size_t padded_height = (height + BlockCompressor::BLOCK_HEIGHT - 1) / BlockCompressor::BLOCK_HEIGHT * BlockCompressor::BLOCK_HEIGHT;
+		std::vector<uint8_t> level(padded_width * padded_height * 4);
+		for (size_t y = 0; y < padded_height; y++) {
+			const uint8_t* src_row = rgba + std::min(y, height - 1) * row_pitch;
+			uint8_t* dst_row = level.data() + y * padded_width * 4;
+			std::memcpy(dst_row, src_row, width * 4);
+			for (size_t x = width; x < padded_width; x++)
+				std::memcpy(dst_row + x * 4, src_row + (width - 1) * 4, 4);
+		}
+
+		unsigned int mip_count = MipGenerator::CalcMipCount(padded_width, padded_height);
+		bool srgb = DirectX::IsSRGB(format);
+		out_cooked = {};
+		out_cooked.format = format;
+		out_cooked.width = padded_width;
+		out_cooked.height = padded_height;
+		out_cooked.mips.resize(mip_count);
+
+		//1段ずつ、圧縮してから次の段を作る(縮小は圧縮前の画像から行う)
+		size_t level_width = padded_width;
+		size_t level_height = padded_height;
+		std::vector<uint8_t> next_level;
+		for (unsigned int mip = 0; mip < mip_count; mip++) {
+			size_t block_row_pitch = BlockCompressor::GetRowPitch(block_format, level_width);
+			std::vector<uint8_t>& blocks = out_cooked.mips[mip];
+			blocks.resize(block_row_pitch * BlockCompressor::GetRowCount(level_height));
+			compressor.Compress(block_format, level.data(), level_width, level_height, level_width * 4, blocks.data(), block_row_pitch);
+
+			if (mip == 0) {
+				//品質の目安として、元の画像の範囲だけを比べる
+				std::vector<uint8_t> decoded(level.size());
+				BlockCompressor::Decompress(block_format, blocks.data(), level_width, level_height, block_row_pitch, decoded.data(), level_width * 4);
+				out_cooked.psnr = BlockCompressor::ComputePSNR(block_format, level.data(), level_width * 4, decoded.data(), level_width * 4, width, height);
+			}
+
+			if (mip + 1 < mip_count) {
+				size_t next_width = std::max<size_t>(1, level_width / 2);
+				size_t next_height = std::max<size_t>(1, level_height / 2);
+				next_level.resize(next_width * next_height * 4);
+				mip_generator.Downsample(level.data(), level_width, level_height, level_width * 4, next_level.data(), next_width * 4, srgb);
+				level.swap(next_level);
+				level_width = next_width;
+				level_height = next_height;
+			}
+		}
+		return S_OK;
+	}
+
+	HRESULT TextureCooker::SaveToDDS(const std::wstring& path, const CookedTexture& cooked)
+	{
+		if (path.empty() || cooked.mips.empty()) {
+			return E_INVALIDARG;
+		}
+		DirectX::ScratchImage scratch;
+		HRESULT hr = scratch.Initialize2D(cooked.format, cooked.width, cooked.height, 1, cooked.mips.size());
+		if (FAILED(hr)) {
+			return hr;
+		}
+		for (size_t mip = 0; mip < cooked.mips.size(); mip++) {
+			const DirectX::Image* image = scratch.GetImage(mip, 0, 0);
+			if (!image) {
+				return E_FAIL;
+			}
+			//ブロックの行毎にコピーする(DirectXTex側の行のピッチが詰めたものと違っても良いように)
+			size_t row_count = BlockCompressor::GetRowCount(image->height);
+			size_t row_bytes = cooked.mips[mip].size() / row_count;
+			if (row_bytes > image->rowPitch) {
+				return E_FAIL;
+			}
+			for (size_t row = 0; row < row_count; row++)
+				std::memcpy(image->pixels + row * image->rowPitch, cooked.mips[mip].data() + row * row_bytes, row_bytes);
+		}
+		return DirectX::SaveToDDSFile(scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), DirectX::DDS_FLAGS_NONE, path.c_str());
+	}
+
+	HRESULT TextureCooker::CookFile(const std::wstring& src_path, const std::wstring& dst_path, Usage usage, double* out_psnr) const
+	{
+		PROFILE_FUNCTION();
+		if (src_path.empty() || dst_path.empty() || !std::filesystem::exists(src_path)) {
+			return E_INVALIDARG;
+		}
+		DirectX::TexMetadata metadata = {};
+		DirectX::ScratchImage source;
+		HRESULT hr = DirectX::LoadFromWICFile(src_path.c_str(), DirectX::WIC_FLAGS_NONE, &metadata, source);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		const DirectX::Image* image = source.GetImage(0, 0, 0);
+		if (!image) {
+			return E_FAIL;
+		}
+
+		//グレースケールのJPG(R8)やBGRAの画像もあるので、sRGBかどうかはそのままでRGBA8に揃える
+		bool srgb = DirectX::IsSRGB(metadata.format);
+		DXGI_FORMAT rgba_format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		DirectX::ScratchImage converted;
+		if (metadata.format != rgba_format) {
+			hr = DirectX::Convert(*image, rgba_format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			image = converted.GetImage(0, 0, 0);
+			if (!image) {
+				return E_FAIL;
+			}
+		}
+
+		CookedTexture cooked;
+		hr = Cook(image->pixels, image->width, image->height, image->rowPitch, GetCookedFormat(usage, srgb), cooked);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		//書き出し先のフォルダが無ければ作る
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(dst_path).parent_path(), error);
+		hr = SaveToDDS(dst_path, cooked);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		if (out_psnr) {
+			*out_psnr = cooked.psnr;
+		}
+		return S_OK;
+	}
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "System/SystemUtils/TextureTools/BlockCompressor/BlockCompressor.h"
+#include "System/SystemUtils/TextureTools/MipGenerator/MipGenerator.h"
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 画像ファイルを、ブロック圧縮とミップを済ませたDDSに変換(クック)するクラス
+	// @details 実行時にミップを作ったり圧縮したりせず、Texture::Loader::LoadFromFileでそのまま転送できる形にしておく。
+	//			・用途毎に形式を決める(カラーはBC7かBC1、法線はBC5、ラフネスやメタリックはBC4)
+	//			・BCのミップ0は幅と高さが4の倍数でなければならないので、足りない分は端のピクセルで埋めてから圧縮する
+	//			・ミップはMipGenerator、圧縮はBlockCompressorで作り、ミップ0のPSNRを品質の目安として残す
+	//-------------------------------------------------------------
+	class TextureCooker
+	{
+	public:
+		enum class Usage {
+			Albedo,			// BC7。カラー(アルファ付き)
+			AlbedoCompact,	// BC1。カラー(不透明)。BC7の半分のサイズ
+			Normal,			// BC5。法線マップのXYだけを持ち、Zはシェーダーで復元する
+			Mask,			// BC4。ラフネスやメタリックなど、Rだけを使うもの
+		};
+
+		// @brief クックした結果。ミップ毎に、ブロックの行を詰めて並べたもの
+		struct CookedTexture {
+			DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+			size_t width = 0;		// ミップ0の幅(4の倍数に揃えた後)
+			size_t height = 0;		// ミップ0の高さ(4の倍数に揃えた後)
+			std::vector<std::vector<uint8_t>> mips;
+			double psnr = 0.0;		// ミップ0を戻した時の、元の画像とのPSNR(dB)
+		};
+
+	private:
+		BlockCompressor compressor;
+		MipGenerator mip_generator;
+
+	public:
+		// @param [in] thread_count_ ミップ作成と圧縮に使うスレッド数(0ならハードウェアスレッド数)
+		explicit TextureCooker(unsigned int thread_count_ = 0);
+
+		// @brief 用途から、クックした後のフォーマットを決める(srgbはカラーの用途だけ使う)
+		static DXGI_FORMAT GetCookedFormat(Usage usage, bool srgb);
+
+		//-------------------------------------------------------------
+		// @brief RGBA8の画像を、ミップ付きのBC形式にする
+		// @param [in] format 出力するBCのフォーマット(BC1/BC3/BC4/BC5/BC7)。sRGBなら、ミップはリニアで平均して作る
+		// @return 成功したらS_OK
+		//-------------------------------------------------------------
+		HRESULT Cook(const uint8_t* rgba, size_t width, size_t height, size_t row_pitch, DXGI_FORMAT format, CookedTexture& out_cooked) const;
+
+		// @brief クックした結果を、DDSファイルに書き出す
+		static HRESULT SaveToDDS(const std::wstring& path, const CookedTexture& cooked);
+
+		//-------------------------------------------------------------
+		// @brief 画像ファイルを読み込んでクックし、DDSに書き出す
+		// @details カラーの用途は、元の画像がsRGBならsRGBのフォーマットにする(LoadFromFileで読んだ時と見た目を揃える)
+		// @param [out] out_psnr nullptrでなければ、ミップ0のPSNRを書き込む
+		// @return 成功したらS_OK
+		//-------------------------------------------------------------
+		HRESULT CookFile(const std::wstring& src_path, const std::wstring& dst_path, Usage usage, double* out_psnr = nullptr) const;
+	};
+}
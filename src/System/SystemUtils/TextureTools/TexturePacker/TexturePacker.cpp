@@ -0,0 +1,272 @@
+﻿#include "TexturePacker.h"
+
+#include <algorithm>
+#include <map>
+
+namespace System {
+
+	namespace {
+		uint32_t CalcFullMipCount(uint32_t width, uint32_t height)
+		{
+			uint32_t size = std::max(width, height);
+			uint32_t count = 1;
+			while (size > 1) {
+				size >>= 1;
+				count++;
+			}
+			return count;
+		}
+		uint32_t DivideRoundUp(uint32_t value, uint32_t divisor)
+		{
+			return (value + divisor - 1) / divisor;
+		}
+	}
+
+	uint32_t TexturePacker::Pack(const std::vector<Item>& items, const Settings& settings)
+	{
+		bins.clear();
+		placements.assign(items.size(), Placement());
+
+		//フォーマット(とブロックの大きさ)毎に分ける。結果が毎回同じになるように、元の順番を保つ
+		std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> groups;
+		for (uint32_t i = 0; i < items.size(); i++) {
+			const Item& item = items[i];
+			if (item.width == 0 || item.height == 0 || item.block_size == 0) continue;
+			groups[{ item.format, item.block_size }].push_back(i);
+		}
+		for (auto& [key, group] : groups) {
+			std::vector<uint32_t> rest;
+			if (settings.allow_arrays) {
+				PackArrays(items, group, settings, rest);
+			}
+			else {
+				rest = group;
+			}
+			if (settings.allow_atlases) {
+				PackAtlases(items, rest, settings);
+			}
+		}
+
+		uint32_t packed = 0;
+		for (const Placement& placement : placements) {
+			if (placement.bin != INVALID_INDEX) packed++;
+		}
+		return packed;
+	}
+
+	void TexturePacker::PackArrays(const std::vector<Item>& items, const std::vector<uint32_t>& group, const Settings& settings, std::vector<uint32_t>& out_rest)
+	{
+		//同じ大きさのもの毎に分ける
+		std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> sizes;
+		for (uint32_t i : group) {
+			sizes[{ items[i].width, items[i].height }].push_back(i);
+		}
+		for (auto& [size, members] : sizes) {
+			//1つだけなら配列にしても減らないので、アトラスに回す
+			if (members.size() < 2) {
+				out_rest.insert(out_rest.end(), members.begin(), members.end());
+				continue;
+			}
+			const Item& first = items[members.front()];
+			//非圧縮のものは足りないミップを作れるので、最後まで持たせる。圧縮のものは、全員が持っている段数まで
+			uint32_t mip_levels = CalcFullMipCount(first.width, first.height);
+			if (first.block_size > 1) {
+				for (uint32_t i : members)
+					mip_levels = std::min(mip_levels, std::max(1u, items[i].mip_levels));
+			}
+			uint32_t max_layers = std::max(1u, settings.max_layers);
+			for (size_t begin = 0; begin < members.size(); begin += max_layers) {
+				size_t end = std::min(members.size(), begin + max_layers);
+				Bin bin;
+				bin.type = BinType::Array;
+				bin.format = first.format;
+				bin.block_size = first.block_size;
+				bin.width = first.width;
+				bin.height = first.height;
+				bin.mip_levels = mip_levels;
+				uint32_t bin_index = static_cast<uint32_t>(bins.size());
+				for (size_t m = begin; m < end; m++) {
+					Placement& placement = placements[members[m]];
+					placement.bin = bin_index;
+					placement.layer = bin.layer_count++;
+					placement.width = placement.frame_width = first.width;
+					placement.height = placement.frame_height = first.height;
+					bin.used_texels += static_cast<uint64_t>(first.width) * first.height;
+				}
+				bins.push_back(bin);
+			}
+		}
+	}
+
+	void TexturePacker::PackAtlases(const std::vector<Item>& items, const std::vector<uint32_t>& group, const Settings& settings)
+	{
+		if (group.empty()) return;
+		//余白を端のテクセルで埋められない(ブロック単位になる)ので、アトラスに詰めるのは非圧縮のものだけ
+		if (items[group.front()].block_size != 1) return;
+
+		uint32_t mip_levels = std::max(1u, settings.mip_levels);
+		uint32_t cell = GetCellSize(1, mip_levels);
+		uint32_t layer_cells = settings.layer_size / cell;
+		//1セルは最も小さいミップで1テクセルになるので、余白はpaddingセル取ればよい
+		uint32_t padding_cells = settings.padding;
+		if (layer_cells == 0) return;
+
+		//大きいものから置く(長い辺、面積の順)。同じなら元の順番
+		std::vector<uint32_t> order;
+		for (uint32_t i : group) {
+			const Item& item = items[i];
+			if (std::max(item.width, item.height) > settings.max_item_size) continue;
+			order.push_back(i);
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			uint32_t long_a = std::max(items[a].width, items[a].height);
+			uint32_t long_b = std::max(items[b].width, items[b].height);
+			if (long_a != long_b) return long_a > long_b;
+			return static_cast<uint64_t>(items[a].width) * items[a].height > static_cast<uint64_t>(items[b].width) * items[b].height;
+			});
+
+		std::vector<std::vector<Rect>> layers;
+		Bin bin;
+		bin.type = BinType::Atlas;
+		bin.format = items[group.front()].format;
+		bin.block_size = 1;
+		bin.mip_levels = mip_levels;
+		uint32_t bin_index = static_cast<uint32_t>(bins.size());
+		uint32_t used_width_cells = 0;
+		uint32_t used_height_cells = 0;
+
+		for (uint32_t i : order) {
+			const Item& item = items[i];
+			uint32_t w = DivideRoundUp(item.width, cell) + padding_cells * 2;
+			uint32_t h = DivideRoundUp(item.height, cell) + padding_cells * 2;
+			if (w > layer_cells || h > layer_cells) continue;
+
+			//前の要素から順に、入る所を探す。どこにも入らなければ要素を増やす
+			Rect rect;
+			uint32_t layer = 0;
+			bool found = false;
+			for (; layer < layers.size(); layer++) {
+				if (FindPosition(layers[layer], w, h, rect)) {
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				if (layers.size() >= std::max(1u, settings.max_layers)) continue;
+				layers.push_back({ Rect{ 0, 0, layer_cells, layer_cells } });
+				layer = static_cast<uint32_t>(layers.size() - 1);
+				FindPosition(layers[layer], w, h, rect);
+			}
+			SplitFreeRects(layers[layer], rect);
+			used_width_cells = std::max(used_width_cells, rect.x + rect.w);
+			used_height_cells = std::max(used_height_cells, rect.y + rect.h);
+
+			Placement& placement = placements[i];
+			placement.bin = bin_index;
+			placement.layer = layer;
+			placement.frame_x = rect.x * cell;
+			placement.frame_y = rect.y * cell;
+			placement.frame_width = rect.w * cell;
+			placement.frame_height = rect.h * cell;
+			placement.x = (rect.x + padding_cells) * cell;
+			placement.y = (rect.y + padding_cells) * cell;
+			placement.width = item.width;
+			placement.height = item.height;
+			bin.used_texels += static_cast<uint64_t>(item.width) * item.height;
+		}
+		if (layers.empty()) return;
+
+		//要素は全て同じ大きさなので、使った範囲が収まる2の累乗(セルの倍数)まで縮める
+		uint32_t width = cell;
+		while (width < used_width_cells * cell) width <<= 1;
+		uint32_t height = cell;
+		while (height < used_height_cells * cell) height <<= 1;
+		bin.width = std::min(width, layer_cells * cell);
+		bin.height = std::min(height, layer_cells * cell);
+		bin.layer_count = static_cast<uint32_t>(layers.size());
+		bins.push_back(bin);
+	}
+
+	bool TexturePacker::FindPosition(const std::vector<Rect>& free_rects, uint32_t w, uint32_t h, Rect& out_rect)
+	{
+		bool found = false;
+		uint32_t best_short = 0xffffffff;
+		uint32_t best_long = 0xffffffff;
+		for (const Rect& free_rect : free_rects) {
+			if (free_rect.w < w || free_rect.h < h) continue;
+			uint32_t leftover_w = free_rect.w - w;
+			uint32_t leftover_h = free_rect.h - h;
+			uint32_t short_side = std::min(leftover_w, leftover_h);
+			uint32_t long_side = std::max(leftover_w, leftover_h);
+			if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+				best_short = short_side;
+				best_long = long_side;
+				out_rect = { free_rect.x, free_rect.y, w, h };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	void TexturePacker::SplitFreeRects(std::vector<Rect>& free_rects, const Rect& used)
+	{
+		std::vector<Rect> result;
+		result.reserve(free_rects.size() + 4);
+		for (const Rect& free_rect : free_rects) {
+			//重ならないものはそのまま残す
+			if (used.x >= free_rect.x + free_rect.w || used.x + used.w <= free_rect.x ||
+				used.y >= free_rect.y + free_rect.h || used.y + used.h <= free_rect.y) {
+				result.push_back(free_rect);
+				continue;
+			}
+			//重なったものは、usedの上下左右の残りに分ける(分けた矩形同士は重なってよい)
+			if (used.x > free_rect.x) {
+				result.push_back({ free_rect.x, free_rect.y, used.x - free_rect.x, free_rect.h });
+			}
+			if (used.x + used.w < free_rect.x + free_rect.w) {
+				result.push_back({ used.x + used.w, free_rect.y, free_rect.x + free_rect.w - (used.x + used.w), free_rect.h });
+			}
+			if (used.y > free_rect.y) {
+				result.push_back({ free_rect.x, free_rect.y, free_rect.w, used.y - free_rect.y });
+			}
+			if (used.y + used.h < free_rect.y + free_rect.h) {
+				result.push_back({ free_rect.x, used.y + used.h, free_rect.w, free_rect.y + free_rect.h - (used.y + used.h) });
+			}
+		}
+		//他の空き矩形に含まれるものは捨てる(同じものが2つあれば、前の方を残す)
+		auto contains = [](const Rect& outer, const Rect& inner) {
+			return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w && inner.y + inner.h <= outer.y + outer.h;
+			};
+		free_rects.clear();
+		for (size_t i = 0; i < result.size(); i++) {
+			bool redundant = false;
+			for (size_t j = 0; j < result.size() && !redundant; j++) {
+				if (i == j || !contains(result[j], result[i])) continue;
+				bool same = contains(result[i], result[j]);
+				redundant = !same || j < i;
+			}
+			if (!redundant) free_rects.push_back(result[i]);
+		}
+	}
+
+	TexturePacker::UVTransform TexturePacker::GetUVTransform(uint32_t item) const
+	{
+		UVTransform transform;
+		if (item >= placements.size() || placements[item].bin == INVALID_INDEX) return transform;
+		const Placement& placement = placements[item];
+		const Bin& bin = bins[placement.bin];
+		transform.offset_u = static_cast<float>(placement.x) / static_cast<float>(bin.width);
+		transform.offset_v = static_cast<float>(placement.y) / static_cast<float>(bin.height);
+		transform.scale_u = static_cast<float>(placement.width) / static_cast<float>(bin.width);
+		transform.scale_v = static_cast<float>(placement.height) / static_cast<float>(bin.height);
+		return transform;
+	}
+
+	double TexturePacker::GetOccupancy(uint32_t bin) const
+	{
+		if (bin >= bins.size()) return 0.0;
+		const Bin& b = bins[bin];
+		uint64_t area = static_cast<uint64_t>(b.width) * b.height * b.layer_count;
+		return area > 0 ? static_cast<double>(b.used_texels) / static_cast<double>(area) : 0.0;
+	}
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 小さいテクスチャを、テクスチャ配列の要素やアトラスにまとめる配置を決めるクラス
+	// @details 中身(ピクセル)には触らず、大きさとフォーマットだけから配置を決める(実際に詰めるのはTextureAtlas)。
+	//			・フォーマットが同じものだけを、同じビン(=1つのTexture2DArray)にまとめる
+	//			・同じ大きさのものが2つ以上あれば、1つずつ配列の要素にする(ブロック圧縮のものもそのまま入る)
+	//			・それ以外の小さい非圧縮のものは、MaxRects(空き矩形のうち、短い辺の余りが最も小さい所に置く)でアトラスに詰める。
+	//			  アトラスの1枚が配列の1要素になり、入らなくなったら要素を増やす。圧縮のものは余白を端のテクセルで埋められないので詰めない
+	//			・アトラスの配置は、セル(1 << (mip_levels - 1)テクセル)単位で行う。
+	//			  全てのミップで矩形の端がテクセルの境界に乗り、周りにpaddingテクセル以上の余白が残る。
+	//			  余白は端のテクセルで埋めるので、どのミップでもバイリニアで隣のテクスチャが混ざらない
+	//			・アトラスに入れたテクスチャはUVが0~1の外で繰り返せない(シェーダー側でfracしてから変換すること)。
+	//			  繰り返して使うものは、同じ大きさに揃えて配列にまとめる方が良い
+	//			デバイスには触らないので、大きさだけ並べればデバイス無しで配置と占有率を確かめられる
+	//-------------------------------------------------------------
+	class TexturePacker
+	{
+	public:
+		static constexpr uint32_t INVALID_INDEX = 0xffffffff;
+
+		// @brief まとめるテクスチャ1つ分
+		struct Item {
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t format = 0;		// 同じ値のものだけをまとめる(DXGI_FORMATを入れる)
+			uint32_t block_size = 1;	// ブロック圧縮なら4
+			uint32_t mip_levels = 1;	// 持っているミップの段数(非圧縮のものは足りなければ作るので、1でよい)
+		};
+
+		struct Settings {
+			uint32_t layer_size = 2048;		// アトラス1枚の幅と高さの上限
+			uint32_t max_item_size = 512;	// アトラスに入れる大きさの上限(これより大きいものは配列にまとめるか、まとめない)
+			uint32_t padding = 1;			// 最も小さいミップでの、周りの余白のテクセル数
+			uint32_t mip_levels = 4;		// アトラスのミップの段数(多いほど余白が大きくなる)
+			uint32_t max_layers = 64;		// 1つのビンの配列の要素数の上限
+			bool allow_arrays = true;
+			bool allow_atlases = true;
+		};
+
+		enum class BinType {
+			Array,	// 同じ大きさのものを、1つずつ配列の要素にする
+			Atlas,	// 1つの要素に、複数を詰める
+		};
+		// @brief まとめた先の、1つのTexture2DArray
+		struct Bin {
+			BinType type = BinType::Array;
+			uint32_t format = 0;
+			uint32_t block_size = 1;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t layer_count = 0;
+			uint32_t mip_levels = 1;
+			uint64_t used_texels = 0;	// 中身の面積の合計(余白を除く)
+		};
+		// @brief テクスチャ1つ分の配置。位置と大きさはミップ0のテクセル
+		struct Placement {
+			uint32_t bin = INVALID_INDEX;	// まとめなかったものはINVALID_INDEX
+			uint32_t layer = 0;				// 配列の要素の番号
+			uint32_t x = 0, y = 0;			// 中身の左上
+			uint32_t width = 0, height = 0;
+			uint32_t frame_x = 0, frame_y = 0;	// 余白を含めた、このテクスチャの領域(余白を埋める範囲)
+			uint32_t frame_width = 0, frame_height = 0;
+		};
+		// @brief 元のUVを、まとめた先のUVに直す。uv * scale + offset
+		struct UVTransform {
+			float offset_u = 0.0f, offset_v = 0.0f;
+			float scale_u = 1.0f, scale_v = 1.0f;
+		};
+
+	private:
+		// @brief セル単位の矩形
+		struct Rect {
+			uint32_t x = 0, y = 0, w = 0, h = 0;
+		};
+		std::vector<Bin> bins;
+		std::vector<Placement> placements;
+
+		// @brief 空き矩形の中から、w×hを置く場所を選ぶ。短い辺の余りが最も小さい所、同じなら長い辺の余りが小さい所
+		static bool FindPosition(const std::vector<Rect>& free_rects, uint32_t w, uint32_t h, Rect& out_rect);
+		// @brief usedを置いた後の空き矩形に更新する(重なる空き矩形を分け、他に含まれるものを捨てる)
+		static void SplitFreeRects(std::vector<Rect>& free_rects, const Rect& used);
+		void PackArrays(const std::vector<Item>& items, const std::vector<uint32_t>& group, const Settings& settings, std::vector<uint32_t>& out_rest);
+		void PackAtlases(const std::vector<Item>& items, const std::vector<uint32_t>& group, const Settings& settings);
+
+	public:
+		//-------------------------------------------------------------
+		// @brief 配置を決める(前の結果は捨てる)
+		// @return まとめたテクスチャの数
+		//-------------------------------------------------------------
+		uint32_t Pack(const std::vector<Item>& items, const Settings& settings);
+
+		const std::vector<Bin>& GetBins() const { return bins; }
+		const std::vector<Placement>& GetPlacements() const { return placements; }
+		UVTransform GetUVTransform(uint32_t item) const;
+		// @brief ビンの面積のうち、中身が占める割合(0~1)
+		double GetOccupancy(uint32_t bin) const;
+		// @brief セルの大きさ。全てのミップで、セルの境界がテクセル(ブロック)の境界に乗る
+		static uint32_t GetCellSize(uint32_t block_size, uint32_t mip_levels) { return block_size << (mip_levels > 0 ? mip_levels - 1 : 0); }
+	};
+}
@@ -0,0 +1,276 @@
+﻿#include "TextureReadback.h"
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/TextureTools/SubresourceCopier/SubresourceCopier.h"
+
+#include <algorithm>
+
+namespace System {
+
+	TextureReadback::TextureReadback(unsigned int ring_size, CommandQueue* queue_)
+		: queue(queue_ ? queue_ : DirectX12Manager::Instance()->GetDrawQueue())
+	{
+		if (!queue || !queue->IsValid() || ring_size == 0) {
+			queue = nullptr;
+			return;
+		}
+		//バッファは、最初に使う時にテクスチャに合わせた大きさで作る
+		slots.resize(ring_size);
+		worker = std::thread(&TextureReadback::WorkerMain, this);
+	}
+
+	TextureReadback::~TextureReadback()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop_requested = true;
+			jobs.clear();
+		}
+		job_added.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+		//実行中のフレームがまだバッファに書き込んでいるかもしれないので、完了を待ってから解放する
+		if (queue) {
+			queue->WaitForCompletionAll();
+		}
+		slots.clear();
+	}
+
+	int TextureReadback::Capture(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list, Texture* texture, D3D12_RESOURCE_STATES state, const std::wstring& path)
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid() || !command_list || !texture || !texture->IsValid() || path.empty()) {
+			return -1;
+		}
+		ID3D12Resource* resource = texture->GetResource();
+		D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		//マルチサンプルはコピーできず、深度とステンシルを別の面に持つフォーマットは、1つの画像にならない
+		if (desc.SampleDesc.Count != 1 || desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER || DirectX::IsPlanar(desc.Format)) {
+			return -1;
+		}
+
+		unsigned int index = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = std::find_if(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Free; });
+			if (it == slots.end()) {
+				//書き出しが追いついていない。待つと描画が止まるので、このフレームは諦める
+				dropped_count++;
+				return -1;
+			}
+			index = static_cast<unsigned int>(it - slots.begin());
+		}
+		//Freeのスロットは作業スレッドが触らないので、ここからはロック無しで書き込める
+		Slot& slot = slots[index];
+
+		UINT subresource_count = desc.MipLevels * (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize);
+		slot.layouts.resize(subresource_count);
+		slot.row_counts.resize(subresource_count);
+		slot.row_sizes.resize(subresource_count);
+		UINT64 total_size = 0;
+		ID3D12Device* device = DirectX12Manager::Instance()->GetDevice();
+		device->GetCopyableFootprints(&desc, 0, subresource_count, 0, slot.layouts.data(), slot.row_counts.data(), slot.row_sizes.data(), &total_size);
+
+		//足りなければ作り直す。大きい分にはそのまま使い回す
+		if (!slot.buffer || slot.buffer_size < total_size) {
+			slot.buffer.Reset();
+			slot.buffer_size = 0;
+			D3D12_HEAP_PROPERTIES heap_properties = {};
+			heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+			heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			heap_properties.CreationNodeMask = 0;
+			heap_properties.VisibleNodeMask = 0;
+			D3D12_RESOURCE_DESC buffer_desc = {};
+			buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			buffer_desc.Alignment = 0;
+			buffer_desc.Width = total_size;
+			buffer_desc.Height = 1;
+			buffer_desc.DepthOrArraySize = 1;
+			buffer_desc.MipLevels = 1;
+			buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+			buffer_desc.SampleDesc.Count = 1;
+			buffer_desc.SampleDesc.Quality = 0;
+			buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			buffer_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			if (FAILED(device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &buffer_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(slot.buffer.GetAddressOf())))) {
+				return -1;
+			}
+			slot.buffer_size = total_size;
+		}
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = resource;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = state;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+		if (state != D3D12_RESOURCE_STATE_COPY_SOURCE) {
+			command_list->ResourceBarrier(1, &barrier);
+		}
+		for (UINT subresource = 0; subresource < subresource_count; subresource++) {
+			D3D12_TEXTURE_COPY_LOCATION dst = {};
+			dst.pResource = slot.buffer.Get();
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			dst.PlacedFootprint = slot.layouts[subresource];
+			D3D12_TEXTURE_COPY_LOCATION src = {};
+			src.pResource = resource;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			src.SubresourceIndex = subresource;
+			command_list->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+		if (state != D3D12_RESOURCE_STATE_COPY_SOURCE) {
+			std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+			command_list->ResourceBarrier(1, &barrier);
+		}
+
+		slot.desc = desc;
+		slot.path = path;
+		slot.fence_value = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slot.state = SlotState::Recorded;
+		}
+		return 0;
+	}
+
+	void TextureReadback::Update()
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid()) return;
+		//Recordedのものは、前のフレームと一緒に実行に回っている。その完了は、最後にシグナルした値で分かる
+		uint64_t last_signaled = queue->GetLastSignaledValue();
+		uint64_t completed = queue->GetCompletedValue();
+		bool added = false;
+		unsigned int pending = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (unsigned int i = 0; i < slots.size(); i++) {
+				Slot& slot = slots[i];
+				if (slot.state == SlotState::Recorded) {
+					slot.fence_value = last_signaled;
+					slot.state = SlotState::Submitted;
+				}
+				if (slot.state == SlotState::Submitted && slot.fence_value <= completed) {
+					slot.state = SlotState::Encoding;
+					jobs.push_back(i);
+					added = true;
+				}
+				if (slot.state != SlotState::Free) {
+					pending++;
+				}
+			}
+		}
+		if (added) {
+			job_added.notify_one();
+		}
+		PROFILE_COUNTER("ReadbackPending", pending);
+	}
+
+	int TextureReadback::Flush()
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid()) return -1;
+		if (queue->WaitForCompletionAll() != 0) {
+			return -1;
+		}
+		//キューが空になったので、全て書き出しに回せる
+		Update();
+		std::unique_lock<std::mutex> lock(mutex);
+		slot_freed.wait(lock, [this] {
+			return std::all_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Free; });
+			});
+		return 0;
+	}
+
+	void TextureReadback::WorkerMain()
+	{
+		PROFILE_THREAD("TextureReadback");
+		//WICでの書き出しにCOMを使う
+		HRESULT com_result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		while (true) {
+			unsigned int index = 0;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_added.wait(lock, [this] { return stop_requested || !jobs.empty(); });
+				if (stop_requested) {
+					break;
+				}
+				index = jobs.front();
+				jobs.pop_front();
+			}
+			//Encodingのスロットはメインスレッドが触らないので、ロック無しで読める
+			if (Encode(slots[index]) == 0) {
+				saved_count++;
+			}
+			else {
+				failed_count++;
+				OutputDebugString(L"テクスチャの書き出しに失敗しました\n");
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slots[index].state = SlotState::Free;
+			}
+			slot_freed.notify_all();
+		}
+		if (SUCCEEDED(com_result)) {
+			CoUninitialize();
+		}
+	}
+
+	int TextureReadback::Encode(const Slot& slot)
+	{
+		PROFILE_FUNCTION();
+		const D3D12_RESOURCE_DESC& desc = slot.desc;
+		bool is_3d = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+		DirectX::TexMetadata metadata = {};
+		metadata.width = static_cast<size_t>(desc.Width);
+		metadata.height = desc.Height;
+		metadata.depth = is_3d ? desc.DepthOrArraySize : 1;
+		metadata.arraySize = is_3d ? 1 : desc.DepthOrArraySize;
+		metadata.mipLevels = desc.MipLevels;
+		metadata.format = desc.Format;
+		//TEX_DIMENSIONの値は、D3D12_RESOURCE_DIMENSIONと同じ並びになっている
+		metadata.dimension = static_cast<DirectX::TEX_DIMENSION>(desc.Dimension);
+		DirectX::ScratchImage scratch = {};
+		if (FAILED(scratch.Initialize(metadata))) {
+			return -1;
+		}
+
+		D3D12_RANGE read_range = { 0, static_cast<SIZE_T>(slot.buffer_size) };
+		void* mapped = nullptr;
+		if (FAILED(slot.buffer->Map(0, &read_range, &mapped))) {
+			return -1;
+		}
+		const uint8_t* base = static_cast<const uint8_t*>(mapped);
+		for (size_t item = 0; item < metadata.arraySize; item++) {
+			for (size_t mip = 0; mip < metadata.mipLevels; mip++) {
+				size_t subresource = mip + item * metadata.mipLevels;
+				const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = slot.layouts[subresource];
+				size_t src_slice_pitch = static_cast<size_t>(layout.Footprint.RowPitch) * slot.row_counts[subresource];
+				for (size_t slice = 0; slice < layout.Footprint.Depth; slice++) {
+					const DirectX::Image* image = scratch.GetImage(mip, item, slice);
+					if (!image) continue;
+					//読み戻し用のバッファはキャッシュが効くメモリで、書き込み先もすぐに読むので、非テンポラルストアは使わない
+					size_t row_size = std::min<size_t>(static_cast<size_t>(slot.row_sizes[subresource]), image->rowPitch);
+					SubresourceCopier::CopySubresource(image->pixels, image->rowPitch, image->slicePitch,
+						base + layout.Offset + slice * src_slice_pitch, layout.Footprint.RowPitch, src_slice_pitch,
+						row_size, slot.row_counts[subresource], 1, false);
+				}
+			}
+		}
+		//CPUからは書き込んでいないので、書き込んだ範囲は空にしておく
+		D3D12_RANGE write_range = { 0, 0 };
+		slot.buffer->Unmap(0, &write_range);
+
+		std::filesystem::path parent = std::filesystem::path(slot.path).parent_path();
+		if (!parent.empty()) {
+			std::error_code error;
+			std::filesystem::create_directories(parent, error);
+		}
+		return Texture::Loader::SaveImageToFile(scratch, slot.path);
+	}
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace System {
+	class Texture;
+	class CommandQueue;
+	template <class CommandList> class CommandStreamRecorder;
+
+	//-------------------------------------------------------------
+	// @brief テクスチャをGPUから読み戻し、別スレッドでファイルに書き出すクラス
+	// @details Texture::Loader::SaveToFileは、描画キューの完了まで待ってから書き出すので、その間描画が止まる。
+	//			このクラスは描画を待たずに、次の順で進める
+	//			・Capture：記録中のコマンドリストに、読み戻し用のバッファへのコピーを積む
+	//			・Update：コピーを積んだフレームの完了をフェンスで確かめ(数フレーム後になる)、作業スレッドに渡す
+	//			・作業スレッド：バッファをマップしてScratchImageに詰め直し、拡張子に合わせた形式で書き出す
+	//			読み戻し用のバッファはリングで使い回す。全て使用中(書き出しが追いつかない)なら、Captureは何も積まずに失敗する。
+	//			毎フレーム呼んでも描画は止まらず、追いつかない分のフレームが抜けるだけになる
+	//-------------------------------------------------------------
+	class TextureReadback
+	{
+	public:
+		static constexpr unsigned int DEFAULT_RING_SIZE = 4;
+
+	private:
+		enum class SlotState {
+			Free,		// 使える
+			Recorded,	// コピーをコマンドリストに積んだ(まだ実行に回していない)
+			Submitted,	// 実行に回した。fence_valueの完了を待っている
+			Encoding,	// 作業スレッドが書き出している
+		};
+		struct Slot {
+			ComPtr<ID3D12Resource> buffer;
+			UINT64 buffer_size = 0;
+			D3D12_RESOURCE_DESC desc = {};
+			// サブリソース毎の、バッファ上での配置
+			std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
+			std::vector<UINT> row_counts;
+			std::vector<UINT64> row_sizes;
+			std::wstring path;
+			uint64_t fence_value = 0;
+			SlotState state = SlotState::Free;
+		};
+
+		CommandQueue* queue = nullptr;	// コピーを積むコマンドリストを実行するキュー
+		std::vector<Slot> slots;
+		std::thread worker;
+		std::mutex mutex;	// スロットの状態とjobsを守る
+		std::condition_variable job_added;
+		std::condition_variable slot_freed;
+		std::deque<unsigned int> jobs;
+		bool stop_requested = false;
+		std::atomic<unsigned int> saved_count = 0;
+		std::atomic<unsigned int> failed_count = 0;
+		unsigned int dropped_count = 0;
+
+		void WorkerMain();
+		// @brief マップしたバッファをScratchImageに詰め直して、ファイルに書き出す
+		int Encode(const Slot& slot);
+
+	public:
+		// @param [in] queue コピーを積むコマンドリストを実行するキュー。nullptrならDirectX12Managerの描画キュー
+		TextureReadback(unsigned int ring_size = DEFAULT_RING_SIZE, CommandQueue* queue = nullptr);
+		// @brief 書き出していないものは捨てる。残さず書き出す場合は、先にFlushを呼ぶ
+		~TextureReadback();
+		bool IsValid() const { return queue && !slots.empty() && worker.joinable(); }
+
+		//-------------------------------------------------------------
+		// @brief テクスチャを読み戻し用のバッファにコピーするコマンドを、command_listに積む
+		// @details 全てのミップ・配列の要素をコピーする。コピーの前後でstateとCOPY_SOURCEを行き来するバリアも積む。
+		//			コマンドは記録用のラッパー経由で積むので、コマンドストリームを記録したフレームにも残る。
+		//			マルチサンプルと、深度とステンシルを別の面に持つフォーマットには対応していない
+		// @param [in] state コピーする時点でのテクスチャの状態(コピーの後はこの状態に戻す)
+		// @param [in] path 書き出すファイル。拡張子で形式が決まり、無いフォルダは作る
+		// @return 積んだら0。空いているバッファが無い、または対応していないテクスチャなら-1
+		//-------------------------------------------------------------
+		int Capture(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list, Texture* texture, D3D12_RESOURCE_STATES state, const std::wstring& path);
+
+		//-------------------------------------------------------------
+		// @brief コピーを積んだフレームが完了していれば、作業スレッドに書き出しを頼む
+		// @details 1フレームに1回、前のフレームを実行に回した後、次のフレームのCaptureより前に呼ぶこと
+		//-------------------------------------------------------------
+		void Update();
+
+		// @brief 積んだものを全て書き出すまで待つ(キューの完了も待つ)。終了時に呼ぶ
+		int Flush();
+
+		unsigned int GetSavedCount() const { return saved_count; }
+		unsigned int GetFailedCount() const { return failed_count; }
+		// @brief バッファが空いていなかったために、積まなかった数
+		unsigned int GetDroppedCount() const { return dropped_count; }
+	};
+}
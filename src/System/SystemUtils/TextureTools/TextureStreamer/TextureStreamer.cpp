@@ -0,0 +1,228 @@
+﻿#include "TextureStreamer.h"
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+#include "System/SystemUtils/Descriptors/View/View.h"
+#include "System/SystemUtils/TextureTools/DDSFile/DDSFile.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace System {
+
+	TextureStreamer::TextureStreamer(uint64_t budget_bytes, unsigned int max_loads_in_flight)
+		: scheduler(budget_bytes, max_loads_in_flight)
+	{
+		//読み込みは描画とも起動時の転送とも別のキューで行い、作業スレッドだけが使う
+		ID3D12Device* device = DirectX12Manager::Instance()->GetDevice();
+		copy_queue = std::make_unique<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+		copy_context = std::make_unique<ID3D12DeviceContext>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+		if (!IsValid()) {
+			return;
+		}
+		worker = std::thread(&TextureStreamer::WorkerMain, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop_requested = true;
+			jobs.clear();
+		}
+		job_added.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+		if (copy_queue && copy_queue->IsValid()) {
+			copy_queue->WaitForCompletionAll();
+		}
+		results.clear();
+		deferred.clear();
+		retired.clear();
+	}
+
+	bool TextureStreamer::IsValid() const
+	{
+		return copy_queue && copy_queue->IsValid() && copy_context && copy_context->IsValid();
+	}
+
+	HRESULT TextureStreamer::Register(const std::wstring& path, std::unique_ptr<Texture>& out_texture, unsigned int& out_id)
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid()) {
+			return E_FAIL;
+		}
+		std::unique_ptr<DDSFile> file = std::make_unique<DDSFile>();
+		HRESULT hr = file->Open(path);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		const DDSFile::Description& description = file->GetDescription();
+		if (description.dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D) {
+			return E_NOTIMPL;
+		}
+
+		//ミップ毎のサイズ(配列の要素の分も含める)と、末尾のミップを決める
+		//BCのフォーマットは、リソースのミップ0の幅と高さが4の倍数でなければならないので、そうなっているミップまでしか先頭にできない
+		bool compressed = DirectX::IsCompressed(description.format);
+		std::vector<uint64_t> mip_sizes(description.mip_levels);
+		unsigned int tail_mip = 0;
+		bool tail_found = false;
+		for (unsigned int mip = 0; mip < description.mip_levels; mip++) {
+			UINT64 width = std::max<UINT64>(1, description.width >> mip);
+			UINT height = std::max(1u, description.height >> mip);
+			UINT64 row_size = 0;
+			UINT row_count = 0;
+			if (!DDSFile::GetSurfaceInfo(description.format, width, height, row_size, row_count)) {
+				return E_NOTIMPL;
+			}
+			mip_sizes[mip] = row_size * row_count * description.depth_or_array_size;
+			if (tail_found) {
+				continue;
+			}
+			if (compressed && (width % 4 != 0 || height % 4 != 0)) {
+				tail_found = true;
+				continue;
+			}
+			tail_mip = mip;
+			tail_found = std::max<UINT64>(width, height) <= TAIL_SIZE;
+		}
+
+		out_texture = Texture::Loader::LoadFromDDS(*file, tail_mip);
+		if (!out_texture || !out_texture->IsValid()) {
+			return E_FAIL;
+		}
+		//差し替えの時に切り替える、2つ目のディスクリプタ。差し替えるまではどのフレームも参照しない
+		D3D12_SHADER_RESOURCE_VIEW_DESC spare_desc = out_texture->Srv()->GetDesc();
+		std::unique_ptr<ShaderResourceView> spare_srv = DirectX12Manager::Instance()->CreateShaderResourceView(out_texture->GetResource(), &spare_desc);
+		if (!spare_srv) {
+			out_texture.reset();
+			return E_FAIL;
+		}
+
+		StreamedTexture streamed;
+		streamed.file = std::move(file);
+		streamed.texture = out_texture.get();
+		streamed.texture_size = std::max<uint64_t>(description.width, description.height);
+		streamed.mip_count = description.mip_levels;
+		streamed.spare_srv = std::move(spare_srv);
+		textures.push_back(std::move(streamed));
+		out_id = scheduler.Register(mip_sizes, tail_mip);
+		return S_OK;
+	}
+
+	void TextureStreamer::Unregister(unsigned int id)
+	{
+		if (id >= textures.size() || !textures[id].texture) return;
+		StreamedTexture& streamed = textures[id];
+		{
+			//まだ作業スレッドが取り出していない指示は捨てる
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t queued = jobs.size();
+			jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [id](const Job& job) { return job.texture == id; }), jobs.end());
+			streamed.jobs_in_flight -= static_cast<unsigned int>(queued - jobs.size());
+		}
+		streamed.texture = nullptr;
+		scheduler.Unregister(id);
+		if (streamed.jobs_in_flight == 0) {
+			streamed.file.reset();
+		}
+	}
+
+	void TextureStreamer::RequestScreenSize(unsigned int id, float screen_size)
+	{
+		if (id >= textures.size() || !textures[id].texture) return;
+		const StreamedTexture& streamed = textures[id];
+		scheduler.RequestMip(id, TextureStreamingScheduler::ComputeDesiredMip(streamed.texture_size, screen_size, streamed.mip_count));
+	}
+
+	int TextureStreamer::Update()
+	{
+		PROFILE_FUNCTION();
+		CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue();
+		uint64_t completed_value = draw_queue->GetCompletedValue();
+		while (!retired.empty() && retired.front().fence_value <= completed_value) {
+			retired.pop_front();
+		}
+
+		//前のUpdateで差し替えられなかったものを先に試す
+		std::vector<Result> completed;
+		completed.swap(deferred);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			completed.insert(completed.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+			results.clear();
+		}
+		//今記録しているフレームは、まだシグナルしていない次の値で完了する
+		uint64_t retire_fence_value = draw_queue->GetLastSignaledValue() + 1;
+		for (Result& result : completed) {
+			StreamedTexture& streamed = textures[result.texture];
+			//登録を外した後に届いた結果は、使わずに捨てる
+			if (!streamed.texture) {
+				streamed.jobs_in_flight--;
+				if (streamed.jobs_in_flight == 0) {
+					streamed.file.reset();
+				}
+				continue;
+			}
+			//空いている方のディスクリプタを、まだ実行中のフレームが読んでいるかもしれない
+			if (SUCCEEDED(result.hr) && streamed.spare_fence_value > completed_value) {
+				deferred.push_back(std::move(result));
+				continue;
+			}
+			streamed.jobs_in_flight--;
+			bool succeeded = SUCCEEDED(result.hr) && streamed.texture->ReplaceResource(result.resource, streamed.spare_srv) == 0;
+			if (succeeded) {
+				//実行中のフレームが読んでいる古いリソースとディスクリプタは、今記録しているフレームが終わるまで残す
+				retired.push_back({ std::move(result.resource), retire_fence_value });
+				streamed.spare_fence_value = retire_fence_value;
+				view_revision++;
+			}
+			scheduler.OnCompleted(result.texture, succeeded);
+		}
+
+		scheduler.Update(requests);
+		if (!requests.empty()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (const TextureStreamingScheduler::Request& request : requests) {
+					jobs.push_back({ request.texture, request.first_mip, textures[request.texture].file.get() });
+					textures[request.texture].jobs_in_flight++;
+				}
+			}
+			job_added.notify_one();
+		}
+		PROFILE_COUNTER("TextureStreamingBytes", scheduler.GetCommittedBytes());
+		PROFILE_COUNTER("TextureStreamingLoads", scheduler.GetLoadsInFlight());
+		return 0;
+	}
+
+	void TextureStreamer::WorkerMain()
+	{
+		PROFILE_THREAD("TextureStreamer");
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_added.wait(lock, [this] { return stop_requested || !jobs.empty(); });
+				if (stop_requested) {
+					return;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			//ファイルから転送して、専用のキューの完了まで待つ(待っている間もメインスレッドは止まらない)
+			Result result;
+			result.texture = job.texture;
+			result.hr = Texture::Loader::CreateResourceFromDDS(*job.file, job.first_mip, D3D12_RESOURCE_FLAG_NONE, result.resource,
+				copy_context.get(), copy_queue.get());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				results.push_back(std::move(result));
+			}
+		}
+	}
+}
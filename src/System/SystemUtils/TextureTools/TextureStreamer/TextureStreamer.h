@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "System/SystemUtils/TextureTools/TextureStreamingScheduler/TextureStreamingScheduler.h"
+
+namespace System {
+	class Texture;
+	class ShaderResourceView;
+	class DDSFile;
+	class CommandQueue;
+	class ID3D12DeviceContext;
+
+	//-------------------------------------------------------------
+	// @brief クック済みのDDSを、必要になったミップから別スレッドで読み込むクラス
+	// @details 登録した時点では末尾の小さいミップだけを読み込み、細かいミップは画面上の大きさの要求に応じて後から読む。
+	//			・どのミップを置くか(優先度と予算、LRUの追い出し)はTextureStreamingSchedulerが決める
+	//			・読み込みと追い出しは、どちらも「first_mip以降を持つリソースを作り直す」ことで行う。
+	//			  作業スレッドが専用のコピーキューでファイルから転送し、完了を待ってから結果を返す
+	//			・リソースの差し替えはUpdate(メインスレッド)で行い、描画キューは待たない。
+	//			  SRVはテクスチャ毎に2つ持つディスクリプタの、使っていない方に作って切り替える(ディスクリプタの番号が変わる)
+	//			・実行中のフレームが参照している古いリソースは、今記録しているフレームの完了を描画キューのフェンスで確かめてから解放する。
+	//			  古いディスクリプタも同じフェンスを過ぎるまで再利用しない(過ぎていなければ、差し替えを次のUpdateに回す)
+	//			DDSファイルは登録している間マップしたままにしておく。登録したテクスチャは、Unregisterするかこのクラスを破棄するまで生かしておくこと
+	//-------------------------------------------------------------
+	class TextureStreamer
+	{
+	private:
+		struct StreamedTexture {
+			std::unique_ptr<DDSFile> file;
+			Texture* texture = nullptr;
+			uint64_t texture_size = 0;	// ミップ0の幅と高さの大きい方
+			unsigned int mip_count = 0;
+			unsigned int jobs_in_flight = 0;	// 積んだが、結果をまだ受け取っていない指示の数(作業スレッドがファイルを読み終わるまで閉じない)
+			std::unique_ptr<ShaderResourceView> spare_srv;	// 次の差し替えでSRVを作るディスクリプタ
+			uint64_t spare_fence_value = 0;	// 描画キューがこの値を過ぎれば、spare_srvを書き換えられる
+		};
+		// @brief 作業スレッドへの指示
+		struct Job {
+			unsigned int texture = 0;
+			unsigned int first_mip = 0;
+			const DDSFile* file = nullptr;
+		};
+		// @brief 作業スレッドで作り終わったリソース
+		struct Result {
+			unsigned int texture = 0;
+			ComPtr<ID3D12Resource> resource;
+			HRESULT hr = E_FAIL;
+		};
+		// @brief 描画キューが使い終わるのを待ってから解放するリソース
+		struct RetiredResource {
+			ComPtr<ID3D12Resource> resource;
+			uint64_t fence_value = 0;
+		};
+
+		TextureStreamingScheduler scheduler;
+		std::vector<StreamedTexture> textures;
+		std::vector<TextureStreamingScheduler::Request> requests;	// 毎フレーム使い回す
+		std::vector<Result> deferred;	// 古いディスクリプタがまだ使われていて、差し替えられなかった結果
+		std::deque<RetiredResource> retired;
+		uint64_t view_revision = 0;	// SRVのディスクリプタを切り替えた回数
+
+		std::unique_ptr<CommandQueue> copy_queue;
+		std::unique_ptr<ID3D12DeviceContext> copy_context;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable job_added;
+		std::deque<Job> jobs;
+		std::vector<Result> results;
+		bool stop_requested = false;
+
+		void WorkerMain();
+
+	public:
+		// @brief 末尾のミップの大きさ(幅と高さの大きい方がこれ以下になる所から、常に常駐させる)
+		static constexpr unsigned int TAIL_SIZE = 64;
+
+		// @param [in] budget_bytes ストリーミングするテクスチャの、VRAMの予算
+		// @param [in] max_loads_in_flight 同時に出す読み込みの数
+		explicit TextureStreamer(uint64_t budget_bytes, unsigned int max_loads_in_flight = 2);
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		bool IsValid() const;
+
+		//-------------------------------------------------------------
+		// @brief DDSを登録し、末尾のミップだけを持つテクスチャを作る
+		// @param [out] out_texture 作ったテクスチャ。細かいミップは、読み込まれた時にリソースとSRVごと差し替わる
+		// @param [out] out_id RequestScreenSizeに渡す番号
+		// @return 成功したらS_OK。2Dテクスチャ以外や、未対応のフォーマットならE_NOTIMPL
+		//-------------------------------------------------------------
+		HRESULT Register(const std::wstring& path, std::unique_ptr<Texture>& out_texture, unsigned int& out_id);
+
+		//-------------------------------------------------------------
+		// @brief 登録を外す。テクスチャを破棄する前に呼ぶこと
+		// @details 作業スレッドが読んでいる途中なら、ファイルは結果を受け取った後のUpdateで閉じる
+		//-------------------------------------------------------------
+		void Unregister(unsigned int id);
+
+		// @brief このフレームで、テクスチャが画面上でscreen_sizeピクセルの大きさに描かれることを伝える
+		void RequestScreenSize(unsigned int id, float screen_size);
+
+		//-------------------------------------------------------------
+		// @brief 読み込み終わったリソースに差し替え、前のフレームの要求から次の読み込みを出す
+		// @details 1フレームに1回、描画のコマンドを積み始める前に呼ぶこと
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int Update();
+
+		const TextureStreamingScheduler& GetScheduler() const { return scheduler; }
+		// @brief SRVを切り替える度に増える値。変わっていたら、テクスチャのディスクリプタの番号を読み直すこと
+		uint64_t GetViewRevision() const { return view_revision; }
+	};
+}
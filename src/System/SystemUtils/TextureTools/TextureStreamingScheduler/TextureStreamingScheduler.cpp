@@ -0,0 +1,188 @@
+﻿#include "TextureStreamingScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace System {
+
+	TextureStreamingScheduler::TextureStreamingScheduler(uint64_t budget_bytes_, unsigned int max_loads_in_flight_)
+		: budget_bytes(budget_bytes_), max_loads_in_flight(std::max(1u, max_loads_in_flight_))
+	{
+	}
+
+	unsigned int TextureStreamingScheduler::Register(const std::vector<uint64_t>& mip_sizes, unsigned int tail_mip)
+	{
+		Entry entry;
+		entry.mip_sizes = mip_sizes;
+		entry.tail_mip = mip_sizes.empty() ? 0 : std::min(tail_mip, static_cast<unsigned int>(mip_sizes.size() - 1));
+		entry.resident_mip = entry.tail_mip;
+		entry.desired_mip = entry.tail_mip;
+		entries.push_back(std::move(entry));
+		return static_cast<unsigned int>(entries.size() - 1);
+	}
+
+	void TextureStreamingScheduler::Unregister(unsigned int texture)
+	{
+		if (texture >= entries.size()) return;
+		//ミップを空にしておけば、読み込みの候補にも追い出しの対象にもならず、予算にも数えない
+		Entry& entry = entries[texture];
+		entry = Entry();
+		entry.active = false;
+	}
+
+	void TextureStreamingScheduler::RequestMip(unsigned int texture, unsigned int mip)
+	{
+		if (texture >= entries.size() || !entries[texture].active) return;
+		Entry& entry = entries[texture];
+		entry.requested_mip = std::min(entry.requested_mip, mip);
+		entry.last_used_frame = frame;
+	}
+
+	uint64_t TextureStreamingScheduler::GetSizeFrom(const std::vector<uint64_t>& mip_sizes, unsigned int first_mip)
+	{
+		uint64_t size = 0;
+		for (size_t mip = first_mip; mip < mip_sizes.size(); mip++)
+			size += mip_sizes[mip];
+		return size;
+	}
+
+	uint64_t TextureStreamingScheduler::GetCommittedBytes() const
+	{
+		uint64_t committed = 0;
+		for (const Entry& entry : entries)
+			committed += GetSizeFrom(entry.mip_sizes, entry.TargetMip());
+		return committed;
+	}
+
+	unsigned int TextureStreamingScheduler::GetLoadsInFlight() const
+	{
+		unsigned int loads = 0;
+		for (const Entry& entry : entries) {
+			if (entry.pending_mip != INVALID_MIP && entry.pending_mip < entry.resident_mip)
+				loads++;
+		}
+		return loads;
+	}
+
+	uint64_t TextureStreamingScheduler::PlanEviction(uint64_t needed_bytes, unsigned int exclude, std::vector<unsigned int>& planned_mips) const
+	{
+		//このフレームに使われたものは要求されたミップまで、使われていないものは末尾のミップまで追い出せる
+		std::vector<unsigned int> victims;
+		for (unsigned int i = 0; i < entries.size(); i++) {
+			const Entry& entry = entries[i];
+			if (i == exclude || entry.pending_mip != INVALID_MIP) continue;
+			unsigned int floor_mip = entry.last_used_frame == frame ? entry.desired_mip : entry.tail_mip;
+			if (planned_mips[i] < floor_mip)
+				victims.push_back(i);
+		}
+		//最後に使われたのが古い順。同じなら、番号の小さい順(結果を毎回同じにするため)
+		std::stable_sort(victims.begin(), victims.end(), [&](unsigned int a, unsigned int b) {
+			return entries[a].last_used_frame < entries[b].last_used_frame;
+			});
+
+		uint64_t freed = 0;
+		for (unsigned int i : victims) {
+			const Entry& entry = entries[i];
+			unsigned int floor_mip = entry.last_used_frame == frame ? entry.desired_mip : entry.tail_mip;
+			//1段ずつ追い出し、足りたらそこで止める
+			while (planned_mips[i] < floor_mip && freed < needed_bytes) {
+				freed += entry.mip_sizes[planned_mips[i]];
+				planned_mips[i]++;
+			}
+			if (freed >= needed_bytes) break;
+		}
+		return freed;
+	}
+
+	void TextureStreamingScheduler::Update(std::vector<Request>& out_requests)
+	{
+		out_requests.clear();
+		//このフレームの要求から、欲しいミップを決める(要求が無ければ末尾のミップだけでよい)
+		for (Entry& entry : entries) {
+			entry.desired_mip = std::min(entry.requested_mip, entry.tail_mip);
+			entry.requested_mip = INVALID_MIP;
+		}
+
+		std::vector<unsigned int> planned_mips(entries.size());
+		for (size_t i = 0; i < entries.size(); i++)
+			planned_mips[i] = entries[i].TargetMip();
+		uint64_t committed = GetCommittedBytes();
+		//予算を下げた場合などで既に超えているなら、読み込みの前に追い出しておく
+		if (committed > budget_bytes)
+			committed -= PlanEviction(committed - budget_bytes, INVALID_MIP, planned_mips);
+
+		//足りないミップ数が多いものから読み込む。同じなら、最近使われたものを先にする
+		std::vector<unsigned int> candidates;
+		for (unsigned int i = 0; i < entries.size(); i++) {
+			const Entry& entry = entries[i];
+			if (entry.pending_mip == INVALID_MIP && entry.resident_mip > entry.desired_mip)
+				candidates.push_back(i);
+		}
+		std::stable_sort(candidates.begin(), candidates.end(), [&](unsigned int a, unsigned int b) {
+			const Entry& ea = entries[a];
+			const Entry& eb = entries[b];
+			unsigned int deficit_a = ea.resident_mip - ea.desired_mip;
+			unsigned int deficit_b = eb.resident_mip - eb.desired_mip;
+			if (deficit_a != deficit_b) return deficit_a > deficit_b;
+			return ea.last_used_frame > eb.last_used_frame;
+			});
+
+		std::vector<unsigned int> load_mips(entries.size(), INVALID_MIP);
+		unsigned int loads = GetLoadsInFlight();
+		for (unsigned int i : candidates) {
+			if (loads >= max_loads_in_flight) break;
+			const Entry& entry = entries[i];
+			uint64_t resident_size = GetSizeFrom(entry.mip_sizes, entry.resident_mip);
+			//欲しいミップまで入らなければ、入る所まで粗くする
+			for (unsigned int target = entry.desired_mip; target < entry.resident_mip; target++) {
+				uint64_t growth = GetSizeFrom(entry.mip_sizes, target) - resident_size;
+				if (committed + growth > budget_bytes) {
+					std::vector<unsigned int> trial = planned_mips;
+					uint64_t needed = committed + growth - budget_bytes;
+					uint64_t freed = PlanEviction(needed, i, trial);
+					if (freed < needed) continue;
+					planned_mips.swap(trial);
+					committed -= freed;
+				}
+				committed += growth;
+				load_mips[i] = target;
+				loads++;
+				break;
+			}
+		}
+
+		//空きを作ってから読み込むように、追い出しを先に並べる
+		for (unsigned int i = 0; i < entries.size(); i++) {
+			Entry& entry = entries[i];
+			if (planned_mips[i] == entry.TargetMip()) continue;
+			entry.pending_mip = planned_mips[i];
+			out_requests.push_back({ i, planned_mips[i], false });
+		}
+		for (unsigned int i = 0; i < entries.size(); i++) {
+			if (load_mips[i] == INVALID_MIP) continue;
+			entries[i].pending_mip = load_mips[i];
+			out_requests.push_back({ i, load_mips[i], true });
+		}
+		frame++;
+	}
+
+	void TextureStreamingScheduler::OnCompleted(unsigned int texture, bool succeeded)
+	{
+		if (texture >= entries.size()) return;
+		Entry& entry = entries[texture];
+		if (!entry.active || entry.pending_mip == INVALID_MIP) return;
+		if (succeeded)
+			entry.resident_mip = entry.pending_mip;
+		entry.pending_mip = INVALID_MIP;
+	}
+
+	unsigned int TextureStreamingScheduler::ComputeDesiredMip(uint64_t texture_size, float screen_size, unsigned int mip_count)
+	{
+		if (mip_count == 0) return 0;
+		if (screen_size <= 0.0f) return mip_count - 1;
+		double ratio = static_cast<double>(texture_size) / screen_size;
+		if (ratio <= 1.0) return 0;
+		unsigned int mip = static_cast<unsigned int>(std::floor(std::log2(ratio)));
+		return std::min(mip, mip_count - 1);
+	}
+}
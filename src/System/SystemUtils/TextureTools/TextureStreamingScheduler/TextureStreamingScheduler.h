@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <cstdint>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief テクスチャのストリーミングで、どのミップまでをVRAMに置くかを決めるクラス
+	// @details デバイスには触らず、ミップ毎のサイズと毎フレームの要求だけから、読み込みと追い出しの指示を作る
+	//			(実際の転送はTextureStreamerが行う。このクラスだけなら、デバイス無しで動かして確かめられる)。
+	//			・「常駐しているミップ」は、VRAMにある一番細かいミップの番号。それより粗いミップは全て常駐している
+	//			・読み込みは、要求に足りないミップ数(常駐 - 要求)が多いものから、同時にmax_loads_in_flight個まで出す
+	//			・予算を超える場合は、最後に使われたフレームが古いものから1段ずつ追い出す。
+	//			  このフレームに使われたテクスチャは要求されたミップまで、使われていないものは末尾のミップまで追い出せる
+	//			・予算は、読み込み・追い出しが終わった後の大きさで数える(差し替えの間だけ、古いリソースの分を超える)
+	//-------------------------------------------------------------
+	class TextureStreamingScheduler
+	{
+	public:
+		static constexpr unsigned int INVALID_MIP = 0xffffffff;
+
+		// @brief 転送する側への指示。テクスチャを、first_mip以降のミップだけを持つ状態にする
+		struct Request {
+			unsigned int texture = 0;
+			unsigned int first_mip = 0;
+			bool is_load = false;	// trueなら読み込み(ミップが増える)、falseなら追い出し(ミップが減る)
+		};
+
+	private:
+		struct Entry {
+			std::vector<uint64_t> mip_sizes;		// ミップ毎のバイト数
+			unsigned int tail_mip = 0;				// 常に常駐させておく、一番粗い段の先頭
+			unsigned int resident_mip = 0;			// 常駐している一番細かいミップ
+			unsigned int pending_mip = INVALID_MIP;	// 転送中の指示の行き先。無ければINVALID_MIP
+			unsigned int requested_mip = INVALID_MIP;	// このフレームに要求された一番細かいミップ
+			unsigned int desired_mip = 0;			// 直前のUpdateで決めた、欲しいミップ
+			uint64_t last_used_frame = 0;			// 最後に要求されたフレーム
+			bool active = true;						// Unregisterしたらfalse(番号は詰めずに残す)
+
+			// @brief 転送が終わった後に常駐しているミップ
+			unsigned int TargetMip() const { return pending_mip != INVALID_MIP ? pending_mip : resident_mip; }
+		};
+
+		std::vector<Entry> entries;
+		uint64_t budget_bytes = 0;
+		unsigned int max_loads_in_flight = 1;
+		uint64_t frame = 1;	// 0は「一度も使われていない」に使う
+
+		//-------------------------------------------------------------
+		// @brief 予算に収めるために、exclude以外から追い出すミップを決める
+		// @param [in,out] planned_mips テクスチャ毎の、追い出した後のミップ。足りなくても、追い出せた分は書き込む
+		// @return 空けられたバイト数
+		//-------------------------------------------------------------
+		uint64_t PlanEviction(uint64_t needed_bytes, unsigned int exclude, std::vector<unsigned int>& planned_mips) const;
+
+	public:
+		// @param [in] budget_bytes_ 常駐させるミップの合計の上限
+		// @param [in] max_loads_in_flight_ 同時に出す読み込みの数
+		TextureStreamingScheduler(uint64_t budget_bytes_, unsigned int max_loads_in_flight_ = 2);
+
+		//-------------------------------------------------------------
+		// @brief テクスチャを登録する。tail_mip以降のミップは、登録した時点で常駐しているものとする
+		// @param [in] mip_sizes ミップ毎のバイト数(配列の要素の分も含める)
+		// @return 登録したテクスチャの番号
+		//-------------------------------------------------------------
+		unsigned int Register(const std::vector<uint64_t>& mip_sizes, unsigned int tail_mip);
+
+		// @brief 登録を外す。以降は指示を出さず、予算にも数えない(転送中の指示の完了は無視する)
+		void Unregister(unsigned int texture);
+
+		// @brief このフレームで、テクスチャのmipより細かいミップが必要になったことを伝える(複数回呼べば一番細かいものを使う)
+		void RequestMip(unsigned int texture, unsigned int mip);
+
+		//-------------------------------------------------------------
+		// @brief このフレームの要求から、読み込み・追い出しの指示を作り、次のフレームに進む
+		// @details 転送中のテクスチャには、完了するまで次の指示を出さない
+		//-------------------------------------------------------------
+		void Update(std::vector<Request>& out_requests);
+
+		// @brief 指示した転送が終わったことを伝える。失敗した場合は、常駐しているミップを変えない
+		void OnCompleted(unsigned int texture, bool succeeded);
+
+		void SetBudget(uint64_t budget_bytes_) { budget_bytes = budget_bytes_; }
+		uint64_t GetBudget() const { return budget_bytes; }
+		// @brief 転送中の指示が全て終わった後に、常駐しているミップの合計
+		uint64_t GetCommittedBytes() const;
+		unsigned int GetTextureCount() const { return static_cast<unsigned int>(entries.size()); }
+		unsigned int GetResidentMip(unsigned int texture) const { return entries[texture].resident_mip; }
+		unsigned int GetDesiredMip(unsigned int texture) const { return entries[texture].desired_mip; }
+		bool IsPending(unsigned int texture) const { return entries[texture].pending_mip != INVALID_MIP; }
+		unsigned int GetLoadsInFlight() const;
+
+		// @brief first_mip以降のミップの合計のバイト数
+		static uint64_t GetSizeFrom(const std::vector<uint64_t>& mip_sizes, unsigned int first_mip);
+
+		//-------------------------------------------------------------
+		// @brief 画面上の大きさから、必要なミップを求める
+		// @details 1ピクセルあたりのテクセル数が1を下回らない、一番粗いミップ(log2(テクスチャの大きさ / 画面上の大きさ)の切り捨て)
+		// @param [in] texture_size ミップ0の幅と高さの大きい方
+		// @param [in] screen_size テクスチャを貼った物の、画面上の大きさ(ピクセル)
+		//-------------------------------------------------------------
+		static unsigned int ComputeDesiredMip(uint64_t texture_size, float screen_size, unsigned int mip_count);
+	};
+}
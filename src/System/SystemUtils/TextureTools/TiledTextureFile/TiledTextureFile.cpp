@@ -0,0 +1,170 @@
+﻿#include "TiledTextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace System {
+
+	namespace {
+		bool IsPowerOfTwo(uint32_t value)
+		{
+			return value != 0 && (value & (value - 1)) == 0;
+		}
+		uint32_t GetMipSize(uint32_t size, uint32_t mip)
+		{
+			return std::max(1u, size >> mip);
+		}
+	}
+
+	uint32_t TiledTextureFile::CalcMipCount(uint32_t width, uint32_t height, uint32_t page_size)
+	{
+		uint32_t count = 1;
+		uint32_t size = std::max(width, height);
+		while (size > page_size && count < MAX_MIP_COUNT) {
+			size >>= 1;
+			count++;
+		}
+		return count;
+	}
+
+	size_t TiledTextureFile::GetPageRowPitch(const Header& header)
+	{
+		size_t elements = (header.page_size + header.border * 2) / header.block_size;
+		return elements * header.element_size;
+	}
+
+	size_t TiledTextureFile::GetPageBytes(const Header& header)
+	{
+		size_t rows = (header.page_size + header.border * 2) / header.block_size;
+		return rows * GetPageRowPitch(header);
+	}
+
+	uint32_t TiledTextureFile::GetPagesX(const Header& header, uint32_t mip)
+	{
+		return (GetMipSize(header.width, mip) + header.page_size - 1) / header.page_size;
+	}
+
+	uint32_t TiledTextureFile::GetPagesY(const Header& header, uint32_t mip)
+	{
+		return (GetMipSize(header.height, mip) + header.page_size - 1) / header.page_size;
+	}
+
+	bool TiledTextureFile::IsValidHeader(const Header& header)
+	{
+		if (header.magic != MAGIC || header.version != VERSION) return false;
+		if (!IsPowerOfTwo(header.width) || !IsPowerOfTwo(header.height)) return false;
+		if (header.block_size == 0 || header.element_size == 0 || header.page_size == 0) return false;
+		if (header.page_size % header.block_size != 0 || header.border % header.block_size != 0 || header.border >= header.page_size) return false;
+		if (header.mip_count == 0 || header.mip_count != CalcMipCount(header.width, header.height, header.page_size)) return false;
+		//一番粗いミップでも、1要素以上の大きさが必要
+		uint32_t last = header.mip_count - 1;
+		return GetMipSize(header.width, last) >= header.block_size && GetMipSize(header.height, last) >= header.block_size;
+	}
+
+	void TiledTextureFile::BuildPage(const Header& header, const uint8_t* pixels, uint32_t mip_width, uint32_t mip_height, size_t row_pitch, uint32_t page_x, uint32_t page_y, uint8_t* out_page)
+	{
+		//要素(テクセルかブロック)単位で、テクスチャの外は反対側から取る(ラップ)
+		int64_t width = mip_width / header.block_size;
+		int64_t height = mip_height / header.block_size;
+		int64_t page_elements = header.page_size / header.block_size;
+		int64_t border = header.border / header.block_size;
+		int64_t elements = page_elements + border * 2;
+		auto wrap = [](int64_t value, int64_t size) { return ((value % size) + size) % size; };
+
+		std::vector<int64_t> source_x(static_cast<size_t>(elements));
+		for (int64_t x = 0; x < elements; x++)
+			source_x[x] = wrap(page_x * page_elements - border + x, width);
+		size_t element_size = header.element_size;
+		size_t out_pitch = GetPageRowPitch(header);
+		for (int64_t y = 0; y < elements; y++) {
+			const uint8_t* src_row = pixels + wrap(page_y * page_elements - border + y, height) * row_pitch;
+			uint8_t* dst_row = out_page + y * out_pitch;
+			//中身が途中で折り返さない所は、まとめてコピーする
+			int64_t x = 0;
+			while (x < elements) {
+				int64_t run = 1;
+				while (x + run < elements && source_x[x + run] == source_x[x] + run)
+					run++;
+				std::memcpy(dst_row + x * element_size, src_row + source_x[x] * element_size, run * element_size);
+				x += run;
+			}
+		}
+	}
+
+	void TiledTextureFile::BuildMipTable()
+	{
+		mip_first_page.assign(header.mip_count + 1, 0);
+		for (uint32_t mip = 0; mip < header.mip_count; mip++)
+			mip_first_page[mip + 1] = mip_first_page[mip] + static_cast<uint64_t>(GetPagesX(header, mip)) * GetPagesY(header, mip);
+	}
+
+	int TiledTextureFile::Write(const std::filesystem::path& path, const Header& header, const MipSource& get_mip)
+	{
+		if (!IsValidHeader(header) || !get_mip) {
+			return -1;
+		}
+		if (path.has_parent_path()) {
+			std::error_code error;
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return -1;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		std::vector<uint8_t> page(GetPageBytes(header));
+		for (uint32_t mip = 0; mip < header.mip_count; mip++) {
+			const uint8_t* pixels = nullptr;
+			size_t row_pitch = 0;
+			if (get_mip(mip, pixels, row_pitch) != 0 || !pixels) {
+				return -1;
+			}
+			uint32_t mip_width = GetMipSize(header.width, mip);
+			uint32_t mip_height = GetMipSize(header.height, mip);
+			for (uint32_t y = 0; y < GetPagesY(header, mip); y++) {
+				for (uint32_t x = 0; x < GetPagesX(header, mip); x++) {
+					BuildPage(header, pixels, mip_width, mip_height, row_pitch, x, y, page.data());
+					file.write(reinterpret_cast<const char*>(page.data()), page.size());
+				}
+			}
+		}
+		return file.good() ? 0 : -1;
+	}
+
+	int TiledTextureFile::Open(const std::filesystem::path& path)
+	{
+		stream.close();
+		stream.clear();
+		stream.open(path, std::ios::binary);
+		if (!stream) {
+			return -1;
+		}
+		stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!stream || !IsValidHeader(header)) {
+			stream.close();
+			return -1;
+		}
+		BuildMipTable();
+		//ファイルが最後のページまであるかを確かめる
+		stream.seekg(0, std::ios::end);
+		uint64_t expected = sizeof(Header) + mip_first_page.back() * GetPageBytes(header);
+		if (static_cast<uint64_t>(stream.tellg()) < expected) {
+			stream.close();
+			return -1;
+		}
+		return 0;
+	}
+
+	int TiledTextureFile::ReadPage(uint32_t mip, uint32_t page_x, uint32_t page_y, uint8_t* out_page)
+	{
+		if (!stream.is_open() || mip >= header.mip_count || page_x >= GetPagesX(mip) || page_y >= GetPagesY(mip) || !out_page) {
+			return -1;
+		}
+		uint64_t index = mip_first_page[mip] + static_cast<uint64_t>(page_y) * GetPagesX(mip) + page_x;
+		size_t page_bytes = GetPageBytes(header);
+		stream.clear();
+		stream.seekg(static_cast<std::streamoff>(sizeof(Header) + index * page_bytes));
+		stream.read(reinterpret_cast<char*>(out_page), page_bytes);
+		return stream ? 0 : -1;
+	}
+}
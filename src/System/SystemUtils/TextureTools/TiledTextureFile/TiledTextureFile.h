@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 仮想テクスチャ用の、ページ単位で並べたテクスチャのファイル
+	// @details ・ミップ毎に、page_size四方のページに区切って並べる。ミップはページ1枚に収まる段まで持つ
+	//			・ページの周りにborderテクセルの縁を付けて保存する(隣のページの端のテクセル。テクスチャの外は反対側から取る)。
+	//			  物理キャッシュの中で隣が別のページでも、バイリニアで正しく補間できる
+	//			・ページは全て同じバイト数で、ミップの順・行の順に隙間無く並べる。ページの位置はヘッダーだけから計算で求まる
+	//			・ブロック圧縮のフォーマットは、ブロック(4x4)を1要素として扱う。page_sizeとborderは4の倍数にすること
+	//			デバイスには触らないので、デバイス無しで書き出しと読み込みを確かめられる
+	//-------------------------------------------------------------
+	class TiledTextureFile
+	{
+	public:
+		static constexpr uint32_t MAGIC = 0x58455456;	// "VTEX"
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t DEFAULT_PAGE_SIZE = 128;
+		static constexpr uint32_t DEFAULT_BORDER = 4;
+		static constexpr uint32_t MAX_MIP_COUNT = 12;
+
+		struct Header {
+			uint32_t magic = MAGIC;
+			uint32_t version = VERSION;
+			uint32_t width = 0;				// ミップ0の幅(テクセル)
+			uint32_t height = 0;
+			uint32_t format = 0;			// DXGI_FORMAT
+			uint32_t mip_count = 0;
+			uint32_t page_size = DEFAULT_PAGE_SIZE;	// 縁を除いたページの幅と高さ(テクセル)
+			uint32_t border = DEFAULT_BORDER;		// ページの周りの縁の幅(テクセル)
+			uint32_t block_size = 1;		// 1要素の幅と高さ(テクセル)。ブロック圧縮なら4
+			uint32_t element_size = 0;		// 1要素のバイト数
+		};
+
+	private:
+		Header header;
+		std::ifstream stream;
+		std::vector<uint64_t> mip_first_page;	// ミップ毎の、先頭のページの通し番号
+
+		void BuildMipTable();
+
+	public:
+		//-------------------------------------------------------------
+		// @brief ミップの段数。幅と高さの大きい方がpage_size以下になる段まで
+		//-------------------------------------------------------------
+		static uint32_t CalcMipCount(uint32_t width, uint32_t height, uint32_t page_size);
+		// @brief 縁を含めたページ1枚のバイト数
+		static size_t GetPageBytes(const Header& header);
+		// @brief ページの1行(要素の1行)のバイト数
+		static size_t GetPageRowPitch(const Header& header);
+		// @brief ミップの、横と縦のページ数
+		static uint32_t GetPagesX(const Header& header, uint32_t mip);
+		static uint32_t GetPagesY(const Header& header, uint32_t mip);
+		// @brief ヘッダーの値が使えるものか(大きさが2の累乗、page_sizeとborderがブロックの倍数など)
+		static bool IsValidHeader(const Header& header);
+
+		//-------------------------------------------------------------
+		// @brief 1つのミップの画像から、縁を付けたページを切り出す
+		// @param [in] pixels ミップの画像(要素の行をrow_pitchバイトおきに並べたもの)
+		// @param [in] mip_width,mip_height ミップの大きさ(テクセル)
+		// @param [out] out_page GetPageBytesバイト
+		//-------------------------------------------------------------
+		static void BuildPage(const Header& header, const uint8_t* pixels, uint32_t mip_width, uint32_t mip_height, size_t row_pitch, uint32_t page_x, uint32_t page_y, uint8_t* out_page);
+
+		//-------------------------------------------------------------
+		// @brief ファイルに書き出す
+		// @param [in] get_mip ミップの画像を返す関数(画像, 行のバイト数)。失敗したら0以外を返す
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		using MipSource = std::function<int(uint32_t mip, const uint8_t*& out_pixels, size_t& out_row_pitch)>;
+		static int Write(const std::filesystem::path& path, const Header& header, const MipSource& get_mip);
+
+		// @brief ファイルを開いてヘッダーを読む。成功したら0
+		int Open(const std::filesystem::path& path);
+		bool IsOpen() const { return stream.is_open(); }
+		const Header& GetHeader() const { return header; }
+		uint32_t GetPagesX(uint32_t mip) const { return GetPagesX(header, mip); }
+		uint32_t GetPagesY(uint32_t mip) const { return GetPagesY(header, mip); }
+		size_t GetPageBytes() const { return GetPageBytes(header); }
+
+		//-------------------------------------------------------------
+		// @brief 1ページを読む(同じファイルを複数のスレッドから読まないこと)
+		// @param [out] out_page GetPageBytesバイト
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int ReadPage(uint32_t mip, uint32_t page_x, uint32_t page_y, uint8_t* out_page);
+	};
+}
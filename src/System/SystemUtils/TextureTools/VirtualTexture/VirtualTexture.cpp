@@ -0,0 +1,596 @@
+﻿#include "VirtualTexture.h"
+#include "System/Managers/DirectX12Manager/DirectX12Manager.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+#include "System/SystemUtils/D3DBuffer/Texture/Texture.h"
+
+#include <algorithm>
+
+namespace System {
+
+	namespace {
+		HRESULT CreateBuffer(size_t size, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES state, D3D12_RESOURCE_FLAGS flags, ComPtr<ID3D12Resource>& out_resource) {
+			D3D12_HEAP_PROPERTIES heap_properties = {};
+			heap_properties.Type = heap_type;
+			heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			heap_properties.CreationNodeMask = 0;
+			heap_properties.VisibleNodeMask = 0;
+			D3D12_RESOURCE_DESC resource_desc = {};
+			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			resource_desc.Alignment = 0;
+			resource_desc.Width = size;
+			resource_desc.Height = 1;
+			resource_desc.DepthOrArraySize = 1;
+			resource_desc.MipLevels = 1;
+			resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+			resource_desc.SampleDesc.Count = 1;
+			resource_desc.SampleDesc.Quality = 0;
+			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			resource_desc.Flags = flags;
+			return DirectX12Manager::Instance()->GetDevice()->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, state, nullptr, IID_PPV_ARGS(out_resource.GetAddressOf()));
+		}
+		size_t AlignUp(size_t value, size_t alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+		uint32_t NextPowerOfTwo(uint32_t value) {
+			uint32_t result = 1;
+			while (result < value)
+				result *= 2;
+			return result;
+		}
+		// @brief ページの大きさ以外の、このクラスで扱うページの形式
+		TiledTextureFile::Header MakePageFormat(DXGI_FORMAT format) {
+			TiledTextureFile::Header header;
+			header.format = format;
+			header.page_size = TiledTextureFile::DEFAULT_PAGE_SIZE;
+			header.border = TiledTextureFile::DEFAULT_BORDER;
+			header.block_size = 1;
+			header.element_size = static_cast<uint32_t>(DirectX::BitsPerPixel(format) / 8);
+			return header;
+		}
+		using PageId = VirtualTextureFeedback::PageId;
+	}
+
+	VirtualTexture::VirtualTexture(const Settings& settings_)
+		: settings(settings_),
+		cache(settings_.physical_pages_x * settings_.physical_pages_y, DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT + 1)
+	{
+		//スロットの座標は、ページテーブルの要素に8bitずつ詰める
+		if (settings.physical_pages_x == 0 || settings.physical_pages_y == 0 || settings.physical_pages_x > 256 || settings.physical_pages_y > 256 ||
+			settings.feedback_scale == 0 || settings.max_uploads_per_frame == 0 || settings.max_reads_in_flight == 0) {
+			return;
+		}
+		//ブロック圧縮のフォーマットは、まだクックできないので扱わない
+		if (DirectX::IsCompressed(settings.format) || DirectX::BitsPerPixel(settings.format) != 32) {
+			return;
+		}
+		TiledTextureFile::Header page_format = MakePageFormat(settings.format);
+		element_size = page_format.element_size;
+		padded_page_size = page_format.page_size + page_format.border * 2;
+		upload_row_pitch = static_cast<uint32_t>(AlignUp(TiledTextureFile::GetPageRowPitch(page_format), D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+		upload_page_bytes = AlignUp(static_cast<size_t>(upload_row_pitch) * padded_page_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+		ID3D12Device* device = DirectX12Manager::Instance()->GetDevice();
+		//物理キャッシュ。COMMONのまま、コピーキューではCOPY_DESTに、描画ではシェーダーリソースに暗黙に昇格させる
+		D3D12_RESOURCE_DESC desc = TEX2D_DESC(static_cast<UINT64>(settings.physical_pages_x) * padded_page_size, settings.physical_pages_y * padded_page_size,
+			settings.format, D3D12_RESOURCE_FLAG_NONE);
+		ComPtr<ID3D12Resource> physical_resource;
+		if (FAILED(Texture::Loader::CreateEmptyTexture(desc, physical_resource))) {
+			return;
+		}
+		physical_texture = Texture::Loader::CreateFromResource(physical_resource);
+		if (!physical_texture || !physical_texture->IsValid() || !physical_texture->Srv()) {
+			physical_texture.reset();
+			return;
+		}
+
+		copy_queue = std::make_unique<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+		copy_frames.resize(DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT);
+		for (CopyFrame& copy_frame : copy_frames) {
+			copy_frame.context = std::make_unique<ID3D12DeviceContext>(device, D3D12_COMMAND_LIST_TYPE_COPY);
+			if (!copy_frame.context->IsValid() ||
+				FAILED(Texture::Loader::CreateUploadBuffer(upload_page_bytes * settings.max_uploads_per_frame, copy_frame.upload_buffer))) {
+				copy_frames.clear();
+				return;
+			}
+		}
+		table_uploads.resize(DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT);
+		//読み戻しは、実行中のフレームの数より1つ多く持てば、毎フレーム積める
+		readbacks.resize(DirectX12Manager::DRAW_CONTEXT_FRAME_COUNT + 1);
+
+		page_table.SetHeader(VirtualTexturePageTable::PhysicalPagesX, settings.physical_pages_x);
+		page_table.SetHeader(VirtualTexturePageTable::PhysicalPagesY, settings.physical_pages_y);
+		page_table.SetHeader(VirtualTexturePageTable::PageSize, page_format.page_size);
+		page_table.SetHeader(VirtualTexturePageTable::Border, page_format.border);
+		page_table.SetHeader(VirtualTexturePageTable::PhysicalSrvIndex, physical_texture->Srv()->GetIndex());
+		page_table.SetHeader(VirtualTexturePageTable::FeedbackScale, settings.feedback_scale);
+		if (!IsValid()) {
+			return;
+		}
+		worker = std::thread(&VirtualTexture::WorkerMain, this);
+	}
+
+	VirtualTexture::~VirtualTexture()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop_requested = true;
+			jobs.clear();
+		}
+		job_added.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+		//実行中のフレームとコピーが、バッファと物理キャッシュを使い終わるのを待つ
+		if (CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue()) {
+			draw_queue->WaitForCompletionAll();
+		}
+		if (copy_queue && copy_queue->IsValid()) {
+			copy_queue->WaitForCompletionAll();
+		}
+		results.clear();
+		retired.clear();
+	}
+
+	bool VirtualTexture::IsValid() const
+	{
+		return physical_texture && copy_queue && copy_queue->IsValid() && !copy_frames.empty();
+	}
+
+	HRESULT VirtualTexture::Cook(const std::wstring& src_path, const std::wstring& dst_path, DXGI_FORMAT format)
+	{
+		PROFILE_FUNCTION();
+		if (src_path.empty() || dst_path.empty() || !std::filesystem::exists(src_path)) {
+			return E_INVALIDARG;
+		}
+		if (DirectX::IsCompressed(format) || DirectX::BitsPerPixel(format) != 32) {
+			return E_NOTIMPL;
+		}
+		DirectX::TexMetadata metadata = {};
+		DirectX::ScratchImage source;
+		HRESULT hr = DirectX::LoadFromWICFile(src_path.c_str(), DirectX::WIC_FLAGS_NONE, &metadata, source);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		//値はそのままで、sRGBとして読むかどうかだけをformatに合わせる(Convertで色を変換させない)
+		DXGI_FORMAT source_format = DirectX::IsSRGB(format) ? DirectX::MakeSRGB(metadata.format) : DirectX::MakeLinear(metadata.format);
+		if (source_format != metadata.format && SUCCEEDED(source.OverrideFormat(source_format))) {
+			metadata.format = source_format;
+		}
+		DirectX::ScratchImage converted;
+		if (metadata.format != format) {
+			hr = DirectX::Convert(*source.GetImage(0, 0, 0), format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			source = std::move(converted);
+		}
+		//ページの座標を半分にすると親のページになるように、幅と高さを2の累乗に揃える
+		uint32_t width = NextPowerOfTwo(static_cast<uint32_t>(metadata.width));
+		uint32_t height = NextPowerOfTwo(static_cast<uint32_t>(metadata.height));
+		if (width != metadata.width || height != metadata.height) {
+			DirectX::ScratchImage resized;
+			hr = DirectX::Resize(*source.GetImage(0, 0, 0), width, height, DirectX::TEX_FILTER_DEFAULT, resized);
+			if (FAILED(hr)) {
+				return hr;
+			}
+			source = std::move(resized);
+		}
+
+		TiledTextureFile::Header header = MakePageFormat(format);
+		header.width = width;
+		header.height = height;
+		header.mip_count = TiledTextureFile::CalcMipCount(width, height, header.page_size);
+		DirectX::ScratchImage mips;
+		if (header.mip_count > 1) {
+			hr = DirectX::GenerateMipMaps(*source.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, header.mip_count, mips);
+			if (FAILED(hr)) {
+				return hr;
+			}
+		}
+		else {
+			mips = std::move(source);
+		}
+
+		//書き出し先のフォルダが無ければ作る
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(dst_path).parent_path(), error);
+		int result = TiledTextureFile::Write(dst_path, header, [&mips](uint32_t mip, const uint8_t*& out_pixels, size_t& out_row_pitch) {
+			const DirectX::Image* image = mips.GetImage(mip, 0, 0);
+			if (!image) return -1;
+			out_pixels = image->pixels;
+			out_row_pitch = image->rowPitch;
+			return 0;
+			});
+		return result == 0 ? S_OK : E_FAIL;
+	}
+
+	HRESULT VirtualTexture::Register(const std::wstring& path, uint32_t& out_id)
+	{
+		PROFILE_FUNCTION();
+		out_id = INVALID_ID;
+		if (!IsValid()) {
+			return E_FAIL;
+		}
+		std::unique_ptr<TiledTextureFile> file = std::make_unique<TiledTextureFile>();
+		if (file->Open(path) != 0) {
+			return E_FAIL;
+		}
+		//物理キャッシュと同じ形式のページしか転送できない
+		const TiledTextureFile::Header& header = file->GetHeader();
+		TiledTextureFile::Header page_format = MakePageFormat(settings.format);
+		if (header.format != page_format.format || header.page_size != page_format.page_size || header.border != page_format.border ||
+			header.block_size != page_format.block_size || header.element_size != page_format.element_size) {
+			return E_INVALIDARG;
+		}
+		if (textures.size() >= VirtualTextureFeedback::MAX_TEXTURES) {
+			return E_FAIL;
+		}
+		uint32_t id = page_table.AddTexture(header.width, header.height, header.page_size, header.mip_count);
+		if (id == VirtualTexturePageTable::INVALID_TEXTURE) {
+			return E_FAIL;
+		}
+
+		//一番粗いミップはページ1枚に収まる。その場で読んで、次のUpdateで最初に転送する
+		uint32_t top_mip = header.mip_count - 1;
+		Result top_page;
+		top_page.page = VirtualTextureFeedback::Pack({ id, top_mip, 0, 0 });
+		top_page.data.resize(file->GetPageBytes());
+		top_page.result = file->ReadPage(top_mip, 0, 0, top_page.data.data());
+		top_page.pinned = true;
+		if (top_page.result != 0) {
+			return E_FAIL;
+		}
+		completed.push_front(std::move(top_page));
+
+		analyzer.SetMipCount(id, header.mip_count);
+		RegisteredTexture texture;
+		texture.file = std::move(file);
+		textures.push_back(std::move(texture));
+		out_id = id;
+		return S_OK;
+	}
+
+	void VirtualTexture::ProcessFeedback()
+	{
+		CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue();
+		//Recordedのものは、前のフレームと一緒に実行に回っている。その完了は、最後にシグナルした値で分かる
+		uint64_t last_signaled = draw_queue->GetLastSignaledValue();
+		uint64_t completed_value = draw_queue->GetCompletedValue();
+		bool added = false;
+		for (FeedbackReadback& readback : readbacks) {
+			if (readback.state == ReadbackState::Recorded) {
+				readback.fence_value = last_signaled;
+				readback.state = ReadbackState::Submitted;
+			}
+			if (readback.state != ReadbackState::Submitted || readback.fence_value > completed_value) {
+				continue;
+			}
+			D3D12_RANGE read_range = { 0, static_cast<SIZE_T>(readback.count) * sizeof(uint32_t) };
+			uint32_t* mapped = nullptr;
+			if (SUCCEEDED(readback.buffer->Map(0, &read_range, reinterpret_cast<void**>(&mapped)))) {
+				analyzer.Analyze(mapped, readback.count, requests);
+				D3D12_RANGE write_range = { 0, 0 };
+				readback.buffer->Unmap(0, &write_range);
+			}
+			else {
+				requests.clear();
+			}
+			readback.state = ReadbackState::Free;
+
+			//キャッシュにあるものは使ったことにして、無いものは優先度の高い順に読みに行く(親は子より先に並んでいる)
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const VirtualTextureFeedback::Request& request : requests) {
+				if (cache.Touch(request.page, frame)) {
+					continue;
+				}
+				if (reading.size() >= settings.max_reads_in_flight) {
+					continue;
+				}
+				if (!reading.insert(request.page).second) {
+					continue;
+				}
+				PageId id = VirtualTextureFeedback::Unpack(request.page);
+				jobs.push_back({ request.page, textures[id.texture].file.get() });
+				added = true;
+			}
+		}
+		if (added) {
+			job_added.notify_one();
+		}
+	}
+
+	int VirtualTexture::UploadPages()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (Result& result : results)
+				completed.push_back(std::move(result));
+			results.clear();
+		}
+		if (completed.empty()) {
+			return 0;
+		}
+
+		//このコンテキストを前に使った転送は、数フレーム前に終わっている
+		CopyFrame& copy_frame = copy_frames[copy_frame_index];
+		if (copy_queue->WaitForCompletion(copy_frame.context.get()) != 0 || copy_frame.context->ResetCommandList() != 0) {
+			return -1;
+		}
+		ID3D12GraphicsCommandList* command_list = copy_frame.context->GetCommandList();
+		uint8_t* mapped = nullptr;
+		if (FAILED(copy_frame.upload_buffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)))) {
+			copy_frame.context->CloseCommandList();
+			return -1;
+		}
+
+		const size_t page_row_size = static_cast<size_t>(padded_page_size) * element_size;
+		uint32_t upload_count = 0;
+		while (!completed.empty() && upload_count < settings.max_uploads_per_frame) {
+			Result result = std::move(completed.front());
+			completed.pop_front();
+			reading.erase(result.page);
+			if (result.result != 0) {
+				continue;
+			}
+			uint32_t evicted_page = VirtualTexturePageCache::INVALID_PAGE;
+			uint32_t slot = cache.Allocate(result.page, frame, evicted_page);
+			if (slot == VirtualTexturePageCache::INVALID_SLOT) {
+				//全てのスロットが最近使われている。必要なら、後のフィードバックでもう一度要求される
+				continue;
+			}
+			if (evicted_page != VirtualTexturePageCache::INVALID_PAGE) {
+				PageId evicted = VirtualTextureFeedback::Unpack(evicted_page);
+				page_table.SetEvicted(evicted.texture, evicted.mip, evicted.x, evicted.y);
+			}
+
+			size_t offset = static_cast<size_t>(upload_count) * upload_page_bytes;
+			for (uint32_t row = 0; row < padded_page_size; row++)
+				std::memcpy(mapped + offset + static_cast<size_t>(row) * upload_row_pitch, result.data.data() + row * page_row_size, page_row_size);
+
+			D3D12_TEXTURE_COPY_LOCATION dst = {};
+			dst.pResource = physical_texture->GetResource();
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = 0;
+			D3D12_TEXTURE_COPY_LOCATION src = {};
+			src.pResource = copy_frame.upload_buffer.Get();
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint.Offset = offset;
+			src.PlacedFootprint.Footprint.Format = settings.format;
+			src.PlacedFootprint.Footprint.Width = padded_page_size;
+			src.PlacedFootprint.Footprint.Height = padded_page_size;
+			src.PlacedFootprint.Footprint.Depth = 1;
+			src.PlacedFootprint.Footprint.RowPitch = upload_row_pitch;
+			uint32_t slot_x = slot % settings.physical_pages_x;
+			uint32_t slot_y = slot / settings.physical_pages_x;
+			command_list->CopyTextureRegion(&dst, slot_x * padded_page_size, slot_y * padded_page_size, 0, &src, nullptr);
+
+			//テーブルは描画のコマンドリストでコピーするので、このコピーを待つフレームから新しいページを読む
+			cache.Commit(slot);
+			if (result.pinned) {
+				cache.SetPinned(slot, true);
+			}
+			PageId id = VirtualTextureFeedback::Unpack(result.page);
+			page_table.SetResident(id.texture, id.mip, id.x, id.y, slot_x, slot_y);
+			upload_count++;
+		}
+		copy_frame.upload_buffer->Unmap(0, nullptr);
+		if (copy_frame.context->CloseCommandList() != 0) {
+			return -1;
+		}
+		if (upload_count == 0) {
+			return 0;
+		}
+
+		//追い出したスロットは実行中のフレームが読んでいるかもしれないので、描画キューに積んだものが終わってから上書きする。
+		//描画キューは、このコピーが終わってから次のフレームを始める
+		CommandQueue* draw_queue = DirectX12Manager::Instance()->GetDrawQueue();
+		if (copy_queue->WaitForQueue(draw_queue, draw_queue->GetLastSignaledValue()) != 0 ||
+			copy_queue->Execute(std::vector<ID3D12DeviceContext*>{ copy_frame.context.get() }) != 0 ||
+			draw_queue->WaitForQueue(copy_queue.get(), copy_queue->GetLastSignaledValue()) != 0) {
+			return -1;
+		}
+		copy_frame_index = (copy_frame_index + 1) % copy_frames.size();
+		PROFILE_COUNTER("VirtualTextureUploads", upload_count);
+		return 0;
+	}
+
+	int VirtualTexture::Update()
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid()) {
+			return -1;
+		}
+		frame++;
+		ProcessFeedback();
+		if (UploadPages() != 0) {
+			return -1;
+		}
+		PROFILE_COUNTER("VirtualTextureReads", reading.size());
+		PROFILE_COUNTER("VirtualTextureEvictions", cache.GetEvictionCount());
+		return 0;
+	}
+
+	void VirtualTexture::Retire(ComPtr<ID3D12Resource>& buffer)
+	{
+		if (!buffer) return;
+		//今記録しているフレームまでの描画が使い終わってから破棄する
+		uint64_t fence_value = DirectX12Manager::Instance()->GetDrawQueue()->GetLastSignaledValue() + 1;
+		retired.push_back({ buffer, fence_value });
+		buffer.Reset();
+	}
+
+	int VirtualTexture::ResizeFeedback(uint32_t count)
+	{
+		Retire(feedback_buffer);
+		Retire(feedback_clear_buffer);
+		feedback_capacity = 0;
+		size_t size = static_cast<size_t>(count) * sizeof(uint32_t);
+		if (FAILED(CreateBuffer(size, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, feedback_buffer)) ||
+			FAILED(CreateBuffer(size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE, feedback_clear_buffer))) {
+			return -1;
+		}
+		//毎フレーム、このバッファからコピーしてフィードバックを空にする
+		void* mapped = nullptr;
+		if (FAILED(feedback_clear_buffer->Map(0, nullptr, &mapped))) {
+			return -1;
+		}
+		std::memset(mapped, 0xff, size);
+		feedback_clear_buffer->Unmap(0, nullptr);
+		feedback_capacity = count;
+		return 0;
+	}
+
+	int VirtualTexture::BeginFrame(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list, uint32_t width, uint32_t height)
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid() || !command_list || width == 0 || height == 0) {
+			return -1;
+		}
+		uint64_t completed_value = DirectX12Manager::Instance()->GetDrawQueue()->GetCompletedValue();
+		while (!retired.empty() && retired.front().fence_value <= completed_value) {
+			retired.pop_front();
+		}
+
+		uint32_t feedback_width = (width + settings.feedback_scale - 1) / settings.feedback_scale;
+		uint32_t feedback_height = (height + settings.feedback_scale - 1) / settings.feedback_scale;
+		feedback_count = feedback_width * feedback_height;
+		if (feedback_count > feedback_capacity && ResizeFeedback(feedback_count) != 0) {
+			return -1;
+		}
+		page_table.SetHeader(VirtualTexturePageTable::FeedbackWidth, feedback_width);
+
+		//テクスチャを登録すると表が伸びるので、足りなくなったら倍の大きさで作り直す
+		const std::vector<uint32_t>& data = page_table.GetData();
+		if (data.size() > table_capacity) {
+			uint32_t new_capacity = std::max(1u, table_capacity);
+			while (new_capacity < data.size())
+				new_capacity *= 2;
+			Retire(table_buffer);
+			table_capacity = 0;
+			if (FAILED(CreateBuffer(static_cast<size_t>(new_capacity) * sizeof(uint32_t), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_FLAG_NONE, table_buffer))) {
+				return -1;
+			}
+			table_capacity = new_capacity;
+			page_table.MarkAllDirty();
+		}
+		uint32_t dirty_begin = 0;
+		uint32_t dirty_count = 0;
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		if (page_table.TakeDirtyRange(dirty_begin, dirty_count)) {
+			//このフレーム番号のコンテキストは、前に使った時の実行を終えているので、同じアップロードバッファを使い回せる
+			UploadBuffer& upload = table_uploads[DirectX12Manager::Instance()->GetFrameIndex()];
+			size_t upload_size = static_cast<size_t>(dirty_count) * sizeof(uint32_t);
+			if (upload.size < upload_size) {
+				size_t new_size = std::max(upload_size, upload.size * 2);
+				if (FAILED(CreateBuffer(new_size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE, upload.buffer))) {
+					upload.size = 0;
+					page_table.MarkAllDirty();
+					return -1;
+				}
+				upload.size = new_size;
+			}
+			void* mapped = nullptr;
+			if (FAILED(upload.buffer->Map(0, nullptr, &mapped))) {
+				page_table.MarkAllDirty();
+				return -1;
+			}
+			std::memcpy(mapped, &data[dirty_begin], upload_size);
+			upload.buffer->Unmap(0, nullptr);
+			command_list->CopyBufferRegion(table_buffer.Get(), static_cast<UINT64>(dirty_begin) * sizeof(uint32_t), upload.buffer.Get(), 0, upload_size);
+
+			D3D12_RESOURCE_BARRIER barrier = {};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barrier.Transition.pResource = table_buffer.Get();
+			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+			barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			barriers.push_back(barrier);
+		}
+
+		//フィードバックを空(EMPTY)にしてから、シェーダーが書けるようにする
+		command_list->CopyBufferRegion(feedback_buffer.Get(), 0, feedback_clear_buffer.Get(), 0, static_cast<UINT64>(feedback_count) * sizeof(uint32_t));
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = feedback_buffer.Get();
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		barriers.push_back(barrier);
+		command_list->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+		return 0;
+	}
+
+	int VirtualTexture::EndFrame(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list)
+	{
+		PROFILE_FUNCTION();
+		if (!IsValid() || !command_list || !feedback_buffer) {
+			return -1;
+		}
+		auto it = std::find_if(readbacks.begin(), readbacks.end(), [](const FeedbackReadback& readback) { return readback.state == ReadbackState::Free; });
+		if (it == readbacks.end()) {
+			//読み戻しが追いついていない。このフレームのフィードバックは捨てる(バッファはコマンドリストの実行後にCOMMONに戻る)
+			return 0;
+		}
+		FeedbackReadback& readback = *it;
+		if (readback.capacity < feedback_count) {
+			readback.buffer.Reset();
+			readback.capacity = 0;
+			if (FAILED(CreateBuffer(static_cast<size_t>(feedback_capacity) * sizeof(uint32_t), D3D12_HEAP_TYPE_READBACK, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_NONE, readback.buffer))) {
+				return -1;
+			}
+			readback.capacity = feedback_capacity;
+		}
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = feedback_buffer.Get();
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+		command_list->ResourceBarrier(1, &barrier);
+		command_list->CopyBufferRegion(readback.buffer.Get(), 0, feedback_buffer.Get(), 0, static_cast<UINT64>(feedback_count) * sizeof(uint32_t));
+		readback.count = feedback_count;
+		readback.state = ReadbackState::Recorded;
+		return 0;
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS VirtualTexture::GetPageTableAddress() const
+	{
+		return table_buffer ? table_buffer->GetGPUVirtualAddress() : 0;
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS VirtualTexture::GetFeedbackAddress() const
+	{
+		return feedback_buffer ? feedback_buffer->GetGPUVirtualAddress() : 0;
+	}
+
+	void VirtualTexture::WorkerMain()
+	{
+		PROFILE_THREAD("VirtualTexture");
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_added.wait(lock, [this] { return stop_requested || !jobs.empty(); });
+				if (stop_requested) {
+					return;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			//ファイルはこのスレッドだけが読む(Registerで一番粗いページを読むのは、ジョブを積む前)
+			Result result;
+			result.page = job.page;
+			PageId id = VirtualTextureFeedback::Unpack(job.page);
+			result.data.resize(job.file->GetPageBytes());
+			result.result = job.file->ReadPage(id.mip, id.x, id.y, result.data.data());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				results.push_back(std::move(result));
+			}
+		}
+	}
+}
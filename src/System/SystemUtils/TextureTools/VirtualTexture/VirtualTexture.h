@@ -0,0 +1,179 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "System/SystemUtils/TextureTools/TiledTextureFile/TiledTextureFile.h"
+#include "System/SystemUtils/TextureTools/VirtualTextureFeedback/VirtualTextureFeedback.h"
+#include "System/SystemUtils/TextureTools/VirtualTexturePageCache/VirtualTexturePageCache.h"
+#include "System/SystemUtils/TextureTools/VirtualTexturePageTable/VirtualTexturePageTable.h"
+
+namespace System {
+	class Texture;
+	class CommandQueue;
+	class ID3D12DeviceContext;
+	template <class CommandList> class CommandStreamRecorder;
+
+	//-------------------------------------------------------------
+	// @brief 仮想テクスチャ(ページ単位で、画面に必要な所だけをVRAMに置くテクスチャ)を動かすクラス
+	// @details 1フレームの流れ
+	//			・シェーダー(virtual_texture.hlsli)は、欲しいページをフィードバックのバッファに書き、ページテーブルを引いて物理キャッシュから読む
+	//			・EndFrameでフィードバックを読み戻し用のバッファにコピーし、数フレーム後のUpdateで、
+	//			  VirtualTextureFeedbackが重複を除いて優先度の順に並べる
+	//			・キャッシュに無いページは、作業スレッドがTiledTextureFileから読む
+	//			・読み終わったページはUpdateでVirtualTexturePageCacheのスロットを決め(空きが無ければLRUで追い出す)、
+	//			  専用のコピーキューで物理キャッシュに転送する
+	//			・コピーキューは実行中のフレームの描画を、描画キューはコピーを、それぞれGPU側で待つ(CPUは止まらない)
+	//			・ページテーブルはBeginFrameで、書き換えた範囲だけを描画のコマンドリストでコピーする
+	//			物理キャッシュはミップを持たない1枚のテクスチャで、ページの縁のおかげでバイリニアで読める(ミップ間の補間はしない)
+	//-------------------------------------------------------------
+	class VirtualTexture
+	{
+	public:
+		static constexpr uint32_t INVALID_ID = 0xffffffff;
+
+		struct Settings {
+			uint32_t physical_pages_x = 16;			// 物理キャッシュの横のスロット数(256まで)
+			uint32_t physical_pages_y = 16;			// 物理キャッシュの縦のスロット数(256まで)
+			uint32_t feedback_scale = 8;			// フィードバックは、縦横この数のピクセルに1つだけ書く
+			uint32_t max_uploads_per_frame = 16;	// 1フレームに物理キャッシュへ転送するページの数
+			uint32_t max_reads_in_flight = 32;		// 作業スレッドに同時に頼むページの数
+			DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;	// ページのフォーマット(32bitの非圧縮のもの)
+		};
+
+	private:
+		enum class ReadbackState {
+			Free,		// 使える
+			Recorded,	// コピーをコマンドリストに積んだ(まだ実行に回していない)
+			Submitted,	// 実行に回した。fence_valueの完了を待っている
+		};
+		struct FeedbackReadback {
+			ComPtr<ID3D12Resource> buffer;
+			uint32_t capacity = 0;	// 要素の数
+			uint32_t count = 0;		// コピーした要素の数
+			uint64_t fence_value = 0;
+			ReadbackState state = ReadbackState::Free;
+		};
+		struct RegisteredTexture {
+			std::unique_ptr<TiledTextureFile> file;
+		};
+		// @brief 作業スレッドへの指示
+		struct Job {
+			uint32_t page = VirtualTextureFeedback::EMPTY;
+			TiledTextureFile* file = nullptr;
+		};
+		// @brief 読み終わったページ
+		struct Result {
+			uint32_t page = VirtualTextureFeedback::EMPTY;
+			std::vector<uint8_t> data;
+			int result = -1;
+			bool pinned = false;	// 追い出さないページ(一番粗いミップ)
+		};
+		// @brief コピーキューで使う、コマンドリストとアップロードバッファの組
+		struct CopyFrame {
+			std::unique_ptr<ID3D12DeviceContext> context;
+			ComPtr<ID3D12Resource> upload_buffer;
+		};
+		struct UploadBuffer {
+			ComPtr<ID3D12Resource> buffer;
+			size_t size = 0;
+		};
+		// @brief 描画キューが使い終わるのを待ってから破棄するバッファ
+		struct RetiredBuffer {
+			ComPtr<ID3D12Resource> buffer;
+			uint64_t fence_value = 0;
+		};
+
+		Settings settings;
+		uint32_t element_size = 0;
+		uint32_t padded_page_size = 0;	// 縁を含めたページの幅(テクセル)
+		uint32_t upload_row_pitch = 0;	// アップロードバッファ上の、ページの1行のバイト数
+		size_t upload_page_bytes = 0;	// アップロードバッファ上の、ページ1枚のバイト数
+
+		VirtualTextureFeedback analyzer;
+		VirtualTexturePageCache cache;
+		VirtualTexturePageTable page_table;
+		std::vector<RegisteredTexture> textures;
+		std::vector<VirtualTextureFeedback::Request> requests;	// 毎フレーム使い回す
+		std::unordered_set<uint32_t> reading;	// 作業スレッドに頼んで、まだ転送していないページ
+		std::deque<Result> completed;			// 読み終わったが、まだ転送していないページ
+		uint64_t frame = 0;
+
+		std::unique_ptr<Texture> physical_texture;
+		ComPtr<ID3D12Resource> table_buffer;
+		uint32_t table_capacity = 0;	// 要素の数
+		std::vector<UploadBuffer> table_uploads;	// 描画のフレーム毎
+		ComPtr<ID3D12Resource> feedback_buffer;
+		ComPtr<ID3D12Resource> feedback_clear_buffer;	// EMPTYで埋めたアップロードバッファ
+		uint32_t feedback_capacity = 0;	// 要素の数
+		uint32_t feedback_count = 0;	// このフレームで使う要素の数
+		std::vector<FeedbackReadback> readbacks;
+		std::deque<RetiredBuffer> retired;
+
+		std::unique_ptr<CommandQueue> copy_queue;
+		std::vector<CopyFrame> copy_frames;
+		uint32_t copy_frame_index = 0;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable job_added;
+		std::deque<Job> jobs;
+		std::vector<Result> results;
+		bool stop_requested = false;
+
+		void WorkerMain();
+		// @brief 読み戻し終わったフィードバックから、読むページを作業スレッドに頼む
+		void ProcessFeedback();
+		// @brief 読み終わったページを物理キャッシュへ転送するコマンドを積み、コピーキューで実行する
+		int UploadPages();
+		// @brief 古いバッファを、今記録しているフレームの描画が終わってから破棄するように預ける
+		void Retire(ComPtr<ID3D12Resource>& buffer);
+		int ResizeFeedback(uint32_t count);
+
+	public:
+		explicit VirtualTexture(const Settings& settings_);
+		~VirtualTexture();
+		VirtualTexture(const VirtualTexture&) = delete;
+		VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+		bool IsValid() const;
+
+		//-------------------------------------------------------------
+		// @brief 画像をTiledTextureFileの形式に変換して書き出す
+		// @details 幅と高さを2の累乗に揃え、ミップを作ってからページに区切る
+		// @param [in] format ページのフォーマット(Settings::formatと同じもの)
+		// @return 成功したらS_OK
+		//-------------------------------------------------------------
+		static HRESULT Cook(const std::wstring& src_path, const std::wstring& dst_path, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+
+		//-------------------------------------------------------------
+		// @brief TiledTextureFileを登録する
+		// @details 一番粗いミップのページは、その場で読んで固定する(何も無い所はこれで描かれる)
+		// @param [out] out_id シェーダーのSampleVirtualTextureに渡す番号
+		// @return 成功したらS_OK。フォーマットやページの大きさが合わなければE_INVALIDARG
+		//-------------------------------------------------------------
+		HRESULT Register(const std::wstring& path, uint32_t& out_id);
+
+		//-------------------------------------------------------------
+		// @brief 前のフレームまでのフィードバックから読むページを決め、読み終わったページを物理キャッシュに転送する
+		// @details 1フレームに1回、DrawBeginより前に呼ぶこと
+		// @return 成功したら0
+		//-------------------------------------------------------------
+		int Update();
+
+		//-------------------------------------------------------------
+		// @brief ページテーブルを更新し、フィードバックのバッファを空にするコマンドを積む
+		// @details 描画のコマンドリスト(の記録用のラッパー)で、仮想テクスチャを使う描画より前に積むこと
+		// @param [in] width,height 描画するピクセル数(フィードバックの大きさを決める)
+		//-------------------------------------------------------------
+		int BeginFrame(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list, uint32_t width, uint32_t height);
+		// @brief フィードバックを読み戻し用のバッファにコピーするコマンドを積む。仮想テクスチャを使う描画の後に積むこと
+		int EndFrame(CommandStreamRecorder<ID3D12GraphicsCommandList>* command_list);
+
+		D3D12_GPU_VIRTUAL_ADDRESS GetPageTableAddress() const;
+		D3D12_GPU_VIRTUAL_ADDRESS GetFeedbackAddress() const;
+		const VirtualTexturePageCache& GetCache() const { return cache; }
+		const VirtualTextureFeedback& GetAnalyzer() const { return analyzer; }
+	};
+}
@@ -0,0 +1,62 @@
+﻿#include "VirtualTextureFeedback.h"
+
+#include <algorithm>
+
+namespace System {
+
+	void VirtualTextureFeedback::SetMipCount(uint32_t texture, uint32_t mip_count)
+	{
+		if (texture >= MAX_TEXTURES) return;
+		mip_counts[texture] = std::min(mip_count, 1u << MIP_BITS);
+	}
+
+	void VirtualTextureFeedback::Analyze(const uint32_t* feedback, size_t count, std::vector<Request>& out_requests)
+	{
+		out_requests.clear();
+		sorted.clear();
+		hit_counts.clear();
+		if (!feedback) return;
+
+		//壊れた要素(登録されていないテクスチャ・無いミップ)を除いて並べ、同じページの数を数える
+		for (size_t i = 0; i < count; i++) {
+			uint32_t page = feedback[i];
+			if (page == EMPTY) continue;
+			analyzed_count++;
+			PageId id = Unpack(page);
+			if (id.texture >= MAX_TEXTURES || id.mip >= mip_counts[id.texture]) {
+				rejected_count++;
+				continue;
+			}
+			sorted.push_back(page);
+		}
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t begin = 0; begin < sorted.size();) {
+			size_t end = begin + 1;
+			while (end < sorted.size() && sorted[end] == sorted[begin])
+				end++;
+			uint32_t page = sorted[begin];
+			uint32_t hits = static_cast<uint32_t>(end - begin);
+			hit_counts[page] += hits;
+			//親にも同じ数を足す(一番粗いミップまで)
+			uint32_t mip_count = mip_counts[Unpack(page).texture];
+			for (uint32_t mip = Unpack(page).mip + 1; mip < mip_count; mip++) {
+				page = GetParent(page);
+				hit_counts[page] += hits;
+			}
+			begin = end;
+		}
+
+		out_requests.reserve(hit_counts.size());
+		for (const auto& [page, hits] : hit_counts) {
+			Request request;
+			request.page = page;
+			request.hits = hits;
+			request.priority = static_cast<uint64_t>(hits) << (2 * Unpack(page).mip);
+			out_requests.push_back(request);
+		}
+		std::sort(out_requests.begin(), out_requests.end(), [](const Request& a, const Request& b) {
+			if (a.priority != b.priority) return a.priority > b.priority;
+			return a.page < b.page;
+			});
+	}
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 仮想テクスチャのフィードバック(シェーダーが書いた、欲しいページの一覧)をまとめて、読み込む順を決めるクラス
+	// @details ・フィードバックの1要素は、ページを32bitに詰めたもの(Pack)。何も書かれなかった所はEMPTY
+	//			・同じページは1つにまとめ、書かれた数(画面上の面積に比例する)を数える
+	//			・要求されたページの親(粗いミップ)も全て要求に加える。粗いページは細かいページが無い間の代わりになるので、
+	//			  子の数を足して、子より先に読まれるようにする
+	//			・優先度は「書かれた数 × ページが覆う面積(4^mip)」。大きい順に並べる
+	//			デバイスには触らないので、作ったフィードバックを渡せばデバイス無しで確かめられる
+	//-------------------------------------------------------------
+	class VirtualTextureFeedback
+	{
+	public:
+		static constexpr uint32_t EMPTY = 0xffffffff;
+		static constexpr uint32_t MAX_TEXTURES = 15;	// テクスチャの番号の4bitのうち、15はEMPTYに使う
+		static constexpr uint32_t PAGE_BITS = 12;		// ページの座標のビット数(1つのミップで4096ページまで)
+		static constexpr uint32_t MIP_BITS = 4;
+
+		// @brief ページの場所
+		struct PageId {
+			uint32_t texture = 0;
+			uint32_t mip = 0;
+			uint32_t x = 0;
+			uint32_t y = 0;
+		};
+		// @brief 読み込みの要求
+		struct Request {
+			uint32_t page = EMPTY;	// Packしたページ
+			uint32_t hits = 0;		// 書かれた数(子の分を含む)
+			uint64_t priority = 0;
+		};
+
+		// @brief ページを32bitに詰める。x(12) | y(12) | mip(4) | テクスチャ(4)の順に下位から詰める(シェーダーのVTPackPageと同じ)
+		static uint32_t Pack(const PageId& page) {
+			return (page.texture << 28) | (page.mip << 24) | (page.y << PAGE_BITS) | page.x;
+		}
+		static PageId Unpack(uint32_t page) {
+			return { page >> 28, (page >> 24) & 0xf, page & 0xfff, (page >> PAGE_BITS) & 0xfff };
+		}
+		// @brief 1つ粗いミップの、このページを含むページ
+		static uint32_t GetParent(uint32_t page) {
+			PageId id = Unpack(page);
+			return Pack({ id.texture, id.mip + 1, id.x >> 1, id.y >> 1 });
+		}
+
+	private:
+		std::vector<uint32_t> mip_counts = std::vector<uint32_t>(MAX_TEXTURES, 0);	// テクスチャ毎のミップの段数。0なら登録されていない
+		std::vector<uint32_t> sorted;						// 毎フレーム使い回す
+		std::unordered_map<uint32_t, uint32_t> hit_counts;	// 毎フレーム使い回す
+		uint64_t analyzed_count = 0;
+		uint64_t rejected_count = 0;
+
+	public:
+		// @brief テクスチャのミップの段数を教える(0なら登録を外す)。登録されていないテクスチャの要素は捨てる
+		void SetMipCount(uint32_t texture, uint32_t mip_count);
+
+		//-------------------------------------------------------------
+		// @brief フィードバックから、読み込みの要求を作る
+		// @param [out] out_requests 重複の無い要求を、優先度の高い順に並べたもの(同じなら番号の順)
+		//-------------------------------------------------------------
+		void Analyze(const uint32_t* feedback, size_t count, std::vector<Request>& out_requests);
+
+		// @brief これまでに読んだ要素の数と、壊れていて捨てた要素の数(EMPTYは数えない)
+		uint64_t GetAnalyzedCount() const { return analyzed_count; }
+		uint64_t GetRejectedCount() const { return rejected_count; }
+	};
+}
@@ -0,0 +1,125 @@
+﻿#include "VirtualTexturePageCache.h"
+
+namespace System {
+
+	VirtualTexturePageCache::VirtualTexturePageCache(uint32_t slot_count, uint32_t min_age_)
+		:slots(slot_count), min_age(min_age_)
+	{
+		//小さい番号から使うように、逆順に積んでおく
+		free_slots.reserve(slot_count);
+		for (uint32_t i = slot_count; i > 0; i--)
+			free_slots.push_back(i - 1);
+		lookup.reserve(slot_count);
+	}
+
+	void VirtualTexturePageCache::Unlink(uint32_t slot)
+	{
+		Slot& s = slots[slot];
+		if (s.prev != INVALID_SLOT) slots[s.prev].next = s.next;
+		else if (lru_head == slot) lru_head = s.next;
+		if (s.next != INVALID_SLOT) slots[s.next].prev = s.prev;
+		else if (lru_tail == slot) lru_tail = s.prev;
+		s.prev = s.next = INVALID_SLOT;
+	}
+
+	void VirtualTexturePageCache::PushBack(uint32_t slot)
+	{
+		Slot& s = slots[slot];
+		s.prev = lru_tail;
+		s.next = INVALID_SLOT;
+		if (lru_tail != INVALID_SLOT) slots[lru_tail].next = slot;
+		else lru_head = slot;
+		lru_tail = slot;
+	}
+
+	uint32_t VirtualTexturePageCache::Find(uint32_t page) const
+	{
+		auto found = lookup.find(page);
+		return found != lookup.end() ? found->second : INVALID_SLOT;
+	}
+
+	bool VirtualTexturePageCache::Touch(uint32_t page, uint64_t frame)
+	{
+		uint32_t slot = Find(page);
+		if (slot == INVALID_SLOT) {
+			return false;
+		}
+		slots[slot].last_used_frame = frame;
+		Unlink(slot);
+		PushBack(slot);
+		return true;
+	}
+
+	uint32_t VirtualTexturePageCache::Allocate(uint32_t page, uint64_t frame, uint32_t& out_evicted_page)
+	{
+		out_evicted_page = INVALID_PAGE;
+		if (page == INVALID_PAGE) {
+			return INVALID_SLOT;
+		}
+		uint32_t slot = Find(page);
+		if (slot != INVALID_SLOT) {
+			Touch(page, frame);
+			return slot;
+		}
+		if (!free_slots.empty()) {
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		else {
+			//古い側から、追い出せるものを探す
+			for (uint32_t candidate = lru_head; candidate != INVALID_SLOT; candidate = slots[candidate].next) {
+				const Slot& s = slots[candidate];
+				//新しい側ほど最近使われているので、守る期間に入ったら先は見なくてよい
+				if (s.last_used_frame + min_age > frame) break;
+				if (s.state != SlotState::Resident || s.pinned) continue;
+				slot = candidate;
+				break;
+			}
+			if (slot == INVALID_SLOT) {
+				return INVALID_SLOT;
+			}
+			out_evicted_page = slots[slot].page;
+			lookup.erase(slots[slot].page);
+			Unlink(slot);
+			eviction_count++;
+		}
+		Slot& s = slots[slot];
+		s.page = page;
+		s.last_used_frame = frame;
+		s.state = SlotState::Loading;
+		s.pinned = false;
+		lookup[page] = slot;
+		PushBack(slot);
+		return slot;
+	}
+
+	void VirtualTexturePageCache::Commit(uint32_t slot)
+	{
+		if (slot >= slots.size() || slots[slot].state != SlotState::Loading) return;
+		slots[slot].state = SlotState::Resident;
+	}
+
+	void VirtualTexturePageCache::Free(uint32_t slot)
+	{
+		if (slot >= slots.size() || slots[slot].state == SlotState::Free) return;
+		Slot& s = slots[slot];
+		lookup.erase(s.page);
+		Unlink(slot);
+		s = Slot();
+		free_slots.push_back(slot);
+	}
+
+	void VirtualTexturePageCache::SetPinned(uint32_t slot, bool pinned)
+	{
+		if (slot >= slots.size() || slots[slot].state == SlotState::Free) return;
+		slots[slot].pinned = pinned;
+	}
+
+	std::vector<uint32_t> VirtualTexturePageCache::GetLruOrder() const
+	{
+		std::vector<uint32_t> order;
+		for (uint32_t slot = lru_head; slot != INVALID_SLOT; slot = slots[slot].next)
+			order.push_back(slot);
+		return order;
+	}
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 仮想テクスチャの物理キャッシュ(決まった数のスロット)に、どのページを置くかを管理するクラス
+	// @details ・スロットは Free → Loading(転送中) → Resident(使える) と進む
+	//			・空きが無ければ、最後に使われたフレームが一番古いResidentのスロットを追い出す(LRU)。
+	//			  min_ageフレーム以内に使われたもの・転送中のもの・固定したもの(一番粗いミップなど)は追い出さない
+	//			・Touchで、このフレームに使われたことを伝える(一番新しい側に移す)
+	//			デバイスには触らないので、デバイス無しで追い出しの順を確かめられる
+	//-------------------------------------------------------------
+	class VirtualTexturePageCache
+	{
+	public:
+		static constexpr uint32_t INVALID_SLOT = 0xffffffff;
+		static constexpr uint32_t INVALID_PAGE = 0xffffffff;
+
+		enum class SlotState {
+			Free,
+			Loading,
+			Resident,
+		};
+
+	private:
+		struct Slot {
+			uint32_t page = INVALID_PAGE;
+			uint64_t last_used_frame = 0;
+			SlotState state = SlotState::Free;
+			bool pinned = false;
+			uint32_t prev = INVALID_SLOT;	// LRUの古い側
+			uint32_t next = INVALID_SLOT;	// LRUの新しい側
+		};
+		std::vector<Slot> slots;
+		std::vector<uint32_t> free_slots;
+		std::unordered_map<uint32_t, uint32_t> lookup;	// ページからスロットを引く(Loadingを含む)
+		uint32_t lru_head = INVALID_SLOT;	// 一番古い
+		uint32_t lru_tail = INVALID_SLOT;	// 一番新しい
+		uint32_t min_age = 1;
+		uint64_t eviction_count = 0;
+
+		void Unlink(uint32_t slot);
+		void PushBack(uint32_t slot);
+
+	public:
+		// @param [in] min_age_ 使われてからこのフレーム数が経っていないものは追い出さない(1ならこのフレームに使われたものだけ守る)
+		VirtualTexturePageCache(uint32_t slot_count, uint32_t min_age_ = 1);
+
+		// @brief ページのスロット(LoadingかResident)。無ければINVALID_SLOT
+		uint32_t Find(uint32_t page) const;
+
+		// @brief ページがこのフレームに使われたことを伝える。キャッシュにあればtrue(Loadingを含む)
+		bool Touch(uint32_t page, uint64_t frame);
+
+		//-------------------------------------------------------------
+		// @brief ページを置くスロットを確保して、Loadingにする
+		// @param [out] out_evicted_page 追い出したページ。追い出さなければINVALID_PAGE
+		// @return スロット。既にあるページならそのスロット。空きも追い出せるものも無ければINVALID_SLOT
+		//-------------------------------------------------------------
+		uint32_t Allocate(uint32_t page, uint64_t frame, uint32_t& out_evicted_page);
+
+		// @brief 転送が終わったスロットを使えるようにする
+		void Commit(uint32_t slot);
+		// @brief スロットを空ける(転送の失敗など)
+		void Free(uint32_t slot);
+		// @brief 固定したスロットは追い出さない
+		void SetPinned(uint32_t slot, bool pinned);
+
+		uint32_t GetSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+		uint32_t GetFreeCount() const { return static_cast<uint32_t>(free_slots.size()); }
+		SlotState GetSlotState(uint32_t slot) const { return slots[slot].state; }
+		uint32_t GetSlotPage(uint32_t slot) const { return slots[slot].page; }
+		uint64_t GetEvictionCount() const { return eviction_count; }
+		// @brief 古い順にスロットを並べる(確かめる時に使う)
+		std::vector<uint32_t> GetLruOrder() const;
+	};
+}
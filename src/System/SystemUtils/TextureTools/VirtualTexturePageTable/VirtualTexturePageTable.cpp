@@ -0,0 +1,126 @@
+﻿#include "VirtualTexturePageTable.h"
+
+#include <algorithm>
+
+namespace System {
+
+	VirtualTexturePageTable::VirtualTexturePageTable()
+		:data(HEADER_SIZE + MAX_TEXTURES * INFO_STRIDE, 0)
+	{
+		MarkAllDirty();
+	}
+
+	void VirtualTexturePageTable::MarkDirty(uint32_t begin, uint32_t end)
+	{
+		dirty_begin = std::min(dirty_begin, begin);
+		dirty_end = std::max(dirty_end, end);
+	}
+
+	void VirtualTexturePageTable::SetHeader(HeaderIndex index, uint32_t value)
+	{
+		if (data[index] == value) return;
+		data[index] = value;
+		MarkDirty(index, index + 1);
+	}
+
+	uint32_t VirtualTexturePageTable::AddTexture(uint32_t width, uint32_t height, uint32_t page_size, uint32_t mip_count)
+	{
+		if (textures.size() >= MAX_TEXTURES || mip_count == 0 || mip_count > MAX_MIP_COUNT || page_size == 0) {
+			return INVALID_TEXTURE;
+		}
+		uint32_t texture = static_cast<uint32_t>(textures.size());
+		TextureInfo info;
+		info.width = width;
+		info.height = height;
+		info.mip_count = mip_count;
+		uint32_t* header = &data[HEADER_SIZE + texture * INFO_STRIDE];
+		header[0] = width;
+		header[1] = height;
+		header[2] = mip_count;
+		header[3] = 0;
+		for (uint32_t mip = 0; mip < mip_count; mip++) {
+			uint32_t pages_x = (std::max(1u, width >> mip) + page_size - 1) / page_size;
+			uint32_t pages_y = (std::max(1u, height >> mip) + page_size - 1) / page_size;
+			info.pages_x.push_back(pages_x);
+			info.pages_y.push_back(pages_y);
+			info.mip_offsets.push_back(static_cast<uint32_t>(data.size()));
+			header[4 + mip] = static_cast<uint32_t>(data.size());
+			//headerはdataの先頭側を指しているので、resizeの前に書き終えておく
+			data.resize(data.size() + static_cast<size_t>(pages_x) * pages_y, 0);
+			header = &data[HEADER_SIZE + texture * INFO_STRIDE];
+		}
+		textures.push_back(std::move(info));
+		MarkDirty(HEADER_SIZE + texture * INFO_STRIDE, static_cast<uint32_t>(data.size()));
+		return texture;
+	}
+
+	bool VirtualTexturePageTable::IsValidPage(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const
+	{
+		if (texture >= textures.size()) return false;
+		const TextureInfo& info = textures[texture];
+		return mip < info.mip_count && x < info.pages_x[mip] && y < info.pages_y[mip];
+	}
+
+	uint32_t VirtualTexturePageTable::GetEntry(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const
+	{
+		if (!IsValidPage(texture, mip, x, y)) return 0;
+		const TextureInfo& info = textures[texture];
+		return data[info.mip_offsets[mip] + y * info.pages_x[mip] + x];
+	}
+
+	template<class Pred>
+	void VirtualTexturePageTable::FillRegion(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t entry, Pred pred)
+	{
+		const TextureInfo& info = textures[texture];
+		//細かいミップほど、同じ範囲を覆うページが縦横2倍ずつ増える
+		for (uint32_t level = 0; level <= mip; level++) {
+			uint32_t target = mip - level;
+			uint32_t x0 = std::min(x << level, info.pages_x[target]);
+			uint32_t y0 = std::min(y << level, info.pages_y[target]);
+			uint32_t x1 = std::min((x + 1) << level, info.pages_x[target]);
+			uint32_t y1 = std::min((y + 1) << level, info.pages_y[target]);
+			if (x0 >= x1 || y0 >= y1) continue;
+			uint32_t offset = info.mip_offsets[target];
+			for (uint32_t py = y0; py < y1; py++) {
+				uint32_t* row = &data[offset + py * info.pages_x[target]];
+				for (uint32_t px = x0; px < x1; px++) {
+					if (pred(row[px])) row[px] = entry;
+				}
+			}
+			MarkDirty(offset + y0 * info.pages_x[target] + x0, offset + (y1 - 1) * info.pages_x[target] + x1);
+		}
+	}
+
+	void VirtualTexturePageTable::SetResident(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t slot_x, uint32_t slot_y)
+	{
+		if (!IsValidPage(texture, mip, x, y)) return;
+		uint32_t entry = MakeEntry(mip, slot_x, slot_y);
+		//無いか、これより粗いページを読んでいたものだけを書き換える(細かいページが既にあるものはそのまま)
+		FillRegion(texture, mip, x, y, entry, [mip](uint32_t current) {
+			return !IsValidEntry(current) || GetEntryMip(current) >= mip;
+			});
+	}
+
+	void VirtualTexturePageTable::SetEvicted(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y)
+	{
+		if (!IsValidPage(texture, mip, x, y)) return;
+		//親の要素は、親の範囲で一番細かいキャッシュにあるページを指している。一番粗いミップなら、何も読めなくなる
+		uint32_t parent_entry = mip + 1 < textures[texture].mip_count ? GetEntry(texture, mip + 1, x >> 1, y >> 1) : 0;
+		//このページを読んでいたもの(範囲の中でミップが同じもの)だけを書き換える
+		FillRegion(texture, mip, x, y, parent_entry, [mip](uint32_t current) {
+			return IsValidEntry(current) && GetEntryMip(current) == mip;
+			});
+	}
+
+	bool VirtualTexturePageTable::TakeDirtyRange(uint32_t& out_begin, uint32_t& out_count)
+	{
+		if (dirty_begin >= dirty_end) {
+			return false;
+		}
+		out_begin = dirty_begin;
+		out_count = dirty_end - dirty_begin;
+		dirty_begin = 0xffffffff;
+		dirty_end = 0;
+		return true;
+	}
+}
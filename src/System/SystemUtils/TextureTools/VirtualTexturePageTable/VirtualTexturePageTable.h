@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 仮想テクスチャのページテーブル(仮想のページから物理キャッシュのスロットを引く表)をCPU側で作るクラス
+	// @details GPUにはGetDataのuintの配列を、そのままStructuredBuffer<uint>として送る。並びは次の通り
+	//			・先頭のHEADER_SIZE個：物理キャッシュの横と縦のスロット数・ページの大きさ・縁の幅・物理キャッシュのSRVの番号・
+	//			  フィードバックの幅と縮小率
+	//			・テクスチャ毎にINFO_STRIDE個：幅・高さ・ミップの段数・(未使用)・ミップ毎の表の先頭の位置
+	//			・その後に、ミップ毎にページの行の順で並べた表
+	//			表の1要素は、そのページを描く時に読むスロット。ページが無ければ、キャッシュにある一番近い親(粗いミップ)のスロットを入れておく。
+	//			シェーダーは1回引くだけで、必ず何かしらのページ(粗くなる場合がある)を読める
+	//			デバイスには触らないので、デバイス無しで表の更新を確かめられる
+	//-------------------------------------------------------------
+	class VirtualTexturePageTable
+	{
+	public:
+		static constexpr uint32_t HEADER_SIZE = 8;
+		static constexpr uint32_t INFO_STRIDE = 16;
+		static constexpr uint32_t MAX_TEXTURES = 15;
+		static constexpr uint32_t MAX_MIP_COUNT = INFO_STRIDE - 4;
+		static constexpr uint32_t INVALID_TEXTURE = 0xffffffff;
+		static constexpr uint32_t VALID_BIT = 0x80000000;
+
+		// @brief ヘッダーの位置
+		enum HeaderIndex : uint32_t {
+			PhysicalPagesX,
+			PhysicalPagesY,
+			PageSize,
+			Border,
+			PhysicalSrvIndex,
+			FeedbackWidth,
+			FeedbackScale,
+		};
+
+		// @brief 表の1要素を作る。有効フラグ(1) | ミップ(4, 16bit目から) | スロットのy(8) | スロットのx(8)
+		static uint32_t MakeEntry(uint32_t mip, uint32_t slot_x, uint32_t slot_y) { return VALID_BIT | (mip << 16) | (slot_y << 8) | slot_x; }
+		static bool IsValidEntry(uint32_t entry) { return (entry & VALID_BIT) != 0; }
+		static uint32_t GetEntryMip(uint32_t entry) { return (entry >> 16) & 0xf; }
+
+	private:
+		struct TextureInfo {
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t mip_count = 0;
+			std::vector<uint32_t> pages_x;
+			std::vector<uint32_t> pages_y;
+			std::vector<uint32_t> mip_offsets;	// data上の、ミップ毎の表の先頭
+		};
+		std::vector<TextureInfo> textures;
+		std::vector<uint32_t> data;
+		uint32_t dirty_begin = 0xffffffff;
+		uint32_t dirty_end = 0;
+
+		void MarkDirty(uint32_t begin, uint32_t end);
+		//-------------------------------------------------------------
+		// @brief mipのページ(x, y)と、その子孫(細かいミップで同じ範囲を覆うページ)の要素のうち、predを満たすものをentryにする
+		//-------------------------------------------------------------
+		template<class Pred>
+		void FillRegion(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t entry, Pred pred);
+
+	public:
+		VirtualTexturePageTable();
+
+		// @brief ヘッダーの値を書き込む
+		void SetHeader(HeaderIndex index, uint32_t value);
+
+		//-------------------------------------------------------------
+		// @brief テクスチャを追加する(全てのページは無い状態から始まる)
+		// @param [in] width,height ミップ0の大きさ(2の累乗)
+		// @return テクスチャの番号。上限に達しているか、ミップが多すぎればINVALID_TEXTURE
+		//-------------------------------------------------------------
+		uint32_t AddTexture(uint32_t width, uint32_t height, uint32_t page_size, uint32_t mip_count);
+
+		// @brief ページをスロットに置いたことを表に書く(子孫のうち、これより粗いページを読んでいたものもこのページを読むようにする)
+		void SetResident(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t slot_x, uint32_t slot_y);
+		// @brief ページを追い出したことを表に書く(このページを読んでいたものは、親が読んでいるページを読むようにする)
+		void SetEvicted(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y);
+
+		bool IsValidPage(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const;
+		uint32_t GetEntry(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const;
+		uint32_t GetTextureCount() const { return static_cast<uint32_t>(textures.size()); }
+		uint32_t GetMipCount(uint32_t texture) const { return textures[texture].mip_count; }
+
+		const std::vector<uint32_t>& GetData() const { return data; }
+		//-------------------------------------------------------------
+		// @brief 前回から書き換えた範囲(1つにまとめたもの)を返して忘れる
+		// @return 書き換えていなければfalse
+		//-------------------------------------------------------------
+		bool TakeDirtyRange(uint32_t& out_begin, uint32_t& out_count);
+		// @brief 全てを転送し直す(GPUのバッファを作り直した時)
+		void MarkAllDirty() { MarkDirty(0, static_cast<uint32_t>(data.size())); }
+	};
+}
@@ -0,0 +1,85 @@
+﻿#include "WorkerPool.h"
+#include "System/Managers/ProfileManager/ProfileManager.h"
+
+namespace System {
+
+	WorkerPool::WorkerPool(unsigned int worker_count_, const char* thread_name_)
+		:thread_name(thread_name_), worker_count(worker_count_)
+	{
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	void WorkerPool::Run(unsigned int count, const std::function<void(unsigned int)>& task_)
+	{
+		//並列にする意味が無ければ、スレッドを起こさずにその場で処理する
+		if (worker_count == 0 || count <= 1) {
+			for (unsigned int i = 0; i < count; i++)
+				task_(i);
+			return;
+		}
+
+		std::lock_guard<std::mutex> run_lock(run_mutex);
+		if (workers.empty()) {
+			workers.reserve(worker_count);
+			for (unsigned int i = 0; i < worker_count; i++)
+				workers.emplace_back(&WorkerPool::WorkerMain, this);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			task = &task_;
+			task_count = count;
+			next_task.store(0, std::memory_order_relaxed);
+			busy_count = worker_count;
+			generation++;
+		}
+		wake.notify_all();
+
+		//呼び出したスレッドも仕事を取る
+		RunTasks();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return busy_count == 0; });
+		task = nullptr;
+	}
+
+	void WorkerPool::WorkerMain()
+	{
+		PROFILE_THREAD(thread_name);
+		uint64_t seen_generation = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen_generation]() { return quit || generation != seen_generation; });
+				if (quit)
+					return;
+				seen_generation = generation;
+			}
+			RunTasks();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busy_count == 0)
+					done.notify_one();
+			}
+		}
+	}
+
+	void WorkerPool::RunTasks()
+	{
+		for (;;) {
+			unsigned int index = next_task.fetch_add(1, std::memory_order_relaxed);
+			if (index >= task_count)
+				return;
+			(*task)(index);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace System {
+
+	//-------------------------------------------------------------
+	// @brief 使い回す作業スレッドで、番号の付いた仕事を並列に処理するクラス
+	// @details Runに渡した仕事を、呼び出したスレッドと作業スレッドで分け合って処理し、全て終わってから戻る。
+	//			・作業スレッドは最初に並列で処理するRunの時に立て、破棄するまで寝かせておく(毎回立てて待つより速い)
+	//			・どの仕事をどのスレッドが処理するかは決まっていないので、仕事同士は書き込み先が重ならないようにすること
+	//			・Runは複数のスレッドから呼んでもよい(1つずつ順に処理する)。仕事の中からRunを呼んではいけない
+	//-------------------------------------------------------------
+	class WorkerPool
+	{
+	private:
+		const char* thread_name = nullptr;
+		unsigned int worker_count = 0;
+		std::vector<std::thread> workers;
+
+		std::mutex run_mutex;	// Runを1つずつにする
+		std::mutex mutex;
+		std::condition_variable wake;	// 作業スレッドを起こす
+		std::condition_variable done;	// 作業スレッドが全て終わったことを知らせる
+		uint64_t generation = 0;	// Runの度に増やす(作業スレッドは、前に見た値と違えば起きる)
+		unsigned int busy_count = 0;	// 仕事を取り終わっていない作業スレッドの数
+		bool quit = false;
+
+		const std::function<void(unsigned int)>* task = nullptr;
+		unsigned int task_count = 0;
+		std::atomic<unsigned int> next_task = 0;
+
+		void WorkerMain();
+		void RunTasks();
+	public:
+		//-------------------------------------------------------------
+		// @param [in] worker_count_ 呼び出したスレッドとは別に立てる作業スレッドの数(0なら全て呼び出したスレッドで処理する)
+		// @param [in] thread_name_ プロファイラーに出す作業スレッドの名前(文字列リテラルを渡すこと)
+		//-------------------------------------------------------------
+		WorkerPool(unsigned int worker_count_, const char* thread_name_);
+		~WorkerPool();
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		unsigned int GetWorkerCount() const { return worker_count; }
+
+		//-------------------------------------------------------------
+		// @brief task(0)～task(count - 1)を並列に処理し、全て終わるまで待つ
+		// @param [in] count 仕事の数
+		// @param [in] task_ 仕事の番号を受け取って処理する関数
+		//-------------------------------------------------------------
+		void Run(unsigned int count, const std::function<void(unsigned int)>& task_);
+	};
+}
@@ -14,6 +14,50 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	// ウィンドウの情報を設定
 	System::WindowManager::Instance()->SetWindowInfo(class_name, window_name, window_width, window_height);
 
+	// コマンドライン引数で、GPUやディスプレイの無いマシン向けの動作に切り替える
+	// -headless  : ウィンドウを作らず、オフスクリーンに描画する
+	// -warp      : GPUを使わず、WARP(ソフトウェア実装)で動かす
+	// -frames N  : Nフレーム描画したら終了する
+	// -capture N path : Nフレーム目に積んだコマンドを記録してpathに保存する
+	// -profile path   : 終了時に、計測した区間をChromeのトレース形式でpathに書き出す
+	// -cook      : テクスチャをブロック圧縮したDDSに変換し直してから使う
+	{
+		std::string command_line = lpCmdLine ? lpCmdLine : "";
+		std::vector<std::string> args;
+		size_t pos = 0;
+		while (pos < command_line.size()) {
+			size_t end = command_line.find(' ', pos);
+			if (end == std::string::npos)
+				end = command_line.size();
+			if (end > pos)
+				args.push_back(command_line.substr(pos, end - pos));
+			pos = end + 1;
+		}
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == "-headless") {
+				System::WindowManager::Instance()->SetHeadless(true);
+			}
+			else if (args[i] == "-warp") {
+				System::DirectX12Manager::Instance()->SetAdapterType(System::DirectX12Manager::AdapterType::Warp);
+			}
+			else if (args[i] == "-frames" && i + 1 < args.size()) {
+				System::ApplicationManager::Instance()->SetMaxFrameCount(static_cast<unsigned int>(std::strtoul(args[++i].c_str(), nullptr, 10)));
+			}
+			else if (args[i] == "-capture" && i + 2 < args.size()) {
+				unsigned int frame = static_cast<unsigned int>(std::strtoul(args[++i].c_str(), nullptr, 10));
+				std::filesystem::path path = args[++i];
+				System::ApplicationManager::Instance()->SetCaptureFrame(frame, path.wstring());
+			}
+			else if (args[i] == "-profile" && i + 1 < args.size()) {
+				std::filesystem::path path = args[++i];
+				System::ApplicationManager::Instance()->SetProfileOutput(path.wstring());
+			}
+			else if (args[i] == "-cook") {
+				System::ApplicationManager::Instance()->SetCookTextures(true);
+			}
+		}
+	}
+
 	// アプリケーションを実行
 	//この中に前回用意したウィンドウ作成やDirectX12の初期化、メインループなどのコードが入っている
 	//更に、メインループ終了後のファイナライズ(終了処理)もこの中に入っている
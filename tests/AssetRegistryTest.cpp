@@ -0,0 +1,161 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Asset/AssetRegistry/AssetRegistry.h"
+
+#include <vector>
+
+using namespace System;
+
+namespace {
+	struct TestAsset {
+		int value = 0;
+	};
+	using Registry = AssetRegistry<TestAsset>;
+	using Handle = Registry::Handle;
+
+	//読み込んだことにして、アセットを渡す
+	bool Load(Registry& registry, Handle handle, int value)
+	{
+		std::unique_ptr<TestAsset> asset = std::make_unique<TestAsset>();
+		asset->value = value;
+		return registry.SetLoaded(handle, asset);
+	}
+}
+
+int main()
+{
+	//同じパスは、大文字と小文字・'\\'と'/'の違いを無視して同じハンドルになる
+	{
+		Registry registry;
+		bool created = false;
+		Handle a = registry.Acquire(L"Assets/Textures/Wood.png", created);
+		CHECK(a.IsValid() && created);
+		Handle b = registry.Acquire(L"assets\\textures\\WOOD.PNG", created);
+		CHECK(b == a && !created);
+		CHECK(registry.GetRefCount(a) == 2);
+		CHECK(registry.Find(L"ASSETS/textures\\wood.png") == a);
+		CHECK(Registry::HashPath(L"A\\B") == Registry::HashPath(L"a/b"));
+		CHECK(Registry::IsSamePath(L"A\\B", L"a/b"));
+		//違うパスは別のハンドル
+		Handle c = registry.Acquire(L"Assets/Textures/Wood2.png", created);
+		CHECK(c != a && created);
+		CHECK(!Registry::IsSamePath(L"a/b", L"a/bc"));
+		CHECK(registry.GetAliveCount() == 2);
+		CHECK(!registry.Find(L"Assets/Textures/Stone.png").IsValid());
+	}
+
+	//破棄待ちのアセットは、フェンスを通過するまで破棄しない
+	{
+		Registry registry;
+		bool created = false;
+		Handle a = registry.Acquire(L"a.png", created);
+		CHECK(Load(registry, a, 1));
+		CHECK(registry.GetState(a) == AssetState::Ready && registry.Get(a)->value == 1);
+		registry.AddRef(a);
+		//参照が残っている間は破棄待ちにしない
+		CHECK(!registry.Release(a, 10));
+		CHECK(registry.IsAlive(a) && registry.GetRetiredCount() == 0);
+		CHECK(registry.Release(a, 10));
+		//破棄待ちの間は引けず、パスでも見つからない
+		CHECK(!registry.IsAlive(a) && registry.Get(a) == nullptr);
+		CHECK(!registry.Find(L"a.png").IsValid());
+		CHECK(registry.GetAliveCount() == 0 && registry.GetRetiredCount() == 1);
+
+		std::vector<int> destroyed;
+		auto on_destroy = [&](uint32_t, TestAsset* asset) { destroyed.push_back(asset ? asset->value : -1); };
+		CHECK(registry.CollectRetired(9, on_destroy) == 0);
+		CHECK(destroyed.empty() && registry.GetRetiredCount() == 1);
+		CHECK(registry.CollectRetired(10, on_destroy) == 1);
+		CHECK(destroyed.size() == 1 && destroyed[0] == 1);
+		CHECK(registry.GetRetiredCount() == 0);
+		//2回目は何もしない
+		CHECK(registry.CollectRetired(100, on_destroy) == 0);
+	}
+
+	//フェンス値の小さいものから、通過した分だけ破棄する
+	{
+		Registry registry;
+		bool created = false;
+		Handle a = registry.Acquire(L"a.png", created);
+		Handle b = registry.Acquire(L"b.png", created);
+		Handle c = registry.Acquire(L"c.png", created);
+		registry.Release(a, 1);
+		registry.Release(b, 2);
+		registry.Release(c, 3);
+		std::vector<uint32_t> destroyed;
+		auto on_destroy = [&](uint32_t index, TestAsset*) { destroyed.push_back(index); };
+		CHECK(registry.CollectRetired(2, on_destroy) == 2);
+		CHECK(destroyed.size() == 2 && destroyed[0] == a.index && destroyed[1] == b.index);
+		CHECK(registry.GetRetiredCount() == 1);
+		CHECK(registry.CollectRetired(3, on_destroy) == 1);
+	}
+
+	//破棄したスロットを使い回しても、古いハンドルでは引けない
+	{
+		Registry registry;
+		bool created = false;
+		Handle old_handle = registry.Acquire(L"a.png", created);
+		CHECK(Load(registry, old_handle, 1));
+		registry.Release(old_handle, 1);
+		registry.CollectRetired(1);
+
+		Handle new_handle = registry.Acquire(L"b.png", created);
+		CHECK(created);
+		CHECK(new_handle.index == old_handle.index && new_handle.generation != old_handle.generation);
+		CHECK(Load(registry, new_handle, 2));
+		CHECK(registry.Get(new_handle)->value == 2);
+		CHECK(registry.Get(old_handle) == nullptr);
+		CHECK(!registry.IsAlive(old_handle));
+		CHECK(registry.GetState(old_handle) == AssetState::Failed);
+		CHECK(registry.GetRefCount(old_handle) == 0);
+		CHECK(!registry.AddRef(old_handle));
+		CHECK(!registry.Release(old_handle, 2));
+		CHECK(!registry.SetFailed(old_handle));
+		CHECK(!Load(registry, old_handle, 3));
+		//古いハンドルを使っても、新しいアセットは変わらない
+		CHECK(registry.GetRefCount(new_handle) == 1 && registry.Get(new_handle)->value == 2);
+		//同じパスを読み直すと、別の世代のハンドルになる
+		Handle reloaded = registry.Acquire(L"a.png", created);
+		CHECK(created && reloaded != old_handle);
+		//無効なハンドルでは何も引けない
+		CHECK(registry.Get(Handle{}) == nullptr && !Handle{}.IsValid());
+	}
+
+	//読み込み中に参照が無くなったら、SetLoadedはfalseを返してアセットを受け取らない
+	{
+		Registry registry;
+		bool created = false;
+		Handle a = registry.Acquire(L"a.png", created);
+		CHECK(registry.GetState(a) == AssetState::Loading && registry.Get(a) == nullptr);
+		registry.Release(a, 5);
+		std::unique_ptr<TestAsset> asset = std::make_unique<TestAsset>();
+		//破棄待ちの間
+		CHECK(!registry.SetLoaded(a, asset));
+		CHECK(asset != nullptr);
+		CHECK(!registry.SetFailed(a));
+		//破棄された後
+		registry.CollectRetired(5);
+		CHECK(!registry.SetLoaded(a, asset));
+		CHECK(asset != nullptr);
+	}
+
+	//Clearは破棄待ちも含めて全て破棄する
+	{
+		Registry registry;
+		bool created = false;
+		Handle a = registry.Acquire(L"a.png", created);
+		Handle b = registry.Acquire(L"b.png", created);
+		Handle c = registry.Acquire(L"c.png", created);
+		Load(registry, a, 1);
+		Load(registry, b, 2);
+		registry.Release(b, 100);
+		//読み込まないまま参照が無くなったものは、破棄するアセットが無い
+		registry.Release(c, 100);
+		std::vector<int> destroyed;
+		registry.Clear([&](uint32_t, TestAsset* asset) { destroyed.push_back(asset ? asset->value : -1); });
+		CHECK(destroyed.size() == 2 && destroyed[0] == 1 && destroyed[1] == 2);
+		CHECK(registry.GetAliveCount() == 0 && registry.GetRetiredCount() == 0);
+		CHECK(!registry.IsAlive(a));
+	}
+
+	return TestResult();
+}
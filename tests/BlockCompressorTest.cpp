@@ -0,0 +1,143 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/BlockCompressor/BlockCompressor.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace System;
+using Format = BlockCompressor::Format;
+
+namespace {
+	constexpr Format FORMATS[] = { Format::BC1, Format::BC3, Format::BC4, Format::BC5, Format::BC7 };
+
+	//滑らかなグラデーションに、少しだけ細かい模様を乗せた画像
+	std::vector<uint8_t> MakeImage(size_t width, size_t height)
+	{
+		std::vector<uint8_t> image(width * height * 4);
+		for (size_t y = 0; y < height; y++) {
+			for (size_t x = 0; x < width; x++) {
+				uint8_t* pixel = &image[(y * width + x) * 4];
+				pixel[0] = static_cast<uint8_t>(x * 255 / std::max<size_t>(1, width - 1));
+				pixel[1] = static_cast<uint8_t>(y * 255 / std::max<size_t>(1, height - 1));
+				pixel[2] = static_cast<uint8_t>(128 + 64 * std::sin(x * 0.3) * std::cos(y * 0.2));
+				pixel[3] = static_cast<uint8_t>(255 - (x + y) % 64);
+			}
+		}
+		return image;
+	}
+
+	std::vector<uint8_t> Compress(const BlockCompressor& compressor, Format format, const std::vector<uint8_t>& image, size_t width, size_t height)
+	{
+		size_t row_pitch = BlockCompressor::GetRowPitch(format, width);
+		std::vector<uint8_t> blocks(row_pitch * BlockCompressor::GetRowCount(height), 0xCD);
+		compressor.Compress(format, image.data(), width, height, width * 4, blocks.data(), row_pitch);
+		return blocks;
+	}
+
+	std::vector<uint8_t> Decompress(Format format, const std::vector<uint8_t>& blocks, size_t width, size_t height, bool* out_result = nullptr)
+	{
+		std::vector<uint8_t> image(width * height * 4, 0);
+		bool result = BlockCompressor::Decompress(format, blocks.data(), width, height, BlockCompressor::GetRowPitch(format, width), image.data(), width * 4);
+		if (out_result)
+			*out_result = result;
+		return image;
+	}
+
+	const uint8_t* Pixel(const std::vector<uint8_t>& image, size_t width, size_t x, size_t y) { return &image[(y * width + x) * 4]; }
+}
+
+int main()
+{
+	//BC1: 赤(0xF800)と青(0x001F)の4色モード。インデックスは1ピクセル2bitで、ピクセル0が下位
+	{
+		std::vector<uint8_t> block = { 0x00, 0xF8, 0x1F, 0x00, 0b11100100, 0, 0, 0 };
+		std::vector<uint8_t> image = Decompress(Format::BC1, block, 4, 4);
+		const uint8_t expected[4][4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 170, 0, 85, 255 }, { 85, 0, 170, 255 } };
+		for (int i = 0; i < 4; i++)
+			CHECK(std::memcmp(Pixel(image, 4, i, 0), expected[i], 4) == 0);
+		CHECK(std::memcmp(Pixel(image, 4, 0, 3), expected[0], 4) == 0);
+	}
+
+	//BC4: 255と0の8段階。インデックスは1ピクセル3bit。持っていないチャンネルは0、アルファは255
+	{
+		std::vector<uint8_t> block = { 255, 0, 0b11010001, 0, 0, 0, 0, 0 };
+		std::vector<uint8_t> image = Decompress(Format::BC4, block, 4, 4);
+		CHECK(Pixel(image, 4, 0, 0)[0] == 0);			// インデックス1
+		CHECK(Pixel(image, 4, 1, 0)[0] == 219);			// インデックス2: (6 * 255 + 3) / 7
+		CHECK(Pixel(image, 4, 2, 0)[0] == 182);			// インデックス3: (5 * 255 + 3) / 7
+		CHECK(Pixel(image, 4, 3, 0)[0] == 255);			// インデックス0
+		CHECK(Pixel(image, 4, 3, 0)[1] == 0 && Pixel(image, 4, 3, 0)[2] == 0 && Pixel(image, 4, 3, 0)[3] == 255);
+	}
+
+	//BC7: モード6以外のブロックは戻せない
+	{
+		std::vector<uint8_t> mode6(16, 0);
+		mode6[0] = 0x40;
+		bool result = false;
+		std::vector<uint8_t> image = Decompress(Format::BC7, mode6, 4, 4, &result);
+		CHECK(result && Pixel(image, 4, 2, 2)[0] == 0 && Pixel(image, 4, 2, 2)[3] == 0);
+		std::vector<uint8_t> mode0(16, 0);
+		mode0[0] = 0x01;
+		Decompress(Format::BC7, mode0, 4, 4, &result);
+		CHECK(!result);
+	}
+
+	//PSNR: 形式が持っているチャンネルだけを比べる
+	{
+		std::vector<uint8_t> a(8 * 8 * 4, 100);
+		std::vector<uint8_t> b = a;
+		CHECK(std::isinf(BlockCompressor::ComputePSNR(Format::BC1, a.data(), 32, b.data(), 32, 8, 8)));
+		//全てのピクセルのRが16違うと、MSEは256
+		for (size_t i = 0; i < b.size(); i += 4)
+			b[i] += 16;
+		double expected = 10.0 * std::log10(255.0 * 255.0 / 256.0);
+		CHECK(std::fabs(BlockCompressor::ComputePSNR(Format::BC4, a.data(), 32, b.data(), 32, 8, 8) - expected) < 1e-9);
+		//BC5はRGの2チャンネルで平均するので、MSEは半分
+		expected = 10.0 * std::log10(255.0 * 255.0 / 128.0);
+		CHECK(std::fabs(BlockCompressor::ComputePSNR(Format::BC5, a.data(), 32, b.data(), 32, 8, 8) - expected) < 1e-9);
+		//BC4はGの違いを見ない
+		std::vector<uint8_t> c = a;
+		for (size_t i = 1; i < c.size(); i += 4)
+			c[i] = 0;
+		CHECK(std::isinf(BlockCompressor::ComputePSNR(Format::BC4, a.data(), 32, c.data(), 32, 8, 8)));
+		CHECK(!std::isinf(BlockCompressor::ComputePSNR(Format::BC5, a.data(), 32, c.data(), 32, 8, 8)));
+	}
+
+	//圧縮して戻した画像の品質。SSEの有無やスレッド数で結果は変わらない
+	{
+		constexpr size_t WIDTH = 67;
+		constexpr size_t HEIGHT = 45;
+		const double MIN_PSNR[] = { 30.0, 30.0, 40.0, 40.0, 35.0 };
+		std::vector<uint8_t> image = MakeImage(WIDTH, HEIGHT);
+		BlockCompressor multi_thread(4);
+		BlockCompressor scalar(1);
+		scalar.SetSimdEnabled(false);
+		for (size_t f = 0; f < std::size(FORMATS); f++) {
+			std::vector<uint8_t> blocks = Compress(multi_thread, FORMATS[f], image, WIDTH, HEIGHT);
+			CHECK(blocks == Compress(scalar, FORMATS[f], image, WIDTH, HEIGHT));
+			bool result = false;
+			std::vector<uint8_t> decoded = Decompress(FORMATS[f], blocks, WIDTH, HEIGHT, &result);
+			CHECK(result);
+			double psnr = BlockCompressor::ComputePSNR(FORMATS[f], image.data(), WIDTH * 4, decoded.data(), WIDTH * 4, WIDTH, HEIGHT);
+			if (psnr < MIN_PSNR[f])
+				std::printf("format %zu: PSNR %.2f dB\n", f, psnr);
+			CHECK(psnr >= MIN_PSNR[f]);
+		}
+	}
+
+	//4の倍数でない小さい画像。はみ出した分は端のピクセルで埋め、単色ならほぼそのまま戻る
+	{
+		const size_t sizes[][2] = { { 1, 1 }, { 3, 5 }, { 5, 1 }, { 13, 7 } };
+		for (const auto& size : sizes) {
+			std::vector<uint8_t> image(size[0] * size[1] * 4);
+			for (size_t i = 0; i < image.size(); i++)
+				image[i] = static_cast<uint8_t>(40 + i % 4 * 60);
+			for (Format format : FORMATS) {
+				std::vector<uint8_t> decoded = Decompress(format, Compress(BlockCompressor(2), format, image, size[0], size[1]), size[0], size[1]);
+				CHECK(BlockCompressor::ComputePSNR(format, image.data(), size[0] * 4, decoded.data(), size[0] * 4, size[0], size[1]) >= 40.0);
+			}
+		}
+	}
+
+	return TestResult();
+}
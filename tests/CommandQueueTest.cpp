@@ -0,0 +1,186 @@
+﻿#include "TestCommon.h"
+#include "NullDevice.h"
+#include "System/SystemUtils/CommandQueue/CommandQueue.h"
+#include "System/SystemUtils/DeviceContext/ID3D12DeviceContext.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace System;
+
+namespace {
+	//DirectX12Managerと同じ数の描画コンテキストを回す
+	constexpr size_t FRAME_COUNT = 3;
+
+	NullCommandQueue* GetNullQueue(const CommandQueue& queue)
+	{
+		return static_cast<NullCommandQueue*>(queue.GetCommandQueue());
+	}
+	NullCommandAllocator* GetNullAllocator(const ID3D12DeviceContext& context)
+	{
+		return static_cast<NullCommandAllocator*>(context.GetCommandAllocator());
+	}
+
+	//DirectX12Manager::DrawBeginからDrawEndまでと同じ順で、1フレーム分を積む
+	int RunFrame(CommandQueue& queue, ID3D12DeviceContext& context)
+	{
+		if (context.ResetCommandList() != 0) return -1;
+		if (context.CloseCommandList() != 0) return -1;
+		std::vector<ID3D12DeviceContext*> contexts = { &context };
+		return queue.Execute(contexts);
+	}
+}
+
+int main()
+{
+	//デバイスが無い、またはフェンスが作れなければ、キューは無効で何も積めない
+	{
+		CommandQueue no_device(nullptr, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(!no_device.IsValid());
+		CHECK(no_device.Execute(std::vector<ID3D12CommandList*>()) == -1);
+		CHECK(no_device.GetCompletedValue() == 0);
+
+		NullDevice device;
+		device.SetFailFence(true);
+		CommandQueue no_fence(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(!no_fence.IsValid());
+
+		ID3D12DeviceContext no_context(nullptr, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(!no_context.IsValid());
+		CHECK(no_context.CloseCommandList() == -1 && no_context.ResetCommandList() == -1);
+	}
+
+	//実行する度にフェンス値が1つ進み、コンテキストは自分の値を覚える
+	{
+		NullDevice device;
+		CommandQueue queue(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		ID3D12DeviceContext a(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		ID3D12DeviceContext b(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(queue.IsValid() && a.IsValid() && b.IsValid());
+		//作った直後のコマンドリストは閉じている
+		CHECK(static_cast<NullGraphicsCommandList*>(a.GetCommandList())->IsClosed());
+		CHECK(RunFrame(queue, a) == 0);
+		CHECK(RunFrame(queue, b) == 0);
+		CHECK(queue.GetLastSignaledValue() == 2);
+		CHECK(a.GetLastSignaledFenceValue() == 1 && b.GetLastSignaledFenceValue() == 2);
+		CHECK(queue.GetCompletedValue() == 2);
+		CHECK(GetNullQueue(queue)->GetExecutedListCount() == 2);
+		//GPUが終わっていれば、待たずに戻る
+		CHECK(queue.WaitForCompletion(&a) == 0);
+		CHECK(queue.WaitForCompletionAll() == 0);
+		CHECK(queue.WaitForCompletion(nullptr) == -1);
+		//閉じる前に閉じ直したり、閉じていないのにリセットしたりはできない
+		CHECK(a.ResetCommandList() == 0);
+		CHECK(a.ResetCommandList() == -1);
+		CHECK(a.CloseCommandList() == 0);
+		CHECK(a.CloseCommandList() == -1);
+	}
+
+	//フレームペーシング: GPUが実行中のコンテキストはリセットできず、WaitForCompletionはGPUが通過するまで戻らない
+	{
+		NullDevice device;
+		CommandQueue queue(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		std::vector<std::unique_ptr<ID3D12DeviceContext>> contexts;
+		for (size_t i = 0; i < FRAME_COUNT; i++)
+			contexts.push_back(std::make_unique<ID3D12DeviceContext>(&device, D3D12_COMMAND_LIST_TYPE_DIRECT));
+		NullCommandQueue* gpu = GetNullQueue(queue);
+
+		//GPUを止めて、全てのコンテキストでフレームを積む
+		gpu->SetPaused(true);
+		for (size_t i = 0; i < FRAME_COUNT; i++)
+			CHECK(RunFrame(queue, *contexts[i]) == 0);
+		CHECK(queue.GetCompletedValue() == 0 && gpu->GetPendingCount() == FRAME_COUNT);
+		//1周して戻ってきたコンテキストは、まだGPUが使っている
+		CHECK(FAILED(contexts[0]->ResetCommandList()));
+		CHECK(GetNullAllocator(*contexts[0])->GetRejectedResetCount() == 1);
+
+		//別のスレッドでGPUを進め、それまでWaitForCompletionが戻らないことを確かめる
+		std::atomic<bool> gpu_resumed = false;
+		std::thread gpu_thread([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			gpu_resumed = true;
+			gpu->SetPaused(false);
+			});
+		CHECK(queue.WaitForCompletion(contexts[0].get()) == 0);
+		CHECK(gpu_resumed);
+		gpu_thread.join();
+		CHECK(queue.GetCompletedValue() == FRAME_COUNT);
+
+		//GPUが通過した後なら、リセットして次のフレームを積める
+		int resets_before = GetNullAllocator(*contexts[0])->GetResetCount();
+		CHECK(RunFrame(queue, *contexts[0]) == 0);
+		CHECK(GetNullAllocator(*contexts[0])->GetResetCount() == resets_before + 1);
+
+		//DirectX12Manager::DrawEndと同じ順で回せば、アロケーターを使用中にリセットすることは無い
+		gpu->SetPaused(true);
+		size_t index = 1;
+		std::thread gpu_steps([&]() {
+			//1フレーム毎に少し遅れて追いつくGPU
+			for (int i = 0; i < 30; i++) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				gpu->Run();
+			}
+			gpu->SetPaused(false);
+			});
+		for (int frame = 0; frame < 30; frame++) {
+			CHECK(RunFrame(queue, *contexts[index]) == 0);
+			index = (index + 1) % FRAME_COUNT;
+			CHECK(queue.WaitForCompletion(contexts[index].get()) == 0);
+		}
+		gpu_steps.join();
+		CHECK(queue.WaitForCompletionAll() == 0);
+		CHECK(queue.GetCompletedValue() == queue.GetLastSignaledValue());
+		for (size_t i = 1; i < FRAME_COUNT; i++)
+			CHECK(GetNullAllocator(*contexts[i])->GetRejectedResetCount() == 0);
+	}
+
+	//WaitForCompletionAllは、最後に積んだものが終わるまで待つ
+	{
+		NullDevice device;
+		CommandQueue queue(&device, D3D12_COMMAND_LIST_TYPE_COPY);
+		ID3D12DeviceContext context(&device, D3D12_COMMAND_LIST_TYPE_COPY);
+		NullCommandQueue* gpu = GetNullQueue(queue);
+		gpu->SetPaused(true);
+		CHECK(RunFrame(queue, context) == 0);
+		std::atomic<bool> gpu_resumed = false;
+		std::thread gpu_thread([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			gpu_resumed = true;
+			gpu->SetPaused(false);
+			});
+		CHECK(queue.WaitForCompletionAll() == 0);
+		CHECK(gpu_resumed);
+		gpu_thread.join();
+	}
+
+	//WaitForQueue: 別のキューのフェンスが進むまで、後から積んだコマンドをGPU側で待たせる(CPUは待たない)
+	{
+		NullDevice device;
+		CommandQueue copy_queue(&device, D3D12_COMMAND_LIST_TYPE_COPY);
+		CommandQueue draw_queue(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		ID3D12DeviceContext copy_context(&device, D3D12_COMMAND_LIST_TYPE_COPY);
+		ID3D12DeviceContext draw_context(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+		//コピーが終わっていない
+		GetNullQueue(copy_queue)->SetPaused(true);
+		CHECK(RunFrame(copy_queue, copy_context) == 0);
+		uint64_t copy_value = copy_queue.GetLastSignaledValue();
+		CHECK(draw_queue.WaitForQueue(&copy_queue, copy_value) == 0);
+		CHECK(GetNullQueue(draw_queue)->GetWaitCount() == 1);
+		CHECK(RunFrame(draw_queue, draw_context) == 0);
+		//描画はコピーを待っているので、まだ終わらない
+		CHECK(draw_queue.GetCompletedValue() == 0);
+
+		//コピーが終われば、描画も進む
+		GetNullQueue(copy_queue)->SetPaused(false);
+		GetNullQueue(draw_queue)->Run();
+		CHECK(draw_queue.GetCompletedValue() == draw_queue.GetLastSignaledValue());
+
+		//既に通過した値なら、待たせない
+		CHECK(draw_queue.WaitForQueue(&copy_queue, copy_value) == 0);
+		CHECK(GetNullQueue(draw_queue)->GetWaitCount() == 1);
+		CHECK(draw_queue.WaitForQueue(nullptr, 1) == -1);
+	}
+
+	return TestResult();
+}
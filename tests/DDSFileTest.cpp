@@ -0,0 +1,172 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/DDSFile/DDSFile.h"
+
+using namespace System;
+
+namespace {
+	D3D12_RESOURCE_DESC MakeDesc(D3D12_RESOURCE_DIMENSION dimension, UINT64 width, UINT height, UINT16 depth_or_array_size, UINT16 mip_levels, DXGI_FORMAT format)
+	{
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = dimension;
+		desc.Width = width;
+		desc.Height = height;
+		desc.DepthOrArraySize = depth_or_array_size;
+		desc.MipLevels = mip_levels;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	}
+
+	void Write32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+	{
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	//ヘッダーだけを書いたDDSを作る(データ部分は0で埋め、data_size分の長さにする)
+	//オフセットはマジックを含めたファイルの先頭から。ヘッダーは4バイト目から124バイト
+	std::vector<uint8_t> MakeDDS(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t four_cc, size_t data_size)
+	{
+		std::vector<uint8_t> data(4 + 124 + data_size, 0);
+		Write32(data, 0, 0x20534444);	// "DDS "
+		Write32(data, 4, 124);
+		Write32(data, 12, height);
+		Write32(data, 16, width);
+		Write32(data, 28, mip_count);
+		Write32(data, 76, 32);			// ピクセルフォーマットの大きさ
+		Write32(data, 80, 0x4);			// DDPF_FOURCC
+		Write32(data, 84, four_cc);
+		return data;
+	}
+
+	constexpr uint32_t FOURCC_DXT1 = 0x31545844;
+	constexpr uint32_t FOURCC_DX10 = 0x30315844;
+	constexpr size_t DX10_HEADER_SIZE = 20;
+}
+
+int main()
+{
+	//407x400のRGBA8、9ミップ。行は256バイト、サブリソースは512バイトに揃う
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(D3D12_RESOURCE_DIMENSION_TEXTURE2D, 407, 400, 1, 9, DXGI_FORMAT_R8G8B8A8_UNORM);
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layouts[9];
+		UINT row_counts[9];
+		UINT64 row_sizes[9];
+		UINT64 total = 0;
+		CHECK(DDSFile::GetCopyableFootprints(desc, 0, 9, 0, layouts, row_counts, row_sizes, &total) == S_OK);
+		CHECK(layouts[0].Offset == 0 && layouts[0].Footprint.Width == 407 && layouts[0].Footprint.Height == 400);
+		CHECK(layouts[0].Footprint.RowPitch == 1792 && row_counts[0] == 400 && row_sizes[0] == 1628);
+		//399 * 1792 + 1628 = 716636を512に揃えて716800
+		CHECK(layouts[1].Offset == 716800 && layouts[1].Footprint.Width == 203 && layouts[1].Footprint.Height == 200);
+		CHECK(layouts[1].Footprint.RowPitch == 1024 && row_sizes[1] == 812);
+		//199 * 1024 + 812 = 204588を揃えて204800
+		CHECK(layouts[2].Offset == 921600 && layouts[2].Footprint.Width == 101 && layouts[2].Footprint.RowPitch == 512);
+		CHECK(layouts[8].Footprint.Width == 1 && layouts[8].Footprint.Height == 1 && layouts[8].Footprint.RowPitch == 256);
+		CHECK(row_sizes[8] == 4 && total == layouts[8].Offset + 4);
+		for (int i = 0; i < 9; i++) {
+			CHECK(layouts[i].Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
+			CHECK(layouts[i].Footprint.Format == DXGI_FORMAT_R8G8B8A8_UNORM && layouts[i].Footprint.Depth == 1);
+		}
+	}
+
+	//408x400のBC7。フットプリントは4の倍数に切り上げ、行はブロック1行分
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(D3D12_RESOURCE_DIMENSION_TEXTURE2D, 408, 400, 1, 9, DXGI_FORMAT_BC7_UNORM_SRGB);
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layouts[9];
+		UINT row_counts[9];
+		UINT64 row_sizes[9];
+		UINT64 total = 0;
+		CHECK(DDSFile::GetCopyableFootprints(desc, 0, 9, 0, layouts, row_counts, row_sizes, &total) == S_OK);
+		CHECK(row_sizes[0] == 102 * 16 && row_counts[0] == 100 && layouts[0].Footprint.RowPitch == 1792);
+		//ミップ3は51x50
+		CHECK(layouts[3].Footprint.Width == 52 && layouts[3].Footprint.Height == 52 && row_sizes[3] == 13 * 16 && row_counts[3] == 13);
+		CHECK(layouts[8].Footprint.Width == 4 && layouts[8].Footprint.Height == 4 && row_sizes[8] == 16 && row_counts[8] == 1);
+	}
+
+	//配列の途中からの範囲は、先頭から求めた配置をずらしたものと同じ
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(D3D12_RESOURCE_DIMENSION_TEXTURE2D, 64, 64, 6, 7, DXGI_FORMAT_BC1_UNORM);
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT all[42];
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT part[7];
+		UINT64 all_total = 0;
+		UINT64 part_total = 0;
+		CHECK(DDSFile::GetCopyableFootprints(desc, 0, 42, 0, all, nullptr, nullptr, &all_total) == S_OK);
+		CHECK(DDSFile::GetCopyableFootprints(desc, 7, 7, 1024, part, nullptr, nullptr, &part_total) == S_OK);
+		for (int i = 0; i < 7; i++) {
+			CHECK(part[i].Offset == all[i].Offset + 1024);
+			CHECK(part[i].Footprint.Width == all[7 + i].Footprint.Width && part[i].Footprint.Height == all[7 + i].Footprint.Height);
+		}
+		//最後の面は、面1つ分の大きさで終わる
+		CHECK(all_total == all[35].Offset + part_total);
+		//範囲外はE_INVALIDARG
+		CHECK(DDSFile::GetCopyableFootprints(desc, 40, 3, 0, nullptr, nullptr, nullptr, &part_total) == E_INVALIDARG);
+	}
+
+	//3Dテクスチャは奥行きもミップ毎に半分になる
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(D3D12_RESOURCE_DIMENSION_TEXTURE3D, 32, 16, 8, 3, DXGI_FORMAT_R16_FLOAT);
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layouts[3];
+		UINT64 total = 0;
+		CHECK(DDSFile::GetCopyableFootprints(desc, 0, 3, 0, layouts, nullptr, nullptr, &total) == S_OK);
+		//64バイトの行が16行 x 8枚: 127 * 256 + 64 = 32576を揃えて32768
+		CHECK(layouts[0].Footprint.Depth == 8 && layouts[0].Footprint.RowPitch == 256);
+		CHECK(layouts[1].Offset == 32768 && layouts[1].Footprint.Depth == 4 && layouts[2].Footprint.Depth == 2);
+	}
+
+	//パックされたフォーマットは未対応
+	{
+		D3D12_RESOURCE_DESC desc = MakeDesc(D3D12_RESOURCE_DIMENSION_TEXTURE2D, 4, 4, 1, 1, DXGI_FORMAT_R8G8_B8G8_UNORM);
+		UINT64 total = 0;
+		CHECK(DDSFile::GetCopyableFootprints(desc, 0, 1, 0, nullptr, nullptr, nullptr, &total) == E_NOTIMPL);
+	}
+
+	//古い形式(DXT1)のヘッダー: 16x8、ミップ3段は64 + 16 + 8バイト
+	{
+		std::vector<uint8_t> data = MakeDDS(16, 8, 3, FOURCC_DXT1, 64 + 16 + 8);
+		DDSFile::Description description;
+		std::vector<size_t> offsets;
+		CHECK(DDSFile::Parse(data.data(), data.size(), description, offsets) == S_OK);
+		CHECK(description.format == DXGI_FORMAT_BC1_UNORM && description.dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D);
+		CHECK(description.width == 16 && description.height == 8 && description.mip_levels == 3 && description.depth_or_array_size == 1);
+		CHECK(offsets.size() == 3 && offsets[0] == 128 && offsets[1] == 128 + 64 && offsets[2] == 128 + 64 + 16);
+
+		//データが1バイトでも足りなければE_FAIL
+		CHECK(DDSFile::Parse(data.data(), data.size() - 1, description, offsets) == E_FAIL);
+		CHECK(offsets.empty() && description.width == 0);
+	}
+
+	//DX10拡張ヘッダーのキューブマップ: 面毎にミップが大きい順に並ぶ
+	{
+		constexpr size_t FACE_SIZE = 8 * 8 * 4 + 4 * 4 * 4;
+		std::vector<uint8_t> data = MakeDDS(8, 8, 2, FOURCC_DX10, DX10_HEADER_SIZE + FACE_SIZE * 6);
+		Write32(data, 128, DXGI_FORMAT_R8G8B8A8_UNORM);
+		Write32(data, 132, D3D12_RESOURCE_DIMENSION_TEXTURE2D);
+		Write32(data, 136, 0x4);		// DDS_RESOURCE_MISC_TEXTURECUBE
+		Write32(data, 140, 1);
+		DDSFile::Description description;
+		std::vector<size_t> offsets;
+		CHECK(DDSFile::Parse(data.data(), data.size(), description, offsets) == S_OK);
+		CHECK(description.is_cubemap && description.depth_or_array_size == 6 && description.mip_levels == 2);
+		CHECK(offsets.size() == 12);
+		for (size_t i = 0; i < offsets.size(); i++) {
+			size_t face = i / 2;
+			size_t mip = i % 2;
+			CHECK(offsets[i] == 148 + face * FACE_SIZE + mip * 8 * 8 * 4);
+		}
+	}
+
+	//壊れたヘッダーと、開けないファイル
+	{
+		DDSFile::Description description;
+		std::vector<size_t> offsets;
+		CHECK(DDSFile::Parse(nullptr, 0, description, offsets) == E_FAIL);
+		std::vector<uint8_t> data = MakeDDS(16, 8, 1, FOURCC_DXT1, 64);
+		data[0] = 'X';
+		CHECK(DDSFile::Parse(data.data(), data.size(), description, offsets) == E_FAIL);
+
+		DDSFile file;
+		CHECK(FAILED(file.Open(L"missing.dds")));
+		CHECK(!file.IsOpen());
+	}
+
+	return TestResult();
+}
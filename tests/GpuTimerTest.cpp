@@ -0,0 +1,169 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/DeviceContext/GpuTimer.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace System;
+
+namespace {
+	//CPUから読めるメモリを持つだけのリソース
+	struct FakeResource : ID3D12Resource {
+		std::vector<uint64_t> memory;
+		HRESULT Map(UINT, const D3D12_RANGE*, void** out_data) override {
+			*out_data = memory.data();
+			return S_OK;
+		}
+	};
+	//作ったオブジェクトを持っておくだけのデバイス
+	struct FakeDevice : ID3D12Device {
+		std::vector<std::unique_ptr<IUnknown>> objects;
+		HRESULT CreateQueryHeap(const D3D12_QUERY_HEAP_DESC*, REFIID, void** out_heap) override {
+			objects.push_back(std::make_unique<ID3D12QueryHeap>());
+			*out_heap = objects.back().get();
+			return S_OK;
+		}
+		HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS, const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES,
+			const D3D12_CLEAR_VALUE*, REFIID, void** out_resource) override {
+			auto resource = std::make_unique<FakeResource>();
+			resource->memory.resize(desc->Width / sizeof(uint64_t));
+			*out_resource = static_cast<ID3D12Resource*>(resource.get());
+			objects.push_back(std::move(resource));
+			return S_OK;
+		}
+	};
+	//EndQueryで時計の値をクエリに書き、ResolveQueryDataで読み戻し用のバッファにコピーする「GPU」
+	struct FakeCommandList : ID3D12GraphicsCommandList {
+		std::vector<uint64_t> queries = std::vector<uint64_t>(GpuTimer::MAX_QUERIES);
+		uint64_t clock = 1000000;
+		int end_count = 0;
+		int resolve_count = 0;
+		void EndQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT index) override {
+			queries[index] = clock;
+			clock += 500;
+			end_count++;
+		}
+		void ResolveQueryData(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT start, UINT count, ID3D12Resource* destination, UINT64 offset) override {
+			FakeResource* resource = static_cast<FakeResource*>(destination);
+			for (UINT i = 0; i < count; i++)
+				resource->memory[offset / sizeof(uint64_t) + i] = queries[start + i];
+			resolve_count++;
+		}
+	};
+
+	//1MHzのGPUの刻みを、ミリ秒に直す
+	double ToMilliseconds(const ProfileEvent& event)
+	{
+		return ProfileManager::Instance()->TicksToMilliseconds(event.value - event.begin);
+	}
+}
+
+int main()
+{
+	ProfileManager* profile_manager = ProfileManager::Instance();
+	ProfileThreadBuffer* lane = profile_manager->AcquireLane("GPU Direct");
+	const GpuClockCalibration calibration = { 100, 5000, 1000000 };
+
+	//デバイス無しでも区間の管理と変換はできる
+	{
+		GpuTimer timer(nullptr, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(!timer.IsValid());
+		int outer = timer.Begin(nullptr, "Outer");
+		int inner = timer.Begin(nullptr, "Inner");
+		timer.End(nullptr, inner);
+		timer.Begin(nullptr, "Unended");
+		timer.End(nullptr, outer);
+		timer.Resolve(nullptr);
+		CHECK(timer.HasPendingZones());
+		//デバイスが無いので、読み戻しはできない
+		GpuTimer no_readback(nullptr, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		no_readback.Begin(nullptr, "Zone");
+		no_readback.End(nullptr, 0);
+		no_readback.Resolve(nullptr);
+		CHECK(no_readback.Collect(calibration, lane) == -1 && !no_readback.HasPendingZones());
+
+		//終わっていない区間は捨てる
+		const uint64_t timestamps[6] = { 100, 400, 150, 250, 300, 0 };
+		uint64_t first = lane->write_index.load();
+		CHECK(timer.CollectTimestamps(timestamps, 6, calibration, lane) == 2);
+		CHECK(!timer.HasPendingZones());
+		CHECK(lane->write_index.load() == first + 2);
+		const ProfileEvent& outer_event = lane->events[first];
+		const ProfileEvent& inner_event = lane->events[first + 1];
+		CHECK(std::strcmp(outer_event.name, "Outer") == 0 && outer_event.depth == 0 && outer_event.begin == 5000);
+		CHECK(std::strcmp(inner_event.name, "Inner") == 0 && inner_event.depth == 1);
+		CHECK(std::fabs(ToMilliseconds(outer_event) - 0.3) < 1e-3);
+		CHECK(std::fabs(ToMilliseconds(inner_event) - 0.1) < 1e-3);
+		CHECK(inner_event.begin > outer_event.begin && inner_event.value < outer_event.value);
+
+		//較正より前のタイムスタンプは、較正したCPUの時刻より前になる
+		timer.Begin(nullptr, "Early");
+		timer.End(nullptr, 0);
+		timer.Resolve(nullptr);
+		const uint64_t early[2] = { 50, 90 };
+		CHECK(timer.CollectTimestamps(early, 2, calibration, lane) == 1);
+		CHECK(lane->events[first + 2].begin < 5000);
+
+		//終了が開始より前の区間と、タイムスタンプが足りない区間は捨てる
+		timer.Begin(nullptr, "Reversed");
+		timer.End(nullptr, 0);
+		timer.Begin(nullptr, "Short");
+		timer.End(nullptr, 1);
+		timer.Resolve(nullptr);
+		const uint64_t broken[3] = { 90, 50, 7 };
+		CHECK(timer.CollectTimestamps(broken, 3, calibration, lane) == 0);
+
+		//較正できていなければ-1で、結果待ちの区間は捨てる
+		timer.Begin(nullptr, "Uncalibrated");
+		timer.End(nullptr, 0);
+		timer.Resolve(nullptr);
+		CHECK(timer.CollectTimestamps(broken, 2, GpuClockCalibration{}, lane) == -1);
+		CHECK(!timer.HasPendingZones());
+
+		//区間の数の上限
+		for (unsigned int i = 0; i < GpuTimer::MAX_ZONES; i++)
+			CHECK(timer.Begin(nullptr, "Zone") >= 0);
+		CHECK(timer.Begin(nullptr, "Overflow") == -1);
+		timer.Resolve(nullptr);
+	}
+
+	//デバイスとコマンドリストを真似たもので、フレーム毎に積んで読み戻す
+	{
+		FakeDevice device;
+		FakeCommandList command_list;
+		//アプリと同じく、記録用のラッパー越しに積む
+		GpuTimer::CommandList recorder(&command_list);
+		GpuTimer timer(&device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		CHECK(timer.IsValid());
+		//コピーキューは計測しない
+		GpuTimer copy_timer(&device, D3D12_COMMAND_LIST_TYPE_COPY);
+		CHECK(!copy_timer.IsValid());
+
+		constexpr int FRAME_COUNT = 10;
+		uint64_t first = lane->write_index.load();
+		CommandStream stream;
+		for (int frame = 0; frame < FRAME_COUNT; frame++) {
+			//最後のフレームだけ記録する
+			if (frame == FRAME_COUNT - 1)
+				recorder.BeginCapture(&stream);
+			int frame_zone = timer.Begin(&recorder, "GPU Frame");
+			int scene_zone = timer.Begin(&recorder, "GPU Scene");
+			timer.End(&recorder, scene_zone);
+			timer.End(&recorder, frame_zone);
+			timer.Resolve(&recorder);
+			recorder.EndCapture();
+			GpuClockCalibration frame_calibration = { command_list.clock, ProfileManager::Now(), 1000000 };
+			CHECK(timer.Collect(frame_calibration, lane) == 2);
+		}
+		CHECK(command_list.resolve_count == FRAME_COUNT && command_list.end_count == FRAME_COUNT * 4);
+		//記録したフレームには、タイムスタンプ4つと読み戻し1つが残る
+		CHECK(stream.GetCommandCount() == 5 && stream.GetObjectCount() == 2);
+		CHECK(lane->write_index.load() == first + FRAME_COUNT * 2);
+		//Sceneは500刻み(0.5ms)、Frameはその前後を含めて1500刻み
+		CHECK(std::fabs(ToMilliseconds(lane->events[first]) - 1.5) < 1e-3);
+		CHECK(std::fabs(ToMilliseconds(lane->events[first + 1]) - 0.5) < 1e-3);
+	}
+
+	profile_manager->ReleaseLane(lane);
+	return TestResult();
+}
@@ -0,0 +1,186 @@
+﻿#pragma once
+#include <cmath>
+#include <utility>
+
+//-------------------------------------------------------------
+// ホスト向けのビルドで、Windows SDKのDirectXMath.hの代わりに読むヘッダー
+// srcとテストが使う関数だけを、同じ名前・同じ意味でスカラーの計算で定義する(SIMDは使わない)
+// 行ベクトルに右から行列を掛ける(DirectXMathと同じ)
+//-------------------------------------------------------------
+namespace DirectX {
+
+	constexpr float XM_PI = 3.141592654f;
+
+	struct XMFLOAT2 {
+		float x, y;
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x_, float y_) :x(x_), y(y_) {}
+	};
+	struct XMFLOAT3 {
+		float x, y, z;
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x_, float y_, float z_) :x(x_), y(y_), z(z_) {}
+	};
+	struct XMFLOAT4 {
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x_, float y_, float z_, float w_) :x(x_), y(y_), z(z_), w(w_) {}
+	};
+	struct alignas(16) XMVECTOR {
+		float v[4];
+	};
+	struct alignas(16) XMMATRIX {
+		XMVECTOR r[4];
+	};
+
+	inline constexpr float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return XMVECTOR{ { x, y, z, w } }; }
+	inline XMVECTOR XMVectorZero() { return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+	inline XMVECTOR XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+	inline float XMVectorGetX(const XMVECTOR& v) { return v.v[0]; }
+	inline float XMVectorGetY(const XMVECTOR& v) { return v.v[1]; }
+	inline float XMVectorGetZ(const XMVECTOR& v) { return v.v[2]; }
+	inline float XMVectorGetW(const XMVECTOR& v) { return v.v[3]; }
+	inline XMVECTOR XMVectorAdd(XMVECTOR a, const XMVECTOR& b) {
+		for (int i = 0; i < 4; i++) a.v[i] += b.v[i];
+		return a;
+	}
+	inline XMVECTOR XMVectorSubtract(XMVECTOR a, const XMVECTOR& b) {
+		for (int i = 0; i < 4; i++) a.v[i] -= b.v[i];
+		return a;
+	}
+	inline XMVECTOR XMVectorScale(XMVECTOR a, float scale) {
+		for (int i = 0; i < 4; i++) a.v[i] *= scale;
+		return a;
+	}
+
+	inline XMVECTOR XMVector3Dot(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+	inline XMVECTOR XMVector4Dot(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]); }
+	inline XMVECTOR XMVector3Length(const XMVECTOR& v) { return XMVectorReplicate(std::sqrt(XMVectorGetX(XMVector3Dot(v, v)))); }
+	inline XMVECTOR XMVector3Normalize(const XMVECTOR& v) {
+		float length = XMVectorGetX(XMVector3Length(v));
+		return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+	}
+	inline XMVECTOR XMVector3Cross(const XMVECTOR& a, const XMVECTOR& b) {
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+	// @brief 平面(xyzが法線、wが距離)を、法線の長さが1になるように割る
+	inline XMVECTOR XMPlaneNormalize(const XMVECTOR& plane) {
+		float length = std::sqrt(plane.v[0] * plane.v[0] + plane.v[1] * plane.v[1] + plane.v[2] * plane.v[2]);
+		return length > 0.0f ? XMVectorScale(plane, 1.0f / length) : plane;
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return XMVectorSet(source->x, source->y, source->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+	inline void XMStoreFloat3(XMFLOAT3* destination, const XMVECTOR& v) { *destination = XMFLOAT3(v.v[0], v.v[1], v.v[2]); }
+	inline void XMStoreFloat4(XMFLOAT4* destination, const XMVECTOR& v) { *destination = XMFLOAT4(v.v[0], v.v[1], v.v[2], v.v[3]); }
+
+	inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33) {
+		return XMMATRIX{ { XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13), XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33) } };
+	}
+	inline XMMATRIX XMMatrixIdentity() { return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1); }
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z) { return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1); }
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z) { return XMMatrixSet(x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1); }
+	inline XMMATRIX XMMatrixRotationY(float angle) {
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		return XMMatrixSet(c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1);
+	}
+	inline XMMATRIX XMMatrixTranspose(const XMMATRIX& m) {
+		XMMATRIX result;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				result.r[i].v[j] = m.r[j].v[i];
+		return result;
+	}
+	inline XMMATRIX XMMatrixMultiply(const XMMATRIX& a, const XMMATRIX& b) {
+		XMMATRIX result;
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++)
+					sum += a.r[i].v[k] * b.r[k].v[j];
+				result.r[i].v[j] = sum;
+			}
+		}
+		return result;
+	}
+	inline XMMATRIX operator*(const XMMATRIX& a, const XMMATRIX& b) { return XMMatrixMultiply(a, b); }
+	// @brief 部分ピボット選択のガウス・ジョルダン法で逆行列を求める(行列式は返さない)
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, const XMMATRIX& m) {
+		double a[4][8];
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				a[i][j] = m.r[i].v[j];
+				a[i][j + 4] = i == j ? 1.0 : 0.0;
+			}
+		}
+		for (int column = 0; column < 4; column++) {
+			int pivot = column;
+			for (int row = column + 1; row < 4; row++) {
+				if (std::fabs(a[row][column]) > std::fabs(a[pivot][column]))
+					pivot = row;
+			}
+			for (int j = 0; j < 8; j++)
+				std::swap(a[column][j], a[pivot][j]);
+			double divisor = a[column][column];
+			for (int j = 0; j < 8; j++)
+				a[column][j] /= divisor;
+			for (int row = 0; row < 4; row++) {
+				if (row == column)
+					continue;
+				double factor = a[row][column];
+				for (int j = 0; j < 8; j++)
+					a[row][j] -= factor * a[column][j];
+			}
+		}
+		if (determinant)
+			*determinant = XMVectorZero();
+		XMMATRIX result;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				result.r[i].v[j] = static_cast<float>(a[i][j + 4]);
+		return result;
+	}
+
+	inline XMVECTOR XMVector4Transform(const XMVECTOR& v, const XMMATRIX& m) {
+		XMVECTOR result;
+		for (int j = 0; j < 4; j++)
+			result.v[j] = v.v[0] * m.r[0].v[j] + v.v[1] * m.r[1].v[j] + v.v[2] * m.r[2].v[j] + v.v[3] * m.r[3].v[j];
+		return result;
+	}
+	// @brief wを1として変換する(結果のwはそのまま)
+	inline XMVECTOR XMVector3Transform(XMVECTOR v, const XMMATRIX& m) {
+		v.v[3] = 1.0f;
+		return XMVector4Transform(v, m);
+	}
+	// @brief wを1として変換し、wで割る
+	inline XMVECTOR XMVector3TransformCoord(const XMVECTOR& v, const XMMATRIX& m) {
+		XMVECTOR result = XMVector3Transform(v, m);
+		return XMVectorScale(result, 1.0f / result.v[3]);
+	}
+	// @brief wを0として変換する(平行移動を含めない)
+	inline XMVECTOR XMVector3TransformNormal(XMVECTOR v, const XMMATRIX& m) {
+		v.v[3] = 0.0f;
+		return XMVector4Transform(v, m);
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(const XMVECTOR& eye, const XMVECTOR& focus, const XMVECTOR& up) {
+		XMVECTOR z = XMVector3Normalize(XMVectorSubtract(focus, eye));
+		XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+		XMVECTOR y = XMVector3Cross(z, x);
+		return XMMatrixSet(
+			x.v[0], y.v[0], z.v[0], 0.0f,
+			x.v[1], y.v[1], z.v[1], 0.0f,
+			x.v[2], y.v[2], z.v[2], 0.0f,
+			-XMVectorGetX(XMVector3Dot(x, eye)), -XMVectorGetX(XMVector3Dot(y, eye)), -XMVectorGetX(XMVector3Dot(z, eye)), 1.0f);
+	}
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fov_y, float aspect, float near_z, float far_z) {
+		float height = 1.0f / std::tan(fov_y * 0.5f);
+		float width = height / aspect;
+		float range = far_z / (far_z - near_z);
+		return XMMatrixSet(width, 0, 0, 0, 0, height, 0, 0, 0, 0, range, 1, 0, 0, -range * near_z, 0);
+	}
+}
@@ -0,0 +1,239 @@
+﻿#pragma once
+#include <deque>
+#include <mutex>
+
+//ホスト(GPUの無い環境)で、CommandQueueとID3D12DeviceContextを動かすためのデバイス
+//precompile.hのD3D12のインターフェースを実装し、キュー・フェンス・アロケーターの決まりだけを真似る
+//・キューに積んだSignalとWaitは、積んだ順に「GPU」が処理する。止めておけば、GPUが実行中の状態を作れる
+//・アロケーターは、最後に実行したコマンドリストのフェンスをGPUが通過する前にResetすると失敗する(D3D12では未定義の動作)
+//・フェンスのSetEventOnCompletionは、完了した時に(別のスレッドからでも)イベントを立てる
+//コマンドは何も実行しない。積まれたコマンドの数を確かめたい時は、NullCommandListを使う
+
+//-------------------------------------------------------------
+// @brief 値が進むと、待っているイベントを立てるフェンス
+//-------------------------------------------------------------
+class NullFence : public ID3D12Fence
+{
+private:
+	struct Waiter {
+		UINT64 value;
+		HANDLE event;
+	};
+	mutable std::mutex mutex;
+	UINT64 completed_value = 0;
+	std::vector<Waiter> waiters;
+
+public:
+	explicit NullFence(UINT64 initial_value) :completed_value(initial_value) {}
+
+	UINT64 GetCompletedValue() override {
+		std::lock_guard<std::mutex> lock(mutex);
+		return completed_value;
+	}
+	HRESULT SetEventOnCompletion(UINT64 value, HANDLE event) override {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (completed_value >= value) {
+			SetEvent(event);
+			return S_OK;
+		}
+		waiters.push_back({ value, event });
+		return S_OK;
+	}
+	// @brief CPUから値を進める
+	HRESULT Signal(UINT64 value) override {
+		Complete(value);
+		return S_OK;
+	}
+	// @brief GPUが値を通過したことにする(値は戻らない)
+	void Complete(UINT64 value) {
+		std::lock_guard<std::mutex> lock(mutex);
+		completed_value = std::max(completed_value, value);
+		size_t kept = 0;
+		for (const Waiter& waiter : waiters) {
+			if (waiter.value <= completed_value)
+				SetEvent(waiter.event);
+			else
+				waiters[kept++] = waiter;
+		}
+		waiters.resize(kept);
+	}
+};
+
+//-------------------------------------------------------------
+// @brief 最後に実行したコマンドリストが終わるまで、Resetを拒むアロケーター
+//-------------------------------------------------------------
+class NullCommandAllocator : public ID3D12CommandAllocator
+{
+private:
+	NullFence* in_use_fence = nullptr;	// このフェンスがin_use_valueを通過するまで、GPUが使っている
+	UINT64 in_use_value = 0;
+	int reset_count = 0;
+	int rejected_reset_count = 0;
+
+public:
+	HRESULT Reset() override {
+		if (in_use_fence && in_use_fence->GetCompletedValue() < in_use_value) {
+			rejected_reset_count++;
+			return E_FAIL;
+		}
+		reset_count++;
+		return S_OK;
+	}
+	// @brief 実行したコマンドリストが、fenceがvalueを通過するまで使うことにする
+	void SetInUse(NullFence* fence, UINT64 value) {
+		in_use_fence = fence;
+		in_use_value = value;
+	}
+	int GetResetCount() const { return reset_count; }
+	// @brief GPUが使っている間にResetしようとした回数
+	int GetRejectedResetCount() const { return rejected_reset_count; }
+};
+
+//-------------------------------------------------------------
+// @brief 開閉の状態と、使っているアロケーターだけを持つコマンドリスト
+//-------------------------------------------------------------
+class NullGraphicsCommandList : public ID3D12GraphicsCommandList
+{
+private:
+	NullCommandAllocator* allocator = nullptr;
+	bool is_closed = false;	// 作った直後は記録中
+
+public:
+	explicit NullGraphicsCommandList(NullCommandAllocator* allocator_) :allocator(allocator_) {}
+
+	HRESULT Close() override {
+		if (is_closed) return E_FAIL;
+		is_closed = true;
+		return S_OK;
+	}
+	HRESULT Reset(ID3D12CommandAllocator* allocator_, ID3D12PipelineState*) override {
+		if (!is_closed || !allocator_) return E_FAIL;
+		allocator = static_cast<NullCommandAllocator*>(allocator_);
+		is_closed = false;
+		return S_OK;
+	}
+	NullCommandAllocator* GetAllocator() const { return allocator; }
+	bool IsClosed() const { return is_closed; }
+};
+
+//-------------------------------------------------------------
+// @brief 積まれたSignalとWaitを、順番に処理するキュー
+// @details 止めていなければ、積まれた時点で処理する(GPUが一瞬で終わる)。
+//			Waitで待っているフェンスが進んでいなければ、そこで止まる(Runを呼び直すと続きから処理する)
+//-------------------------------------------------------------
+class NullCommandQueue : public ID3D12CommandQueue
+{
+private:
+	struct Operation {
+		NullFence* fence;
+		UINT64 value;
+		bool is_wait;	// trueならfenceがvalueに達するまで待つ。falseならfenceをvalueに進める
+	};
+	std::recursive_mutex mutex;
+	std::deque<Operation> operations;
+	std::vector<NullCommandAllocator*> executed_allocators;	// 前のSignalから後に実行したコマンドリストのアロケーター
+	bool paused = false;
+	int executed_list_count = 0;
+	int wait_count = 0;
+
+public:
+	void ExecuteCommandLists(UINT count, ID3D12CommandList* const* lists) override {
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		for (UINT i = 0; i < count; i++) {
+			NullGraphicsCommandList* list = static_cast<NullGraphicsCommandList*>(lists[i]);
+			if (list && list->GetAllocator())
+				executed_allocators.push_back(list->GetAllocator());
+			executed_list_count++;
+		}
+	}
+	HRESULT Signal(ID3D12Fence* fence, UINT64 value) override {
+		if (!fence) return E_INVALIDARG;
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		NullFence* null_fence = static_cast<NullFence*>(fence);
+		//実行したコマンドリストのアロケーターは、このSignalが処理されるまでGPUが使っている
+		for (NullCommandAllocator* allocator : executed_allocators)
+			allocator->SetInUse(null_fence, value);
+		executed_allocators.clear();
+		operations.push_back({ null_fence, value, false });
+		if (!paused) Run();
+		return S_OK;
+	}
+	HRESULT Wait(ID3D12Fence* fence, UINT64 value) override {
+		if (!fence) return E_INVALIDARG;
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		operations.push_back({ static_cast<NullFence*>(fence), value, true });
+		wait_count++;
+		if (!paused) Run();
+		return S_OK;
+	}
+
+	// @brief trueの間は、積まれたものを処理しない(GPUが前のフレームを実行している状態)
+	void SetPaused(bool paused_) {
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		paused = paused_;
+		if (!paused) Run();
+	}
+	// @brief 待っているフェンスが進んでいない所まで処理する
+	// @return 処理した数
+	size_t Run() {
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		size_t count = 0;
+		while (!operations.empty()) {
+			const Operation& operation = operations.front();
+			if (operation.is_wait) {
+				if (operation.fence->GetCompletedValue() < operation.value) break;
+			}
+			else {
+				operation.fence->Complete(operation.value);
+			}
+			operations.pop_front();
+			count++;
+		}
+		return count;
+	}
+	size_t GetPendingCount() {
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		return operations.size();
+	}
+	int GetExecutedListCount() const { return executed_list_count; }
+	int GetWaitCount() const { return wait_count; }
+};
+
+//-------------------------------------------------------------
+// @brief キュー・フェンス・アロケーター・コマンドリストを作るデバイス
+// @details 作ったものはデバイスが持つ(ComPtrは参照を数えない)ので、デバイスは使う側より長く生かすこと。
+//			クエリヒープやリソースは作れないので、GpuTimerは無効になる
+//-------------------------------------------------------------
+class NullDevice : public ID3D12Device
+{
+private:
+	std::vector<std::unique_ptr<IUnknown>> objects;
+	bool fail_fence = false;
+
+	template <class T, class Interface>
+	HRESULT Store(std::unique_ptr<T> object, void** out_object) {
+		*out_object = static_cast<Interface*>(object.get());
+		objects.push_back(std::move(object));
+		return S_OK;
+	}
+
+public:
+	// @brief trueなら、フェンスの作成に失敗する
+	void SetFailFence(bool fail) { fail_fence = fail; }
+
+	HRESULT CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC*, REFIID, void** out_queue) override {
+		return Store<NullCommandQueue, ID3D12CommandQueue>(std::make_unique<NullCommandQueue>(), out_queue);
+	}
+	HRESULT CreateFence(UINT64 initial_value, D3D12_FENCE_FLAGS, REFIID, void** out_fence) override {
+		if (fail_fence) return E_FAIL;
+		return Store<NullFence, ID3D12Fence>(std::make_unique<NullFence>(initial_value), out_fence);
+	}
+	HRESULT CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE, REFIID, void** out_allocator) override {
+		return Store<NullCommandAllocator, ID3D12CommandAllocator>(std::make_unique<NullCommandAllocator>(), out_allocator);
+	}
+	HRESULT CreateCommandList(UINT, D3D12_COMMAND_LIST_TYPE, ID3D12CommandAllocator* allocator, ID3D12PipelineState*, REFIID, void** out_list) override {
+		if (!allocator) return E_INVALIDARG;
+		auto list = std::make_unique<NullGraphicsCommandList>(static_cast<NullCommandAllocator*>(allocator));
+		return Store<NullGraphicsCommandList, ID3D12GraphicsCommandList>(std::move(list), out_list);
+	}
+};
@@ -0,0 +1,351 @@
+﻿#pragma once
+
+//ホスト(Windows以外のg++など)で、テストとベンチマークをビルドする時にsrc/precompile.hの代わりに強制インクルードするヘッダー
+//D3D12に触らないクラスをビルドするのに必要な、Windowsの型とD3D12の構造体だけを、同じ名前・同じ並びで定義する
+//インターフェースは中身の無い型で、デバイスやリソースは作れない(GPUを使う処理はWindowsのビルドでしか動かない)
+
+//stdライブラリのヘッダーファイル(src/precompile.hと同じもの)
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+//Windowsの基本的な型
+typedef int BOOL;
+typedef unsigned char UINT8;
+typedef unsigned short UINT16;
+typedef unsigned int UINT;
+typedef int INT;
+typedef uint64_t UINT64;
+typedef int32_t LONG;
+typedef float FLOAT;
+typedef size_t SIZE_T;
+typedef int32_t HRESULT;
+#define TRUE 1
+#define FALSE 0
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define HRESULT_FROM_WIN32(error) ((HRESULT)((error) == 0 ? 0 : (((error) & 0x0000FFFF) | 0x80070000)))
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+
+//ファイルのマップ(ホストでは常に失敗する。ファイルを開かずに済む関数だけをテストで使う)
+typedef void* HANDLE;
+typedef unsigned long DWORD;
+union LARGE_INTEGER { int64_t QuadPart; };
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 0x00000001
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define PAGE_READONLY 0x02
+#define FILE_MAP_READ 0x0004
+#define ERROR_CALL_NOT_IMPLEMENTED 120
+inline HANDLE CreateFileW(const wchar_t*, DWORD, DWORD, void*, DWORD, DWORD, HANDLE) { return INVALID_HANDLE_VALUE; }
+inline BOOL GetFileSizeEx(HANDLE, LARGE_INTEGER*) { return FALSE; }
+inline HANDLE CreateFileMappingW(HANDLE, void*, DWORD, DWORD, DWORD, const wchar_t*) { return nullptr; }
+inline void* MapViewOfFile(HANDLE, DWORD, DWORD, DWORD, SIZE_T) { return nullptr; }
+inline BOOL UnmapViewOfFile(const void*) { return FALSE; }
+inline DWORD GetLastError() { return ERROR_CALL_NOT_IMPLEMENTED; }
+
+//イベント(ホストでは条件変数で作る。フェンスの完了を別のスレッドから知らせて、待つ側を起こせる)
+//自動リセットだけを扱う(srcはbManualReset=FALSEでしか作らない)
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+struct HostEvent {
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool signaled = false;
+};
+inline HANDLE CreateEventW(void*, BOOL, BOOL initial_state, const wchar_t*) {
+	HostEvent* event = new HostEvent;
+	event->signaled = initial_state != FALSE;
+	return event;
+}
+#define CreateEvent CreateEventW
+inline BOOL SetEvent(HANDLE handle) {
+	if (!handle) return FALSE;
+	HostEvent* event = static_cast<HostEvent*>(handle);
+	{
+		std::lock_guard<std::mutex> lock(event->mutex);
+		event->signaled = true;
+	}
+	event->condition.notify_one();
+	return TRUE;
+}
+inline DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds) {
+	HostEvent* event = static_cast<HostEvent*>(handle);
+	std::unique_lock<std::mutex> lock(event->mutex);
+	if (milliseconds == INFINITE)
+		event->condition.wait(lock, [event]() { return event->signaled; });
+	else if (!event->condition.wait_for(lock, std::chrono::milliseconds(milliseconds), [event]() { return event->signaled; }))
+		return WAIT_TIMEOUT;
+	event->signaled = false;
+	return WAIT_OBJECT_0;
+}
+//ホストで開けるハンドルはイベントだけ(ファイルとマップは作れない)
+inline BOOL CloseHandle(HANDLE handle) {
+	if (!handle || handle == INVALID_HANDLE_VALUE) return FALSE;
+	delete static_cast<HostEvent*>(handle);
+	return TRUE;
+}
+
+//DXGIのフォーマット(値はdxgiformat.hと同じ。ファイルに番号のまま書くものがあるので、並びを変えないこと)
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN = 0, DXGI_FORMAT_R32G32B32A32_TYPELESS = 1, DXGI_FORMAT_R32G32B32A32_FLOAT = 2, DXGI_FORMAT_R32G32B32A32_UINT = 3,
+	DXGI_FORMAT_R32G32B32A32_SINT = 4, DXGI_FORMAT_R32G32B32_TYPELESS = 5, DXGI_FORMAT_R32G32B32_FLOAT = 6, DXGI_FORMAT_R32G32B32_UINT = 7,
+	DXGI_FORMAT_R32G32B32_SINT = 8, DXGI_FORMAT_R16G16B16A16_TYPELESS = 9, DXGI_FORMAT_R16G16B16A16_FLOAT = 10, DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+	DXGI_FORMAT_R16G16B16A16_UINT = 12, DXGI_FORMAT_R16G16B16A16_SNORM = 13, DXGI_FORMAT_R16G16B16A16_SINT = 14, DXGI_FORMAT_R32G32_TYPELESS = 15,
+	DXGI_FORMAT_R32G32_FLOAT = 16, DXGI_FORMAT_R32G32_UINT = 17, DXGI_FORMAT_R32G32_SINT = 18, DXGI_FORMAT_R32G8X24_TYPELESS = 19,
+	DXGI_FORMAT_D32_FLOAT_S8X24_UINT = 20, DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS = 21, DXGI_FORMAT_X32_TYPELESS_G8X24_UINT = 22, DXGI_FORMAT_R10G10B10A2_TYPELESS = 23,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24, DXGI_FORMAT_R10G10B10A2_UINT = 25, DXGI_FORMAT_R11G11B10_FLOAT = 26, DXGI_FORMAT_R8G8B8A8_TYPELESS = 27,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29, DXGI_FORMAT_R8G8B8A8_UINT = 30, DXGI_FORMAT_R8G8B8A8_SNORM = 31,
+	DXGI_FORMAT_R8G8B8A8_SINT = 32, DXGI_FORMAT_R16G16_TYPELESS = 33, DXGI_FORMAT_R16G16_FLOAT = 34, DXGI_FORMAT_R16G16_UNORM = 35,
+	DXGI_FORMAT_R16G16_UINT = 36, DXGI_FORMAT_R16G16_SNORM = 37, DXGI_FORMAT_R16G16_SINT = 38, DXGI_FORMAT_R32_TYPELESS = 39,
+	DXGI_FORMAT_D32_FLOAT = 40, DXGI_FORMAT_R32_FLOAT = 41, DXGI_FORMAT_R32_UINT = 42, DXGI_FORMAT_R32_SINT = 43,
+	DXGI_FORMAT_R24G8_TYPELESS = 44, DXGI_FORMAT_D24_UNORM_S8_UINT = 45, DXGI_FORMAT_R24_UNORM_X8_TYPELESS = 46, DXGI_FORMAT_X24_TYPELESS_G8_UINT = 47,
+	DXGI_FORMAT_R8G8_TYPELESS = 48, DXGI_FORMAT_R8G8_UNORM = 49, DXGI_FORMAT_R8G8_UINT = 50, DXGI_FORMAT_R8G8_SNORM = 51,
+	DXGI_FORMAT_R8G8_SINT = 52, DXGI_FORMAT_R16_TYPELESS = 53, DXGI_FORMAT_R16_FLOAT = 54, DXGI_FORMAT_D16_UNORM = 55,
+	DXGI_FORMAT_R16_UNORM = 56, DXGI_FORMAT_R16_UINT = 57, DXGI_FORMAT_R16_SNORM = 58, DXGI_FORMAT_R16_SINT = 59,
+	DXGI_FORMAT_R8_TYPELESS = 60, DXGI_FORMAT_R8_UNORM = 61, DXGI_FORMAT_R8_UINT = 62, DXGI_FORMAT_R8_SNORM = 63,
+	DXGI_FORMAT_R8_SINT = 64, DXGI_FORMAT_A8_UNORM = 65, DXGI_FORMAT_R1_UNORM = 66, DXGI_FORMAT_R9G9B9E5_SHAREDEXP = 67,
+	DXGI_FORMAT_R8G8_B8G8_UNORM = 68, DXGI_FORMAT_G8R8_G8B8_UNORM = 69, DXGI_FORMAT_BC1_TYPELESS = 70, DXGI_FORMAT_BC1_UNORM = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB = 72, DXGI_FORMAT_BC2_TYPELESS = 73, DXGI_FORMAT_BC2_UNORM = 74, DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+	DXGI_FORMAT_BC3_TYPELESS = 76, DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC3_UNORM_SRGB = 78, DXGI_FORMAT_BC4_TYPELESS = 79,
+	DXGI_FORMAT_BC4_UNORM = 80, DXGI_FORMAT_BC4_SNORM = 81, DXGI_FORMAT_BC5_TYPELESS = 82, DXGI_FORMAT_BC5_UNORM = 83,
+	DXGI_FORMAT_BC5_SNORM = 84, DXGI_FORMAT_B5G6R5_UNORM = 85, DXGI_FORMAT_B5G5R5A1_UNORM = 86, DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_B8G8R8X8_UNORM = 88, DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM = 89, DXGI_FORMAT_B8G8R8A8_TYPELESS = 90, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+	DXGI_FORMAT_B8G8R8X8_TYPELESS = 92, DXGI_FORMAT_B8G8R8X8_UNORM_SRGB = 93, DXGI_FORMAT_BC6H_TYPELESS = 94, DXGI_FORMAT_BC6H_UF16 = 95,
+	DXGI_FORMAT_BC6H_SF16 = 96, DXGI_FORMAT_BC7_TYPELESS = 97, DXGI_FORMAT_BC7_UNORM = 98, DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+//D3D12のインターフェース(ホストでは中身を持たない)
+//srcが呼ぶメソッドだけを、失敗を返す仮想関数として持つ。テストでは派生させて、GPUの代わりの動きを書く
+typedef unsigned long ULONG;
+typedef const void* REFIID;
+#define IID_PPV_ARGS(pp) nullptr, reinterpret_cast<void**>(pp)
+struct IUnknown {
+	virtual ~IUnknown() = default;
+	//寿命はテスト側で持つので、参照カウントは数えない
+	virtual ULONG AddRef() { return 1; }
+	virtual ULONG Release() { return 1; }
+};
+struct D3D12_RANGE { SIZE_T Begin; SIZE_T End; };
+struct ID3D12Resource : IUnknown {
+	virtual HRESULT Map(UINT, const D3D12_RANGE*, void**) { return E_NOTIMPL; }
+	virtual void Unmap(UINT, const D3D12_RANGE*) {}
+};
+struct ID3D12RootSignature : IUnknown {};
+struct ID3D12PipelineState : IUnknown {};
+struct ID3D12DescriptorHeap : IUnknown {};
+struct ID3D12CommandSignature : IUnknown {};
+struct ID3D12QueryHeap : IUnknown {};
+
+//Microsoft::WRL::ComPtrの、srcが使う分だけ
+template <class T>
+class ComPtr
+{
+private:
+	T* pointer = nullptr;
+public:
+	ComPtr() = default;
+	ComPtr(T* pointer_) :pointer(pointer_) { if (pointer) pointer->AddRef(); }
+	ComPtr(const ComPtr& other) :ComPtr(other.pointer) {}
+	ComPtr(ComPtr&& other) noexcept :pointer(other.pointer) { other.pointer = nullptr; }
+	~ComPtr() { Reset(); }
+	ComPtr& operator=(ComPtr other) { std::swap(pointer, other.pointer); return *this; }
+
+	T* Get() const { return pointer; }
+	T* operator->() const { return pointer; }
+	explicit operator bool() const { return pointer != nullptr; }
+	T** GetAddressOf() { return &pointer; }
+	T** ReleaseAndGetAddressOf() { Reset(); return &pointer; }
+	void Reset() {
+		if (pointer) pointer->Release();
+		pointer = nullptr;
+	}
+};
+
+//D3D12の構造体と定数
+typedef uint64_t D3D12_GPU_VIRTUAL_ADDRESS;
+struct D3D12_CPU_DESCRIPTOR_HANDLE { SIZE_T ptr; };
+struct D3D12_GPU_DESCRIPTOR_HANDLE { UINT64 ptr; };
+struct D3D12_RECT { LONG left; LONG top; LONG right; LONG bottom; };
+struct D3D12_VIEWPORT { FLOAT TopLeftX; FLOAT TopLeftY; FLOAT Width; FLOAT Height; FLOAT MinDepth; FLOAT MaxDepth; };
+struct D3D12_VERTEX_BUFFER_VIEW { D3D12_GPU_VIRTUAL_ADDRESS BufferLocation; UINT SizeInBytes; UINT StrideInBytes; };
+struct D3D12_INDEX_BUFFER_VIEW { D3D12_GPU_VIRTUAL_ADDRESS BufferLocation; UINT SizeInBytes; DXGI_FORMAT Format; };
+
+enum D3D12_PRIMITIVE_TOPOLOGY {
+	D3D_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+	D3D_PRIMITIVE_TOPOLOGY_LINESTRIP = 3,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5,
+};
+enum D3D12_CLEAR_FLAGS {
+	D3D12_CLEAR_FLAG_DEPTH = 0x1,
+	D3D12_CLEAR_FLAG_STENCIL = 0x2,
+};
+enum D3D12_RESOURCE_STATES {
+	D3D12_RESOURCE_STATE_COMMON = 0,
+	D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER = 0x1,
+	D3D12_RESOURCE_STATE_INDEX_BUFFER = 0x2,
+	D3D12_RESOURCE_STATE_RENDER_TARGET = 0x4,
+	D3D12_RESOURCE_STATE_UNORDERED_ACCESS = 0x8,
+	D3D12_RESOURCE_STATE_DEPTH_WRITE = 0x10,
+	D3D12_RESOURCE_STATE_DEPTH_READ = 0x20,
+	D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE = 0x40,
+	D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE = 0x80,
+	D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT = 0x200,
+	D3D12_RESOURCE_STATE_COPY_DEST = 0x400,
+	D3D12_RESOURCE_STATE_COPY_SOURCE = 0x800,
+	D3D12_RESOURCE_STATE_PRESENT = 0,
+};
+enum D3D12_RESOURCE_BARRIER_TYPE {
+	D3D12_RESOURCE_BARRIER_TYPE_TRANSITION = 0,
+	D3D12_RESOURCE_BARRIER_TYPE_ALIASING = 1,
+	D3D12_RESOURCE_BARRIER_TYPE_UAV = 2,
+};
+enum D3D12_RESOURCE_BARRIER_FLAGS {
+	D3D12_RESOURCE_BARRIER_FLAG_NONE = 0,
+	D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY = 0x1,
+	D3D12_RESOURCE_BARRIER_FLAG_END_ONLY = 0x2,
+};
+#define D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES 0xffffffff
+struct D3D12_RESOURCE_TRANSITION_BARRIER { ID3D12Resource* pResource; UINT Subresource; D3D12_RESOURCE_STATES StateBefore; D3D12_RESOURCE_STATES StateAfter; };
+struct D3D12_RESOURCE_ALIASING_BARRIER { ID3D12Resource* pResourceBefore; ID3D12Resource* pResourceAfter; };
+struct D3D12_RESOURCE_UAV_BARRIER { ID3D12Resource* pResource; };
+struct D3D12_RESOURCE_BARRIER {
+	D3D12_RESOURCE_BARRIER_TYPE Type;
+	D3D12_RESOURCE_BARRIER_FLAGS Flags;
+	union {
+		D3D12_RESOURCE_TRANSITION_BARRIER Transition;
+		D3D12_RESOURCE_ALIASING_BARRIER Aliasing;
+		D3D12_RESOURCE_UAV_BARRIER UAV;
+	};
+};
+
+#define D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT 32
+#define D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT 8
+#define D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE 16
+
+//リソースの記述とアップロードバッファ上の配置
+enum D3D12_RESOURCE_DIMENSION {
+	D3D12_RESOURCE_DIMENSION_UNKNOWN = 0,
+	D3D12_RESOURCE_DIMENSION_BUFFER = 1,
+	D3D12_RESOURCE_DIMENSION_TEXTURE1D = 2,
+	D3D12_RESOURCE_DIMENSION_TEXTURE2D = 3,
+	D3D12_RESOURCE_DIMENSION_TEXTURE3D = 4,
+};
+enum D3D12_TEXTURE_LAYOUT {
+	D3D12_TEXTURE_LAYOUT_UNKNOWN = 0,
+	D3D12_TEXTURE_LAYOUT_ROW_MAJOR = 1,
+};
+enum D3D12_RESOURCE_FLAGS {
+	D3D12_RESOURCE_FLAG_NONE = 0,
+	D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET = 0x1,
+	D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL = 0x2,
+	D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS = 0x4,
+};
+struct DXGI_SAMPLE_DESC { UINT Count; UINT Quality; };
+struct D3D12_RESOURCE_DESC {
+	D3D12_RESOURCE_DIMENSION Dimension;
+	UINT64 Alignment;
+	UINT64 Width;
+	UINT Height;
+	UINT16 DepthOrArraySize;
+	UINT16 MipLevels;
+	DXGI_FORMAT Format;
+	DXGI_SAMPLE_DESC SampleDesc;
+	D3D12_TEXTURE_LAYOUT Layout;
+	D3D12_RESOURCE_FLAGS Flags;
+};
+struct D3D12_SUBRESOURCE_FOOTPRINT { DXGI_FORMAT Format; UINT Width; UINT Height; UINT Depth; UINT RowPitch; };
+struct D3D12_PLACED_SUBRESOURCE_FOOTPRINT { UINT64 Offset; D3D12_SUBRESOURCE_FOOTPRINT Footprint; };
+enum D3D12_TEXTURE_COPY_TYPE { D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX = 0, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT = 1 };
+struct D3D12_TEXTURE_COPY_LOCATION {
+	ID3D12Resource* pResource;
+	D3D12_TEXTURE_COPY_TYPE Type;
+	union {
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT PlacedFootprint;
+		UINT SubresourceIndex;
+	};
+};
+struct D3D12_BOX { UINT left; UINT top; UINT front; UINT right; UINT bottom; UINT back; };
+#define D3D12_TEXTURE_DATA_PITCH_ALIGNMENT 256
+#define D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT 512
+
+//クエリとリソースの作成
+enum D3D12_COMMAND_LIST_TYPE {
+	D3D12_COMMAND_LIST_TYPE_DIRECT = 0,
+	D3D12_COMMAND_LIST_TYPE_BUNDLE = 1,
+	D3D12_COMMAND_LIST_TYPE_COMPUTE = 2,
+	D3D12_COMMAND_LIST_TYPE_COPY = 3,
+};
+enum D3D12_QUERY_HEAP_TYPE { D3D12_QUERY_HEAP_TYPE_OCCLUSION = 0, D3D12_QUERY_HEAP_TYPE_TIMESTAMP = 1 };
+enum D3D12_QUERY_TYPE { D3D12_QUERY_TYPE_OCCLUSION = 0, D3D12_QUERY_TYPE_BINARY_OCCLUSION = 1, D3D12_QUERY_TYPE_TIMESTAMP = 2 };
+struct D3D12_QUERY_HEAP_DESC { D3D12_QUERY_HEAP_TYPE Type; UINT Count; UINT NodeMask; };
+enum D3D12_HEAP_TYPE { D3D12_HEAP_TYPE_DEFAULT = 1, D3D12_HEAP_TYPE_UPLOAD = 2, D3D12_HEAP_TYPE_READBACK = 3 };
+enum D3D12_CPU_PAGE_PROPERTY { D3D12_CPU_PAGE_PROPERTY_UNKNOWN = 0 };
+enum D3D12_MEMORY_POOL { D3D12_MEMORY_POOL_UNKNOWN = 0 };
+enum D3D12_HEAP_FLAGS { D3D12_HEAP_FLAG_NONE = 0 };
+struct D3D12_HEAP_PROPERTIES { D3D12_HEAP_TYPE Type; D3D12_CPU_PAGE_PROPERTY CPUPageProperty; D3D12_MEMORY_POOL MemoryPoolPreference; UINT CreationNodeMask; UINT VisibleNodeMask; };
+struct D3D12_CLEAR_VALUE;
+
+//コマンドキュー・フェンス・アロケーター(GPU無しで動かす実装は、tests/HostPlatform/NullDevice.h)
+enum D3D12_COMMAND_QUEUE_PRIORITY { D3D12_COMMAND_QUEUE_PRIORITY_NORMAL = 0, D3D12_COMMAND_QUEUE_PRIORITY_HIGH = 100 };
+enum D3D12_COMMAND_QUEUE_FLAGS { D3D12_COMMAND_QUEUE_FLAG_NONE = 0 };
+struct D3D12_COMMAND_QUEUE_DESC { D3D12_COMMAND_LIST_TYPE Type; INT Priority; D3D12_COMMAND_QUEUE_FLAGS Flags; UINT NodeMask; };
+enum D3D12_FENCE_FLAGS { D3D12_FENCE_FLAG_NONE = 0 };
+struct ID3D12CommandAllocator : IUnknown {
+	virtual HRESULT Reset() { return E_NOTIMPL; }
+};
+struct ID3D12CommandList : IUnknown {};
+struct ID3D12Fence : IUnknown {
+	virtual UINT64 GetCompletedValue() { return 0; }
+	virtual HRESULT SetEventOnCompletion(UINT64, HANDLE) { return E_NOTIMPL; }
+	virtual HRESULT Signal(UINT64) { return E_NOTIMPL; }
+};
+struct ID3D12CommandQueue : IUnknown {
+	virtual void ExecuteCommandLists(UINT, ID3D12CommandList* const*) {}
+	virtual HRESULT Signal(ID3D12Fence*, UINT64) { return E_NOTIMPL; }
+	virtual HRESULT Wait(ID3D12Fence*, UINT64) { return E_NOTIMPL; }
+	virtual HRESULT GetTimestampFrequency(UINT64*) { return E_NOTIMPL; }
+	virtual HRESULT GetClockCalibration(UINT64*, UINT64*) { return E_NOTIMPL; }
+};
+
+struct ID3D12Device : IUnknown {
+	virtual HRESULT CreateQueryHeap(const D3D12_QUERY_HEAP_DESC*, REFIID, void**) { return E_NOTIMPL; }
+	virtual HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS, const D3D12_RESOURCE_DESC*, D3D12_RESOURCE_STATES,
+		const D3D12_CLEAR_VALUE*, REFIID, void**) { return E_NOTIMPL; }
+	virtual HRESULT CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC*, REFIID, void**) { return E_NOTIMPL; }
+	virtual HRESULT CreateFence(UINT64, D3D12_FENCE_FLAGS, REFIID, void**) { return E_NOTIMPL; }
+	virtual HRESULT CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE, REFIID, void**) { return E_NOTIMPL; }
+	virtual HRESULT CreateCommandList(UINT, D3D12_COMMAND_LIST_TYPE, ID3D12CommandAllocator*, ID3D12PipelineState*, REFIID, void**) { return E_NOTIMPL; }
+};
+struct ID3D12GraphicsCommandList : ID3D12CommandList {
+	virtual HRESULT Close() { return E_NOTIMPL; }
+	virtual HRESULT Reset(ID3D12CommandAllocator*, ID3D12PipelineState*) { return E_NOTIMPL; }
+	virtual void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) {}
+	virtual void EndQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) {}
+	virtual void ResolveQueryData(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT, UINT, ID3D12Resource*, UINT64) {}
+	virtual void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION*, UINT, UINT, UINT, const D3D12_TEXTURE_COPY_LOCATION*, const D3D12_BOX*) {}
+};
@@ -0,0 +1,163 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Material/MaterialTable/MaterialTable.h"
+
+using namespace System;
+using Desc = MaterialTable::Desc;
+using Range = MaterialTable::Range;
+
+namespace {
+	Desc MakeDesc(float red, uint64_t diffuse_texture = 0)
+	{
+		Desc desc;
+		desc.diffuse_color[0] = red;
+		desc.textures[MaterialTable::Diffuse] = diffuse_texture;
+		return desc;
+	}
+
+	//書き換えた範囲を忘れさせる(確認の前に、前の操作の分を消しておく)
+	void ClearDirty(MaterialTable& table)
+	{
+		table.TakeDirtyRanges();
+	}
+
+	bool IsSameRanges(const std::vector<Range>& ranges, std::initializer_list<Range> expected)
+	{
+		if (ranges.size() != expected.size()) return false;
+		size_t i = 0;
+		for (const Range& range : expected) {
+			if (ranges[i].begin != range.begin || ranges[i].count != range.count) return false;
+			i++;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	//同じ内容は同じ番号になり、1つでも違えば別の番号になる
+	{
+		MaterialTable table;
+		bool created = false;
+		uint32_t a = table.Add(MakeDesc(0.5f), &created);
+		CHECK(a == 0 && created);
+		uint32_t b = table.Add(MakeDesc(0.5f), &created);
+		CHECK(b == a && !created);
+		CHECK(table.Add(MakeDesc(0.25f), &created) == 1 && created);
+		CHECK(table.Add(MakeDesc(0.5f, 7), &created) == 2 && created);
+		Desc translucent = MakeDesc(0.5f);
+		translucent.flags = MaterialTable::FLAG_TRANSLUCENT;
+		CHECK(table.Add(translucent, &created) == 3 && created);
+		CHECK(table.IsTranslucent(3) && !table.IsTranslucent(0));
+		//0と-0は同じ値として扱う
+		CHECK(table.Add(MakeDesc(0.0f)) == table.Add(MakeDesc(-0.0f)));
+		CHECK(table.GetCount() == 5);
+		//追加したばかりのテクスチャの番号は、全て無し
+		for (uint32_t slot = 0; slot < MaterialTable::TextureSlotCount; slot++)
+			CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), slot) == MaterialTable::INVALID_TEXTURE);
+	}
+
+	//Modifyは内容とGPUの形式を書き換え、古い内容では引けなくなる
+	{
+		MaterialTable table;
+		uint32_t a = table.Add(MakeDesc(0.5f, 7));
+		uint32_t b = table.Add(MakeDesc(0.25f, 8));
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, 3) == 0);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Normal, 4) == 0);
+		ClearDirty(table);
+
+		//テクスチャが同じスロットは番号を残し、変わったスロットは無しに戻す
+		Desc modified = MakeDesc(0.75f, 9);
+		CHECK(table.Modify(a, modified) == 0);
+		CHECK(table.GetGpuMaterial(a).diffuse_color[0] == 0.75f);
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Diffuse) == MaterialTable::INVALID_TEXTURE);
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Normal) == 4);
+		CHECK(IsSameRanges(table.TakeDirtyRanges(), { { a, 1 } }));
+
+		//新しい内容では同じ番号を引き、古い内容は新しく追加される
+		bool created = false;
+		CHECK(table.Add(modified, &created) == a && !created);
+		CHECK(table.Add(MakeDesc(0.5f, 7), &created) == 2 && created);
+
+		//同じ内容の別の番号があれば、書き換えてもそちらは引けるまま
+		CHECK(table.Modify(b, modified) == 0);
+		CHECK(table.Modify(b, MakeDesc(1.0f)) == 0);
+		CHECK(table.Add(modified, &created) == a && !created);
+
+		CHECK(table.Modify(100, modified) == -1);
+	}
+
+	//SRVの番号は、アトラスの参照と区別できるものだけ書ける
+	{
+		MaterialTable table;
+		uint32_t a = table.Add(MakeDesc(0.5f));
+		ClearDirty(table);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, MaterialTable::ATLAS_ENTRY_BIT - 1) == 0);
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Diffuse) == MaterialTable::ATLAS_ENTRY_BIT - 1);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, MaterialTable::ATLAS_ENTRY_BIT) == -1);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, 0xfffe) == -1);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, 0x10000) == -1);
+		CHECK(table.SetTextureIndex(a, MaterialTable::TextureSlotCount, 1) == -1);
+		CHECK(table.SetTextureIndex(100, MaterialTable::Diffuse, 1) == -1);
+		//失敗した書き込みは値を変えない
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Diffuse) == MaterialTable::ATLAS_ENTRY_BIT - 1);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, MaterialTable::INVALID_TEXTURE) == 0);
+
+		//アトラスの参照は、専用の関数で印を付けて書く
+		CHECK(table.SetAtlasEntry(a, MaterialTable::Roughness, 5) == 0);
+		uint16_t index = MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Roughness);
+		CHECK(MaterialTable::IsAtlasTextureIndex(index) && (index & ~MaterialTable::ATLAS_ENTRY_BIT) == 5);
+		CHECK(table.SetAtlasEntry(a, MaterialTable::Roughness, MaterialTable::MAX_ATLAS_ENTRY_COUNT) == -1);
+		CHECK(!MaterialTable::IsAtlasTextureIndex(MaterialTable::INVALID_TEXTURE));
+
+		//隣のスロット(同じuintの上位)を壊さない
+		CHECK(table.SetTextureIndex(a, MaterialTable::Metallic, 9) == 0);
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Roughness) == index);
+		CHECK(MaterialTable::GetTextureIndex(table.GetGpuMaterial(a), MaterialTable::Metallic) == 9);
+	}
+
+	//同じ値の書き込みは転送しない
+	{
+		MaterialTable table;
+		uint32_t a = table.Add(MakeDesc(0.5f));
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, 3) == 0);
+		ClearDirty(table);
+		CHECK(table.SetTextureIndex(a, MaterialTable::Diffuse, 3) == 0);
+		CHECK(!table.HasDirty());
+		CHECK(table.TakeDirtyRanges().empty());
+	}
+
+	//書き換えた範囲は番号の順に並び、間がmerge_gap以下なら1つにまとまる
+	{
+		MaterialTable table;
+		for (int i = 0; i < 20; i++)
+			table.Add(MakeDesc(static_cast<float>(i)));
+		//追加したものは全て書き換え扱い
+		CHECK(IsSameRanges(table.TakeDirtyRanges(), { { 0, 20 } }));
+		CHECK(!table.HasDirty());
+
+		//順不同・重複ありで書き換えても、範囲は番号の順で重ならない
+		const uint32_t ids[] = { 12, 3, 5, 3, 19, 0, 12 };
+		for (uint32_t id : ids)
+			table.SetTextureIndex(id, MaterialTable::Diffuse, id + 1);
+		CHECK(IsSameRanges(table.TakeDirtyRanges(2), { { 0, 6 }, { 12, 1 }, { 19, 1 } }));
+
+		//間が丁度merge_gapならまとめ、1つ多ければ分ける
+		table.SetTextureIndex(4, MaterialTable::Diffuse, 100);
+		table.SetTextureIndex(8, MaterialTable::Diffuse, 100);
+		table.SetTextureIndex(13, MaterialTable::Diffuse, 100);
+		CHECK(IsSameRanges(table.TakeDirtyRanges(3), { { 4, 5 }, { 13, 1 } }));
+
+		//merge_gapが0なら、隣り合う番号だけがまとまる
+		table.SetTextureIndex(6, MaterialTable::Diffuse, 200);
+		table.SetTextureIndex(7, MaterialTable::Diffuse, 200);
+		table.SetTextureIndex(9, MaterialTable::Diffuse, 200);
+		CHECK(IsSameRanges(table.TakeDirtyRanges(0), { { 6, 2 }, { 9, 1 } }));
+
+		//MarkAllDirtyは全てを1つの範囲で返す
+		table.MarkAllDirty();
+		CHECK(IsSameRanges(table.TakeDirtyRanges(0), { { 0, 20 } }));
+		CHECK(table.TakeDirtyRanges().empty());
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,185 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/Mesh/MeshOptimizer/MeshOptimizer.h"
+
+#include <cmath>
+#include <random>
+
+using namespace System;
+
+namespace {
+	//u方向にsegments_u、v方向にsegments_vで分割したトーラスを作る
+	//カラーのrに元の頂点番号を入れておき、並べ替えた後でも元のどの頂点かを辿れるようにする
+	MeshInfo MakeTorus(unsigned int segments_u, unsigned int segments_v)
+	{
+		constexpr float TWO_PI = 6.2831853f;
+		constexpr float RADIUS = 2.0f;
+		constexpr float TUBE_RADIUS = 0.5f;
+		MeshInfo mesh;
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				float a = u * TWO_PI / segments_u;
+				float b = v * TWO_PI / segments_v;
+				float ring = RADIUS + TUBE_RADIUS * std::cos(b);
+				float vertex[MeshInfo::SOURCE_STRIDE] = {
+					ring * std::cos(a), TUBE_RADIUS * std::sin(b), ring * std::sin(a),
+					static_cast<float>(v * segments_u + u), 1.0f, 1.0f, 1.0f,
+					static_cast<float>(u) / segments_u, static_cast<float>(v) / segments_v,
+					std::cos(b) * std::cos(a), std::sin(b), std::cos(b) * std::sin(a),
+				};
+				mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MeshInfo::SOURCE_STRIDE);
+			}
+		}
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				unsigned int a = v * segments_u + u;
+				unsigned int b = v * segments_u + (u + 1) % segments_u;
+				unsigned int c = ((v + 1) % segments_v) * segments_u + u;
+				unsigned int d = ((v + 1) % segments_v) * segments_u + (u + 1) % segments_u;
+				unsigned int triangles[6] = { a, c, b, b, c, d };
+				mesh.indices.insert(mesh.indices.end(), triangles, triangles + 6);
+			}
+		}
+		return mesh;
+	}
+
+	//三角形の順番をばらばらにする(頂点キャッシュが最も効きにくい並び)
+	void ShuffleTriangles(MeshInfo& mesh, unsigned int seed)
+	{
+		size_t triangle_count = mesh.indices.size() / 3;
+		std::mt19937 random(seed);
+		for (size_t t = triangle_count - 1; t > 0; t--) {
+			size_t other = random() % (t + 1);
+			for (int k = 0; k < 3; k++)
+				std::swap(mesh.indices[t * 3 + k], mesh.indices[other * 3 + k]);
+		}
+	}
+
+	//三角形を元の頂点番号で表し、巻き順を保ったまま最小の番号が先頭に来るように回して並べる(三角形の集合の比較用)
+	std::vector<std::array<unsigned int, 3>> GetTriangleSet(const MeshInfo& mesh)
+	{
+		std::vector<std::array<unsigned int, 3>> triangles(mesh.indices.size() / 3);
+		for (size_t t = 0; t < triangles.size(); t++) {
+			std::array<unsigned int, 3>& triangle = triangles[t];
+			for (int k = 0; k < 3; k++)
+				triangle[k] = static_cast<unsigned int>(mesh.vertices[mesh.indices[t * 3 + k] * MeshInfo::SOURCE_STRIDE + MeshInfo::COLOR_OFFSET]);
+			while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+				std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	//最適化の前後で、ACMRもATVRも悪くならないことを確かめる
+	void CheckNotWorse(const MeshInfo& source)
+	{
+		MeshInfo mesh = source;
+		MeshOptimizer::VertexCacheStats before;
+		MeshOptimizer::VertexCacheStats after;
+		CHECK(MeshOptimizer::Optimize(mesh, &before, &after) == 0);
+		CHECK(after.acmr <= before.acmr);
+		CHECK(after.atvr <= before.atvr);
+		//最適化した結果を直接解析した値と一致する
+		MeshOptimizer::VertexCacheStats analyzed = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.GetVertexCount());
+		CHECK(analyzed.vertices_transformed == after.vertices_transformed);
+		CHECK(GetTriangleSet(mesh) == GetTriangleSet(source));
+	}
+}
+
+int main()
+{
+	//頂点変換数の解析:キャッシュが3つだけなら、間に別の三角形を挟んだ同じ三角形もまた変換される
+	{
+		std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+		MeshOptimizer::VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, 6, 3);
+		CHECK(stats.vertices_transformed == 9);
+		CHECK(std::fabs(stats.acmr - 3.0f) < 1e-6f);
+		CHECK(std::fabs(stats.atvr - 1.5f) < 1e-6f);
+		stats = MeshOptimizer::AnalyzeVertexCache(indices, 6, 16);
+		CHECK(stats.vertices_transformed == 6);
+		CHECK(std::fabs(stats.atvr - 1.0f) < 1e-6f);
+	}
+
+	//ばらばらの並びからは大きく良くなり、三角形の集合は変わらない
+	MeshInfo torus = MakeTorus(200, 100);
+	MeshInfo shuffled = torus;
+	ShuffleTriangles(shuffled, 3);
+	{
+		MeshInfo mesh = shuffled;
+		MeshOptimizer::VertexCacheStats before;
+		MeshOptimizer::VertexCacheStats after;
+		CHECK(MeshOptimizer::Optimize(mesh, &before, &after) == 0);
+		CHECK(after.acmr < before.acmr * 0.5f);
+		CHECK(after.acmr < 0.8f);
+		CHECK(GetTriangleSet(mesh) == GetTriangleSet(torus));
+	}
+
+	//元々キャッシュに優しい並びや、最適化済みのメッシュに通しても悪くならない
+	CheckNotWorse(torus);
+	CheckNotWorse(shuffled);
+	{
+		MeshInfo optimized = shuffled;
+		CHECK(MeshOptimizer::Optimize(optimized) == 0);
+		CheckNotWorse(optimized);
+	}
+	for (unsigned int seed = 0; seed < 8; seed++) {
+		MeshInfo small = MakeTorus(3 + seed * 5, 3 + seed * 2);
+		ShuffleTriangles(small, seed);
+		CheckNotWorse(small);
+	}
+
+	//頂点フェッチ最適化:初めて参照された順に番号が振り直され、参照されない頂点は消える
+	{
+		MeshInfo mesh = shuffled;
+		//どこからも参照されない頂点を、先頭と途中に足しておく
+		size_t original_vertex_count = mesh.GetVertexCount();
+		std::vector<float> unused(MeshInfo::SOURCE_STRIDE, -1.0f);
+		mesh.vertices.insert(mesh.vertices.begin(), unused.begin(), unused.end());
+		mesh.vertices.insert(mesh.vertices.begin() + 100 * MeshInfo::SOURCE_STRIDE, unused.begin(), unused.end());
+		for (unsigned int& index : mesh.indices)
+			index += index >= 98 ? 2 : 1;
+		MeshInfo before = mesh;
+
+		CHECK(MeshOptimizer::OptimizeVertexFetch(mesh) == 0);
+		CHECK(mesh.GetVertexCount() == original_vertex_count);
+		CHECK(mesh.indices.size() == before.indices.size());
+		//新しい番号は0から順に初めて現れ、同じ位置のインデックスは同じ頂点の中身を指す(番号の付け替えは1対1)
+		std::vector<unsigned int> new_to_old(mesh.GetVertexCount(), ~0u);
+		unsigned int next_vertex = 0;
+		bool valid = true;
+		for (size_t i = 0; i < mesh.indices.size(); i++) {
+			unsigned int index = mesh.indices[i];
+			unsigned int old_index = before.indices[i];
+			if (index == next_vertex) {
+				new_to_old[index] = old_index;
+				next_vertex++;
+			}
+			valid = valid && index < next_vertex && new_to_old[index] == old_index;
+			valid = valid && std::equal(&mesh.vertices[index * MeshInfo::SOURCE_STRIDE], &mesh.vertices[(index + 1) * MeshInfo::SOURCE_STRIDE],
+				&before.vertices[old_index * MeshInfo::SOURCE_STRIDE]);
+		}
+		CHECK(valid);
+		CHECK(next_vertex == mesh.GetVertexCount());
+		std::vector<unsigned int> sorted_old = new_to_old;
+		std::sort(sorted_old.begin(), sorted_old.end());
+		CHECK(std::adjacent_find(sorted_old.begin(), sorted_old.end()) == sorted_old.end());
+		CHECK(GetTriangleSet(mesh) == GetTriangleSet(before));
+	}
+
+	//三角形リストとして正しくないインデックスは失敗し、何も書き換えない
+	{
+		MeshInfo mesh = MakeTorus(4, 4);
+		MeshInfo broken = mesh;
+		broken.indices.pop_back();
+		CHECK(MeshOptimizer::Optimize(broken) == -1);
+		broken = mesh;
+		broken.indices[5] = static_cast<unsigned int>(mesh.GetVertexCount());
+		std::vector<unsigned int> broken_indices = broken.indices;
+		CHECK(MeshOptimizer::OptimizeVertexCache(broken.indices, broken.GetVertexCount()) == -1);
+		CHECK(MeshOptimizer::OptimizeOverdraw(broken) == -1);
+		CHECK(MeshOptimizer::OptimizeVertexFetch(broken) == -1);
+		CHECK(broken.indices == broken_indices);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,118 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+#include "System/SystemUtils/Mesh/MeshOptimizer/MeshOptimizer.h"
+#include "System/SystemUtils/Mesh/MeshletBuilder/MeshletBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace System;
+
+namespace {
+	//u方向にsegments_u、v方向にsegments_vで分割したトーラスを作る
+	MeshInfo MakeTorus(unsigned int segments_u, unsigned int segments_v)
+	{
+		constexpr float TWO_PI = 6.2831853f;
+		constexpr float RADIUS = 2.0f;
+		constexpr float TUBE_RADIUS = 0.5f;
+		MeshInfo mesh;
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				float a = u * TWO_PI / segments_u;
+				float b = v * TWO_PI / segments_v;
+				float ring = RADIUS + TUBE_RADIUS * std::cos(b);
+				float vertex[MeshInfo::SOURCE_STRIDE] = {
+					ring * std::cos(a), TUBE_RADIUS * std::sin(b), ring * std::sin(a),
+					1.0f, 1.0f, 1.0f, 1.0f,
+					static_cast<float>(u) / segments_u, static_cast<float>(v) / segments_v,
+					std::cos(b) * std::cos(a), std::sin(b), std::cos(b) * std::sin(a),
+				};
+				mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MeshInfo::SOURCE_STRIDE);
+			}
+		}
+		for (unsigned int v = 0; v < segments_v; v++) {
+			for (unsigned int u = 0; u < segments_u; u++) {
+				unsigned int a = v * segments_u + u;
+				unsigned int b = v * segments_u + (u + 1) % segments_u;
+				unsigned int c = ((v + 1) % segments_v) * segments_u + u;
+				unsigned int d = ((v + 1) % segments_v) * segments_u + (u + 1) % segments_u;
+				unsigned int triangles[6] = { a, c, b, b, c, d };
+				mesh.indices.insert(mesh.indices.end(), triangles, triangles + 6);
+			}
+		}
+		return mesh;
+	}
+
+	bool SameMeshlets(const MeshInfo& a, const MeshInfo& b)
+	{
+		if (a.meshlets.size() != b.meshlets.size() || a.meshlet_vertices != b.meshlet_vertices || a.meshlet_triangles != b.meshlet_triangles)
+			return false;
+		//パディングも含めて、ビット単位で同じであること
+		return std::memcmp(a.meshlets.data(), b.meshlets.data(), sizeof(Meshlet) * a.meshlets.size()) == 0;
+	}
+
+	//メッシュレットが上限を守り、LOD0の三角形を順にちょうど1回ずつ覆っていることを確かめる
+	void CheckMeshlets(const MeshInfo& mesh, unsigned int max_vertices, unsigned int max_triangles)
+	{
+		CHECK(!mesh.meshlets.empty());
+		unsigned int next_triangle = 0;
+		for (const Meshlet& meshlet : mesh.meshlets) {
+			CHECK(meshlet.vertex_count > 0 && meshlet.vertex_count <= max_vertices);
+			CHECK(meshlet.triangle_count > 0 && meshlet.triangle_count <= max_triangles);
+			CHECK(meshlet.triangle_offset == next_triangle);
+			next_triangle += meshlet.triangle_count;
+			for (unsigned int i = 0; i < meshlet.triangle_count * 3; i++) {
+				unsigned int local = mesh.meshlet_triangles[meshlet.triangle_offset * 3 + i];
+				CHECK(local < meshlet.vertex_count);
+				CHECK(mesh.meshlet_vertices[meshlet.vertex_offset + local] == mesh.indices[meshlet.triangle_offset * 3 + i]);
+			}
+			//バウンディングスフィアは全ての頂点を含む
+			for (unsigned int i = 0; i < meshlet.vertex_count; i++) {
+				const float* position = mesh.GetPosition(mesh.meshlet_vertices[meshlet.vertex_offset + i]);
+				float dx = position[0] - meshlet.bounding_sphere.x;
+				float dy = position[1] - meshlet.bounding_sphere.y;
+				float dz = position[2] - meshlet.bounding_sphere.z;
+				CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) <= meshlet.bounding_sphere.w * 1.0001f + 1e-6f);
+			}
+			CHECK(meshlet.cone_cutoff <= 1.0f);
+		}
+		CHECK(next_triangle * 3 == mesh.indices.size());
+	}
+}
+
+int main()
+{
+	MeshInfo source = MakeTorus(200, 100);
+	CHECK(MeshOptimizer::Optimize(source) == 0);
+
+	//同じ入力からは、何度作ってもビット単位で同じ結果になる
+	MeshInfo first = source;
+	MeshInfo second = source;
+	CHECK(MeshletBuilder::Build(first) == 0);
+	CHECK(MeshletBuilder::Build(second) == 0);
+	CHECK(SameMeshlets(first, second));
+	CheckMeshlets(first, MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES);
+
+	//作り直しても前の結果は残らない
+	CHECK(MeshletBuilder::Build(second) == 0);
+	CHECK(SameMeshlets(first, second));
+
+	//並べ替えからやり直しても同じになる
+	MeshInfo reoptimized = MakeTorus(200, 100);
+	CHECK(MeshOptimizer::Optimize(reoptimized) == 0);
+	CHECK(reoptimized.indices == source.indices);
+	CHECK(MeshletBuilder::Build(reoptimized) == 0);
+	CHECK(SameMeshlets(first, reoptimized));
+
+	//上限を変えても、上限を守って全ての三角形を覆う
+	MeshInfo small = source;
+	CHECK(MeshletBuilder::Build(small, 32, 32) == 0);
+	CheckMeshlets(small, 32, 32);
+	CHECK(small.meshlets.size() > first.meshlets.size());
+
+	//上限が256頂点を超える指定は失敗する
+	MeshInfo invalid = source;
+	CHECK(MeshletBuilder::Build(invalid, 257, 124) == -1);
+
+	return TestResult();
+}
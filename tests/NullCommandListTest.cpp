@@ -0,0 +1,181 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamReplayer.h"
+#include "System/SystemUtils/DeviceContext/NullCommandList.h"
+
+using namespace System;
+using Op = CommandStream::Op;
+
+namespace {
+	//1フレーム分のコマンドを、アプリと同じような順で積む
+	template <class CommandList>
+	void RecordFrame(CommandList& command_list, ID3D12Resource* back_buffer, ID3D12RootSignature* root_signature, ID3D12PipelineState* pipeline_state, UINT draw_count,
+		ID3D12QueryHeap* query_heap, ID3D12Resource* readback_buffer)
+	{
+		command_list.EndQuery(query_heap, D3D12_QUERY_TYPE_TIMESTAMP, 0);
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = back_buffer;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		command_list.ResourceBarrier(1, &barrier);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE rtv = { 0x100 };
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv = { 0x200 };
+		command_list.OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+		const FLOAT clear_color[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+		command_list.ClearRenderTargetView(rtv, clear_color, 0, nullptr);
+		command_list.ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+		D3D12_RECT scissor = { 0, 0, 1280, 720 };
+		command_list.RSSetViewports(1, &viewport);
+		command_list.RSSetScissorRects(1, &scissor);
+		command_list.SetGraphicsRootSignature(root_signature);
+		command_list.SetPipelineState(pipeline_state);
+		command_list.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		for (UINT i = 0; i < draw_count; i++) {
+			UINT constants[2] = { i, i * 2 };
+			command_list.SetGraphicsRoot32BitConstants(0, 2, constants, 0);
+			command_list.DrawIndexedInstanced(36, 4, 0, 0, i * 4);
+		}
+
+		//バックバッファの一部を読み戻し用のバッファへコピーする(TextureReadbackと同じ形)
+		D3D12_TEXTURE_COPY_LOCATION src = {};
+		src.pResource = back_buffer;
+		src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		src.SubresourceIndex = 0;
+		D3D12_TEXTURE_COPY_LOCATION dst = {};
+		dst.pResource = readback_buffer;
+		dst.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		dst.PlacedFootprint.Offset = 512;
+		dst.PlacedFootprint.Footprint = { DXGI_FORMAT_R8G8B8A8_UNORM, 640, 360, 1, 2560 };
+		D3D12_BOX box = { 0, 0, 0, 640, 360, 1 };
+		command_list.CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+		command_list.CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+		command_list.ResourceBarrier(1, &barrier);
+		command_list.EndQuery(query_heap, D3D12_QUERY_TYPE_TIMESTAMP, 1);
+		command_list.ResolveQueryData(query_heap, D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, readback_buffer, 0);
+	}
+
+	//コピーの引数を覚えておく、何も実行しないコマンドリスト
+	struct CopyCapturingCommandList : NullCommandList {
+		std::vector<D3D12_TEXTURE_COPY_LOCATION> destinations;
+		std::vector<D3D12_TEXTURE_COPY_LOCATION> sources;
+		std::vector<bool> has_boxes;
+		D3D12_BOX last_box = {};
+		void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT x, UINT y, UINT z, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* box) {
+			NullCommandList::CopyTextureRegion(dst, x, y, z, src, box);
+			destinations.push_back(*dst);
+			sources.push_back(*src);
+			has_boxes.push_back(box != nullptr);
+			if (box)
+				last_box = *box;
+		}
+	};
+}
+
+int main()
+{
+	ID3D12Resource back_buffer;
+	ID3D12RootSignature root_signature;
+	ID3D12PipelineState pipeline_state;
+	ID3D12QueryHeap query_heap;
+	ID3D12Resource readback_buffer;
+	constexpr UINT DRAW_COUNT = 10;
+
+	//直接積んだ回数を数える
+	NullCommandList direct;
+	RecordFrame(direct, &back_buffer, &root_signature, &pipeline_state, DRAW_COUNT, &query_heap, &readback_buffer);
+	CHECK(direct.GetCount(Op::ResourceBarrier) == 2);
+	CHECK(direct.GetCount(Op::DrawIndexedInstanced) == DRAW_COUNT);
+	CHECK(direct.GetCount(Op::SetGraphicsRoot32BitConstants) == DRAW_COUNT);
+	CHECK(direct.GetDrawnInstanceCount() == DRAW_COUNT * 4);
+	CHECK(direct.GetCount(Op::CopyTextureRegion) == 2);
+	CHECK(direct.GetCount(Op::EndQuery) == 2 && direct.GetCount(Op::ResolveQueryData) == 1);
+	CHECK(direct.GetTotalCount() == 15 + DRAW_COUNT * 2);
+
+	//記録しながら積んでも、下のコマンドリストに届く数は変わらない
+	NullCommandList recorded_target;
+	CommandStreamRecorder<NullCommandList> recorder(&recorded_target);
+	CommandStream stream;
+	recorder.BeginCapture(&stream);
+	RecordFrame(recorder, &back_buffer, &root_signature, &pipeline_state, DRAW_COUNT, &query_heap, &readback_buffer);
+	recorder.EndCapture();
+	CHECK(recorded_target.GetTotalCount() == direct.GetTotalCount());
+	CHECK(stream.GetCommandCount() == direct.GetTotalCount());
+	CHECK(stream.GetObjectCount() == 5);
+
+	//同じプロセスで記録したストリームは、記録時のオブジェクトでそのまま再生できる
+	CommandStreamReplayer replayer;
+	NullCommandList replayed;
+	CHECK(replayer.Replay(stream, &replayed) == static_cast<int>(direct.GetTotalCount()));
+	for (size_t op = 0; op < static_cast<size_t>(Op::Count); op++)
+		CHECK(replayed.GetCount(static_cast<Op>(op)) == direct.GetCount(static_cast<Op>(op)));
+	CHECK(replayed.GetDrawnInstanceCount() == direct.GetDrawnInstanceCount());
+
+	//コピー元と先の配置、範囲の有無は記録した通りに戻る
+	CopyCapturingCommandList copies;
+	CHECK(replayer.Replay(stream, &copies) == static_cast<int>(direct.GetTotalCount()));
+	CHECK(copies.destinations.size() == 2 && copies.has_boxes == std::vector<bool>({ true, false }));
+	if (copies.destinations.size() == 2) {
+		const D3D12_TEXTURE_COPY_LOCATION& dst = copies.destinations[0];
+		const D3D12_TEXTURE_COPY_LOCATION& src = copies.sources[0];
+		CHECK(dst.pResource == &readback_buffer && dst.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT);
+		CHECK(dst.PlacedFootprint.Offset == 512 && dst.PlacedFootprint.Footprint.Width == 640 && dst.PlacedFootprint.Footprint.RowPitch == 2560);
+		CHECK(src.pResource == &back_buffer && src.Type == D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX && src.SubresourceIndex == 0);
+		CHECK(copies.last_box.right == 640 && copies.last_box.bottom == 360 && copies.last_box.back == 1);
+	}
+
+	//ファイルから読んだストリームはポインタを持たないが、何も実行しないコマンドリストならそのまま再生できる
+	const std::wstring path = L"NullCommandListTest.cstr";
+	CHECK(stream.SaveToFile(path) == 0);
+	CommandStream loaded;
+	CHECK(loaded.LoadFromFile(path) == 0);
+	CHECK(loaded.GetData() == stream.GetData());
+	CHECK(loaded.GetObjectCount() == stream.GetObjectCount());
+	replayed.Clear();
+	CHECK(replayed.GetTotalCount() == 0);
+	CHECK(replayer.Replay(loaded, &replayed) == static_cast<int>(direct.GetTotalCount()));
+	CHECK(replayed.GetCount(Op::DrawIndexedInstanced) == DRAW_COUNT);
+
+	//ヘッダーとファイルの大きさが合わないファイルは、大きく確保せずに失敗する
+	{
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+		constexpr size_t OBJECT_COUNT_OFFSET = 16;
+		constexpr size_t DATA_SIZE_OFFSET = 24;
+		auto load_modified = [&](size_t offset, uint64_t value, size_t size) {
+			std::vector<char> modified = bytes;
+			std::memcpy(modified.data() + offset, &value, sizeof(value));
+			modified.resize(size);
+			std::ofstream(std::filesystem::path(path), std::ios::binary).write(modified.data(), static_cast<std::streamsize>(modified.size()));
+			CommandStream corrupt;
+			int result = corrupt.LoadFromFile(path);
+			return result == -1 && corrupt.GetData().empty() && corrupt.GetObjectCount() == 0 && corrupt.GetCommandCount() == 0;
+		};
+		uint64_t data_size = stream.GetData().size();
+		CHECK(load_modified(DATA_SIZE_OFFSET, data_size, bytes.size() - 1));	// 途中で切れている
+		CHECK(load_modified(DATA_SIZE_OFFSET, 1ull << 62, bytes.size()));	// 大きさが壊れている
+		CHECK(load_modified(DATA_SIZE_OFFSET, data_size - 1, bytes.size()));	// 後ろに余りがある
+		CHECK(load_modified(OBJECT_COUNT_OFFSET, 1ull << 40, bytes.size()));	// オブジェクト数が壊れている
+		CHECK(load_modified(DATA_SIZE_OFFSET, data_size, 20));	// ヘッダーも揃っていない
+		//元に戻せば読める
+		CHECK(load_modified(DATA_SIZE_OFFSET, data_size, bytes.size()) == false);
+	}
+	std::filesystem::remove(std::filesystem::path(path));
+
+	//途中で切れたストリームは、積めた所までで失敗を返す
+	CommandStream truncated;
+	truncated.WriteOp(Op::DrawInstanced);
+	truncated.Write(UINT(3));
+	replayed.Clear();
+	CHECK(replayer.Replay(truncated, &replayed) == -1);
+	CHECK(replayed.GetTotalCount() == 0);
+
+	return TestResult();
+}
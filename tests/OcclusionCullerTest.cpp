@@ -0,0 +1,168 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Culling/OcclusionCuller/OcclusionCuller.h"
+#include "System/SystemUtils/Mesh/MeshInfo/MeshInfo.h"
+
+#include <cmath>
+#include <random>
+
+using namespace System;
+
+namespace {
+	//ピクセルの中心が辺からこの距離(ピクセル)以内なら、内外どちらでも良いことにする(浮動小数点の誤差の分)
+	constexpr double EDGE_TOLERANCE = 1e-3;
+	constexpr float DEPTH_TOLERANCE = 1e-5f;
+
+	void AddVertex(MeshInfo& mesh, float x, float y, float z)
+	{
+		float vertex[MeshInfo::SOURCE_STRIDE] = {};
+		vertex[MeshInfo::POSITION_OFFSET + 0] = x;
+		vertex[MeshInfo::POSITION_OFFSET + 1] = y;
+		vertex[MeshInfo::POSITION_OFFSET + 2] = z;
+		mesh.indices.push_back(static_cast<unsigned int>(mesh.GetVertexCount()));
+		mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MeshInfo::SOURCE_STRIDE);
+	}
+
+	//NDCに直接置いた三角形(単位行列で描く)。一部は裏向きや画面からはみ出すもの
+	MeshInfo MakeRandomTriangles(unsigned int count, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-1.3f, 1.3f);
+		std::uniform_real_distribution<float> offset(-0.4f, 0.4f);
+		std::uniform_real_distribution<float> depth(0.05f, 0.95f);
+		MeshInfo mesh;
+		for (unsigned int i = 0; i < count; i++) {
+			float x = position(rng);
+			float y = position(rng);
+			for (int k = 0; k < 3; k++)
+				AddVertex(mesh, x + offset(rng), y + offset(rng), depth(rng));
+		}
+		return mesh;
+	}
+
+	//判定の仕方だけを素直に書いた、倍精度のラスタライザ
+	//ピクセルの中心が3辺の内側(時計回りの表の三角形のみ)なら、平面の深度で手前を残す。
+	//辺の上に近いピクセルは、確実に描かれる深度(definite)と、描かれるかもしれない深度(possible)を別々に持つ
+	void ReferenceRasterize(const MeshInfo& mesh, unsigned int width, unsigned int height, std::vector<float>& definite, std::vector<float>& possible)
+	{
+		definite.assign(static_cast<size_t>(width) * height, 1.0f);
+		possible.assign(static_cast<size_t>(width) * height, 1.0f);
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+			double x[3], y[3], z[3];
+			for (int k = 0; k < 3; k++) {
+				const float* position = mesh.GetPosition(mesh.indices[t + k]);
+				x[k] = (position[0] * 0.5 + 0.5) * width;
+				y[k] = (0.5 - position[1] * 0.5) * height;
+				z[k] = position[2];
+			}
+			double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area <= 0.0)
+				continue;
+			for (unsigned int py = 0; py < height; py++) {
+				for (unsigned int px = 0; px < width; px++) {
+					double cx = px + 0.5;
+					double cy = py + 0.5;
+					double barycentric[3];
+					double min_distance = 1e30;
+					for (int i = 0; i < 3; i++) {
+						int j = (i + 1) % 3;
+						double edge = (x[j] - x[i]) * (cy - y[i]) - (y[j] - y[i]) * (cx - x[i]);
+						min_distance = std::min(min_distance, edge / std::hypot(x[j] - x[i], y[j] - y[i]));
+						barycentric[(i + 2) % 3] = edge / area;
+					}
+					if (min_distance < -EDGE_TOLERANCE)
+						continue;
+					float depth = static_cast<float>(barycentric[0] * z[0] + barycentric[1] * z[1] + barycentric[2] * z[2]);
+					size_t index = static_cast<size_t>(py) * width + px;
+					possible[index] = std::min(possible[index], depth);
+					if (min_distance > EDGE_TOLERANCE)
+						definite[index] = std::min(definite[index], depth);
+				}
+			}
+		}
+	}
+
+	//深度バッファが参照の2つの深度の間に収まっているか
+	int CountMismatches(const std::vector<float>& depth, const std::vector<float>& definite, const std::vector<float>& possible)
+	{
+		int mismatches = 0;
+		for (size_t i = 0; i < depth.size(); i++) {
+			if (depth[i] < possible[i] - DEPTH_TOLERANCE || depth[i] > definite[i] + DEPTH_TOLERANCE)
+				mismatches++;
+		}
+		return mismatches;
+	}
+
+	std::vector<float> Render(const MeshInfo& mesh, unsigned int width, unsigned int height, unsigned int thread_count, bool simd)
+	{
+		OcclusionCuller culler(width, height, thread_count);
+		culler.SetSimdEnabled(simd);
+		std::vector<OcclusionCuller::Occluder> occluders(1);
+		occluders[0].mesh = &mesh;
+		occluders[0].world_view_projection = DirectX::XMMatrixIdentity();
+		culler.RenderOccluders(occluders);
+		return culler.GetDepth();
+	}
+}
+
+int main()
+{
+	//スカラー版もSSE版も、参照のラスタライザと同じピクセルを同じ深度で描く
+	{
+		OcclusionCuller size_check(67, 45, 1);
+		CHECK(size_check.GetWidth() == 72 && size_check.GetHeight() == 48);
+		const unsigned int width = size_check.GetWidth();
+		const unsigned int height = size_check.GetHeight();
+
+		for (unsigned int seed = 1; seed <= 4; seed++) {
+			MeshInfo mesh = MakeRandomTriangles(60, seed);
+			std::vector<float> definite, possible;
+			ReferenceRasterize(mesh, width, height, definite, possible);
+
+			std::vector<float> scalar = Render(mesh, 67, 45, 1, false);
+			std::vector<float> simd = Render(mesh, 67, 45, 1, true);
+			CHECK(CountMismatches(scalar, definite, possible) == 0);
+			CHECK(CountMismatches(simd, definite, possible) == 0);
+			//何か描かれていること
+			CHECK(std::count_if(scalar.begin(), scalar.end(), [](float depth) { return depth < 1.0f; }) > 100);
+
+			//帯の分け方で結果は変わらない(帯同士は同じピクセルに書かない)
+			CHECK(Render(mesh, 67, 45, 4, false) == scalar);
+			CHECK(Render(mesh, 67, 45, 5, true) == simd);
+		}
+	}
+
+	//遮蔽の判定: 画面の左半分を深度0.3の板で覆う
+	//辺の上にちょうど乗ったピクセルはどちらの三角形にも描かれないので、対角線がピクセルの中心を通らない大きさにする
+	{
+		MeshInfo mesh;
+		AddVertex(mesh, -1.0f, 1.0f, 0.3f);
+		AddVertex(mesh, 0.0f, 1.0f, 0.3f);
+		AddVertex(mesh, -1.0f, -1.0f, 0.3f);
+		AddVertex(mesh, 0.0f, 1.0f, 0.3f);
+		AddVertex(mesh, 0.0f, -1.0f, 0.3f);
+		AddVertex(mesh, -1.0f, -1.0f, 0.3f);
+		OcclusionCuller culler(64, 40, 2);
+		std::vector<OcclusionCuller::Occluder> occluders(1);
+		occluders[0].mesh = &mesh;
+		occluders[0].world_view_projection = DirectX::XMMatrixIdentity();
+		culler.RenderOccluders(occluders);
+
+		const DirectX::XMMATRIX identity = DirectX::XMMatrixIdentity();
+		//板の奥に隠れている
+		CHECK(!culler.IsVisible({ -0.8f, -0.5f, 0.5f }, { -0.2f, 0.5f, 0.6f }, identity));
+		//板より手前
+		CHECK(culler.IsVisible({ -0.8f, -0.5f, 0.1f }, { -0.2f, 0.5f, 0.2f }, identity));
+		//板と重なる奥行き
+		CHECK(culler.IsVisible({ -0.8f, -0.5f, 0.25f }, { -0.2f, 0.5f, 0.6f }, identity));
+		//右半分は何も無い
+		CHECK(culler.IsVisible({ 0.2f, -0.5f, 0.5f }, { 0.8f, 0.5f, 0.6f }, identity));
+		//板の端を跨いでいる
+		CHECK(culler.IsVisible({ -0.5f, -0.5f, 0.5f }, { 0.1f, 0.5f, 0.6f }, identity));
+
+		//クリアすれば全て見える
+		culler.Clear();
+		CHECK(culler.IsVisible({ -0.8f, -0.5f, 0.5f }, { -0.2f, 0.5f, 0.6f }, identity));
+	}
+
+	return TestResult();
+}
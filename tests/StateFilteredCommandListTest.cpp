@@ -0,0 +1,130 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/DeviceContext/CommandStreamRecorder.h"
+#include "System/SystemUtils/DeviceContext/NullCommandList.h"
+#include "System/SystemUtils/DeviceContext/StateFilteredCommandList.h"
+
+using namespace System;
+using Op = CommandStream::Op;
+using Stats = StateFilterStats;
+
+namespace {
+	struct Scene {
+		ID3D12RootSignature root_signature;
+		ID3D12PipelineState pipeline_state;
+		ID3D12DescriptorHeap heap;
+		D3D12_VERTEX_BUFFER_VIEW vertex_buffer = { 100, 10, 4 };
+		D3D12_INDEX_BUFFER_VIEW index_buffer = { 200, 10, DXGI_FORMAT_R16_UINT };
+		D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 10.0f, 10.0f, 0.0f, 1.0f };
+		D3D12_RECT scissor = { 0, 0, 10, 10 };
+		D3D12_CPU_DESCRIPTOR_HANDLE rtv = { 5 };
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv = { 6 };
+	};
+
+	//メッシュ毎に全てのステートを設定し直す、素朴な描画ループ。変わるのはルート定数だけ
+	template <class CommandList>
+	void DrawMeshes(CommandList& command_list, Scene& scene, unsigned int mesh_count)
+	{
+		ID3D12DescriptorHeap* heaps[] = { &scene.heap };
+		for (unsigned int mesh = 0; mesh < mesh_count; mesh++) {
+			command_list.OMSetRenderTargets(1, &scene.rtv, FALSE, &scene.dsv);
+			command_list.RSSetViewports(1, &scene.viewport);
+			command_list.RSSetScissorRects(1, &scene.scissor);
+			command_list.SetGraphicsRootSignature(&scene.root_signature);
+			command_list.SetPipelineState(&scene.pipeline_state);
+			command_list.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			command_list.SetDescriptorHeaps(1, heaps);
+			command_list.SetGraphicsRootShaderResourceView(0, 1000);
+			command_list.SetGraphicsRootDescriptorTable(5, D3D12_GPU_DESCRIPTOR_HANDLE{ 77 });
+			command_list.IASetVertexBuffers(0, 1, &scene.vertex_buffer);
+			command_list.IASetIndexBuffer(&scene.index_buffer);
+			command_list.SetGraphicsRoot32BitConstant(6, mesh % 3, 0);
+			command_list.SetGraphicsRoot32BitConstant(7, mesh, 0);
+		}
+	}
+}
+
+int main()
+{
+	Scene scene;
+	constexpr unsigned int MESH_COUNT = 10;
+
+	//1回目だけ積まれ、以降は値の変わったルート定数だけが積まれる
+	{
+		NullCommandList command_list;
+		StateFilteredCommandList<NullCommandList> filter(&command_list);
+		for (int frame = 0; frame < 2; frame++) {
+			//コマンドリストをResetしたらフィルターもResetする
+			filter.Reset();
+			command_list.Clear();
+			DrawMeshes(filter, scene, MESH_COUNT);
+			const Stats& stats = filter.GetStats();
+			CHECK(stats.GetIssuedCount() == command_list.GetTotalCount());
+			CHECK(stats.GetIssuedCount() + stats.GetSkippedCount() == MESH_COUNT * 13);
+			CHECK(command_list.GetCount(Op::SetPipelineState) == 1);
+			CHECK(command_list.GetCount(Op::OMSetRenderTargets) == 1);
+			CHECK(command_list.GetCount(Op::IASetVertexBuffers) == 1);
+			CHECK(command_list.GetCount(Op::SetDescriptorHeaps) == 1);
+			//スロット6はmesh % 3が変わる度(10回)、スロット7は毎回
+			CHECK(command_list.GetCount(Op::SetGraphicsRoot32BitConstant) == MESH_COUNT * 2);
+			CHECK(stats.issued[Stats::RootParameter] == 2 + MESH_COUNT * 2);
+			CHECK(stats.skipped[Stats::PipelineState] == MESH_COUNT - 1);
+		}
+	}
+
+	//設定を無効にする操作の後は、同じ値でも積み直す
+	{
+		NullCommandList command_list;
+		StateFilteredCommandList<NullCommandList> filter(&command_list);
+		ID3D12RootSignature other_root_signature;
+		ID3D12DescriptorHeap* heaps[] = { &scene.heap };
+		DrawMeshes(filter, scene, 1);
+
+		//ルートシグネチャを変えると、ルートパラメータは全て未設定に戻る
+		command_list.Clear();
+		filter.SetGraphicsRootSignature(&other_root_signature);
+		filter.SetGraphicsRootShaderResourceView(0, 1000);
+		CHECK(command_list.GetTotalCount() == 2);
+
+		//ヒープを変えない限りテーブルは省かれる。Invalidateの後にヒープを積み直すとテーブルも積み直す
+		filter.SetGraphicsRootDescriptorTable(5, D3D12_GPU_DESCRIPTOR_HANDLE{ 77 });
+		command_list.Clear();
+		filter.SetGraphicsRootDescriptorTable(5, D3D12_GPU_DESCRIPTOR_HANDLE{ 77 });
+		filter.SetDescriptorHeaps(1, heaps);
+		CHECK(command_list.GetTotalCount() == 0);
+		filter.Invalidate();
+		filter.SetDescriptorHeaps(1, heaps);
+		filter.SetGraphicsRootDescriptorTable(5, D3D12_GPU_DESCRIPTOR_HANDLE{ 77 });
+		CHECK(command_list.GetTotalCount() == 2);
+
+		//インデックスバッファを外すと、次の設定は必ず積む
+		command_list.Clear();
+		filter.IASetIndexBuffer(nullptr);
+		filter.IASetIndexBuffer(&scene.index_buffer);
+		filter.IASetIndexBuffer(&scene.index_buffer);
+		CHECK(command_list.GetCount(Op::IASetIndexBuffer) == 2);
+
+		//グラフィックスとコンピュートのルートパラメータは別々に追跡する
+		filter.SetGraphicsRootShaderResourceView(0, 1000);
+		command_list.Clear();
+		filter.SetComputeRootSignature(&scene.root_signature);
+		filter.SetComputeRootShaderResourceView(0, 1000);
+		filter.SetGraphicsRootShaderResourceView(0, 1000);
+		CHECK(command_list.GetCount(Op::SetComputeRootShaderResourceView) == 1);
+		CHECK(command_list.GetCount(Op::SetGraphicsRootShaderResourceView) == 0);
+	}
+
+	//アプリと同じ重ね方(フィルター -> 記録 -> コマンドリスト)では、省いたコマンドは記録もされない
+	{
+		NullCommandList command_list;
+		CommandStreamRecorder<NullCommandList> recorder(&command_list);
+		StateFilteredCommandList<CommandStreamRecorder<NullCommandList>> filter(&recorder);
+		CommandStream stream;
+		recorder.BeginCapture(&stream);
+		DrawMeshes(filter, scene, MESH_COUNT);
+		recorder.EndCapture();
+		CHECK(stream.GetCommandCount() == filter.GetStats().GetIssuedCount());
+		CHECK(command_list.GetTotalCount() == filter.GetStats().GetIssuedCount());
+	}
+
+	return TestResult();
+}
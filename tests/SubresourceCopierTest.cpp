@@ -0,0 +1,90 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/SubresourceCopier/SubresourceCopier.h"
+
+#include <random>
+
+using namespace System;
+
+int main()
+{
+	std::mt19937 rng(5);
+	constexpr uint8_t UNTOUCHED = 0xEE;
+
+	//幅が64バイトや16バイトの倍数でないもの、コピー元が16バイト境界にないもの、3Dテクスチャの面を含めて試す
+	const size_t widths[] = { 1, 3, 5, 15, 16, 17, 63, 64, 65, 407, 1000 };
+	const size_t pixel_sizes[] = { 1, 4, 16 };
+	const size_t misalignments[] = { 0, 1, 7 };
+	const size_t slice_counts[] = { 1, 3 };
+	for (size_t width : widths) {
+		for (size_t pixel_size : pixel_sizes) {
+			for (size_t misalignment : misalignments) {
+				for (size_t slice_count : slice_counts) {
+					constexpr size_t ROW_COUNT = 7;
+					size_t row_size = width * pixel_size;
+					size_t src_row_pitch = row_size + (width % 3) * 4;
+					size_t dst_row_pitch = (row_size + 255) / 256 * 256;
+					size_t src_slice_pitch = src_row_pitch * ROW_COUNT;
+					size_t dst_slice_pitch = dst_row_pitch * ROW_COUNT;
+
+					//コピー元は最後の行のrow_sizeまでしか無い(その先を読めばASanで分かる)
+					size_t src_size = src_row_pitch * (ROW_COUNT * slice_count - 1) + row_size;
+					std::vector<uint8_t> storage(src_size + misalignment);
+					for (uint8_t& value : storage)
+						value = static_cast<uint8_t>(rng());
+					std::vector<uint8_t> src(storage.begin() + misalignment, storage.end());
+
+					std::vector<uint8_t> streamed(dst_slice_pitch * slice_count, UNTOUCHED);
+					std::vector<uint8_t> copied = streamed;
+					SubresourceCopier::CopySubresource(streamed.data(), dst_row_pitch, dst_slice_pitch, src.data(), src_row_pitch, src_slice_pitch,
+						row_size, ROW_COUNT, slice_count, true);
+					SubresourceCopier::CopySubresource(copied.data(), dst_row_pitch, dst_slice_pitch, src.data(), src_row_pitch, src_slice_pitch,
+						row_size, ROW_COUNT, slice_count, false);
+					SubresourceCopier::Finish();
+					CHECK(streamed == copied);
+
+					bool rows_match = true;
+					bool padding_untouched = true;
+					for (size_t slice = 0; slice < slice_count; slice++) {
+						for (size_t row = 0; row < ROW_COUNT; row++) {
+							const uint8_t* dst_row = &streamed[slice * dst_slice_pitch + row * dst_row_pitch];
+							rows_match = rows_match && std::memcmp(dst_row, &src[slice * src_slice_pitch + row * src_row_pitch], row_size) == 0;
+							//行の後ろの隙間には書かない
+							for (size_t x = row_size; x < dst_row_pitch; x++)
+								padding_untouched = padding_untouched && dst_row[x] == UNTOUCHED;
+						}
+					}
+					CHECK(rows_match);
+					CHECK(padding_untouched);
+				}
+			}
+		}
+	}
+
+	//ピッチが揃っている場合は、書き込み先がずれていても1つの連続した領域としてコピーする
+	{
+		std::vector<uint8_t> src(256 * 100);
+		for (uint8_t& value : src)
+			value = static_cast<uint8_t>(rng());
+		std::vector<uint8_t> dst(src.size() + 4, UNTOUCHED);
+		SubresourceCopier::CopySubresource(dst.data() + 3, 256, 256 * 100, src.data(), 256, 256 * 100, 256, 100, 1);
+		SubresourceCopier::Finish();
+		CHECK(std::memcmp(dst.data() + 3, src.data(), src.size()) == 0);
+		CHECK(dst[2] == UNTOUCHED && dst.back() == UNTOUCHED);
+	}
+
+	//連続した領域のコピーは、長さや書き込み先の位置によらずmemcpyと同じ
+	for (size_t size : { 0, 1, 15, 16, 17, 64, 65, 200, 4099 }) {
+		for (size_t offset : { 0, 5, 12 }) {
+			std::vector<uint8_t> src(size);
+			for (uint8_t& value : src)
+				value = static_cast<uint8_t>(rng());
+			std::vector<uint8_t> dst(size + 32, UNTOUCHED);
+			SubresourceCopier::CopyStreaming(dst.data() + offset, src.data(), size);
+			SubresourceCopier::Finish();
+			CHECK(size == 0 || std::memcmp(dst.data() + offset, src.data(), size) == 0);
+			CHECK((offset == 0 || dst[offset - 1] == UNTOUCHED) && dst[offset + size] == UNTOUCHED);
+		}
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <cstdio>
+
+//-------------------------------------------------------------
+// @brief テストで使う確認のマクロ
+// @details 条件を満たさなければ場所と式を出力して失敗を数え、そのまま続ける。
+//			mainの最後でTestResult()を返せば、1つでも失敗していれば0以外で終わる
+//-------------------------------------------------------------
+namespace TestCommon {
+	inline int failure_count = 0;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #condition); \
+			TestCommon::failure_count++; \
+		} \
+	} while (0)
+
+// @brief 失敗の数を出力し、mainの戻り値にする値を返す
+inline int TestResult()
+{
+	if (TestCommon::failure_count == 0) {
+		std::printf("OK\n");
+		return 0;
+	}
+	std::printf("%d check(s) failed\n", TestCommon::failure_count);
+	return 1;
+}
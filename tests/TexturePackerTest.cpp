@@ -0,0 +1,219 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/TexturePacker/TexturePacker.h"
+
+#include <cmath>
+#include <random>
+
+using namespace System;
+using Item = TexturePacker::Item;
+using Placement = TexturePacker::Placement;
+
+namespace {
+	constexpr uint32_t FORMAT_RGBA8 = 28;	// DXGI_FORMAT_R8G8B8A8_UNORM
+	constexpr uint32_t FORMAT_BC1 = 71;		// DXGI_FORMAT_BC1_UNORM
+
+	Item MakeItem(uint32_t width, uint32_t height, uint32_t format = FORMAT_RGBA8, uint32_t block_size = 1, uint32_t mip_levels = 1)
+	{
+		Item item;
+		item.width = width;
+		item.height = height;
+		item.format = format;
+		item.block_size = block_size;
+		item.mip_levels = mip_levels;
+		return item;
+	}
+
+	//同じ要素に置いたテクスチャの領域(余白を含む)が重ならず、ビンからはみ出していないか
+	bool IsValidLayout(const TexturePacker& packer)
+	{
+		const std::vector<Placement>& placements = packer.GetPlacements();
+		for (size_t i = 0; i < placements.size(); i++) {
+			const Placement& a = placements[i];
+			if (a.bin == TexturePacker::INVALID_INDEX)
+				continue;
+			const TexturePacker::Bin& bin = packer.GetBins()[a.bin];
+			if (a.layer >= bin.layer_count || a.frame_x + a.frame_width > bin.width || a.frame_y + a.frame_height > bin.height)
+				return false;
+			for (size_t j = i + 1; j < placements.size(); j++) {
+				const Placement& b = placements[j];
+				if (b.bin != a.bin || b.layer != a.layer)
+					continue;
+				if (a.frame_x < b.frame_x + b.frame_width && b.frame_x < a.frame_x + a.frame_width &&
+					a.frame_y < b.frame_y + b.frame_height && b.frame_y < a.frame_y + a.frame_height)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	//アトラスに置いたものが、全てのミップでテクセルの境界に乗り、周りにpaddingテクセル以上の余白が残っているか
+	bool IsAlignedAtEveryMip(const TexturePacker& packer, uint32_t padding)
+	{
+		for (const Placement& placement : packer.GetPlacements()) {
+			if (placement.bin == TexturePacker::INVALID_INDEX)
+				continue;
+			const TexturePacker::Bin& bin = packer.GetBins()[placement.bin];
+			if (bin.type != TexturePacker::BinType::Atlas)
+				continue;
+			uint32_t cell = TexturePacker::GetCellSize(bin.block_size, bin.mip_levels);
+			if (placement.x % cell != 0 || placement.y % cell != 0 || placement.frame_x % cell != 0 || placement.frame_y % cell != 0 ||
+				placement.frame_width % cell != 0 || placement.frame_height % cell != 0)
+				return false;
+			for (uint32_t mip = 0; mip < bin.mip_levels; mip++) {
+				//中身はそのミップでの端のテクセルを含む範囲(切り上げ)、領域はセル単位なので割り切れる
+				uint32_t left = (placement.x - placement.frame_x) >> mip;
+				uint32_t top = (placement.y - placement.frame_y) >> mip;
+				uint32_t right = ((placement.frame_x + placement.frame_width) >> mip) - ((placement.x + placement.width + (1u << mip) - 1) >> mip);
+				uint32_t bottom = ((placement.frame_y + placement.frame_height) >> mip) - ((placement.y + placement.height + (1u << mip) - 1) >> mip);
+				if (left < padding || top < padding || right < padding || bottom < padding)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	//ばらばらの大きさを詰めても重ならず、どのミップでもセルの境界に乗って余白が残る
+	for (uint32_t mip_levels : { 1u, 3u, 5u }) {
+		for (uint32_t padding : { 1u, 2u }) {
+			std::mt19937 random(mip_levels * 10 + padding);
+			std::uniform_int_distribution<uint32_t> size(1, 200);
+			std::vector<Item> items;
+			for (int i = 0; i < 300; i++)
+				items.push_back(MakeItem(size(random), size(random)));
+			TexturePacker packer;
+			TexturePacker::Settings settings;
+			settings.mip_levels = mip_levels;
+			settings.padding = padding;
+			settings.allow_arrays = false;
+			CHECK(packer.Pack(items, settings) == items.size());
+			CHECK(packer.GetBins().size() == 1);
+			CHECK(packer.GetBins()[0].type == TexturePacker::BinType::Atlas && packer.GetBins()[0].mip_levels == mip_levels);
+			CHECK(IsValidLayout(packer));
+			CHECK(IsAlignedAtEveryMip(packer, padding));
+			//ビンの大きさはセルの倍数の2の累乗
+			const TexturePacker::Bin& bin = packer.GetBins()[0];
+			CHECK((bin.width & (bin.width - 1)) == 0 && (bin.height & (bin.height - 1)) == 0);
+			CHECK(bin.width % TexturePacker::GetCellSize(1, mip_levels) == 0);
+			CHECK(packer.GetOccupancy(0) > 0.0 && packer.GetOccupancy(0) <= 1.0);
+		}
+	}
+
+	//同じ大きさのものは、1つずつ配列の要素にまとめる。1つしか無い大きさはアトラスに回す
+	{
+		std::vector<Item> items;
+		for (int i = 0; i < 5; i++)
+			items.push_back(MakeItem(64, 32));
+		items.push_back(MakeItem(48, 48));
+		items.push_back(MakeItem(64, 32, FORMAT_BC1, 4, 3));	// フォーマットが違うので別扱い
+		TexturePacker packer;
+		TexturePacker::Settings settings;
+		settings.max_layers = 3;
+		CHECK(packer.Pack(items, settings) == 6);
+		const std::vector<Placement>& placements = packer.GetPlacements();
+		uint32_t array_bin = placements[0].bin;
+		CHECK(array_bin != TexturePacker::INVALID_INDEX);
+		const TexturePacker::Bin& bin = packer.GetBins()[array_bin];
+		CHECK(bin.type == TexturePacker::BinType::Array && bin.width == 64 && bin.height == 32);
+		CHECK(bin.layer_count == 3);
+		CHECK(bin.mip_levels == 7);	// 非圧縮のものは1x1まで作る
+		//要素数の上限を超えた分は、次のビンに入る
+		for (int i = 0; i < 5; i++) {
+			CHECK(placements[i].bin == array_bin + (i < 3 ? 0 : 1));
+			CHECK(placements[i].layer == static_cast<uint32_t>(i % 3));
+			CHECK(placements[i].x == 0 && placements[i].y == 0 && placements[i].width == 64 && placements[i].height == 32);
+		}
+		CHECK(packer.GetBins()[array_bin + 1].layer_count == 2);
+		CHECK(placements[5].bin != TexturePacker::INVALID_INDEX && packer.GetBins()[placements[5].bin].type == TexturePacker::BinType::Atlas);
+		CHECK(placements[6].bin == TexturePacker::INVALID_INDEX);
+		CHECK(IsValidLayout(packer));
+	}
+
+	//ブロック圧縮のものはアトラスには詰めず、同じ大きさだけを配列にまとめる(ミップは全員が持っている段数まで)
+	{
+		std::vector<Item> items = {
+			MakeItem(128, 128, FORMAT_BC1, 4, 8),
+			MakeItem(128, 128, FORMAT_BC1, 4, 5),
+			MakeItem(64, 64, FORMAT_BC1, 4, 7),
+			MakeItem(32, 16, FORMAT_BC1, 4, 6),
+		};
+		TexturePacker packer;
+		CHECK(packer.Pack(items, TexturePacker::Settings()) == 2);
+		const std::vector<Placement>& placements = packer.GetPlacements();
+		CHECK(placements[0].bin != TexturePacker::INVALID_INDEX && placements[0].bin == placements[1].bin);
+		CHECK(packer.GetBins()[placements[0].bin].mip_levels == 5);
+		CHECK(packer.GetBins()[placements[0].bin].block_size == 4);
+		CHECK(placements[2].bin == TexturePacker::INVALID_INDEX && placements[3].bin == TexturePacker::INVALID_INDEX);
+		for (const TexturePacker::Bin& bin : packer.GetBins())
+			CHECK(bin.type == TexturePacker::BinType::Array);
+
+		//配列も使わなければ、何もまとめない
+		TexturePacker::Settings settings;
+		settings.allow_arrays = false;
+		CHECK(packer.Pack(items, settings) == 0);
+		CHECK(packer.GetBins().empty());
+	}
+
+	//要素がいっぱいになったら次の要素に置き、要素数の上限に達したら残りはまとめない
+	{
+		//256テクセルの要素に、余白込みで102テクセルのものは2x2個まで入る
+		std::vector<Item> items(10, MakeItem(100, 100));
+		for (size_t i = 0; i < items.size(); i++)
+			items[i].width = 100 - static_cast<uint32_t>(i % 2);	// 大きさを変えて、配列にまとめられないようにする
+		TexturePacker packer;
+		TexturePacker::Settings settings;
+		settings.layer_size = 256;
+		settings.mip_levels = 1;
+		settings.allow_arrays = false;
+		CHECK(packer.Pack(items, settings) == 10);
+		CHECK(packer.GetBins().size() == 1 && packer.GetBins()[0].layer_count == 3);
+		CHECK(IsValidLayout(packer));
+		std::vector<uint32_t> per_layer(3);
+		for (const Placement& placement : packer.GetPlacements())
+			per_layer[placement.layer]++;
+		CHECK(per_layer == std::vector<uint32_t>({ 4, 4, 2 }));
+
+		settings.max_layers = 2;
+		CHECK(packer.Pack(items, settings) == 8);
+		CHECK(packer.GetBins()[0].layer_count == 2);
+		uint32_t unpacked = 0;
+		for (const Placement& placement : packer.GetPlacements())
+			unpacked += placement.bin == TexturePacker::INVALID_INDEX ? 1 : 0;
+		CHECK(unpacked == 2);
+
+		//余白込みで要素に入らない大きさと、max_item_sizeより大きいものはまとめない
+		std::vector<Item> large = { MakeItem(255, 10), MakeItem(200, 10) };
+		settings.max_item_size = 199;
+		CHECK(packer.Pack(large, settings) == 0);
+	}
+
+	//UVの変換は、中身の範囲をビン全体に対する比率で表す
+	{
+		std::vector<Item> items = { MakeItem(100, 60), MakeItem(30, 20), MakeItem(16, 16), MakeItem(16, 16) };
+		TexturePacker packer;
+		CHECK(packer.Pack(items, TexturePacker::Settings()) == 4);
+		for (uint32_t i = 0; i < items.size(); i++) {
+			const Placement& placement = packer.GetPlacements()[i];
+			const TexturePacker::Bin& bin = packer.GetBins()[placement.bin];
+			TexturePacker::UVTransform transform = packer.GetUVTransform(i);
+			//元のUVの(0,0)と(1,1)が、まとめた先の中身の左上と右下になる
+			float u0 = 0.0f * transform.scale_u + transform.offset_u;
+			float v0 = 0.0f * transform.scale_v + transform.offset_v;
+			float u1 = 1.0f * transform.scale_u + transform.offset_u;
+			float v1 = 1.0f * transform.scale_v + transform.offset_v;
+			CHECK(std::fabs(u0 * bin.width - placement.x) < 1e-3f && std::fabs(v0 * bin.height - placement.y) < 1e-3f);
+			CHECK(std::fabs(u1 * bin.width - (placement.x + items[i].width)) < 1e-3f);
+			CHECK(std::fabs(v1 * bin.height - (placement.y + items[i].height)) < 1e-3f);
+		}
+		//配列の要素は、そのまま全体を使う
+		TexturePacker::UVTransform array_transform = packer.GetUVTransform(2);
+		CHECK(array_transform.offset_u == 0.0f && array_transform.offset_v == 0.0f && array_transform.scale_u == 1.0f && array_transform.scale_v == 1.0f);
+		//まとめなかったもの・範囲外の番号は、変換しない
+		TexturePacker::UVTransform identity = packer.GetUVTransform(100);
+		CHECK(identity.offset_u == 0.0f && identity.offset_v == 0.0f && identity.scale_u == 1.0f && identity.scale_v == 1.0f);
+	}
+
+	return TestResult();
+}
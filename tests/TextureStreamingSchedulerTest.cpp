@@ -0,0 +1,209 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/TextureStreamingScheduler/TextureStreamingScheduler.h"
+
+#include <deque>
+
+using namespace System;
+using Scheduler = TextureStreamingScheduler;
+
+namespace {
+	//-------------------------------------------------------------
+	// 転送の代わりに、指示を受け取った順にlatencyフレーム後に完了させるデバイス
+	// 完了した指示を反映した、テクスチャ毎の常駐ミップも持っておく(スケジューラーの値と食い違わないことを確かめる)
+	//-------------------------------------------------------------
+	class SimulatedDevice
+	{
+	private:
+		struct Job {
+			Scheduler::Request request;
+			int completion_frame;
+		};
+		std::deque<Job> jobs;
+		int latency;
+		int fail_interval;
+		int completed_count = 0;
+
+	public:
+		std::vector<unsigned int> resident_mips;
+
+		SimulatedDevice(int latency_, int fail_interval_ = 0) :latency(latency_), fail_interval(fail_interval_) {}
+
+		void Submit(const std::vector<Scheduler::Request>& requests, int frame) {
+			for (const Scheduler::Request& request : requests)
+				jobs.push_back({ request, frame + latency });
+		}
+		// @brief frameまでに終わる転送を完了させる。fail_interval回に1回は失敗させる
+		void Tick(Scheduler& scheduler, int frame) {
+			while (!jobs.empty() && jobs.front().completion_frame <= frame) {
+				const Scheduler::Request& request = jobs.front().request;
+				completed_count++;
+				bool succeeded = fail_interval == 0 || completed_count % fail_interval != 0;
+				if (succeeded)
+					resident_mips[request.texture] = request.first_mip;
+				scheduler.OnCompleted(request.texture, succeeded);
+				jobs.pop_front();
+			}
+		}
+		bool IsIdle() const { return jobs.empty(); }
+	};
+
+	//BC7の正方形のテクスチャの、ミップ毎のバイト数
+	std::vector<uint64_t> MakeBC7Mips(unsigned int size)
+	{
+		std::vector<uint64_t> mip_sizes;
+		for (unsigned int s = size;; s /= 2) {
+			uint64_t blocks = std::max(1u, (s + 3) / 4);
+			mip_sizes.push_back(blocks * blocks * 16);
+			if (s == 1)
+				break;
+		}
+		return mip_sizes;
+	}
+
+	unsigned int Register(Scheduler& scheduler, SimulatedDevice& device, const std::vector<uint64_t>& mip_sizes, unsigned int tail_mip)
+	{
+		device.resident_mips.push_back(tail_mip);
+		return scheduler.Register(mip_sizes, tail_mip);
+	}
+}
+
+int main()
+{
+	//画面上の大きさから求めるミップ
+	CHECK(Scheduler::ComputeDesiredMip(2048, 2048.0f, 12) == 0);
+	CHECK(Scheduler::ComputeDesiredMip(2048, 4000.0f, 12) == 0);
+	CHECK(Scheduler::ComputeDesiredMip(2048, 1024.0f, 12) == 1);
+	CHECK(Scheduler::ComputeDesiredMip(2048, 700.0f, 12) == 1);
+	CHECK(Scheduler::ComputeDesiredMip(2048, 1.0f, 12) == 11);
+	CHECK(Scheduler::ComputeDesiredMip(2048, 0.0f, 12) == 11);
+
+	std::vector<Scheduler::Request> requests;
+
+	//予算が十分なら要求どおりに収束し、同時の読み込みは上限を超えない
+	{
+		Scheduler scheduler(1ull << 30, 2);
+		SimulatedDevice device(3);
+		const std::vector<uint64_t> mip_sizes = MakeBC7Mips(2048);
+		constexpr unsigned int TAIL_MIP = 5;
+		std::vector<unsigned int> textures;
+		for (int i = 0; i < 6; i++)
+			textures.push_back(Register(scheduler, device, mip_sizes, TAIL_MIP));
+		CHECK(scheduler.GetCommittedBytes() == 6 * Scheduler::GetSizeFrom(mip_sizes, TAIL_MIP));
+		for (int frame = 0; frame < 100; frame++) {
+			device.Tick(scheduler, frame);
+			for (unsigned int texture : textures)
+				scheduler.RequestMip(texture, texture % 3);
+			scheduler.Update(requests);
+			device.Submit(requests, frame);
+			CHECK(scheduler.GetLoadsInFlight() <= 2);
+		}
+		for (unsigned int texture : textures) {
+			CHECK(scheduler.GetResidentMip(texture) == texture % 3);
+			CHECK(device.resident_mips[texture] == texture % 3);
+		}
+	}
+
+	//8枚の全ミップは入らない予算で、常に使う2枚と、100フレーム毎に入れ替わる1枚を使う
+	{
+		const std::vector<uint64_t> mip_sizes = MakeBC7Mips(2048);
+		const uint64_t budget = Scheduler::GetSizeFrom(mip_sizes, 0) * 3;
+		Scheduler scheduler(budget, 2);
+		SimulatedDevice device(2);
+		for (int i = 0; i < 8; i++)
+			Register(scheduler, device, mip_sizes, 5);
+		for (int frame = 0; frame < 400; frame++) {
+			device.Tick(scheduler, frame);
+			int phase = frame / 100;
+			scheduler.RequestMip(0, 0);
+			scheduler.RequestMip(1, 1);
+			scheduler.RequestMip(2 + phase, 0);
+			scheduler.Update(requests);
+			device.Submit(requests, frame);
+			CHECK(scheduler.GetCommittedBytes() <= budget);
+			//デバイス側で完了した分だけを数えても、予算を超えない(追い出しを読み込みより先に出しているため)
+			uint64_t device_bytes = 0;
+			for (unsigned int mip : device.resident_mips)
+				device_bytes += Scheduler::GetSizeFrom(mip_sizes, mip);
+			CHECK(device_bytes <= budget);
+			if (frame % 100 == 99) {
+				CHECK(scheduler.GetResidentMip(0) == 0);
+				CHECK(scheduler.GetResidentMip(1) == 1);
+				CHECK(scheduler.GetResidentMip(2 + phase) == 0);
+			}
+		}
+	}
+
+	//使われなくなったテクスチャは、最後に使われたのが古いものから追い出す
+	{
+		const std::vector<uint64_t> mip_sizes = MakeBC7Mips(1024);
+		constexpr unsigned int TAIL_MIP = 4;
+		const uint64_t full_size = Scheduler::GetSizeFrom(mip_sizes, 0);
+		const uint64_t tail_size = Scheduler::GetSizeFrom(mip_sizes, TAIL_MIP);
+		Scheduler scheduler(full_size * 2 + tail_size, 1);
+		SimulatedDevice device(1);
+		unsigned int a = Register(scheduler, device, mip_sizes, TAIL_MIP);
+		unsigned int b = Register(scheduler, device, mip_sizes, TAIL_MIP);
+		unsigned int c = Register(scheduler, device, mip_sizes, TAIL_MIP);
+		int frame = 0;
+		auto run = [&](const std::vector<unsigned int>& used, int frame_count) {
+			for (int i = 0; i < frame_count; i++, frame++) {
+				device.Tick(scheduler, frame);
+				for (unsigned int texture : used)
+					scheduler.RequestMip(texture, 0);
+				scheduler.Update(requests);
+				device.Submit(requests, frame);
+				CHECK(scheduler.GetCommittedBytes() <= scheduler.GetBudget());
+			}
+			};
+		run({ a }, 10);
+		run({ b }, 10);
+		CHECK(scheduler.GetResidentMip(a) == 0 && scheduler.GetResidentMip(b) == 0);
+		//aが一番古いので、aを追い出してcを読む
+		run({ c }, 10);
+		CHECK(scheduler.GetResidentMip(c) == 0 && scheduler.GetResidentMip(a) > 0 && scheduler.GetResidentMip(b) == 0);
+
+		//予算を下げると、使われていないものから末尾のミップまで追い出す
+		scheduler.SetBudget(full_size + tail_size * 2);
+		run({ c }, 10);
+		CHECK(scheduler.GetResidentMip(c) == 0 && scheduler.GetResidentMip(a) == TAIL_MIP && scheduler.GetResidentMip(b) == TAIL_MIP);
+
+		//全てを使っても、使われているcは要求されたミップより粗くはしない。空きが無いので、aとbは読まない
+		run({ a, b, c }, 10);
+		CHECK(scheduler.GetCommittedBytes() <= scheduler.GetBudget());
+		CHECK(scheduler.GetResidentMip(c) == 0 && scheduler.GetResidentMip(a) == TAIL_MIP && scheduler.GetResidentMip(b) == TAIL_MIP);
+		//予算を少し増やせば、入る所まで粗くして読む
+		scheduler.SetBudget(full_size + tail_size * 2 + mip_sizes[TAIL_MIP - 1] * 2);
+		run({ a, b, c }, 10);
+		CHECK(scheduler.GetCommittedBytes() <= scheduler.GetBudget());
+		CHECK(scheduler.GetResidentMip(a) == TAIL_MIP - 1 && scheduler.GetResidentMip(b) == TAIL_MIP - 1);
+
+		//登録を外したものは予算に数えず、完了の通知も無視する
+		uint64_t before = scheduler.GetCommittedBytes();
+		uint64_t removed = Scheduler::GetSizeFrom(mip_sizes, scheduler.GetResidentMip(c));
+		run({}, 5);
+		scheduler.Unregister(c);
+		CHECK(scheduler.GetCommittedBytes() <= before - removed);
+		scheduler.OnCompleted(c, true);
+		scheduler.RequestMip(c, 0);
+		scheduler.Update(requests);
+		for (const Scheduler::Request& request : requests)
+			CHECK(request.texture != c);
+	}
+
+	//転送が失敗しても常駐しているミップは変わらず、次のフレームにやり直す
+	{
+		Scheduler scheduler(1ull << 30, 1);
+		SimulatedDevice device(1, 2);
+		unsigned int texture = Register(scheduler, device, MakeBC7Mips(512), 4);
+		for (int frame = 0; frame < 20; frame++) {
+			device.Tick(scheduler, frame);
+			scheduler.RequestMip(texture, 0);
+			scheduler.Update(requests);
+			device.Submit(requests, frame);
+			CHECK(scheduler.GetResidentMip(texture) == device.resident_mips[texture]);
+		}
+		CHECK(scheduler.GetResidentMip(texture) == 0);
+	}
+
+	return TestResult();
+}
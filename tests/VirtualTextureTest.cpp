@@ -0,0 +1,204 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/TextureTools/VirtualTextureFeedback/VirtualTextureFeedback.h"
+#include "System/SystemUtils/TextureTools/VirtualTexturePageCache/VirtualTexturePageCache.h"
+#include "System/SystemUtils/TextureTools/VirtualTexturePageTable/VirtualTexturePageTable.h"
+
+using namespace System;
+using Feedback = VirtualTextureFeedback;
+using PageCache = VirtualTexturePageCache;
+using PageTable = VirtualTexturePageTable;
+
+namespace {
+	constexpr uint32_t SLOTS_X = 4;
+
+	uint32_t GetEntrySlot(uint32_t entry) { return ((entry >> 8) & 0xff) * SLOTS_X + (entry & 0xff); }
+
+	//-------------------------------------------------------------
+	// 表の全ての要素が、キャッシュにある一番細かい祖先(自分を含む)のスロットを指しているかを確かめる
+	//-------------------------------------------------------------
+	bool IsTableConsistent(const PageTable& table, const PageCache& cache, uint32_t texture)
+	{
+		uint32_t mip_count = table.GetMipCount(texture);
+		uint32_t pages = 1u << (mip_count - 1);
+		for (uint32_t mip = 0; mip < mip_count; mip++, pages >>= 1) {
+			for (uint32_t y = 0; y < std::max(1u, pages); y++) {
+				for (uint32_t x = 0; x < std::max(1u, pages); x++) {
+					uint32_t expected_mip = mip;
+					uint32_t ax = x;
+					uint32_t ay = y;
+					uint32_t expected_slot = PageCache::INVALID_SLOT;
+					for (; expected_mip < mip_count; expected_mip++, ax >>= 1, ay >>= 1) {
+						uint32_t slot = cache.Find(Feedback::Pack({ texture, expected_mip, ax, ay }));
+						if (slot != PageCache::INVALID_SLOT && cache.GetSlotState(slot) == PageCache::SlotState::Resident) {
+							expected_slot = slot;
+							break;
+						}
+					}
+					uint32_t entry = table.GetEntry(texture, mip, x, y);
+					if (expected_slot == PageCache::INVALID_SLOT) {
+						if (PageTable::IsValidEntry(entry))
+							return false;
+						continue;
+					}
+					if (!PageTable::IsValidEntry(entry) || PageTable::GetEntryMip(entry) != expected_mip || GetEntrySlot(entry) != expected_slot)
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	//フィードバックの集計: 重複をまとめ、親を加え、面積の大きい順に並べる
+	{
+		Feedback feedback;
+		feedback.SetMipCount(0, 4);
+		std::vector<uint32_t> buffer(1000, Feedback::EMPTY);
+		for (int i = 0; i < 100; i++)
+			buffer[i] = Feedback::Pack({ 0, 0, 5, 6 });
+		for (int i = 100; i < 110; i++)
+			buffer[i] = Feedback::Pack({ 0, 0, 4, 6 });
+		//登録されていないテクスチャと、無いミップは捨てる
+		buffer[200] = Feedback::Pack({ 3, 0, 0, 0 });
+		buffer[201] = Feedback::Pack({ 0, 7, 0, 0 });
+		std::vector<Feedback::Request> requests;
+		feedback.Analyze(buffer.data(), buffer.size(), requests);
+		CHECK(feedback.GetRejectedCount() == 2 && feedback.GetAnalyzedCount() == 112);
+		CHECK(requests.size() == 5);
+		if (requests.size() == 5) {
+			CHECK(requests[0].page == Feedback::Pack({ 0, 3, 0, 0 }) && requests[0].hits == 110);
+			CHECK(requests[1].page == Feedback::Pack({ 0, 2, 1, 1 }));
+			CHECK(requests[2].page == Feedback::Pack({ 0, 1, 2, 3 }) && requests[2].hits == 110);
+			CHECK(requests[3].page == Feedback::Pack({ 0, 0, 5, 6 }) && requests[3].hits == 100 && requests[3].priority == 100);
+			CHECK(requests[4].page == Feedback::Pack({ 0, 0, 4, 6 }));
+		}
+		CHECK(Feedback::GetParent(Feedback::Pack({ 2, 1, 7, 5 })) == Feedback::Pack({ 2, 2, 3, 2 }));
+	}
+
+	//キャッシュの追い出し: 固定したもの・このフレームに使われたもの・転送中のものは追い出さない
+	{
+		PageCache cache(3, 1);
+		uint32_t evicted = 0;
+		uint32_t slot0 = cache.Allocate(10, 1, evicted);
+		CHECK(slot0 == 0 && evicted == PageCache::INVALID_PAGE);
+		uint32_t slot1 = cache.Allocate(11, 1, evicted);
+		uint32_t slot2 = cache.Allocate(12, 1, evicted);
+		CHECK(slot1 == 1 && slot2 == 2 && cache.GetFreeCount() == 0);
+		CHECK(cache.Allocate(13, 1, evicted) == PageCache::INVALID_SLOT);
+		cache.Commit(slot0);
+		cache.Commit(slot1);
+		cache.Commit(slot2);
+		cache.SetPinned(slot0, true);
+		cache.Touch(11, 2);
+		CHECK(cache.Allocate(13, 3, evicted) == slot2 && evicted == 12);
+		CHECK(cache.Find(12) == PageCache::INVALID_SLOT && cache.Find(13) == slot2);
+		CHECK(cache.Allocate(14, 3, evicted) == slot1 && evicted == 11);
+		CHECK(cache.Allocate(15, 3, evicted) == PageCache::INVALID_SLOT);
+		CHECK(cache.GetEvictionCount() == 2);
+		cache.Free(slot1);
+		CHECK(cache.GetFreeCount() == 1 && cache.Find(14) == PageCache::INVALID_SLOT);
+		std::vector<uint32_t> order = cache.GetLruOrder();
+		CHECK(order.size() == 2 && order[0] == slot0 && order[1] == slot2);
+	}
+
+	//ページテーブル: 無いページは一番近い親のスロットを指す
+	{
+		PageTable table;
+		CHECK(table.AddTexture(1024, 1024, 128, 4) == 0);
+		CHECK(table.GetData().size() == PageTable::HEADER_SIZE + PageTable::MAX_TEXTURES * PageTable::INFO_STRIDE + 64 + 16 + 4 + 1);
+		table.SetResident(0, 3, 0, 0, 1, 2);
+		CHECK(table.GetEntry(0, 0, 7, 7) == PageTable::MakeEntry(3, 1, 2));
+		table.SetResident(0, 1, 2, 3, 0, 1);
+		CHECK(table.GetEntry(0, 0, 5, 6) == PageTable::MakeEntry(1, 0, 1));
+		CHECK(table.GetEntry(0, 0, 3, 6) == PageTable::MakeEntry(3, 1, 2));
+		table.SetResident(0, 0, 5, 6, 3, 0);
+		//後から粗いページを置いても、細かいページを読んでいる所は変えない
+		table.SetResident(0, 2, 1, 1, 2, 2);
+		CHECK(table.GetEntry(0, 0, 5, 6) == PageTable::MakeEntry(0, 3, 0));
+		CHECK(table.GetEntry(0, 0, 4, 6) == PageTable::MakeEntry(1, 0, 1));
+		CHECK(table.GetEntry(0, 0, 4, 4) == PageTable::MakeEntry(2, 2, 2));
+		table.SetEvicted(0, 1, 2, 3);
+		CHECK(table.GetEntry(0, 0, 4, 6) == PageTable::MakeEntry(2, 2, 2));
+		CHECK(table.GetEntry(0, 0, 5, 6) == PageTable::MakeEntry(0, 3, 0));
+		uint32_t begin = 0;
+		uint32_t count = 0;
+		CHECK(table.TakeDirtyRange(begin, count) && begin == 0 && count == table.GetData().size());
+		CHECK(!table.TakeDirtyRange(begin, count));
+		table.SetResident(0, 0, 0, 0, 1, 1);
+		CHECK(table.TakeDirtyRange(begin, count) && count == 1);
+	}
+
+	//作ったフィードバックで数百フレーム回す: カメラに見える範囲が横に動き、キャッシュは全ページより少ない
+	//表は毎フレーム、キャッシュにある一番細かい祖先を指していること
+	{
+		constexpr uint32_t MIP_COUNT = 4;	// 8x8、4x4、2x2、1x1ページ
+		constexpr uint64_t FRAME_COUNT = 310;	// 最後に窓が動いてから10フレーム後に止める
+		constexpr uint32_t SLOT_COUNT = 16;	// 窓1つ分(全ミップで最大15ページ)は入るが、全ページ(29)は入らない
+		Feedback feedback;
+		feedback.SetMipCount(0, MIP_COUNT);
+		PageCache cache(SLOT_COUNT, 2);
+		PageTable table;
+		CHECK(table.AddTexture(1024, 1024, 128, MIP_COUNT) == 0);
+
+		std::vector<uint32_t> buffer;
+		std::vector<Feedback::Request> requests;
+		std::vector<uint32_t> loading;
+		bool consistent = true;
+		bool top_resident = true;
+		uint64_t loads = 0;
+		for (uint64_t frame = 1; frame <= FRAME_COUNT; frame++) {
+			//前のフレームに出した転送は、このフレームに終わる
+			for (uint32_t slot : loading) {
+				cache.Commit(slot);
+				Feedback::PageId id = Feedback::Unpack(cache.GetSlotPage(slot));
+				table.SetResident(id.texture, id.mip, id.x, id.y, slot % SLOTS_X, slot / SLOTS_X);
+				//一番粗いミップは常に置いておく
+				if (id.mip == MIP_COUNT - 1)
+					cache.SetPinned(slot, true);
+			}
+			loading.clear();
+
+			//3x2ページの窓が、20フレーム毎に1ページずつ右に動く(端で折り返す)
+			buffer.assign(256, Feedback::EMPTY);
+			uint32_t left = static_cast<uint32_t>(frame / 20) % 6;
+			for (uint32_t i = 0; i < 200; i++) {
+				uint32_t x = left + i % 3;
+				uint32_t y = 3 + (i / 3) % 2;
+				//画面の奥の方は1つ粗いミップで書かれる
+				uint32_t mip = i % 5 == 0 ? 1 : 0;
+				buffer[i] = Feedback::Pack({ 0, mip, x >> mip, y >> mip });
+			}
+			feedback.Analyze(buffer.data(), buffer.size(), requests);
+
+			for (const Feedback::Request& request : requests) {
+				if (cache.Touch(request.page, frame))
+					continue;
+				uint32_t evicted = PageCache::INVALID_PAGE;
+				uint32_t slot = cache.Allocate(request.page, frame, evicted);
+				if (slot == PageCache::INVALID_SLOT)
+					break;
+				if (evicted != PageCache::INVALID_PAGE) {
+					Feedback::PageId id = Feedback::Unpack(evicted);
+					table.SetEvicted(id.texture, id.mip, id.x, id.y);
+				}
+				loading.push_back(slot);
+				loads++;
+			}
+			consistent = consistent && IsTableConsistent(table, cache, 0);
+			if (frame > 1)
+				top_resident = top_resident && PageTable::IsValidEntry(table.GetEntry(0, MIP_COUNT - 1, 0, 0));
+		}
+		CHECK(consistent);
+		CHECK(top_resident);
+		//窓の中のページは、動きが止まっている間に全て読み終わる
+		uint32_t left = static_cast<uint32_t>(FRAME_COUNT / 20) % 6;
+		for (uint32_t x = left; x < left + 3; x++)
+			CHECK(PageTable::GetEntryMip(table.GetEntry(0, 0, x, 3)) == 0 && PageTable::GetEntryMip(table.GetEntry(0, 0, x, 4)) == 0);
+		//キャッシュより多くのページを使ったので、追い出しが起きている
+		CHECK(cache.GetEvictionCount() > 0 && loads > SLOT_COUNT);
+	}
+
+	return TestResult();
+}
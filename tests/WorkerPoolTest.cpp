@@ -0,0 +1,79 @@
+﻿#include "TestCommon.h"
+#include "System/SystemUtils/Thread/WorkerPool/WorkerPool.h"
+
+using namespace System;
+
+namespace {
+	//countの仕事を流して、どれも1回ずつ処理されたかを確かめる
+	bool RunsEachTaskOnce(WorkerPool& pool, unsigned int count)
+	{
+		std::vector<std::atomic<unsigned int>> calls(count);
+		pool.Run(count, [&calls](unsigned int index) { calls[index]++; });
+		for (std::atomic<unsigned int>& call : calls) {
+			if (call.load() != 1)
+				return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	//仕事の数が作業スレッドより多くても少なくても、全ての仕事を1回ずつ処理する。同じスレッドを何度使い回してもよい
+	{
+		WorkerPool pool(3, "WorkerPoolTest");
+		CHECK(pool.GetWorkerCount() == 3);
+		for (int frame = 0; frame < 1000; frame++) {
+			CHECK(RunsEachTaskOnce(pool, 4));
+			CHECK(RunsEachTaskOnce(pool, static_cast<unsigned int>(frame % 11)));
+		}
+	}
+
+	//作業スレッドが0なら、全て呼び出したスレッドで順に処理する
+	{
+		WorkerPool pool(0, "WorkerPoolTest");
+		std::vector<unsigned int> order;
+		std::thread::id caller = std::this_thread::get_id();
+		bool same_thread = true;
+		pool.Run(5, [&](unsigned int index) {
+			order.push_back(index);
+			same_thread = same_thread && std::this_thread::get_id() == caller;
+			});
+		CHECK(order == std::vector<unsigned int>({ 0, 1, 2, 3, 4 }));
+		CHECK(same_thread);
+	}
+
+	//Runから戻った時には、全ての仕事の書き込みが見えている
+	{
+		WorkerPool pool(4, "WorkerPoolTest");
+		std::vector<uint64_t> sums(5);
+		for (uint64_t frame = 0; frame < 200; frame++) {
+			pool.Run(5, [&sums, frame](unsigned int index) {
+				for (uint64_t i = 0; i < 1000; i++)
+					sums[index] += frame + i;
+				});
+		}
+		for (uint64_t sum : sums)
+			CHECK(sum == 200 * 199 / 2 * 1000 + 200 * (999 * 1000 / 2));
+	}
+
+	//複数のスレッドから同時に呼んでも、1つずつ順に処理する
+	{
+		WorkerPool pool(2, "WorkerPoolTest");
+		std::atomic<int> failures = 0;
+		std::vector<std::thread> callers;
+		for (int caller = 0; caller < 3; caller++) {
+			callers.emplace_back([&pool, &failures]() {
+				for (int i = 0; i < 300; i++) {
+					if (!RunsEachTaskOnce(pool, 3))
+						failures++;
+				}
+				});
+		}
+		for (std::thread& caller : callers)
+			caller.join();
+		CHECK(failures.load() == 0);
+	}
+
+	return TestResult();
+}